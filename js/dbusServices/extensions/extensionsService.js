@@ -122,6 +122,24 @@ export const ExtensionsService = class extends ServiceImplementation {
         }
     }
 
+    async EnableExtensionsAsync(params, invocation) {
+        try {
+            const res = await this._proxy.EnableExtensionsAsync(...params);
+            invocation.return_value(new GLib.Variant('(ab)', res));
+        } catch (error) {
+            this._handleError(invocation, error);
+        }
+    }
+
+    async DisableExtensionsAsync(params, invocation) {
+        try {
+            const res = await this._proxy.DisableExtensionsAsync(...params);
+            invocation.return_value(new GLib.Variant('(ab)', res));
+        } catch (error) {
+            this._handleError(invocation, error);
+        }
+    }
+
     LaunchExtensionPrefsAsync([uuid], invocation) {
         this.OpenExtensionPrefsAsync([uuid, '', {}], invocation);
     }
@@ -27,10 +27,79 @@ const ScreenCastStreamProxy = Gio.DBusProxy.makeProxyWrapper(ScreenCastStreamIfa
 
 const DEFAULT_FRAMERATE = 30;
 const DEFAULT_DRAW_CURSOR = true;
+const DEFAULT_VARIABLE_FRAMERATE = false;
+
+// How long pipewiresrc waits for a new frame before resending the last
+// one, in milliseconds. Mutter only sends frames when the recorded area
+// changed, so with a variable frame rate, a static screen is encoded
+// only this often; resending still keeps the recording's duration and
+// fragments going.
+const KEEPALIVE_TIME = 1000;
+const VARIABLE_FRAMERATE_KEEPALIVE_TIME = 10000;
 
 const PIPELINE_BLOCKLIST_FILENAME = 'gnome-shell-screencast-pipeline-blocklist';
+const PIPELINE_PROBE_CACHE_FILENAME = 'screencast-pipelines.json';
 
+// Pipelines in order of preference. Hardware encoders take the DMABufs
+// straight from PipeWire, and are only tried if the probe at startup
+// found their `encoder` element to work on this machine. The last
+// pipeline is the fallback that must always be available.
 const PIPELINES = [
+    {
+        id: 'hwenc-dmabuf-h264-vaapi-lp',
+        fileExtension: 'mp4',
+        encoder: 'vah264lpenc',
+        pipelineString:
+            'capsfilter caps=video/x-raw(memory:DMABuf),max-framerate=%F/1 ! \
+             vapostproc ! \
+             capsfilter caps=video/x-raw(memory:VAMemory),format=NV12 ! \
+             queue ! \
+             vah264lpenc ! \
+             queue ! \
+             h264parse ! \
+             mp4mux fragment-duration=500 fragment-mode=first-moov-then-finalise',
+    },
+    {
+        id: 'hwenc-dmabuf-h264-vaapi',
+        fileExtension: 'mp4',
+        encoder: 'vah264enc',
+        pipelineString:
+            'capsfilter caps=video/x-raw(memory:DMABuf),max-framerate=%F/1 ! \
+             vapostproc ! \
+             capsfilter caps=video/x-raw(memory:VAMemory),format=NV12 ! \
+             queue ! \
+             vah264enc ! \
+             queue ! \
+             h264parse ! \
+             mp4mux fragment-duration=500 fragment-mode=first-moov-then-finalise',
+    },
+    {
+        id: 'hwenc-dmabuf-h264-nvenc',
+        fileExtension: 'mp4',
+        encoder: 'nvh264enc',
+        pipelineString:
+            'capsfilter caps=video/x-raw(memory:DMABuf),max-framerate=%F/1 ! \
+             glupload ! glcolorconvert ! \
+             capsfilter caps=video/x-raw(memory:GLMemory),format=NV12 ! \
+             queue ! \
+             nvh264enc ! \
+             queue ! \
+             h264parse ! \
+             mp4mux fragment-duration=500 fragment-mode=first-moov-then-finalise',
+    },
+    {
+        id: 'hwenc-dmabuf-h264-v4l2',
+        fileExtension: 'mp4',
+        encoder: 'v4l2h264enc',
+        pipelineString:
+            'capsfilter caps=video/x-raw(memory:DMABuf),max-framerate=%F/1 ! \
+             v4l2convert output-io-mode=dmabuf-import ! \
+             queue ! \
+             v4l2h264enc ! \
+             queue ! \
+             h264parse ! \
+             mp4mux fragment-duration=500 fragment-mode=first-moov-then-finalise',
+    },
     {
         id: 'swenc-dmabuf-h264-openh264',
         fileExtension: 'mp4',
@@ -79,6 +148,141 @@ const PIPELINES = [
     },
 ];
 
+/**
+ * @param {object} pipelineConfig - an entry of PIPELINES
+ * @returns {string[]} the names of the elements of the pipeline
+ */
+function getPipelineElements(pipelineConfig) {
+    return pipelineConfig.pipelineString.split('!').map(
+        e => e.trim().split(' ').at(0));
+}
+
+/**
+ * @param {string} path - a sysfs file
+ * @returns {string} the contents of the file, or an empty string
+ */
+function readSysfsFile(path) {
+    try {
+        const [, contents] = GLib.file_get_contents(path);
+        return new TextDecoder().decode(contents).trim();
+    } catch (e) {
+        return '';
+    }
+}
+
+/**
+ * @param {string} device - a sysfs device directory
+ * @returns {string} the name of the driver bound to the device
+ */
+function readSysfsDriver(device) {
+    try {
+        return GLib.path_get_basename(GLib.file_read_link(`${device}/driver`));
+    } catch (e) {
+        return '';
+    }
+}
+
+/**
+ * Identifies the GPUs of the machine, and the GStreamer version driving
+ * them, as the key to cache probing results under
+ *
+ * @returns {string}
+ */
+function getProbeCacheKey() {
+    const gpus = [];
+
+    try {
+        const enumerator = Gio.File.new_for_path('/sys/class/drm')
+            .enumerate_children('standard::name', Gio.FileQueryInfoFlags.NONE, null);
+
+        for (const info of enumerator) {
+            const name = info.get_name();
+            if (!name.startsWith('renderD'))
+                continue;
+
+            const device = `/sys/class/drm/${name}/device`;
+            gpus.push([
+                readSysfsFile(`${device}/vendor`),
+                readSysfsFile(`${device}/device`),
+                readSysfsDriver(device),
+            ].join(':'));
+        }
+    } catch (e) {
+        // No DRM devices, only software encoders can work
+    }
+
+    return [...gpus.sort(), Gst.version_string()].join(';');
+}
+
+/**
+ * Checks whether the encoder of a hardware pipeline can open its device,
+ * which fails without a supported GPU even if the element exists.
+ *
+ * @param {object} pipelineConfig - an entry of PIPELINES
+ * @returns {boolean}
+ */
+function probePipeline(pipelineConfig) {
+    if (getPipelineElements(pipelineConfig).some(e => Gst.ElementFactory.find(e) === null))
+        return false;
+
+    if (!pipelineConfig.encoder)
+        return true;
+
+    const encoder = Gst.ElementFactory.make(pipelineConfig.encoder, null);
+    if (!encoder)
+        return false;
+
+    const works = encoder.set_state(Gst.State.READY) !== Gst.StateChangeReturn.FAILURE;
+    encoder.set_state(Gst.State.NULL);
+
+    return works;
+}
+
+/**
+ * Returns the pipelines that work on this machine, in order of
+ * preference. Probing opens devices, so results are cached per GPU.
+ *
+ * @returns {object[]} entries of PIPELINES
+ */
+function getWorkingPipelines() {
+    const cacheFile = Gio.File.new_for_path(GLib.build_filenamev([
+        GLib.get_user_cache_dir(), 'gnome-shell', PIPELINE_PROBE_CACHE_FILENAME]));
+    const key = getProbeCacheKey();
+    let cache = {};
+
+    try {
+        const [, contents] = cacheFile.load_contents(null);
+        cache = JSON.parse(new TextDecoder().decode(contents));
+    } catch (e) {
+        if (!e.matches?.(Gio.IOErrorEnum, Gio.IOErrorEnum.NOT_FOUND))
+            console.log(`Failed to load screencast pipeline cache: ${e.message}`);
+    }
+
+    let ids = cache[key];
+    if (!Array.isArray(ids)) {
+        ids = PIPELINES.filter(probePipeline).map(p => p.id);
+        cache[key] = ids;
+
+        try {
+            cacheFile.get_parent().make_directory_with_parents(null);
+        } catch (e) {
+            if (!e.matches(Gio.IOErrorEnum, Gio.IOErrorEnum.EXISTS))
+                console.log(`Failed to create cache directory: ${e.message}`);
+        }
+
+        try {
+            cacheFile.replace_contents(JSON.stringify(cache), null, false,
+                Gio.FileCreateFlags.NONE, null);
+        } catch (e) {
+            console.log(`Failed to save screencast pipeline cache: ${e.message}`);
+        }
+    }
+
+    // Software pipelines don't depend on the GPU, so keep them even if
+    // the cache predates them
+    return PIPELINES.filter(p => ids.includes(p.id) || !p.encoder);
+}
+
 const PipelineState = {
     INIT: 'INIT',
     STARTING: 'STARTING',
@@ -96,9 +300,11 @@ const SessionState = {
 
 class Recorder extends Signals.EventEmitter {
     constructor(sessionPath, x, y, width, height, filePathStem, options,
-        invocation) {
+        pipelines, invocation) {
         super();
 
+        this._pipelines = pipelines;
+
         this._dbusConnection = invocation.get_connection();
 
         this._x = x;
@@ -118,6 +324,7 @@ class Recorder extends Signals.EventEmitter {
         this._pipelineString = null;
         this._framerate = DEFAULT_FRAMERATE;
         this._drawCursor = DEFAULT_DRAW_CURSOR;
+        this._variableFramerate = DEFAULT_VARIABLE_FRAMERATE;
         this._blocklistFromPreviousCrashes = [];
 
         const pipelineBlocklistPath = GLib.build_filenamev(
@@ -153,6 +360,8 @@ class Recorder extends Signals.EventEmitter {
             this._framerate = options['framerate'];
         if ('draw-cursor' in options)
             this._drawCursor = options['draw-cursor'];
+        if ('variable-framerate' in options)
+            this._variableFramerate = options['variable-framerate'];
     }
 
     _addRecentItem() {
@@ -322,7 +531,7 @@ class Recorder extends Signals.EventEmitter {
         const fallbackSupported =
                 Gst.Registry.get().check_feature_version('pipewiresrc', 0, 3, 67);
         if (fallbackSupported)
-            yield* PIPELINES;
+            yield* this._pipelines;
         else
             yield PIPELINES.at(-1);
     }
@@ -331,6 +540,10 @@ class Recorder extends Signals.EventEmitter {
         return new Promise((resolve, reject) => {
             this._startRequest = {resolve, reject};
 
+            // Mutter paints only the requested area into the stream, so
+            // the capture and conversion cost scales with the size of the
+            // area rather than of the monitors it is on; the pipelines
+            // must not crop the frames again.
             const [streamPath] = this._sessionProxy.RecordAreaSync(
                 this._x, this._y,
                 this._width, this._height,
@@ -477,10 +690,13 @@ class Recorder extends Signals.EventEmitter {
         const finalPipelineString = this._substituteVariables(pipelineString, framerate);
         this._filePath = `${this._filePathStem}.${fileExtension}`;
 
+        const keepaliveTime = this._variableFramerate
+            ? VARIABLE_FRAMERATE_KEEPALIVE_TIME : KEEPALIVE_TIME;
+
         const fullPipeline = `
             pipewiresrc path=${nodeId}
                         do-timestamp=true
-                        keepalive-time=1000
+                        keepalive-time=${keepaliveTime}
                         resend-last=true !
             ${finalPipelineString} !
             filesink location="${this._filePath}"`;
@@ -507,8 +723,7 @@ export const ScreencastService = class extends ServiceImplementation {
         // guaranteed to work because they depend on hw encoders.
         const fallbackPipeline = PIPELINES.at(-1);
 
-        elements = fallbackPipeline.pipelineString.split('!').map(
-            e => e.trim().split(' ').at(0));
+        elements = getPipelineElements(fallbackPipeline);
 
         if (elements.every(e => Gst.ElementFactory.find(e) !== null))
             return true;
@@ -525,6 +740,8 @@ export const ScreencastService = class extends ServiceImplementation {
         Gst.init(null);
         Gtk.init();
 
+        this._pipelines = this._canScreencast ? getWorkingPipelines() : [];
+
         this.release();
 
         this._recorders = new Map();
@@ -655,6 +872,7 @@ export const ScreencastService = class extends ServiceImplementation {
                 screenWidth, screenHeight,
                 filePathStem,
                 options,
+                this._pipelines,
                 invocation);
         } catch (error) {
             log(`Failed to create recorder: ${error.message}`);
@@ -726,6 +944,7 @@ export const ScreencastService = class extends ServiceImplementation {
                 width, height,
                 filePathStem,
                 options,
+                this._pipelines,
                 invocation);
         } catch (error) {
             log(`Failed to create recorder: ${error.message}`);
@@ -51,7 +51,7 @@ export const UserListItem = GObject.registerClass({
     Signals: {'activate': {}},
 }, class UserListItem extends St.Button {
     _init(user) {
-        let layout = new St.BoxLayout({
+        this._layout = new St.BoxLayout({
             vertical: true,
             x_expand: true,
         });
@@ -60,31 +60,43 @@ export const UserListItem = GObject.registerClass({
             button_mask: St.ButtonMask.ONE | St.ButtonMask.THREE,
             can_focus: true,
             x_expand: true,
-            child: layout,
+            child: this._layout,
             reactive: true,
         });
 
-        this.user = user;
-        this.user.connectObject('changed', this._onUserChanged.bind(this), this);
-
         this.connect('notify::hover', () => {
             this._setSelected(this.hover);
         });
 
+        // The indicator always takes its space, so that all rows of the
+        // list have the same height
+        this._timedLoginIndicator = new St.Bin({
+            style_class: 'login-dialog-timed-login-indicator',
+            scale_x: 0,
+        });
+        this._layout.add_child(this._timedLoginIndicator);
+
+        this.setUser(user);
+    }
+
+    setUser(user) {
+        if (this.user === user)
+            return;
+
+        this.user?.disconnectObject(this);
+        this._userWidget?.destroy();
+
+        this.user = user;
+        this.user.connectObject('changed', this._onUserChanged.bind(this), this);
+
         this._userWidget = new UserWidget.UserWidget(this.user);
-        layout.add_child(this._userWidget);
+        this._layout.insert_child_at_index(this._userWidget, 0);
 
         this._userWidget.bind_property('label-actor',
             this, 'label-actor',
             GObject.BindingFlags.SYNC_CREATE);
 
-        this._timedLoginIndicator = new St.Bin({
-            style_class: 'login-dialog-timed-login-indicator',
-            scale_x: 0,
-            visible: false,
-        });
-        layout.add_child(this._timedLoginIndicator);
-
+        this.setTimedLoginProgress(0);
         this._onUserChanged();
     }
 
@@ -122,49 +134,15 @@ export const UserListItem = GObject.registerClass({
         }
     }
 
-    showTimedLoginIndicator(time) {
-        let hold = new Batch.Hold();
-
-        this.hideTimedLoginIndicator();
-
-        this._timedLoginIndicator.visible = true;
-
-        let startTime = GLib.get_monotonic_time();
-
-        this._timedLoginTimeoutId = GLib.timeout_add(GLib.PRIORITY_DEFAULT, 33,
-            () => {
-                let currentTime = GLib.get_monotonic_time();
-                let elapsedTime = (currentTime - startTime) / GLib.USEC_PER_SEC;
-                this._timedLoginIndicator.scale_x = elapsedTime / time;
-                if (elapsedTime >= time) {
-                    this._timedLoginTimeoutId = 0;
-                    hold.release();
-                    return GLib.SOURCE_REMOVE;
-                }
-
-                return GLib.SOURCE_CONTINUE;
-            });
-
-        GLib.Source.set_name_by_id(this._timedLoginTimeoutId, '[gnome-shell] this._timedLoginTimeoutId');
-
-        return hold;
-    }
-
-    hideTimedLoginIndicator() {
-        if (this._timedLoginTimeoutId) {
-            GLib.source_remove(this._timedLoginTimeoutId);
-            this._timedLoginTimeoutId = 0;
-        }
-
-        this._timedLoginIndicator.visible = false;
-        this._timedLoginIndicator.scale_x = 0.;
+    setTimedLoginProgress(progress) {
+        this._timedLoginIndicator.scale_x = progress;
     }
 });
 
 const UserList = GObject.registerClass({
     Signals: {
         'activate': {param_types: [UserListItem.$gtype]},
-        'item-added': {param_types: [UserListItem.$gtype]},
+        'user-added': {param_types: [AccountsService.User.$gtype]},
     },
 }, class UserList extends St.ScrollView {
     _init() {
@@ -174,14 +152,88 @@ const UserList = GObject.registerClass({
             y_expand: true,
         });
 
-        this._box = new St.BoxLayout({
-            vertical: true,
+        // Sites with directory-backed accounts can list hundreds of
+        // users, so only the rows on screen get an item, and with it an
+        // avatar; the avatars of the other users aren't loaded until
+        // their rows scroll into view
+        this._model = new Gio.ListStore({item_type: AccountsService.User});
+        // Users by user name
+        this._users = new Map();
+        // Realized rows by the user name they show
+        this._rows = new Map();
+
+        this._view = new St.ListView({
             style_class: 'login-dialog-user-list',
             pseudo_class: 'expanded',
         });
+        this._view.set_model(this._model, this._bindRow.bind(this));
 
-        this.child = this._box;
-        this._items = {};
+        this.child = this._view;
+
+        this._pendingFocusUserName = null;
+        this._timedLoginUserName = null;
+        this._timedLoginProgress = 0;
+        this._timedLoginTimeoutId = 0;
+    }
+
+    _bindRow(item, user) {
+        if (item) {
+            if (this._rows.get(item.user.get_user_name()) === item)
+                this._rows.delete(item.user.get_user_name());
+            item.setUser(user);
+        } else {
+            item = new UserListItem(user);
+
+            item.connect('activate', this._onItemActivated.bind(this));
+
+            // Try to keep the focused item front-and-center
+            item.connect('key-focus-in', () => this.scrollToItem(item));
+
+            item.connect('destroy', () => {
+                if (this._rows.get(item.user.get_user_name()) === item)
+                    this._rows.delete(item.user.get_user_name());
+            });
+        }
+
+        let userName = user.get_user_name();
+        this._rows.set(userName, item);
+
+        if (userName === this._timedLoginUserName)
+            item.setTimedLoginProgress(this._timedLoginProgress);
+
+        if (userName === this._pendingFocusUserName) {
+            this._pendingFocusUserName = null;
+
+            // Rows are bound while the list is allocated
+            const laters = global.compositor.get_laters();
+            laters.add(Meta.LaterType.BEFORE_REDRAW, () => {
+                if (this._getItem(userName) === item)
+                    item.grab_key_focus();
+                return false;
+            });
+        }
+
+        return item;
+    }
+
+    _getItem(userName) {
+        let item = this._rows.get(userName);
+
+        // Rows that scrolled out of view are hidden until they are reused
+        if (!item?.visible)
+            return null;
+
+        return item;
+    }
+
+    _getPosition(userName) {
+        let user = this._users.get(userName);
+
+        if (!user)
+            return -1;
+
+        let [found, position] = this._model.find(user);
+        return found ? position : -1;
     }
 
     vfunc_key_focus_in() {
@@ -190,7 +242,7 @@ const UserList = GObject.registerClass({
     }
 
     _moveFocusToItems() {
-        let hasItems = Object.keys(this._items).length > 0;
+        let hasItems = this._users.size > 0;
 
         if (!hasItems)
             return;
@@ -214,14 +266,12 @@ const UserList = GObject.registerClass({
 
     updateStyle(isExpanded) {
         if (isExpanded)
-            this._box.add_style_pseudo_class('expanded');
+            this._view.add_style_pseudo_class('expanded');
         else
-            this._box.remove_style_pseudo_class('expanded');
+            this._view.remove_style_pseudo_class('expanded');
 
-        for (let userName in this._items) {
-            let item = this._items[userName];
+        for (let item of this._rows.values())
             item.sync_hover();
-        }
     }
 
     scrollToItem(item) {
@@ -246,49 +296,121 @@ const UserList = GObject.registerClass({
         adjustment.set_value(value);
     }
 
-    getItemFromUserName(userName) {
-        let item = this._items[userName];
+    jumpToUser(userName) {
+        let item = this._getItem(userName);
 
-        if (!item)
-            return null;
+        if (item) {
+            this.jumpToItem(item);
+            return;
+        }
 
-        return item;
+        let position = this._getPosition(userName);
+        if (position >= 0)
+            this._view.scroll_to(position);
     }
 
-    containsUser(user) {
-        return this._items[user.get_user_name()] != null;
-    }
+    focusUser(userName) {
+        let item = this._getItem(userName);
 
-    addUser(user) {
-        if (!user.is_loaded)
+        if (item) {
+            this.scrollToItem(item);
+            item.grab_key_focus();
             return;
+        }
 
-        if (user.is_system_account())
+        let position = this._getPosition(userName);
+        if (position < 0)
             return;
 
-        if (user.locked)
-            return;
+        // The row only exists once the list is laid out again, and gets
+        // centered when it takes the focus
+        this._pendingFocusUserName = userName;
+        this._view.scroll_to(position);
+    }
 
-        let userName = user.get_user_name();
+    showTimedLoginIndicator(userName, time) {
+        let hold = new Batch.Hold();
 
-        if (!userName)
-            return;
+        this.hideTimedLoginIndicator();
+
+        this._timedLoginUserName = userName;
+
+        let startTime = GLib.get_monotonic_time();
+
+        this._timedLoginTimeoutId = GLib.timeout_add(GLib.PRIORITY_DEFAULT, 33,
+            () => {
+                let currentTime = GLib.get_monotonic_time();
+                let elapsedTime = (currentTime - startTime) / GLib.USEC_PER_SEC;
+                this._timedLoginProgress = elapsedTime / time;
+                this._getItem(userName)?.setTimedLoginProgress(this._timedLoginProgress);
+                if (elapsedTime >= time) {
+                    this._timedLoginTimeoutId = 0;
+                    hold.release();
+                    return GLib.SOURCE_REMOVE;
+                }
+
+                return GLib.SOURCE_CONTINUE;
+            });
 
-        this.removeUser(user);
+        GLib.Source.set_name_by_id(this._timedLoginTimeoutId, '[gnome-shell] this._timedLoginTimeoutId');
+
+        return hold;
+    }
+
+    hideTimedLoginIndicator() {
+        if (this._timedLoginTimeoutId) {
+            GLib.source_remove(this._timedLoginTimeoutId);
+            this._timedLoginTimeoutId = 0;
+        }
+
+        if (this._timedLoginUserName)
+            this._getItem(this._timedLoginUserName)?.setTimedLoginProgress(0);
+
+        this._timedLoginUserName = null;
+        this._timedLoginProgress = 0;
+    }
+
+    getUserFromUserName(userName) {
+        return this._users.get(userName) ?? null;
+    }
+
+    containsUser(user) {
+        return this._users.has(user.get_user_name());
+    }
+
+    _canList(user) {
+        if (!user.is_loaded)
+            return false;
+
+        if (user.is_system_account())
+            return false;
+
+        if (user.locked)
+            return false;
 
-        let item = new UserListItem(user);
-        this._box.add_child(item);
+        return !!user.get_user_name();
+    }
 
-        this._items[userName] = item;
+    addUsers(users) {
+        users = users.filter(user => this._canList(user));
 
-        item.connect('activate', this._onItemActivated.bind(this));
+        for (let user of users)
+            this.removeUser(user);
 
-        // Try to keep the focused item front-and-center
-        item.connect('key-focus-in', () => this.scrollToItem(item));
+        // Add the initial users in one go rather than relaying out the
+        // list for each of them
+        for (let user of users)
+            this._users.set(user.get_user_name(), user);
+        this._model.splice(this._model.get_n_items(), 0, users);
 
         this._moveFocusToItems();
 
-        this.emit('item-added', item);
+        for (let user of users)
+            this.emit('user-added', user);
+    }
+
+    addUser(user) {
+        this.addUsers([user]);
     }
 
     removeUser(user) {
@@ -300,17 +422,17 @@ const UserList = GObject.registerClass({
         if (!userName)
             return;
 
-        let item = this._items[userName];
+        let position = this._getPosition(userName);
 
-        if (!item)
+        if (position < 0)
             return;
 
-        item.destroy();
-        delete this._items[userName];
+        this._model.remove(position);
+        this._users.delete(userName);
     }
 
     numItems() {
-        return Object.keys(this._items).length;
+        return this._users.size;
     }
 });
 
@@ -1175,18 +1297,18 @@ export const LoginDialog = GObject.registerClass({
         this._authPrompt.finish(() => this._startSession(serviceName));
     }
 
-    _waitForItemForUser(userName) {
-        let item = this._userList.getItemFromUserName(userName);
+    _waitForUser(userName) {
+        let user = this._userList.getUserFromUserName(userName);
 
-        if (item)
+        if (user)
             return null;
 
         let hold = new Batch.Hold();
-        let signalId = this._userList.connect('item-added',
+        let signalId = this._userList.connect('user-added',
             () => {
-                item = this._userList.getItemFromUserName(userName);
+                user = this._userList.getUserFromUserName(userName);
 
-                if (item)
+                if (user)
                     hold.release();
             });
 
@@ -1224,7 +1346,6 @@ export const LoginDialog = GObject.registerClass({
             this._timedLoginIdleTimeOutId = 0;
         }
 
-        let loginItem = null;
         let animationTime;
 
         let tasks = [
@@ -1232,20 +1353,18 @@ export const LoginDialog = GObject.registerClass({
                 if (this._disableUserList)
                     return null;
 
-                this._timedLoginUserListHold = this._waitForItemForUser(userName);
+                this._timedLoginUserListHold = this._waitForUser(userName);
                 return this._timedLoginUserListHold;
             },
 
             () => {
                 this._timedLoginUserListHold = null;
 
+                // If there is an animation running on the item, reset it.
                 if (this._disableUserList)
-                    loginItem = this._authPrompt;
+                    this._authPrompt.hideTimedLoginIndicator();
                 else
-                    loginItem = this._userList.getItemFromUserName(userName);
-
-                // If there is an animation running on the item, reset it.
-                loginItem.hideTimedLoginIndicator();
+                    this._userList.hideTimedLoginIndicator();
             },
 
             () => {
@@ -1254,7 +1373,7 @@ export const LoginDialog = GObject.registerClass({
 
                 // If we're just starting out, start on the right item.
                 if (!this._userManager.is_loaded)
-                    this._userList.jumpToItem(loginItem);
+                    this._userList.jumpToUser(userName);
             },
 
             () => {
@@ -1281,13 +1400,16 @@ export const LoginDialog = GObject.registerClass({
                     this._authPrompt.visible)
                     this._authPrompt.cancel();
 
-                if (delay > _TIMED_LOGIN_IDLE_THRESHOLD || firstRun) {
-                    this._userList.scrollToItem(loginItem);
-                    loginItem.grab_key_focus();
-                }
+                if (delay > _TIMED_LOGIN_IDLE_THRESHOLD || firstRun)
+                    this._userList.focusUser(userName);
             },
 
-            () => loginItem.showTimedLoginIndicator(animationTime),
+            () => {
+                if (this._disableUserList)
+                    return this._authPrompt.showTimedLoginIndicator(animationTime);
+
+                return this._userList.showTimedLoginIndicator(userName, animationTime);
+            },
 
             () => {
                 this._timedLoginBatch = null;
@@ -1390,10 +1512,7 @@ export const LoginDialog = GObject.registerClass({
 
         this._userListLoaded = true;
 
-        let users = this._userManager.list_users();
-
-        for (let i = 0; i < users.length; i++)
-            this._userList.addUser(users[i]);
+        this._userList.addUsers(this._userManager.list_users());
 
         this._updateDisableUserList();
 
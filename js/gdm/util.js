@@ -10,14 +10,12 @@ import * as Batch from './batch.js';
 import * as OVirt from './oVirt.js';
 import * as Vmware from './vmware.js';
 import * as Main from '../ui/main.js';
-import {loadInterfaceXML} from '../misc/fileUtils.js';
+import {loadInterfaceInfo} from '../misc/fileUtils.js';
 import * as Params from '../misc/params.js';
 import * as SmartcardManager from '../misc/smartcardManager.js';
 
-const FprintManagerInfo = Gio.DBusInterfaceInfo.new_for_xml(
-    loadInterfaceXML('net.reactivated.Fprint.Manager'));
-const FprintDeviceInfo = Gio.DBusInterfaceInfo.new_for_xml(
-    loadInterfaceXML('net.reactivated.Fprint.Device'));
+const FprintManagerInfo = loadInterfaceInfo('net.reactivated.Fprint.Manager');
+const FprintDeviceInfo = loadInterfaceInfo('net.reactivated.Fprint.Device');
 
 Gio._promisify(Gdm.Client.prototype, 'open_reauthentication_channel');
 Gio._promisify(Gdm.Client.prototype, 'get_user_verifier');
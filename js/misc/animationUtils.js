@@ -37,8 +37,14 @@ export function ensureActorVisibleInScrollView(scrollView, actor) {
 
     let offset = 0;
     const vfade = scrollView.get_effect('fade');
-    if (vfade)
+    if (vfade) {
         offset = vfade.fade_margins.top;
+    } else {
+        // Fades into a solid color are painted without the effect
+        const [found, fadeOffset] = scrollView.get_theme_node().lookup_length('-st-vfade-offset', false);
+        if (found)
+            offset = fadeOffset;
+    }
 
     let box = actor.get_allocation_box();
     let y1 = box.y1, y2 = box.y2;
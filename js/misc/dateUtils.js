@@ -9,6 +9,88 @@ import * as Params from './params.js';
 let _desktopSettings = null;
 let _localTimeZone = null;
 
+// Clocks and calendars format the same few strings over and over, so
+// both translated formats and formatted times are kept around
+const MAX_CACHED_TIMES = 256;
+const _translatedFormats = new Map();
+const _formattedTimes = new Map();
+
+/**
+ * Translates a time format string, like Shell.util_translate_time_string(),
+ * but does so only once per format
+ *
+ * @param {string} format the format string to translate
+ * @returns {string}
+ */
+export function translateTimeString(format) {
+    let translated = _translatedFormats.get(format);
+    if (translated === undefined) {
+        translated = Shell.util_translate_time_string(format);
+        _translatedFormats.set(format, translated);
+    }
+    return translated;
+}
+
+/**
+ * @private
+ *
+ * @param {string} format a format string
+ * @returns {number} the number of seconds over which the formatted
+ *   string can't change, or 0 if it changes all the time
+ */
+function _getFormatResolution(format) {
+    const conversions = format.match(/%[-_0^#]?[EO]?./g) ?? [];
+    const specifiers = conversions.map(c => c.at(-1)).join('');
+
+    if (/f/.test(specifiers))
+        return 0;
+    if (/[crsSTX+]/.test(specifiers))
+        return 1;
+    if (/[MR]/.test(specifiers))
+        return 60;
+    if (/[HIklpP]/.test(specifiers))
+        return 60 * 60;
+    return 24 * 60 * 60;
+}
+
+/**
+ * @private
+ *
+ * @param {GLib.DateTime} dt a date time
+ * @param {string} format a format string for the date
+ * @returns {string} the formatted date, reused for all times that
+ *   look the same with the format
+ */
+function _formatDateTime(dt, format) {
+    const resolution = _getFormatResolution(format);
+    if (resolution === 0)
+        return dt.format(format) ?? '';
+
+    // Key on the local time rather than the UTC one, so that formats
+    // that only show the day are reused for the whole local day; the
+    // offset tells apart the same local time before and after DST ends
+    const offset = dt.get_utc_offset() / GLib.TIME_SPAN_SECOND;
+    const localTime = dt.to_unix() + offset;
+    const key = [
+        format,
+        dt.get_timezone().get_identifier(),
+        offset,
+        Math.floor(localTime / resolution),
+    ].join('\n');
+
+    let formatted = _formattedTimes.get(key);
+    if (formatted !== undefined)
+        return formatted;
+
+    formatted = dt.format(format) ?? '';
+
+    if (_formattedTimes.size >= MAX_CACHED_TIMES)
+        _formattedTimes.delete(_formattedTimes.keys().next().value);
+    _formattedTimes.set(key, formatted);
+
+    return formatted;
+}
+
 /**
  * @private
  *
@@ -41,7 +123,7 @@ function _convertJSDateToGLibDateTime(date) {
 export function formatDateWithCFormatString(date, format) {
     const dt = _convertJSDateToGLibDateTime(date);
 
-    return dt?.format(format) ?? '';
+    return dt ? _formatDateTime(dt, format) : '';
 }
 
 /**
@@ -213,7 +295,7 @@ export function formatTime(time, params) {
     if (!params.ampm)
         format = format.replace(/\s*%p/g, '');
 
-    let formattedTime = date.format(Shell.util_translate_time_string(format));
+    let formattedTime = _formatDateTime(date, translateTimeString(format));
     // prepend LTR-mark to colon/ratio to force a text direction on times
     return formattedTime.replace(/([:\u2236])/g, '\u200e$1');
 }
@@ -229,4 +311,5 @@ export function clearCachedLocalTimeZone() {
     System.clearDateCaches();
 
     _localTimeZone = GLib.TimeZone.new_local();
+    _formattedTimes.clear();
 }
@@ -5,6 +5,11 @@ import * as Config from './config.js';
 
 let _ifaceResource = null;
 
+// Interfaces are loaded by name from many modules, often the same ones,
+// so both the XML and the parsed info are kept for the whole process
+const _ifaceXmls = new Map();
+const _ifaceInfos = new Map();
+
 /**
  * @private
  */
@@ -24,6 +29,10 @@ function _ensureIfaceResource() {
  * @returns {string | null} the XML string or null if it is not found
  */
 export function loadInterfaceXML(iface) {
+    let xml = _ifaceXmls.get(iface);
+    if (xml)
+        return xml;
+
     _ensureIfaceResource();
 
     let uri = `resource:///org/gnome/shell/dbus-interfaces/${iface}.xml`;
@@ -31,12 +40,35 @@ export function loadInterfaceXML(iface) {
 
     try {
         let [ok_, bytes] = f.load_contents(null);
-        return new TextDecoder().decode(bytes);
+        xml = new TextDecoder().decode(bytes);
     } catch (e) {
         log(`Failed to load D-Bus interface ${iface}`);
+        return null;
     }
 
-    return null;
+    _ifaceXmls.set(iface, xml);
+    return xml;
+}
+
+/**
+ * @param {string} iface the interface name
+ * @returns {Gio.DBusInterfaceInfo | null} the parsed interface, shared
+ *   by all callers, or null if it is not found
+ */
+export function loadInterfaceInfo(iface) {
+    let info = _ifaceInfos.get(iface);
+    if (info)
+        return info;
+
+    const xml = loadInterfaceXML(iface);
+    if (!xml)
+        return null;
+
+    info = Gio.DBusInterfaceInfo.new_for_xml(xml);
+    info.cache_build();
+
+    _ifaceInfos.set(iface, info);
+    return info;
 }
 
 /**
@@ -0,0 +1,138 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+// Events are filed under every local day they overlap, so that looking
+// up the events of a day or of a month only visits the events of those
+// days. Events spanning more than MAX_INDEXED_DAYS are kept aside and
+// checked on every lookup instead, so that they don't fill thousands
+// of days.
+const MAX_INDEXED_DAYS = 62;
+
+/**
+ * @param {Date} date - a date
+ * @returns {Date} the beginning of the day of the date
+ */
+function _getBeginningOfDay(date) {
+    return new Date(date.getFullYear(), date.getMonth(), date.getDate());
+}
+
+/**
+ * Lists the days an event overlaps, half-open like its interval,
+ * except that zero-length events are on the day they happen
+ *
+ * @param {Date} begin - the beginning of the interval
+ * @param {Date} end - the end of the interval
+ * @param {number} limit - how many days to list at most
+ * @returns {number[]} the beginnings of the days, as timestamps
+ */
+function _getDays(begin, end, limit) {
+    const days = [];
+    const day = _getBeginningOfDay(begin);
+
+    do {
+        days.push(day.getTime());
+        day.setDate(day.getDate() + 1);
+    } while (day < end && days.length <= limit);
+
+    return days;
+}
+
+export class EventIndex {
+    constructor() {
+        this.clear();
+    }
+
+    clear() {
+        // Events by ID
+        this._events = new Map();
+        // Sets of events by the beginning of their days, as timestamp
+        this._days = new Map();
+        this._longEvents = new Set();
+    }
+
+    /** @type {number} */
+    get size() {
+        return this._events.size;
+    }
+
+    /** @returns {Iterator<string>} */
+    ids() {
+        return this._events.keys();
+    }
+
+    /**
+     * Adds an event, or replaces the one with the same ID
+     *
+     * @param {object} event - the event, with id, date and end
+     */
+    set(event) {
+        this.delete(event.id);
+        this._events.set(event.id, event);
+
+        const days = _getDays(event.date, event.end, MAX_INDEXED_DAYS);
+        if (days.length > MAX_INDEXED_DAYS) {
+            this._longEvents.add(event);
+            return;
+        }
+
+        for (const day of days) {
+            let events = this._days.get(day);
+            if (!events) {
+                events = new Set();
+                this._days.set(day, events);
+            }
+            events.add(event);
+        }
+    }
+
+    /**
+     * @param {string} id - the ID of the event to remove
+     * @returns {boolean} whether there was such an event
+     */
+    delete(id) {
+        const event = this._events.get(id);
+        if (!event)
+            return false;
+
+        this._events.delete(id);
+
+        if (this._longEvents.delete(event))
+            return true;
+
+        for (const day of _getDays(event.date, event.end, MAX_INDEXED_DAYS)) {
+            const events = this._days.get(day);
+            events.delete(event);
+            if (events.size === 0)
+                this._days.delete(day);
+        }
+
+        return true;
+    }
+
+    /**
+     * Yields every event on the days of the interval once; callers
+     * still have to check whether each overlaps the interval itself
+     *
+     * @param {Date} begin - the beginning of the interval
+     * @param {Date} end - the end of the interval
+     */
+    *candidates(begin, end) {
+        const seen = new Set();
+
+        yield* this._longEvents;
+
+        // Lookups of longer intervals than any indexed event need to see
+        // every day, however many, up to the end
+        for (const day of _getDays(begin, end, Infinity)) {
+            const events = this._days.get(day);
+            if (!events)
+                continue;
+
+            for (const event of events) {
+                if (seen.has(event))
+                    continue;
+                seen.add(event);
+                yield event;
+            }
+        }
+    }
+}
@@ -36,6 +36,7 @@ const SERIALIZED_PROPERTIES = [
     'hasPrefs',
     'hasUpdate',
     'canChange',
+    'busyTime',
 ];
 
 /**
@@ -0,0 +1,84 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+import GLib from 'gi://GLib';
+import Shell from 'gi://Shell';
+import System from 'system';
+
+// Statistics about the JavaScript heap, read from the memory info GJS
+// dumps, as [statistic name, section, member, description]
+const STATISTICS = [
+    ['gjs.gcBytes', 'gc', 'gcBytes',
+        'Size of the JavaScript heap, in bytes'],
+    ['gjs.gcMaxBytes', 'gc', 'gcMaxBytes',
+        'Maximum size of the JavaScript heap, in bytes'],
+    ['gjs.mallocBytes', 'gc', 'mallocBytes',
+        'Memory allocated by the JavaScript engine outside of its heap, in bytes'],
+    ['gjs.gcNumber', 'gc', 'gcNumber',
+        'Number of garbage collections of the JavaScript heap'],
+    ['gjs.majorGCCount', 'gc', 'majorGCCount',
+        'Number of major garbage collections of the JavaScript heap'],
+    ['gjs.minorGCCount', 'gc', 'minorGCCount',
+        'Number of minor garbage collections of the JavaScript heap'],
+    ['gjs.gobjectWrappers', 'gjs', 'object_instance',
+        'Number of JavaScript wrappers of GObjects'],
+];
+
+let _collectionRegistry = null;
+
+function _readMemoryInfo() {
+    const [fd, path] = GLib.file_open_tmp('gnome-shell-memory-XXXXXX.json');
+    GLib.close(fd);
+
+    try {
+        System.dumpMemoryInfo(path);
+
+        const [, contents] = GLib.file_get_contents(path);
+        return JSON.parse(new TextDecoder().decode(contents));
+    } finally {
+        GLib.unlink(path);
+    }
+}
+
+function _updateStatistics(perfLog) {
+    let info;
+    try {
+        info = _readMemoryInfo();
+    } catch (e) {
+        logError(e, 'Failed to read JavaScript memory info');
+        return;
+    }
+
+    for (const [name, section, member] of STATISTICS) {
+        const value = info[section]?.[member];
+        if (typeof value === 'number')
+            perfLog.update_statistic_x(name, value);
+    }
+}
+
+// Nothing points to the sentinel but the registry, so the cleanup
+// callback runs once the garbage collector found it unreachable
+function _watchCollection(perfLog) {
+    _collectionRegistry.register({}, perfLog);
+}
+
+/**
+ * Defines statistics of the JavaScript heap in the performance log,
+ * and logs a gjs.gcDetected event whenever garbage was collected.
+ */
+export function init() {
+    const perfLog = Shell.PerfLog.get_default();
+
+    for (const [name, , , description] of STATISTICS)
+        perfLog.define_statistic(name, description, 'x');
+
+    perfLog.add_statistics_callback(_updateStatistics);
+
+    perfLog.define_event('gjs.gcDetected',
+        'JavaScript objects were found to be garbage collected', '');
+
+    _collectionRegistry = new FinalizationRegistry(heldPerfLog => {
+        heldPerfLog.event('gjs.gcDetected');
+        _watchCollection(heldPerfLog);
+    });
+    _watchCollection(perfLog);
+}
@@ -0,0 +1,47 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+
+import Shell from 'gi://Shell';
+
+// Modules that most sessions never need are imported the first time
+// they are used, rather than with the rest of the shell at startup.
+// Imports go through this registry so that everyone using a module
+// shares the one import, however many ask for it while it loads.
+
+// Promises of imported modules, by URL
+const _modules = new Map();
+
+/**
+ * Imports a module, the first time it is asked for
+ *
+ * @param {string} url - the URL of the module
+ * @returns {Promise<object>} the namespace of the module
+ */
+export function load(url) {
+    let promise = _modules.get(url);
+
+    if (!promise) {
+        promise = import(url);
+        _modules.set(url, promise);
+
+        // Let the next caller try again
+        promise.catch(() => _modules.delete(url));
+    }
+
+    return promise;
+}
+
+/**
+ * Imports a module once the shell is idle, so that its first use doesn't
+ * wait for it
+ *
+ * @param {string} url - the URL of the module
+ */
+export function prewarm(url) {
+    if (_modules.has(url))
+        return;
+
+    global.add_idle_work(Shell.IdlePriority.LOW, 0, () => {
+        load(url).catch(e => logError(e, `Failed to import ${url}`));
+        return false;
+    });
+}
@@ -1,4 +1,5 @@
 import GObject from 'gi://GObject';
+import Shell from 'gi://Shell';
 
 const destroyableTypes = [];
 
@@ -167,9 +168,15 @@ class SignalTracker {
         const {ownerSignals, destroyId} = this._getSignalData(obj);
         this._map.delete(obj);
 
-        const ownerProto = this._getObjectProto(this._owner);
-        ownerSignals.forEach(id =>
-            this._disconnectSignalForProto(ownerProto, this._owner, id));
+        // GObject handlers are disconnected in one call, however many
+        if (this._owner instanceof GObject.Object) {
+            if (ownerSignals.length > 0)
+                Shell.util_disconnect_handlers(this._owner, ownerSignals);
+        } else {
+            const ownerProto = this._getObjectProto(this._owner);
+            ownerSignals.forEach(id =>
+                this._disconnectSignalForProto(ownerProto, this._owner, id));
+        }
         if (destroyId)
             this._disconnectSignal(obj, destroyId);
 
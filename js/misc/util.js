@@ -2,6 +2,7 @@
 
 import Gio from 'gi://Gio';
 import GLib from 'gi://GLib';
+import Meta from 'gi://Meta';
 import Pango from 'gi://Pango';
 import Shell from 'gi://Shell';
 import St from 'gi://St';
@@ -429,6 +430,66 @@ export class DBusSenderChecker {
     }
 }
 
+/**
+ * Coalesces the updates of an actor, like the ones following property
+ * changes of a D-Bus service, so that they run at most once per frame.
+ * With mappedOnly, updates wait until the actor is mapped, which is for
+ * updates that only affect what the actor itself shows.
+ */
+export class CoalescedUpdate {
+    /**
+     * @param {Clutter.Actor} actor - the actor that is updated
+     * @param {Function} callback - the function updating it
+     * @param {object=} params - optional parameters
+     * @param {bool=} params.mappedOnly - whether to wait for the actor to be mapped
+     */
+    constructor(actor, callback, params = {}) {
+        const {mappedOnly = false} = params;
+
+        this._actor = actor;
+        this._callback = callback;
+        this._mappedOnly = mappedOnly;
+        this._queued = false;
+        this._laterId = 0;
+
+        this._actor.connectObject(
+            'notify::mapped', () => this._maybeAddLater(),
+            'destroy', () => this.cancel(),
+            this);
+    }
+
+    queue() {
+        this._queued = true;
+        this._maybeAddLater();
+    }
+
+    cancel() {
+        this._queued = false;
+
+        if (this._laterId) {
+            const laters = global.compositor.get_laters();
+            laters.remove(this._laterId);
+            this._laterId = 0;
+        }
+    }
+
+    _maybeAddLater() {
+        if (!this._queued || this._laterId)
+            return;
+
+        if (this._mappedOnly && !this._actor.mapped)
+            return;
+
+        const laters = global.compositor.get_laters();
+        this._laterId = laters.add(Meta.LaterType.BEFORE_REDRAW, () => {
+            this._laterId = 0;
+            this._queued = false;
+            this._callback();
+            return GLib.SOURCE_REMOVE;
+        });
+    }
+}
+
 /* @class Highlighter Highlight given terms in text using markup. */
 export class Highlighter {
     /**
@@ -36,6 +36,8 @@ const HTTP_URI_FLAGS =
 const CONNECTIVITY_CHECK_HOST = 'nmcheck.gnome.org';
 const CONNECTIVITY_CHECK_URI = `http://${CONNECTIVITY_CHECK_HOST}`;
 const CONNECTIVITY_RECHECK_RATELIMIT_TIMEOUT = 30 * GLib.USEC_PER_SEC;
+// How long a prewarmed window is kept around without being used
+const PREWARM_TIMEOUT = 5 * 60;
 
 const HelperDBusInterface = loadInterfaceXML('org.gnome.Shell.PortalHelper');
 
@@ -109,7 +111,7 @@ class PortalSecurityButton extends Gtk.MenuButton {
 
 const PortalWindow = GObject.registerClass(
 class PortalWindow extends Gtk.ApplicationWindow {
-    _init(application, url, timestamp, doneCallback) {
+    _init(application) {
         super._init({
             application,
             title: _('Hotspot Login'),
@@ -123,18 +125,7 @@ class PortalWindow extends Gtk.ApplicationWindow {
 
         this.set_titlebar(headerbar);
 
-        if (!url) {
-            url = CONNECTIVITY_CHECK_URI;
-            this._originalUrlWasGnome = true;
-        } else {
-            this._originalUrlWasGnome = false;
-        }
-        this._uri = GLib.Uri.parse(url, HTTP_URI_FLAGS);
-        this._everSeenRedirect = false;
-        this._originalUrl = url;
-        this._doneCallback = doneCallback;
-        this._lastRecheck = 0;
-        this._recheckAtExit = false;
+        this._doneCallback = null;
 
         this._networkSession = WebKit.NetworkSession.new_ephemeral();
         this._networkSession.set_proxy_settings(WebKit.NetworkProxyMode.NO_PROXY, null);
@@ -150,18 +141,46 @@ class PortalWindow extends Gtk.ApplicationWindow {
         this._webView.connect('load-changed', this._onLoadChanged.bind(this));
         this._webView.connect('insecure-content-detected', this._onInsecureContentDetected.bind(this));
         this._webView.connect('load-failed-with-tls-errors', this._onLoadFailedWithTlsErrors.bind(this));
-        this._webView.load_uri(url);
         this._webView.connect('notify::uri', this._syncUri.bind(this));
-        this._syncUri();
 
         this.set_child(this._webView);
-        this.maximize();
-        this.present_with_time(timestamp);
 
         this.application.set_accels_for_action('app.quit', ['<Primary>q', '<Primary>w']);
     }
 
+    /**
+     * Spawns the web process with an empty page, so that a window
+     * created ahead of time shows the portal quickly once started
+     */
+    prewarm() {
+        this._webView.load_uri('about:blank');
+    }
+
+    start(url, timestamp, doneCallback) {
+        if (!url) {
+            url = CONNECTIVITY_CHECK_URI;
+            this._originalUrlWasGnome = true;
+        } else {
+            this._originalUrlWasGnome = false;
+        }
+        this._uri = GLib.Uri.parse(url, HTTP_URI_FLAGS);
+        this._everSeenRedirect = false;
+        this._originalUrl = url;
+        this._doneCallback = doneCallback;
+        this._lastRecheck = 0;
+        this._recheckAtExit = false;
+
+        this._webView.load_uri(url);
+        this._syncUri();
+
+        this.maximize();
+        this.present_with_time(timestamp);
+    }
+
     _syncUri() {
+        if (!this._doneCallback)
+            return;
+
         const {uri} = this._webView;
 
         try {
@@ -180,6 +199,9 @@ class PortalWindow extends Gtk.ApplicationWindow {
     }
 
     vfunc_close_request() {
+        if (!this._doneCallback)
+            return false;
+
         if (this._recheckAtExit)
             this._doneCallback(PortalHelperResult.RECHECK);
         else
@@ -214,6 +236,10 @@ class PortalWindow extends Gtk.ApplicationWindow {
     }
 
     _onDecidePolicy(view, decision, type) {
+        // Not started yet, loading the prewarm page
+        if (!this._doneCallback)
+            return false;
+
         if (type === WebKit.PolicyDecisionType.RESPONSE)
             return false;
 
@@ -294,6 +320,9 @@ class WebPortalHelper extends Adw.Application {
         this._dbusImpl = Gio.DBusExportedObject.wrapJSObject(HelperDBusInterface, this);
         this._queue = [];
 
+        this._prewarmedWindow = null;
+        this._prewarmTimeoutId = 0;
+
         let action = new Gio.SimpleAction({name: 'quit'});
         action.connect('activate', () => this.active_window.destroy());
         this.add_action(action);
@@ -316,6 +345,34 @@ class WebPortalHelper extends Adw.Application {
         this.Authenticate('/org/gnome/dummy', '', 0);
     }
 
+    Prewarm() {
+        if (this._prewarmedWindow || this._queue.length > 0)
+            return;
+
+        // The window holds the application, so let it go if it isn't
+        // used in a while, like the service would time out otherwise
+        this._prewarmedWindow = new PortalWindow(this);
+        this._prewarmedWindow.prewarm();
+        this._prewarmTimeoutId = GLib.timeout_add_seconds(GLib.PRIORITY_DEFAULT,
+            PREWARM_TIMEOUT, () => {
+                this._prewarmedWindow.destroy();
+                this._prewarmedWindow = null;
+                this._prewarmTimeoutId = 0;
+                return GLib.SOURCE_REMOVE;
+            });
+    }
+
+    _takePrewarmedWindow() {
+        const window = this._prewarmedWindow;
+        if (!window)
+            return new PortalWindow(this);
+
+        GLib.source_remove(this._prewarmTimeoutId);
+        this._prewarmTimeoutId = 0;
+        this._prewarmedWindow = null;
+        return window;
+    }
+
     Authenticate(connection, url, timestamp) {
         this._queue.push({connection, url, timestamp});
 
@@ -357,7 +414,8 @@ class WebPortalHelper extends Adw.Application {
         if (top.window != null)
             return;
 
-        top.window = new PortalWindow(this, top.url, top.timestamp, result => {
+        top.window = this._takePrewarmedWindow();
+        top.window.start(top.url, top.timestamp, result => {
             this._dbusImpl.emit_signal('Done', new GLib.Variant('(ou)', [top.connection, result]));
         });
     }
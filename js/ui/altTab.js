@@ -31,19 +31,45 @@ const AppIconMode = {
     BOTH: 3,
 };
 
-function _createWindowClone(window, size) {
-    let [width, height] = window.get_size();
+function _sizeWindowClone(clone, size) {
+    let [width, height] = clone.source.get_size();
     let scale = Math.min(1.0, size / width, size / height);
-    return new Clutter.Clone({
+    clone.set_size(width * scale, height * scale);
+}
+
+function _createWindowClone(window, size) {
+    const clone = new Clutter.Clone({
         source: window,
-        width: width * scale,
-        height: height * scale,
         x_align: Clutter.ActorAlign.CENTER,
         y_align: Clutter.ActorAlign.CENTER,
         // usual hack for the usual bug in ClutterBinLayout...
         x_expand: true,
         y_expand: true,
     });
+    _sizeWindowClone(clone, size);
+    return clone;
+}
+
+// The icons of the switchers are kept from one popup to the next, so that
+// showing a switcher doesn't recreate them. They are destroyed when their
+// app stops or their window goes away.
+const _appIcons = new Map();
+const _windowIcons = new Map();
+
+function _getCachedIcon(cache, key, create) {
+    let icon = cache.get(key);
+    if (!icon) {
+        icon = create();
+        cache.set(key, icon);
+        icon.connect('destroy', () => cache.delete(key));
+    }
+    return icon;
+}
+
+// Takes the icons out of the items of a switcher that is destroyed
+function _releaseCachedIcons(icons) {
+    for (const icon of icons)
+        icon.get_parent()?.remove_child(icon);
 }
 
 /**
@@ -674,6 +700,7 @@ class AppIcon extends St.BoxLayout {
 
         this.app = app;
         this.icon = null;
+        this._iconSize = 0;
         this._iconBin = new St.Bin();
 
         this.add_child(this._iconBin);
@@ -682,10 +709,20 @@ class AppIcon extends St.BoxLayout {
             x_align: Clutter.ActorAlign.CENTER,
         });
         this.add_child(this.label);
+
+        this.app.connectObject('notify::state', () => {
+            // Icons that are shown are removed by their switcher
+            if (this.app.state !== Shell.AppState.RUNNING && !this.get_parent())
+                this.destroy();
+        }, this);
     }
 
     // eslint-disable-next-line camelcase
     set_size(size) {
+        if (this._iconSize === size)
+            return;
+
+        this._iconSize = size;
         this.icon = this.app.create_icon_texture(size);
         this._iconBin.child = this.icon;
     }
@@ -709,17 +746,29 @@ class AppSwitcher extends SwitcherPopup.SwitcherList {
             workspace = workspaceManager.get_active_workspace();
         }
 
-        let allWindows = getWindows(workspace);
+        // Group the windows by app in one go, in the order of the tab list
+        const windowsByApp = new Map();
+        for (const window of getWindows(workspace)) {
+            const app = windowTracker.get_window_app(window);
+            const windows = windowsByApp.get(app);
+            if (windows)
+                windows.push(window);
+            else
+                windowsByApp.set(app, [window]);
+        }
 
         // Construct the AppIcons, add to the popup
         for (let i = 0; i < apps.length; i++) {
-            let appIcon = new AppIcon(apps[i]);
             // Cache the window list now; we don't handle dynamic changes here,
             // and we don't want to be continually retrieving it
-            appIcon.cachedWindows = allWindows.filter(
-                w => windowTracker.get_window_app(w) === appIcon.app);
-            if (appIcon.cachedWindows.length > 0)
-                this._addIcon(appIcon);
+            const cachedWindows = windowsByApp.get(apps[i]);
+            if (!cachedWindows)
+                continue;
+
+            const appIcon = _getCachedIcon(_appIcons, apps[i],
+                () => new AppIcon(apps[i]));
+            appIcon.cachedWindows = cachedWindows;
+            this._addIcon(appIcon);
         }
 
         this._altTabPopup = altTabPopup;
@@ -735,6 +784,7 @@ class AppSwitcher extends SwitcherPopup.SwitcherList {
 
         this.icons.forEach(
             icon => icon.app.disconnectObject(this));
+        _releaseCachedIcons(this.icons);
     }
 
     _setIconSize() {
@@ -772,11 +822,9 @@ class AppSwitcher extends SwitcherPopup.SwitcherList {
 
         this._iconSize = iconSize;
 
-        for (let i = 0; i < this.icons.length; i++) {
-            if (this.icons[i].icon != null)
-                break;
+        // Icons kept from a previous popup may need a different size
+        for (let i = 0; i < this.icons.length; i++)
             this.icons[i].set_size(iconSize);
-        }
     }
 
     vfunc_get_preferred_height(forWidth) {
@@ -1007,6 +1055,8 @@ class WindowIcon extends St.BoxLayout {
         });
 
         this.window = window;
+        this.mode = mode;
+        this._clones = [];
 
         this._icon = new St.Widget({layout_manager: new Clutter.BinLayout()});
 
@@ -1026,12 +1076,14 @@ class WindowIcon extends St.BoxLayout {
         switch (mode) {
         case AppIconMode.THUMBNAIL_ONLY:
             size = WINDOW_PREVIEW_SIZE;
-            this._icon.add_child(_createWindowClone(mutterWindow, size * scaleFactor));
+            this._clones.push(_createWindowClone(mutterWindow, size * scaleFactor));
+            this._icon.add_child(this._clones[0]);
             break;
 
         case AppIconMode.BOTH:
             size = WINDOW_PREVIEW_SIZE;
-            this._icon.add_child(_createWindowClone(mutterWindow, size * scaleFactor));
+            this._clones.push(_createWindowClone(mutterWindow, size * scaleFactor));
+            this._icon.add_child(this._clones[0]);
 
             if (this.app) {
                 this._icon.add_child(
@@ -1044,7 +1096,20 @@ class WindowIcon extends St.BoxLayout {
             this._icon.add_child(this._createAppIcon(this.app, size));
         }
 
-        this._icon.set_size(size * scaleFactor, size * scaleFactor);
+        this._size = size * scaleFactor;
+        this._icon.set_size(this._size, this._size);
+
+        // Icons that are shown are removed by their switcher
+        this.window.connectObject('unmanaged', () => {
+            if (!this.get_parent())
+                this.destroy();
+        }, this);
+    }
+
+    // Catches up with changes of the window since the icon was last shown
+    sync() {
+        this.label.text = this.window.get_title();
+        this._clones.forEach(clone => _sizeWindowClone(clone, this._size));
     }
 
     _createAppIcon(app, size) {
@@ -1072,9 +1137,19 @@ class WindowSwitcher extends SwitcherPopup.SwitcherList {
         this.windows = windows;
         this.icons = [];
 
+        const scaleFactor = St.ThemeContext.get_for_stage(global.stage).scale_factor;
+
         for (let i = 0; i < windows.length; i++) {
             let win = windows[i];
-            let icon = new WindowIcon(win, mode);
+            let icon = _getCachedIcon(_windowIcons, win, () => new WindowIcon(win, mode));
+
+            // Icons shown in a different way need to be created again
+            if (icon.mode !== mode || icon.scaleFactor !== scaleFactor) {
+                icon.destroy();
+                icon = _getCachedIcon(_windowIcons, win, () => new WindowIcon(win, mode));
+            }
+            icon.scaleFactor = scaleFactor;
+            icon.sync();
 
             this.addItem(icon, icon.label);
             this.icons.push(icon);
@@ -1089,6 +1164,7 @@ class WindowSwitcher extends SwitcherPopup.SwitcherList {
     _onDestroy() {
         this.icons.forEach(
             icon => icon.window.disconnectObject(this));
+        _releaseCachedIcons(this.icons);
     }
 
     vfunc_get_preferred_height(forWidth) {
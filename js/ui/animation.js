@@ -80,7 +80,7 @@ class Animation extends St.Bin {
 
         let textureCache = St.TextureCache.get_default();
         let scaleFactor = St.ThemeContext.get_for_stage(global.stage).scale_factor;
-        this._animations = textureCache.load_sliced_image(this._file,
+        this._animations = textureCache.load_sprite_sheet(this._file,
             this._width, this._height,
             scaleFactor, resourceScale,
             () => this._loadFinished());
@@ -96,15 +96,12 @@ class Animation extends St.Bin {
     }
 
     _showFrame(frame) {
-        let oldFrameActor = this._animations.get_child_at_index(this._frame);
-        if (oldFrameActor)
-            oldFrameActor.hide();
+        const {content} = this._animations;
+        if (!content)
+            return;
 
-        this._frame = frame % this._animations.get_n_children();
-
-        let newFrameActor = this._animations.get_child_at_index(this._frame);
-        if (newFrameActor)
-            newFrameActor.show();
+        this._frame = frame % content.get_n_frames();
+        content.set_frame(this._frame);
     }
 
     _update() {
@@ -113,7 +110,8 @@ class Animation extends St.Bin {
     }
 
     _loadFinished() {
-        this._isLoaded = this._animations.get_n_children() > 0;
+        const {content} = this._animations;
+        this._isLoaded = !!content && content.get_n_frames() > 0;
 
         if (this._isLoaded && this._isPlaying)
             this.play();
@@ -1857,8 +1857,7 @@ export class AppSearchProvider {
                 const app = this._appSys.lookup_app(appID);
                 return app && this._parentalControlsManager.shouldShowApp(app.app_info);
             });
-            results = results.concat(group.sort(
-                (a, b) => usage.compare(a, b)));
+            results = results.concat(usage.sort(group));
         });
 
         results = results.concat(this._systemActions.getMatchingActions(terms));
@@ -2973,6 +2972,38 @@ export const AppFolderDialog = GObject.registerClass({
     }
 });
 
+// App icons by app, whose running style is updated for all changed
+// apps at once, from Shell.AppSystem::apps-changed
+const _runningStyleIcons = new Map();
+let _appsChangedId = 0;
+
+function _onAppsChanged(appSystem, apps) {
+    for (const app of apps)
+        _runningStyleIcons.get(app)?.forEach(icon => icon._updateRunningStyle());
+}
+
+function _trackRunningStyle(icon) {
+    if (!_appsChangedId) {
+        _appsChangedId = Shell.AppSystem.get_default().connect(
+            'apps-changed', _onAppsChanged);
+    }
+
+    let icons = _runningStyleIcons.get(icon.app);
+    if (!icons) {
+        icons = new Set();
+        _runningStyleIcons.set(icon.app, icons);
+    }
+    icons.add(icon);
+}
+
+function _untrackRunningStyle(icon) {
+    const icons = _runningStyleIcons.get(icon.app);
+
+    icons?.delete(icon);
+    if (icons?.size === 0)
+        _runningStyleIcons.delete(icon.app);
+}
+
 export const AppIcon = GObject.registerClass({
     Signals: {
         'menu-state-changed': {param_types: [GObject.TYPE_BOOLEAN]},
@@ -3026,14 +3057,15 @@ export const AppIcon = GObject.registerClass({
         this._menuManager = new PopupMenu.PopupMenuManager(this);
 
         this._menuTimeoutId = 0;
-        this.app.connectObject('notify::state',
-            () => this._updateRunningStyle(), this);
+        _trackRunningStyle(this);
         this._updateRunningStyle();
     }
 
     _onDestroy() {
         super._onDestroy();
 
+        _untrackRunningStyle(this);
+
         if (this._folderPreviewId > 0) {
             GLib.source_remove(this._folderPreviewId);
             this._folderPreviewId = 0;
@@ -229,6 +229,49 @@ class BackgroundCache extends Signals.EventEmitter {
     }
 }
 
+/**
+ * Resolves what a background settings schema asks to be drawn.
+ *
+ * @param {Gio.Settings} settings - the background settings
+ * @param {Gio.Settings} interfaceSettings - the interface settings
+ * @returns {{file: ?Gio.File, style: number, key: string}} the image
+ *   file and style, and a key identifying everything that affects the
+ *   drawn background
+ */
+function getBackgroundSpec(settings, interfaceSettings) {
+    let file = null;
+    let style;
+
+    // Allow override the background image setting for performance testing
+    const overrideImage = GLib.getenv('SHELL_BACKGROUND_IMAGE');
+
+    if (overrideImage != null) {
+        file = Gio.File.new_for_path(overrideImage);
+        style = GDesktopEnums.BackgroundStyle.ZOOM; // Hardcode
+    } else {
+        style = settings.get_enum(BACKGROUND_STYLE_KEY);
+        if (style !== GDesktopEnums.BackgroundStyle.NONE) {
+            const colorScheme = interfaceSettings.get_enum('color-scheme');
+            const uri = settings.get_string(
+                colorScheme === GDesktopEnums.ColorScheme.PREFER_DARK
+                    ? PICTURE_URI_DARK_KEY
+                    : PICTURE_URI_KEY);
+
+            file = Gio.File.new_for_commandline_arg(uri);
+        }
+    }
+
+    const key = [
+        file?.get_uri() ?? '',
+        style,
+        settings.get_string(PRIMARY_COLOR_KEY),
+        settings.get_string(SECONDARY_COLOR_KEY),
+        settings.get_enum(COLOR_SHADING_TYPE_KEY),
+    ].join('|');
+
+    return {file, style, key};
+}
+
 /**
  * @returns {BackgroundCache}
  */
@@ -248,6 +291,7 @@ const Background = GObject.registerClass({
             settings: null,
             file: null,
             style: null,
+            specKey: null,
         });
 
         super._init({meta_display: global.display});
@@ -255,6 +299,7 @@ const Background = GObject.registerClass({
         this._settings = params.settings;
         this._file = params.file;
         this._style = params.style;
+        this._specKey = params.specKey;
         this._monitorIndex = params.monitorIndex;
         this._layoutManager = params.layoutManager;
         this._fileWatches = {};
@@ -279,10 +324,10 @@ const Background = GObject.registerClass({
             }, this);
 
         this._settings.connectObject('changed',
-            this._emitChangedSignal.bind(this), this);
+            () => this._onSettingsChanged(), this);
 
         this._interfaceSettings.connectObject(`changed::${COLOR_SCHEME_KEY}`,
-            this._emitChangedSignal.bind(this), this);
+            () => this._onSettingsChanged(), this);
 
         this._load();
     }
@@ -291,6 +336,12 @@ const Background = GObject.registerClass({
         this._cancellable.cancel();
         this._removeAnimationTimeout();
 
+        if (this._prefetchIdleId) {
+            GLib.source_remove(this._prefetchIdleId);
+            this._prefetchIdleId = 0;
+        }
+        this._prefetchedImages = null;
+
         let i;
         let keys = Object.keys(this._fileWatches);
         for (i = 0; i < keys.length; i++)
@@ -311,6 +362,18 @@ const Background = GObject.registerClass({
         }
     }
 
+    _onSettingsChanged() {
+        // Replacing the background means drawing it again for every
+        // monitor, so keep it when the image and colors stay the same,
+        // for example when switching the color scheme with a single
+        // picture for both
+        const {key} = getBackgroundSpec(this._settings, this._interfaceSettings);
+        if (key === this._specKey)
+            return;
+
+        this._emitChangedSignal();
+    }
+
     _emitChangedSignal() {
         if (this._changedIdleId)
             return;
@@ -410,6 +473,7 @@ const Background = GObject.registerClass({
                 this.set_file(null, this._style);
             }
             this._queueUpdateAnimation();
+            this._queuePrefetchNextSlide();
         };
 
         let cache = Meta.BackgroundImageCache.get_default();
@@ -433,6 +497,33 @@ const Background = GObject.registerClass({
         }
     }
 
+    _queuePrefetchNextSlide() {
+        if (this._prefetchIdleId)
+            return;
+
+        this._prefetchIdleId = GLib.idle_add(GLib.PRIORITY_LOW, () => {
+            this._prefetchIdleId = 0;
+            this._prefetchNextSlide();
+            return GLib.SOURCE_REMOVE;
+        });
+        GLib.Source.set_name_by_id(this._prefetchIdleId,
+            '[gnome-shell] Background._prefetchNextSlide');
+    }
+
+    _prefetchNextSlide() {
+        if (!this._animation || this._cancellable.is_cancelled())
+            return;
+
+        // Images of the next slide are loaded into the image cache well
+        // before it shows, so that the transition finds them decoded;
+        // holding on to them keeps them from being dropped meanwhile
+        const cache = Meta.BackgroundImageCache.get_default();
+        this._prefetchedImages = this._animation.nextKeyFrameFiles.map(file => {
+            this._watchFile(file);
+            return cache.load(file);
+        });
+    }
+
     _queueUpdateAnimation() {
         if (this._updateAnimationTimeoutId !== 0)
             return;
@@ -558,9 +649,7 @@ export const SystemBackground = GObject.registerClass({
 
 class BackgroundSource {
     constructor(layoutManager, settingsSchema) {
-        // Allow override the background image setting for performance testing
         this._layoutManager = layoutManager;
-        this._overrideImage = GLib.getenv('SHELL_BACKGROUND_IMAGE');
         this._settings = new Gio.Settings({schema_id: settingsSchema});
         this._backgrounds = [];
 
@@ -587,28 +676,11 @@ class BackgroundSource {
     }
 
     getBackground(monitorIndex) {
-        let file = null;
-        let style;
-
         // We don't watch changes to settings here,
         // instead we rely on Background to watch those
         // and emit 'bg-changed' at the right time
-
-        if (this._overrideImage != null) {
-            file = Gio.File.new_for_path(this._overrideImage);
-            style = GDesktopEnums.BackgroundStyle.ZOOM; // Hardcode
-        } else {
-            style = this._settings.get_enum(BACKGROUND_STYLE_KEY);
-            if (style !== GDesktopEnums.BackgroundStyle.NONE) {
-                const colorScheme = this._interfaceSettings.get_enum('color-scheme');
-                const uri = this._settings.get_string(
-                    colorScheme === GDesktopEnums.ColorScheme.PREFER_DARK
-                        ? PICTURE_URI_DARK_KEY
-                        : PICTURE_URI_KEY);
-
-                file = Gio.File.new_for_commandline_arg(uri);
-            }
-        }
+        const {file, style, key} =
+            getBackgroundSpec(this._settings, this._interfaceSettings);
 
         // Animated backgrounds are (potentially) per-monitor, since
         // they can have variants that depend on the aspect ratio and
@@ -624,6 +696,7 @@ class BackgroundSource {
                 settings: this._settings,
                 file,
                 style,
+                specKey: key,
             });
 
             background._changedId = background.connect('bg-changed', () => {
@@ -658,9 +731,12 @@ class Animation extends GnomeBG.BGSlideShow {
         super._init(params);
 
         this.keyFrameFiles = [];
+        this.nextKeyFrameFiles = [];
         this.transitionProgress = 0.0;
         this.transitionDuration = 0.0;
         this.loaded = false;
+
+        this._currentSlide = null;
     }
 
     // eslint-disable-next-line camelcase
@@ -678,7 +754,7 @@ class Animation extends GnomeBG.BGSlideShow {
         if (this.get_num_slides() < 1)
             return;
 
-        let [progress, duration, isFixed_, filename1, filename2] =
+        let [progress, duration, isFixed, filename1, filename2] =
             this.get_current_slide(monitor.width, monitor.height);
 
         this.transitionDuration = duration;
@@ -689,6 +765,33 @@ class Animation extends GnomeBG.BGSlideShow {
 
         if (filename2)
             this.keyFrameFiles.push(Gio.File.new_for_path(filename2));
+
+        const slide = `${isFixed}|${filename1}|${filename2}`;
+        if (slide !== this._currentSlide) {
+            this._currentSlide = slide;
+            this.nextKeyFrameFiles =
+                this._getNextSlideFiles(monitor, isFixed, filename1, filename2);
+        }
+    }
+
+    _getNextSlideFiles(monitor, isFixed, filename1, filename2) {
+        const {width, height} = monitor;
+        const nSlides = this.get_num_slides();
+
+        for (let i = 0; i < nSlides; i++) {
+            const [, , , fixed, file1, file2] =
+                this.get_slide(i, width, height);
+            if (fixed !== isFixed || file1 !== filename1 || file2 !== filename2)
+                continue;
+
+            const [, , , , nextFile1, nextFile2] =
+                this.get_slide((i + 1) % nSlides, width, height);
+            return [nextFile1, nextFile2]
+                .filter(f => f && f !== filename1 && f !== filename2)
+                .map(f => Gio.File.new_for_path(f));
+        }
+
+        return [];
     }
 });
 
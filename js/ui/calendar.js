@@ -14,12 +14,17 @@ import * as Mpris from './mpris.js';
 import * as PopupMenu from './popupMenu.js';
 import {ensureActorVisibleInScrollView} from '../misc/animationUtils.js';
 
-import {formatDateWithCFormatString} from '../misc/dateUtils.js';
-import {loadInterfaceXML} from '../misc/fileUtils.js';
+import {formatDateWithCFormatString, translateTimeString} from '../misc/dateUtils.js';
+import {EventIndex} from '../misc/eventIndex.js';
+import {loadInterfaceInfo} from '../misc/fileUtils.js';
 
 const SHOW_WEEKDATE_KEY = 'show-weekdate';
 const MAX_NOTIFICATION_BUTTONS = 3;
 
+// Notifications below the first this many only get messages once the
+// list is scrolled towards them, this many more at a time
+const NOTIFICATION_MESSAGE_BATCH = 20;
+
 const NC_ = (context, str) => `${context}\u0004${str}`;
 
 function sameYear(dateA, dateB) {
@@ -76,7 +81,27 @@ function _getCalendarDayAbbreviation(dayNumber) {
         /* Translators: Calendar grid abbreviation for Saturday */
         NC_('grid saturday', 'S'),
     ];
-    return Shell.util_translate_time_string(abbreviations[dayNumber]);
+    return translateTimeString(abbreviations[dayNumber]);
+}
+
+let _dayNumberLabels = null;
+
+/**
+ * @param {Date} date a date
+ * @returns {string} the label of the day of the date in the grid
+ */
+function _getDayNumberLabel(date) {
+    // Day numbers look the same in every month, so format them once
+    if (!_dayNumberLabels) {
+        const day = new Date(2000, 0, 1, 12);
+        _dayNumberLabels = [];
+        for (let i = 1; i <= 31; i++) {
+            day.setDate(i);
+            // xgettext:no-javascript-format
+            _dayNumberLabels[i] = formatDateWithCFormatString(day, C_('date day number format', '%d'));
+        }
+    }
+    return _dayNumberLabels[date.getDate()];
 }
 
 // Abstraction for an appointment/event in a calendar
@@ -164,9 +189,7 @@ class EmptyEventSource extends EventSourceBase {
     }
 });
 
-const CalendarServerIface = loadInterfaceXML('org.gnome.Shell.CalendarServer');
-
-const CalendarServerInfo  = Gio.DBusInterfaceInfo.new_for_xml(CalendarServerIface);
+const CalendarServerInfo = loadInterfaceInfo('org.gnome.Shell.CalendarServer');
 
 function CalendarServer() {
     return new Gio.DBusProxy({
@@ -241,10 +264,8 @@ class DBusEventSource extends EventSourceBase {
             }
         }
 
-        this._dbusProxy.connectSignal('EventsAddedOrUpdated',
-            this._onEventsAddedOrUpdated.bind(this));
-        this._dbusProxy.connectSignal('EventsRemoved',
-            this._onEventsRemoved.bind(this));
+        this._dbusProxy.connectSignal('EventsChanged',
+            this._onEventsChanged.bind(this));
         this._dbusProxy.connectSignal('ClientDisappeared',
             this._onClientDisappeared.bind(this));
 
@@ -282,14 +303,14 @@ class DBusEventSource extends EventSourceBase {
     }
 
     _resetCache() {
-        this._events = new Map();
+        this._events = new EventIndex();
         this._lastRequestBegin = null;
         this._lastRequestEnd = null;
     }
 
     _removeMatching(uidPrefix) {
         let changed = false;
-        for (const id of this._events.keys()) {
+        for (const id of this._events.ids()) {
             if (id.startsWith(uidPrefix))
                 changed = this._events.delete(id) || changed;
         }
@@ -307,16 +328,21 @@ class DBusEventSource extends EventSourceBase {
         this.emit('changed');
     }
 
-    _onEventsAddedOrUpdated(dbusProxy, nameOwner, argArray) {
-        const [appointments = []] = argArray;
+    _onEventsChanged(dbusProxy, nameOwner, argArray) {
+        const [
+            removedIds = [], ids = [], summaries = [], startTimes = [], endTimes = [],
+        ] = argArray;
         let changed = false;
-        const handledRemovals = new Set();
 
-        for (let n = 0; n < appointments.length; n++) {
-            const [id, summary, startTime, endTime] = appointments[n];
-            const date = new Date(startTime * 1000);
-            const end = new Date(endTime * 1000);
-            let event = new CalendarEvent(id, date, end, summary);
+        for (const id of removedIds)
+            changed = this._removeMatching(id) || changed;
+
+        const handledRemovals = new Set();
+        for (let n = 0; n < ids.length; n++) {
+            const id = ids[n];
+            const date = new Date(startTimes[n] * 1000);
+            const end = new Date(endTimes[n] * 1000);
+            const event = new CalendarEvent(id, date, end, summaries[n]);
             /* It's a recurring event */
             if (!id.endsWith('\n')) {
                 const parentId = id.substring(0, id.lastIndexOf('\n') + 1);
@@ -334,17 +360,6 @@ class DBusEventSource extends EventSourceBase {
             this.emit('changed');
     }
 
-    _onEventsRemoved(dbusProxy, nameOwner, argArray) {
-        const [ids = []] = argArray;
-
-        let changed = false;
-        for (const id of ids)
-            changed = this._removeMatching(id) || changed;
-
-        if (changed)
-            this.emit('changed');
-    }
-
     _onClientDisappeared(dbusProxy, nameOwner, argArray) {
         let [sourceUid = ''] = argArray;
         sourceUid += '\n';
@@ -359,10 +374,10 @@ class DBusEventSource extends EventSourceBase {
             return;
 
         if (this._curRequestBegin && this._curRequestEnd) {
-            if (forceReload) {
-                this._events.clear();
-                this.emit('changed');
-            }
+            // The server sends all events of the range again, those it
+            // has cached right away
+            this._events.clear();
+            this.emit('changed');
             this._dbusProxy.SetTimeRangeAsync(
                 this._curRequestBegin.getTime() / 1000,
                 this._curRequestEnd.getTime() / 1000,
@@ -377,12 +392,12 @@ class DBusEventSource extends EventSourceBase {
             this._lastRequestEnd = end;
             this._curRequestBegin = begin;
             this._curRequestEnd = end;
-            this._loadEvents(true);
+            this._loadEvents(false);
         }
     }
 
     *_getFilteredEvents(begin, end) {
-        for (const event of this._events.values()) {
+        for (const event of this._events.candidates(begin, end)) {
             if (_eventOverlapsInterval(event.date, event.end, begin, end))
                 yield event;
         }
@@ -665,8 +680,7 @@ export const Calendar = GObject.registerClass({
         let nRows = 8;
         while (row < nRows) {
             let button = new St.Button({
-                // xgettext:no-javascript-format
-                label: formatDateWithCFormatString(iter, C_('date day number format', '%d')),
+                label: _getDayNumberLabel(iter),
                 can_focus: true,
             });
             let rtl = button.get_text_direction() === Clutter.TextDirection.RTL;
@@ -725,7 +739,7 @@ export const Calendar = GObject.registerClass({
                     style_class: 'calendar-week-number',
                     can_focus: true,
                 });
-                let weekFormat = Shell.util_translate_time_string(N_('Week %V'));
+                let weekFormat = translateTimeString(N_('Week %V'));
                 label.clutter_text.y_align = Clutter.ActorAlign.CENTER;
                 label.accessible_name = formatDateWithCFormatString(iter, weekFormat);
                 layout.attach(label, rtl ? 7 : 0, row, 1, 1);
@@ -854,6 +868,12 @@ class NotificationSection extends MessageList.MessageListSection {
 
         this._nUrgent = 0;
 
+        // Notifications listed below the messages, without messages yet
+        this._pendingNotifications = [];
+        this._maxMessages = NOTIFICATION_MESSAGE_BATCH;
+
+        this._list.connect('child-removed', () => this._fillMessages());
+
         Main.messageTray.connect('source-added', this._sourceAdded.bind(this));
         Main.messageTray.getSources().forEach(source => {
             this._sourceAdded(Main.messageTray, source);
@@ -871,18 +891,24 @@ class NotificationSection extends MessageList.MessageListSection {
     }
 
     _onNotificationAdded(source, notification) {
-        let message = new NotificationMessage(notification);
-
         let isUrgent = notification.urgency === MessageTray.Urgency.CRITICAL;
 
         notification.connectObject(
             'destroy', () => {
                 if (isUrgent)
                     this._nUrgent--;
+                this._removePendingNotification(notification);
             },
             'notify::datetime', () => {
                 // The datetime property changes whenever the notification is updated
-                this.moveMessage(message, isUrgent ? 0 : this._nUrgent, this.mapped);
+                const index = isUrgent ? 0 : this._nUrgent;
+                const message = this._messages.find(m => m.notification === notification);
+                if (message) {
+                    this.moveMessage(message, index, this.mapped);
+                } else {
+                    this._removePendingNotification(notification);
+                    this._addNotificationMessage(notification, index, this.mapped);
+                }
             }, this);
 
         if (isUrgent) {
@@ -895,15 +921,81 @@ class NotificationSection extends MessageList.MessageListSection {
             notification.acknowledged = true;
         }
 
+        // Don't make messages disappear at the bottom while the list is shown
+        if (this.mapped)
+            this._maxMessages++;
+
         let index = isUrgent ? 0 : this._nUrgent;
-        this.addMessageAtIndex(message, index, this.mapped);
+        this._addNotificationMessage(notification, index, this.mapped);
+    }
+
+    _addNotificationMessage(notification, index, animate) {
+        this.addMessageAtIndex(new NotificationMessage(notification), index, animate);
+        this._trimMessages();
+    }
+
+    _removePendingNotification(notification) {
+        const index = this._pendingNotifications.indexOf(notification);
+        if (index !== -1)
+            this._pendingNotifications.splice(index, 1);
+    }
+
+    // Hands the notifications of the messages beyond the maximum back to
+    // the pending ones; urgent notifications always keep their messages
+    _trimMessages() {
+        const messages = this._messages.filter(m => m.notification);
+
+        for (let i = messages.length - 1; i >= this._maxMessages; i--) {
+            const {notification} = messages[i];
+            if (notification.urgency === MessageTray.Urgency.CRITICAL)
+                break;
+
+            this._pendingNotifications.unshift(notification);
+            messages[i].destroy();
+        }
+    }
+
+    _fillMessages() {
+        let nMessages = this._messages.filter(m => m.notification).length;
+
+        while (nMessages < this._maxMessages && this._pendingNotifications.length > 0) {
+            const notification = this._pendingNotifications.shift();
+            this.addMessage(new NotificationMessage(notification), false);
+            nMessages++;
+        }
+    }
+
+    /**
+     * Adds messages for more of the notifications below the list
+     */
+    showMoreMessages() {
+        if (this._pendingNotifications.length === 0)
+            return;
+
+        this._maxMessages += NOTIFICATION_MESSAGE_BATCH;
+        this._fillMessages();
+    }
+
+    clear() {
+        const pending = this._pendingNotifications;
+        this._pendingNotifications = [];
+        pending.forEach(n => n.destroy(MessageTray.NotificationDestroyedReason.DISMISSED));
+
+        super.clear();
     }
 
     vfunc_map() {
+        // Start over with the first batch of messages when the list is shown
+        this._maxMessages = NOTIFICATION_MESSAGE_BATCH;
+        this._trimMessages();
+
         this._messages.forEach(message => {
             if (message.notification.urgency !== MessageTray.Urgency.CRITICAL)
                 message.notification.acknowledged = true;
         });
+        this._pendingNotifications.forEach(notification => {
+            notification.acknowledged = true;
+        });
         super.vfunc_map();
     }
 });
@@ -1021,6 +1113,13 @@ class CalendarMessageList extends St.Widget {
             this);
         this._scrollView.child = this._sectionList;
 
+        const {vadjustment} = this._scrollView;
+        vadjustment.connect('notify::value', () => {
+            // Have the next notifications ready a page before the end
+            if (vadjustment.value + 2 * vadjustment.page_size >= vadjustment.upper)
+                this._notificationSection.showMoreMessages();
+        });
+
         this._mediaSection = new Mpris.MediaSection();
         this._addSection(this._mediaSection);
 
@@ -30,7 +30,7 @@ const DELAYED_RESET_TIMEOUT = 200;
 const AuthenticationDialog = GObject.registerClass({
     Signals: {'done': {param_types: [GObject.TYPE_BOOLEAN]}},
 }, class AuthenticationDialog extends ModalDialog.ModalDialog {
-    _init(actionId, description, cookie, userNames) {
+    _init(actionId, description, cookie, userNames, batchedCookies = []) {
         super._init({styleClass: 'prompt-dialog'});
 
         this.actionId = actionId;
@@ -169,6 +169,13 @@ const AuthenticationDialog = GObject.registerClass({
         this._identityToAuth = Polkit.UnixUser.new_for_name(userName);
         this._cookie = cookie;
 
+        // Requests for the same action from the same caller and subject
+        // are authenticated for by replaying the responses given for
+        // this one, rather than with a dialog each
+        this._batchedCookies = batchedCookies;
+        this._responses = [];
+        this.authenticatedCookies = [];
+
         this._user.connectObject(
             'notify::is-loaded', this._onUserChanged.bind(this),
             'changed', this._onUserChanged.bind(this), this);
@@ -188,6 +195,44 @@ const AuthenticationDialog = GObject.registerClass({
             'show-error', this._onSessionShowError.bind(this),
             'show-info', this._onSessionShowInfo.bind(this), this);
         this._session.initiate();
+
+        this._responses = [];
+    }
+
+    _authenticateBatched(cookie) {
+        return new Promise(resolve => {
+            let responses = [...this._responses];
+            let session = new PolkitAgent.Session({
+                identity: this._identityToAuth,
+                cookie,
+            });
+            session.connect('request', () => {
+                // Asked for something the user wasn't asked for, like a
+                // one-time code; the request will get its own dialog
+                if (responses.length === 0)
+                    session.cancel();
+                else
+                    session.response(responses.shift());
+            });
+            session.connect('completed', (_session, gainedAuthorization) => {
+                resolve(gainedAuthorization);
+            });
+            session.initiate();
+        });
+    }
+
+    async _completeBatch() {
+        for (const cookie of this._batchedCookies) {
+            if (this._doneEmitted)
+                break;
+
+            // eslint-disable-next-line no-await-in-loop
+            if (await this._authenticateBatched(cookie))
+                this.authenticatedCookies.push(cookie);
+        }
+
+        this._responses = [];
+        this._emitDone(false);
     }
 
     _ensureOpen() {
@@ -228,6 +273,7 @@ const AuthenticationDialog = GObject.registerClass({
         this._okButton.reactive = false;
 
         this._session.response(response);
+        this._responses.push(response);
         // When the user responds, dismiss already shown info and
         // error texts (if any)
         this._errorMessageLabel.hide();
@@ -250,7 +296,7 @@ const AuthenticationDialog = GObject.registerClass({
 
         /* Yay, all done */
         if (gainedAuthorization) {
-            this._emitDone(false);
+            this._completeBatch().catch(logError);
         } else {
             /* Unless we are showing an existing error message from the PAM
              * module (the PAM module could be reporting the authentication
@@ -409,6 +455,11 @@ const AuthenticationDialog = GObject.registerClass({
         this._user?.disconnectObject(this);
         this._user = null;
 
+        // The request is completed by now, a batch that is still being
+        // authenticated for mustn't report on it anymore
+        this._doneEmitted = true;
+        this._responses = [];
+
         this._destroySession();
     }
 });
@@ -451,7 +502,8 @@ class AuthenticationAgent extends Shell.PolkitAuthenticationAgent {
             return;
         }
 
-        this._currentDialog = new AuthenticationDialog(actionId, message, cookie, userNames);
+        this._currentDialog = new AuthenticationDialog(actionId, message,
+            cookie, userNames, this.get_batched_cookies());
         this._currentDialog.connect('done', this._onDialogDone.bind(this));
     }
 
@@ -464,11 +516,15 @@ class AuthenticationAgent extends Shell.PolkitAuthenticationAgent {
     }
 
     _completeRequest(dismissed) {
+        const {authenticatedCookies} = this._currentDialog;
+
         this._currentDialog.close();
         this._currentDialog = null;
 
         Main.sessionMode.disconnectObject(this);
 
+        for (const cookie of authenticatedCookies)
+            this.complete_batched(cookie);
         this.complete(dismissed);
     }
 });
@@ -212,6 +212,7 @@ class ShowAppsIcon extends DashItemContainer {
 
         this.toggleButton.child = this.icon;
         this.toggleButton._delegate = this;
+        DND.addDropTarget(this.toggleButton);
 
         this.setChild(this.toggleButton);
         this.setDragApp(null);
@@ -352,6 +353,7 @@ export const Dash = GObject.registerClass({
             y_expand: true,
         });
         this._box._delegate = this;
+        DND.addDropTarget(this._box);
 
         this._dashContainer.add_child(this._box);
 
@@ -15,11 +15,13 @@ import * as PanelMenu from './panelMenu.js';
 import * as Calendar from './calendar.js';
 import * as Weather from '../misc/weather.js';
 
-import {formatDateWithCFormatString, formatTime, clearCachedLocalTimeZone} from '../misc/dateUtils.js';
+import {
+    formatDateWithCFormatString, formatTime, clearCachedLocalTimeZone, translateTimeString,
+} from '../misc/dateUtils.js';
 import {loadInterfaceXML} from '../misc/fileUtils.js';
 
 const NC_ = (context, str) => `${context}\u0004${str}`;
-const T_ = Shell.util_translate_time_string;
+const T_ = translateTimeString;
 
 const MAX_FORECASTS = 5;
 const EN_CHAR = '\u2013';
@@ -98,14 +100,14 @@ class TodayButton extends St.Button {
          * "Tue 9:29 AM").  The string itself should become a full date, e.g.,
          * "February 17 2015".
          */
-        const dateFormat = Shell.util_translate_time_string(N_('%B %-d %Y'));
+        const dateFormat = T_(N_('%B %-d %Y'));
         this._dateLabel.set_text(formatDateWithCFormatString(date, dateFormat));
 
         /* Translators: This is the accessible name of the date button shown
          * below the time in the shell; it should combine the weekday and the
          * date, e.g. "Tuesday February 17 2015".
          */
-        const dateAccessibleNameFormat = Shell.util_translate_time_string(N_('%A %B %e %Y'));
+        const dateAccessibleNameFormat = T_(N_('%A %B %e %Y'));
         this.accessible_name = formatDateWithCFormatString(date, dateAccessibleNameFormat);
     }
 });
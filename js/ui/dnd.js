@@ -47,6 +47,7 @@ export const dragMonitors = [];
 
 let eventHandlerActor = null;
 let currentDraggable = null;
+let dropTargets = null;
 
 function _getEventHandlerActor() {
     if (!eventHandlerActor) {
@@ -94,6 +95,30 @@ export function removeDragMonitor(monitor) {
     }
 }
 
+function _getDropTargets() {
+    if (!dropTargets)
+        dropTargets = new Shell.DropTargetIndex();
+    return dropTargets;
+}
+
+/**
+ * Registers a drop target that is looked up by its extents rather than
+ * by picking the stage during drags. Only actors that nothing else is
+ * stacked on during drags should be registered.
+ *
+ * @param {Clutter.Actor} actor - the actor, with a delegate handling drops
+ */
+export function addDropTarget(actor) {
+    _getDropTargets().add(actor);
+}
+
+/**
+ * @param {Clutter.Actor} actor - the actor of a registered drop target
+ */
+export function removeDropTarget(actor) {
+    _getDropTargets().remove(actor);
+}
+
 class _Draggable extends Signals.EventEmitter {
     constructor(actor, params) {
         super();
@@ -373,6 +398,7 @@ class _Draggable extends Signals.EventEmitter {
         }
 
         currentDraggable = this;
+        _getDropTargets().invalidate();
         this._dragState = DragState.DRAGGING;
 
         // Special-case St.Button: the pointer grab messes with the internal
@@ -569,9 +595,10 @@ class _Draggable extends Signals.EventEmitter {
         return Clutter.EVENT_STOP;
     }
 
-    _pickTargetActor() {
-        return this._dragActor.get_stage().get_actor_at_pos(
-            Clutter.PickMode.ALL, this._dragX, this._dragY);
+    _pickTargetActor(x = this._dragX, y = this._dragY) {
+        return _getDropTargets().lookup(x, y) ??
+            this._dragActor.get_stage().get_actor_at_pos(
+                Clutter.PickMode.ALL, x, y);
     }
 
     _updateDragHover() {
@@ -656,8 +683,7 @@ class _Draggable extends Signals.EventEmitter {
 
     _dragActorDropped(event) {
         let [dropX, dropY] = event.get_coords();
-        let target = this._dragActor.get_stage().get_actor_at_pos(
-            Clutter.PickMode.ALL, dropX, dropY);
+        let target = this._pickTargetActor(dropX, dropY);
 
         // We call observers only once per motion with the innermost
         // target actor. If necessary, the observer can walk the
@@ -36,10 +36,18 @@ export class ExtensionManager extends Signals.EventEmitter {
         this._updatedUUIDS = [];
 
         this._extensions = new Map();
+        this._extensionImports = new Map();
         this._unloadedExtensions = new Map();
         this._enabledExtensions = [];
         this._extensionOrder = [];
         this._checkVersion = false;
+        this._enabledExtensionsChangedId = 0;
+
+        const perfLog = Shell.PerfLog.get_default();
+        perfLog.define_event('extensions.callStart',
+            'Start of a call into an extension', 's');
+        perfLog.define_event('extensions.callDone',
+            'End of a call into an extension', 's');
 
         St.Settings.get().connect('notify::color-scheme',
             () => this._reloadExtensionStylesheets());
@@ -166,6 +174,27 @@ export class ExtensionManager extends Signals.EventEmitter {
         this.emit('extension-state-changed', extension);
     }
 
+    /**
+     * Calls into an extension, marking the call in the performance log and
+     * adding the time it blocked the main loop to the extension's busyTime
+     *
+     * @param {object} extension - the extension
+     * @param {Function} func - the function calling into the extension
+     * @returns {*} the return value of func
+     */
+    _callIntoExtension(extension, func) {
+        const perfLog = Shell.PerfLog.get_default();
+        const start = GLib.get_monotonic_time();
+
+        perfLog.event_s('extensions.callStart', extension.uuid);
+        try {
+            return func();
+        } finally {
+            perfLog.event_s('extensions.callDone', extension.uuid);
+            extension.busyTime += (GLib.get_monotonic_time() - start) / 1000;
+        }
+    }
+
     _extensionSupportsSessionMode(uuid) {
         const extension = this.lookup(uuid);
 
@@ -207,14 +236,15 @@ export class ExtensionManager extends Signals.EventEmitter {
             let otherUuid = orderReversed[i];
             try {
                 console.debug(`Temporarily disable extension ${otherUuid}`);
-                this.lookup(otherUuid).stateObj.disable();
+                const other = this.lookup(otherUuid);
+                this._callIntoExtension(other, () => other.stateObj.disable());
             } catch (e) {
                 this.logExtensionError(otherUuid, e);
             }
         }
 
         try {
-            extension.stateObj.disable();
+            this._callIntoExtension(extension, () => extension.stateObj.disable());
         } catch (e) {
             this.logExtensionError(uuid, e);
         }
@@ -225,8 +255,9 @@ export class ExtensionManager extends Signals.EventEmitter {
             let otherUuid = order[i];
             try {
                 console.debug(`Re-enable extension ${otherUuid}`);
+                const other = this.lookup(otherUuid);
                 // eslint-disable-next-line no-await-in-loop
-                await this.lookup(otherUuid).stateObj.enable();
+                await this._callIntoExtension(other, () => other.stateObj.enable());
             } catch (e) {
                 this.logExtensionError(otherUuid, e);
             }
@@ -263,7 +294,7 @@ export class ExtensionManager extends Signals.EventEmitter {
         }
 
         try {
-            await extension.stateObj.enable();
+            await this._callIntoExtension(extension, () => extension.stateObj.enable());
             this._changeExtensionState(extension, ExtensionState.ACTIVE);
             this._extensionOrder.push(uuid);
         } catch (e) {
@@ -273,43 +304,61 @@ export class ExtensionManager extends Signals.EventEmitter {
     }
 
     enableExtension(uuid) {
-        if (!this._extensions.has(uuid))
-            return false;
-
-        let enabledExtensions = global.settings.get_strv(ENABLED_EXTENSIONS_KEY);
-        let disabledExtensions = global.settings.get_strv(DISABLED_EXTENSIONS_KEY);
+        const [success] = this.enableExtensions([uuid]);
+        return success;
+    }
 
-        if (disabledExtensions.includes(uuid)) {
-            disabledExtensions = disabledExtensions.filter(item => item !== uuid);
-            global.settings.set_strv(DISABLED_EXTENSIONS_KEY, disabledExtensions);
-        }
+    disableExtension(uuid) {
+        const [success] = this.disableExtensions([uuid]);
+        return success;
+    }
 
-        if (!enabledExtensions.includes(uuid)) {
-            enabledExtensions.push(uuid);
-            global.settings.set_strv(ENABLED_EXTENSIONS_KEY, enabledExtensions);
-        }
+    /**
+     * Enables several extensions with a single settings write, so that
+     * they are all enabled by the same re-evaluation
+     *
+     * @param {string[]} uuids - the UUIDs of the extensions
+     * @returns {boolean[]} whether each of the extensions exists
+     */
+    enableExtensions(uuids) {
+        return this._setExtensionsEnabled(uuids, true);
+    }
 
-        return true;
+    /**
+     * Disables several extensions with a single settings write
+     *
+     * @param {string[]} uuids - the UUIDs of the extensions
+     * @returns {boolean[]} whether each of the extensions exists
+     */
+    disableExtensions(uuids) {
+        return this._setExtensionsEnabled(uuids, false);
     }
 
-    disableExtension(uuid) {
-        if (!this._extensions.has(uuid))
-            return false;
+    _setExtensionsEnabled(uuids, enable) {
+        const results = uuids.map(uuid => this._extensions.has(uuid));
+        const changed = uuids.filter((uuid, i) => results[i]);
 
-        let enabledExtensions = global.settings.get_strv(ENABLED_EXTENSIONS_KEY);
-        let disabledExtensions = global.settings.get_strv(DISABLED_EXTENSIONS_KEY);
+        if (changed.length === 0)
+            return results;
 
-        if (enabledExtensions.includes(uuid)) {
-            enabledExtensions = enabledExtensions.filter(item => item !== uuid);
-            global.settings.set_strv(ENABLED_EXTENSIONS_KEY, enabledExtensions);
-        }
+        const [addKey, removeKey] = enable
+            ? [ENABLED_EXTENSIONS_KEY, DISABLED_EXTENSIONS_KEY]
+            : [DISABLED_EXTENSIONS_KEY, ENABLED_EXTENSIONS_KEY];
 
-        if (!disabledExtensions.includes(uuid)) {
-            disabledExtensions.push(uuid);
-            global.settings.set_strv(DISABLED_EXTENSIONS_KEY, disabledExtensions);
-        }
+        const added = global.settings.get_strv(addKey);
+        const removed = global.settings.get_strv(removeKey);
+        const newAdded = [...new Set([...added, ...changed])];
+        const newRemoved = removed.filter(uuid => !changed.includes(uuid));
 
-        return true;
+        // Both keys go out in one write
+        global.settings.delay();
+        if (newRemoved.length !== removed.length)
+            global.settings.set_strv(removeKey, newRemoved);
+        if (newAdded.length !== added.length)
+            global.settings.set_strv(addKey, newAdded);
+        global.settings.apply();
+
+        return results;
     }
 
     openExtensionPrefs(uuid, parentWindow, options) {
@@ -436,6 +485,7 @@ export class ExtensionManager extends Signals.EventEmitter {
             enabled: this._enabledExtensions.includes(uuid),
             hasUpdate: false,
             canChange: false,
+            busyTime: 0,
             sessionModes: meta['session-modes'] ? meta['session-modes'] : ['user'],
         };
         this._extensions.set(uuid, extension);
@@ -545,7 +595,7 @@ export class ExtensionManager extends Signals.EventEmitter {
         let extensionState = null;
 
         try {
-            extensionModule = await import(extensionJs.get_uri());
+            extensionModule = await this._importExtension(extension, extensionJs);
 
             // Extensions can only be imported once, so add a property to avoid
             // attempting to re-import an extension.
@@ -557,8 +607,8 @@ export class ExtensionManager extends Signals.EventEmitter {
 
         try {
             const {metadata, path} = extension;
-            extensionState =
-                new extensionModule.default({...metadata, dir, path});
+            extensionState = this._callIntoExtension(extension,
+                () => new extensionModule.default({...metadata, dir, path}));
         } catch (e) {
             this.logExtensionError(uuid, e);
             return false;
@@ -569,6 +619,48 @@ export class ExtensionManager extends Signals.EventEmitter {
         return true;
     }
 
+    _importExtension(extension, extensionJs) {
+        const promise = this._extensionImports.get(extension.uuid);
+        if (promise) {
+            this._extensionImports.delete(extension.uuid);
+            return promise;
+        }
+
+        return import(extensionJs.get_uri());
+    }
+
+    /**
+     * Starts importing the modules of the extensions that are going to be
+     * initialized, so that they are fetched and compiled concurrently;
+     * initializing and enabling them still happens one by one, in order
+     *
+     * @param {object[]} extensions - the extensions about to be loaded
+     */
+    _prefetchExtensionImports(extensions) {
+        for (const extension of extensions) {
+            const {uuid} = extension;
+
+            if (!this._enabledExtensions.includes(uuid) ||
+                !this._extensionSupportsSessionMode(uuid))
+                continue;
+
+            if (this._checkVersion && this._isOutOfDate(extension))
+                continue;
+
+            if (!this._canLoad(extension))
+                continue;
+
+            const extensionJs = extension.dir.get_child('extension.js');
+            if (!extensionJs.query_exists(null))
+                continue;
+
+            const promise = import(extensionJs.get_uri());
+            // Errors are reported when the extension is initialized
+            promise.catch(() => {});
+            this._extensionImports.set(uuid, promise);
+        }
+    }
+
     _getModeExtensions() {
         if (Array.isArray(Main.sessionMode.enabledExtensions))
             return Main.sessionMode.enabledExtensions;
@@ -606,6 +698,19 @@ export class ExtensionManager extends Signals.EventEmitter {
         this._onSettingsWritableChanged();
     }
 
+    // Changes to both keys, as by enableExtensions(), arrive as separate
+    // signals; re-evaluate once for all of them
+    _queueEnabledExtensionsChanged() {
+        if (this._enabledExtensionsChangedId)
+            return;
+
+        this._enabledExtensionsChangedId = GLib.idle_add(GLib.PRIORITY_DEFAULT, () => {
+            this._enabledExtensionsChangedId = 0;
+            this._onEnabledExtensionsChanged();
+            return GLib.SOURCE_REMOVE;
+        });
+    }
+
     async _onEnabledExtensionsChanged() {
         let newEnabledExtensions = this._getEnabledExtensions();
 
@@ -728,10 +833,10 @@ export class ExtensionManager extends Signals.EventEmitter {
 
     async _loadExtensions() {
         global.settings.connect(`changed::${ENABLED_EXTENSIONS_KEY}`, () => {
-            this._onEnabledExtensionsChanged();
+            this._queueEnabledExtensionsChanged();
         });
         global.settings.connect(`changed::${DISABLED_EXTENSIONS_KEY}`, () => {
-            this._onEnabledExtensionsChanged();
+            this._queueEnabledExtensionsChanged();
         });
         global.settings.connect(`changed::${DISABLE_USER_EXTENSIONS_KEY}`, () => {
             this._onUserExtensionsEnabledChanged();
@@ -781,10 +886,14 @@ export class ExtensionManager extends Signals.EventEmitter {
         // update extensions before loading them
         await this._handleMajorUpdate();
 
+        this._prefetchExtensionImports(extensionObjects);
+
         for (const extension of extensionObjects) {
             // eslint-disable-next-line no-await-in-loop
             await this.loadExtension(extension);
         }
+
+        this._extensionImports.clear();
     }
 
     async _enableAllExtensions() {
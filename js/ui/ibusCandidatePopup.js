@@ -34,26 +34,9 @@ const CandidateArea = GObject.registerClass({
             reactive: true,
             visible: false,
         });
+        // Rows are created up to the largest page size seen and then
+        // updated in place, as the lookup table changes on most keystrokes
         this._candidateBoxes = [];
-        for (let i = 0; i < MAX_CANDIDATES_PER_PAGE; ++i) {
-            const box = new St.BoxLayout({
-                style_class: 'candidate-box',
-                reactive: true,
-                track_hover: true,
-            });
-            box._indexLabel = new St.Label({style_class: 'candidate-index'});
-            box._candidateLabel = new St.Label({style_class: 'candidate-label'});
-            box.add_child(box._indexLabel);
-            box.add_child(box._candidateLabel);
-            this._candidateBoxes.push(box);
-            this.add_child(box);
-
-            let j = i;
-            box.connect('button-release-event', (actor, event) => {
-                this.emit('candidate-clicked', j, event.get_button(), event.get_state());
-                return Clutter.EVENT_PROPAGATE;
-            });
-        }
 
         this._buttonBox = new St.BoxLayout({style_class: 'candidate-page-button-box'});
 
@@ -80,6 +63,28 @@ const CandidateArea = GObject.registerClass({
 
         this._orientation = -1;
         this._cursorPosition = 0;
+        this._cursorVisible = false;
+    }
+
+    _ensureCandidateBoxes(nBoxes) {
+        for (let i = this._candidateBoxes.length; i < nBoxes; ++i) {
+            const box = new St.BoxLayout({
+                style_class: 'candidate-box',
+                reactive: true,
+                track_hover: true,
+            });
+            box._indexLabel = new St.Label({style_class: 'candidate-index'});
+            box._candidateLabel = new St.Label({style_class: 'candidate-label'});
+            box.add_child(box._indexLabel);
+            box.add_child(box._candidateLabel);
+            this._candidateBoxes.push(box);
+            this.insert_child_below(box, this._buttonBox);
+
+            box.connect('button-release-event', (actor, event) => {
+                this.emit('candidate-clicked', i, event.get_button(), event.get_state());
+                return Clutter.EVENT_PROPAGATE;
+            });
+        }
     }
 
     vfunc_scroll_event(event) {
@@ -116,22 +121,34 @@ const CandidateArea = GObject.registerClass({
     }
 
     setCandidates(indexes, candidates, cursorPosition, cursorVisible) {
-        for (let i = 0; i < MAX_CANDIDATES_PER_PAGE; ++i) {
-            let visible = i < candidates.length;
+        const nCandidates = Math.min(candidates.length, MAX_CANDIDATES_PER_PAGE);
+        this._ensureCandidateBoxes(nCandidates);
+
+        for (let i = 0; i < this._candidateBoxes.length; ++i) {
+            let visible = i < nCandidates;
             let box = this._candidateBoxes[i];
             box.visible = visible;
 
             if (!visible)
                 continue;
 
-            box._indexLabel.text = indexes && indexes[i] ? indexes[i] : DEFAULT_INDEX_LABELS[i];
-            box._candidateLabel.text = candidates[i];
+            // Setting a label's text relayouts it even when it is the same
+            const indexText = indexes && indexes[i] ? indexes[i] : DEFAULT_INDEX_LABELS[i];
+            if (box._indexLabel.text !== indexText)
+                box._indexLabel.text = indexText;
+            if (box._candidateLabel.text !== candidates[i])
+                box._candidateLabel.text = candidates[i];
         }
 
-        this._candidateBoxes[this._cursorPosition].remove_style_pseudo_class('selected');
+        if (this._cursorPosition === cursorPosition &&
+            this._cursorVisible === cursorVisible)
+            return;
+
+        this._candidateBoxes[this._cursorPosition]?.remove_style_pseudo_class('selected');
         this._cursorPosition = cursorPosition;
+        this._cursorVisible = cursorVisible;
         if (cursorVisible)
-            this._candidateBoxes[cursorPosition].add_style_pseudo_class('selected');
+            this._candidateBoxes[cursorPosition]?.add_style_pseudo_class('selected');
     }
 
     updateButtons(wrapsAround, page, nPages) {
@@ -282,11 +299,12 @@ class IbusCandidatePopup extends BoxPointer.BoxPointer {
                 });
             }
 
+            // Before updating the candidates, so new rows get styled once
+            this._candidateArea.setOrientation(lookupTable.get_orientation());
             this._candidateArea.setCandidates(indexes,
                 candidates,
                 cursorPos % pageSize,
                 lookupTable.is_cursor_visible());
-            this._candidateArea.setOrientation(lookupTable.get_orientation());
             this._candidateArea.updateButtons(lookupTable.is_round(), page, nPages);
         });
         panelService.connect('show-lookup-table', () => {
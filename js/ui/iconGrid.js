@@ -103,6 +103,8 @@ class BaseIcon extends Shell.SquareBin {
         this._setSizeManually = params.setSizeManually;
 
         this.icon = null;
+        this._loadPriority = St.TextureCachePriority.VISIBLE;
+        this._textureReleased = false;
 
         let cache = St.TextureCache.get_default();
         cache.connectObject(
@@ -126,14 +128,74 @@ class BaseIcon extends Shell.SquareBin {
     }
 
     _createIconTexture(size) {
+        // Released icons stay released, only taking up the new size
+        if (this._textureReleased) {
+            if (size !== this.iconSize) {
+                this.iconSize = size;
+                this._setPlaceholderSize(size);
+            }
+            return;
+        }
+
         if (this.icon)
             this.icon.destroy();
         this.iconSize = size;
         this.icon = this.createIcon(this.iconSize);
+        if (this.icon instanceof St.Icon)
+            this.icon.set_load_priority(this._loadPriority);
 
         this._iconBin.child = this.icon;
     }
 
+    /**
+     * Sets how urgently the icon texture is loaded.
+     *
+     * @param {St.TextureCachePriority} priority - the load priority
+     */
+    setLoadPriority(priority) {
+        this._loadPriority = priority;
+
+        if (this.icon instanceof St.Icon)
+            this.icon.set_load_priority(priority);
+    }
+
+    _setPlaceholderSize(size) {
+        const {scaleFactor} = St.ThemeContext.get_for_stage(global.stage);
+        this._iconBin.set_size(size * scaleFactor, size * scaleFactor);
+    }
+
+    /**
+     * Drops the icon texture to save memory, until restoreTexture() is
+     * called. The icon keeps taking up the same space in the meantime.
+     *
+     * Icons that have no texture yet don't create one until restored.
+     */
+    releaseTexture() {
+        if (this._textureReleased)
+            return;
+
+        if (this.icon) {
+            const [width, height] = this._iconBin.get_size();
+            this._iconBin.set_size(width, height);
+
+            this.icon.destroy();
+            this.icon = null;
+        } else {
+            this._setPlaceholderSize(this.iconSize);
+        }
+
+        this._textureReleased = true;
+    }
+
+    restoreTexture() {
+        if (!this._textureReleased)
+            return;
+
+        this._textureReleased = false;
+        this._iconBin.set_size(-1, -1);
+        this._createIconTexture(this.iconSize);
+    }
+
     vfunc_style_changed() {
         super.vfunc_style_changed();
         let node = this.get_theme_node();
@@ -149,7 +211,11 @@ class BaseIcon extends Shell.SquareBin {
             size = found ? len / scaleFactor : ICON_SIZE;
         }
 
-        if (this.iconSize === size && this._iconBin.child)
+        // The scale factor may have changed
+        if (this._textureReleased && this.iconSize === size)
+            this._setPlaceholderSize(size);
+
+        if (this.iconSize === size && (this._iconBin.child || this._textureReleased))
             return;
 
         this._createIconTexture(size);
@@ -330,9 +396,13 @@ export const IconGridLayout = GObject.registerClass({
         this._pageWidth = 0;
         this._nPages = -1;
 
+        // Pages are only allocated again when their items changed, or
+        // when the geometry of all pages did
+        //
         // [
         //     {
         //         children: [ itemData, itemData, itemData, ... ],
+        //         dirty: <whether the page needs to be allocated>,
         //     },
         //     {
         //         children: [ itemData, itemData, itemData, ... ],
@@ -359,6 +429,7 @@ export const IconGridLayout = GObject.registerClass({
         this._updateIconSizesLaterId = 0;
 
         this._childrenMaxSize = -1;
+        this._allocatedGeometry = null;
     }
 
     _findBestIconSize() {
@@ -432,6 +503,7 @@ export const IconGridLayout = GObject.registerClass({
     _updateVisibleChildrenForPage(pageIndex) {
         this._pages[pageIndex].visibleChildren =
             this._pages[pageIndex].children.filter(actor => actor.visible);
+        this._pages[pageIndex].dirty = true;
     }
 
     _updatePages() {
@@ -462,6 +534,11 @@ export const IconGridLayout = GObject.registerClass({
         }
 
         this._pages.splice(pageIndex, 1);
+
+        // The pages after it moved
+        for (let i = pageIndex; i < this._pages.length; i++)
+            this._pages[i].dirty = true;
+
         this.emit('pages-changed');
     }
 
@@ -528,7 +605,7 @@ export const IconGridLayout = GObject.registerClass({
     }
 
     _appendPage() {
-        this._pages.push({children: []});
+        this._pages.push({children: [], dirty: true});
         this.emit('pages-changed');
     }
 
@@ -562,7 +639,10 @@ export const IconGridLayout = GObject.registerClass({
                     this._fillItemVacancies(itemData.pageIndex);
             }),
             queueRelayoutId: item.connect('queue-relayout', () => {
+                const itemData = this._items.get(item);
+
                 this._childrenMaxSize = -1;
+                this._pages[itemData.pageIndex].dirty = true;
             }),
         });
 
@@ -762,11 +842,33 @@ export const IconGridLayout = GObject.registerClass({
         const pageSizeChanged = this._pageSizeChanged;
         const lastRowAlign = this.lastRowAlign;
         const shouldEaseItems = this._shouldEaseItems;
+        const swapPages = isRtl && orientation === Clutter.Orientation.HORIZONTAL;
+
+        // Everything the position of every item depends on, besides the
+        // items of its page
+        const geometry = [
+            isRtl, orientation, pageWidth, pageHeight, childSize,
+            leftEmptySpace, topEmptySpace, hSpacing, vSpacing,
+            columnsPerPage, lastRowAlign,
+            swapPages ? this._pages.length : 0,
+        ].join();
+        const geometryChanged = geometry !== this._allocatedGeometry;
+        this._allocatedGeometry = geometry;
 
         this._pages.forEach((page, pageIndex) => {
-            if (isRtl && orientation === Clutter.Orientation.HORIZONTAL)
+            if (!page.dirty && !geometryChanged)
+                return;
+            page.dirty = false;
+
+            if (swapPages)
                 pageIndex = swap(pageIndex, this._pages.length);
 
+            // Only the last row can be padded
+            const nItems = page.visibleChildren.length;
+            const lastRow = Math.floor((nItems - 1) / columnsPerPage);
+            const lastRowPadding = this._getRowPadding(lastRowAlign,
+                page.visibleChildren, nItems - 1, childSize, hSpacing);
+
             page.visibleChildren.forEach((item, itemIndex) => {
                 const row = Math.floor(itemIndex / columnsPerPage);
                 let column = itemIndex % columnsPerPage;
@@ -774,8 +876,7 @@ export const IconGridLayout = GObject.registerClass({
                 if (isRtl)
                     column = swap(column, columnsPerPage);
 
-                const rowPadding = this._getRowPadding(lastRowAlign,
-                    page.visibleChildren, itemIndex, childSize, hSpacing);
+                const rowPadding = row === lastRow ? lastRowPadding : 0;
 
                 // Icon position
                 let x = leftEmptySpace + rowPadding + column * (childSize + hSpacing);
@@ -1180,8 +1281,10 @@ export const IconGrid = GObject.registerClass({
             row_spacing: 0,
         });
         const layoutManager = new IconGridLayout(layoutParams);
-        const pagesChangedId = layoutManager.connect('pages-changed',
-            () => this.emit('pages-changed'));
+        const pagesChangedId = layoutManager.connect('pages-changed', () => {
+            this._updateLoadPriorities();
+            this.emit('pages-changed');
+        });
 
         super._init({
             style_class: 'icon-grid',
@@ -1193,8 +1296,19 @@ export const IconGrid = GObject.registerClass({
         this._gridModes = defaultGridModes;
         this._currentPage = 0;
         this._currentMode = -1;
+        this._prefetchId = 0;
+
+        global.connectObject('memory-pressure',
+            () => this._releaseDistantTextures(), this);
 
-        this.connect('destroy', () => layoutManager.disconnect(pagesChangedId));
+        this.connect('destroy', () => {
+            layoutManager.disconnect(pagesChangedId);
+
+            if (this._prefetchId) {
+                GLib.source_remove(this._prefetchId);
+                this._prefetchId = 0;
+            }
+        });
     }
 
     vfunc_child_added(child) {
@@ -1203,6 +1317,71 @@ export const IconGrid = GObject.registerClass({
         });
     }
 
+    _getItemPageDistance(item) {
+        return Math.abs(this.getItemPage(item) - this._currentPage);
+    }
+
+    _updateItemLoadPriority(item) {
+        const distance = this._getItemPageDistance(item);
+
+        if (distance === 0) {
+            item.icon.restoreTexture();
+            item.icon.setLoadPriority(St.TextureCachePriority.VISIBLE);
+        } else if (distance === 1) {
+            // Raised once the page switch is done, see _prefetchAdjacentPages()
+            item.icon.setLoadPriority(St.TextureCachePriority.BACKGROUND);
+            this._queuePrefetch();
+        } else {
+            item.icon.setLoadPriority(St.TextureCachePriority.BACKGROUND);
+        }
+    }
+
+    // New icons only create their texture once they are on the current
+    // page or next to it, see _updateItemLoadPriority(), so that the
+    // icons of pages that are never visited are never loaded
+    _deferItemTexture(item) {
+        if (!item.icon.icon)
+            item.icon.releaseTexture();
+    }
+
+    _updateLoadPriorities() {
+        for (const item of this)
+            this._updateItemLoadPriority(item);
+    }
+
+    // Loading the icons of the next and previous page while switching
+    // pages would compete with the animation for the frame budget, so wait
+    // until the main loop has nothing more important to do.
+    _queuePrefetch() {
+        if (this._prefetchId)
+            return;
+
+        this._prefetchId = GLib.idle_add(GLib.PRIORITY_LOW, () => {
+            this._prefetchId = 0;
+            this._prefetchAdjacentPages();
+            return GLib.SOURCE_REMOVE;
+        });
+        GLib.Source.set_name_by_id(this._prefetchId,
+            '[gnome-shell] this._prefetchAdjacentPages');
+    }
+
+    _prefetchAdjacentPages() {
+        for (const item of this) {
+            if (this._getItemPageDistance(item) !== 1)
+                continue;
+
+            item.icon.restoreTexture();
+            item.icon.setLoadPriority(St.TextureCachePriority.PREFETCH);
+        }
+    }
+
+    _releaseDistantTextures() {
+        for (const item of this) {
+            if (this._getItemPageDistance(item) > 1)
+                item.icon.releaseTexture();
+        }
+    }
+
     _ensureItemIsVisible(item) {
         if (!this.contains(item))
             throw new Error(`${item} is not a child of IconGrid`);
@@ -1298,7 +1477,9 @@ export const IconGrid = GObject.registerClass({
         if (!(item.icon instanceof BaseIcon))
             throw new Error('Only items with a BaseIcon icon property can be added to IconGrid');
 
+        this._deferItemTexture(item);
         this.layout_manager.addItem(item, page, index);
+        this._updateItemLoadPriority(item);
     }
 
     /**
@@ -1309,7 +1490,9 @@ export const IconGrid = GObject.registerClass({
      * Appends `item` to the grid. `item` must not be part of the grid.
      */
     appendItem(item) {
+        this._deferItemTexture(item);
         this.layout_manager.appendItem(item);
+        this._updateItemLoadPriority(item);
     }
 
     /**
@@ -1323,6 +1506,7 @@ export const IconGrid = GObject.registerClass({
      */
     moveItem(item, newPage, newPosition) {
         this.layout_manager.moveItem(item, newPage, newPosition);
+        this._updateItemLoadPriority(item);
         this.queue_relayout();
     }
 
@@ -1367,6 +1551,7 @@ export const IconGrid = GObject.registerClass({
         }
 
         this._currentPage = pageIndex;
+        this._updateLoadPriorities();
 
         if (!this.mapped)
             animate = false;
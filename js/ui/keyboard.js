@@ -23,6 +23,10 @@ const KEYBOARD_ANIMATION_TIME = 150;
 const KEYBOARD_REST_TIME = KEYBOARD_ANIMATION_TIME * 2;
 const KEY_LONG_PRESS_TIME = 250;
 
+// How many layouts (input source and purpose) are kept built, hidden,
+// for switching back to
+const MAX_CACHED_LAYOUTS = 4;
+
 const A11Y_APPLICATIONS_SCHEMA = 'org.gnome.desktop.a11y.applications';
 const SHOW_KEYBOARD = 'screen-keyboard-enabled';
 const EMOJI_PAGE_SEPARATION = 32;
@@ -223,7 +227,8 @@ const Key = GObject.registerClass({
         'long-press': {},
         'pressed': {},
         'released': {},
-        'keyval': {param_types: [GObject.TYPE_UINT]},
+        'keyval-pressed': {param_types: [GObject.TYPE_UINT]},
+        'keyval-released': {param_types: [GObject.TYPE_UINT]},
         'commit': {param_types: [GObject.TYPE_STRING]},
     },
 }, class Key extends St.BoxLayout {
@@ -282,6 +287,11 @@ const Key = GObject.registerClass({
     }
 
     _press(button) {
+        // Keys sending a keyval have no extended keys, so the key press is
+        // sent right away, and the release when the key is released
+        if (this._keyval && button === this.keyButton && !this._pressed)
+            this.emit('keyval-pressed', this._keyval);
+
         if (button === this.keyButton) {
             this._pressTimeoutId = GLib.timeout_add(GLib.PRIORITY_DEFAULT,
                 KEY_LONG_PRESS_TIME,
@@ -314,7 +324,7 @@ const Key = GObject.registerClass({
 
         if (this._pressed) {
             if (this._keyval && button === this.keyButton)
-                this.emit('keyval', this._keyval);
+                this.emit('keyval-released', this._keyval);
             else if (commitString)
                 this.emit('commit', commitString);
             else
@@ -334,6 +344,12 @@ const Key = GObject.registerClass({
         this._touchPressSlot = null;
         this.keyButton.set_hover(false);
         this.keyButton.fake_release();
+
+        // Don't leave the key pressed
+        if (this._keyval && this._pressed) {
+            this._pressed = false;
+            this.emit('keyval-released', this._keyval);
+        }
     }
 
     _onCapturedEvent(actor, event) {
@@ -1199,6 +1215,10 @@ export const Keyboard = GObject.registerClass({
         this._modifiers = new Set();
         this._modifierKeys = new Map();
 
+        // Built layouts by input source and purpose, least recently used first
+        this._layouts = new Map();
+        this._prebuildLayoutId = 0;
+
         this._suggestions = null;
 
         this._focusTracker = new FocusTracker();
@@ -1260,6 +1280,11 @@ export const Keyboard = GObject.registerClass({
 
         this._clearShowIdle();
 
+        if (this._prebuildLayoutId) {
+            global.remove_idle_work(this._prebuildLayoutId);
+            this._prebuildLayoutId = 0;
+        }
+
         this._keyboardController.oskCompletion = false;
         this._keyboardController.destroy();
 
@@ -1399,6 +1424,73 @@ export const Keyboard = GObject.registerClass({
     }
 
     _updateLayout(groupName, purpose) {
+        const key = `${groupName}:${purpose}`;
+        let cached = this._layouts.get(key);
+
+        if (cached) {
+            // Moved to the end as the most recently used
+            this._layouts.delete(key);
+        } else {
+            cached = this._buildLayout(groupName, purpose);
+            if (!cached)
+                return;
+        }
+        this._layouts.set(key, cached);
+
+        this._currentLayout?.hide();
+        this._currentLayout = cached.layout;
+        this._currentLayout.show();
+        this._layers = cached.layers;
+
+        this._trimLayouts();
+        this._queuePrebuildLayout(groupName, Clutter.InputContentPurpose.NORMAL);
+    }
+
+    _trimLayouts() {
+        for (const [key, {layout}] of this._layouts) {
+            if (this._layouts.size <= MAX_CACHED_LAYOUTS)
+                break;
+
+            if (layout === this._currentLayout)
+                continue;
+
+            for (const keyval in this._modifierKeys) {
+                this._modifierKeys[keyval] =
+                    this._modifierKeys[keyval].filter(k => !layout.contains(k));
+            }
+
+            this._layouts.delete(key);
+            layout.destroy();
+        }
+    }
+
+    // Builds the layout fields are most likely to switch back to at
+    // leisure, so that switching is only a matter of showing it
+    _queuePrebuildLayout(groupName, purpose) {
+        if (this._prebuildLayoutId)
+            global.remove_idle_work(this._prebuildLayoutId);
+
+        this._prebuildLayoutId = global.add_idle_work(Shell.IdlePriority.LOW, 0, () => {
+            this._prebuildLayoutId = 0;
+
+            const key = `${groupName}:${purpose}`;
+            if (this._layouts.has(key))
+                return false;
+
+            const built = this._buildLayout(groupName, purpose);
+            if (!built)
+                return false;
+
+            built.layout.hide();
+
+            // Least recently used, so that it is the first to go
+            this._layouts = new Map([[key, built], ...this._layouts]);
+            this._trimLayouts();
+            return false;
+        });
+    }
+
+    _buildLayout(groupName, purpose) {
         let keyboardModel = null;
         let layers = {};
         let layout = new Clutter.Actor({
@@ -1436,7 +1528,7 @@ export const Keyboard = GObject.registerClass({
             }
 
             if (!keyboardModel)
-                return;
+                return null;
         }
 
         const emojiVisible = Meta.is_wayland_compositor() &&
@@ -1462,9 +1554,7 @@ export const Keyboard = GObject.registerClass({
         });
 
         this._aspectContainer.add_child(layout);
-        this._currentLayout?.destroy();
-        this._currentLayout = layout;
-        this._layers = layers;
+        return {layout, layers};
     }
 
     _addRowKeys(keys, layout, emojiVisible) {
@@ -1493,10 +1583,10 @@ export const Keyboard = GObject.registerClass({
             }, strings);
 
             if (key.keyval) {
-                button.connect('keyval', (_actor, keyval) => {
-                    this._keyboardController.keyvalPress(keyval);
-                    this._keyboardController.keyvalRelease(keyval);
-                });
+                button.connect('keyval-pressed',
+                    (_actor, keyval) => this._keyboardController.keyvalPress(keyval));
+                button.connect('keyval-released',
+                    (_actor, keyval) => this._keyboardController.keyvalRelease(keyval));
             }
 
             if (key.action !== 'modifier') {
@@ -183,6 +183,27 @@ class UiActor extends St.Widget {
     }
 });
 
+/**
+ * @param {Mtk.Rectangle[]} rects - some rectangles
+ * @param {Mtk.Rectangle[]} others - other rectangles
+ * @returns {boolean} whether both lists have the same rectangles
+ */
+function _rectsEqual(rects, others) {
+    return rects.length === others.length &&
+        rects.every((r, i) => r.equal(others[i]));
+}
+
+/**
+ * @param {Meta.Strut[]} struts - some struts
+ * @param {Meta.Strut[]} others - other struts
+ * @returns {boolean} whether both lists have the same struts
+ */
+function _strutsEqual(struts, others) {
+    return struts.length === others.length &&
+        struts.every((s, i) =>
+            s.side === others[i].side && s.rect.equal(others[i].rect));
+}
+
 const defaultParams = {
     trackFullscreen: false,
     affectsStruts: false,
@@ -212,6 +233,10 @@ export const LayoutManager = GObject.registerClass({
 
         this._inOverview = false;
         this._updateRegionIdle = 0;
+        this._regionsInvalid = true;
+        this._inputRegion = null;
+        this._struts = null;
+        this._nStrutWorkspaces = 0;
 
         this._trackedActors = [];
         this._topActors = [];
@@ -730,6 +755,7 @@ export const LayoutManager = GObject.registerClass({
         // get the correct allocation for the struts.
         // Do this even when we don't animate on restart, so that maximized
         // windows restore to the right size.
+        this._regionsInvalid = true;
         this._updateRegions();
 
         if (Meta.is_restart()) {
@@ -935,16 +961,18 @@ export const LayoutManager = GObject.registerClass({
 
         let actorData = Params.parse(params, defaultParams);
         actorData.actor = actor;
+        actorData.geometry = null;
+        actorData.geometryChanged = false;
         actor.connectObject(
-            'notify::visible', this._queueUpdateRegions.bind(this),
-            'notify::allocation', this._queueUpdateRegions.bind(this),
+            'notify::visible', () => this._queueUpdateActorRegions(actorData),
+            'notify::allocation', () => this._queueUpdateActorRegions(actorData),
             'destroy', this._untrackActor.bind(this), this);
         // Note that destroying actor will unset its parent, so we don't
         // need to connect to 'destroy' too.
 
         this._trackedActors.push(actorData);
         this._updateActorVisibility(actorData);
-        this._queueUpdateRegions();
+        this._queueUpdateActorRegions(actorData);
     }
 
     _untrackActor(actor) {
@@ -956,7 +984,7 @@ export const LayoutManager = GObject.registerClass({
         this._trackedActors.splice(i, 1);
         actor.disconnectObject(this);
 
-        this._queueUpdateRegions();
+        this._queueUpdateLater();
     }
 
     _updateActorVisibility(actorData) {
@@ -1003,6 +1031,18 @@ export const LayoutManager = GObject.registerClass({
     }
 
     _queueUpdateRegions() {
+        this._regionsInvalid = true;
+        this._queueUpdateLater();
+    }
+
+    _queueUpdateActorRegions(actorData) {
+        // Chrome moves a lot, for example while the panel or OSDs slide
+        // in, so only that actor and what it contains is measured again
+        actorData.geometryChanged = true;
+        this._queueUpdateLater();
+    }
+
+    _queueUpdateLater() {
         if (!this._updateRegionIdle) {
             const laters = global.compositor.get_laters();
             this._updateRegionIdle = laters.add(
@@ -1027,6 +1067,73 @@ export const LayoutManager = GObject.registerClass({
         }
     }
 
+    _getActorStrut(actorData, x, y, w, h) {
+        let monitor = this.findMonitorForActor(actorData.actor);
+        if (!monitor)
+            return null;
+
+        // Limit struts to the size of the screen
+        let x1 = Math.max(x, 0);
+        let x2 = Math.min(x + w, global.screen_width);
+        let y1 = Math.max(y, 0);
+        let y2 = Math.min(y + h, global.screen_height);
+
+        // Metacity wants to know what side of the monitor the
+        // strut is considered to be attached to. First, we find
+        // the monitor that contains the strut. If the actor is
+        // only touching one edge, or is touching the entire
+        // border of that monitor, then it's obvious which side
+        // to call it. If it's in a corner, we pick a side
+        // arbitrarily. If it doesn't touch any edges, or it
+        // spans the width/height across the middle of the
+        // screen, then we don't create a strut for it at all.
+
+        let side;
+        if (x1 <= monitor.x && x2 >= monitor.x + monitor.width) {
+            if (y1 <= monitor.y)
+                side = Meta.Side.TOP;
+            else if (y2 >= monitor.y + monitor.height)
+                side = Meta.Side.BOTTOM;
+            else
+                return null;
+        } else if (y1 <= monitor.y && y2 >= monitor.y + monitor.height) {
+            if (x1 <= monitor.x)
+                side = Meta.Side.LEFT;
+            else if (x2 >= monitor.x + monitor.width)
+                side = Meta.Side.RIGHT;
+            else
+                return null;
+        } else if (x1 <= monitor.x) {
+            side = Meta.Side.LEFT;
+        } else if (y1 <= monitor.y) {
+            side = Meta.Side.TOP;
+        } else if (x2 >= monitor.x + monitor.width) {
+            side = Meta.Side.RIGHT;
+        } else if (y2 >= monitor.y + monitor.height) {
+            side = Meta.Side.BOTTOM;
+        } else {
+            return null;
+        }
+
+        const strutRect = new Mtk.Rectangle({x: x1, y: y1, width: x2 - x1, height: y2 - y1});
+        return new Meta.Strut({rect: strutRect, side});
+    }
+
+    _updateActorGeometry(actorData) {
+        let [x, y] = actorData.actor.get_transformed_position();
+        let [w, h] = actorData.actor.get_transformed_size();
+        x = Math.round(x);
+        y = Math.round(y);
+        w = Math.round(w);
+        h = Math.round(h);
+
+        actorData.geometry = {
+            rect: new Mtk.Rectangle({x, y, width: w, height: h}),
+            strut: actorData.affectsStruts
+                ? this._getActorStrut(actorData, x, y, w, h) : null,
+        };
+    }
+
     _updateRegions() {
         if (this._updateRegionIdle) {
             const laters = global.compositor.get_laters();
@@ -1034,7 +1141,7 @@ export const LayoutManager = GObject.registerClass({
             delete this._updateRegionIdle;
         }
 
-        let rects = [], struts = [], i;
+        let rects = [], struts = [];
         let isPopupMenuVisible = global.top_window_group.get_children().some(isPopupMetaWindow);
         const wantsInputRegion =
             !this._startingUp &&
@@ -1042,92 +1149,67 @@ export const LayoutManager = GObject.registerClass({
             Main.modalCount === 0 &&
             !Meta.is_wayland_compositor();
 
-        for (i = 0; i < this._trackedActors.length; i++) {
-            let actorData = this._trackedActors[i];
-            if (!(actorData.affectsInputRegion && wantsInputRegion) && !actorData.affectsStruts)
+        // Moving an actor moves the tracked actors inside it as well
+        const changedActors = this._trackedActors
+            .filter(a => a.geometryChanged)
+            .map(a => a.actor);
+
+        for (const actorData of this._trackedActors) {
+            const changed = this._regionsInvalid ||
+                changedActors.some(a => a.contains(actorData.actor));
+            actorData.geometryChanged = false;
+
+            if (!(actorData.affectsInputRegion && wantsInputRegion) && !actorData.affectsStruts) {
+                if (changed)
+                    actorData.geometry = null;
                 continue;
+            }
+
+            if (changed || !actorData.geometry)
+                this._updateActorGeometry(actorData);
 
-            let [x, y] = actorData.actor.get_transformed_position();
-            let [w, h] = actorData.actor.get_transformed_size();
-            x = Math.round(x);
-            y = Math.round(y);
-            w = Math.round(w);
-            h = Math.round(h);
+            const {rect, strut} = actorData.geometry;
 
             if (actorData.affectsInputRegion && wantsInputRegion && actorData.actor.get_paint_visibility())
-                rects.push(new Mtk.Rectangle({x, y, width: w, height: h}));
-
-            let monitor = null;
-            if (actorData.affectsStruts)
-                monitor = this.findMonitorForActor(actorData.actor);
-
-            if (monitor) {
-                // Limit struts to the size of the screen
-                let x1 = Math.max(x, 0);
-                let x2 = Math.min(x + w, global.screen_width);
-                let y1 = Math.max(y, 0);
-                let y2 = Math.min(y + h, global.screen_height);
-
-                // Metacity wants to know what side of the monitor the
-                // strut is considered to be attached to. First, we find
-                // the monitor that contains the strut. If the actor is
-                // only touching one edge, or is touching the entire
-                // border of that monitor, then it's obvious which side
-                // to call it. If it's in a corner, we pick a side
-                // arbitrarily. If it doesn't touch any edges, or it
-                // spans the width/height across the middle of the
-                // screen, then we don't create a strut for it at all.
-
-                let side;
-                if (x1 <= monitor.x && x2 >= monitor.x + monitor.width) {
-                    if (y1 <= monitor.y)
-                        side = Meta.Side.TOP;
-                    else if (y2 >= monitor.y + monitor.height)
-                        side = Meta.Side.BOTTOM;
-                    else
-                        continue;
-                } else if (y1 <= monitor.y && y2 >= monitor.y + monitor.height) {
-                    if (x1 <= monitor.x)
-                        side = Meta.Side.LEFT;
-                    else if (x2 >= monitor.x + monitor.width)
-                        side = Meta.Side.RIGHT;
-                    else
-                        continue;
-                } else if (x1 <= monitor.x) {
-                    side = Meta.Side.LEFT;
-                } else if (y1 <= monitor.y) {
-                    side = Meta.Side.TOP;
-                } else if (x2 >= monitor.x + monitor.width) {
-                    side = Meta.Side.RIGHT;
-                } else if (y2 >= monitor.y + monitor.height) {
-                    side = Meta.Side.BOTTOM;
-                } else {
-                    continue;
-                }
+                rects.push(rect);
 
-                const strutRect = new Mtk.Rectangle({x: x1, y: y1, width: x2 - x1, height: y2 - y1});
-                let strut = new Meta.Strut({rect: strutRect, side});
+            if (strut)
                 struts.push(strut);
-            }
         }
-
-        if (wantsInputRegion)
+        this._regionsInvalid = false;
+
+        // Setting the input region goes through the X server, and setting
+        // struts makes mutter recompute the work areas and constrain
+        // windows to them, so skip both when nothing changed
+        if (!wantsInputRegion) {
+            this._inputRegion = null;
+        } else if (!this._inputRegion || !_rectsEqual(rects, this._inputRegion)) {
             global.set_stage_input_region(rects);
+            this._inputRegion = rects;
+        }
 
         this._isPopupWindowVisible = isPopupMenuVisible;
 
         let workspaceManager = global.workspace_manager;
+        if (this._struts && _strutsEqual(struts, this._struts) &&
+            this._nStrutWorkspaces === workspaceManager.n_workspaces)
+            return GLib.SOURCE_REMOVE;
+
         for (let w = 0; w < workspaceManager.n_workspaces; w++) {
             let workspace = workspaceManager.get_workspace_by_index(w);
             workspace.set_builtin_struts(struts);
         }
+        this._struts = struts;
+        this._nStrutWorkspaces = workspaceManager.n_workspaces;
 
         return GLib.SOURCE_REMOVE;
     }
 
     modalEnded() {
         // We don't update the stage input region while in a modal,
-        // so queue an update now.
+        // so queue an update now; the modal may have changed it
+        // behind our back, so set it again even if it's the same
+        this._inputRegion = null;
         this._queueUpdateRegions();
     }
 });
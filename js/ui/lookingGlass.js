@@ -35,6 +35,8 @@ const commandHeader = `
     const inspect = Main.lookingGlass.inspect.bind(Main.lookingGlass);
     const it = Main.lookingGlass.getIt();
     const r = Main.lookingGlass.getResult.bind(Main.lookingGlass);
+    const frames = Main.lookingGlass.getFrameStats.bind(Main.lookingGlass);
+    const monitorFrames = Main.lookingGlass.getMonitorFrameStats.bind(Main.lookingGlass);
     `;
 const AsyncFunction = async function () {}.constructor;
 
@@ -47,6 +49,10 @@ const AUTO_COMPLETE_GLOBAL_KEYWORDS = _getAutoCompleteGlobalKeywords();
 
 const LG_ANIMATION_TIME = 500;
 
+// Only that many of the latest results keep their objects alive; older
+// ones hold weak references, and fall back to their text once collected
+const MAX_LIVE_RESULTS = 10;
+
 const CLUTTER_DEBUG_FLAG_CATEGORIES = new Map([
     // Paint debugging can easily result in a non-responsive session
     ['DebugFlag', {argPos: 0, exclude: ['PAINT']}],
@@ -302,8 +308,25 @@ class ObjLink extends St.Button {
         this._lookingGlass = lookingGlass;
     }
 
+    release() {
+        if (this._obj instanceof WeakRef || this._obj !== Object(this._obj))
+            return;
+
+        this._obj = new WeakRef(this._obj);
+    }
+
     vfunc_clicked() {
-        this._lookingGlass.inspectObject(this._obj, this);
+        let obj = this._obj;
+
+        if (obj instanceof WeakRef) {
+            obj = obj.deref();
+            if (obj === undefined) {
+                this.reactive = false;
+                return;
+            }
+        }
+
+        this._lookingGlass.inspectObject(obj, this);
     }
 });
 
@@ -313,8 +336,9 @@ class Result extends St.BoxLayout {
         super._init({vertical: true});
 
         this.index = index;
-        this.o = o;
 
+        this._obj = o;
+        this._snapshot = '';
         this._lookingGlass = lookingGlass;
 
         let cmdTxt = new St.Label({text: command});
@@ -325,8 +349,28 @@ class Result extends St.BoxLayout {
         let resultTxt = new St.Label({text: `r(${index}) = `});
         resultTxt.clutter_text.ellipsize = Pango.EllipsizeMode.END;
         box.add_child(resultTxt);
-        let objLink = new ObjLink(this._lookingGlass, o);
-        box.add_child(objLink);
+        this._objLink = new ObjLink(this._lookingGlass, o);
+        box.add_child(this._objLink);
+    }
+
+    get o() {
+        if (!(this._obj instanceof WeakRef))
+            return this._obj;
+
+        return this._obj.deref() ?? this._snapshot;
+    }
+
+    /**
+     * Stops keeping the object of the result alive, leaving its
+     * text for when it is gone
+     */
+    release() {
+        if (this._obj instanceof WeakRef || this._obj !== Object(this._obj))
+            return;
+
+        this._snapshot = this._objLink.label;
+        this._obj = new WeakRef(this._obj);
+        this._objLink.release();
     }
 });
 
@@ -737,6 +781,23 @@ const Extensions = GObject.registerClass({
 
         Main.extensionManager.connect('extension-loaded',
             this._loadExtension.bind(this));
+        Main.extensionManager.connectObject('extension-state-changed',
+            (o, extension) => this._updateExtension(extension), this);
+    }
+
+    _updateExtension(extension) {
+        const display = [...this._extensionsList].find(
+            dsp => dsp._extension?.uuid === extension.uuid);
+        if (!display)
+            return;
+
+        display._extension = extension;
+        display._state.text = this._stateToString(extension.state);
+        display._busyTime.text = this._busyTimeToString(extension.busyTime);
+    }
+
+    _busyTimeToString(busyTime) {
+        return `${Math.round(busyTime ?? 0)} ms`;
     }
 
     _loadExtension(o, uuid) {
@@ -842,6 +903,15 @@ const Extensions = GObject.registerClass({
             text: this._stateToString(extension.state),
         });
         metaBox.add_child(state);
+        box._state = state;
+
+        // The time the extension blocked the shell in its own calls
+        const busyTime = new St.Label({
+            style_class: 'lg-extension-state',
+            text: this._busyTimeToString(extension.busyTime),
+        });
+        metaBox.add_child(busyTime);
+        box._busyTime = busyTime;
 
         const viewsource = new St.Button({
             reactive: true,
@@ -1062,6 +1132,169 @@ class ActorTreeViewer extends St.BoxLayout {
     }
 });
 
+const PROFILER_UPDATE_INTERVAL = 1000;
+const PROFILER_MAX_ROWS = 50;
+
+const PROFILER_COLUMNS = [
+    {key: 'total', title: 'Total'},
+    {key: 'preferredSize', title: 'Size request'},
+    {key: 'allocate', title: 'Allocate'},
+    {key: 'paintNode', title: 'Paint'},
+    {key: 'themeNodePaint', title: 'Theme node'},
+];
+
+const ActorProfiler = GObject.registerClass(
+class ActorProfiler extends St.BoxLayout {
+    _init(lookingGlass) {
+        super._init({
+            name: 'lookingGlassProfiler',
+            vertical: true,
+        });
+
+        this._lookingGlass = lookingGlass;
+        this._sortKey = 'total';
+        this._updateId = 0;
+
+        const toolbar = new St.BoxLayout({style_class: 'lg-profiler-toolbar'});
+        this.add_child(toolbar);
+
+        this._recordButton = new St.Button({
+            style_class: 'lg-obj-inspector-button',
+            label: 'Record',
+            toggle_mode: true,
+        });
+        this._recordButton.connect('notify::checked', () => {
+            St.Widget.set_profiling_enabled(this._recordButton.checked);
+            this._recordButton.label = this._recordButton.checked ? 'Stop' : 'Record';
+        });
+        toolbar.add_child(this._recordButton);
+
+        const resetButton = new St.Button({
+            style_class: 'lg-obj-inspector-button',
+            label: 'Reset',
+        });
+        resetButton.connect('clicked', () => {
+            St.Widget.reset_profile();
+            this._update();
+        });
+        toolbar.add_child(resetButton);
+
+        this._byClassButton = new St.Button({
+            style_class: 'lg-obj-inspector-button',
+            label: 'Group by class',
+            toggle_mode: true,
+        });
+        this._byClassButton.connect('notify::checked', () => this._update());
+        toolbar.add_child(this._byClassButton);
+
+        this._table = new St.Widget({
+            style_class: 'lg-profiler-table',
+            layout_manager: new Clutter.GridLayout(),
+        });
+        this.add_child(this._table);
+    }
+
+    _getEntries() {
+        const entries = new Map();
+
+        for (const widget of St.Widget.get_profiled_widgets()) {
+            const [preferredSize, allocate, paintNode, themeNodePaint] =
+                widget.get_profile();
+            const key = this._byClassButton.checked
+                ? GObject.type_name(widget.constructor.$gtype) : widget;
+
+            let entry = entries.get(key);
+            if (!entry) {
+                entry = {
+                    key,
+                    count: 0,
+                    preferredSize: 0,
+                    allocate: 0,
+                    paintNode: 0,
+                    themeNodePaint: 0,
+                };
+                entries.set(key, entry);
+            }
+
+            entry.count++;
+            entry.preferredSize += preferredSize;
+            entry.allocate += allocate;
+            entry.paintNode += paintNode;
+            entry.themeNodePaint += themeNodePaint;
+        }
+
+        for (const entry of entries.values()) {
+            entry.total = entry.preferredSize + entry.allocate +
+                entry.paintNode + entry.themeNodePaint;
+        }
+
+        return [...entries.values()]
+            .sort((a, b) => b[this._sortKey] - a[this._sortKey])
+            .slice(0, PROFILER_MAX_ROWS);
+    }
+
+    _update() {
+        const layout = this._table.layout_manager;
+        const byClass = this._byClassButton.checked;
+
+        this._table.destroy_all_children();
+
+        layout.attach(new St.Label({
+            style_class: 'lg-profiler-header',
+            text: byClass ? 'Class (widgets)' : 'Actor',
+        }), 0, 0, 1, 1);
+
+        PROFILER_COLUMNS.forEach(({key, title}, i) => {
+            const header = new St.Button({
+                style_class: 'lg-profiler-header',
+                label: key === this._sortKey ? `${title} ▾` : title,
+                x_align: Clutter.ActorAlign.END,
+            });
+            header.connect('clicked', () => {
+                this._sortKey = key;
+                this._update();
+            });
+            layout.attach(header, i + 1, 0, 1, 1);
+        });
+
+        this._getEntries().forEach((entry, row) => {
+            const name = byClass
+                ? new St.Label({text: `${entry.key} (${entry.count})`})
+                : new ObjLink(this._lookingGlass, entry.key);
+            layout.attach(name, 0, row + 1, 1, 1);
+
+            PROFILER_COLUMNS.forEach(({key}, i) => {
+                layout.attach(new St.Label({
+                    style_class: 'lg-profiler-cost',
+                    text: `${(entry[key] / 1000).toFixed(2)} ms`,
+                    x_align: Clutter.ActorAlign.END,
+                }), i + 1, row + 1, 1, 1);
+            });
+        });
+    }
+
+    vfunc_map() {
+        super.vfunc_map();
+
+        this._update();
+        this._updateId = GLib.timeout_add(GLib.PRIORITY_DEFAULT,
+            PROFILER_UPDATE_INTERVAL, () => {
+                this._update();
+                return GLib.SOURCE_CONTINUE;
+            });
+        GLib.Source.set_name_by_id(this._updateId, '[gnome-shell] this._update');
+    }
+
+    vfunc_unmap() {
+        super.vfunc_unmap();
+
+        if (this._updateId) {
+            GLib.source_remove(this._updateId);
+            this._updateId = 0;
+        }
+    }
+});
+
 const DebugFlag = GObject.registerClass({
     GTypeFlags: GObject.TypeFlags.ABSTRACT,
 }, class DebugFlag extends St.Button {
@@ -1290,7 +1523,6 @@ class LookingGlass extends St.BoxLayout {
 
         this._open = false;
 
-        this._it = null;
         this._offset = 0;
 
         // Sort of magic, but...eh.
@@ -1397,6 +1629,9 @@ class LookingGlass extends St.BoxLayout {
         this._actorTreeViewer = new ActorTreeViewer(this);
         notebook.appendPage('Actors', this._actorTreeViewer);
 
+        this._profiler = new ActorProfiler(this);
+        notebook.appendPage('Profiler', this._profiler);
+
         this._debugFlags = new DebugFlags();
         notebook.appendPage('Flags', this._debugFlags);
 
@@ -1465,11 +1700,14 @@ class LookingGlass extends St.BoxLayout {
         if (obj instanceof Clutter.Actor)
             this.setBorderPaintTarget(obj);
 
-        if (this._resultsArea.get_n_children() > this._maxItems) {
+        const nResults = this._resultsArea.get_n_children();
+        if (nResults > MAX_LIVE_RESULTS)
+            this._resultsArea.get_child_at_index(nResults - MAX_LIVE_RESULTS - 1).release();
+
+        if (nResults > this._maxItems) {
             this._resultsArea.get_first_child().destroy();
             this._offset++;
         }
-        this._it = obj;
 
         // Scroll to bottom
         this._notebook.scrollToBottom(0);
@@ -1550,7 +1788,8 @@ class LookingGlass extends St.BoxLayout {
     }
 
     getIt() {
-        return this._it;
+        const result = this._resultsArea.get_last_child();
+        return result ? result.o : null;
     }
 
     getResult(idx) {
@@ -1561,6 +1800,63 @@ class LookingGlass extends St.BoxLayout {
         }
     }
 
+    getFrameStats() {
+        // Recording starts with the first request
+        global.frame_stats = true;
+
+        return global.get_frame_stats().deepUnpack().map(
+            ([start, style, layout, paint, gpu, update, interval, dropped]) => ({
+                start, style, layout, paint, gpu, update, interval, dropped,
+            }));
+    }
+
+    getMonitorFrameStats() {
+        // Recording starts with the first request
+        global.frame_stats = true;
+
+        const monitors = new Map();
+        for (const [monitor, refreshRate, start, update, latency, dropped] of
+            global.get_view_frame_stats().deepUnpack()) {
+            let stats = monitors.get(monitor);
+            if (!stats) {
+                stats = {
+                    monitor, refreshRate,
+                    frames: 0, missed: 0,
+                    firstStart: start, lastStart: start,
+                    maxUpdate: 0, latencies: [],
+                };
+                monitors.set(monitor, stats);
+            }
+
+            stats.frames++;
+            stats.lastStart = start;
+            stats.maxUpdate = Math.max(stats.maxUpdate, update);
+            if (dropped)
+                stats.missed++;
+            if (latency >= 0)
+                stats.latencies.push(latency);
+        }
+
+        // Times in milliseconds
+        return [...monitors.values()].map(stats => {
+            const {monitor, refreshRate, frames, missed, latencies} = stats;
+            const duration = stats.lastStart - stats.firstStart;
+            const fps = duration > 0 ? (frames - 1) * 1e6 / duration : 0;
+            const latency = latencies.length > 0
+                ? latencies.reduce((a, b) => a + b) / latencies.length / 1000
+                : -1;
+            const maxLatency = latencies.length > 0
+                ? Math.max(...latencies) / 1000
+                : -1;
+
+            return {
+                monitor, refreshRate, frames, fps, missed,
+                latency, maxLatency,
+                maxUpdate: stats.maxUpdate / 1000,
+            };
+        });
+    }
+
     toggle() {
         if (this._open)
             this.close();
@@ -1661,6 +1957,9 @@ class LookingGlass extends St.BoxLayout {
 
         this.setBorderPaintTarget(null);
 
+        // Don't keep what was looked at alive once done debugging
+        this._resultsArea.get_children().forEach(r => r.release());
+
         let settings = St.Settings.get();
         let duration = Math.min(
             LG_ANIMATION_TIME / settings.slow_down_factor,
@@ -2042,17 +2042,12 @@ class Crosshairs extends Clutter.Actor {
 
 class MagShaderEffects {
     constructor(uiGroupClone) {
-        this._inverse = new Shell.InvertLightnessEffect();
-        this._brightnessContrast = new Clutter.BrightnessContrastEffect();
-        this._colorDesaturation = new Clutter.DesaturateEffect();
-        this._inverse.set_enabled(false);
-        this._brightnessContrast.set_enabled(false);
-        this._colorDesaturation.set_enabled(false);
+        // Inversion, brightness, contrast and saturation in one pass,
+        // rather than an offscreen of the zoom region for each
+        this._effect = new Shell.MagnifierEffect();
 
         this._magView = uiGroupClone;
-        this._magView.add_effect(this._inverse);
-        this._magView.add_effect(this._brightnessContrast);
-        this._magView.add_effect(this._colorDesaturation);
+        this._magView.add_effect(this._effect);
     }
 
     /**
@@ -2063,9 +2058,7 @@ class MagShaderEffects {
      */
     destroyEffects() {
         this._magView.clear_effects();
-        this._colorDesaturation = null;
-        this._brightnessContrast = null;
-        this._inverse = null;
+        this._effect = null;
         this._magView = null;
     }
 
@@ -2076,12 +2069,11 @@ class MagShaderEffects {
      * @param {boolean} invertFlag Enabled flag.
      */
     setInvertLightness(invertFlag) {
-        this._inverse.set_enabled(invertFlag);
+        this._effect.set_invert_lightness(invertFlag);
     }
 
     setColorSaturation(factor) {
-        this._colorDesaturation.set_factor(1.0 - factor);
-        this._colorDesaturation.set_enabled(factor !== 1.0);
+        this._effect.set_color_saturation(factor);
     }
 
     /**
@@ -2098,17 +2090,7 @@ class MagShaderEffects {
      *     {number} brightness.b - the blue component
      */
     setBrightness(brightness) {
-        let bRed = brightness.r;
-        let bGreen = brightness.g;
-        let bBlue = brightness.b;
-        this._brightnessContrast.set_brightness_full(bRed, bGreen, bBlue);
-
-        // Enable the effect if the brightness OR contrast change are such that
-        // it modifies the brightness and/or contrast.
-        let [cRed, cGreen, cBlue] = this._brightnessContrast.get_contrast();
-        this._brightnessContrast.set_enabled(
-            bRed !== NO_CHANGE || bGreen !== NO_CHANGE || bBlue !== NO_CHANGE ||
-            cRed !== NO_CHANGE || cGreen !== NO_CHANGE || cBlue !== NO_CHANGE);
+        this._effect.set_brightness(brightness.r, brightness.g, brightness.b);
     }
 
     /**
@@ -2124,19 +2106,6 @@ class MagShaderEffects {
      *     {number} contrast.b - the blue component
      */
     setContrast(contrast) {
-        let cRed = contrast.r;
-        let cGreen = contrast.g;
-        let cBlue = contrast.b;
-
-        this._brightnessContrast.set_contrast_full(cRed, cGreen, cBlue);
-
-        // Enable the effect if the contrast OR brightness change are such that
-        // it modifies the brightness and/or contrast.
-        // should be able to use Cogl.Color.equal(), but that complains of
-        // a null first argument.
-        let [bRed, bGreen, bBlue] = this._brightnessContrast.get_brightness();
-        this._brightnessContrast.set_enabled(
-            cRed !== NO_CHANGE || cGreen !== NO_CHANGE || cBlue !== NO_CHANGE ||
-            bRed !== NO_CHANGE || bGreen !== NO_CHANGE || bBlue !== NO_CHANGE);
+        this._effect.set_contrast(contrast.r, contrast.g, contrast.b);
     }
 }
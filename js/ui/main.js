@@ -15,6 +15,7 @@ import * as Components from './components.js';
 import * as CtrlAltTab from './ctrlAltTab.js';
 import * as EndSessionDialog from './endSessionDialog.js';
 import * as ExtensionSystem from './extensionSystem.js';
+import * as HeapStatistics from '../misc/heapStatistics.js';
 import * as ExtensionDownloader from './extensionDownloader.js';
 import * as InputMethod from '../misc/inputMethod.js';
 import * as Introspect from '../misc/introspect.js';
@@ -26,11 +27,8 @@ import * as OsdMonitorLabeler from './osdMonitorLabeler.js';
 import * as Overview from './overview.js';
 import * as PadOsd from './padOsd.js';
 import * as Panel from './panel.js';
-import * as RunDialog from './runDialog.js';
-import * as WelcomeDialog from './welcomeDialog.js';
 import * as Layout from './layout.js';
 import * as LoginManager from '../misc/loginManager.js';
-import * as LookingGlass from './lookingGlass.js';
 import * as NotificationDaemon from './notificationDaemon.js';
 import * as WindowAttentionHandler from './windowAttentionHandler.js';
 import * as Screenshot from './screenshot.js';
@@ -42,6 +40,7 @@ import * as WindowManager from './windowManager.js';
 import * as Magnifier from './magnifier.js';
 import * as XdndHandler from './xdndHandler.js';
 import * as KbdA11yDialog from './kbdA11yDialog.js';
+import * as LazyModules from '../misc/lazyModules.js';
 import * as LocatePointer from './locatePointer.js';
 import * as PointerA11yTimeout from './pointerA11yTimeout.js';
 import {formatError} from '../misc/errorUtils.js';
@@ -55,6 +54,23 @@ const WELCOME_DIALOG_LAST_TOUR_CHANGE = '40.beta';
 const LOG_DOMAIN = 'GNOME Shell';
 const GNOMESHELL_STARTED_MESSAGE_ID = 'f3ea493c22934e26811cd62abe8e203a';
 
+// Images used by the theme, decoded in the background during startup
+// so that the widgets using them don't have to wait for them
+const PREWARMED_THEME_ASSETS = [
+    'calendar-today.svg',
+    'calendar-today-light.svg',
+    'workspace-placeholder.svg',
+];
+
+// Time in milliseconds after which deferred stages of startup run, even
+// if the shell didn't become idle in between
+const DEFERRED_STARTUP_DEADLINE = 5000;
+
+// Modules imported on first use, see LazyModules
+const LOOKING_GLASS_MODULE = 'resource:///org/gnome/shell/ui/lookingGlass.js';
+const RUN_DIALOG_MODULE = 'resource:///org/gnome/shell/ui/runDialog.js';
+const WELCOME_DIALOG_MODULE = 'resource:///org/gnome/shell/ui/welcomeDialog.js';
+
 export let componentManager = null;
 export let extensionManager = null;
 export let panel = null;
@@ -140,8 +156,50 @@ function _sessionUpdated() {
     }
 }
 
+/**
+ * Runs a stage of startup, marking its start and end in the performance
+ * log, so that the timeline of startup shows where the time goes
+ *
+ * @param {string} name - the name of the stage
+ * @param {Function} func - the function running the stage
+ * @returns {*} the return value of func
+ */
+function _runStartupStage(name, func) {
+    const perfLog = Shell.PerfLog.get_default();
+
+    perfLog.event_s('startup.stageStart', name);
+    try {
+        return func();
+    } finally {
+        perfLog.event_s('startup.stageDone', name);
+    }
+}
+
+/**
+ * Runs a stage of startup which nothing on screen depends on once the
+ * shell is idle, rather than before the first frame
+ *
+ * @param {string} name - the name of the stage
+ * @param {Function} func - the function running the stage
+ * @param {Shell.IdlePriority} priority - the priority of the stage
+ */
+function _deferStartupStage(name, func, priority = Shell.IdlePriority.DEFAULT) {
+    global.add_idle_work(priority, DEFERRED_STARTUP_DEADLINE, () => {
+        _runStartupStage(name, func);
+        return false;
+    });
+}
+
 /** @returns {void} */
 export async function start() {
+    const perfLog = Shell.PerfLog.get_default();
+    perfLog.define_event('startup.stageStart',
+        'Start of a stage of startup', 's');
+    perfLog.define_event('startup.stageDone',
+        'End of a stage of startup', 's');
+    perfLog.define_event('startup.complete',
+        'Startup is complete', '');
+
     globalThis.log = console.log;
     globalThis.logError = function (err, msg) {
         const args = [formatError(err)];
@@ -197,57 +255,51 @@ async function _initializeUI() {
     // and recalculate application associations, so to avoid
     // races for now we initialize it here. It's better to
     // be predictable anyways.
-    Shell.WindowTracker.get_default();
-    Shell.AppUsage.get_default();
+    _runStartupStage('apps', () => {
+        Shell.WindowTracker.get_default();
+        Shell.AppUsage.get_default();
+    });
+
+    global.settings.bind('texture-cache-budget',
+        St.TextureCache.get_default(), 'memory-budget',
+        Gio.SettingsBindFlags.GET);
 
-    reloadThemeResource();
-    _loadIcons();
-    _loadOskLayouts();
-    _loadDefaultStylesheet();
+    // Themes are parsed and applied on the main thread, so these stages
+    // run in order; only the decoding of prewarmed assets is threaded
+    _runStartupStage('resources', () => {
+        reloadThemeResource();
+        _loadIcons();
+        _loadOskLayouts();
+    });
+    _runStartupStage('stylesheet', () => {
+        _loadDefaultStylesheet();
+        _prewarmThemeAssets();
+    });
     _loadWorkspacesAdjustment();
 
     new AnimationsSettings();
 
     // Setup the stage hierarchy early
-    layoutManager = new Layout.LayoutManager();
-
-    // Various parts of the codebase still refer to Main.uiGroup
-    // instead of using the layoutManager. This keeps that code
-    // working until it's updated.
-    uiGroup = layoutManager.uiGroup;
-
-    padOsdService = new PadOsd.PadOsdService();
-    xdndHandler = new XdndHandler.XdndHandler();
-    ctrlAltTabManager = new CtrlAltTab.CtrlAltTabManager();
-    osdWindowManager = new OsdWindow.OsdWindowManager();
-    osdMonitorLabeler = new OsdMonitorLabeler.OsdMonitorLabeler();
-    overview = new Overview.Overview();
-    kbdA11yDialog = new KbdA11yDialog.KbdA11yDialog();
-    wm = new WindowManager.WindowManager();
-    magnifier = new Magnifier.Magnifier();
-    locatePointer = new LocatePointer.LocatePointer();
+    _runStartupStage('layout', () => {
+        layoutManager = new Layout.LayoutManager();
 
-    if (LoginManager.canLock())
-        screenShield = new ScreenShield.ScreenShield();
+        // Various parts of the codebase still refer to Main.uiGroup
+        // instead of using the layoutManager. This keeps that code
+        // working until it's updated.
+        uiGroup = layoutManager.uiGroup;
+    });
 
-    inputMethod = new InputMethod.InputMethod();
-    Clutter.get_default_backend().set_input_method(inputMethod);
-    global.connect('shutdown',
-        () => Clutter.get_default_backend().set_input_method(null));
+    _runStartupStage('ui', _createUI);
 
-    screenshotUI = new Screenshot.ScreenshotUI();
+    // Only serves tools, which wait for its bus name
+    _deferStartupStage('introspect', () => {
+        introspectService = new Introspect.IntrospectService();
+    }, Shell.IdlePriority.LOW);
 
-    messageTray = new MessageTray.MessageTray();
-    panel = new Panel.Panel();
-    keyboard = new Keyboard.KeyboardManager();
-    notificationDaemon = new NotificationDaemon.NotificationDaemon();
-    windowAttentionHandler = new WindowAttentionHandler.WindowAttentionHandler();
-    componentManager = new Components.ComponentManager();
-
-    introspectService = new Introspect.IntrospectService();
-
-    layoutManager.init();
-    overview.init();
+    _runStartupStage('layoutInit', () => {
+        layoutManager.init();
+        overview.init();
+    });
 
     new PointerA11yTimeout.PointerA11yTimeout();
 
@@ -298,9 +350,15 @@ async function _initializeUI() {
 
     _startDate = new Date();
 
-    ExtensionDownloader.init();
-    extensionManager = new ExtensionSystem.ExtensionManager();
-    extensionManager.init();
+    // Statistics are only sampled once the performance log is read
+    _deferStartupStage('heapStatistics', () => HeapStatistics.init(),
+        Shell.IdlePriority.LOW);
+
+    _runStartupStage('extensions', () => {
+        ExtensionDownloader.init();
+        extensionManager = new ExtensionSystem.ExtensionManager();
+        extensionManager.init();
+    });
 
     if (sessionMode.isGreeter && screenShield) {
         layoutManager.connect('startup-prepared', () => {
@@ -319,6 +377,8 @@ async function _initializeUI() {
     }
 
     layoutManager.connect('startup-complete', () => {
+        Shell.PerfLog.get_default().event('startup.complete');
+
         if (actionMode === Shell.ActionMode.NONE)
             actionMode = Shell.ActionMode.NORMAL;
 
@@ -350,6 +410,10 @@ async function _initializeUI() {
 
         LoginManager.registerSessionWithGDM();
 
+        // Alt+F2 should not wait for the run dialog to be imported
+        if (sessionMode.hasRunDialog)
+            LazyModules.prewarm(RUN_DIALOG_MODULE);
+
         if (perfModule) {
             let perfOutput = GLib.getenv('SHELL_PERF_OUTPUT');
             Scripting.runPerfScript(perfModule, perfOutput);
@@ -357,6 +421,37 @@ async function _initializeUI() {
     });
 }
 
+/** @private */
+function _createUI() {
+    padOsdService = new PadOsd.PadOsdService();
+    xdndHandler = new XdndHandler.XdndHandler();
+    ctrlAltTabManager = new CtrlAltTab.CtrlAltTabManager();
+    osdWindowManager = new OsdWindow.OsdWindowManager();
+    osdMonitorLabeler = new OsdMonitorLabeler.OsdMonitorLabeler();
+    overview = new Overview.Overview();
+    kbdA11yDialog = new KbdA11yDialog.KbdA11yDialog();
+    wm = new WindowManager.WindowManager();
+    magnifier = new Magnifier.Magnifier();
+    locatePointer = new LocatePointer.LocatePointer();
+
+    if (LoginManager.canLock())
+        screenShield = new ScreenShield.ScreenShield();
+
+    inputMethod = new InputMethod.InputMethod();
+    Clutter.get_default_backend().set_input_method(inputMethod);
+    global.connect('shutdown',
+        () => Clutter.get_default_backend().set_input_method(null));
+
+    screenshotUI = new Screenshot.ScreenshotUI();
+
+    messageTray = new MessageTray.MessageTray();
+    panel = new Panel.Panel();
+    keyboard = new Keyboard.KeyboardManager();
+    notificationDaemon = new NotificationDaemon.NotificationDaemon();
+    windowAttentionHandler = new WindowAttentionHandler.WindowAttentionHandler();
+    componentManager = new Components.ComponentManager();
+}
+
 function _handleShowWelcomeScreen() {
     const lastShownVersion = global.settings.get_string(WELCOME_DIALOG_LAST_SHOWN_VERSION);
     if (Util.GNOMEversionCompare(WELCOME_DIALOG_LAST_TOUR_CHANGE, lastShownVersion) > 0) {
@@ -578,6 +673,17 @@ function _loadIcons() {
     _iconResource._register();
 }
 
+function _prewarmThemeAssets() {
+    const textureCache = St.TextureCache.get_default();
+    const {scaleFactor} = St.ThemeContext.get_for_stage(global.stage);
+
+    for (const asset of PREWARMED_THEME_ASSETS) {
+        const file = Gio.File.new_for_uri(
+            `resource:///org/gnome/shell/theme/${asset}`);
+        textureCache.prewarm_file(file, scaleFactor, 1);
+    }
+}
+
 function _loadOskLayouts() {
     _oskResource = Gio.Resource.load(`${global.datadir}/gnome-shell-osk-layouts.gresource`);
     _oskResource._register();
@@ -780,31 +886,36 @@ export function popModal(grab) {
 }
 
 /**
- * Creates the looking glass panel
+ * Creates the looking glass panel, importing it on first use
  *
- * @returns {LookingGlass.LookingGlass}
+ * @returns {Promise<LookingGlass.LookingGlass>}
  */
-export function createLookingGlass() {
-    if (lookingGlass == null)
-        lookingGlass = new LookingGlass.LookingGlass();
+export async function createLookingGlass() {
+    const LookingGlass = await LazyModules.load(LOOKING_GLASS_MODULE);
+
+    lookingGlass ??= new LookingGlass.LookingGlass();
 
     return lookingGlass;
 }
 
 /**
- * Opens the run dialog
+ * Opens the run dialog, importing it on first use
  */
-export function openRunDialog() {
-    if (runDialog == null)
-        runDialog = new RunDialog.RunDialog();
+export async function openRunDialog() {
+    const RunDialog = await LazyModules.load(RUN_DIALOG_MODULE);
+
+    // The session may have changed while importing
+    if (!sessionMode.hasRunDialog)
+        return;
 
+    runDialog ??= new RunDialog.RunDialog();
     runDialog.open();
 }
 
-export function openWelcomeDialog() {
-    if (welcomeDialog === null)
-        welcomeDialog = new WelcomeDialog.WelcomeDialog();
+export async function openWelcomeDialog() {
+    const WelcomeDialog = await LazyModules.load(WELCOME_DIALOG_MODULE);
 
+    welcomeDialog ??= new WelcomeDialog.WelcomeDialog();
     welcomeDialog.open();
 }
 
@@ -777,7 +777,7 @@ export const MessageTray = GObject.registerClass({
             this._onDragEnd.bind(this));
 
         Main.wm.addKeybinding('focus-active-notification',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.NONE,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._expandActiveNotification.bind(this));
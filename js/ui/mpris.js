@@ -1,6 +1,9 @@
+import GdkPixbuf from 'gi://GdkPixbuf';
 import Gio from 'gi://Gio';
+import GLib from 'gi://GLib';
 import GObject from 'gi://GObject';
 import Shell from 'gi://Shell';
+import St from 'gi://St';
 import * as Signals from '../misc/signals.js';
 
 import * as Main from './main.js';
@@ -19,6 +22,178 @@ const MprisPlayerProxy = Gio.DBusProxy.makeProxyWrapper(MprisPlayerIface);
 
 const MPRIS_PLAYER_PREFIX = 'org.mpris.MediaPlayer2.';
 
+// The icon-size of the album art in the theme
+const COVER_ART_SIZE = 48;
+// How much disk space downscaled covers may take at most, in bytes
+const COVER_ART_CACHE_BUDGET = 8 * 1024 * 1024;
+
+Gio._promisify(Gio.File.prototype, 'delete_async');
+Gio._promisify(Gio.File.prototype, 'enumerate_children_async');
+Gio._promisify(Gio.File.prototype, 'read_async');
+Gio._promisify(Gio.File.prototype,
+    'replace_contents_bytes_async', 'replace_contents_finish');
+Gio._promisify(Gio.FileEnumerator.prototype, 'next_files_async');
+Gio._promisify(Gio.InputStream.prototype, 'close_async');
+Gio._promisify(GdkPixbuf.Pixbuf,
+    'new_from_stream_at_scale_async', 'new_from_stream_finish');
+
+/**
+ * Keeps downscaled copies of cover art on disk, so that players skipping
+ * through tracks don't make us fetch and decode full-size images again,
+ * often from remote URLs. Covers are decoded in a worker thread, and
+ * cached under their URL, size and ETag (or modification time), so that
+ * changed images are fetched again.
+ */
+class CoverArtCache {
+    constructor() {
+        this._dir = Gio.File.new_for_path(GLib.build_filenamev(
+            [GLib.get_user_cache_dir(), 'gnome-shell', 'cover-art']));
+
+        // Sizes of the cached files by name, least recently used first
+        this._entries = null;
+        this._totalSize = 0;
+        this._indexPromise = null;
+
+        // Covers being downscaled, by file name
+        this._pending = new Map();
+    }
+
+    /**
+     * @param {string} url - the URL of the cover
+     * @param {number} size - the size of the cover, in pixels
+     * @param {Gio.Cancellable} cancellable - a cancellable
+     * @returns {Promise<Gio.Icon>} an icon for the downscaled cover
+     */
+    async lookup(url, size, cancellable) {
+        const source = Gio.File.new_for_uri(url);
+        const info = await source.query_info_async(
+            'etag::value,time::modified',
+            Gio.FileQueryInfoFlags.NONE,
+            GLib.PRIORITY_DEFAULT,
+            cancellable);
+        const version = info.get_etag() ??
+            info.get_modification_date_time()?.to_unix() ?? '';
+        const name = `${GLib.compute_checksum_for_string(
+            GLib.ChecksumType.SHA256, `${url}\n${version}`, -1)}-${size}.png`;
+        const file = this._dir.get_child(name);
+
+        await this._ensureIndex();
+
+        if (this._entries.has(name)) {
+            this._touch(name);
+        } else {
+            let promise = this._pending.get(name);
+            if (!promise) {
+                // Not cancellable, as other lookups may share it
+                promise = this._store(source, file, size)
+                    .finally(() => this._pending.delete(name));
+                this._pending.set(name, promise);
+            }
+            await promise;
+        }
+
+        cancellable?.set_error_if_cancelled();
+        return new Gio.FileIcon({file});
+    }
+
+    _ensureIndex() {
+        this._indexPromise ??= this._loadIndex();
+        return this._indexPromise;
+    }
+
+    async _loadIndex() {
+        const entries = [];
+
+        try {
+            const enumerator = await this._dir.enumerate_children_async(
+                'standard::name,standard::size,time::modified',
+                Gio.FileQueryInfoFlags.NONE,
+                GLib.PRIORITY_LOW,
+                null);
+
+            for (;;) {
+                // eslint-disable-next-line no-await-in-loop
+                const infos = await enumerator.next_files_async(100,
+                    GLib.PRIORITY_LOW, null);
+                if (infos.length === 0)
+                    break;
+                entries.push(...infos);
+            }
+        } catch (e) {
+            if (!e.matches?.(Gio.IOErrorEnum, Gio.IOErrorEnum.NOT_FOUND))
+                logError(e, 'Failed to read the cover art cache');
+        }
+
+        entries.sort((a, b) =>
+            a.get_modification_date_time().compare(b.get_modification_date_time()));
+
+        this._entries = new Map();
+        for (const info of entries)
+            this._add(info.get_name(), info.get_size());
+    }
+
+    async _store(source, file, size) {
+        const stream = await source.read_async(GLib.PRIORITY_LOW, null);
+        let pixbuf;
+        try {
+            pixbuf = await GdkPixbuf.Pixbuf.new_from_stream_at_scale_async(
+                stream, size, size, true, null);
+        } finally {
+            stream.close_async(GLib.PRIORITY_LOW, null).catch(logError);
+        }
+
+        // Encoding the small copy is cheap, unlike decoding the original
+        const [, buffer] = pixbuf.save_to_bufferv('png', [], []);
+        const bytes = new GLib.Bytes(buffer);
+
+        try {
+            this._dir.make_directory_with_parents(null);
+        } catch (e) {
+            if (!e.matches(Gio.IOErrorEnum, Gio.IOErrorEnum.EXISTS))
+                throw e;
+        }
+
+        await file.replace_contents_bytes_async(bytes,
+            null, false, Gio.FileCreateFlags.NONE, null);
+
+        this._add(file.get_basename(), bytes.get_size());
+        this._trim();
+    }
+
+    _add(name, size) {
+        this._entries.set(name, size);
+        this._totalSize += size;
+    }
+
+    _touch(name) {
+        const size = this._entries.get(name);
+        this._entries.delete(name);
+        this._entries.set(name, size);
+    }
+
+    _trim() {
+        for (const [name, size] of this._entries) {
+            if (this._totalSize <= COVER_ART_CACHE_BUDGET)
+                break;
+
+            this._entries.delete(name);
+            this._totalSize -= size;
+            this._dir.get_child(name).delete_async(GLib.PRIORITY_LOW, null)
+                .catch(logError);
+        }
+    }
+}
+
+let _coverArtCache = null;
+
+/**
+ * @returns {CoverArtCache}
+ */
+function getCoverArtCache() {
+    _coverArtCache ??= new CoverArtCache();
+    return _coverArtCache;
+}
+
 export const MediaMessage = GObject.registerClass(
 class MediaMessage extends MessageList.Message {
     constructor(player) {
@@ -42,10 +217,15 @@ class MediaMessage extends MessageList.Message {
                 this._player.next();
             });
 
+        this._coverUrl = null;
+        this._coverCancellable = null;
+
         this._player.connectObject(
             'changed', this._update.bind(this),
             'closed', this.close.bind(this), this);
         this._update();
+
+        this.connect('destroy', () => this._coverCancellable?.cancel());
     }
 
     vfunc_clicked() {
@@ -57,19 +237,48 @@ class MediaMessage extends MessageList.Message {
         button.reactive = sensitive;
     }
 
-    _update() {
+    async _updateCover() {
+        const url = this._player.trackCoverUrl;
+        if (url === this._coverUrl)
+            return;
+
+        this._coverUrl = url;
+        this._coverCancellable?.cancel();
+        this._coverCancellable = null;
+
+        // Keep showing the previous cover until the new one is ready
+        if (!url || !this.icon)
+            this.icon = new Gio.ThemedIcon({name: 'audio-x-generic-symbolic'});
+
+        if (!url)
+            return;
+
+        const cancellable = new Gio.Cancellable();
+        this._coverCancellable = cancellable;
+
+        const scaleFactor = St.ThemeContext.get_for_stage(global.stage).scale_factor;
         let icon;
-        if (this._player.trackCoverUrl) {
-            const file = Gio.File.new_for_uri(this._player.trackCoverUrl);
-            icon = new Gio.FileIcon({file});
-        } else {
-            icon = new Gio.ThemedIcon({name: 'audio-x-generic-symbolic'});
+        try {
+            icon = await getCoverArtCache().lookup(url,
+                COVER_ART_SIZE * scaleFactor, cancellable);
+        } catch (e) {
+            if (e.matches?.(Gio.IOErrorEnum, Gio.IOErrorEnum.CANCELLED))
+                return;
+
+            // Let the texture cache have a go at whatever this is
+            icon = new Gio.FileIcon({file: Gio.File.new_for_uri(url)});
         }
 
+        if (!cancellable.is_cancelled())
+            this.icon = icon;
+    }
+
+    _update() {
+        this._updateCover().catch(logError);
+
         this.set({
             title: this._player.trackTitle,
             body: this._player.trackArtists.join(', '),
-            icon,
         });
 
         let isPlaying = this._player.status === 'Playing';
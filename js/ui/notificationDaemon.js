@@ -30,6 +30,16 @@ const Urgency = {
     CRITICAL: 2,
 };
 
+// Each client may send this many new notifications in a burst, and then
+// this many per second; the ones beyond are closed right away. Updates of
+// existing notifications aren't limited.
+const NOTIFICATION_BURST = 20;
+const NOTIFICATIONS_PER_SECOND = 5;
+
+// How many notifications are shown per main loop iteration; updates of a
+// notification that pile up until it is shown are merged into the latest
+const NOTIFICATIONS_PER_BATCH = 10;
+
 class FdoNotificationDaemon {
     constructor() {
         this._dbusImpl = Gio.DBusExportedObject.wrapJSObject(FdoNotificationsIface, this);
@@ -39,9 +49,67 @@ class FdoNotificationDaemon {
         this._sourceForPidAndName = new Map();
         this._notifications = new Map();
 
+        // Parameters of the Notify() calls not processed yet, by ID
+        this._pendingNotifications = new Map();
+        this._processNotificationsId = 0;
+
+        // Token buckets of the clients, by sender
+        this._notificationBuckets = new Map();
+
         this._nextNotificationId = 1;
     }
 
+    _takeNotificationToken(sender) {
+        const now = GLib.get_monotonic_time();
+        let bucket = this._notificationBuckets.get(sender);
+
+        if (!bucket) {
+            // Forget about clients that have been quiet for long enough
+            // to have their buckets refilled
+            if (this._notificationBuckets.size >= 64) {
+                const refillTime = NOTIFICATION_BURST / NOTIFICATIONS_PER_SECOND * GLib.USEC_PER_SEC;
+                for (const [key, b] of this._notificationBuckets) {
+                    if (now - b.time >= refillTime)
+                        this._notificationBuckets.delete(key);
+                }
+            }
+
+            bucket = {tokens: NOTIFICATION_BURST, time: now};
+            this._notificationBuckets.set(sender, bucket);
+        }
+
+        bucket.tokens = Math.min(NOTIFICATION_BURST,
+            bucket.tokens + (now - bucket.time) * NOTIFICATIONS_PER_SECOND / GLib.USEC_PER_SEC);
+        bucket.time = now;
+
+        if (bucket.tokens < 1)
+            return false;
+
+        bucket.tokens--;
+        return true;
+    }
+
+    _queueProcessNotifications() {
+        if (this._processNotificationsId)
+            return;
+
+        this._processNotificationsId = GLib.idle_add(GLib.PRIORITY_DEFAULT, () => {
+            let n = 0;
+            for (const [id, params] of this._pendingNotifications) {
+                if (n++ === NOTIFICATIONS_PER_BATCH)
+                    return GLib.SOURCE_CONTINUE;
+
+                this._pendingNotifications.delete(id);
+                this._processNotification(id, params);
+            }
+
+            this._processNotificationsId = 0;
+            return GLib.SOURCE_REMOVE;
+        });
+        GLib.Source.set_name_by_id(this._processNotificationsId,
+            '[gnome-shell] this._processNotifications');
+    }
+
     _imageForNotificationData(hints) {
         if (hints['image-data']) {
             const [
@@ -135,9 +203,33 @@ class FdoNotificationDaemon {
     }
 
     NotifyAsync(params, invocation) {
-        let [appName, replacesId, appIcon, summary, body, actions, hints, timeout_] = params;
+        const [appName, replacesId, , , , , hints] = params;
         let id;
 
+        if (replacesId !== 0 &&
+            (this._notifications.has(replacesId) || this._pendingNotifications.has(replacesId))) {
+            id = replacesId;
+        } else {
+            id = this._nextNotificationId++;
+
+            const sender = hints['x-shell-sender']?.deepUnpack() ?? appName;
+            if (!this._takeNotificationToken(sender)) {
+                invocation.return_value(GLib.Variant.new('(u)', [id]));
+                this._emitNotificationClosed(id, NotificationClosedReason.UNDEFINED);
+                return;
+            }
+        }
+
+        // Replaces any update of the notification that wasn't processed yet
+        this._pendingNotifications.set(id, params);
+        this._queueProcessNotifications();
+
+        return invocation.return_value(GLib.Variant.new('(u)', [id]));
+    }
+
+    _processNotification(id, params) {
+        let [appName, replacesId_, appIcon, summary, body, actions, hints, timeout_] = params;
+
         for (let hint in hints) {
             // unpack the variants
             hints[hint] = hints[hint].deepUnpack();
@@ -160,17 +252,15 @@ class FdoNotificationDaemon {
         }
 
         let source, notification;
-        if (replacesId !== 0 && this._notifications.has(replacesId)) {
-            notification = this._notifications.get(replacesId);
+        if (this._notifications.has(id)) {
+            notification = this._notifications.get(id);
             source = notification.source;
-            id = replacesId;
         } else {
             const sender = hints['x-shell-sender'];
             const pid = hints['x-shell-sender-pid'];
             const appId = hints['desktop-entry'];
             const app = this._getApp(pid, appId, appName);
 
-            id = this._nextNotificationId++;
             source = app
                 ? this._getSourceForApp(sender, app)
                 : this._getSourceForPidAndName(sender, pid, appName);
@@ -261,11 +351,15 @@ class FdoNotificationDaemon {
         // Only fallback to 'app-icon' when the source doesn't have a valid app
         const sourceGIcon = source.app ? null : this._iconForNotificationData(appIcon);
         source.processNotification(notification, appName, sourceGIcon);
-
-        return invocation.return_value(GLib.Variant.new('(u)', [id]));
     }
 
     CloseNotification(id) {
+        // Notifications that were never shown are closed right away
+        if (this._pendingNotifications.delete(id) && !this._notifications.has(id)) {
+            this._emitNotificationClosed(id, NotificationClosedReason.APP_CLOSED);
+            return;
+        }
+
         const notification = this._notifications.get(id);
         notification?.destroy(MessageTray.NotificationDestroyedReason.SOURCE_CLOSED);
     }
@@ -2,7 +2,6 @@
 
 import GLib from 'gi://GLib';
 import Clutter from 'gi://Clutter';
-import Gio from 'gi://Gio';
 import GObject from 'gi://GObject';
 import Meta from 'gi://Meta';
 import Shell from 'gi://Shell';
@@ -413,7 +412,7 @@ class ControlsManager extends St.Widget {
                 },
             });
 
-        this._a11ySettings = new Gio.Settings({schema_id: A11Y_SCHEMA});
+        this._a11ySettings = global.get_schema_settings(A11Y_SCHEMA);
 
         this._lastOverlayKeyTime = 0;
         global.display.connect('overlay-key', () => {
@@ -474,19 +473,19 @@ class ControlsManager extends St.Widget {
 
         Main.wm.addKeybinding(
             'toggle-application-view',
-            new Gio.Settings({schema_id: WindowManager.SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(WindowManager.SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._toggleAppsPage.bind(this));
 
         Main.wm.addKeybinding('shift-overview-up',
-            new Gio.Settings({schema_id: WindowManager.SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(WindowManager.SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             () => this._shiftState(Meta.MotionDirection.UP));
 
         Main.wm.addKeybinding('shift-overview-down',
-            new Gio.Settings({schema_id: WindowManager.SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(WindowManager.SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             () => this._shiftState(Meta.MotionDirection.DOWN));
@@ -1,13 +1,9 @@
 // -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
 
-import GLib from 'gi://GLib';
-
-// We stop polling if the user is idle for more than this amount of time
-const IDLE_TIME = 1000;
-
 // This file implements a reasonably efficient system for tracking the position
-// of the mouse pointer. We simply query the pointer from the X server in a loop,
-// but we turn off the polling when the user is idle.
+// of the mouse pointer. The shell emits pointer motion as the cursor tracker
+// sees it, at most as often as the watches need, and not at all while the
+// pointer doesn't move.
 
 let _pointerWatcher = null;
 
@@ -38,18 +34,17 @@ class PointerWatch {
 
 class PointerWatcher {
     constructor() {
-        this._idleMonitor = global.backend.get_core_idle_monitor();
-        this._idleMonitor.add_idle_watch(IDLE_TIME, this._onIdleMonitorBecameIdle.bind(this));
-        this._idle = this._idleMonitor.get_idletime() > IDLE_TIME;
+        global.connect('pointer-motion',
+            (_global, x, y) => this._onPointerMotion(x, y));
         this._watches = [];
         this.pointerX = null;
         this.pointerY = null;
     }
 
     // addWatch:
-    // @interval: hint as to the time resolution needed. When the user is
-    //   not idle, the position of the pointer will be queried at least
-    //   once every this many milliseconds.
+    // @interval: hint as to the time resolution needed. While the pointer
+    //   moves, its position will be reported no later than this many
+    //   milliseconds after it changed.
     // @callback to call when the pointer position changes - takes
     //   two arguments, X and Y.
     //
@@ -61,7 +56,7 @@ class PointerWatcher {
 
         let watch = new PointerWatch(this, interval, callback);
         this._watches.push(watch);
-        this._updateTimeout();
+        this._updateInterval();
         return watch;
     }
 
@@ -69,49 +64,32 @@ class PointerWatcher {
         for (let i = 0; i < this._watches.length; i++) {
             if (this._watches[i] === watch) {
                 this._watches.splice(i, 1);
-                this._updateTimeout();
+                this._updateInterval();
                 return;
             }
         }
     }
 
-    _onIdleMonitorBecameActive() {
-        this._idle = false;
-        this._updatePointer();
-        this._updateTimeout();
-    }
-
-    _onIdleMonitorBecameIdle() {
-        this._idle = true;
-        this._idleMonitor.add_user_active_watch(this._onIdleMonitorBecameActive.bind(this));
-        this._updateTimeout();
-    }
-
-    _updateTimeout() {
-        if (this._timeoutId) {
-            GLib.source_remove(this._timeoutId);
-            this._timeoutId = 0;
-        }
-
-        if (this._idle || this._watches.length === 0)
+    _updateInterval() {
+        if (this._watches.length === 0) {
+            global.set_pointer_watch_interval(0);
             return;
+        }
 
         let minInterval = this._watches[0].interval;
         for (let i = 1; i < this._watches.length; i++)
             minInterval = Math.min(this._watches[i].interval, minInterval);
 
-        this._timeoutId = GLib.timeout_add(GLib.PRIORITY_DEFAULT, minInterval,
-            this._onTimeout.bind(this));
-        GLib.Source.set_name_by_id(this._timeoutId, '[gnome-shell] this._onTimeout');
-    }
-
-    _onTimeout() {
-        this._updatePointer();
-        return GLib.SOURCE_CONTINUE;
+        // An interval of 0 would stop the shell from watching
+        global.set_pointer_watch_interval(Math.max(minInterval, 1));
     }
 
     _updatePointer() {
         let [x, y] = global.get_pointer();
+        this._onPointerMotion(x, y);
+    }
+
+    _onPointerMotion(x, y) {
         if (this.pointerX === x && this.pointerY === y)
             return;
 
@@ -10,6 +10,19 @@ import * as FileUtils from '../misc/fileUtils.js';
 
 const KEY_FILE_GROUP = 'Shell Search Provider';
 
+// Calls to a provider fail after this long, so that a slow provider
+// doesn't keep the search in progress for the default 25 seconds
+const PROVIDER_CALL_TIMEOUT = 5000; // ms
+
+// Result metas are kept this long, so that results that stay while
+// typing aren't asked for again
+const RESULT_META_TTL = 5 * 60 * GLib.USEC_PER_SEC;
+const MAX_CACHED_RESULT_METAS = 256;
+
+// The metas of the first results of a result set are asked for right
+// away, as the results view shows at least that many
+const PREFETCHED_RESULT_METAS = 5;
+
 const SearchProviderIface = `
 <node>
 <interface name="org.gnome.Shell.SearchProvider">
@@ -209,6 +222,7 @@ class RemoteSearchProvider {
             g_object_path: dbusPath,
             g_interface_info: proxyInfo,
             g_interface_name: proxyInfo.name,
+            g_default_timeout: PROVIDER_CALL_TIMEOUT,
             gFlags,
         });
         this.proxy.init_async(GLib.PRIORITY_DEFAULT, null);
@@ -217,6 +231,11 @@ class RemoteSearchProvider {
         this.id = appInfo.get_id();
         this.isRemoteProvider = true;
         this.canLaunchSearch = false;
+
+        // Unpacked metas and the time they were received, by result ID
+        this._metas = new Map();
+        // Promises of metas being received, by result ID
+        this._pendingMetas = new Map();
     }
 
     createIcon(size, meta) {
@@ -259,6 +278,7 @@ class RemoteSearchProvider {
     async getInitialResultSet(terms, cancellable) {
         try {
             const [results] = await this.proxy.GetInitialResultSetAsync(terms, cancellable);
+            this._prefetchResultMetas(results, cancellable);
             return results;
         } catch (error) {
             if (!error.matches(Gio.IOErrorEnum, Gio.IOErrorEnum.CANCELLED))
@@ -270,6 +290,7 @@ class RemoteSearchProvider {
     async getSubsearchResultSet(previousResults, newTerms, cancellable) {
         try {
             const [results] = await this.proxy.GetSubsearchResultSetAsync(previousResults, newTerms, cancellable);
+            this._prefetchResultMetas(results, cancellable);
             return results;
         } catch (error) {
             if (!error.matches(Gio.IOErrorEnum, Gio.IOErrorEnum.CANCELLED))
@@ -278,33 +299,103 @@ class RemoteSearchProvider {
         }
     }
 
-    async getResultMetas(ids, cancellable) {
-        let metas;
-        try {
-            [metas] = await this.proxy.GetResultMetasAsync(ids, cancellable);
-        } catch (error) {
-            if (!error.matches(Gio.IOErrorEnum, Gio.IOErrorEnum.CANCELLED))
-                log(`Received error from D-Bus search provider ${this.id} during GetResultMetas: ${error}`);
-            return [];
+    _getCachedMeta(id) {
+        const cached = this._metas.get(id);
+        if (!cached)
+            return null;
+
+        if (GLib.get_monotonic_time() - cached.time > RESULT_META_TTL) {
+            this._metas.delete(id);
+            return null;
         }
 
-        let resultMetas = [];
-        for (let i = 0; i < metas.length; i++) {
-            for (let prop in metas[i]) {
+        return cached.meta;
+    }
+
+    _cacheMetas(metas) {
+        const time = GLib.get_monotonic_time();
+
+        for (const meta of metas) {
+            this._metas.delete(meta['id']);
+            this._metas.set(meta['id'], {meta, time});
+        }
+
+        // Maps iterate in insertion order, so the oldest metas go first
+        for (const id of this._metas.keys()) {
+            if (this._metas.size <= MAX_CACHED_RESULT_METAS)
+                break;
+            this._metas.delete(id);
+        }
+    }
+
+    async _requestMetas(ids, cancellable) {
+        let [metas] = await this.proxy.GetResultMetasAsync(ids, cancellable);
+
+        for (const meta of metas) {
+            for (let prop in meta) {
                 // we can use the serialized icon variant directly
                 if (prop !== 'icon')
-                    metas[i][prop] = metas[i][prop].deepUnpack();
+                    meta[prop] = meta[prop].deepUnpack();
             }
+        }
+
+        if (metas.length === ids.length)
+            this._cacheMetas(metas);
+        return metas;
+    }
+
+    _prefetchResultMetas(results, cancellable) {
+        const ids = this.filterResults(results, PREFETCHED_RESULT_METAS).filter(
+            id => !this._pendingMetas.has(id) && !this._getCachedMeta(id));
+        if (ids.length === 0)
+            return;
 
-            resultMetas.push({
-                id: metas[i]['id'],
-                name: metas[i]['name'],
-                description: metas[i]['description'],
-                createIcon: size => this.createIcon(size, metas[i]),
-                clipboardText: metas[i]['clipboardText'],
+        // Failed prefetches are asked for again by getResultMetas()
+        const promise = this._requestMetas(ids, cancellable).catch(() => {});
+        ids.forEach(id => this._pendingMetas.set(id, promise));
+        promise.finally(() => {
+            ids.forEach(id => {
+                if (this._pendingMetas.get(id) === promise)
+                    this._pendingMetas.delete(id);
             });
+        });
+    }
+
+    async getResultMetas(ids, cancellable) {
+        const pending = new Set(ids.map(id => this._pendingMetas.get(id)));
+        pending.delete(undefined);
+        await Promise.all(pending);
+
+        if (cancellable?.is_cancelled())
+            return [];
+
+        const missingIds = ids.filter(id => !this._getCachedMeta(id));
+        if (missingIds.length > 0) {
+            try {
+                const metas = await this._requestMetas(missingIds, cancellable);
+                if (metas.length !== missingIds.length)
+                    return [];
+            } catch (error) {
+                if (!error.matches(Gio.IOErrorEnum, Gio.IOErrorEnum.CANCELLED))
+                    log(`Received error from D-Bus search provider ${this.id} during GetResultMetas: ${error}`);
+                return [];
+            }
         }
-        return resultMetas;
+
+        const metas = ids.map(id => this._getCachedMeta(id));
+        // Providers are expected to answer with the metas of the IDs asked for
+        if (metas.includes(null))
+            return [];
+
+        return metas.map(meta => {
+            return {
+                id: meta['id'],
+                name: meta['name'],
+                description: meta['description'],
+                createIcon: size => this.createIcon(size, meta),
+                clipboardText: meta['clipboardText'],
+            };
+        });
     }
 
     activateResult(id) {
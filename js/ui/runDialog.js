@@ -40,7 +40,7 @@ class RunDialog extends ModalDialog.ModalDialog {
         this._enableInternalCommands = global.settings.get_boolean('development-tools');
 
         this._internalCommands = {
-            'lg': () => Main.createLookingGlass().open(),
+            'lg': async () => (await Main.createLookingGlass()).open(),
 
             'r': this._restart.bind(this),
 
@@ -114,6 +114,9 @@ export class ScreenShield extends Signals.EventEmitter {
         this._lockSettings = new Gio.Settings({schema_id: LOCKDOWN_SCHEMA});
         this._lockSettings.connect(`changed::${DISABLE_LOCK_KEY}`, this._syncInhibitor.bind(this));
 
+        this._dialog = null;
+        this._dialogOpen = false;
+
         this._isModal = false;
         this._isGreeter = false;
         this._isActive = false;
@@ -426,7 +429,14 @@ export class ScreenShield extends Signals.EventEmitter {
             }
 
             this._dialog = new constructor(this._lockDialogGroup);
+            this._dialogOpen = false;
+
+            this._dialog.connect('failed', this._onUnlockFailed.bind(this));
+            this._wakeUpScreenId = this._dialog.connect(
+                'wake-up-screen', this._wakeUpScreen.bind(this));
+        }
 
+        if (!this._dialogOpen) {
             if (!this._dialog.open()) {
                 // This is kind of an impossible error: we're already modal
                 // by the time we reach this...
@@ -435,9 +445,7 @@ export class ScreenShield extends Signals.EventEmitter {
                 return false;
             }
 
-            this._dialog.connect('failed', this._onUnlockFailed.bind(this));
-            this._wakeUpScreenId = this._dialog.connect(
-                'wake-up-screen', this._wakeUpScreen.bind(this));
+            this._dialogOpen = true;
         }
 
         this._dialog.allowCancel = allowCancel;
@@ -578,9 +586,12 @@ export class ScreenShield extends Signals.EventEmitter {
     }
 
     _completeDeactivate() {
-        if (this._dialog) {
-            this._dialog.destroy();
-            this._dialog = null;
+        // The dialog is kept for the next lock, together with the blurred
+        // backgrounds it painted; those are only blurred again once the
+        // wallpaper or the monitors change
+        if (this._dialogOpen) {
+            this._dialog.close();
+            this._dialogOpen = false;
         }
 
         this.actor.hide();
@@ -22,6 +22,7 @@ Gio._promisify(Shell.Screenshot.prototype, 'pick_color');
 Gio._promisify(Shell.Screenshot.prototype, 'screenshot');
 Gio._promisify(Shell.Screenshot.prototype, 'screenshot_window');
 Gio._promisify(Shell.Screenshot.prototype, 'screenshot_area');
+Gio._promisify(Shell.Screenshot.prototype, 'screenshot_raw');
 Gio._promisify(Shell.Screenshot.prototype, 'screenshot_stage_to_content');
 Gio._promisify(Shell.Screenshot, 'composite_to_stream');
 
@@ -34,6 +35,15 @@ const ScreenshotIface = loadInterfaceXML('org.gnome.Shell.Screenshot');
 const ScreencastIface = loadInterfaceXML('org.gnome.Shell.Screencast');
 const ScreencastProxy = Gio.DBusProxy.makeProxyWrapper(ScreencastIface);
 
+// Raw screenshots hold premultiplied 32-bit ARGB pixels in native byte
+// order, which is DRM_FORMAT_ARGB8888 on little endian machines and
+// DRM_FORMAT_BGRA8888 on big endian ones
+const DRM_FORMAT_ARGB8888 = 0x34325241;
+const DRM_FORMAT_BGRA8888 = 0x34324142;
+const RAW_SCREENSHOT_FORMAT =
+    new Uint8Array(new Uint32Array([1]).buffer)[0] === 1
+        ? DRM_FORMAT_ARGB8888 : DRM_FORMAT_BGRA8888;
+
 const IconLabelButton = GObject.registerClass(
 class IconLabelButton extends St.Button {
     _init(iconName, label, params) {
@@ -1405,7 +1415,7 @@ export const ScreenshotUI = GObject.registerClass({
 
         Main.wm.addKeybinding(
             'show-screenshot-ui',
-            new Gio.Settings({schema_id: 'org.gnome.shell.keybindings'}),
+            global.get_schema_settings('org.gnome.shell.keybindings'),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             uiModes,
             showScreenshotUI
@@ -1413,7 +1423,7 @@ export const ScreenshotUI = GObject.registerClass({
 
         Main.wm.addKeybinding(
             'show-screen-recording-ui',
-            new Gio.Settings({schema_id: 'org.gnome.shell.keybindings'}),
+            global.get_schema_settings('org.gnome.shell.keybindings'),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             restrictedModes,
             showScreenRecordingUI
@@ -1421,7 +1431,7 @@ export const ScreenshotUI = GObject.registerClass({
 
         Main.wm.addKeybinding(
             'screenshot-window',
-            new Gio.Settings({schema_id: 'org.gnome.shell.keybindings'}),
+            global.get_schema_settings('org.gnome.shell.keybindings'),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT | Meta.KeyBindingFlags.PER_WINDOW,
             restrictedModes,
             async (_display, window, _binding) => {
@@ -1439,7 +1449,7 @@ export const ScreenshotUI = GObject.registerClass({
 
         Main.wm.addKeybinding(
             'screenshot',
-            new Gio.Settings({schema_id: 'org.gnome.shell.keybindings'}),
+            global.get_schema_settings('org.gnome.shell.keybindings'),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             uiModes,
             async () => {
@@ -2209,9 +2219,9 @@ export const ScreenshotUI = GObject.registerClass({
  * notification.
  *
  * @param {GLib.Bytes} bytes - The PNG-encoded screenshot.
- * @param {GdkPixbuf.Pixbuf} pixbuf - The Pixbuf with the screenshot.
+ * @param {St.ImageContent} [preview] - A downscaled preview of the screenshot.
  */
-function _storeScreenshot(bytes, pixbuf) {
+function _storeScreenshot(bytes, preview) {
     // Store to the clipboard first in case storing to file fails.
     const clipboard = St.Clipboard.get_default();
     clipboard.set_content(St.ClipboardType.CLIPBOARD, 'image/png', bytes);
@@ -2309,20 +2319,6 @@ function _storeScreenshot(bytes, pixbuf) {
         saveRecentFile(file);
     }
 
-    // Create a St.ImageContent icon for the notification. We want
-    // St.ImageContent specifically because it preserves the aspect ratio when
-    // shown in a notification.
-    const pixels = pixbuf.read_pixel_bytes();
-    const content =
-        St.ImageContent.new_with_preferred_size(pixbuf.width, pixbuf.height);
-    content.set_bytes(
-        pixels,
-        Cogl.PixelFormat.RGBA_8888,
-        pixbuf.width,
-        pixbuf.height,
-        pixbuf.rowstride
-    );
-
     // Show a notification.
     const source = new MessageTray.Source({
         // Translators: notification source name.
@@ -2336,7 +2332,9 @@ function _storeScreenshot(bytes, pixbuf) {
         // Translators: notification body when a screenshot was captured.
         body: _('You can paste the image from the clipboard.'),
         datetime: time,
-        gicon: content,
+        // The preview is a St.ImageContent, which preserves its aspect
+        // ratio when shown in a notification
+        gicon: preview,
         isTransient: true,
     });
 
@@ -2392,7 +2390,7 @@ export async function captureScreenshot(texture, geometry, scale, cursor) {
     global.display.get_sound_player().play_from_theme(
         'screen-capture', _('Screenshot taken'), null);
 
-    const pixbuf = await Shell.Screenshot.composite_to_stream(
+    const [, preview] = await Shell.Screenshot.composite_to_stream(
         texture,
         x, y, w, h,
         scale,
@@ -2401,7 +2399,7 @@ export async function captureScreenshot(texture, geometry, scale, cursor) {
     );
 
     stream.close(null);
-    return _storeScreenshot(stream.steal_as_bytes(), pixbuf);
+    return _storeScreenshot(stream.steal_as_bytes(), preview);
 }
 
 /**
@@ -2670,6 +2668,57 @@ export class ScreenshotService {
         }
     }
 
+    async ScreenshotRawAsync(params, invocation) {
+        const [options] = params;
+        for (const option in options)
+            options[option] = options[option].deepUnpack();
+
+        const {
+            'include-cursor': includeCursor = false,
+            'flash': flash = false,
+        } = options;
+
+        let area = null;
+        if (options['area'] !== undefined) {
+            const [x, y, width, height] = this._scaleArea(...options['area']);
+            if (!this._checkArea(x, y, width, height)) {
+                invocation.return_error_literal(
+                    Gio.IOErrorEnum,
+                    Gio.IOErrorEnum.CANCELLED,
+                    'Invalid params');
+                return;
+            }
+            area = new Mtk.Rectangle({x, y, width, height});
+        }
+
+        const screenshot = await this._createScreenshot(invocation);
+        if (!screenshot)
+            return;
+
+        try {
+            const [, [fd, width, height, stride, grabbed]] = await Promise.all([
+                flash ? this._flashAsync(screenshot) : null,
+                screenshot.screenshot_raw(includeCursor, area),
+            ]);
+
+            const metadata = {
+                'width': new GLib.Variant('i', width),
+                'height': new GLib.Variant('i', height),
+                'stride': new GLib.Variant('i', stride),
+                'format': new GLib.Variant('u', RAW_SCREENSHOT_FORMAT),
+                'area': new GLib.Variant('(iiii)', this._unscaleArea(
+                    grabbed.x, grabbed.y, grabbed.width, grabbed.height)),
+            };
+            invocation.return_value_with_unix_fd_list(
+                new GLib.Variant('(ha{sv})', [0, metadata]),
+                Gio.UnixFDList.new_from_array([fd]));
+        } catch (e) {
+            invocation.return_gerror(e);
+        } finally {
+            this._removeShooterForSender(invocation.get_sender());
+        }
+    }
+
     async InteractiveScreenshotAsync(params, invocation) {
         try {
             await this._senderChecker.checkInvocation(invocation);
@@ -2742,23 +2791,47 @@ export class ScreenshotService {
         invocation.return_value(null);
     }
 
-    async PickColorAsync(params, invocation) {
+    _colorToVariant(color) {
+        const {red, green, blue} = color;
+        return GLib.Variant.new('(a{sv})', [{
+            color: GLib.Variant.new('(ddd)', [
+                red / 255.0,
+                green / 255.0,
+                blue / 255.0,
+            ]),
+        }]);
+    }
+
+    PickColorAsync(params, invocation) {
+        return this._pickColor(invocation, false);
+    }
+
+    PickColorContinuousAsync(params, invocation) {
+        return this._pickColor(invocation, true);
+    }
+
+    async _pickColor(invocation, continuous) {
         const screenshot = await this._createScreenshot(invocation, false, false);
         if (!screenshot)
             return;
 
         const pickPixel = new PickPixel(screenshot);
+        if (continuous) {
+            // Only the caller gets to see the colors under the pointer
+            const connection = invocation.get_connection();
+            const sender = invocation.get_sender();
+            pickPixel.connect('color-picked', (o, color) => {
+                connection.emit_signal(sender,
+                    '/org/gnome/Shell/Screenshot',
+                    'org.gnome.Shell.Screenshot',
+                    'ColorPicked',
+                    this._colorToVariant(color));
+            });
+        }
+
         try {
             const color = await pickPixel.pickAsync();
-            const {red, green, blue} = color;
-            const retval = GLib.Variant.new('(a{sv})', [{
-                color: GLib.Variant.new('(ddd)', [
-                    red / 255.0,
-                    green / 255.0,
-                    blue / 255.0,
-                ]),
-            }]);
-            invocation.return_value(retval);
+            invocation.return_value(this._colorToVariant(color));
         } catch (e) {
             invocation.return_error_literal(
                 Gio.IOErrorEnum, Gio.IOErrorEnum.CANCELLED,
@@ -3001,8 +3074,9 @@ const RecolorEffect = GObject.registerClass({
     }
 });
 
-export const PickPixel = GObject.registerClass(
-class PickPixel extends St.Widget {
+export const PickPixel = GObject.registerClass({
+    Signals: {'color-picked': {param_types: [Cogl.Color.$gtype]}},
+}, class PickPixel extends St.Widget {
     _init(screenshot) {
         super._init({visible: false, reactive: true});
 
@@ -3074,6 +3148,8 @@ class PickPixel extends St.Widget {
         if (this._inPick)
             return;
 
+        // With one pick in flight at a time, colors are picked at most
+        // once per frame as the pointer moves
         this._inPick = true;
         this._previewCursor.set_position(x, y);
         [this._color] = await this._screenshot.pick_color(x, y);
@@ -3082,6 +3158,7 @@ class PickPixel extends St.Widget {
         if (!this._color)
             return;
 
+        this.emit('color-picked', this._color);
         this._recolorEffect.color = this._color;
         this._previewCursor.show();
     }
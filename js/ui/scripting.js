@@ -119,6 +119,85 @@ export async function createTestWindow(params) {
         params.redraws, params.textInput).catch(logError);
 }
 
+let _testWindowSerial = 0;
+
+/**
+ * createTestWindows:
+ *
+ * @param {object[]} windows - options for each window, as for
+ *   createTestWindow(), and additionally:
+ * @param {number} [windows[].workspace] - index of the workspace to
+ *   move the window to
+ * @param {string} [windows[].appId] - application ID of the window;
+ *   it needs to be passed to the test tool with --extra-filter
+ * @param {string} [windows[].damage] - 'full' to repaint the whole
+ *   window, or 'partial' to repaint a small part of it, every frame
+ * @returns {Promise}
+ *
+ * Creates a batch of windows using gnome-shell-perf-helper with a single
+ * D-Bus call. Like createTestWindow(), use waitTestWindows() to wait
+ * until the windows have been mapped and exposed.
+ */
+export async function createTestWindows(windows) {
+    const workspaces = new Map();
+
+    const specs = windows.map(params => {
+        params = Params.parse(params, {
+            width: 640,
+            height: 480,
+            alpha: false,
+            maximized: false,
+            redraws: false,
+            textInput: false,
+            workspace: -1,
+            appId: '',
+            damage: '',
+        });
+
+        const options = {
+            'alpha': new GLib.Variant('b', params.alpha),
+            'maximized': new GLib.Variant('b', params.maximized),
+            'redraws': new GLib.Variant('b', params.redraws),
+            'text-input': new GLib.Variant('b', params.textInput),
+        };
+        if (params.appId)
+            options['app-id'] = new GLib.Variant('s', params.appId);
+        if (params.damage)
+            options['damage'] = new GLib.Variant('s', params.damage);
+
+        // The helper can't place windows itself, so recognize them
+        // by their title to move them once they show up
+        if (params.workspace >= 0) {
+            const title = `Test Window ${++_testWindowSerial}`;
+            options['title'] = new GLib.Variant('s', title);
+            workspaces.set(title, params.workspace);
+        }
+
+        return [params.width, params.height, options];
+    });
+
+    if (workspaces.size > 0) {
+        const workspaceManager = global.workspace_manager;
+        const lastWorkspace = Math.max(...workspaces.values());
+        while (workspaceManager.n_workspaces <= lastWorkspace)
+            workspaceManager.append_new_workspace(false, global.get_current_time());
+
+        const id = global.display.connect('window-created', (display, window) => {
+            const workspace = workspaces.get(window.title);
+            if (workspace === undefined)
+                return;
+
+            window.change_workspace_by_index(workspace, false);
+            workspaces.delete(window.title);
+            if (workspaces.size === 0)
+                global.display.disconnect(id);
+        });
+    }
+
+    let perfHelper = await _getPerfHelper();
+    perfHelper.CreateWindowsAsync(specs).catch(logError);
+}
+
 /**
  * waitTestWindows:
  *
@@ -213,6 +292,18 @@ function _collect(scriptModule, outputFile) {
     if ('finish' in scriptModule)
         scriptModule.finish();
 
+    const traceFile = GLib.getenv('SHELL_PERF_TRACE');
+    if (traceFile) {
+        let f = Gio.file_new_for_path(traceFile);
+        let raw = f.replace(null,
+            false,
+            Gio.FileCreateFlags.NONE,
+            null);
+        let out = Gio.BufferedOutputStream.new_sized(raw, 4096);
+        Shell.PerfLog.get_default().dump_trace(out);
+        out.close(null);
+    }
+
     if (outputFile) {
         let f = Gio.file_new_for_path(outputFile);
         let raw = f.replace(null,
@@ -351,7 +442,9 @@ async function _runPerfScript(scriptModule, outputFile) {
  *  value: computed value of the metric
  *
  * The resulting metrics will be written to `outputFile` as JSON, or,
- * if `outputFile` is not provided, logged.
+ * if `outputFile` is not provided, logged. If SHELL_PERF_TRACE is set
+ * in the environment, the event log is also written to the file it
+ * names in the Trace Event format, for Perfetto or Sysprof.
  *
  * After running the script and collecting statistics from the
  * event log, GNOME Shell will exit.
@@ -174,6 +174,7 @@ const SearchResultsBase = GObject.registerClass({
         this.add_child(separator);
 
         this._resultDisplays = {};
+        this._displayedResults = [];
 
         this._cancellable = new Gio.Cancellable();
 
@@ -196,10 +197,16 @@ const SearchResultsBase = GObject.registerClass({
         for (let resultId in this._resultDisplays)
             this._resultDisplays[resultId].destroy();
         this._resultDisplays = {};
+        this._displayedResults = [];
         this._clearResultDisplay();
         this.hide();
     }
 
+    _isDisplayingResults(results) {
+        return results.length === this._displayedResults.length &&
+            results.every((resultId, i) => resultId === this._displayedResults[i]);
+    }
+
     get focusChild() {
         return this._focusChild;
     }
@@ -250,6 +257,7 @@ const SearchResultsBase = GObject.registerClass({
     async updateSearch(providerResults, terms, callback) {
         this._terms = terms;
         if (providerResults.length === 0) {
+            this._displayedResults = [];
             this._clearResultDisplay();
             this.hide();
             callback();
@@ -263,17 +271,23 @@ const SearchResultsBase = GObject.registerClass({
             try {
                 await this._ensureResultActors(results);
 
-                // To avoid CSS transitions causing flickering when
-                // the first search result stays the same, we hide the
-                // content while filling in the results.
-                this.hide();
-                this._clearResultDisplay();
-                results.forEach(
-                    resultId => this._addItem(this._resultDisplays[resultId]));
+                // Typing often leaves the top results as they are, in
+                // which case the displayed results are kept untouched
+                if (!this._isDisplayingResults(results)) {
+                    // To avoid CSS transitions causing flickering when
+                    // the first search result stays the same, we hide the
+                    // content while filling in the results.
+                    this.hide();
+                    this._clearResultDisplay();
+                    results.forEach(
+                        resultId => this._addItem(this._resultDisplays[resultId]));
+                    this._displayedResults = results;
+                }
                 this._setMoreCount(this.provider.canLaunchSearch ? moreCount : 0);
                 this.show();
                 callback();
             } catch (e) {
+                this._displayedResults = [];
                 this._clearResultDisplay();
                 callback();
             }
@@ -670,11 +684,13 @@ export const SearchResultsView = GObject.registerClass({
         this._clearSearchTimeout();
         this._defaultResult = null;
         this._startingSearch = false;
+        this._providers.forEach(provider => (provider.searchInProgress = false));
 
         this._updateSearchProgress();
     }
 
     async _doProviderSearch(provider, previousResults) {
+        const cancellable = this._cancellable;
         provider.searchInProgress = true;
 
         let results;
@@ -682,13 +698,18 @@ export const SearchResultsView = GObject.registerClass({
             results = await provider.getSubsearchResultSet(
                 previousResults,
                 this._terms,
-                this._cancellable);
+                cancellable);
         } else {
             results = await provider.getInitialResultSet(
                 this._terms,
-                this._cancellable);
+                cancellable);
         }
 
+        // Results of a search that the terms changed under are stale,
+        // whether or not the provider honored the cancellation
+        if (cancellable.is_cancelled())
+            return;
+
         this._results[provider.id] = results;
         this._updateResults(provider, results);
     }
@@ -727,8 +748,10 @@ export const SearchResultsView = GObject.registerClass({
 
         this._startingSearch = true;
 
+        // Every search gets its own cancellable, so that the calls of
+        // previous searches still know that they are canceled
         this._cancellable.cancel();
-        this._cancellable.reset();
+        this._cancellable = new Gio.Cancellable();
 
         if (terms.length === 0) {
             this._reset();
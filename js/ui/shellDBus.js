@@ -272,6 +272,30 @@ export class GnomeShell {
         invocation.return_value(null);
     }
 
+    /**
+     * Get where the time of recent frames went, as documented for
+     * shell_global_get_frame_stats(). The first call starts recording.
+     *
+     * @param {...any} params - method parameters
+     * @param {Gio.DBusMethodInvocation} invocation - the invocation
+     * @returns {void}
+     */
+    GetFrameStatsAsync(params, invocation) {
+        // Frame timings reveal what the user is doing
+        if (!global.context.unsafe_mode) {
+            invocation.return_error_literal(
+                Gio.DBusError,
+                Gio.DBusError.ACCESS_DENIED,
+                'GetFrameStats is only available in unsafe mode');
+            return;
+        }
+
+        global.frame_stats = true;
+
+        const frames = global.get_frame_stats();
+        invocation.return_value(GLib.Variant.new_tuple([frames]));
+    }
+
     _emitAcceleratorActivated(action, device, timestamp) {
         let destination = this._grabbedAccelerators.get(action);
         if (!destination)
@@ -457,6 +481,14 @@ class GnomeShellExtensions {
         return Main.extensionManager.disableExtension(uuid);
     }
 
+    EnableExtensions(uuids) {
+        return Main.extensionManager.enableExtensions(uuids);
+    }
+
+    DisableExtensions(uuids) {
+        return Main.extensionManager.disableExtensions(uuids);
+    }
+
     LaunchExtensionPrefs(uuid) {
         this.OpenExtensionPrefs(uuid, '', {});
     }
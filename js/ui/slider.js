@@ -41,42 +41,6 @@ export const Slider = GObject.registerClass({
         this._handleRadius = themeNode.get_length('-slider-handle-radius');
     }
 
-    vfunc_repaint() {
-        super.vfunc_repaint();
-
-        // Add handle
-        let cr = this.get_context();
-        let themeNode = this.get_theme_node();
-        let [width, height] = this.get_surface_size();
-        const rtl = this.get_text_direction() === Clutter.TextDirection.RTL;
-
-        const ceiledHandleRadius = Math.ceil(this._handleRadius);
-        const handleY = height / 2;
-
-        let handleX = ceiledHandleRadius +
-            (width - 2 * ceiledHandleRadius) * this._value / this._maxValue;
-        if (rtl)
-            handleX = width - handleX;
-
-        let color = themeNode.get_foreground_color();
-        cr.setSourceColor(color);
-        cr.arc(handleX, handleY, this._handleRadius, 0, 2 * Math.PI);
-        cr.fillPreserve();
-        cr.$dispose();
-    }
-
-    _getPreferredHeight() {
-        const barHeight = super._getPreferredHeight();
-        const handleHeight = 2 * this._handleRadius;
-        return Math.max(barHeight, handleHeight);
-    }
-
-    _getPreferredWidth() {
-        const barWidth = super._getPreferredWidth();
-        const handleWidth = 2 * this._handleRadius;
-        return Math.max(barWidth, handleWidth);
-    }
-
     vfunc_button_press_event(event) {
         return this.startDragging(event);
     }
@@ -169,7 +133,7 @@ export const Slider = GObject.registerClass({
             delta = -dy * SLIDER_SCROLL_STEP;
         }
 
-        this.value = Math.min(Math.max(0, this._value + delta), this._maxValue);
+        this.value = Math.min(Math.max(0, this.value + delta), this.maximumValue);
 
         return Clutter.EVENT_STOP;
     }
@@ -196,7 +160,7 @@ export const Slider = GObject.registerClass({
         let key = event.get_key_symbol();
         if (key === Clutter.KEY_Right || key === Clutter.KEY_Left) {
             let delta = key === Clutter.KEY_Right ? 0.1 : -0.1;
-            this.value = Math.max(0, Math.min(this._value + delta, this._maxValue));
+            this.value = Math.max(0, Math.min(this.value + delta, this.maximumValue));
             return Clutter.EVENT_STOP;
         }
         return super.vfunc_key_press_event(event);
@@ -219,7 +183,7 @@ export const Slider = GObject.registerClass({
             newvalue = 1;
         else
             newvalue = (relX - this._handleRadius) / (width - 2 * this._handleRadius);
-        this.value = newvalue * this._maxValue;
+        this.value = newvalue * this.maximumValue;
     }
 
     _getMinimumIncrement() {
@@ -11,16 +11,16 @@ import St from 'gi://St';
 import {Spinner} from '../animation.js';
 import * as PopupMenu from '../popupMenu.js';
 import {QuickMenuToggle, SystemIndicator} from '../quickSettings.js';
+import {CoalescedUpdate} from '../../misc/util.js';
 
-import {loadInterfaceXML} from '../../misc/fileUtils.js';
+import {loadInterfaceInfo} from '../../misc/fileUtils.js';
 
 const {AdapterState} = GnomeBluetooth;
 
 const BUS_NAME = 'org.gnome.SettingsDaemon.Rfkill';
 const OBJECT_PATH = '/org/gnome/SettingsDaemon/Rfkill';
 
-const RfkillManagerInterface = loadInterfaceXML('org.gnome.SettingsDaemon.Rfkill');
-const rfkillManagerInfo = Gio.DBusInterfaceInfo.new_for_xml(RfkillManagerInterface);
+const rfkillManagerInfo = loadInterfaceInfo('org.gnome.SettingsDaemon.Rfkill');
 
 Gio._promisify(GnomeBluetooth.Client.prototype, 'connect_service');
 
@@ -289,6 +289,7 @@ class BluetoothToggle extends QuickMenuToggle {
             'gnome-bluetooth-panel.desktop');
 
         this._client = client;
+        this._syncUpdate = new CoalescedUpdate(this, () => this._sync());
 
         this._client.bind_property('available',
             this, 'visible',
@@ -304,7 +305,7 @@ class BluetoothToggle extends QuickMenuToggle {
 
         this._client.connectObject(
             'notify::active', () => this._onActiveChanged(),
-            'devices-changed', () => this._sync(),
+            'devices-changed', () => this._syncUpdate.queue(),
             'device-removed', (c, path) => this._removeDevice(path),
             this);
 
@@ -420,7 +421,8 @@ class Indicator extends SystemIndicator {
         super._init();
 
         this._client = new BtClient();
-        this._client.connect('devices-changed', () => this._sync());
+        this._syncUpdate = new CoalescedUpdate(this, () => this._sync());
+        this._client.connect('devices-changed', () => this._syncUpdate.queue());
 
         this._indicator = this._addIndicator();
         this._indicator.icon_name = 'bluetooth-active-symbolic';
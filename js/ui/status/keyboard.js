@@ -351,13 +351,13 @@ export class InputSourceManager extends Signals.EventEmitter {
         this._mruSourcesBackup = null;
         this._keybindingAction =
             Main.wm.addKeybinding('switch-input-source',
-                new Gio.Settings({schema_id: 'org.gnome.desktop.wm.keybindings'}),
+                global.get_schema_settings('org.gnome.desktop.wm.keybindings'),
                 Meta.KeyBindingFlags.NONE,
                 Shell.ActionMode.ALL,
                 this._switchInputSource.bind(this));
         this._keybindingActionBackward =
             Main.wm.addKeybinding('switch-input-source-backward',
-                new Gio.Settings({schema_id: 'org.gnome.desktop.wm.keybindings'}),
+                global.get_schema_settings('org.gnome.desktop.wm.keybindings'),
                 Meta.KeyBindingFlags.IS_REVERSED,
                 Shell.ActionMode.ALL,
                 this._switchInputSource.bind(this));
@@ -19,7 +19,7 @@ import * as Util from '../../misc/util.js';
 import {Spinner} from '../animation.js';
 import {QuickMenuToggle, SystemIndicator} from '../quickSettings.js';
 
-import {loadInterfaceXML} from '../../misc/fileUtils.js';
+import {loadInterfaceInfo} from '../../misc/fileUtils.js';
 import {registerDestroyableType} from '../../misc/signalTracker.js';
 
 Gio._promisify(Gio.DBusConnection.prototype, 'call');
@@ -40,8 +40,7 @@ const PortalHelperResult = {
     RECHECK: 2,
 };
 
-const PortalHelperIface = loadInterfaceXML('org.gnome.Shell.PortalHelper');
-const PortalHelperInfo = Gio.DBusInterfaceInfo.new_for_xml(PortalHelperIface);
+const PortalHelperInfo = loadInterfaceInfo('org.gnome.Shell.PortalHelper');
 
 function signalToIcon(value) {
     if (value < 20)
@@ -777,12 +776,13 @@ const WirelessNetwork = GObject.registerClass({
         this._name = '';
         this._ssid = null;
         this._bestAp = null;
+        this._strength = 0;
         this._mode = 0;
         this._securityType = NM.UtilsSecurityType.NONE;
     }
 
     get signal_strength() {
-        return this._bestAp?.strength ?? 0;
+        return this._strength;
     }
 
     get name() {
@@ -796,7 +796,7 @@ const WirelessNetwork = GObject.registerClass({
         if (!this._bestAp)
             return '';
 
-        return `network-wireless-signal-${signalToIcon(this._bestAp.strength)}-symbolic`;
+        return `network-wireless-signal-${signalToIcon(this._strength)}-symbolic`;
     }
 
     get secure() {
@@ -863,11 +863,8 @@ const WirelessNetwork = GObject.registerClass({
         this._accessPoints.add(ap);
 
         ap.connectObject(
-            'notify::strength', () => {
-                this.notify('icon-name');
-                this.notify('signal-strength');
-                this._updateBestAp();
-            }, this);
+            'notify::strength', () => this._apStrengthChanged(ap),
+            this);
         this._updateBestAp();
 
         if (wasActive !== this.is_active)
@@ -973,15 +970,34 @@ const WirelessNetwork = GObject.registerClass({
         return bestType ?? NM.UtilsSecurityType.INVALID;
     }
 
+    _apStrengthChanged(ap) {
+        // Only the strongest access point is shown, so the others don't
+        // matter until they get stronger than it
+        if (ap !== this._bestAp && ap.strength <= this._strength)
+            return;
+
+        this._updateBestAp();
+    }
+
     _updateBestAp() {
-        const [bestAp] =
-            [...this._accessPoints].sort((a, b) => b.strength - a.strength);
+        let bestAp = null;
+        for (const ap of this._accessPoints) {
+            if (!bestAp || ap.strength > bestAp.strength)
+                bestAp = ap;
+        }
 
-        if (this._bestAp === bestAp)
-            return;
+        const oldIconName = this.icon_name;
+        const oldStrength = this._strength;
 
         this._bestAp = bestAp;
-        this.notify('icon-name');
+        this._strength = bestAp?.strength ?? 0;
+
+        // Access points report strength changes all the time; only
+        // notify when it makes a difference to the network as a whole
+        if (this._strength !== oldStrength)
+            this.notify('signal-strength');
+        if (this.icon_name !== oldIconName)
+            this.notify('icon-name');
     }
 });
 registerDestroyableType(WirelessNetwork);
@@ -1014,20 +1030,25 @@ class NMWirelessNetworkItem extends PopupMenu.PopupBaseMenuItem {
         });
         this.add_child(this._selectedIcon);
 
-        this._network.bind_property('icon-name',
-            this._signalIcon, 'icon-name',
-            GObject.BindingFlags.SYNC_CREATE);
-        this._network.bind_property('name',
-            this._label, 'text',
-            GObject.BindingFlags.SYNC_CREATE);
-        this._network.bind_property('is-active',
-            this._selectedIcon, 'visible',
-            GObject.BindingFlags.SYNC_CREATE);
-        this._network.bind_property_full('secure',
-            this._secureIcon, 'icon-name',
-            GObject.BindingFlags.SYNC_CREATE,
-            (bind, source) => [true, source ? 'network-wireless-encrypted-symbolic' : ''],
-            null);
+        // Items come and go while the network stays around, so
+        // drop the bindings along with the item
+        const bindings = [
+            this._network.bind_property('icon-name',
+                this._signalIcon, 'icon-name',
+                GObject.BindingFlags.SYNC_CREATE),
+            this._network.bind_property('name',
+                this._label, 'text',
+                GObject.BindingFlags.SYNC_CREATE),
+            this._network.bind_property('is-active',
+                this._selectedIcon, 'visible',
+                GObject.BindingFlags.SYNC_CREATE),
+            this._network.bind_property_full('secure',
+                this._secureIcon, 'icon-name',
+                GObject.BindingFlags.SYNC_CREATE,
+                (bind, source) => [true, source ? 'network-wireless-encrypted-symbolic' : ''],
+                null),
+        ];
+        this.connect('destroy', () => bindings.forEach(b => b.unbind()));
         this._network.connectObject(
             'notify::is-active', () => this._isActiveChanged(),
             'notify::secure', () => this._updateAccessibleName(),
@@ -1072,10 +1093,19 @@ const NMWirelessDeviceItem = GObject.registerClass({
 
         this._deviceName = '';
 
-        this._networkItems = new Map();
-        this._itemSorter = new ItemSorter({
-            sortFunc: (one, two) => one.network.compare(two.network),
+        // All networks are tracked and sorted, but menu items only
+        // exist for the few that are shown, and only once the menu
+        // is mapped; there can be hundreds of access points around
+        this._networks = new Map();
+        this._networksBySsid = new Map();
+        this._apNetworks = new Map();
+        this._networkSorter = new ItemSorter({
+            sortFunc: (one, two) => one.compare(two),
         });
+        this._networksToResort = new Set();
+        this._networkItems = new Map();
+        this._syncUpdate = new Util.CoalescedUpdate(this,
+            () => this._syncItems(), {mappedOnly: true});
 
         this._client.connectObject(
             'notify::wireless-enabled', () => this.notify('icon-name'),
@@ -1088,21 +1118,16 @@ const NMWirelessDeviceItem = GObject.registerClass({
             'notify::active-connection', () => this._activeConnectionChanged(),
             'notify::available-connections', () => this._availableConnectionsChanged(),
             'state-changed', () => this.notify('is-hotspot'),
-            'access-point-added', (d, ap) => {
-                this._addAccessPoint(ap);
-                this._updateItemsVisibility();
-            },
-            'access-point-removed', (d, ap) => {
-                this._removeAccessPoint(ap);
-                this._updateItemsVisibility();
-            }, this);
+            'access-point-added', (d, ap) => this._addAccessPoint(ap),
+            'access-point-removed', (d, ap) => this._removeAccessPoint(ap),
+            this);
 
         this.bind_property('single-device-mode',
             this, 'use-submenu',
             GObject.BindingFlags.INVERT_BOOLEAN);
 
         Main.sessionMode.connectObject('updated',
-            () => this._updateItemsVisibility(),
+            () => this._syncUpdate.queue(),
             this);
 
         for (const ap of this._device.get_access_points())
@@ -1111,10 +1136,9 @@ const NMWirelessDeviceItem = GObject.registerClass({
         this._activeApChanged();
         this._activeConnectionChanged();
         this._availableConnectionsChanged();
-        this._updateItemsVisibility();
 
         this.connect('destroy', () => {
-            for (const net of this._networkItems.keys())
+            for (const net of this._networks.keys())
                 net.destroy();
         });
     }
@@ -1207,8 +1231,10 @@ const NMWirelessDeviceItem = GObject.registerClass({
 
     _availableConnectionsChanged() {
         const connections = this._device.get_available_connections();
-        for (const net of this._networkItems.keys())
+        for (const net of this._networks.keys()) {
             net.checkConnections(connections);
+            this._resortNetwork(net);
+        }
     }
 
     _addAccessPoint(ap) {
@@ -1224,62 +1250,114 @@ const NMWirelessDeviceItem = GObject.registerClass({
             return;
         }
 
-        let network = [...this._networkItems.keys()]
-            .find(n => n.checkAccessPoint(ap));
+        const ssidKey = NM.utils_ssid_to_utf8(ap.get_ssid().get_data());
+        let networks = this._networksBySsid.get(ssidKey);
+        if (!networks) {
+            networks = [];
+            this._networksBySsid.set(ssidKey, networks);
+        }
+
+        let network = networks.find(n => n.checkAccessPoint(ap));
 
         if (!network) {
             network = new WirelessNetwork(this._device);
-
-            const item = new NMWirelessNetworkItem(network);
-            item.connect('activate', () => network.activate());
+            if (!network.addAccessPoint(ap)) {
+                network.destroy();
+                return;
+            }
 
             network.connectObject(
-                'notify::icon-name', () => this._resortItem(item),
-                'notify::is-active', () => this._resortItem(item),
+                'notify::icon-name', () => this._resortNetwork(network),
+                'notify::is-active', () => this._resortNetwork(network),
                 this);
 
-            const pos = this._itemSorter.upsert(item);
-            this.section.addMenuItem(item, pos);
-            this._networkItems.set(network, item);
+            networks.push(network);
+            this._networks.set(network, ssidKey);
+            this._networkSorter.upsert(network);
+        } else {
+            network.addAccessPoint(ap);
         }
 
-        network.addAccessPoint(ap);
+        this._apNetworks.set(ap, network);
+        this._syncUpdate.queue();
     }
 
     _removeAccessPoint(ap) {
-        const network = [...this._networkItems.keys()]
-            .find(n => n.removeAccessPoint(ap));
+        // Access points without SSID were never added
+        ap.disconnectObject(this);
 
-        if (!network || network.hasAccessPoints())
+        const network = this._apNetworks.get(ap);
+        if (!network)
             return;
 
-        const item = this._networkItems.get(network);
-        this._itemSorter.delete(item);
-        this._networkItems.delete(network);
+        this._apNetworks.delete(ap);
+        network.removeAccessPoint(ap);
+
+        if (network.hasAccessPoints()) {
+            this._syncUpdate.queue();
+            return;
+        }
+
+        const ssidKey = this._networks.get(network);
+        const networks = this._networksBySsid.get(ssidKey);
+        networks.splice(networks.indexOf(network), 1);
+        if (networks.length === 0)
+            this._networksBySsid.delete(ssidKey);
 
-        item?.destroy();
+        this._networks.delete(network);
+        this._networksToResort.delete(network);
+        this._networkSorter.delete(network);
+
+        this._networkItems.get(network)?.destroy();
+        this._networkItems.delete(network);
         network.destroy();
-    }
 
-    _resortItem(item) {
-        const pos = this._itemSorter.upsert(item);
-        this.section.moveMenuItem(item, pos);
+        this._syncUpdate.queue();
+    }
 
-        this._updateItemsVisibility();
+    _resortNetwork(network) {
+        // Signal strengths change all the time, so the networks are only
+        // sorted again once per frame, and not while they aren't shown
+        this._networksToResort.add(network);
+        this._syncUpdate.queue();
     }
 
-    _updateItemsVisibility() {
+    _syncItems() {
+        for (const network of this._networksToResort)
+            this._networkSorter.upsert(network);
+        this._networksToResort.clear();
+
         const {hasWindows} = Main.sessionMode;
 
-        let nVisible = 0;
-        for (const item of this._itemSorter) {
-            const {network: net} = item;
-            item.visible =
-                (hasWindows || net.hasConnections() || net.canAutoconnect()) &&
-                nVisible < MAX_VISIBLE_NETWORKS;
-            if (item.visible)
-                nVisible++;
+        const visible = [];
+        for (const net of this._networkSorter) {
+            if (visible.length === MAX_VISIBLE_NETWORKS)
+                break;
+
+            if (hasWindows || net.hasConnections() || net.canAutoconnect())
+                visible.push(net);
         }
+
+        for (const [net, item] of this._networkItems) {
+            if (visible.includes(net))
+                continue;
+
+            item.destroy();
+            this._networkItems.delete(net);
+        }
+
+        visible.forEach((net, pos) => {
+            let item = this._networkItems.get(net);
+            if (item) {
+                this.section.moveMenuItem(item, pos);
+                return;
+            }
+
+            item = new NMWirelessNetworkItem(net);
+            item.connect('activate', () => net.activate());
+            this.section.addMenuItem(item, pos);
+            this._networkItems.set(net, item);
+        });
     }
 
     setDeviceName(name) {
@@ -1950,6 +2028,7 @@ class Indicator extends SystemIndicator {
         super._init();
 
         this._connectivityQueue = new Set();
+        this._prewarmedConnection = null;
 
         this._mainConnection = null;
 
@@ -2113,14 +2192,48 @@ class Indicator extends SystemIndicator {
         // (but in general we should only prompt a portal if we know there is a portal)
         if (GLib.getenv('GNOME_SHELL_CONNECTIVITY_TEST') != null)
             isPortal ||= this._client.connectivity < NM.ConnectivityState.FULL;
-        if (!isPortal || Main.sessionMode.isGreeter)
+        if (Main.sessionMode.isGreeter)
             return;
 
         let path = this._mainConnection.get_path();
         if (this._connectivityQueue.has(path))
             return;
 
+        if (!isPortal) {
+            this._maybePrewarmPortalHelper(path).catch(logError);
+            return;
+        }
+
         let timestamp = global.get_current_time();
+        await this._ensurePortalHelperProxy();
+
+        this._portalHelperProxy?.AuthenticateAsync(path, this._client.connectivity_check_uri, timestamp).catch(logError);
+
+        this._connectivityQueue.add(path);
+    }
+
+    async _maybePrewarmPortalHelper(path) {
+        // Starting WebKit takes seconds, so get the portal helper ready
+        // while the connectivity of a new connection is still being
+        // checked, or when it is limited, which is often how a portal
+        // shows before it is detected as such
+        const {connectivity} = this._client;
+        if (connectivity !== NM.ConnectivityState.UNKNOWN &&
+            connectivity !== NM.ConnectivityState.LIMITED)
+            return;
+
+        if (!this._client.connectivity_check_enabled)
+            return;
+
+        if (this._prewarmedConnection === path)
+            return;
+        this._prewarmedConnection = path;
+
+        await this._ensurePortalHelperProxy();
+        await this._portalHelperProxy?.PrewarmAsync();
+    }
+
+    async _ensurePortalHelperProxy() {
         if (!this._portalHelperProxy) {
             this._portalHelperProxy = new Gio.DBusProxy({
                 g_connection: Gio.DBus.session,
@@ -2141,10 +2254,6 @@ class Indicator extends SystemIndicator {
                 console.error(`Error launching the portal helper: ${e.message}`);
             }
         }
-
-        this._portalHelperProxy?.AuthenticateAsync(path, this._client.connectivity_check_uri, timestamp).catch(logError);
-
-        this._connectivityQueue.add(path);
     }
 
     _updateIcon() {
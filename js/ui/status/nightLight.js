@@ -6,13 +6,12 @@ import GObject from 'gi://GObject';
 
 import {QuickToggle, SystemIndicator} from '../quickSettings.js';
 
-import {loadInterfaceXML} from '../../misc/fileUtils.js';
+import {loadInterfaceInfo} from '../../misc/fileUtils.js';
 
 const BUS_NAME = 'org.gnome.SettingsDaemon.Color';
 const OBJECT_PATH = '/org/gnome/SettingsDaemon/Color';
 
-const ColorInterface = loadInterfaceXML('org.gnome.SettingsDaemon.Color');
-const colorInfo = Gio.DBusInterfaceInfo.new_for_xml(ColorInterface);
+const colorInfo = loadInterfaceInfo('org.gnome.SettingsDaemon.Color');
 
 const NightLightToggle = GObject.registerClass(
 class NightLightToggle extends QuickToggle {
@@ -6,13 +6,12 @@ import GObject from 'gi://GObject';
 
 import {QuickToggle, SystemIndicator} from '../quickSettings.js';
 
-import {loadInterfaceXML} from '../../misc/fileUtils.js';
+import {loadInterfaceInfo} from '../../misc/fileUtils.js';
 
 const BUS_NAME = 'org.gnome.SettingsDaemon.Rfkill';
 const OBJECT_PATH = '/org/gnome/SettingsDaemon/Rfkill';
 
-const RfkillManagerInterface = loadInterfaceXML('org.gnome.SettingsDaemon.Rfkill');
-const rfkillManagerInfo = Gio.DBusInterfaceInfo.new_for_xml(RfkillManagerInterface);
+const rfkillManagerInfo = loadInterfaceInfo('org.gnome.SettingsDaemon.Rfkill');
 
 const RfkillManager = GObject.registerClass({
     Properties: {
@@ -16,6 +16,7 @@ import * as PopupMenu from '../popupMenu.js';
 import {PopupAnimation} from '../boxpointer.js';
 
 import {QuickSettingsItem, QuickToggle, SystemIndicator} from '../quickSettings.js';
+import {CoalescedUpdate} from '../../misc/util.js';
 import {loadInterfaceXML} from '../../misc/fileUtils.js';
 
 const BUS_NAME = 'org.freedesktop.UPower';
@@ -40,12 +41,14 @@ const PowerToggle = GObject.registerClass({
 
         this.add_style_class_name('power-item');
 
+        this._syncUpdate = new CoalescedUpdate(this, () => this._sync());
+
         this._proxy = new PowerManagerProxy(Gio.DBus.system, BUS_NAME, OBJECT_PATH,
             (proxy, error) => {
                 if (error)
                     console.error(error.message);
                 else
-                    this._proxy.connect('g-properties-changed', () => this._sync());
+                    this._proxy.connect('g-properties-changed', () => this._syncUpdate.queue());
                 this._sync();
             });
 
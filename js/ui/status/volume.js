@@ -10,6 +10,7 @@ import * as Main from '../main.js';
 import * as PopupMenu from '../popupMenu.js';
 
 import {QuickSlider, SystemIndicator} from '../quickSettings.js';
+import {CoalescedUpdate} from '../../misc/util.js';
 
 const ALLOW_AMPLIFIED_VOLUME_KEY = 'allow-volume-above-100-percent';
 const UNMUTE_DEFAULT_VOLUME = 0.25;
@@ -46,6 +47,11 @@ const StreamSlider = GObject.registerClass({
         this._inDrag = false;
         this._notifyVolumeChangeId = 0;
 
+        this._volumeUpdate = new CoalescedUpdate(this, () => {
+            if (this._stream)
+                this._updateVolume();
+        });
+
         this._soundSettings = new Gio.Settings({
             schema_id: 'org.gnome.desktop.sound',
         });
@@ -111,8 +117,8 @@ const StreamSlider = GObject.registerClass({
 
     _connectStream(stream) {
         stream.connectObject(
-            'notify::is-muted', this._updateVolume.bind(this),
-            'notify::volume', this._updateVolume.bind(this), this);
+            'notify::is-muted', () => this._volumeUpdate.queue(),
+            'notify::volume', () => this._volumeUpdate.queue(), this);
     }
 
     _lookupDevice(_id) {
@@ -16,7 +16,7 @@ import * as Layout from './layout.js';
 import * as Main from './main.js';
 import * as MessageTray from './messageTray.js';
 import * as SwipeTracker from './swipeTracker.js';
-import {formatDateWithCFormatString} from '../misc/dateUtils.js';
+import {formatDateWithCFormatString, translateTimeString} from '../misc/dateUtils.js';
 import * as AuthPrompt from '../gdm/authPrompt.js';
 
 // The timeout before going back automatically to the lock screen (in seconds)
@@ -377,7 +377,7 @@ class UnlockDialogClock extends St.BoxLayout {
         let date = new Date();
         /* Translators: This is a time format for a date in
            long format */
-        let dateFormat = Shell.util_translate_time_string(N_('%A %B %-d'));
+        let dateFormat = translateTimeString(N_('%A %B %-d'));
         this._date.text = formatDateWithCFormatString(date, dateFormat);
     }
 
@@ -901,6 +901,21 @@ export const UnlockDialog = GObject.registerClass({
         return true;
     }
 
+    // Undoes open(), and returns the dialog to the clock without an auth
+    // prompt, so that it can be opened again on the next lock without
+    // building it and blurring the backgrounds again
+    close() {
+        this.popModal();
+
+        this._adjustment.remove_transition('value');
+        this._activePage = this._clock;
+        this._adjustment.value = 0;
+        this._maybeDestroyAuthPrompt();
+
+        this.allowCancel = false;
+        this.hide();
+    }
+
     activate() {
         this._showPrompt();
     }
@@ -29,12 +29,6 @@ import * as Main from './main.js';
 
 export const SHELL_KEYBINDINGS_SCHEMA = 'org.gnome.shell.keybindings';
 
-const MINIMIZE_WINDOW_ANIMATION_TIME = 400;
-const MINIMIZE_WINDOW_ANIMATION_MODE = Clutter.AnimationMode.EASE_OUT_EXPO;
-const SHOW_WINDOW_ANIMATION_TIME = 150;
-const DIALOG_SHOW_WINDOW_ANIMATION_TIME = 100;
-const DESTROY_WINDOW_ANIMATION_TIME = 150;
-const DIALOG_DESTROY_WINDOW_ANIMATION_TIME = 100;
 const WINDOW_ANIMATION_TIME = 250;
 export const SCROLL_TIMEOUT_TIME = 150;
 const DIM_BRIGHTNESS = -0.3;
@@ -511,12 +505,9 @@ export class WindowManager {
     constructor() {
         this._shellwm =  global.window_manager;
 
-        this._minimizing = new Set();
-        this._unminimizing = new Set();
-        this._mapping = new Set();
+        this._waitingToMap = new Set();
         this._resizing = new Set();
         this._resizePending = new Set();
-        this._destroying = new Set();
 
         this._skippedActors = new Set();
 
@@ -525,12 +516,19 @@ export class WindowManager {
         this._isWorkspacePrepended = false;
         this._canScroll = true; // limiting scrolling speed
 
+        // Map, minimize, unminimize and destroy effects run in ShellWM,
+        // which completes them itself, also when they get killed
         this._shellwm.connect('kill-window-effects', (shellwm, actor) => {
-            this._minimizeWindowDone(shellwm, actor);
-            this._mapWindowDone(shellwm, actor);
-            this._destroyWindowDone(shellwm, actor);
+            if (this._waitingToMap.delete(actor))
+                shellwm.completed_map(actor);
             this._sizeChangeWindowDone(shellwm, actor);
         });
+        this._shellwm.connect('window-effects-completed', (shellwm, actors) => {
+            for (const actor of actors) {
+                const parent = actor.get_meta_window()?.get_transient_for();
+                parent?.disconnectObject(actor);
+            }
+        });
 
         this._shellwm.connect('switch-workspace', this._switchWorkspace.bind(this));
         this._shellwm.connect('show-tile-preview', this._showTilePreview.bind(this));
@@ -756,123 +754,123 @@ export class WindowManager {
             this._startSwitcher.bind(this));
 
         this.addKeybinding('toggle-message-tray',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW |
             Shell.ActionMode.POPUP,
             this._toggleCalendar.bind(this));
 
         this.addKeybinding('toggle-quick-settings',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW |
             Shell.ActionMode.POPUP,
             this._toggleQuickSettings.bind(this));
 
         this.addKeybinding('switch-to-application-1',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._switchToApplication.bind(this));
 
         this.addKeybinding('switch-to-application-2',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._switchToApplication.bind(this));
 
         this.addKeybinding('switch-to-application-3',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._switchToApplication.bind(this));
 
         this.addKeybinding('switch-to-application-4',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._switchToApplication.bind(this));
 
         this.addKeybinding('switch-to-application-5',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._switchToApplication.bind(this));
 
         this.addKeybinding('switch-to-application-6',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._switchToApplication.bind(this));
 
         this.addKeybinding('switch-to-application-7',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._switchToApplication.bind(this));
 
         this.addKeybinding('switch-to-application-8',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._switchToApplication.bind(this));
 
         this.addKeybinding('switch-to-application-9',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._switchToApplication.bind(this));
 
         this.addKeybinding('open-new-window-application-1',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._openNewApplicationWindow.bind(this));
 
         this.addKeybinding('open-new-window-application-2',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._openNewApplicationWindow.bind(this));
 
         this.addKeybinding('open-new-window-application-3',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._openNewApplicationWindow.bind(this));
 
         this.addKeybinding('open-new-window-application-4',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._openNewApplicationWindow.bind(this));
 
         this.addKeybinding('open-new-window-application-5',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._openNewApplicationWindow.bind(this));
 
         this.addKeybinding('open-new-window-application-6',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._openNewApplicationWindow.bind(this));
 
         this.addKeybinding('open-new-window-application-7',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._openNewApplicationWindow.bind(this));
 
         this.addKeybinding('open-new-window-application-8',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._openNewApplicationWindow.bind(this));
 
         this.addKeybinding('open-new-window-application-9',
-            new Gio.Settings({schema_id: SHELL_KEYBINDINGS_SCHEMA}),
+            global.get_schema_settings(SHELL_KEYBINDINGS_SCHEMA),
             Meta.KeyBindingFlags.IGNORE_AUTOREPEAT,
             Shell.ActionMode.NORMAL | Shell.ActionMode.OVERVIEW,
             this._openNewApplicationWindow.bind(this));
@@ -1164,61 +1162,34 @@ export class WindowManager {
             return;
         }
 
-        actor.set_scale(1.0, 1.0);
-
-        this._minimizing.add(actor);
-
         if (actor.meta_window.is_monitor_sized()) {
-            actor.ease({
-                opacity: 0,
-                duration: MINIMIZE_WINDOW_ANIMATION_TIME,
-                mode: MINIMIZE_WINDOW_ANIMATION_MODE,
-                onStopped: () => this._minimizeWindowDone(shellwm, actor),
-            });
-        } else {
-            let xDest, yDest, xScale, yScale;
-            let [success, geom] = actor.meta_window.get_icon_geometry();
-            if (success) {
-                xDest = geom.x;
-                yDest = geom.y;
-                xScale = geom.width / actor.width;
-                yScale = geom.height / actor.height;
-            } else {
-                let monitor = Main.layoutManager.monitors[actor.meta_window.get_monitor()];
-                if (!monitor) {
-                    this._minimizeWindowDone();
-                    return;
-                }
-                xDest = monitor.x;
-                yDest = monitor.y;
-                if (Clutter.get_default_text_direction() === Clutter.TextDirection.RTL)
-                    xDest += monitor.width;
-                xScale = 0;
-                yScale = 0;
-            }
+            shellwm.start_window_effect(actor,
+                Shell.WMEffect.MINIMIZE_FADE, null);
+            return;
+        }
 
-            actor.ease({
-                opacity: 0,
-                scale_x: xScale,
-                scale_y: yScale,
-                x: xDest,
-                y: yDest,
-                duration: MINIMIZE_WINDOW_ANIMATION_TIME,
-                mode: MINIMIZE_WINDOW_ANIMATION_MODE,
-                onStopped: () => this._minimizeWindowDone(shellwm, actor),
-            });
+        const rect = this._getMinimizeRect(actor);
+        if (!rect) {
+            shellwm.completed_minimize(actor);
+            return;
         }
+
+        shellwm.start_window_effect(actor, Shell.WMEffect.MINIMIZE, rect);
     }
 
-    _minimizeWindowDone(shellwm, actor) {
-        if (this._minimizing.delete(actor)) {
-            actor.remove_all_transitions();
-            actor.set_scale(1.0, 1.0);
-            actor.set_opacity(255);
-            actor.set_pivot_point(0, 0);
+    _getMinimizeRect(actor) {
+        const [success, geom] = actor.meta_window.get_icon_geometry();
+        if (success)
+            return geom;
 
-            shellwm.completed_minimize(actor);
-        }
+        const monitor = Main.layoutManager.monitors[actor.meta_window.get_monitor()];
+        if (!monitor)
+            return null;
+
+        let x = monitor.x;
+        if (Clutter.get_default_text_direction() === Clutter.TextDirection.RTL)
+            x += monitor.width;
+        return new Mtk.Rectangle({x, y: monitor.y, width: 0, height: 0});
     }
 
     _unminimizeWindow(shellwm, actor) {
@@ -1232,62 +1203,20 @@ export class WindowManager {
             return;
         }
 
-        this._unminimizing.add(actor);
-
         if (actor.meta_window.is_monitor_sized()) {
-            actor.opacity = 0;
-            actor.set_scale(1.0, 1.0);
-            actor.ease({
-                opacity: 255,
-                duration: MINIMIZE_WINDOW_ANIMATION_TIME,
-                mode: MINIMIZE_WINDOW_ANIMATION_MODE,
-                onStopped: () => this._unminimizeWindowDone(shellwm, actor),
-            });
-        } else {
-            let [success, geom] = actor.meta_window.get_icon_geometry();
-            if (success) {
-                actor.set_position(geom.x, geom.y);
-                actor.set_scale(
-                    geom.width / actor.width,
-                    geom.height / actor.height);
-            } else {
-                let monitor = Main.layoutManager.monitors[actor.meta_window.get_monitor()];
-                if (!monitor) {
-                    actor.show();
-                    this._unminimizeWindowDone();
-                    return;
-                }
-                actor.set_position(monitor.x, monitor.y);
-                if (Clutter.get_default_text_direction() === Clutter.TextDirection.RTL)
-                    actor.x += monitor.width;
-                actor.set_scale(0, 0);
-            }
-
-            let rect = actor.meta_window.get_buffer_rect();
-            let [xDest, yDest] = [rect.x, rect.y];
-
-            actor.show();
-            actor.ease({
-                scale_x: 1,
-                scale_y: 1,
-                x: xDest,
-                y: yDest,
-                duration: MINIMIZE_WINDOW_ANIMATION_TIME,
-                mode: MINIMIZE_WINDOW_ANIMATION_MODE,
-                onStopped: () => this._unminimizeWindowDone(shellwm, actor),
-            });
+            shellwm.start_window_effect(actor,
+                Shell.WMEffect.UNMINIMIZE_FADE, null);
+            return;
         }
-    }
-
-    _unminimizeWindowDone(shellwm, actor) {
-        if (this._unminimizing.delete(actor)) {
-            actor.remove_all_transitions();
-            actor.set_scale(1.0, 1.0);
-            actor.set_opacity(255);
-            actor.set_pivot_point(0, 0);
 
+        const rect = this._getMinimizeRect(actor);
+        if (!rect) {
+            actor.show();
             shellwm.completed_unminimize(actor);
+            return;
         }
+
+        shellwm.start_window_effect(actor, Shell.WMEffect.UNMINIMIZE, rect);
     }
 
     _sizeChangeWindow(shellwm, actor, whichChange, oldFrameRect, _oldBufferRect) {
@@ -1495,59 +1424,28 @@ export class WindowManager {
             return;
         }
 
+        let effect;
         switch (this._getAnimationWindowType(actor)) {
         case Meta.WindowType.NORMAL:
-            actor.set_pivot_point(0.5, 1.0);
-            actor.scale_x = 0.01;
-            actor.scale_y = 0.05;
-            actor.opacity = 0;
-            actor.show();
-            this._mapping.add(actor);
-
-            await this._waitForOverviewToHide();
-            actor.ease({
-                opacity: 255,
-                scale_x: 1,
-                scale_y: 1,
-                duration: SHOW_WINDOW_ANIMATION_TIME,
-                mode: Clutter.AnimationMode.EASE_OUT_EXPO,
-                onStopped: () => this._mapWindowDone(shellwm, actor),
-            });
+            effect = Shell.WMEffect.MAP;
             break;
         case Meta.WindowType.MODAL_DIALOG:
         case Meta.WindowType.DIALOG:
-            actor.set_pivot_point(0.5, 0.5);
-            actor.scale_y = 0;
-            actor.opacity = 0;
-            actor.show();
-            this._mapping.add(actor);
-
-            await this._waitForOverviewToHide();
-            actor.ease({
-                opacity: 255,
-                scale_x: 1,
-                scale_y: 1,
-                duration: DIALOG_SHOW_WINDOW_ANIMATION_TIME,
-                mode: Clutter.AnimationMode.EASE_OUT_QUAD,
-                onStopped: () => this._mapWindowDone(shellwm, actor),
-            });
+            effect = Shell.WMEffect.MAP_DIALOG;
             break;
         default:
             shellwm.completed_map(actor);
+            return;
         }
-    }
 
-    _mapWindowDone(shellwm, actor) {
-        if (this._mapping.delete(actor)) {
-            actor.remove_all_transitions();
-            actor.opacity = 255;
-            actor.set_pivot_point(0, 0);
-            actor.scale_y = 1;
-            actor.scale_x = 1;
-            actor.translation_y = 0;
-            actor.translation_x = 0;
-            shellwm.completed_map(actor);
-        }
+        this._waitingToMap.add(actor);
+        await this._waitForOverviewToHide();
+
+        // Killed while waiting
+        if (!this._waitingToMap.delete(actor))
+            return;
+
+        shellwm.start_window_effect(actor, effect, null);
     }
 
     _destroyWindow(shellwm, actor) {
@@ -1569,51 +1467,26 @@ export class WindowManager {
 
         switch (this._getAnimationWindowType(actor)) {
         case Meta.WindowType.NORMAL:
-            actor.set_pivot_point(0.5, 0.5);
-            this._destroying.add(actor);
-
-            actor.ease({
-                opacity: 0,
-                scale_x: 0.8,
-                scale_y: 0.8,
-                duration: DESTROY_WINDOW_ANIMATION_TIME,
-                mode: Clutter.AnimationMode.EASE_OUT_QUAD,
-                onStopped: () => this._destroyWindowDone(shellwm, actor),
-            });
+            shellwm.start_window_effect(actor, Shell.WMEffect.DESTROY, null);
             break;
         case Meta.WindowType.MODAL_DIALOG:
         case Meta.WindowType.DIALOG:
-            actor.set_pivot_point(0.5, 0.5);
-            this._destroying.add(actor);
-
             if (window.is_attached_dialog()) {
                 let parent = window.get_transient_for();
                 parent.connectObject('unmanaged', () => {
                     actor.remove_all_transitions();
-                    this._destroyWindowDone(shellwm, actor);
+                    shellwm.flush_window_effects();
                 }, actor);
             }
 
-            actor.ease({
-                scale_y: 0,
-                duration: DIALOG_DESTROY_WINDOW_ANIMATION_TIME,
-                mode: Clutter.AnimationMode.EASE_OUT_QUAD,
-                onStopped: () => this._destroyWindowDone(shellwm, actor),
-            });
+            shellwm.start_window_effect(actor,
+                Shell.WMEffect.DESTROY_DIALOG, null);
             break;
         default:
             shellwm.completed_destroy(actor);
         }
     }
 
-    _destroyWindowDone(shellwm, actor) {
-        if (this._destroying.delete(actor)) {
-            const parent = actor.get_meta_window()?.get_transient_for();
-            parent?.disconnectObject(actor);
-            shellwm.completed_destroy(actor);
-        }
-    }
-
     _filterKeybinding(shellwm, binding) {
         if (Main.actionMode === Shell.ActionMode.NONE)
             return true;
@@ -50,6 +50,7 @@ export const WindowPreview = GObject.registerClass({
         this._windowActor = metaWindow.get_compositor_private();
         this._workspace = workspace;
         this._overviewAdjustment = overviewAdjustment;
+        this._layoutScale = [1, 1];
 
         super._init({
             reactive: true,
@@ -244,13 +245,33 @@ export const WindowPreview = GObject.registerClass({
             finalState === ControlsState.WINDOW_PICKER;
         const scale = visible
             ? 1 - Math.abs(ControlsState.WINDOW_PICKER - currentState) : 0;
+        const [layoutScaleX, layoutScaleY] = this._layoutScale;
 
         this._icon.set({
-            scale_x: scale,
-            scale_y: scale,
+            scale_x: layoutScaleX > 0 ? scale / layoutScaleX : 0,
+            scale_y: layoutScaleY > 0 ? scale / layoutScaleY : 0,
         });
     }
 
+    /**
+     * Moves and scales the preview away from its allocation, so that the
+     * workspace can animate it without allocating it again. The icon
+     * keeps the size it has without the transform.
+     *
+     * @param {number} translationX - the horizontal translation
+     * @param {number} translationY - the vertical translation
+     * @param {number} scaleX - the horizontal scale
+     * @param {number} scaleY - the vertical scale
+     */
+    setLayoutTransform(translationX, translationY, scaleX, scaleY) {
+        this.set_pivot_point(0, 0);
+        this.set_translation(translationX, translationY, 0);
+        this.set_scale(scaleX, scaleY);
+
+        this._layoutScale = [scaleX, scaleY];
+        this._updateIconScale();
+    }
+
     _windowCanClose() {
         return this.metaWindow.can_close() &&
                !this._hasAttachedDialogs();
@@ -12,382 +12,14 @@ import * as Background from './background.js';
 import * as DND from './dnd.js';
 import * as Main from './main.js';
 import * as OverviewControls from './overviewControls.js';
-import * as Params from '../misc/params.js';
 
 import * as Util from '../misc/util.js';
 import {WindowPreview} from './windowPreview.js';
 
-const WINDOW_PREVIEW_MAXIMUM_SCALE = 0.95;
-
 const WINDOW_REPOSITIONING_DELAY = 750;
 
-// When calculating a layout, we calculate the scale of windows and the percent
-// of the available area the new layout uses. If the values for the new layout,
-// when weighted with the values as below, are worse than the previous layout's,
-// we stop looking for a new layout and use the previous layout.
-// Otherwise, we keep looking for a new layout.
-const LAYOUT_SCALE_WEIGHT = 1;
-const LAYOUT_SPACE_WEIGHT = 0.1;
-
 const BACKGROUND_CORNER_RADIUS_PIXELS = 30;
 
-// Window Thumbnail Layout Algorithm
-// =================================
-//
-// General overview
-// ----------------
-//
-// The window thumbnail layout algorithm calculates some optimal layout
-// by computing layouts with some number of rows, calculating how good
-// each layout is, and stopping iterating when it finds one that is worse
-// than the previous layout. A layout consists of which windows are in
-// which rows, row sizes and other general state tracking that would make
-// calculating window positions from this information fairly easy.
-//
-// After a layout is computed that's considered the best layout, we
-// compute the layout scale to fit it in the area, and then compute
-// slots (sizes and positions) for each thumbnail.
-//
-// Layout generation
-// -----------------
-//
-// Layout generation is naive and simple: we simply add windows to a row
-// until we've added too many windows to a row, and then make a new row,
-// until we have our required N rows. The potential issue with this strategy
-// is that we may have too many windows at the bottom in some pathological
-// cases, which tends to make the thumbnails have the shape of a pile of
-// sand with a peak, with one window at the top.
-//
-// Scaling factors
-// ---------------
-//
-// Thumbnail position is mostly straightforward -- the main issue is
-// computing an optimal scale for each window that fits the constraints,
-// and doesn't make the thumbnail too small to see. There are two factors
-// involved in thumbnail scale to make sure that these two goals are met:
-// the window scale (calculated by _computeWindowScale) and the layout
-// scale (calculated by computeSizeAndScale).
-//
-// The calculation logic becomes slightly more complicated because row
-// and column spacing are not scaled, they're constant, so we can't
-// simply generate a bunch of window positions and then scale it. In
-// practice, it's not too bad -- we can simply try to fit the layout
-// in the input area minus whatever spacing we have, and then add
-// it back afterwards.
-//
-// The window scale is constant for the window's size regardless of the
-// input area or the layout scale or rows or anything else, and right
-// now just enlarges the window if it's too small. The fact that this
-// factor is stable makes it easy to calculate, so there's no sense
-// in not applying it in most calculations.
-//
-// The layout scale depends on the input area, the rows, etc, but is the
-// same for the entire layout, rather than being per-window. After
-// generating the rows of windows, we basically do some basic math to
-// fit the full, unscaled layout to the input area, as described above.
-//
-// With these two factors combined, the final scale of each thumbnail is
-// simply windowScale * layoutScale... almost.
-//
-// There's one additional constraint: the thumbnail scale must never be
-// larger than WINDOW_PREVIEW_MAXIMUM_SCALE, which means that the inequality:
-//
-//   windowScale * layoutScale <= WINDOW_PREVIEW_MAXIMUM_SCALE
-//
-// must always be true. This is for each individual window -- while we
-// could adjust layoutScale to make the largest thumbnail smaller than
-// WINDOW_PREVIEW_MAXIMUM_SCALE, it would shrink windows which are already
-// under the inequality. To solve this, we simply cheat: we simply keep
-// each window's "cell" area to be the same, but we shrink the thumbnail
-// and center it horizontally, and align it to the bottom vertically.
-
-export class LayoutStrategy {
-    constructor(params) {
-        params = Params.parse(params, {
-            monitor: null,
-            rowSpacing: 0,
-            columnSpacing: 0,
-        });
-
-        if (!params.monitor)
-            throw new Error(`No monitor param passed to ${this.constructor.name}`);
-
-        this._monitor = params.monitor;
-        this._rowSpacing = params.rowSpacing;
-        this._columnSpacing = params.columnSpacing;
-    }
-
-    // Compute a strategy-specific overall layout given a list of WindowPreviews
-    // @windows and the strategy-specific @layoutParams.
-    //
-    // Returns a strategy-specific layout object that is opaque to the user.
-    computeLayout(_windows, _layoutParams) {
-        throw new GObject.NotImplementedError(`computeLayout in ${this.constructor.name}`);
-    }
-
-    // Given @layout and @area, compute the overall scale of the layout and
-    // space occupied by the layout.
-    //
-    // This method returns an array where the first element is the scale and
-    // the second element is the space.
-    //
-    // This method must be called before calling computeWindowSlots(), as it
-    // sets the fixed overall scale of the layout.
-    computeScaleAndSpace(_layout, _area) {
-        throw new GObject.NotImplementedError(`computeScaleAndSpace in ${this.constructor.name}`);
-    }
-
-    // Returns an array with final position and size information for each
-    // window of the layout, given a bounding area that it will be inside of.
-    computeWindowSlots(_layout, _area) {
-        throw new GObject.NotImplementedError(`computeWindowSlots in ${this.constructor.name}`);
-    }
-}
-
-class UnalignedLayoutStrategy extends LayoutStrategy {
-    _newRow() {
-        // Row properties:
-        //
-        // * x, y are the position of row, relative to area
-        //
-        // * width, height are the scaled versions of fullWidth, fullHeight
-        //
-        // * width also has the spacing in between windows. It's not in
-        //   fullWidth, as the spacing is constant, whereas fullWidth is
-        //   meant to be scaled
-        //
-        // * neither height/fullHeight have any sort of spacing or padding
-        return {
-            x: 0, y: 0,
-            width: 0, height: 0,
-            fullWidth: 0, fullHeight: 0,
-            windows: [],
-        };
-    }
-
-    // Computes and returns an individual scaling factor for @window,
-    // to be applied in addition to the overall layout scale.
-    _computeWindowScale(window) {
-        // Since we align windows next to each other, the height of the
-        // thumbnails is much more important to preserve than the width of
-        // them, so two windows with equal height, but maybe differering
-        // widths line up.
-        let ratio = window.boundingBox.height / this._monitor.height;
-
-        // The purpose of this manipulation here is to prevent windows
-        // from getting too small. For something like a calculator window,
-        // we need to bump up the size just a bit to make sure it looks
-        // good. We'll use a multiplier of 1.5 for this.
-
-        // Map from [0, 1] to [1.5, 1]
-        return Util.lerp(1.5, 1, ratio);
-    }
-
-    _computeRowSizes(layout) {
-        let {rows, scale} = layout;
-        for (let i = 0; i < rows.length; i++) {
-            let row = rows[i];
-            row.width = row.fullWidth * scale + (row.windows.length - 1) * this._columnSpacing;
-            row.height = row.fullHeight * scale;
-        }
-    }
-
-    _keepSameRow(row, window, width, idealRowWidth) {
-        if (row.fullWidth + width <= idealRowWidth)
-            return true;
-
-        let oldRatio = row.fullWidth / idealRowWidth;
-        let newRatio = (row.fullWidth + width) / idealRowWidth;
-
-        if (Math.abs(1 - newRatio) < Math.abs(1 - oldRatio))
-            return true;
-
-        return false;
-    }
-
-    _sortRow(row) {
-        // Sort windows horizontally to minimize travel distance.
-        // This affects in what order the windows end up in a row.
-        row.windows.sort((a, b) => a.windowCenter.x - b.windowCenter.x);
-    }
-
-    computeLayout(windows, layoutParams) {
-        layoutParams = Params.parse(layoutParams, {
-            numRows: 0,
-        });
-
-        if (layoutParams.numRows === 0)
-            throw new Error(`${this.constructor.name}: No numRows given in layout params`);
-
-        const numRows = layoutParams.numRows;
-
-        let rows = [];
-        let totalWidth = 0;
-        for (let i = 0; i < windows.length; i++) {
-            let window = windows[i];
-            let s = this._computeWindowScale(window);
-            totalWidth += window.boundingBox.width * s;
-        }
-
-        let idealRowWidth = totalWidth / numRows;
-
-        // Sort windows vertically to minimize travel distance.
-        // This affects what rows the windows get placed in.
-        let sortedWindows = windows.slice();
-        sortedWindows.sort((a, b) => a.windowCenter.y - b.windowCenter.y);
-
-        let windowIdx = 0;
-        for (let i = 0; i < numRows; i++) {
-            let row = this._newRow();
-            rows.push(row);
-
-            for (; windowIdx < sortedWindows.length; windowIdx++) {
-                let window = sortedWindows[windowIdx];
-                let s = this._computeWindowScale(window);
-                let width = window.boundingBox.width * s;
-                let height = window.boundingBox.height * s;
-                row.fullHeight = Math.max(row.fullHeight, height);
-
-                // either new width is < idealWidth or new width is nearer from idealWidth then oldWidth
-                if (this._keepSameRow(row, window, width, idealRowWidth) || (i === numRows - 1)) {
-                    row.windows.push(window);
-                    row.fullWidth += width;
-                } else {
-                    break;
-                }
-            }
-        }
-
-        let gridHeight = 0;
-        let maxRow;
-        for (let i = 0; i < numRows; i++) {
-            let row = rows[i];
-            this._sortRow(row);
-
-            if (!maxRow || row.fullWidth > maxRow.fullWidth)
-                maxRow = row;
-            gridHeight += row.fullHeight;
-        }
-
-        return {
-            numRows,
-            rows,
-            maxColumns: maxRow.windows.length,
-            gridWidth: maxRow.fullWidth,
-            gridHeight,
-        };
-    }
-
-    computeScaleAndSpace(layout, area) {
-        let hspacing = (layout.maxColumns - 1) * this._columnSpacing;
-        let vspacing = (layout.numRows - 1) * this._rowSpacing;
-
-        let spacedWidth = area.width - hspacing;
-        let spacedHeight = area.height - vspacing;
-
-        let horizontalScale = spacedWidth / layout.gridWidth;
-        let verticalScale = spacedHeight / layout.gridHeight;
-
-        // Thumbnails should be less than 70% of the original size
-        let scale = Math.min(
-            horizontalScale, verticalScale, WINDOW_PREVIEW_MAXIMUM_SCALE);
-
-        let scaledLayoutWidth = layout.gridWidth * scale + hspacing;
-        let scaledLayoutHeight = layout.gridHeight * scale + vspacing;
-        let space = (scaledLayoutWidth * scaledLayoutHeight) / (area.width * area.height);
-
-        layout.scale = scale;
-
-        return [scale, space];
-    }
-
-    computeWindowSlots(layout, area) {
-        this._computeRowSizes(layout);
-
-        let {rows, scale} = layout;
-
-        let slots = [];
-
-        // Do this in three parts.
-        let heightWithoutSpacing = 0;
-        for (let i = 0; i < rows.length; i++) {
-            let row = rows[i];
-            heightWithoutSpacing += row.height;
-        }
-
-        let verticalSpacing = (rows.length - 1) * this._rowSpacing;
-        let additionalVerticalScale = Math.min(1, (area.height - verticalSpacing) / heightWithoutSpacing);
-
-        // keep track how much smaller the grid becomes due to scaling
-        // so it can be centered again
-        let compensation = 0;
-        let y = 0;
-
-        for (let i = 0; i < rows.length; i++) {
-            let row = rows[i];
-
-            // If this window layout row doesn't fit in the actual
-            // geometry, then apply an additional scale to it.
-            let horizontalSpacing = (row.windows.length - 1) * this._columnSpacing;
-            let widthWithoutSpacing = row.width - horizontalSpacing;
-            let additionalHorizontalScale = Math.min(1, (area.width - horizontalSpacing) / widthWithoutSpacing);
-
-            if (additionalHorizontalScale < additionalVerticalScale) {
-                row.additionalScale = additionalHorizontalScale;
-                // Only consider the scaling in addition to the vertical scaling for centering.
-                compensation += (additionalVerticalScale - additionalHorizontalScale) * row.height;
-            } else {
-                row.additionalScale = additionalVerticalScale;
-                // No compensation when scaling vertically since centering based on a too large
-                // height would undo what vertical scaling is trying to achieve.
-            }
-
-            row.x = area.x + (Math.max(area.width - (widthWithoutSpacing * row.additionalScale + horizontalSpacing), 0) / 2);
-            row.y = area.y + (Math.max(area.height - (heightWithoutSpacing + verticalSpacing), 0) / 2) + y;
-            y += row.height * row.additionalScale + this._rowSpacing;
-        }
-
-        compensation /= 2;
-
-        for (let i = 0; i < rows.length; i++) {
-            const row = rows[i];
-            const rowY = row.y + compensation;
-            const rowHeight = row.height * row.additionalScale;
-
-            let x = row.x;
-            for (let j = 0; j < row.windows.length; j++) {
-                let window = row.windows[j];
-
-                let s = scale * this._computeWindowScale(window) * row.additionalScale;
-                let cellWidth = window.boundingBox.width * s;
-                let cellHeight = window.boundingBox.height * s;
-
-                s = Math.min(s, WINDOW_PREVIEW_MAXIMUM_SCALE);
-                let cloneWidth = window.boundingBox.width * s;
-                const cloneHeight = window.boundingBox.height * s;
-
-                let cloneX = x + (cellWidth - cloneWidth) / 2;
-                let cloneY;
-
-                // If there's only one row, align windows vertically centered inside the row
-                if (rows.length === 1)
-                    cloneY = rowY + (rowHeight - cloneHeight) / 2;
-                // If there are multiple rows, align windows to the bottom edge of the row
-                else
-                    cloneY = rowY + rowHeight - cellHeight;
-
-                // Align with the pixel grid to prevent blurry windows at scale = 1
-                cloneX = Math.floor(cloneX);
-                cloneY = Math.floor(cloneY);
-
-                slots.push([cloneX, cloneY, cloneWidth, cloneHeight, window]);
-                x += cellWidth + this._columnSpacing;
-            }
-        }
-        return slots;
-    }
-}
-
 function animateAllocation(actor, box) {
     actor.save_easing_state();
     actor.set_easing_mode(Clutter.AnimationMode.EASE_OUT_QUAD);
@@ -427,7 +59,8 @@ export const WorkspaceLayout = GObject.registerClass({
         this._sortedWindows = [];
         this._lastBox = null;
         this._windowSlots = [];
-        this._layout = null;
+        this._layoutWindows = [];
+        this._layoutEngine = new Shell.UnalignedLayout();
 
         this._needsLayout = true;
 
@@ -458,25 +91,6 @@ export const WorkspaceLayout = GObject.registerClass({
         });
     }
 
-    _isBetterScaleAndSpace(oldScale, oldSpace, scale, space) {
-        let spacePower = (space - oldSpace) * LAYOUT_SPACE_WEIGHT;
-        let scalePower = (scale - oldScale) * LAYOUT_SCALE_WEIGHT;
-
-        if (scale > oldScale && space > oldSpace) {
-            // Win win -- better scale and better space
-            return true;
-        } else if (scale > oldScale && space <= oldSpace) {
-            // Keep new layout only if scale gain outweighs aspect space loss
-            return scalePower > spacePower;
-        } else if (scale <= oldScale && space > oldSpace) {
-            // Keep new layout only if aspect space gain outweighs scale loss
-            return spacePower > scalePower;
-        } else {
-            // Lose -- worse scale and space
-            return false;
-        }
-    }
-
     _adjustSpacingAndPadding(rowSpacing, colSpacing, containerBox) {
         if (this._sortedWindows.length === 0)
             return [rowSpacing, colSpacing, containerBox];
@@ -517,59 +131,40 @@ export const WorkspaceLayout = GObject.registerClass({
     _createBestLayout(area) {
         const [rowSpacing, columnSpacing] =
             this._adjustSpacingAndPadding(this._spacing, this._spacing, null);
+        const monitor = Main.layoutManager.monitors[this._monitorIndex];
 
-        // We look for the largest scale that allows us to fit the
-        // largest row/tallest column on the workspace.
-        this._layoutStrategy = new UnalignedLayoutStrategy({
-            monitor: Main.layoutManager.monitors[this._monitorIndex],
-            rowSpacing,
-            columnSpacing,
-        });
-
-        let lastLayout = null;
-        let lastNumColumns = -1;
-        let lastScale = 0;
-        let lastSpace = 0;
-
-        for (let numRows = 1; ; numRows++) {
-            const numColumns = Math.ceil(this._sortedWindows.length / numRows);
-
-            // If adding a new row does not change column count just stop
-            // (for instance: 9 windows, with 3 rows -> 3 columns, 4 rows ->
-            // 3 columns as well => just use 3 rows then)
-            if (numColumns === lastNumColumns)
-                break;
-
-            const layout = this._layoutStrategy.computeLayout(this._sortedWindows, {
-                numRows,
-            });
-
-            const [scale, space] = this._layoutStrategy.computeScaleAndSpace(layout, area);
-
-            if (lastLayout && !this._isBetterScaleAndSpace(lastScale, lastSpace, scale, space))
-                break;
-
-            lastLayout = layout;
-            lastNumColumns = numColumns;
-            lastScale = scale;
-            lastSpace = space;
+        const boxes = [];
+        for (const window of this._sortedWindows) {
+            const {x, y, width, height} = window.boundingBox;
+            boxes.push(x, y, width, height);
         }
 
-        return lastLayout;
+        // We look for the largest scale that allows us to fit the
+        // largest row/tallest column on the workspace. The layout
+        // is only computed again when any of its inputs changed.
+        this._layoutEngine.compute_layout(boxes, monitor.height,
+            rowSpacing, columnSpacing, area.width, area.height);
+
+        // Slots refer to windows by their index in the layout
+        this._layoutWindows = this._sortedWindows.slice();
     }
 
     _getWindowSlots(containerBox) {
         [, , containerBox] =
             this._adjustSpacingAndPadding(null, null, containerBox);
 
-        const availArea = {
-            x: parseInt(containerBox.x1),
-            y: parseInt(containerBox.y1),
-            width: parseInt(containerBox.get_width()),
-            height: parseInt(containerBox.get_height()),
-        };
+        const slots = this._layoutEngine.compute_window_slots(
+            parseInt(containerBox.x1),
+            parseInt(containerBox.y1),
+            parseInt(containerBox.get_width()),
+            parseInt(containerBox.get_height()));
 
-        return this._layoutStrategy.computeWindowSlots(this._layout, availArea);
+        const windowSlots = [];
+        for (let i = 0; i < slots.length; i += 5) {
+            const [x, y, width, height, index] = slots.slice(i, i + 5);
+            windowSlots.push([x, y, width, height, this._layoutWindows[index]]);
+        }
+        return windowSlots;
     }
 
     _getAdjustedWorkarea(container) {
@@ -671,7 +266,7 @@ export const WorkspaceLayout = GObject.registerClass({
         let layoutChanged = false;
         if (!this._layoutFrozen || !this._lastBox) {
             if (this._needsLayout) {
-                this._layout = this._createBestLayout(this._workarea);
+                this._createBestLayout(this._workarea);
                 this._needsLayout = false;
                 layoutChanged = true;
             }
@@ -691,6 +286,15 @@ export const WorkspaceLayout = GObject.registerClass({
         const allocationScale = containerWidth / workareaWidth;
 
         const childBox = new Clutter.ActorBox();
+        const slotBox = new Clutter.ActorBox();
+
+        // We want layout changes (ie. larger changes to the layout like
+        // reshuffling the window order) to be animated, but small changes
+        // like changes to the container size to happen immediately (for
+        // example if the container height is being animated, we want to
+        // avoid animating the children allocations to make sure they
+        // don't "lag behind" the other animation).
+        const animateLayout = layoutChanged && !Main.overview.animationInProgress;
 
         const nSlots = this._windowSlots.length;
         for (let i = 0; i < nSlots; i++) {
@@ -698,6 +302,9 @@ export const WorkspaceLayout = GObject.registerClass({
             if (!child.visible)
                 continue;
 
+            slotBox.set_origin(x, y);
+            slotBox.set_size(width, height);
+
             x *= slotsScale;
             y *= slotsScale;
             width *= slotsScale;
@@ -751,13 +358,26 @@ export const WorkspaceLayout = GObject.registerClass({
                 continue;
             }
 
-            // We want layout changes (ie. larger changes to the layout like
-            // reshuffling the window order) to be animated, but small changes
-            // like changes to the container size to happen immediately (for
-            // example if the container height is being animated, we want to
-            // avoid animating the children allocations to make sure they
-            // don't "lag behind" the other animation).
-            if (layoutChanged && !Main.overview.animationInProgress) {
+            // Between the session and the window picker, children stay in
+            // the slots they were given and only move by their transforms,
+            // so that they aren't laid out again on every frame
+            if (stateAdjustementValue < 1 && !animateLayout) {
+                const [slotWidth, slotHeight] = slotBox.get_size();
+
+                child.allocate(slotBox);
+                child.setLayoutTransform(x - slotBox.x1, y - slotBox.y1,
+                    slotWidth > 0 ? width / slotWidth : 0,
+                    slotHeight > 0 ? height / slotHeight : 0);
+                windowInfo.transformed = true;
+                continue;
+            }
+
+            if (windowInfo.transformed) {
+                child.setLayoutTransform(0, 0, 1, 1);
+                windowInfo.transformed = false;
+            }
+
+            if (animateLayout) {
                 const transition = animateAllocation(child, childBox);
                 if (transition) {
                     windowInfo.currentTransition = transition;
@@ -807,6 +427,7 @@ export const WorkspaceLayout = GObject.registerClass({
             destroyId: window.connect('destroy', () =>
                 this.removeWindow(window)),
             currentTransition: null,
+            transformed: false,
         });
 
         this._sortedWindows.push(window);
@@ -1,6 +1,7 @@
 // -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
 
 import Clutter from 'gi://Clutter';
+import GLib from 'gi://GLib';
 import GObject from 'gi://GObject';
 import Meta from 'gi://Meta';
 import Shell from 'gi://Shell';
@@ -16,6 +17,9 @@ import * as Main from './main.js';
 const WINDOW_ANIMATION_TIME = 250;
 export const WORKSPACE_SPACING = 100;
 
+// How often windows of snapshotted workspaces may update, in ms
+const SNAPSHOT_UPDATE_INTERVAL = 100;
+
 export const WorkspaceGroup = GObject.registerClass(
 class WorkspaceGroup extends Clutter.Actor {
     _init(workspace, monitor, movingWindow) {
@@ -29,6 +33,8 @@ class WorkspaceGroup extends Clutter.Actor {
         this._monitor = monitor;
         this._movingWindow = movingWindow;
         this._windowRecords = [];
+        this._frozenWindowActors = new Set();
+        this._snapshotUpdateId = 0;
 
         if (this._workspace) {
             this._background = new Meta.BackgroundGroup();
@@ -76,13 +82,16 @@ class WorkspaceGroup extends Clutter.Actor {
     }
 
     _syncStacking() {
-        const windowActors = global.get_window_actors().filter(w =>
-            this._shouldShowWindow(w.meta_window));
+        const windowActors = global.get_window_actors_model();
 
         let lastRecord;
         const bottomActor = this._background ?? null;
 
-        for (const windowActor of windowActors) {
+        for (let i = 0; i < windowActors.get_n_items(); i++) {
+            const windowActor = windowActors.get_item(i);
+            if (!this._shouldShowWindow(windowActor.meta_window))
+                continue;
+
             const record = this._windowRecords.find(r => r.windowActor === windowActor);
 
             this.set_child_above_sibling(record.clone,
@@ -127,12 +136,49 @@ class WorkspaceGroup extends Clutter.Actor {
         windowActor.connectObject('destroy', () => {
             clone.destroy();
             this._windowRecords.splice(this._windowRecords.indexOf(record), 1);
+            this._frozenWindowActors.delete(windowActor);
         }, this);
 
         this._windowRecords.push(record);
         return clone;
     }
 
+    /**
+     * Paints the workspace into an offscreen buffer that is moved around
+     * instead of all of its windows in every frame. The buffer is only
+     * painted again when windows are damaged, and their damage is only
+     * let through every SNAPSHOT_UPDATE_INTERVAL.
+     */
+    snapshot() {
+        if (this._snapshotUpdateId)
+            return;
+
+        this.set_offscreen_redirect(Clutter.OffscreenRedirect.ALWAYS);
+        this._freezeWindows();
+
+        this._snapshotUpdateId = GLib.timeout_add(GLib.PRIORITY_DEFAULT,
+            SNAPSHOT_UPDATE_INTERVAL, () => {
+                this._thawWindows();
+                this._freezeWindows();
+                return GLib.SOURCE_CONTINUE;
+            });
+        GLib.Source.set_name_by_id(this._snapshotUpdateId,
+            '[gnome-shell] WorkspaceGroup.snapshot');
+    }
+
+    _freezeWindows() {
+        for (const {windowActor} of this._windowRecords) {
+            windowActor.freeze();
+            this._frozenWindowActors.add(windowActor);
+        }
+    }
+
+    _thawWindows() {
+        for (const windowActor of this._frozenWindowActors)
+            windowActor.thaw();
+        this._frozenWindowActors.clear();
+    }
+
     _removeWindows() {
         for (const record of this._windowRecords)
             record.clone.destroy();
@@ -141,6 +187,11 @@ class WorkspaceGroup extends Clutter.Actor {
     }
 
     _onDestroy() {
+        if (this._snapshotUpdateId)
+            GLib.source_remove(this._snapshotUpdateId);
+        this._snapshotUpdateId = 0;
+        this._thawWindows();
+
         this._removeWindows();
 
         if (this._workspace)
@@ -156,7 +207,7 @@ export const MonitorGroup = GObject.registerClass({
             -Infinity, Infinity, 0),
     },
 }, class MonitorGroup extends St.Widget {
-    _init(monitor, workspaceIndices, movingWindow) {
+    _init(monitor, workspaceIndices, movingWindow, snapshot) {
         super._init({
             clip_to_allocation: true,
             style_class: 'workspace-animation',
@@ -194,6 +245,8 @@ export const MonitorGroup = GObject.registerClass({
             }
 
             const group = new WorkspaceGroup(ws, monitor, movingWindow);
+            if (snapshot)
+                group.snapshot();
 
             this._workspaceGroups.push(group);
             this._container.add_child(group);
@@ -362,13 +415,16 @@ export class WorkspaceAnimationController {
 
         const monitors = Meta.prefs_get_workspaces_only_on_primary()
             ? [Main.layoutManager.primaryMonitor] : Main.layoutManager.monitors;
+        const snapshot =
+            global.settings.get_boolean('workspace-animation-snapshots');
 
         for (const monitor of monitors) {
             if (Meta.prefs_get_workspaces_only_on_primary() &&
                 monitor.index !== Main.layoutManager.primaryIndex)
                 continue;
 
-            const group = new MonitorGroup(monitor, workspaceIndices, this.movingWindow);
+            const group = new MonitorGroup(monitor, workspaceIndices,
+                this.movingWindow, snapshot);
 
             Main.uiGroup.insert_child_above(group, global.window_group);
 
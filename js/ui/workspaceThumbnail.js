@@ -67,6 +67,10 @@ export const WindowClone = GObject.registerClass({
         });
         this._delegate = this;
 
+        // Render the window and its dialogs at the size of the thumbnail,
+        // and only pick up their damage every now and then
+        this.add_effect(new Shell.ThumbnailEffect());
+
         this.add_child(clone);
         this.realWindow = realWindow;
         this.metaWindow = realWindow.meta_window;
@@ -598,6 +602,7 @@ export const ThumbnailsBox = GObject.registerClass({
         });
 
         this._delegate = this;
+        DND.addDropTarget(this);
 
         let indicator = new St.Bin({style_class: 'workspace-thumbnail-indicator'});
 
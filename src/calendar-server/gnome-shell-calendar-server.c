@@ -51,11 +51,12 @@ static const gchar introspection_xml[] =
   "      <arg type='x' name='until' direction='in'/>"
   "      <arg type='b' name='force_reload' direction='in'/>"
   "    </method>"
-  "    <signal name='EventsAddedOrUpdated'>"
-  "      <arg type='a(ssxxa{sv})' name='events' direction='out'/>"
-  "    </signal>"
-  "    <signal name='EventsRemoved'>"
+  "    <signal name='EventsChanged'>"
+  "      <arg type='as' name='removed_ids' direction='out'/>"
   "      <arg type='as' name='ids' direction='out'/>"
+  "      <arg type='as' name='summaries' direction='out'/>"
+  "      <arg type='ax' name='start_times' direction='out'/>"
+  "      <arg type='ax' name='end_times' direction='out'/>"
   "    </signal>"
   "    <signal name='ClientDisappeared'>"
   "      <arg type='s' name='source_uid' direction='out'/>"
@@ -319,13 +320,16 @@ struct _App
 
   gchar *timezone_location;
 
-  GSList *notify_appointments; /* CalendarAppointment *, for EventsAdded */
-  GSList *notify_ids; /* gchar *, for EventsRemoved */
+  GHashTable *notify_series; /* gchar * series ID, for EventsChanged */
+  GHashTable *notify_ids; /* gchar * removed ID, for EventsChanged */
+  guint notify_source_id;
 
   GSList *live_views;
+  GHashTable *view_states; /* ECalClientView * -> ViewState * */
+  GHashTable *source_caches; /* gchar * source UID -> SourceCache * */
 };
 
-static void
+static gboolean
 app_update_timezone (App *app)
 {
   g_autofree char *location = NULL;
@@ -340,185 +344,653 @@ app_update_timezone (App *app)
       g_free (app->timezone_location);
       app->timezone_location = g_steal_pointer (&location);
       print_debug ("Using timezone %s", app->timezone_location);
+
+      return TRUE;
     }
+
+  return FALSE;
+}
+
+static gboolean
+appointment_in_range (CalendarAppointment *appt,
+                      time_t               since,
+                      time_t               until)
+{
+  return (appt->start_time >= since &&
+          appt->start_time < until) ||
+         (appt->start_time <= since &&
+          (appt->end_time - 1) > since);
+}
+
+/* The instances expanded for each source are cached, for one interval
+ * around the requested range, so that moving the range back and forth
+ * only expands what the cache doesn't cover yet: the cached instances
+ * of the range are signaled right away, and views are only started for
+ * the rest of it. Each view keeps the instances of its own interval up
+ * to date. Once the interval would grow past CACHE_MAX_SPAN, the cache
+ * starts over with the requested range.
+ */
+#define CACHE_MAX_SPAN (400 * 24 * 60 * 60)
+
+typedef struct
+{
+  time_t since;
+  time_t until;
+  GHashTable *series; /* gchar * series ID -> GHashTable of gchar * ID -> CalendarAppointment * */
+} SourceCache;
+
+/* The ID without RID, which all instances of a series share */
+static gchar *
+series_id_from_event_id (const gchar *id)
+{
+  return g_strndup (id, strrchr (id, '\n') - id + 1);
+}
+
+static SourceCache *
+source_cache_new (time_t since,
+                  time_t until)
+{
+  SourceCache *cache;
+
+  cache = g_new0 (SourceCache, 1);
+  cache->since = since;
+  cache->until = until;
+  cache->series = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                         (GDestroyNotify) g_hash_table_unref);
+
+  return cache;
 }
 
 static void
-app_notify_events_added (App *app)
+source_cache_free (SourceCache *cache)
 {
-  GVariantBuilder builder, extras_builder;
-  GSList *events, *link;
+  g_hash_table_destroy (cache->series);
+  g_free (cache);
+}
 
-  events = g_slist_reverse (app->notify_appointments);
-  app->notify_appointments = NULL;
+static gboolean
+source_cache_covers (SourceCache *cache,
+                     time_t       since,
+                     time_t       until)
+{
+  return since >= cache->since && until <= cache->until;
+}
 
-  print_debug ("Emitting EventsAddedOrUpdated with %d events", g_slist_length (events));
+/* Whether the cached interval can grow to include [since, until) without
+ * leaving a gap */
+static gboolean
+source_cache_can_extend (SourceCache *cache,
+                         time_t       since,
+                         time_t       until)
+{
+  return since <= cache->until && until >= cache->since &&
+         MAX (until, cache->until) - MIN (since, cache->since) <= CACHE_MAX_SPAN;
+}
 
-  if (!events)
-    return;
+/* Replaces the cached instances of a series in [since, until) by
+ * the ones just expanded, which it takes, and returns all instances
+ * of the series, or %NULL if there are none left */
+static GHashTable *
+source_cache_update_series (SourceCache *cache,
+                            const gchar *series_id,
+                            GSList      *appointments,
+                            time_t       since,
+                            time_t       until)
+{
+  GHashTable *instances;
+  GHashTableIter iter;
+  CalendarAppointment *appt;
+  GSList *link;
+
+  instances = g_hash_table_lookup (cache->series, series_id);
+  if (instances == NULL)
+    {
+      if (appointments == NULL)
+        return NULL;
+
+      /* The keys are the IDs of the instances */
+      instances = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                         calendar_appointment_free);
+      g_hash_table_insert (cache->series, g_strdup (series_id), instances);
+    }
+
+  g_hash_table_iter_init (&iter, instances);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &appt))
+    {
+      if (appointment_in_range (appt, since, until))
+        g_hash_table_iter_remove (&iter);
+    }
 
-  /* The a{sv} is used as an escape hatch in case we want to provide more
-   * information in the future without breaking ABI
-   */
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssxxa{sv})"));
-  for (link = events; link; link = g_slist_next (link))
+  for (link = appointments; link; link = g_slist_next (link))
     {
-      CalendarAppointment *appt = link->data;
-      time_t start_time = appt->start_time;
-      time_t end_time   = appt->end_time;
-
-      if ((start_time >= app->since &&
-           start_time < app->until) ||
-          (start_time <= app->since &&
-          (end_time - 1) > app->since))
+      appt = link->data;
+      g_hash_table_replace (instances, appt->id, appt);
+    }
+  g_slist_free (appointments);
+
+  if (g_hash_table_size (instances) == 0)
+    {
+      g_hash_table_remove (cache->series, series_id);
+      return NULL;
+    }
+
+  return instances;
+}
+
+/* Drops the cached instances a view of [since, until) reported removed,
+ * and returns whether that was a whole series */
+static gboolean
+source_cache_remove (SourceCache *cache,
+                     const gchar *id,
+                     time_t       since,
+                     time_t       until)
+{
+  g_autofree gchar *series_id = NULL;
+  GHashTable *instances;
+
+  series_id = series_id_from_event_id (id);
+  instances = g_hash_table_lookup (cache->series, series_id);
+  if (instances == NULL)
+    return FALSE;
+
+  if (g_strcmp0 (id, series_id) != 0)
+    {
+      g_hash_table_remove (instances, id);
+      if (g_hash_table_size (instances) == 0)
+        g_hash_table_remove (cache->series, series_id);
+
+      return FALSE;
+    }
+
+  /* Other views may still have instances of the series */
+  source_cache_update_series (cache, series_id, NULL, since, until);
+
+  return TRUE;
+}
+
+/* Changes are signaled at most once per NOTIFY_INTERVAL_MS, in one
+ * EventsChanged signal, with one array per field rather than one
+ * structure per event. Only the IDs of changed series are kept until
+ * then, and their instances are looked up in the caches when
+ * signaling, so that later changes of a series replace earlier ones.
+ * The IDs in removed_ids are to be removed first, along with the IDs
+ * that start with them, then the events are added or updated; as
+ * the shell removes all instances of a series before adding the ones
+ * it is sent, every series is sent whole.
+ */
+#define NOTIFY_INTERVAL_MS 16
+
+static gboolean
+app_notify_events_changed (gpointer user_data)
+{
+  App *app = user_data;
+  GVariantBuilder removed_builder;
+  GVariantBuilder ids_builder;
+  GVariantBuilder summaries_builder;
+  GVariantBuilder start_times_builder;
+  GVariantBuilder end_times_builder;
+  GHashTableIter iter;
+  const gchar *id;
+  guint n_events = 0;
+
+  app->notify_source_id = 0;
+
+  g_variant_builder_init (&removed_builder, G_VARIANT_TYPE ("as"));
+  g_variant_builder_init (&ids_builder, G_VARIANT_TYPE ("as"));
+  g_variant_builder_init (&summaries_builder, G_VARIANT_TYPE ("as"));
+  g_variant_builder_init (&start_times_builder, G_VARIANT_TYPE ("ax"));
+  g_variant_builder_init (&end_times_builder, G_VARIANT_TYPE ("ax"));
+
+  g_hash_table_iter_init (&iter, app->notify_ids);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &id, NULL))
+    g_variant_builder_add (&removed_builder, "s", id);
+
+  g_hash_table_iter_init (&iter, app->notify_series);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &id, NULL))
+    {
+      g_autofree gchar *source_uid = NULL;
+      SourceCache *cache;
+      GHashTable *instances;
+      GHashTableIter instances_iter;
+      CalendarAppointment *appt;
+
+      /* Gone since, along with its removal or its source */
+      source_uid = g_strndup (id, strchr (id, '\n') - id);
+      cache = g_hash_table_lookup (app->source_caches, source_uid);
+      instances = cache ? g_hash_table_lookup (cache->series, id) : NULL;
+      if (instances == NULL)
+        continue;
+
+      g_hash_table_iter_init (&instances_iter, instances);
+      while (g_hash_table_iter_next (&instances_iter, NULL, (gpointer *) &appt))
         {
-          g_variant_builder_init (&extras_builder, G_VARIANT_TYPE ("a{sv}"));
-          g_variant_builder_add (&builder,
-                                 "(ssxxa{sv})",
-                                 appt->id,
-                                 appt->summary != NULL ? appt->summary : "",
-                                 (gint64) start_time,
-                                 (gint64) end_time,
-                                 &extras_builder);
+          if (!appointment_in_range (appt, app->since, app->until))
+            continue;
+
+          g_variant_builder_add (&ids_builder, "s", appt->id);
+          g_variant_builder_add (&summaries_builder, "s",
+                                 appt->summary != NULL ? appt->summary : "");
+          g_variant_builder_add (&start_times_builder, "x", (gint64) appt->start_time);
+          g_variant_builder_add (&end_times_builder, "x", (gint64) appt->end_time);
+          n_events++;
         }
     }
 
-  g_dbus_connection_emit_signal (app->connection,
-                                 NULL, /* destination_bus_name */
-                                 "/org/gnome/Shell/CalendarServer",
-                                 "org.gnome.Shell.CalendarServer",
-                                 "EventsAddedOrUpdated",
-                                 g_variant_new ("(a(ssxxa{sv}))", &builder),
-                                 NULL);
+  print_debug ("Emitting EventsChanged with %u removed ids and %u events",
+               g_hash_table_size (app->notify_ids), n_events);
+
+  if (g_hash_table_size (app->notify_ids) > 0 || n_events > 0)
+    {
+      g_dbus_connection_emit_signal (app->connection,
+                                     NULL, /* destination_bus_name */
+                                     "/org/gnome/Shell/CalendarServer",
+                                     "org.gnome.Shell.CalendarServer",
+                                     "EventsChanged",
+                                     g_variant_new ("(asasasaxax)",
+                                                    &removed_builder,
+                                                    &ids_builder,
+                                                    &summaries_builder,
+                                                    &start_times_builder,
+                                                    &end_times_builder),
+                                     NULL);
+    }
+  else
+    {
+      g_variant_builder_clear (&removed_builder);
+      g_variant_builder_clear (&ids_builder);
+      g_variant_builder_clear (&summaries_builder);
+      g_variant_builder_clear (&start_times_builder);
+      g_variant_builder_clear (&end_times_builder);
+    }
 
-  g_variant_builder_clear (&builder);
+  g_hash_table_remove_all (app->notify_ids);
+  g_hash_table_remove_all (app->notify_series);
 
-  g_slist_free_full (events, calendar_appointment_free);
+  return G_SOURCE_REMOVE;
 }
 
 static void
-app_notify_events_removed (App *app)
+app_schedule_notify (App *app)
 {
-  GVariantBuilder builder;
-  GSList *ids, *link;
+  if (app->notify_source_id != 0)
+    return;
 
-  ids = app->notify_ids;
-  app->notify_ids = NULL;
+  app->notify_source_id = g_timeout_add (NOTIFY_INTERVAL_MS,
+                                         app_notify_events_changed,
+                                         app);
+  g_source_set_name_by_id (app->notify_source_id, "[gnome-shell-calendar-server] notify");
+}
 
-  print_debug ("Emitting EventsRemoved with %d ids", g_slist_length (ids));
+static void
+app_queue_series (App         *app,
+                  const gchar *series_id)
+{
+  g_hash_table_add (app->notify_series, g_strdup (series_id));
+  app_schedule_notify (app);
+}
 
-  if (!ids)
-    return;
+static void
+app_queue_removed (App         *app,
+                   const gchar *id)
+{
+  g_hash_table_add (app->notify_ids, g_strdup (id));
+  app_schedule_notify (app);
+}
 
-  g_variant_builder_init (&builder, G_VARIANT_TYPE ("as"));
-  for (link = ids; link; link = g_slist_next (link))
-    {
-      const gchar *id = link->data;
+static void
+app_queue_cached (App         *app,
+                  SourceCache *cache)
+{
+  GHashTableIter iter;
+  const gchar *series_id;
 
-      g_variant_builder_add (&builder, "s", id);
-    }
+  g_hash_table_iter_init (&iter, cache->series);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &series_id, NULL))
+    app_queue_series (app, series_id);
+}
 
-  g_dbus_connection_emit_signal (app->connection,
-                                 NULL, /* destination_bus_name */
-                                 "/org/gnome/Shell/CalendarServer",
-                                 "org.gnome.Shell.CalendarServer",
-                                 "EventsRemoved",
-                                 g_variant_new ("(as)", &builder),
-                                 NULL);
-  g_variant_builder_clear (&builder);
+/* Expanding recurrences takes calls to the calendar backend for every
+ * object, so objects are expanded in threads, in chunks of
+ * EXPAND_CHUNK_SIZE, and the instances of each chunk are queued for
+ * signaling as soon as the chunk is done. Changes of a view are applied
+ * in the order they were reported: a batch of changes only starts once
+ * all chunks of the one before are done, so that an older version of an
+ * object can't overwrite a newer one.
+ */
+#define EXPAND_CHUNK_SIZE 8
 
-  g_slist_free_full (ids, g_free);
+typedef struct
+{
+  GPtrArray *objects; /* ICalComponent *, added or modified */
+  GSList *removed_ids; /* gchar *, removed */
+} ViewBatch;
 
-  return;
+typedef struct
+{
+  gchar *source_uid;
+  time_t since; /* the interval of the view */
+  time_t until;
+  GCancellable *cancellable;
+  GQueue batches; /* ViewBatch *, waiting for the running one */
+  guint n_running; /* chunks of the running batch */
+} ViewState;
+
+typedef struct
+{
+  gchar *series_id;
+  GSList *appointments; /* CalendarAppointment * */
+} ExpandedObject;
+
+typedef struct
+{
+  ECalClient *client;
+  GPtrArray *objects; /* ICalComponent * */
+  time_t since;
+  time_t until;
+} ExpandChunk;
+
+static void
+view_batch_free (ViewBatch *batch)
+{
+  g_clear_pointer (&batch->objects, g_ptr_array_unref);
+  g_slist_free_full (batch->removed_ids, g_free);
+  g_free (batch);
 }
 
 static void
-app_process_added_modified_objects (App *app,
-                                    ECalClientView *view,
-                                    GSList *objects) /* ICalComponent * */
+view_state_free (ViewState *state)
 {
-  ECalClient *cal_client;
-  g_autoptr(GHashTable) covered_uids = NULL;
-  GSList *link;
+  g_cancellable_cancel (state->cancellable);
+  g_object_unref (state->cancellable);
+  g_queue_clear_full (&state->batches, (GDestroyNotify) view_batch_free);
+  g_free (state->source_uid);
+  g_free (state);
+}
+
+static void
+expand_chunk_free (ExpandChunk *chunk)
+{
+  g_object_unref (chunk->client);
+  g_ptr_array_unref (chunk->objects);
+  g_free (chunk);
+}
+
+static void
+expanded_object_free (ExpandedObject *object)
+{
+  g_free (object->series_id);
+  g_slist_free_full (object->appointments, calendar_appointment_free);
+  g_free (object);
+}
+
+static ExpandedObject *
+expand_object (ECalClient     *cal_client,
+               ICalComponent  *icomp,
+               time_t          since,
+               time_t          until,
+               GCancellable   *cancellable)
+{
+  ExpandedObject *object;
+  GSList **appointments;
+  ECalComponent *comp;
   gboolean expand_recurrences;
+  gboolean fallback = FALSE;
+
+  object = g_new0 (ExpandedObject, 1);
+  object->series_id = create_event_id (e_source_get_uid (e_client_get_source (E_CLIENT (cal_client))),
+                                       i_cal_component_get_uid (icomp),
+                                       NULL);
+  appointments = &object->appointments;
 
-  cal_client = e_cal_client_view_ref_client (view);
-  covered_uids = g_hash_table_new (g_str_hash, g_str_equal);
   expand_recurrences = e_cal_client_get_source_type (cal_client) == E_CAL_CLIENT_SOURCE_TYPE_EVENTS;
 
-  for (link = objects; link; link = g_slist_next (link))
+  if (expand_recurrences &&
+      !e_cal_util_component_is_instance (icomp) &&
+      e_cal_util_component_has_recurrences (icomp))
     {
-      ECalComponent *comp;
-      ICalComponent *icomp = link->data;
-      const gchar *uid;
-      gboolean fallback = FALSE;
+      CollectAppointmentsData data;
 
-      if (!icomp)
-        continue;
-
-      uid = i_cal_component_get_uid (icomp);
-      if (!uid || g_hash_table_contains (covered_uids, uid))
-        continue;
+      data.client = cal_client;
+      data.pappointments = appointments;
 
-      g_hash_table_add (covered_uids, (gpointer) uid);
+      e_cal_client_generate_instances_for_object_sync (cal_client, icomp, since, until, cancellable,
+                                                       generate_instances_cb, &data);
+    }
+  else if (expand_recurrences &&
+           e_cal_util_component_is_instance (icomp))
+    {
+      ICalComponent *main_comp = NULL;
 
-      if (expand_recurrences &&
-          !e_cal_util_component_is_instance (icomp) &&
-          e_cal_util_component_has_recurrences (icomp))
+      /* Always pass whole series of the recurring events, because
+       * the calendar removes events with the same UID first. */
+      if (e_cal_client_get_object_sync (cal_client, i_cal_component_get_uid (icomp), NULL,
+                                        &main_comp, cancellable, NULL))
         {
           CollectAppointmentsData data;
 
           data.client = cal_client;
-          data.pappointments = &app->notify_appointments;
+          data.pappointments = appointments;
 
-          e_cal_client_generate_instances_for_object_sync (cal_client, icomp, app->since, app->until, NULL,
+          e_cal_client_generate_instances_for_object_sync (cal_client, main_comp, since, until, cancellable,
                                                            generate_instances_cb, &data);
+
+          g_clear_object (&main_comp);
         }
-      else if (expand_recurrences &&
-               e_cal_util_component_is_instance (icomp))
+      else
         {
-          ICalComponent *main_comp = NULL;
+          fallback = TRUE;
+        }
+    }
+  else
+    {
+      fallback = TRUE;
+    }
 
-          /* Always pass whole series of the recurring events, because
-           * the calendar removes events with the same UID first. */
-          if (e_cal_client_get_object_sync (cal_client, uid, NULL, &main_comp, NULL, NULL))
-            {
-              CollectAppointmentsData data;
+  if (fallback)
+    {
+      comp = e_cal_component_new_from_icalcomponent (i_cal_component_clone (icomp));
+      if (comp)
+        {
+          *appointments = g_slist_prepend (*appointments,
+                                           calendar_appointment_new (cal_client, comp));
+          g_object_unref (comp);
+        }
+    }
 
-              data.client = cal_client;
-              data.pappointments = &app->notify_appointments;
+  return object;
+}
 
-              e_cal_client_generate_instances_for_object_sync (cal_client, main_comp, app->since, app->until, NULL,
-                                                               generate_instances_cb, &data);
+static void
+expand_chunk_thread (GTask        *task,
+                     gpointer      source_object,
+                     gpointer      task_data,
+                     GCancellable *cancellable)
+{
+  ExpandChunk *chunk = task_data;
+  GPtrArray *objects;
+  guint i;
 
-              g_clear_object (&main_comp);
-            }
-          else
+  objects = g_ptr_array_new_with_free_func ((GDestroyNotify) expanded_object_free);
+
+  for (i = 0; i < chunk->objects->len; i++)
+    {
+      if (g_cancellable_is_cancelled (cancellable))
+        break;
+
+      g_ptr_array_add (objects,
+                       expand_object (chunk->client, g_ptr_array_index (chunk->objects, i),
+                                      chunk->since, chunk->until, cancellable));
+    }
+
+  g_task_return_pointer (task, objects, (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void app_run_view_batches (App            *app,
+                                  ECalClientView *view,
+                                  ViewState      *state);
+
+static void
+on_chunk_expanded (GObject      *source_object,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+  App *app = user_data;
+  ECalClientView *view = E_CAL_CLIENT_VIEW (source_object);
+  g_autoptr (GPtrArray) objects = NULL;
+  ViewState *state;
+  SourceCache *cache;
+  guint i;
+
+  /* The view was stopped */
+  objects = g_task_propagate_pointer (G_TASK (result), NULL);
+  state = g_hash_table_lookup (app->view_states, view);
+  if (objects == NULL || state == NULL ||
+      g_task_get_cancellable (G_TASK (result)) != state->cancellable)
+    return;
+
+  cache = g_hash_table_lookup (app->source_caches, state->source_uid);
+
+  for (i = 0; i < objects->len; i++)
+    {
+      ExpandedObject *object = g_ptr_array_index (objects, i);
+
+      if (source_cache_update_series (cache, object->series_id,
+                                      g_steal_pointer (&object->appointments),
+                                      state->since, state->until))
+        app_queue_series (app, object->series_id);
+    }
+
+  state->n_running--;
+  if (state->n_running == 0)
+    app_run_view_batches (app, view, state);
+}
+
+static void
+app_start_expand_chunk (App            *app,
+                        ECalClientView *view,
+                        ViewState      *state,
+                        GPtrArray      *objects)
+{
+  g_autoptr (GTask) task = NULL;
+  ExpandChunk *chunk;
+
+  chunk = g_new0 (ExpandChunk, 1);
+  chunk->client = e_cal_client_view_ref_client (view);
+  chunk->objects = objects;
+  chunk->since = state->since;
+  chunk->until = state->until;
+
+  task = g_task_new (view, state->cancellable, on_chunk_expanded, app);
+  g_task_set_source_tag (task, app_start_expand_chunk);
+  g_task_set_task_data (task, chunk, (GDestroyNotify) expand_chunk_free);
+  g_task_run_in_thread (task, expand_chunk_thread);
+
+  state->n_running++;
+}
+
+static void
+app_run_view_batches (App            *app,
+                      ECalClientView *view,
+                      ViewState      *state)
+{
+  ViewBatch *batch;
+
+  while (state->n_running == 0 &&
+         (batch = g_queue_pop_head (&state->batches)) != NULL)
+    {
+      if (batch->removed_ids)
+        {
+          SourceCache *cache;
+          GSList *link;
+
+          cache = g_hash_table_lookup (app->source_caches, state->source_uid);
+
+          for (link = batch->removed_ids; link; link = g_slist_next (link))
             {
-               fallback = TRUE;
+              const gchar *id = link->data;
+
+              /* Put back what other views still have of the series */
+              if (source_cache_remove (cache, id, state->since, state->until))
+                app_queue_series (app, id);
+
+              app_queue_removed (app, id);
             }
         }
       else
         {
-	  fallback = TRUE;
-        }
+          GPtrArray *chunk = NULL;
+          guint i;
 
-      if (fallback)
-        {
-          comp = e_cal_component_new_from_icalcomponent (i_cal_component_clone (icomp));
-          if (!comp)
-            continue;
+          for (i = 0; i < batch->objects->len; i++)
+            {
+              if (chunk == NULL)
+                chunk = g_ptr_array_new_with_free_func (g_object_unref);
 
-          app->notify_appointments = g_slist_prepend (app->notify_appointments,
-                                                      calendar_appointment_new (cal_client, comp));
-          g_object_unref (comp);
+              g_ptr_array_add (chunk, g_object_ref (g_ptr_array_index (batch->objects, i)));
+
+              if (chunk->len == EXPAND_CHUNK_SIZE)
+                app_start_expand_chunk (app, view, state, g_steal_pointer (&chunk));
+            }
+
+          if (chunk)
+            app_start_expand_chunk (app, view, state, chunk);
         }
+
+      view_batch_free (batch);
     }
+}
+
+static void
+app_queue_view_batch (App            *app,
+                      ECalClientView *view,
+                      ViewBatch      *batch)
+{
+  ViewState *state;
+
+  state = g_hash_table_lookup (app->view_states, view);
+  if (state == NULL)
+    {
+      view_batch_free (batch);
+      return;
+    }
+
+  g_queue_push_tail (&state->batches, batch);
+  app_run_view_batches (app, view, state);
+}
+
+static void
+app_process_added_modified_objects (App *app,
+                                    ECalClientView *view,
+                                    GSList *objects) /* ICalComponent * */
+{
+  g_autoptr(GHashTable) covered_uids = NULL;
+  ViewBatch *batch;
+  GSList *link;
+
+  covered_uids = g_hash_table_new (g_str_hash, g_str_equal);
+
+  batch = g_new0 (ViewBatch, 1);
+  batch->objects = g_ptr_array_new_with_free_func (g_object_unref);
 
-  g_clear_object (&cal_client);
+  for (link = objects; link; link = g_slist_next (link))
+    {
+      ICalComponent *icomp = link->data;
+      const gchar *uid;
 
-  if (app->notify_appointments)
-    app_notify_events_added (app);
+      if (!icomp)
+        continue;
+
+      uid = i_cal_component_get_uid (icomp);
+      if (!uid || g_hash_table_contains (covered_uids, uid))
+        continue;
+
+      g_hash_table_add (covered_uids, (gpointer) uid);
+
+      /* The objects only live as long as the signal emission */
+      g_ptr_array_add (batch->objects, i_cal_component_clone (icomp));
+    }
+
+  app_queue_view_batch (app, view, batch);
 }
 
 static void
@@ -558,6 +1030,7 @@ on_objects_removed (ECalClientView *view,
 {
   App *app = user_data;
   ECalClient *client;
+  ViewBatch *batch;
   GSList *link;
   const gchar *source_uid;
 
@@ -566,6 +1039,8 @@ on_objects_removed (ECalClientView *view,
 
   print_debug ("%s (%d) for calendar '%s'", G_STRFUNC, g_slist_length (uids), source_uid);
 
+  batch = g_new0 (ViewBatch, 1);
+
   for (link = uids; link; link = g_slist_next (link))
     {
       ECalComponentId *id = link->data;
@@ -573,16 +1048,18 @@ on_objects_removed (ECalClientView *view,
       if (!id)
         continue;
 
-      app->notify_ids = g_slist_prepend (app->notify_ids,
-                                         create_event_id (source_uid,
-                                         e_cal_component_id_get_uid (id),
-                                         e_cal_component_id_get_rid (id)));
+      batch->removed_ids = g_slist_prepend (batch->removed_ids,
+                                            create_event_id (source_uid,
+                                            e_cal_component_id_get_uid (id),
+                                            e_cal_component_id_get_rid (id)));
     }
 
   g_clear_object (&client);
 
-  if (app->notify_ids)
-    app_notify_events_removed (app);
+  if (batch->removed_ids)
+    app_queue_view_batch (app, view, batch);
+  else
+    view_batch_free (batch);
 }
 
 static gboolean
@@ -593,29 +1070,29 @@ app_has_calendars (App *app)
 
 static ECalClientView *
 app_start_view (App *app,
-                ECalClient *cal_client)
+                ECalClient *cal_client,
+                time_t since,
+                time_t until)
 {
   g_autofree char *since_iso8601 = NULL;
   g_autofree char *until_iso8601 = NULL;
   g_autofree char *query = NULL;
   const gchar *tz_location;
   ECalClientView *view = NULL;
+  ViewState *state;
   g_autoptr (GError) error = NULL;
 
-  if (app->since <= 0 || app->since >= app->until)
+  if (since <= 0 || since >= until)
     return NULL;
 
-  if (!app->since || !app->until)
+  if (!since || !until)
     {
       print_debug ("Skipping load of events, no time interval set yet");
       return NULL;
     }
 
-  /* timezone could have changed */
-  app_update_timezone (app);
-
-  since_iso8601 = isodate_from_time_t (app->since);
-  until_iso8601 = isodate_from_time_t (app->until);
+  since_iso8601 = isodate_from_time_t (since);
+  until_iso8601 = isodate_from_time_t (until);
   tz_location = i_cal_timezone_get_location (app->zone);
 
   print_debug ("Loading events since %s until %s for calendar '%s'",
@@ -650,6 +1127,15 @@ app_start_view (App *app,
                         "objects-removed",
                         G_CALLBACK (on_objects_removed),
                         app);
+
+      state = g_new0 (ViewState, 1);
+      state->source_uid = g_strdup (e_source_get_uid (e_client_get_source (E_CLIENT (cal_client))));
+      state->since = since;
+      state->until = until;
+      state->cancellable = g_cancellable_new ();
+      g_queue_init (&state->batches);
+      g_hash_table_insert (app->view_states, view, state);
+
       e_cal_client_view_start (view, NULL);
     }
 
@@ -665,6 +1151,92 @@ app_stop_view (App *app,
       g_signal_handlers_disconnect_by_func (view, on_objects_added, app);
       g_signal_handlers_disconnect_by_func (view, on_objects_modified, app);
       g_signal_handlers_disconnect_by_func (view, on_objects_removed, app);
+
+      /* Drops changes that are still being expanded */
+      g_hash_table_remove (app->view_states, view);
+}
+
+static gboolean
+app_add_view (App *app,
+              ECalClient *cal_client,
+              time_t since,
+              time_t until)
+{
+  ECalClientView *view;
+
+  view = app_start_view (app, cal_client, since, until);
+  if (!view)
+    return FALSE;
+
+  app->live_views = g_slist_prepend (app->live_views, view);
+
+  return TRUE;
+}
+
+/* Stops the views of a source and drops its cache */
+static gboolean
+app_drop_source (App *app,
+                 const gchar *source_uid)
+{
+  GSList *link, *next;
+
+  for (link = app->live_views; link; link = next)
+    {
+      ECalClientView *view = link->data;
+      ViewState *state;
+
+      next = g_slist_next (link);
+
+      state = g_hash_table_lookup (app->view_states, view);
+      if (state == NULL || g_strcmp0 (state->source_uid, source_uid) != 0)
+        continue;
+
+      app_stop_view (app, view);
+      app->live_views = g_slist_delete_link (app->live_views, link);
+      g_object_unref (view);
+    }
+
+  return g_hash_table_remove (app->source_caches, source_uid);
+}
+
+static void
+app_update_source (App *app,
+                   ECalClient *cal_client,
+                   gboolean force_reload)
+{
+  const gchar *source_uid;
+  SourceCache *cache;
+
+  source_uid = e_source_get_uid (e_client_get_source (E_CLIENT (cal_client)));
+  cache = g_hash_table_lookup (app->source_caches, source_uid);
+
+  if (cache && !force_reload &&
+      source_cache_can_extend (cache, app->since, app->until))
+    {
+      print_debug ("Sending cached events for calendar '%s'", source_uid);
+
+      app_queue_cached (app, cache);
+
+      if (source_cache_covers (cache, app->since, app->until))
+        return;
+
+      /* Only expand what isn't cached yet */
+      if (app->since < cache->since &&
+          app_add_view (app, cal_client, app->since, cache->since))
+        cache->since = app->since;
+
+      if (app->until > cache->until &&
+          app_add_view (app, cal_client, cache->until, app->until))
+        cache->until = app->until;
+
+      return;
+    }
+
+  app_drop_source (app, source_uid);
+
+  if (app_add_view (app, cal_client, app->since, app->until))
+    g_hash_table_insert (app->source_caches, g_strdup (source_uid),
+                         source_cache_new (app->since, app->until));
 }
 
 static void
@@ -690,34 +1262,28 @@ app_notify_has_calendars (App *app)
 }
 
 static void
-app_update_views (App *app)
+app_update_views (App *app,
+                  gboolean force_reload)
 {
   GSList *link, *clients;
   gboolean had_views, has_views;
 
   had_views = app->live_views != NULL;
 
-  for (link = app->live_views; link; link = g_slist_next (link))
-    {
-      app_stop_view (app, link->data);
-    }
-
-  g_slist_free_full (app->live_views, g_object_unref);
-  app->live_views = NULL;
+  /* Floating times of the cached instances are off now */
+  if (app_update_timezone (app))
+    force_reload = TRUE;
 
   clients = calendar_sources_ref_clients (app->sources);
 
   for (link = clients; link; link = g_slist_next (link))
     {
       ECalClient *cal_client = link->data;
-      ECalClientView *view;
 
       if (!cal_client)
         continue;
 
-      view = app_start_view (app, cal_client);
-      if (view)
-        app->live_views = g_slist_prepend (app->live_views, view);
+      app_update_source (app, cal_client, force_reload);
     }
 
   has_views = app->live_views != NULL;
@@ -734,42 +1300,21 @@ on_client_appeared_cb (CalendarSources *sources,
                        gpointer user_data)
 {
   App *app = user_data;
-  ECalClientView *view;
-  GSList *link;
   const gchar *source_uid;
 
   source_uid = e_source_get_uid (e_client_get_source (E_CLIENT (client)));
 
   print_debug ("Client appeared '%s'", source_uid);
 
-  for (link = app->live_views; link; link = g_slist_next (link))
-    {
-      ECalClientView *view = link->data;
-      ECalClient *cal_client;
-      ESource *source;
-
-      cal_client = e_cal_client_view_ref_client (view);
-      source = e_client_get_source (E_CLIENT (cal_client));
-
-      if (g_strcmp0 (source_uid, e_source_get_uid (source)) == 0)
-        {
-          g_clear_object (&cal_client);
-          return;
-        }
-
-      g_clear_object (&cal_client);
-    }
-
-  view = app_start_view (app, client);
+  if (g_hash_table_contains (app->source_caches, source_uid))
+    return;
 
-  if (view)
-    {
-      app->live_views = g_slist_prepend (app->live_views, view);
+  app_update_timezone (app);
+  app_update_source (app, client, TRUE);
 
-      /* It's the first view, notify that it has calendars now */
-      if (!g_slist_next (app->live_views))
-        app_notify_has_calendars (app);
-    }
+  /* It's the first view, notify that it has calendars now */
+  if (app->live_views && !g_slist_next (app->live_views))
+    app_notify_has_calendars (app);
 }
 
 static void
@@ -778,45 +1323,25 @@ on_client_disappeared_cb (CalendarSources *sources,
                           gpointer user_data)
 {
   App *app = user_data;
-  GSList *link;
 
   print_debug ("Client disappeared '%s'", source_uid);
 
-  for (link = app->live_views; link; link = g_slist_next (link))
-    {
-      ECalClientView *view = link->data;
-      ECalClient *cal_client;
-      ESource *source;
-
-      cal_client = e_cal_client_view_ref_client (view);
-      source = e_client_get_source (E_CLIENT (cal_client));
-
-      if (g_strcmp0 (source_uid, e_source_get_uid (source)) == 0)
-        {
-          g_clear_object (&cal_client);
-          app_stop_view (app, view);
-          app->live_views = g_slist_remove (app->live_views, view);
-          g_object_unref (view);
-
-          print_debug ("Emitting ClientDisappeared for '%s'", source_uid);
-
-          g_dbus_connection_emit_signal (app->connection,
-                                         NULL, /* destination_bus_name */
-                                         "/org/gnome/Shell/CalendarServer",
-                                         "org.gnome.Shell.CalendarServer",
-                                         "ClientDisappeared",
-                                         g_variant_new ("(s)", source_uid),
-                                         NULL);
+  if (!app_drop_source (app, source_uid))
+    return;
 
-          /* It was the last view, notify that it doesn't have calendars now */
-          if (!app->live_views)
-            app_notify_has_calendars (app);
+  print_debug ("Emitting ClientDisappeared for '%s'", source_uid);
 
-          break;
-        }
+  g_dbus_connection_emit_signal (app->connection,
+                                 NULL, /* destination_bus_name */
+                                 "/org/gnome/Shell/CalendarServer",
+                                 "org.gnome.Shell.CalendarServer",
+                                 "ClientDisappeared",
+                                 g_variant_new ("(s)", source_uid),
+                                 NULL);
 
-      g_clear_object (&cal_client);
-    }
+  /* It was the last view, notify that it doesn't have calendars now */
+  if (!app->live_views)
+    app_notify_has_calendars (app);
 }
 
 static App *
@@ -827,6 +1352,12 @@ app_new (GDBusConnection *connection)
   app = g_new0 (App, 1);
   app->connection = g_object_ref (connection);
   app->sources = calendar_sources_get ();
+  app->view_states = g_hash_table_new_full (NULL, NULL, NULL,
+                                            (GDestroyNotify) view_state_free);
+  app->source_caches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                              (GDestroyNotify) source_cache_free);
+  app->notify_series = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  app->notify_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
   app->client_appeared_signal_id = g_signal_connect (app->sources,
                                                      "client-appeared",
                                                      G_CALLBACK (on_client_appeared_cb),
@@ -860,9 +1391,12 @@ app_free (App *app)
 
   g_free (app->timezone_location);
 
+  g_hash_table_destroy (app->view_states);
   g_slist_free_full (app->live_views, g_object_unref);
-  g_slist_free_full (app->notify_appointments, calendar_appointment_free);
-  g_slist_free_full (app->notify_ids, g_free);
+  g_clear_handle_id (&app->notify_source_id, g_source_remove);
+  g_hash_table_destroy (app->notify_series);
+  g_hash_table_destroy (app->notify_ids);
+  g_hash_table_destroy (app->source_caches);
 
   g_object_unref (app->connection);
   g_object_unref (app->sources);
@@ -943,7 +1477,7 @@ handle_method_call (GDBusConnection       *connection,
       g_dbus_method_invocation_return_value (invocation, NULL);
 
       if (window_changed || force_reload)
-        app_update_views (app);
+        app_update_views (app, force_reload);
     }
   else
     {
@@ -69,6 +69,15 @@ struct _GtkActionMuxer
   GHashTable *groups;
   GHashTable *primary_accels;
   GtkActionMuxer *parent;
+
+  /* Groups by full action name, looked up along the parent chain */
+  GHashTable *lookup_cache;
+  guint lookup_generation;
+
+  /* Latest enabled and state changes, notified once per iteration */
+  GHashTable *pending_enabled;
+  GHashTable *pending_states;
+  guint flush_changes_id;
 };
 
 G_DEFINE_TYPE_WITH_CODE (GtkActionMuxer, gtk_action_muxer, G_TYPE_OBJECT,
@@ -86,6 +95,15 @@ static GParamSpec *properties[NUM_PROPERTIES];
 
 guint accel_signal;
 
+/* Bumped whenever a group is inserted into or removed from any muxer or
+ * a muxer changes parent, invalidating the lookup caches of all muxers,
+ * since those of their children depend on them too
+ */
+static guint lookup_generation = 1;
+
+/* Drop the cache when it is filled with lookups of missing actions */
+#define MAX_CACHED_LOOKUPS 1024
+
 typedef struct
 {
   GtkActionMuxer *muxer;
@@ -166,6 +184,143 @@ gtk_action_muxer_find_group (GtkActionMuxer  *muxer,
   return group;
 }
 
+static void
+gtk_action_muxer_invalidate_lookups (void)
+{
+  lookup_generation++;
+}
+
+/* Finds the group of an action in @muxer or its parents, like
+ * gtk_action_muxer_find_group() on each of them in turn would
+ */
+static Group *
+gtk_action_muxer_lookup_group (GtkActionMuxer  *muxer,
+                               const gchar     *full_name,
+                               const gchar    **action_name)
+{
+  GtkActionMuxer *it;
+  Group *group = NULL;
+  gpointer cached;
+  const gchar *dot;
+
+  dot = strchr (full_name, '.');
+
+  if (!dot)
+    return NULL;
+
+  *action_name = dot + 1;
+
+  if (muxer->lookup_generation != lookup_generation ||
+      g_hash_table_size (muxer->lookup_cache) >= MAX_CACHED_LOOKUPS)
+    {
+      g_hash_table_remove_all (muxer->lookup_cache);
+      muxer->lookup_generation = lookup_generation;
+    }
+
+  if (g_hash_table_lookup_extended (muxer->lookup_cache, full_name, NULL, &cached))
+    return cached;
+
+  for (it = muxer; it != NULL && group == NULL; it = it->parent)
+    group = gtk_action_muxer_find_group (it, full_name, NULL);
+
+  g_hash_table_insert (muxer->lookup_cache, g_strdup (full_name), group);
+
+  return group;
+}
+
+static void gtk_action_muxer_action_enabled_changed (GtkActionMuxer *muxer,
+                                                     const gchar    *action_name,
+                                                     gboolean        enabled);
+static void gtk_action_muxer_action_state_changed   (GtkActionMuxer *muxer,
+                                                     const gchar    *action_name,
+                                                     GVariant       *state);
+
+static gboolean
+gtk_action_muxer_flush_changes (gpointer user_data)
+{
+  GtkActionMuxer *muxer = user_data;
+  g_autoptr (GHashTable) pending_enabled = NULL;
+  g_autoptr (GHashTable) pending_states = NULL;
+  GHashTableIter iter;
+  gpointer key, value;
+
+  muxer->flush_changes_id = 0;
+
+  /* Changes made by observers are queued for the next iteration */
+  pending_enabled = g_steal_pointer (&muxer->pending_enabled);
+  pending_states = g_steal_pointer (&muxer->pending_states);
+
+  g_object_ref (muxer);
+
+  if (pending_enabled)
+    {
+      g_hash_table_iter_init (&iter, pending_enabled);
+      while (g_hash_table_iter_next (&iter, &key, &value))
+        gtk_action_muxer_action_enabled_changed (muxer, key, GPOINTER_TO_INT (value));
+    }
+
+  if (pending_states)
+    {
+      g_hash_table_iter_init (&iter, pending_states);
+      while (g_hash_table_iter_next (&iter, &key, &value))
+        gtk_action_muxer_action_state_changed (muxer, key, value);
+    }
+
+  g_object_unref (muxer);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+gtk_action_muxer_queue_flush_changes (GtkActionMuxer *muxer)
+{
+  if (muxer->flush_changes_id != 0)
+    return;
+
+  /* Before redrawing, so menus don't show the old values */
+  muxer->flush_changes_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE,
+                                             gtk_action_muxer_flush_changes,
+                                             muxer, NULL);
+  g_source_set_name_by_id (muxer->flush_changes_id,
+                           "[gnome-shell] gtk_action_muxer_flush_changes");
+}
+
+static void
+gtk_action_muxer_queue_enabled_changed (GtkActionMuxer *muxer,
+                                        gchar          *action_name,
+                                        gboolean        enabled)
+{
+  if (!muxer->pending_enabled)
+    muxer->pending_enabled = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  g_hash_table_replace (muxer->pending_enabled, action_name, GINT_TO_POINTER (enabled));
+  gtk_action_muxer_queue_flush_changes (muxer);
+}
+
+static void
+gtk_action_muxer_queue_state_changed (GtkActionMuxer *muxer,
+                                      gchar          *action_name,
+                                      GVariant       *state)
+{
+  if (!muxer->pending_states)
+    muxer->pending_states = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                                   (GDestroyNotify) g_variant_unref);
+
+  g_hash_table_replace (muxer->pending_states, action_name, g_variant_ref (state));
+  gtk_action_muxer_queue_flush_changes (muxer);
+}
+
+/* Additions carry the current values, and removed actions have none */
+static void
+gtk_action_muxer_drop_pending_changes (GtkActionMuxer *muxer,
+                                       const gchar    *action_name)
+{
+  if (muxer->pending_enabled)
+    g_hash_table_remove (muxer->pending_enabled, action_name);
+  if (muxer->pending_states)
+    g_hash_table_remove (muxer->pending_states, action_name);
+}
+
 static void
 gtk_action_muxer_action_enabled_changed (GtkActionMuxer *muxer,
                                          const gchar    *action_name,
@@ -187,12 +342,10 @@ gtk_action_muxer_group_action_enabled_changed (GActionGroup *action_group,
                                                gpointer      user_data)
 {
   Group *group = user_data;
-  gchar *fullname;
 
-  fullname = g_strconcat (group->prefix, ".", action_name, NULL);
-  gtk_action_muxer_action_enabled_changed (group->muxer, fullname, enabled);
-
-  g_free (fullname);
+  gtk_action_muxer_queue_enabled_changed (group->muxer,
+                                          g_strconcat (group->prefix, ".", action_name, NULL),
+                                          enabled);
 }
 
 static void
@@ -203,7 +356,7 @@ gtk_action_muxer_parent_action_enabled_changed (GActionGroup *action_group,
 {
   GtkActionMuxer *muxer = user_data;
 
-  gtk_action_muxer_action_enabled_changed (muxer, action_name, enabled);
+  gtk_action_muxer_queue_enabled_changed (muxer, g_strdup (action_name), enabled);
 }
 
 static void
@@ -227,12 +380,10 @@ gtk_action_muxer_group_action_state_changed (GActionGroup *action_group,
                                              gpointer      user_data)
 {
   Group *group = user_data;
-  gchar *fullname;
-
-  fullname = g_strconcat (group->prefix, ".", action_name, NULL);
-  gtk_action_muxer_action_state_changed (group->muxer, fullname, state);
 
-  g_free (fullname);
+  gtk_action_muxer_queue_state_changed (group->muxer,
+                                        g_strconcat (group->prefix, ".", action_name, NULL),
+                                        state);
 }
 
 static void
@@ -243,7 +394,7 @@ gtk_action_muxer_parent_action_state_changed (GActionGroup *action_group,
 {
   GtkActionMuxer *muxer = user_data;
 
-  gtk_action_muxer_action_state_changed (muxer, action_name, state);
+  gtk_action_muxer_queue_state_changed (muxer, g_strdup (action_name), state);
 }
 
 static void
@@ -257,6 +408,8 @@ gtk_action_muxer_action_added (GtkActionMuxer *muxer,
   GVariant *state;
   Action *action;
 
+  gtk_action_muxer_drop_pending_changes (muxer, action_name);
+
   action = g_hash_table_lookup (muxer->observed_actions, action_name);
 
   if (action && action->watchers &&
@@ -308,6 +461,8 @@ gtk_action_muxer_action_removed (GtkActionMuxer *muxer,
   Action *action;
   GSList *node;
 
+  gtk_action_muxer_drop_pending_changes (muxer, action_name);
+
   action = g_hash_table_lookup (muxer->observed_actions, action_name);
   for (node = action ? action->watchers : NULL; node; node = node->next)
     gtk_action_observer_action_removed (node->data, GTK_ACTION_OBSERVABLE (muxer), action_name);
@@ -384,17 +539,12 @@ gtk_action_muxer_query_action (GActionGroup        *action_group,
   Group *group;
   const gchar *unprefixed_name;
 
-  group = gtk_action_muxer_find_group (muxer, action_name, &unprefixed_name);
+  group = gtk_action_muxer_lookup_group (muxer, action_name, &unprefixed_name);
 
   if (group)
     return g_action_group_query_action (group->group, unprefixed_name, enabled,
                                         parameter_type, state_type, state_hint, state);
 
-  if (muxer->parent)
-    return g_action_group_query_action (G_ACTION_GROUP (muxer->parent), action_name,
-                                        enabled, parameter_type,
-                                        state_type, state_hint, state);
-
   return FALSE;
 }
 
@@ -427,7 +577,7 @@ gtk_action_muxer_activate_action (GActionGroup *action_group,
   Group *group;
   const gchar *unprefixed_name;
 
-  group = gtk_action_muxer_find_group (muxer, action_name, &unprefixed_name);
+  group = gtk_action_muxer_lookup_group (muxer, action_name, &unprefixed_name);
 
   if (group)
     {
@@ -438,8 +588,6 @@ gtk_action_muxer_activate_action (GActionGroup *action_group,
       else
 	g_action_group_activate_action (group->group, unprefixed_name, parameter);
     }
-  else if (muxer->parent)
-    g_action_group_activate_action (G_ACTION_GROUP (muxer->parent), action_name, parameter);
 }
 
 static void
@@ -451,7 +599,7 @@ gtk_action_muxer_change_action_state (GActionGroup *action_group,
   Group *group;
   const gchar *unprefixed_name;
 
-  group = gtk_action_muxer_find_group (muxer, action_name, &unprefixed_name);
+  group = gtk_action_muxer_lookup_group (muxer, action_name, &unprefixed_name);
 
   if (group)
     {
@@ -463,8 +611,6 @@ gtk_action_muxer_change_action_state (GActionGroup *action_group,
       else
         g_action_group_change_action_state (group->group, unprefixed_name, state);
     }
-  else if (muxer->parent)
-    g_action_group_change_action_state (G_ACTION_GROUP (muxer->parent), action_name, state);
 }
 
 static void
@@ -571,6 +717,7 @@ gtk_action_muxer_finalize (GObject *object)
   g_assert_cmpint (g_hash_table_size (muxer->observed_actions), ==, 0);
   g_hash_table_unref (muxer->observed_actions);
   g_hash_table_unref (muxer->groups);
+  g_hash_table_unref (muxer->lookup_cache);
 
   G_OBJECT_CLASS (gtk_action_muxer_parent_class)
     ->finalize (object);
@@ -590,8 +737,13 @@ gtk_action_muxer_dispose (GObject *object)
     g_signal_handlers_disconnect_by_func (muxer->parent, gtk_action_muxer_parent_primary_accel_changed, muxer);
 
     g_clear_object (&muxer->parent);
+    gtk_action_muxer_invalidate_lookups ();
   }
 
+  g_clear_handle_id (&muxer->flush_changes_id, g_source_remove);
+  g_clear_pointer (&muxer->pending_enabled, g_hash_table_unref);
+  g_clear_pointer (&muxer->pending_states, g_hash_table_unref);
+
   g_hash_table_remove_all (muxer->observed_actions);
 
   G_OBJECT_CLASS (gtk_action_muxer_parent_class)
@@ -641,6 +793,7 @@ gtk_action_muxer_init (GtkActionMuxer *muxer)
 {
   muxer->observed_actions = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, gtk_action_muxer_free_action);
   muxer->groups = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, gtk_action_muxer_free_group);
+  muxer->lookup_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 }
 
 static void
@@ -717,6 +870,7 @@ gtk_action_muxer_insert (GtkActionMuxer *muxer,
   group->prefix = g_strdup (prefix);
 
   g_hash_table_insert (muxer->groups, group->prefix, group);
+  gtk_action_muxer_invalidate_lookups ();
 
   actions = g_action_group_list_actions (group->group);
   for (i = 0; actions[i]; i++)
@@ -757,6 +911,7 @@ gtk_action_muxer_remove (GtkActionMuxer *muxer,
       gint i;
 
       g_hash_table_steal (muxer->groups, prefix);
+      gtk_action_muxer_invalidate_lookups ();
 
       actions = g_action_group_list_actions (group->group);
       for (i = 0; actions[i]; i++)
@@ -851,6 +1006,7 @@ gtk_action_muxer_set_parent (GtkActionMuxer *muxer,
     }
 
   muxer->parent = parent;
+  gtk_action_muxer_invalidate_lookups ();
 
   if (muxer->parent != NULL)
     {
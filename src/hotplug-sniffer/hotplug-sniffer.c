@@ -23,12 +23,20 @@
 #include "shell-mime-sniffer.h"
 #include "hotplug-mimetypes.h"
 
+#include <errno.h>
+#include <string.h>
+
 /* Set the environment variable HOTPLUG_SNIFFER_DEBUG to show debug */
 static void print_debug (const gchar *str, ...);
 
 #define BUS_NAME "org.gnome.Shell.HotplugSniffer"
 #define AUTOQUIT_TIMEOUT 5
 
+#define SUMMARY_ATTRS                         \
+  G_FILE_ATTRIBUTE_STANDARD_NAME ","          \
+  G_FILE_ATTRIBUTE_STANDARD_SIZE ","          \
+  G_FILE_ATTRIBUTE_TIME_MODIFIED
+
 static const gchar introspection_xml[] =
   "<node>"
   "  <interface name='org.gnome.Shell.HotplugSniffer'>"
@@ -42,6 +50,7 @@ static const gchar introspection_xml[] =
 static GDBusNodeInfo *introspection_data = NULL;
 static GMainLoop     *loop = NULL;
 static guint          autoquit_id = 0;
+static GKeyFile      *sniff_cache = NULL;
 
 static gboolean
 autoquit_timeout_cb (gpointer _unused)
@@ -69,15 +78,193 @@ ensure_autoquit_on (void)
   if (g_getenv ("HOTPLUG_SNIFFER_PERSIST") != NULL)
     return;
 
+  g_clear_handle_id (&autoquit_id, g_source_remove);
   autoquit_id = 
     g_timeout_add_seconds (AUTOQUIT_TIMEOUT,
                            autoquit_timeout_cb, NULL);
   g_source_set_name_by_id (autoquit_id, "[gnome-shell] autoquit_timeout_cb");
 }
 
+/* The content types of media that were sniffed before are kept, by the
+ * UUID of their filesystem, along with a summary of their root
+ * directory. Known media are then answered for right away, and only
+ * sniffed again, in the background, when the summary changed.
+ */
+static char *
+get_sniff_cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "gnome-shell",
+                           "hotplug-sniffer.ini", NULL);
+}
+
+static GKeyFile *
+ensure_sniff_cache (void)
+{
+  g_autofree char *path = NULL;
+
+  if (sniff_cache != NULL)
+    return sniff_cache;
+
+  sniff_cache = g_key_file_new ();
+  path = get_sniff_cache_path ();
+  g_key_file_load_from_file (sniff_cache, path, G_KEY_FILE_NONE, NULL);
+
+  return sniff_cache;
+}
+
+static void
+update_sniff_cache (const gchar  *uuid,
+                    const gchar  *summary,
+                    const gchar **types)
+{
+  GKeyFile *cache = ensure_sniff_cache ();
+  g_autofree char *path = NULL;
+  g_autofree char *dir = NULL;
+  g_autoptr (GError) error = NULL;
+
+  g_key_file_set_string (cache, uuid, "summary", summary);
+  g_key_file_set_string_list (cache, uuid, "content-types",
+                              types, g_strv_length ((gchar **) types));
+
+  path = get_sniff_cache_path ();
+  dir = g_path_get_dirname (path);
+
+  if (g_mkdir_with_parents (dir, 0700) < 0 ||
+      !g_key_file_save_to_file (cache, path, &error))
+    print_debug ("Failed to save sniffed content types: %s",
+                 error ? error->message : g_strerror (errno));
+}
+
+typedef struct {
+  gchar *uuid;
+  gchar *summary;
+} VolumeSummary;
+
+static void
+volume_summary_free (VolumeSummary *summary)
+{
+  g_free (summary->uuid);
+  g_free (summary->summary);
+  g_free (summary);
+}
+
+static gchar *
+get_filesystem_uuid (GFile        *file,
+                     GCancellable *cancellable)
+{
+  g_autoptr (GMount) mount = NULL;
+  g_autoptr (GVolume) volume = NULL;
+  gchar *uuid;
+
+  mount = g_file_find_enclosing_mount (file, cancellable, NULL);
+  if (mount == NULL)
+    return NULL;
+
+  uuid = g_mount_get_uuid (mount);
+  if (uuid != NULL)
+    return uuid;
+
+  volume = g_mount_get_volume (mount);
+  if (volume == NULL)
+    return NULL;
+
+  return g_volume_get_uuid (volume);
+}
+
+static gint
+compare_strings (gconstpointer a,
+                 gconstpointer b)
+{
+  return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
+
+/* A checksum of the modification time of the root directory, and of the
+ * names, sizes and modification times of what it contains */
+static gchar *
+get_root_summary (GFile        *file,
+                  GCancellable *cancellable)
+{
+  g_autoptr (GFileInfo) info = NULL;
+  g_autoptr (GFileEnumerator) enumerator = NULL;
+  g_autoptr (GPtrArray) entries = NULL;
+  g_autoptr (GChecksum) checksum = NULL;
+  guint i;
+
+  info = g_file_query_info (file, G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                            G_FILE_QUERY_INFO_NONE, cancellable, NULL);
+  enumerator = g_file_enumerate_children (file, SUMMARY_ATTRS,
+                                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                          cancellable, NULL);
+  if (info == NULL || enumerator == NULL)
+    return NULL;
+
+  entries = g_ptr_array_new_with_free_func (g_free);
+  g_ptr_array_add (entries,
+                   g_strdup_printf ("%" G_GUINT64_FORMAT,
+                                    g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED)));
+
+  while (TRUE)
+    {
+      g_autoptr (GFileInfo) child = NULL;
+      g_autoptr (GError) error = NULL;
+
+      child = g_file_enumerator_next_file (enumerator, cancellable, &error);
+      if (error != NULL)
+        return NULL;
+      if (child == NULL)
+        break;
+
+      g_ptr_array_add (entries,
+                       g_strdup_printf ("%s\t%" G_GOFFSET_FORMAT "\t%" G_GUINT64_FORMAT,
+                                        g_file_info_get_name (child),
+                                        g_file_info_get_size (child),
+                                        g_file_info_get_attribute_uint64 (child, G_FILE_ATTRIBUTE_TIME_MODIFIED)));
+    }
+
+  /* Enumeration order may differ between mounts */
+  g_ptr_array_sort (entries, compare_strings);
+
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+  for (i = 0; i < entries->len; i++)
+    {
+      const gchar *entry = g_ptr_array_index (entries, i);
+
+      g_checksum_update (checksum, (const guchar *) entry, strlen (entry) + 1);
+    }
+
+  return g_strdup (g_checksum_get_string (checksum));
+}
+
+static void
+volume_summary_thread (GTask        *task,
+                       gpointer      source_object,
+                       gpointer      task_data,
+                       GCancellable *cancellable)
+{
+  GFile *file = task_data;
+  g_autofree gchar *uuid = NULL;
+  g_autofree gchar *summary = NULL;
+  VolumeSummary *result = NULL;
+
+  uuid = get_filesystem_uuid (file, cancellable);
+  if (uuid != NULL)
+    summary = get_root_summary (file, cancellable);
+
+  if (summary != NULL)
+    {
+      result = g_new0 (VolumeSummary, 1);
+      result->uuid = g_steal_pointer (&uuid);
+      result->summary = g_steal_pointer (&summary);
+    }
+
+  g_task_return_pointer (task, result, (GDestroyNotify) volume_summary_free);
+}
+
 typedef struct {
   GVariant *parameters;
   GDBusMethodInvocation *invocation;
+  GFile *file;
+  VolumeSummary *summary;
 } InvocationData;
 
 static InvocationData *
@@ -98,6 +285,8 @@ invocation_data_free (InvocationData *data)
 {
   g_variant_unref (data->parameters);
   g_clear_object (&data->invocation);
+  g_clear_object (&data->file);
+  g_clear_pointer (&data->summary, volume_summary_free);
 
   g_free (data);
 }
@@ -116,13 +305,20 @@ sniff_async_ready_cb (GObject *source,
 
   if (error != NULL)
     {
-      g_dbus_method_invocation_return_gerror (data->invocation, error);
+      /* Sniffing again in the background, the cached types were sent */
+      if (data->invocation)
+        g_dbus_method_invocation_return_gerror (data->invocation, error);
       g_error_free (error);
       goto out;
     }
 
-  g_dbus_method_invocation_return_value (data->invocation,
-                                         g_variant_new ("(^as)", types));
+  if (data->summary)
+    update_sniff_cache (data->summary->uuid, data->summary->summary,
+                        (const gchar **) types);
+
+  if (data->invocation)
+    g_dbus_method_invocation_return_value (data->invocation,
+                                           g_variant_new ("(^as)", types));
   g_strfreev (types);
 
  out:
@@ -131,28 +327,81 @@ sniff_async_ready_cb (GObject *source,
 }
 
 static void
-handle_sniff_uri (InvocationData *data)
+start_sniff (InvocationData *data)
 {
   ShellMimeSniffer *sniffer;
-  const gchar *uri;
-  GFile *file;
-
-  ensure_autoquit_off ();
-
-  g_variant_get (data->parameters, 
-                 "(&s)", &uri,
-                 NULL);
-  file = g_file_new_for_uri (uri);
+  g_autofree char *uri = NULL;
 
+  uri = g_file_get_uri (data->file);
   print_debug ("Initiating sniff for uri %s", uri);
 
-  sniffer = shell_mime_sniffer_new (file);
+  sniffer = shell_mime_sniffer_new (data->file);
   shell_mime_sniffer_sniff_async (sniffer,
                                   sniff_async_ready_cb,
                                   data);
 
   g_object_unref (sniffer);
-  g_object_unref (file);
+}
+
+static void
+volume_summary_ready_cb (GObject      *source,
+                         GAsyncResult *res,
+                         gpointer      user_data)
+{
+  InvocationData *data = user_data;
+  g_autofree gchar *cached_summary = NULL;
+  g_auto (GStrv) cached_types = NULL;
+  GKeyFile *cache;
+
+  data->summary = g_task_propagate_pointer (G_TASK (res), NULL);
+  if (data->summary == NULL)
+    {
+      start_sniff (data);
+      return;
+    }
+
+  cache = ensure_sniff_cache ();
+  cached_summary = g_key_file_get_string (cache, data->summary->uuid, "summary", NULL);
+  cached_types = g_key_file_get_string_list (cache, data->summary->uuid,
+                                             "content-types", NULL, NULL);
+  if (cached_summary == NULL || cached_types == NULL)
+    {
+      start_sniff (data);
+      return;
+    }
+
+  print_debug ("Using cached content types for %s", data->summary->uuid);
+
+  g_dbus_method_invocation_return_value (g_steal_pointer (&data->invocation),
+                                         g_variant_new ("(^as)", cached_types));
+
+  if (g_strcmp0 (cached_summary, data->summary->summary) != 0)
+    {
+      start_sniff (data);
+      return;
+    }
+
+  invocation_data_free (data);
+  ensure_autoquit_on ();
+}
+
+static void
+handle_sniff_uri (InvocationData *data)
+{
+  g_autoptr (GTask) task = NULL;
+  const gchar *uri;
+
+  ensure_autoquit_off ();
+
+  g_variant_get (data->parameters, 
+                 "(&s)", &uri,
+                 NULL);
+  data->file = g_file_new_for_uri (uri);
+
+  task = g_task_new (NULL, NULL, volume_summary_ready_cb, data);
+  g_task_set_source_tag (task, handle_sniff_uri);
+  g_task_set_task_data (task, g_object_ref (data->file), g_object_unref);
+  g_task_run_in_thread (task, volume_summary_thread);
 }
 
 static void
@@ -42,6 +42,8 @@
 #define WATCHDOG_TIMEOUT 1500
 #define DIRECTORY_LOAD_ITEMS_PER_CALLBACK 100
 #define HIGH_SCORE_RATIO 0.10
+#define DIRECTORY_LOAD_MAX_RUNNING 4
+#define DEEP_COUNT_ENOUGH_SAMPLES 300
 
 enum {
   PROP_FILE = 1,
@@ -58,9 +60,9 @@ static GParamSpec *properties[NUM_PROPERTIES] = { NULL, };
 typedef struct {
   ShellMimeSniffer *self;
 
-  GFile *file;
-  GFileEnumerator *enumerator;
-  GList *deep_count_subdirectories;
+  GQueue pending_directories; /* GFile *, waiting to be loaded */
+  guint n_running;
+  gboolean conclusive;
 
   gint audio_count;
   gint image_count;
@@ -70,6 +72,13 @@ typedef struct {
   gint total_items;
 } DeepCountState;
 
+typedef struct {
+  DeepCountState *state;
+
+  GFile *file;
+  GFileEnumerator *enumerator;
+} DirectoryLoad;
+
 typedef struct _ShellMimeSnifferPrivate   ShellMimeSnifferPrivate;
 
 struct _ShellMimeSniffer
@@ -237,19 +246,19 @@ prepare_async_result (DeepCountState *state)
 
 /* adapted from nautilus/libnautilus-private/nautilus-directory-async.c */
 static void
-deep_count_one (DeepCountState *state,
-		GFileInfo *info)
+deep_count_one (DirectoryLoad *load,
+                GFileInfo *info)
 {
+  DeepCountState *state = load->state;
   GFile *subdir;
   const char *content_type;
 
   if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
     {
       /* record the fact that we have to descend into this directory */
-      subdir = g_file_get_child (state->file, g_file_info_get_name (info));
-      state->deep_count_subdirectories =
-        g_list_append (state->deep_count_subdirectories, subdir);
-    } 
+      subdir = g_file_get_child (load->file, g_file_info_get_name (info));
+      g_queue_push_tail (&state->pending_directories, subdir);
+    }
   else
     {
       content_type = g_file_info_get_content_type (info);
@@ -259,49 +268,81 @@ deep_count_one (DeepCountState *state,
     }
 }
 
+/* Whether one type has all but HIGH_SCORE_RATIO of enough samples, so
+ * that no other type would make it into the result */
+static gboolean
+deep_count_is_conclusive (DeepCountState *state)
+{
+  gint max_count;
+
+  if (state->total_items < DEEP_COUNT_ENOUGH_SAMPLES)
+    return FALSE;
+
+  max_count = MAX (MAX (state->audio_count, state->image_count),
+                   MAX (state->document_count, state->video_count));
+
+  return (gdouble) max_count / (gdouble) state->total_items >= 1.0 - HIGH_SCORE_RATIO;
+}
+
+static gboolean
+deep_count_should_stop (DeepCountState *state)
+{
+  return state->conclusive ||
+         g_cancellable_is_cancelled (state->self->priv->cancellable);
+}
+
 static void
 deep_count_finish (DeepCountState *state)
 {
   prepare_async_result (state);
 
-  if (state->enumerator)
-    {
-      if (!g_file_enumerator_is_closed (state->enumerator))
-        g_file_enumerator_close_async (state->enumerator,
-                                       0, NULL, NULL, NULL);
-
-      g_object_unref (state->enumerator);
-    }
-
   g_cancellable_reset (state->self->priv->cancellable);
-  g_clear_object (&state->file);
 
-  g_list_free_full (state->deep_count_subdirectories, g_object_unref);
+  g_queue_clear_full (&state->pending_directories, g_object_unref);
 
   g_free (state);
 }
 
+/* Starts loading the next directories, breadth first, with up to
+ * DIRECTORY_LOAD_MAX_RUNNING at a time, and finishes once all are done */
 static void
-deep_count_next_dir (DeepCountState *state)
+deep_count_schedule (DeepCountState *state)
 {
-  GFile *new_file;
+  GFile *file;
 
-  g_clear_object (&state->file);
+  if (deep_count_should_stop (state))
+    g_queue_clear_full (&state->pending_directories, g_object_unref);
 
-  if (state->deep_count_subdirectories != NULL)
+  while (state->n_running < DIRECTORY_LOAD_MAX_RUNNING &&
+         (file = g_queue_pop_head (&state->pending_directories)) != NULL)
     {
-      /* Work on a new directory. */
-      new_file = state->deep_count_subdirectories->data;
-      state->deep_count_subdirectories =
-        g_list_remove (state->deep_count_subdirectories, new_file);
-
-      deep_count_load (state, new_file);
-      g_object_unref (new_file);
+      deep_count_load (state, file);
+      g_object_unref (file);
     }
-  else
+
+  if (state->n_running == 0)
+    deep_count_finish (state);
+}
+
+static void
+directory_load_done (DirectoryLoad *load)
+{
+  DeepCountState *state = load->state;
+
+  if (load->enumerator)
     {
-      deep_count_finish (state);
+      if (!g_file_enumerator_is_closed (load->enumerator))
+        g_file_enumerator_close_async (load->enumerator,
+                                       0, NULL, NULL, NULL);
+
+      g_object_unref (load->enumerator);
     }
+
+  g_object_unref (load->file);
+  g_free (load);
+
+  state->n_running--;
+  deep_count_schedule (state);
 }
 
 static void
@@ -309,44 +350,47 @@ deep_count_more_files_callback (GObject *source_object,
 				GAsyncResult *res,
 				gpointer user_data)
 {
+  DirectoryLoad *load;
   DeepCountState *state;
   GList *files, *l;
   GFileInfo *info;
 
-  state = user_data;
+  load = user_data;
+  state = load->state;
 
-  if (g_cancellable_is_cancelled (state->self->priv->cancellable))
+  if (deep_count_should_stop (state))
     {
-      deep_count_finish (state);
+      directory_load_done (load);
       return;
     }
-	
-  files = g_file_enumerator_next_files_finish (state->enumerator,
+
+  files = g_file_enumerator_next_files_finish (load->enumerator,
                                                res, NULL);
-  
+
   for (l = files; l != NULL; l = l->next)
     {
       info = l->data;
-      deep_count_one (state, info);
+      deep_count_one (load, info);
       g_object_unref (info);
     }
 
-  if (files == NULL)
-    {
-      g_file_enumerator_close_async (state->enumerator, 0, NULL, NULL, NULL);
-      g_object_unref (state->enumerator);
-      state->enumerator = NULL;
+  state->conclusive = deep_count_is_conclusive (state);
 
-      deep_count_next_dir (state);
+  if (files == NULL || state->conclusive)
+    {
+      directory_load_done (load);
     }
   else
     {
-      g_file_enumerator_next_files_async (state->enumerator,
+      /* Subdirectories found so far can load alongside */
+      deep_count_schedule (state);
+
+      g_file_enumerator_next_files_async (load->enumerator,
                                           DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
                                           G_PRIORITY_LOW,
                                           state->self->priv->cancellable,
                                           deep_count_more_files_callback,
-                                          state);
+                                          load);
     }
 
   g_list_free (files);
@@ -357,33 +401,33 @@ deep_count_callback (GObject *source_object,
 		     GAsyncResult *res,
 		     gpointer user_data)
 {
+  DirectoryLoad *load;
   DeepCountState *state;
-  GFileEnumerator *enumerator;
 
-  state = user_data;
+  load = user_data;
+  state = load->state;
 
-  if (g_cancellable_is_cancelled (state->self->priv->cancellable))
+  if (deep_count_should_stop (state))
     {
-      deep_count_finish (state);
+      directory_load_done (load);
       return;
     }
 
-  enumerator = g_file_enumerate_children_finish (G_FILE (source_object),
-                                                 res, NULL);
-	
-  if (enumerator == NULL)
+  load->enumerator = g_file_enumerate_children_finish (G_FILE (source_object),
+                                                       res, NULL);
+
+  if (load->enumerator == NULL)
     {
-      deep_count_next_dir (state);
+      directory_load_done (load);
     }
   else
     {
-      state->enumerator = enumerator;
-      g_file_enumerator_next_files_async (state->enumerator,
+      g_file_enumerator_next_files_async (load->enumerator,
                                           DIRECTORY_LOAD_ITEMS_PER_CALLBACK,
                                           G_PRIORITY_LOW,
                                           state->self->priv->cancellable,
                                           deep_count_more_files_callback,
-                                          state);
+                                          load);
     }
 }
 
@@ -391,15 +435,21 @@ static void
 deep_count_load (DeepCountState *state,
                  GFile *file)
 {
-  state->file = g_object_ref (file);
+  DirectoryLoad *load;
+
+  load = g_new0 (DirectoryLoad, 1);
+  load->state = state;
+  load->file = g_object_ref (file);
+
+  state->n_running++;
 
-  g_file_enumerate_children_async (state->file,
+  g_file_enumerate_children_async (load->file,
                                    LOADER_ATTRS,
                                    G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, /* flags */
                                    G_PRIORITY_LOW, /* prio */
                                    state->self->priv->cancellable,
                                    deep_count_callback,
-                                   state);
+                                   load);
 }
 
 static void
@@ -409,6 +459,7 @@ deep_count_start (ShellMimeSniffer *self)
 
   state = g_new0 (DeepCountState, 1);
   state->self = self;
+  g_queue_init (&state->pending_directories);
 
   deep_count_load (state, self->priv->file);
 }
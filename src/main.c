@@ -330,6 +330,39 @@ malloc_statistics_callback (ShellPerfLog *perf_log,
 #endif /* defined (HAVE_MALLINFO) || defined (HAVE_MALLINFO2) */
 }
 
+static void
+icon_theme_statistics_callback (ShellPerfLog *perf_log,
+                                gpointer      data)
+{
+  guint hits, misses;
+
+  st_texture_cache_get_icon_lookup_stats (st_texture_cache_get_default (),
+                                          &hits, &misses);
+
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "iconTheme.cacheHits",
+                                     hits);
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "iconTheme.cacheMisses",
+                                     misses);
+}
+
+static void
+size_request_statistics_callback (ShellPerfLog *perf_log,
+                                  gpointer      data)
+{
+  guint width_requests, height_requests;
+
+  st_theme_node_get_size_request_stats (&width_requests, &height_requests);
+
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "st.widthRequests",
+                                     width_requests);
+  shell_perf_log_update_statistic_i (perf_log,
+                                     "st.heightRequests",
+                                     height_requests);
+}
+
 static void
 shell_perf_log_init (void)
 {
@@ -355,6 +388,32 @@ shell_perf_log_init (void)
   shell_perf_log_add_statistics_callback (perf_log,
                                           malloc_statistics_callback,
                                           NULL, NULL);
+
+  shell_perf_log_define_statistic (perf_log,
+                                   "iconTheme.cacheHits",
+                                   "Number of icon lookups answered from the icon info cache",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "iconTheme.cacheMisses",
+                                   "Number of icon lookups that searched the icon themes",
+                                   "i");
+
+  shell_perf_log_add_statistics_callback (perf_log,
+                                          icon_theme_statistics_callback,
+                                          NULL, NULL);
+
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.widthRequests",
+                                   "Number of preferred widths St widgets computed instead of reusing a cached one",
+                                   "i");
+  shell_perf_log_define_statistic (perf_log,
+                                   "st.heightRequests",
+                                   "Number of preferred heights St widgets computed instead of reusing a cached one",
+                                   "i");
+
+  shell_perf_log_add_statistics_callback (perf_log,
+                                          size_request_statistics_callback,
+                                          NULL, NULL);
 }
 
 static void
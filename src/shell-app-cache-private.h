@@ -15,5 +15,8 @@ GDesktopAppInfo *shell_app_cache_get_info         (ShellAppCache *cache,
                                                    const char    *id);
 char            *shell_app_cache_translate_folder (ShellAppCache *cache,
                                                    const char    *name);
+char          ***shell_app_cache_search           (ShellAppCache *cache,
+                                                   const char    *search_string);
+void             shell_app_cache_save_index       (ShellAppCache *cache);
 
 #endif /* __SHELL_APP_CACHE_PRIVATE_H__ */
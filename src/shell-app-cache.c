@@ -2,7 +2,10 @@
 
 #include "config.h"
 
+#include <glib/gstdio.h>
+
 #include "shell-app-cache-private.h"
+#include "shell-app-index-private.h"
 
 #include "shell-global-private.h"
 
@@ -14,7 +17,10 @@
  * The #ShellAppCache is responsible for caching information about #GAppInfo
  * to ensure that the compositor thread never needs to perform disk reads to
  * access them. All of the work is done off-thread. When the new data has
- * been loaded, a #ShellAppCache::changed signal is emitted.
+ * been loaded, a #ShellAppCache::changed signal is emitted, listing the
+ * applications that were added, removed or changed since the last update.
+ * Applications that didn't change keep their #GAppInfo, so unchanged
+ * entries compare equal by pointer.
  *
  * Additionally, the #ShellAppCache caches information about translations for
  * directories. This allows translation provided in [Desktop Entry] GKeyFiles
@@ -22,7 +28,9 @@
  * costly disk reads.
  *
  * Various monitors are used to keep this information up to date while the
- * Shell is running.
+ * Shell is running. Only what they report as changed is reloaded: the
+ * application list when the #GAppInfoMonitor fires, the translations when
+ * one of the desktop-directories monitors does.
  */
 
 #define DEFAULT_TIMEOUT_SECONDS 5
@@ -36,14 +44,29 @@ struct _ShellAppCache
   GHashTable      *folders;
   GCancellable    *cancellable;
   GList           *app_infos;
+  GHashTable      *id_to_info;
+  ShellAppIndex   *app_index;
 
   guint            queued_update;
+  gboolean         apps_dirty;
+  gboolean         folders_dirty;
+  gboolean         apps_in_flight;
+  gboolean         folders_in_flight;
 };
 
 typedef struct
 {
+  /* The current applications, to diff against */
+  GHashTable *old_infos;
+
   GList      *app_infos;
   GHashTable *folders;
+
+  GPtrArray  *added;
+  GPtrArray  *removed;
+  GPtrArray  *changed;
+
+  ShellAppIndex *app_index;
 } CacheState;
 
 G_DEFINE_TYPE (ShellAppCache, shell_app_cache, G_TYPE_OBJECT)
@@ -58,22 +81,108 @@ static guint signals [N_SIGNALS];
 static void
 cache_state_free (CacheState *state)
 {
+  g_clear_pointer (&state->old_infos, g_hash_table_unref);
   g_clear_pointer (&state->folders, g_hash_table_unref);
   g_list_free_full (state->app_infos, g_object_unref);
+  g_clear_pointer (&state->added, g_ptr_array_unref);
+  g_clear_pointer (&state->removed, g_ptr_array_unref);
+  g_clear_pointer (&state->changed, g_ptr_array_unref);
+  g_clear_pointer (&state->app_index, shell_app_index_unref);
   g_free (state);
 }
 
 static CacheState *
-cache_state_new (void)
+cache_state_new (GHashTable *old_infos,
+                 gboolean    load_apps,
+                 gboolean    load_folders)
 {
   CacheState *state;
 
   state = g_new0 (CacheState, 1);
-  state->folders = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  if (load_apps)
+    {
+      state->old_infos = g_hash_table_ref (old_infos);
+      state->added = g_ptr_array_new_with_free_func (g_free);
+      state->removed = g_ptr_array_new_with_free_func (g_free);
+      state->changed = g_ptr_array_new_with_free_func (g_free);
+    }
+
+  if (load_folders)
+    state->folders = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
   return g_steal_pointer (&state);
 }
 
+static GHashTable *
+index_app_infos (GList *app_infos)
+{
+  GHashTable *id_to_info;
+  GList *l;
+
+  /* The keys are owned by the values */
+  id_to_info = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                      NULL, g_object_unref);
+
+  for (l = app_infos; l != NULL; l = l->next)
+    g_hash_table_insert (id_to_info,
+                         (char *) g_app_info_get_id (l->data),
+                         g_object_ref (l->data));
+
+  return id_to_info;
+}
+
+typedef struct
+{
+  gint64 mtime;
+  gint64 size;
+} FileStamp;
+
+static GQuark
+file_stamp_quark (void)
+{
+  return g_quark_from_static_string ("shell-app-cache-file-stamp");
+}
+
+/* Remembers the state of the desktop file @info was loaded from.
+ * Must not be called once @info is shared between threads. */
+static void
+stamp_app_info (GAppInfo *info)
+{
+  const char *filename;
+  FileStamp *stamp;
+  GStatBuf stat_buf;
+
+  filename = g_desktop_app_info_get_filename (G_DESKTOP_APP_INFO (info));
+  if (filename == NULL || g_stat (filename, &stat_buf) != 0)
+    return;
+
+  stamp = g_new0 (FileStamp, 1);
+  stamp->mtime = stat_buf.st_mtime;
+  stamp->size = stat_buf.st_size;
+  g_object_set_qdata_full (G_OBJECT (info), file_stamp_quark (),
+                           stamp, g_free);
+}
+
+/* Whether both were loaded from the same, unmodified desktop file */
+static gboolean
+app_info_equal (GAppInfo *old_info,
+                GAppInfo *new_info)
+{
+  FileStamp *old_stamp, *new_stamp;
+
+  if (g_strcmp0 (g_desktop_app_info_get_filename (G_DESKTOP_APP_INFO (old_info)),
+                 g_desktop_app_info_get_filename (G_DESKTOP_APP_INFO (new_info))) != 0)
+    return FALSE;
+
+  old_stamp = g_object_get_qdata (G_OBJECT (old_info), file_stamp_quark ());
+  new_stamp = g_object_get_qdata (G_OBJECT (new_info), file_stamp_quark ());
+
+  return old_stamp != NULL && new_stamp != NULL &&
+         old_stamp->mtime == new_stamp->mtime &&
+         old_stamp->size == new_stamp->size;
+}
+
 /**
  * shell_app_cache_get_default:
  *
@@ -147,22 +256,81 @@ load_folders (GHashTable *folders)
     }
 }
 
+static void
+load_apps (CacheState *state)
+{
+  g_autoptr(GHashTable) new_ids = NULL;
+  GHashTableIter iter;
+  const char *id;
+  GList *l;
+
+  state->app_infos = g_app_info_get_all ();
+  new_ids = g_hash_table_new (g_str_hash, g_str_equal);
+
+  for (l = state->app_infos; l != NULL; l = l->next)
+    {
+      GAppInfo *info = l->data;
+      GAppInfo *old_info;
+
+      id = g_app_info_get_id (info);
+      g_hash_table_add (new_ids, (char *) id);
+      stamp_app_info (info);
+
+      old_info = g_hash_table_lookup (state->old_infos, id);
+
+      if (old_info == NULL)
+        {
+          g_ptr_array_add (state->added, g_strdup (id));
+        }
+      else if (!app_info_equal (old_info, info))
+        {
+          g_ptr_array_add (state->changed, g_strdup (id));
+        }
+      else
+        {
+          /* Unchanged apps keep their info, so they compare equal */
+          l->data = g_object_ref (old_info);
+          g_object_unref (info);
+        }
+    }
+
+  g_hash_table_iter_init (&iter, state->old_infos);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &id, NULL))
+    {
+      if (!g_hash_table_contains (new_ids, id))
+        g_ptr_array_add (state->removed, g_strdup (id));
+    }
+
+  if (shell_app_index_is_enabled () &&
+      (state->added->len > 0 || state->removed->len > 0 || state->changed->len > 0))
+    {
+      state->app_index = shell_app_index_new (state->app_infos);
+      shell_app_index_save (state->app_index);
+    }
+
+  g_ptr_array_add (state->added, NULL);
+  g_ptr_array_add (state->removed, NULL);
+  g_ptr_array_add (state->changed, NULL);
+}
+
 static void
 shell_app_cache_worker (GTask        *task,
                         gpointer      source_object,
                         gpointer      task_data,
                         GCancellable *cancellable)
 {
-  CacheState *state;
+  CacheState *state = task_data;
 
   g_assert (G_IS_TASK (task));
   g_assert (SHELL_IS_APP_CACHE (source_object));
 
-  state = cache_state_new ();
-  state->app_infos = g_app_info_get_all ();
-  load_folders (state->folders);
+  if (state->old_infos != NULL)
+    load_apps (state);
+
+  if (state->folders != NULL)
+    load_folders (state->folders);
 
-  g_task_return_pointer (task, state, (GDestroyNotify) cache_state_free);
+  g_task_return_boolean (task, TRUE);
 }
 
 static void
@@ -173,25 +341,55 @@ apply_update_cb (GObject      *object,
   ShellAppCache *cache = (ShellAppCache *)object;
   g_autoptr(GError) error = NULL;
   CacheState *state;
+  const char * const empty[] = { NULL };
+  const char * const *added = empty;
+  const char * const *removed = empty;
+  const char * const *changed = empty;
 
   g_assert (SHELL_IS_APP_CACHE (cache));
   g_assert (G_IS_TASK (result));
   g_assert (user_data == NULL);
 
-  state = g_task_propagate_pointer (G_TASK (result), &error);
-
-  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+  if (!g_task_propagate_boolean (G_TASK (result), &error))
     return;
 
-  g_list_free_full (cache->app_infos, g_object_unref);
-  cache->app_infos = g_steal_pointer (&state->app_infos);
+  cache->apps_in_flight = FALSE;
+  cache->folders_in_flight = FALSE;
 
-  g_clear_pointer (&cache->folders, g_hash_table_unref);
-  cache->folders = g_steal_pointer (&state->folders);
+  state = g_task_get_task_data (G_TASK (result));
 
-  g_signal_emit (cache, signals[CHANGED], 0);
+  if (state->old_infos != NULL)
+    {
+      if (state->added->len == 1 &&
+          state->removed->len == 1 &&
+          state->changed->len == 1 &&
+          state->folders == NULL)
+        return;
+
+      g_list_free_full (cache->app_infos, g_object_unref);
+      cache->app_infos = g_steal_pointer (&state->app_infos);
+
+      g_clear_pointer (&cache->id_to_info, g_hash_table_unref);
+      cache->id_to_info = index_app_infos (cache->app_infos);
+
+      if (state->app_index != NULL)
+        {
+          g_clear_pointer (&cache->app_index, shell_app_index_unref);
+          cache->app_index = g_steal_pointer (&state->app_index);
+        }
+
+      added = (const char * const *) state->added->pdata;
+      removed = (const char * const *) state->removed->pdata;
+      changed = (const char * const *) state->changed->pdata;
+    }
 
-  cache_state_free (state);
+  if (state->folders != NULL)
+    {
+      g_clear_pointer (&cache->folders, g_hash_table_unref);
+      cache->folders = g_steal_pointer (&state->folders);
+    }
+
+  g_signal_emit (cache, signals[CHANGED], 0, added, removed, changed);
 }
 
 static gboolean
@@ -199,6 +397,7 @@ shell_app_cache_do_update (gpointer user_data)
 {
   ShellAppCache *cache = user_data;
   g_autoptr(GTask) task = NULL;
+  CacheState *state;
 
   cache->queued_update = 0;
 
@@ -210,8 +409,19 @@ shell_app_cache_do_update (gpointer user_data)
   g_clear_object (&cache->cancellable);
   cache->cancellable = g_cancellable_new ();
 
+  /* Whatever the cancelled update was going to reload still needs it */
+  cache->apps_in_flight |= cache->apps_dirty;
+  cache->folders_in_flight |= cache->folders_dirty;
+  cache->apps_dirty = FALSE;
+  cache->folders_dirty = FALSE;
+
+  state = cache_state_new (cache->id_to_info,
+                           cache->apps_in_flight,
+                           cache->folders_in_flight);
+
   task = g_task_new (cache, cache->cancellable, apply_update_cb, NULL);
   g_task_set_source_tag (task, shell_app_cache_do_update);
+  g_task_set_task_data (task, state, (GDestroyNotify) cache_state_free);
   g_task_run_in_thread (task, shell_app_cache_worker);
 
   return G_SOURCE_REMOVE;
@@ -230,6 +440,20 @@ shell_app_cache_queue_update (ShellAppCache *self)
                                                self);
 }
 
+static void
+apps_changed_cb (ShellAppCache *self)
+{
+  self->apps_dirty = TRUE;
+  shell_app_cache_queue_update (self);
+}
+
+static void
+folders_changed_cb (ShellAppCache *self)
+{
+  self->folders_dirty = TRUE;
+  shell_app_cache_queue_update (self);
+}
+
 static void
 monitor_desktop_directories_for_data_dir (ShellAppCache *self,
                                           const gchar   *directory)
@@ -252,13 +476,42 @@ monitor_desktop_directories_for_data_dir (ShellAppCache *self,
       g_file_monitor_set_rate_limit (monitor, DEFAULT_TIMEOUT_SECONDS * 1000);
       g_signal_connect_object (monitor,
                                "changed",
-                               G_CALLBACK (shell_app_cache_queue_update),
+                               G_CALLBACK (folders_changed_cb),
                                self,
                                G_CONNECT_SWAPPED);
       g_ptr_array_add (self->dir_monitors, g_steal_pointer (&monitor));
     }
 }
 
+static void
+save_index_worker (GTask        *task,
+                   gpointer      source_object,
+                   gpointer      task_data,
+                   GCancellable *cancellable)
+{
+  shell_app_index_save (task_data);
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+ensure_index (ShellAppCache *self)
+{
+  g_autoptr(GTask) task = NULL;
+
+  self->app_index = shell_app_index_load ();
+  if (self->app_index != NULL)
+    return;
+
+  self->app_index = shell_app_index_new (self->app_infos);
+
+  task = g_task_new (self, NULL, NULL, NULL);
+  g_task_set_source_tag (task, ensure_index);
+  g_task_set_task_data (task,
+                        shell_app_index_ref (self->app_index),
+                        (GDestroyNotify) shell_app_index_unref);
+  g_task_run_in_thread (task, save_index_worker);
+}
+
 static void
 shell_app_cache_finalize (GObject *object)
 {
@@ -274,6 +527,8 @@ shell_app_cache_finalize (GObject *object)
 
   g_clear_pointer (&self->dir_monitors, g_ptr_array_unref);
   g_clear_pointer (&self->folders, g_hash_table_unref);
+  g_clear_pointer (&self->id_to_info, g_hash_table_unref);
+  g_clear_pointer (&self->app_index, shell_app_index_unref);
   g_list_free_full (self->app_infos, g_object_unref);
 
   G_OBJECT_CLASS (shell_app_cache_parent_class)->finalize (object);
@@ -288,16 +543,22 @@ shell_app_cache_class_init (ShellAppCacheClass *klass)
 
   /**
    * ShellAppCache::changed:
+   * @cache: the #ShellAppCache
+   * @added: the IDs of applications that were installed
+   * @removed: the IDs of applications that were removed
+   * @changed: the IDs of applications whose information changed
    *
    * The "changed" signal is emitted when the cache has updated
-   * information about installed applications.
+   * information about installed applications. All lists are empty
+   * if only folder translations changed.
    */
   signals [CHANGED] =
     g_signal_new ("changed",
                   G_TYPE_FROM_CLASS (klass),
                   G_SIGNAL_RUN_LAST,
                   0, NULL, NULL, NULL,
-                  G_TYPE_NONE, 0);
+                  G_TYPE_NONE, 3,
+                  G_TYPE_STRV, G_TYPE_STRV, G_TYPE_STRV);
 }
 
 static void
@@ -321,10 +582,15 @@ shell_app_cache_init (ShellAppCache *self)
   self->monitor = g_app_info_monitor_get ();
   g_signal_connect_object (self->monitor,
                            "changed",
-                           G_CALLBACK (shell_app_cache_queue_update),
+                           G_CALLBACK (apps_changed_cb),
                            self,
                            G_CONNECT_SWAPPED);
   self->app_infos = g_app_info_get_all ();
+  g_list_foreach (self->app_infos, (GFunc) stamp_app_info, NULL);
+  self->id_to_info = index_app_infos (self->app_infos);
+
+  if (shell_app_index_is_enabled ())
+    ensure_index (self);
 }
 
 /**
@@ -360,19 +626,12 @@ GDesktopAppInfo *
 shell_app_cache_get_info (ShellAppCache *cache,
                           const char    *id)
 {
-  const GList *iter;
-
   g_return_val_if_fail (SHELL_IS_APP_CACHE (cache), NULL);
 
-  for (iter = cache->app_infos; iter != NULL; iter = iter->next)
-    {
-      GAppInfo *info = iter->data;
-
-      if (g_strcmp0 (id, g_app_info_get_id (info)) == 0)
-        return G_DESKTOP_APP_INFO (info);
-    }
+  if (id == NULL)
+    return NULL;
 
-  return NULL;
+  return g_hash_table_lookup (cache->id_to_info, id);
 }
 
 /**
@@ -396,3 +655,50 @@ shell_app_cache_translate_folder (ShellAppCache *cache,
 
   return g_strdup (g_hash_table_lookup (cache->folders, name));
 }
+
+/**
+ * shell_app_cache_save_index:
+ * @cache: a #ShellAppCache
+ *
+ * Writes the search index of the installed apps to disk, so that a
+ * process started next with SHELL_APP_INDEX=1 can load it rather than
+ * build it. The index is built for the occasion if @cache doesn't use
+ * one; otherwise it was saved when it was built already.
+ */
+void
+shell_app_cache_save_index (ShellAppCache *cache)
+{
+  ShellAppIndex *app_index;
+
+  g_return_if_fail (SHELL_IS_APP_CACHE (cache));
+
+  if (cache->app_index != NULL)
+    return;
+
+  app_index = shell_app_index_new (cache->app_infos);
+  shell_app_index_save (app_index);
+  shell_app_index_unref (app_index);
+}
+
+/**
+ * shell_app_cache_search:
+ * @cache: a #ShellAppCache
+ * @search_string: the search string to use
+ *
+ * Searches applications using the index kept by @cache, see
+ * g_desktop_app_info_search() for the format of the results.
+ *
+ * Returns: (nullable) (transfer full): the results, or %NULL if there
+ *   is no index
+ */
+char ***
+shell_app_cache_search (ShellAppCache *cache,
+                        const char    *search_string)
+{
+  g_return_val_if_fail (SHELL_IS_APP_CACHE (cache), NULL);
+
+  if (cache->app_index == NULL)
+    return NULL;
+
+  return shell_app_index_search (cache->app_index, search_string);
+}
@@ -0,0 +1,27 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#ifndef __SHELL_APP_INDEX_PRIVATE_H__
+#define __SHELL_APP_INDEX_PRIVATE_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ShellAppIndex ShellAppIndex;
+
+gboolean        shell_app_index_is_enabled (void);
+
+ShellAppIndex  *shell_app_index_load       (void);
+ShellAppIndex  *shell_app_index_new        (GList          *app_infos);
+void            shell_app_index_save       (ShellAppIndex  *app_index);
+
+ShellAppIndex  *shell_app_index_ref        (ShellAppIndex  *app_index);
+void            shell_app_index_unref      (ShellAppIndex  *app_index);
+
+char         ***shell_app_index_search     (ShellAppIndex  *app_index,
+                                            const char     *search_string);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (ShellAppIndex, shell_app_index_unref)
+
+G_END_DECLS
+
+#endif /* __SHELL_APP_INDEX_PRIVATE_H__ */
@@ -0,0 +1,900 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Searching applications through g_desktop_app_info_search() makes GIO
+ * parse every desktop file once more to build its search index, on the
+ * main thread and in every session, which delays the first search
+ * results. When enabled by setting SHELL_APP_INDEX=1 in the
+ * environment, #ShellAppCache instead keeps its own index of the folded
+ * search terms of all applications, which is rebuilt off-thread with the
+ * application list and saved to a single file in the user cache
+ * directory.
+ *
+ * The file is mapped in at startup and used as long as the modification
+ * times of the applications directories match the ones recorded in it;
+ * otherwise the index is rebuilt from the applications loaded by the
+ * cache. Searches try to rank results the way GIO does, grouping them
+ * by the best key every term matched.
+ *
+ * For searching, the tokens are sorted, which turns prefix matches into
+ * a binary search, and indexed by their trigrams, which narrows down
+ * the tokens that need to be checked for substring matches. While the
+ * user keeps typing, each search only checks the applications that
+ * matched the previous one.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+#include <gio/gdesktopappinfo.h>
+
+#include "shell-app-index-private.h"
+
+#define INDEX_MAGIC "ShAppIdx"
+#define INDEX_MAGIC_LEN 8
+#define INDEX_FORMAT_VERSION 1
+
+/* Earlier is better, in the same order as GIO */
+typedef enum
+{
+  MATCH_NAME,
+  MATCH_GENERIC_NAME,
+  MATCH_FULL_NAME,
+  MATCH_KEYWORDS,
+  MATCH_CATEGORIES,
+  MATCH_COMMENT,
+  MATCH_EXEC,
+  N_MATCH_CATEGORIES
+} MatchCategory;
+
+typedef struct
+{
+  const char *text;
+  guint category;
+  guint entry;
+} IndexToken;
+
+typedef struct
+{
+  const char *id;
+  guint first_token;
+  guint n_tokens;
+} IndexEntry;
+
+typedef struct
+{
+  char *path;
+  gint64 mtime;
+} DirStamp;
+
+struct _ShellAppIndex
+{
+  /* Strings point into either of them */
+  GBytes *bytes;
+  GStringChunk *strings;
+
+  GArray *dir_stamps;
+  GArray *entries;
+  GArray *tokens;
+
+  /* Only used from the main thread, created by the first search */
+  GArray *sorted_tokens;
+  GHashTable *trigrams;
+
+  /* The last search and the entries it matched */
+  char *last_search;
+  GArray *last_entries;
+};
+
+gboolean
+shell_app_index_is_enabled (void)
+{
+  static int enabled = -1;
+
+  if (G_UNLIKELY (enabled < 0))
+    enabled = g_strcmp0 (g_getenv ("SHELL_APP_INDEX"), "1") == 0;
+
+  return enabled;
+}
+
+/* Names and keywords are localized, so is the index */
+static guint32
+version_hash (void)
+{
+  g_autofree char *languages = NULL;
+
+  languages = g_strjoinv (":", (char **) g_get_language_names ());
+
+  return g_str_hash (PACKAGE_VERSION) ^ g_str_hash (languages);
+}
+
+static char *
+get_index_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           "gnome-shell", "app-index.bin", NULL);
+}
+
+static void
+dir_stamp_clear (DirStamp *stamp)
+{
+  g_free (stamp->path);
+}
+
+static void
+add_dir_stamp (GArray     *dir_stamps,
+               const char *data_dir)
+{
+  DirStamp stamp;
+  GStatBuf stat_buf;
+
+  stamp.path = g_build_filename (data_dir, "applications", NULL);
+
+  if (g_stat (stamp.path, &stat_buf) == 0)
+    stamp.mtime = stat_buf.st_mtime;
+  else
+    stamp.mtime = -1;
+
+  g_array_append_val (dir_stamps, stamp);
+}
+
+/* Adding or removing desktop files changes the modification time of
+ * their directory. Changes while the shell is running are picked up by
+ * the cache's monitors anyway. */
+static GArray *
+get_dir_stamps (void)
+{
+  const char * const *dirs;
+  GArray *dir_stamps;
+  guint i;
+
+  dir_stamps = g_array_new (FALSE, FALSE, sizeof (DirStamp));
+  g_array_set_clear_func (dir_stamps, (GDestroyNotify) dir_stamp_clear);
+
+  add_dir_stamp (dir_stamps, g_get_user_data_dir ());
+
+  dirs = g_get_system_data_dirs ();
+  for (i = 0; dirs[i] != NULL; i++)
+    add_dir_stamp (dir_stamps, dirs[i]);
+
+  return dir_stamps;
+}
+
+static gboolean
+dir_stamps_equal (GArray *a,
+                  GArray *b)
+{
+  guint i;
+
+  if (a->len != b->len)
+    return FALSE;
+
+  for (i = 0; i < a->len; i++)
+    {
+      DirStamp *stamp_a = &g_array_index (a, DirStamp, i);
+      DirStamp *stamp_b = &g_array_index (b, DirStamp, i);
+
+      if (stamp_a->mtime != stamp_b->mtime ||
+          strcmp (stamp_a->path, stamp_b->path) != 0)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static ShellAppIndex *
+app_index_alloc (void)
+{
+  ShellAppIndex *app_index;
+
+  app_index = g_atomic_rc_box_new0 (ShellAppIndex);
+  app_index->entries = g_array_new (FALSE, FALSE, sizeof (IndexEntry));
+  app_index->tokens = g_array_new (FALSE, FALSE, sizeof (IndexToken));
+
+  return app_index;
+}
+
+static void
+app_index_clear (ShellAppIndex *app_index)
+{
+  g_clear_pointer (&app_index->bytes, g_bytes_unref);
+  g_clear_pointer (&app_index->strings, g_string_chunk_free);
+  g_clear_pointer (&app_index->dir_stamps, g_array_unref);
+  g_clear_pointer (&app_index->entries, g_array_unref);
+  g_clear_pointer (&app_index->tokens, g_array_unref);
+  g_clear_pointer (&app_index->sorted_tokens, g_array_unref);
+  g_clear_pointer (&app_index->trigrams, g_hash_table_unref);
+  g_clear_pointer (&app_index->last_search, g_free);
+  g_clear_pointer (&app_index->last_entries, g_array_unref);
+}
+
+ShellAppIndex *
+shell_app_index_ref (ShellAppIndex *app_index)
+{
+  return g_atomic_rc_box_acquire (app_index);
+}
+
+void
+shell_app_index_unref (ShellAppIndex *app_index)
+{
+  g_atomic_rc_box_release_full (app_index, (GDestroyNotify) app_index_clear);
+}
+
+static void
+add_tokens (ShellAppIndex *app_index,
+            IndexEntry    *entry,
+            const char    *text,
+            MatchCategory  category)
+{
+  g_auto (GStrv) tokens = NULL;
+  g_auto (GStrv) alternates = NULL;
+  guint i;
+
+  if (text == NULL)
+    return;
+
+  tokens = g_str_tokenize_and_fold (text, NULL, &alternates);
+
+  for (i = 0; tokens[i] != NULL; i++)
+    {
+      IndexToken token;
+
+      token.text = g_string_chunk_insert_const (app_index->strings, tokens[i]);
+      token.category = category;
+      token.entry = app_index->entries->len;
+      g_array_append_val (app_index->tokens, token);
+      entry->n_tokens++;
+    }
+
+  for (i = 0; alternates[i] != NULL; i++)
+    {
+      IndexToken token;
+
+      token.text = g_string_chunk_insert_const (app_index->strings, alternates[i]);
+      token.category = category;
+      token.entry = app_index->entries->len;
+      g_array_append_val (app_index->tokens, token);
+      entry->n_tokens++;
+    }
+}
+
+static void
+add_list_tokens (ShellAppIndex      *app_index,
+                 IndexEntry         *entry,
+                 const char * const *list,
+                 MatchCategory       category)
+{
+  guint i;
+
+  for (i = 0; list != NULL && list[i] != NULL; i++)
+    add_tokens (app_index, entry, list[i], category);
+}
+
+/**
+ * shell_app_index_new:
+ * @app_infos: (element-type GAppInfo): the installed applications
+ *
+ * Builds the index for @app_infos. This may be called from any thread.
+ *
+ * Returns: (transfer full): a new #ShellAppIndex
+ */
+ShellAppIndex *
+shell_app_index_new (GList *app_infos)
+{
+  ShellAppIndex *app_index;
+  GList *l;
+
+  app_index = app_index_alloc ();
+  app_index->strings = g_string_chunk_new (64 * 1024);
+  app_index->dir_stamps = get_dir_stamps ();
+
+  for (l = app_infos; l != NULL; l = l->next)
+    {
+      GDesktopAppInfo *info = l->data;
+      g_autofree char *full_name = NULL;
+      g_autofree char *exec = NULL;
+      g_auto (GStrv) categories = NULL;
+      const char *categories_string;
+      IndexEntry entry;
+
+      entry.id = g_string_chunk_insert_const (app_index->strings,
+                                              g_app_info_get_id (G_APP_INFO (info)));
+      entry.first_token = app_index->tokens->len;
+      entry.n_tokens = 0;
+
+      full_name = g_desktop_app_info_get_locale_string (info, "X-GNOME-FullName");
+
+      categories_string = g_desktop_app_info_get_categories (info);
+      if (categories_string != NULL)
+        categories = g_strsplit (categories_string, ";", -1);
+
+      if (g_app_info_get_executable (G_APP_INFO (info)) != NULL)
+        exec = g_path_get_basename (g_app_info_get_executable (G_APP_INFO (info)));
+
+      add_tokens (app_index, &entry, g_app_info_get_name (G_APP_INFO (info)), MATCH_NAME);
+      add_tokens (app_index, &entry, g_desktop_app_info_get_generic_name (info), MATCH_GENERIC_NAME);
+      add_tokens (app_index, &entry, full_name, MATCH_FULL_NAME);
+      add_list_tokens (app_index, &entry, g_desktop_app_info_get_keywords (info), MATCH_KEYWORDS);
+      add_list_tokens (app_index, &entry, (const char * const *) categories, MATCH_CATEGORIES);
+      add_tokens (app_index, &entry, g_app_info_get_description (G_APP_INFO (info)), MATCH_COMMENT);
+      add_tokens (app_index, &entry, exec, MATCH_EXEC);
+
+      g_array_append_val (app_index->entries, entry);
+    }
+
+  return app_index;
+}
+
+static void
+write_uint32 (GByteArray *buf,
+              guint32     value)
+{
+  g_byte_array_append (buf, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+write_int64 (GByteArray *buf,
+             gint64      value)
+{
+  g_byte_array_append (buf, (const guint8 *) &value, sizeof (value));
+}
+
+/* Strings keep their terminator, so they can be used straight from
+ * the mapped file */
+static void
+write_string (GByteArray *buf,
+              const char *string)
+{
+  guint32 len = strlen (string);
+
+  write_uint32 (buf, len);
+  g_byte_array_append (buf, (const guint8 *) string, len + 1);
+}
+
+/**
+ * shell_app_index_save:
+ * @app_index: a #ShellAppIndex
+ *
+ * Writes @app_index to disk, to be loaded by the next session. This does
+ * I/O and should be called from a worker thread. Failures are silently
+ * ignored, the index is purely an optimization.
+ */
+void
+shell_app_index_save (ShellAppIndex *app_index)
+{
+  g_autoptr (GByteArray) buf = NULL;
+  g_autofree char *path = NULL;
+  g_autofree char *dir = NULL;
+  guint i, j;
+
+  buf = g_byte_array_new ();
+  g_byte_array_append (buf, (const guint8 *) INDEX_MAGIC, INDEX_MAGIC_LEN);
+  write_uint32 (buf, INDEX_FORMAT_VERSION);
+  write_uint32 (buf, version_hash ());
+
+  write_uint32 (buf, app_index->dir_stamps->len);
+  for (i = 0; i < app_index->dir_stamps->len; i++)
+    {
+      DirStamp *stamp = &g_array_index (app_index->dir_stamps, DirStamp, i);
+
+      write_string (buf, stamp->path);
+      write_int64 (buf, stamp->mtime);
+    }
+
+  write_uint32 (buf, app_index->entries->len);
+  for (i = 0; i < app_index->entries->len; i++)
+    {
+      IndexEntry *entry = &g_array_index (app_index->entries, IndexEntry, i);
+
+      write_string (buf, entry->id);
+      write_uint32 (buf, entry->n_tokens);
+
+      for (j = 0; j < entry->n_tokens; j++)
+        {
+          IndexToken *token = &g_array_index (app_index->tokens, IndexToken,
+                                              entry->first_token + j);
+
+          write_uint32 (buf, token->category);
+          write_string (buf, token->text);
+        }
+    }
+
+  path = get_index_path ();
+  dir = g_path_get_dirname (path);
+
+  if (g_mkdir_with_parents (dir, 0700) == 0)
+    g_file_set_contents (path, (const char *) buf->data, buf->len, NULL);
+}
+
+typedef struct
+{
+  const guint8 *data;
+  gsize length;
+  gsize offset;
+} Reader;
+
+static gboolean
+read_uint32 (Reader  *reader,
+             guint32 *value)
+{
+  if (reader->length - reader->offset < sizeof (guint32))
+    return FALSE;
+
+  memcpy (value, reader->data + reader->offset, sizeof (guint32));
+  reader->offset += sizeof (guint32);
+
+  return TRUE;
+}
+
+static gboolean
+read_int64 (Reader *reader,
+            gint64 *value)
+{
+  if (reader->length - reader->offset < sizeof (gint64))
+    return FALSE;
+
+  memcpy (value, reader->data + reader->offset, sizeof (gint64));
+  reader->offset += sizeof (gint64);
+
+  return TRUE;
+}
+
+static gboolean
+read_string (Reader      *reader,
+             const char **string)
+{
+  guint32 len;
+
+  if (!read_uint32 (reader, &len) ||
+      reader->length - reader->offset <= len ||
+      reader->data[reader->offset + len] != '\0')
+    return FALSE;
+
+  *string = (const char *) reader->data + reader->offset;
+  reader->offset += len + 1;
+
+  return TRUE;
+}
+
+static gboolean
+read_index (ShellAppIndex *app_index,
+            Reader        *reader)
+{
+  guint32 version, hash, n_dirs, n_entries, i, j;
+  g_autoptr (GArray) dir_stamps = NULL;
+
+  if (reader->length < INDEX_MAGIC_LEN ||
+      memcmp (reader->data, INDEX_MAGIC, INDEX_MAGIC_LEN) != 0)
+    return FALSE;
+
+  reader->offset = INDEX_MAGIC_LEN;
+  if (!read_uint32 (reader, &version) ||
+      !read_uint32 (reader, &hash) ||
+      version != INDEX_FORMAT_VERSION ||
+      hash != version_hash ())
+    return FALSE;
+
+  if (!read_uint32 (reader, &n_dirs))
+    return FALSE;
+
+  dir_stamps = g_array_new (FALSE, FALSE, sizeof (DirStamp));
+  g_array_set_clear_func (dir_stamps, (GDestroyNotify) dir_stamp_clear);
+
+  for (i = 0; i < n_dirs; i++)
+    {
+      DirStamp stamp;
+      const char *path;
+
+      if (!read_string (reader, &path) ||
+          !read_int64 (reader, &stamp.mtime))
+        return FALSE;
+
+      stamp.path = g_strdup (path);
+      g_array_append_val (dir_stamps, stamp);
+    }
+
+  if (!dir_stamps_equal (dir_stamps, app_index->dir_stamps))
+    return FALSE;
+
+  if (!read_uint32 (reader, &n_entries))
+    return FALSE;
+
+  for (i = 0; i < n_entries; i++)
+    {
+      IndexEntry entry;
+
+      if (!read_string (reader, &entry.id) ||
+          !read_uint32 (reader, &entry.n_tokens))
+        return FALSE;
+
+      entry.first_token = app_index->tokens->len;
+
+      for (j = 0; j < entry.n_tokens; j++)
+        {
+          IndexToken token;
+          guint32 category;
+
+          if (!read_uint32 (reader, &category) ||
+              category >= N_MATCH_CATEGORIES ||
+              !read_string (reader, &token.text))
+            return FALSE;
+
+          token.category = category;
+          token.entry = i;
+          g_array_append_val (app_index->tokens, token);
+        }
+
+      g_array_append_val (app_index->entries, entry);
+    }
+
+  return TRUE;
+}
+
+/**
+ * shell_app_index_load:
+ *
+ * Maps in the index saved by a previous session.
+ *
+ * Returns: (transfer full) (nullable): the index, or %NULL if there is
+ *   none or it is out of date
+ */
+ShellAppIndex *
+shell_app_index_load (void)
+{
+  g_autoptr (GMappedFile) mapped_file = NULL;
+  g_autoptr (ShellAppIndex) app_index = NULL;
+  g_autofree char *path = NULL;
+  Reader reader = { 0, };
+
+  path = get_index_path ();
+  mapped_file = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped_file == NULL)
+    return NULL;
+
+  app_index = app_index_alloc ();
+  app_index->bytes = g_mapped_file_get_bytes (mapped_file);
+  app_index->dir_stamps = get_dir_stamps ();
+
+  reader.data = g_bytes_get_data (app_index->bytes, &reader.length);
+
+  if (!read_index (app_index, &reader))
+    return NULL;
+
+  return g_steal_pointer (&app_index);
+}
+
+typedef struct
+{
+  guint entry;
+  guint category;
+} SearchResult;
+
+static int
+compare_results (gconstpointer a,
+                 gconstpointer b)
+{
+  const SearchResult *result_a = a;
+  const SearchResult *result_b = b;
+
+  return (int) result_a->category - (int) result_b->category;
+}
+
+static inline guint32
+trigram_at (const char *text)
+{
+  return ((guint8) text[0] << 16) | ((guint8) text[1] << 8) | (guint8) text[2];
+}
+
+static int
+compare_tokens (gconstpointer a,
+                gconstpointer b,
+                gpointer      user_data)
+{
+  ShellAppIndex *app_index = user_data;
+  IndexToken *token_a = &g_array_index (app_index->tokens, IndexToken,
+                                        *(const guint *) a);
+  IndexToken *token_b = &g_array_index (app_index->tokens, IndexToken,
+                                        *(const guint *) b);
+
+  return strcmp (token_a->text, token_b->text);
+}
+
+static void
+ensure_lookup (ShellAppIndex *app_index)
+{
+  guint i;
+
+  if (app_index->sorted_tokens != NULL)
+    return;
+
+  app_index->sorted_tokens = g_array_sized_new (FALSE, FALSE, sizeof (guint),
+                                                app_index->tokens->len);
+  app_index->trigrams = g_hash_table_new_full (NULL, NULL, NULL,
+                                               (GDestroyNotify) g_array_unref);
+
+  for (i = 0; i < app_index->tokens->len; i++)
+    {
+      IndexToken *token = &g_array_index (app_index->tokens, IndexToken, i);
+      const char *p;
+
+      g_array_append_val (app_index->sorted_tokens, i);
+
+      for (p = token->text; p[0] && p[1] && p[2]; p++)
+        {
+          gpointer key = GUINT_TO_POINTER (trigram_at (p));
+          GArray *postings = g_hash_table_lookup (app_index->trigrams, key);
+
+          if (postings == NULL)
+            {
+              postings = g_array_new (FALSE, FALSE, sizeof (guint));
+              g_hash_table_insert (app_index->trigrams, key, postings);
+            }
+
+          /* Tokens can repeat a trigram */
+          if (postings->len == 0 ||
+              g_array_index (postings, guint, postings->len - 1) != i)
+            g_array_append_val (postings, i);
+        }
+    }
+
+  g_array_sort_with_data (app_index->sorted_tokens, compare_tokens, app_index);
+}
+
+/* The tokens that may contain @term, or %NULL if all of them may */
+static GArray *
+get_substring_candidates (ShellAppIndex *app_index,
+                          const char    *term,
+                          gboolean      *none)
+{
+  GArray *best = NULL;
+  const char *p;
+
+  *none = FALSE;
+
+  for (p = term; p[0] && p[1] && p[2]; p++)
+    {
+      GArray *postings;
+
+      postings = g_hash_table_lookup (app_index->trigrams,
+                                      GUINT_TO_POINTER (trigram_at (p)));
+      if (postings == NULL)
+        {
+          *none = TRUE;
+          return NULL;
+        }
+
+      if (best == NULL || postings->len < best->len)
+        best = postings;
+    }
+
+  return best;
+}
+
+static void
+update_best (ShellAppIndex *app_index,
+             guint         *best,
+             guint          token_index,
+             const char    *term)
+{
+  IndexToken *token = &g_array_index (app_index->tokens, IndexToken, token_index);
+  guint category = token->category + N_MATCH_CATEGORIES;
+
+  if (category < best[token->entry] && strstr (token->text, term) != NULL)
+    best[token->entry] = category;
+}
+
+/* Sets @best to the best category each entry matches @term with, or
+ * G_MAXUINT if it doesn't match */
+static void
+match_term_indexed (ShellAppIndex *app_index,
+                    const char    *term,
+                    guint         *best)
+{
+  GArray *sorted = app_index->sorted_tokens;
+  GArray *candidates;
+  gboolean none;
+  guint lo = 0, hi = sorted->len, i;
+
+  for (i = 0; i < app_index->entries->len; i++)
+    best[i] = G_MAXUINT;
+
+  /* Tokens starting with @term sort right where @term would */
+  while (lo < hi)
+    {
+      guint mid = lo + (hi - lo) / 2;
+      IndexToken *token = &g_array_index (app_index->tokens, IndexToken,
+                                          g_array_index (sorted, guint, mid));
+
+      if (strcmp (token->text, term) < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  for (i = lo; i < sorted->len; i++)
+    {
+      IndexToken *token = &g_array_index (app_index->tokens, IndexToken,
+                                          g_array_index (sorted, guint, i));
+
+      if (!g_str_has_prefix (token->text, term))
+        break;
+
+      best[token->entry] = MIN (best[token->entry], token->category);
+    }
+
+  candidates = get_substring_candidates (app_index, term, &none);
+  if (none)
+    return;
+
+  if (candidates != NULL)
+    {
+      for (i = 0; i < candidates->len; i++)
+        update_best (app_index, best, g_array_index (candidates, guint, i), term);
+    }
+  else
+    {
+      for (i = 0; i < app_index->tokens->len; i++)
+        update_best (app_index, best, i, term);
+    }
+}
+
+/* The best category a token of @entry matches @term with; prefix
+ * matches rank above any substring match */
+static guint
+match_term (ShellAppIndex *app_index,
+            IndexEntry    *entry,
+            const char    *term)
+{
+  guint best = G_MAXUINT;
+  guint i;
+
+  for (i = 0; i < entry->n_tokens; i++)
+    {
+      IndexToken *token = &g_array_index (app_index->tokens, IndexToken,
+                                          entry->first_token + i);
+
+      if (token->category >= best)
+        continue;
+
+      if (g_str_has_prefix (token->text, term))
+        best = token->category;
+      else if (token->category + N_MATCH_CATEGORIES < best &&
+               strstr (token->text, term) != NULL)
+        best = token->category + N_MATCH_CATEGORIES;
+    }
+
+  return best;
+}
+
+/**
+ * shell_app_index_search:
+ * @app_index: a #ShellAppIndex
+ * @search_string: the search string to use
+ *
+ * Like g_desktop_app_info_search(), but using @app_index. Applications
+ * match if all terms of @search_string match, and are grouped by the
+ * worst of the best matches of each term. This must only be called
+ * from the main thread.
+ *
+ * Returns: (array zero-terminated=1) (element-type GStrv) (transfer full):
+ *   a list of strvs
+ */
+char ***
+shell_app_index_search (ShellAppIndex *app_index,
+                        const char    *search_string)
+{
+  g_autoptr (GArray) results = NULL;
+  g_auto (GStrv) terms = NULL;
+  GPtrArray *groups, *group = NULL;
+  guint i, j, category = G_MAXUINT;
+
+  terms = g_str_tokenize_and_fold (search_string, NULL, NULL);
+  results = g_array_new (FALSE, FALSE, sizeof (SearchResult));
+
+  if (terms[0] == NULL)
+    {
+      /* Nothing to refine */
+      g_clear_pointer (&app_index->last_search, g_free);
+      g_clear_pointer (&app_index->last_entries, g_array_unref);
+    }
+  else if (app_index->last_search != NULL &&
+           g_str_has_prefix (search_string, app_index->last_search))
+    {
+      /* Terms only got longer or more, so only what matched before
+       * can match */
+      for (i = 0; i < app_index->last_entries->len; i++)
+        {
+          guint entry_index = g_array_index (app_index->last_entries, guint, i);
+          IndexEntry *entry = &g_array_index (app_index->entries, IndexEntry,
+                                              entry_index);
+          SearchResult result = { entry_index, 0 };
+
+          for (j = 0; terms[j] != NULL; j++)
+            {
+              guint term_category = match_term (app_index, entry, terms[j]);
+
+              result.category = MAX (result.category, term_category);
+              if (result.category == G_MAXUINT)
+                break;
+            }
+
+          if (result.category != G_MAXUINT)
+            g_array_append_val (results, result);
+        }
+    }
+  else
+    {
+      g_autofree guint *totals = NULL;
+      g_autofree guint *best = NULL;
+
+      ensure_lookup (app_index);
+
+      totals = g_new0 (guint, app_index->entries->len);
+      best = g_new (guint, app_index->entries->len);
+
+      for (j = 0; terms[j] != NULL; j++)
+        {
+          match_term_indexed (app_index, terms[j], best);
+
+          for (i = 0; i < app_index->entries->len; i++)
+            totals[i] = MAX (totals[i], best[i]);
+        }
+
+      for (i = 0; i < app_index->entries->len; i++)
+        {
+          SearchResult result = { i, totals[i] };
+
+          if (result.category != G_MAXUINT)
+            g_array_append_val (results, result);
+        }
+    }
+
+  if (terms[0] != NULL)
+    {
+      g_clear_pointer (&app_index->last_entries, g_array_unref);
+      app_index->last_entries = g_array_sized_new (FALSE, FALSE, sizeof (guint),
+                                                   results->len);
+
+      for (i = 0; i < results->len; i++)
+        g_array_append_val (app_index->last_entries,
+                            g_array_index (results, SearchResult, i).entry);
+
+      g_free (app_index->last_search);
+      app_index->last_search = g_strdup (search_string);
+    }
+
+  g_array_sort (results, compare_results);
+
+  groups = g_ptr_array_new ();
+
+  for (i = 0; i < results->len; i++)
+    {
+      SearchResult *result = &g_array_index (results, SearchResult, i);
+
+      if (result->category != category)
+        {
+          if (group != NULL)
+            {
+              g_ptr_array_add (group, NULL);
+              g_ptr_array_add (groups, g_ptr_array_free (group, FALSE));
+            }
+
+          group = g_ptr_array_new ();
+          category = result->category;
+        }
+
+      g_ptr_array_add (group,
+                       g_strdup (g_array_index (app_index->entries, IndexEntry,
+                                                result->entry).id));
+    }
+
+  if (group != NULL)
+    {
+      g_ptr_array_add (group, NULL);
+      g_ptr_array_add (groups, g_ptr_array_free (group, FALSE));
+    }
+
+  g_ptr_array_add (groups, NULL);
+
+  return (char ***) g_ptr_array_free (groups, FALSE);
+}
@@ -5,5 +5,8 @@
 #include "shell-app-system.h"
 
 void _shell_app_system_notify_app_state_changed (ShellAppSystem *self, ShellApp *app);
+void _shell_app_system_queue_app_change (ShellAppSystem *self, ShellApp *app);
+
+guint _shell_app_system_get_installed_serial (ShellAppSystem *self);
 
 #endif
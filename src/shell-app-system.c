@@ -40,6 +40,7 @@ enum {
 
 enum {
   APP_STATE_CHANGED,
+  APPS_CHANGED,
   INSTALLED_CHANGED,
   LAST_SIGNAL
 };
@@ -63,6 +64,13 @@ struct _ShellAppSystemPrivate {
 
   guint rescan_icons_timeout_id;
   guint n_rescan_retries;
+
+  /* Bumped whenever the installed apps change */
+  guint installed_serial;
+
+  /* Apps that changed since ::apps-changed was last emitted */
+  GHashTable *changed_apps;
+  ClutterStage *changes_stage;
 };
 
 static void shell_app_system_finalize (GObject *object);
@@ -82,6 +90,26 @@ static void shell_app_system_class_init(ShellAppSystemClass *klass)
                                              NULL, NULL, NULL,
                                              G_TYPE_NONE, 1,
                                              SHELL_TYPE_APP);
+
+  /**
+   * ShellAppSystem::apps-changed:
+   * @self: the #ShellAppSystem
+   * @apps: (element-type ShellApp): the apps that changed
+   *
+   * Emitted at most once per frame, before the stage is updated, with
+   * every app whose state or windows changed since the last emission.
+   * This lets a user interface showing many apps update them in one go,
+   * rather than on each ShellApp::windows-changed and notify::state.
+   *
+   * Changes are only collected while the signal has handlers.
+   */
+  signals[APPS_CHANGED] = g_signal_new ("apps-changed",
+                                        SHELL_TYPE_APP_SYSTEM,
+                                        G_SIGNAL_RUN_LAST,
+                                        0,
+                                        NULL, NULL, NULL,
+                                        G_TYPE_NONE, 1,
+                                        G_TYPE_PTR_ARRAY);
   signals[INSTALLED_CHANGED] =
     g_signal_new ("installed-changed",
 		  SHELL_TYPE_APP_SYSTEM,
@@ -196,14 +224,6 @@ app_is_stale (ShellApp *app)
   return !is_unchanged;
 }
 
-static gboolean
-stale_app_remove_func (gpointer key,
-                       gpointer value,
-                       gpointer user_data)
-{
-  return app_is_stale (value);
-}
-
 static void
 collect_stale_windows (gpointer key,
                        gpointer value,
@@ -282,20 +302,76 @@ rescan_icon_theme (ShellAppSystem *self)
                                                  self);
 }
 
+/* Whether one of @ids has, or had, a StartupWMClass */
+static gboolean
+affects_startup_wm_class (ShellAppSystem     *self,
+                          const char * const *ids)
+{
+  ShellAppCache *cache = shell_app_cache_get_default ();
+  ShellAppSystemPrivate *priv = self->priv;
+  GHashTableIter iter;
+  const char *id;
+  guint i;
+
+  for (i = 0; ids[i] != NULL; i++)
+    {
+      GDesktopAppInfo *info = shell_app_cache_get_info (cache, ids[i]);
+
+      if (info && g_desktop_app_info_get_startup_wm_class (info) != NULL)
+        return TRUE;
+    }
+
+  g_hash_table_iter_init (&iter, priv->startup_wm_class_to_id);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &id))
+    {
+      if (g_strv_contains (ids, id))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
 static void
-installed_changed (ShellAppCache  *cache,
-                   ShellAppSystem *self)
+installed_changed (ShellAppCache      *cache,
+                   const char * const *added,
+                   const char * const *removed,
+                   const char * const *changed,
+                   ShellAppSystem     *self)
 {
-  GPtrArray *windows = g_ptr_array_new ();
+  ShellAppSystemPrivate *priv = self->priv;
+  GPtrArray *windows;
+  guint i;
 
-  rescan_icon_theme (self);
-  scan_startup_wm_class_to_id (self);
+  priv->installed_serial++;
 
-  g_hash_table_foreach_remove (self->priv->id_to_app, stale_app_remove_func, NULL);
-  g_hash_table_foreach (self->priv->running_apps, collect_stale_windows, windows);
+  if (added[0] != NULL || changed[0] != NULL)
+    rescan_icon_theme (self);
 
-  g_ptr_array_foreach (windows, retrack_window, NULL);
-  g_ptr_array_free (windows, TRUE);
+  if (affects_startup_wm_class (self, added) ||
+      affects_startup_wm_class (self, removed) ||
+      affects_startup_wm_class (self, changed))
+    scan_startup_wm_class_to_id (self);
+
+  for (i = 0; removed[i] != NULL; i++)
+    g_hash_table_remove (priv->id_to_app, removed[i]);
+
+  for (i = 0; changed[i] != NULL; i++)
+    {
+      ShellApp *app = g_hash_table_lookup (priv->id_to_app, changed[i]);
+
+      if (app && app_is_stale (app))
+        g_hash_table_remove (priv->id_to_app, changed[i]);
+    }
+
+  /* Apps that appeared may take over windows that were window-backed
+   * so far, and windows of removed apps need to become window-backed */
+  if (added[0] != NULL || removed[0] != NULL)
+    {
+      windows = g_ptr_array_new ();
+      g_hash_table_foreach (priv->running_apps, collect_stale_windows, windows);
+      g_ptr_array_foreach (windows, retrack_window, NULL);
+      g_ptr_array_free (windows, TRUE);
+    }
 
   g_signal_emit (self, signals[INSTALLED_CHANGED], 0, NULL);
 }
@@ -314,10 +390,13 @@ shell_app_system_init (ShellAppSystem *self)
                                            (GDestroyNotify)g_object_unref);
 
   priv->startup_wm_class_to_id = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  priv->changed_apps = g_hash_table_new_full (NULL, NULL, (GDestroyNotify) g_object_unref, NULL);
 
   cache = shell_app_cache_get_default ();
   g_signal_connect (cache, "changed", G_CALLBACK (installed_changed), self);
-  installed_changed (cache, self);
+
+  rescan_icon_theme (self);
+  scan_startup_wm_class_to_id (self);
 }
 
 static void
@@ -329,6 +408,7 @@ shell_app_system_finalize (GObject *object)
   g_hash_table_destroy (priv->running_apps);
   g_hash_table_destroy (priv->id_to_app);
   g_hash_table_destroy (priv->startup_wm_class_to_id);
+  g_hash_table_destroy (priv->changed_apps);
   g_list_free_full (priv->installed_apps, g_object_unref);
   g_clear_handle_id (&priv->rescan_icons_timeout_id, g_source_remove);
 
@@ -506,6 +586,96 @@ _shell_app_system_notify_app_state_changed (ShellAppSystem *self,
       break;
     }
   g_signal_emit (self, signals[APP_STATE_CHANGED], 0, app);
+
+  _shell_app_system_queue_app_change (self, app);
+}
+
+static void
+emit_apps_changed (ShellAppSystem *self)
+{
+  ShellAppSystemPrivate *priv = self->priv;
+  g_autoptr (GPtrArray) apps = NULL;
+  GHashTableIter iter;
+  ShellApp *app;
+
+  if (g_hash_table_size (priv->changed_apps) == 0)
+    return;
+
+  apps = g_ptr_array_new_full (g_hash_table_size (priv->changed_apps),
+                               g_object_unref);
+
+  g_hash_table_iter_init (&iter, priv->changed_apps);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &app, NULL))
+    {
+      g_ptr_array_add (apps, app);
+      g_hash_table_iter_steal (&iter);
+    }
+
+  g_signal_emit (self, signals[APPS_CHANGED], 0, apps);
+}
+
+static void
+on_stage_before_update (ClutterStage     *stage,
+                        ClutterStageView *view,
+                        ClutterFrame     *frame,
+                        ShellAppSystem   *self)
+{
+  emit_apps_changed (self);
+}
+
+/*
+ * _shell_app_system_queue_app_change:
+ * @self: the #ShellAppSystem
+ * @app: an app whose state or windows changed
+ *
+ * Adds @app to the apps of the next ::apps-changed emission.
+ */
+void
+_shell_app_system_queue_app_change (ShellAppSystem *self,
+                                    ShellApp       *app)
+{
+  ShellAppSystemPrivate *priv = self->priv;
+
+  if (!g_signal_has_handler_pending (self, signals[APPS_CHANGED], 0, FALSE))
+    return;
+
+  if (priv->changes_stage == NULL)
+    {
+      priv->changes_stage = shell_global_get_stage (shell_global_get ());
+
+      /* Without a stage, there are no frames to wait for */
+      if (priv->changes_stage == NULL)
+        {
+          g_autoptr (GPtrArray) apps = g_ptr_array_new ();
+
+          g_ptr_array_add (apps, app);
+          g_signal_emit (self, signals[APPS_CHANGED], 0, apps);
+          return;
+        }
+
+      g_signal_connect_object (priv->changes_stage, "before-update",
+                               G_CALLBACK (on_stage_before_update), self, 0);
+    }
+
+  if (!g_hash_table_contains (priv->changed_apps, app))
+    {
+      g_hash_table_add (priv->changed_apps, g_object_ref (app));
+      clutter_stage_schedule_update (priv->changes_stage);
+    }
+}
+
+/*
+ * _shell_app_system_get_installed_serial:
+ * @self: A #ShellAppSystem
+ *
+ * Returns a number that changes whenever the set of installed apps or
+ * their information changes, before windows are retracked, so that
+ * results derived from the installed apps can be cached.
+ */
+guint
+_shell_app_system_get_installed_serial (ShellAppSystem *self)
+{
+  return self->priv->installed_serial;
 }
 
 /**
@@ -553,9 +723,14 @@ shell_app_system_get_running (ShellAppSystem *self)
 char ***
 shell_app_system_search (const char *search_string)
 {
-  char ***results = g_desktop_app_info_search (search_string);
+  char ***results;
   char ***groups, **ids;
 
+  results = shell_app_cache_search (shell_app_cache_get_default (),
+                                    search_string);
+  if (results == NULL)
+    results = g_desktop_app_info_search (search_string);
+
   for (groups = results; *groups; groups++)
     for (ids = *groups; *ids; ids++)
       if (!g_utf8_validate (*ids, -1, NULL))
@@ -43,7 +43,12 @@
 
 #define USAGE_CLEAN_DAYS 7 /* If after 7 days we haven't seen an app, purge it */
 
-/* Data is saved to file SHELL_CONFIG_DIR/DATA_FILENAME */
+/* Data is saved as persistent state STATE_NAME, a dictionary mapping app
+ * ids to their score and last-seen time. Older versions saved it in XML to
+ * SHELL_CONFIG_DIR/DATA_FILENAME, which is still read when there is no
+ * state yet. */
+#define STATE_NAME "application-usage"
+#define STATE_TYPE "a{s(dx)}"
 #define DATA_FILENAME "application_state"
 
 #define IDLE_TIME_TRANSITION_SECONDS 30 /* If we transition to idle, only count
@@ -84,12 +89,15 @@ struct _ShellAppUsage
   guint save_id;
   gboolean currently_idle;
   gboolean enable_monitoring;
+  gboolean dirty;
 
   long watch_start_time;
   ShellApp *watched_app;
 
   /* <char *appid, UsageData *usage> */
   GHashTable *app_usages;
+  /* UsageData *usage, by decreasing score */
+  GSequence *ranking;
 };
 
 G_DEFINE_TYPE (ShellAppUsage, shell_app_usage, G_TYPE_OBJECT);
@@ -99,6 +107,9 @@ struct UsageData
 {
   gdouble score; /* Based on the number of times we'e seen the app and normalized */
   long last_seen; /* Used to clear old apps we've only seen a few times */
+
+  const char *appid; /* Owned by the app_usages key */
+  GSequenceIter *rank; /* Position in the ranking */
 };
 
 static void shell_app_usage_finalize (GObject *object);
@@ -109,7 +120,7 @@ static void ensure_queued_save (ShellAppUsage *self);
 
 static gboolean idle_save_application_usage (gpointer data);
 
-static void restore_from_file (ShellAppUsage *self);
+static void restore_usage (ShellAppUsage *self);
 
 static void update_enable_monitoring (ShellAppUsage *self);
 
@@ -131,6 +142,53 @@ shell_app_usage_class_init (ShellAppUsageClass *klass)
   gobject_class->finalize = shell_app_usage_finalize;
 }
 
+static int
+compare_usage_rank (gconstpointer a,
+                    gconstpointer b,
+                    gpointer      data)
+{
+  const UsageData *usage_a = a;
+  const UsageData *usage_b = b;
+
+  if (usage_a->score != usage_b->score)
+    return usage_a->score > usage_b->score ? -1 : 1;
+
+  return strcmp (usage_a->appid, usage_b->appid);
+}
+
+static void
+usage_data_free (gpointer data)
+{
+  UsageData *usage = data;
+
+  g_sequence_remove (usage->rank);
+  g_free (usage);
+}
+
+/* Takes ownership of @appid */
+static UsageData *
+add_usage (ShellAppUsage *self,
+           char          *appid)
+{
+  UsageData *usage;
+
+  usage = g_new0 (UsageData, 1);
+  usage->appid = appid;
+  usage->rank = g_sequence_insert_sorted (self->ranking, usage,
+                                          compare_usage_rank, NULL);
+  g_hash_table_replace (self->app_usages, appid, usage);
+
+  return usage;
+}
+
+static void
+set_usage_score (UsageData *usage,
+                 gdouble    score)
+{
+  usage->score = score;
+  g_sequence_sort_changed (usage->rank, compare_usage_rank, NULL);
+}
+
 static UsageData *
 get_usage_for_app (ShellAppUsage *self,
                    ShellApp      *app)
@@ -142,13 +200,11 @@ get_usage_for_app (ShellAppUsage *self,
   if (usage)
     return usage;
 
-  usage = g_new0 (UsageData, 1);
-  g_hash_table_insert (self->app_usages, g_strdup (appid), usage);
-
-  return usage;
+  return add_usage (self, g_strdup (appid));
 }
 
-/* Limit the score to a certain level so that most used apps can change */
+/* Limit the score to a certain level so that most used apps can change.
+ * Halving every score keeps their order, so the ranking stays valid. */
 static void
 normalize_usage (ShellAppUsage *self)
 {
@@ -159,6 +215,8 @@ normalize_usage (ShellAppUsage *self)
 
   while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &usage))
     usage->score /= 2;
+
+  self->dirty = TRUE;
 }
 
 static void
@@ -173,12 +231,13 @@ increment_usage_for_app_at_time (ShellAppUsage *self,
   usage = get_usage_for_app (self, app);
 
   usage->last_seen = time;
+  self->dirty = TRUE;
 
   elapsed = time - self->watch_start_time;
   usage_count = elapsed / FOCUS_TIME_MIN_SECONDS;
   if (usage_count > 0)
     {
-      usage->score += usage_count;
+      set_usage_score (usage, usage->score + usage_count);
       if (usage->score > SCORE_MAX)
         normalize_usage (self);
       ensure_queued_save (self);
@@ -210,7 +269,10 @@ on_app_state_changed (ShellAppSystem *app_system,
   running = shell_app_get_state (app) == SHELL_APP_STATE_RUNNING;
 
   if (running)
-    usage->last_seen = get_time ();
+    {
+      usage->last_seen = get_time ();
+      self->dirty = TRUE;
+    }
 }
 
 static void
@@ -282,7 +344,9 @@ shell_app_usage_init (ShellAppUsage *self)
 
   global = shell_global_get ();
 
-  self->app_usages = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  self->ranking = g_sequence_new (NULL);
+  self->app_usages = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                            g_free, usage_data_free);
 
   tracker = shell_window_tracker_get_default ();
   g_signal_connect (tracker, "notify::focus-app", G_CALLBACK (on_focus_app_changed), self);
@@ -310,7 +374,7 @@ shell_app_usage_init (ShellAppUsage *self)
   g_free (shell_userdata_dir);
   self->configfile = g_file_new_for_path (path);
   g_free (path);
-  restore_from_file (self);
+  restore_usage (self);
 
   self->privacy_settings = g_settings_new(PRIVACY_SCHEMA);
   g_signal_connect (self->privacy_settings,
@@ -336,24 +400,6 @@ shell_app_usage_finalize (GObject *object)
   G_OBJECT_CLASS (shell_app_usage_parent_class)->finalize(object);
 }
 
-static int
-sort_apps_by_usage (gconstpointer a,
-                    gconstpointer b,
-                    gpointer      datap)
-{
-  ShellAppUsage *self = datap;
-  ShellApp *app_a, *app_b;
-  UsageData *usage_a, *usage_b;
-
-  app_a = (ShellApp*)a;
-  app_b = (ShellApp*)b;
-
-  usage_a = g_hash_table_lookup (self->app_usages, shell_app_get_id (app_a));
-  usage_b = g_hash_table_lookup (self->app_usages, shell_app_get_id (app_b));
-
-  return usage_b->score - usage_a->score;
-}
-
 /**
  * shell_app_usage_get_most_used:
  * @usage: the usage instance to request
@@ -364,27 +410,29 @@ GSList *
 shell_app_usage_get_most_used (ShellAppUsage   *self)
 {
   GSList *apps;
-  char *appid;
   ShellAppSystem *appsys;
-  GHashTableIter iter;
+  GSequenceIter *iter;
 
   appsys = shell_app_system_get_default ();
 
-  g_hash_table_iter_init (&iter, self->app_usages);
+  /* Walk the ranking from the bottom, so the list ends up sorted */
   apps = NULL;
-  while (g_hash_table_iter_next (&iter, (gpointer *) &appid, NULL))
+  iter = g_sequence_get_end_iter (self->ranking);
+  while (!g_sequence_iter_is_begin (iter))
     {
+      UsageData *usage;
       ShellApp *app;
 
-      app = shell_app_system_lookup_app (appsys, appid);
+      iter = g_sequence_iter_prev (iter);
+      usage = g_sequence_get (iter);
+
+      app = shell_app_system_lookup_app (appsys, usage->appid);
       if (!app)
         continue;
 
       apps = g_slist_prepend (apps, g_object_ref (app));
     }
 
-  apps = g_slist_sort_with_data (apps, sort_apps_by_usage, self);
-
   return apps;
 }
 
@@ -420,6 +468,42 @@ shell_app_usage_compare (ShellAppUsage *self,
   return usage_b->score - usage_a->score;
 }
 
+static int
+compare_ids (gconstpointer a,
+             gconstpointer b,
+             gpointer      data)
+{
+  return shell_app_usage_compare (data,
+                                  *(const char * const *) a,
+                                  *(const char * const *) b);
+}
+
+/**
+ * shell_app_usage_sort:
+ * @self: the usage instance to request
+ * @ids: (array zero-terminated=1): IDs of apps
+ *
+ * Sorts @ids by frequency of use, like sorting them with
+ * shell_app_usage_compare(), but without calling back and forth for
+ * every comparison. Apps that rank equally keep their order.
+ *
+ * Returns: (transfer full) (array zero-terminated=1): the sorted IDs
+ */
+char **
+shell_app_usage_sort (ShellAppUsage      *self,
+                      const char * const *ids)
+{
+  char **sorted;
+
+  g_return_val_if_fail (SHELL_IS_APP_USAGE (self), NULL);
+
+  sorted = g_strdupv ((char **) ids);
+  g_qsort_with_data (sorted, g_strv_length (sorted), sizeof (char *),
+                     compare_ids, self);
+
+  return sorted;
+}
+
 static void
 ensure_queued_save (ShellAppUsage *self)
 {
@@ -450,149 +534,53 @@ idle_clean_usage (ShellAppUsage *self)
     {
       if ((usage->score < SCORE_MIN) &&
           (usage->last_seen < week_ago))
-        g_hash_table_iter_remove (&iter);
+        {
+          g_hash_table_iter_remove (&iter);
+          self->dirty = TRUE;
+        }
     }
 
   return FALSE;
 }
 
-static gboolean
-write_escaped (GDataOutputStream   *stream,
-               const char          *str,
-               GError             **error)
-{
-  gboolean ret;
-  char *quoted = g_markup_escape_text (str, -1);
-  ret = g_data_output_stream_put_string (stream, quoted, NULL, error);
-  g_free (quoted);
-  return ret;
-}
-
-static gboolean
-write_attribute_string (GDataOutputStream *stream,
-                        const char        *elt_name,
-                        const char        *str,
-                        GError           **error)
-{
-  gboolean ret = FALSE;
-  char *elt;
-
-  elt = g_strdup_printf (" %s=\"", elt_name);
-  ret = g_data_output_stream_put_string (stream, elt, NULL, error);
-  g_free (elt);
-  if (!ret)
-    goto out;
-
-  ret = write_escaped (stream, str, error);
-  if (!ret)
-    goto out;
-
-  ret = g_data_output_stream_put_string (stream, "\"", NULL, error);
-
-out:
-  return ret;
-}
-
-static gboolean
-write_attribute_uint (GDataOutputStream *stream,
-                      const char        *elt_name,
-                      guint              value,
-                      GError           **error)
-{
-  gboolean ret;
-  char *buf;
-
-  buf = g_strdup_printf ("%u", value);
-  ret = write_attribute_string (stream, elt_name, buf, error);
-  g_free (buf);
-
-  return ret;
-}
-
-static gboolean
-write_attribute_double (GDataOutputStream *stream,
-                        const char        *elt_name,
-                        double             value,
-                        GError           **error)
-{
-  gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
-  gboolean ret;
-
-  g_ascii_dtostr (buf, sizeof (buf), value);
-  ret = write_attribute_string (stream, elt_name, buf, error);
-
-  return ret;
-}
-
 /* Save app data lists to file */
 static gboolean
 idle_save_application_usage (gpointer data)
 {
   ShellAppUsage *self = SHELL_APP_USAGE (data);
-  char *id;
+  ShellAppSystem *app_system = shell_app_system_get_default ();
+  GVariantBuilder builder;
+  GVariant *state;
   GHashTableIter iter;
   UsageData *usage;
-  GFileOutputStream *output;
-  GOutputStream *buffered_output;
-  GDataOutputStream *data_output;
-  GError *error = NULL;
+  char *id;
 
   self->save_id = 0;
 
-  /* Parent directory is already created by shell-global */
-  output = g_file_replace (self->configfile, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &error);
-  if (!output)
-    {
-      g_debug ("Could not save applications usage data: %s", error->message);
-      g_error_free (error);
-      return FALSE;
-    }
-  buffered_output = g_buffered_output_stream_new (G_OUTPUT_STREAM (output));
-  g_object_unref (output);
-  data_output = g_data_output_stream_new (G_OUTPUT_STREAM (buffered_output));
-  g_object_unref (buffered_output);
+  if (!self->dirty)
+    return FALSE;
 
-  if (!g_data_output_stream_put_string (data_output, "<?xml version=\"1.0\"?>\n<application-state>\n", NULL, &error))
-    goto out;
-  if (!g_data_output_stream_put_string (data_output, "  <context id=\"\">\n", NULL, &error))
-    goto out;
+  g_variant_builder_init (&builder, G_VARIANT_TYPE (STATE_TYPE));
 
   g_hash_table_iter_init (&iter, self->app_usages);
 
   while (g_hash_table_iter_next (&iter, (gpointer *) &id, (gpointer *) &usage))
     {
-      ShellApp *app;
-
-      app = shell_app_system_lookup_app (shell_app_system_get_default(), id);
-
-      if (!app)
+      if (!shell_app_system_lookup_app (app_system, id))
         continue;
 
-      if (!g_data_output_stream_put_string (data_output, "    <application", NULL, &error))
-        goto out;
-      if (!write_attribute_string (data_output, "id", id, &error))
-        goto out;
-      if (!write_attribute_double (data_output, "score", usage->score, &error))
-        goto out;
-      if (!write_attribute_uint (data_output, "last-seen", usage->last_seen, &error))
-        goto out;
-      if (!g_data_output_stream_put_string (data_output, "/>\n", NULL, &error))
-        goto out;
+      g_variant_builder_add (&builder, "{s(dx)}",
+                             id, usage->score, (gint64) usage->last_seen);
     }
-  if (!g_data_output_stream_put_string (data_output, "  </context>\n", NULL, &error))
-    goto out;
-  if (!g_data_output_stream_put_string (data_output, "</application-state>\n", NULL, &error))
-    goto out;
 
-out:
-  if (!error)
-    g_output_stream_close_async (G_OUTPUT_STREAM (data_output), 0, NULL, NULL, NULL);
-  g_object_unref (data_output);
-  if (error)
-    {
-      g_debug ("Could not save applications usage data: %s", error->message);
-      g_error_free (error);
-    }
+  /* The state file is written from a thread by shell-global, replacing
+   * the previous one atomically */
+  state = g_variant_ref_sink (g_variant_builder_end (&builder));
+  shell_global_set_persistent_state (shell_global_get (), STATE_NAME, state);
+  g_variant_unref (state);
+
+  self->dirty = FALSE;
+
   return FALSE;
 }
 
@@ -638,14 +626,13 @@ shell_app_usage_start_element_handler  (GMarkupParseContext *context,
           return;
         }
 
-      usage = g_new0 (UsageData, 1);
-      g_hash_table_insert (self->app_usages, appid, usage);
+      usage = add_usage (self, appid);
 
       for (attribute = attribute_names, value = attribute_values; *attribute; attribute++, value++)
         {
           if (strcmp (*attribute, "score") == 0)
             {
-              usage->score = g_ascii_strtod (*value, NULL);
+              set_usage_score (usage, g_ascii_strtod (*value, NULL));
             }
           else if (strcmp (*attribute, "last-seen") == 0)
             {
@@ -672,7 +659,7 @@ static GMarkupParser app_state_parse_funcs =
   NULL
 };
 
-/* Load data about apps usage from file */
+/* Load data about apps usage from the XML file of older versions */
 static void
 restore_from_file (ShellAppUsage *self)
 {
@@ -707,13 +694,48 @@ out:
   g_input_stream_close ((GInputStream*)input, NULL, NULL);
   g_object_unref (input);
 
-  idle_clean_usage (self);
-
   if (error)
     {
       g_warning ("Could not load applications usage data: %s", error->message);
       g_error_free (error);
     }
+
+  /* Carry the data over to the current format on the next save */
+  self->dirty = TRUE;
+}
+
+static void
+restore_usage (ShellAppUsage *self)
+{
+  GVariant *state;
+  GVariantIter iter;
+  const char *id;
+  gdouble score;
+  gint64 last_seen;
+
+  state = shell_global_get_persistent_state (shell_global_get (),
+                                             STATE_TYPE, STATE_NAME);
+  if (state == NULL)
+    {
+      restore_from_file (self);
+      idle_clean_usage (self);
+      return;
+    }
+
+  g_variant_ref_sink (state);
+
+  g_variant_iter_init (&iter, state);
+  while (g_variant_iter_next (&iter, "{&s(dx)}", &id, &score, &last_seen))
+    {
+      UsageData *usage = add_usage (self, g_strdup (id));
+
+      set_usage_score (usage, score);
+      usage->last_seen = last_seen;
+    }
+
+  g_variant_unref (state);
+
+  idle_clean_usage (self);
 }
 
 /* Enable or disable the timers, depending on the value of ENABLE_MONITORING_KEY
@@ -17,6 +17,8 @@ GSList *shell_app_usage_get_most_used (ShellAppUsage *usage);
 int shell_app_usage_compare (ShellAppUsage *self,
                              const char    *id_a,
                              const char    *id_b);
+char **shell_app_usage_sort (ShellAppUsage      *self,
+                             const char * const *ids);
 
 G_END_DECLS
 
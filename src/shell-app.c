@@ -912,6 +912,14 @@ shell_app_state_transition (ShellApp      *app,
   g_object_notify_by_pspec (G_OBJECT (app), props[PROP_STATE]);
 }
 
+static void
+emit_windows_changed (ShellApp *app)
+{
+  g_signal_emit (app, shell_app_signals[WINDOWS_CHANGED], 0);
+
+  _shell_app_system_queue_app_change (shell_app_system_get_default (), app);
+}
+
 static void
 shell_app_on_user_time_changed (MetaWindow *window,
                                 GParamSpec *pspec,
@@ -925,7 +933,7 @@ shell_app_on_user_time_changed (MetaWindow *window,
   if (window != app->running_state->windows->data)
     {
       app->running_state->window_sort_stale = TRUE;
-      g_signal_emit (app, shell_app_signals[WINDOWS_CHANGED], 0);
+      emit_windows_changed (app);
     }
 }
 
@@ -971,12 +979,38 @@ shell_app_on_ws_switch (MetaWorkspaceManager *workspace_manager,
                         gpointer              data)
 {
   ShellApp *app = SHELL_APP (data);
+  GSList *l;
 
   g_assert (app->running_state != NULL);
 
+  /* Only windows on the workspaces we left or entered move relative to
+   * the others; sticky windows always count as being on the active one.
+   * Most apps have none, so they keep their order and don't have to make
+   * the dash and friends refresh. */
+  for (l = app->running_state->windows; l; l = l->next)
+    {
+      MetaWindow *window = l->data;
+      MetaWorkspace *workspace;
+      int index;
+
+      if (meta_window_is_on_all_workspaces (window))
+        continue;
+
+      workspace = meta_window_get_workspace (window);
+      if (workspace == NULL)
+        continue;
+
+      index = meta_workspace_index (workspace);
+      if (index == from || index == to)
+        break;
+    }
+
+  if (l == NULL)
+    return;
+
   app->running_state->window_sort_stale = TRUE;
 
-  g_signal_emit (app, shell_app_signals[WINDOWS_CHANGED], 0);
+  emit_windows_changed (app);
 }
 
 gboolean
@@ -1094,7 +1128,7 @@ _shell_app_add_window (ShellApp        *app,
 
   g_object_thaw_notify (G_OBJECT (app));
 
-  g_signal_emit (app, shell_app_signals[WINDOWS_CHANGED], 0);
+  emit_windows_changed (app);
 }
 
 void
@@ -1120,7 +1154,7 @@ _shell_app_remove_window (ShellApp   *app,
 
   g_object_unref (window);
 
-  g_signal_emit (app, shell_app_signals[WINDOWS_CHANGED], 0);
+  emit_windows_changed (app);
 }
 
 /**
@@ -1353,7 +1387,12 @@ shell_app_launch (ShellApp           *app,
   flags = G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD |
           G_SPAWN_LEAVE_DESCRIPTORS_OPEN;
 
-  /* Optimized spawn path, avoiding a child_setup function */
+  /* This has to stay on the main thread: the launch context hands out
+   * startup notification ids and emits ::launched, which starts the
+   * systemd scope asynchronously, from the thread that launches. The
+   * child setup restores the file descriptor limit, so the spawn can't
+   * take the posix_spawn() path.
+   */
   {
     int journalfd = -1;
 
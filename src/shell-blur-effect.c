@@ -23,6 +23,7 @@
 #include "shell-blur-effect.h"
 
 #include "shell-enum-types.h"
+#include "st.h"
 
 /**
  * SECTION:shell-blur-effect
@@ -38,8 +39,18 @@
  * background mode blurs the pixels beneath the actor, but not the actor itself.
  *
  * @SHELL_BLUR_MODE_BACKGROUND can be computationally expensive, since the contents
- * beneath the actor cannot be cached, so beware of the performance implications
- * of using this blur mode.
+ * beneath the actor are copied and blurred again whenever that part of the
+ * stage is redrawn, so beware of the performance implications of using this
+ * blur mode.
+ *
+ * # Algorithms
+ *
+ * By default, #ShellBlurEffect runs a gaussian blur on a copy of the contents
+ * that is downscaled depending on the radius. With
+ * @SHELL_BLUR_ALGORITHM_DUAL_KAWASE it instead downsamples and upsamples the
+ * contents through a chain of framebuffers with a few texture fetches per
+ * pixel, which is much cheaper for large radii. The chain only depends on the
+ * size of the contents, so the radius can be animated without reallocating it.
  */
 
 static const gchar *brightness_glsl_declarations =
@@ -48,9 +59,44 @@ static const gchar *brightness_glsl_declarations =
 static const gchar *brightness_glsl =
 "  cogl_color_out.rgb *= brightness;                                       \n";
 
+static const gchar *kawase_glsl_declarations =
+"uniform vec2 pixel_step;                                                  \n";
+
+static const gchar *kawase_downsample_glsl =
+"  vec2 uv = vec2 (cogl_tex_coord.st);                                     \n"
+"  vec2 step_flipped = vec2 (pixel_step.x, -pixel_step.y);                 \n"
+"                                                                          \n"
+"  vec4 sum = texture2D (cogl_sampler, uv) * 4.0;                          \n"
+"  sum += texture2D (cogl_sampler, uv - pixel_step);                       \n"
+"  sum += texture2D (cogl_sampler, uv + pixel_step);                       \n"
+"  sum += texture2D (cogl_sampler, uv - step_flipped);                     \n"
+"  sum += texture2D (cogl_sampler, uv + step_flipped);                     \n"
+"                                                                          \n"
+"  cogl_texel = sum / 8.0;                                                 \n";
+
+static const gchar *kawase_upsample_glsl =
+"  vec2 uv = vec2 (cogl_tex_coord.st);                                     \n"
+"  vec2 step_x = vec2 (pixel_step.x, 0.0);                                 \n"
+"  vec2 step_y = vec2 (0.0, pixel_step.y);                                 \n"
+"                                                                          \n"
+"  vec4 sum = texture2D (cogl_sampler, uv - step_x * 2.0);                 \n"
+"  sum += texture2D (cogl_sampler, uv + step_x * 2.0);                     \n"
+"  sum += texture2D (cogl_sampler, uv - step_y * 2.0);                     \n"
+"  sum += texture2D (cogl_sampler, uv + step_y * 2.0);                     \n"
+"  sum += texture2D (cogl_sampler, uv - step_x - step_y) * 2.0;            \n"
+"  sum += texture2D (cogl_sampler, uv - step_x + step_y) * 2.0;            \n"
+"  sum += texture2D (cogl_sampler, uv + step_x - step_y) * 2.0;            \n"
+"  sum += texture2D (cogl_sampler, uv + step_x + step_y) * 2.0;            \n"
+"                                                                          \n"
+"  cogl_texel = sum / 12.0;                                                \n";
+
 #define MIN_DOWNSCALE_SIZE 256.f
 #define MAX_RADIUS 12.f
 
+#define MAX_KAWASE_LEVELS 6
+#define MIN_KAWASE_LEVEL_SIZE 8
+#define MAX_KAWASE_OFFSET 2.f
+
 typedef enum
 {
   ACTOR_PAINTED = 1 << 0,
@@ -64,6 +110,16 @@ typedef struct
   CoglTexture *texture;
 } FramebufferData;
 
+typedef struct
+{
+  /* Downsampled from the previous level */
+  FramebufferData down;
+  /* Upsampled from the next level */
+  FramebufferData up;
+  /* Upsamples the downsampled texture when this is the last level used */
+  CoglPipeline *upsample_pipeline;
+} KawaseLevel;
+
 struct _ShellBlurEffect
 {
   ClutterEffect parent_instance;
@@ -78,10 +134,15 @@ struct _ShellBlurEffect
   CacheFlags cache_flags;
 
   FramebufferData background_fb;
+  ClutterStageView *background_view;
   FramebufferData brightness_fb;
   int brightness_uniform;
 
+  KawaseLevel kawase_levels[MAX_KAWASE_LEVELS];
+  int n_kawase_levels;
+
   ShellBlurMode mode;
+  ShellBlurAlgorithm algorithm;
   float downscale_factor;
   float brightness;
   int radius;
@@ -94,6 +155,7 @@ enum {
   PROP_RADIUS,
   PROP_BRIGHTNESS,
   PROP_MODE,
+  PROP_ALGORITHM,
   N_PROPS
 };
 
@@ -144,6 +206,48 @@ create_brightness_pipeline (void)
   return cogl_pipeline_copy (brightness_pipeline);
 }
 
+static CoglPipeline*
+create_kawase_pipeline (gboolean upsample)
+{
+  static CoglPipeline *downsample_pipeline = NULL;
+  static CoglPipeline *upsample_pipeline = NULL;
+  CoglPipeline **pipeline = upsample ? &upsample_pipeline : &downsample_pipeline;
+
+  if (G_UNLIKELY (*pipeline == NULL))
+    {
+      CoglSnippet *snippet;
+
+      *pipeline = create_base_pipeline ();
+
+      snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_TEXTURE_LOOKUP,
+                                  kawase_glsl_declarations,
+                                  NULL);
+      cogl_snippet_set_replace (snippet,
+                                upsample ? kawase_upsample_glsl
+                                         : kawase_downsample_glsl);
+      cogl_pipeline_add_layer_snippet (*pipeline, 0, snippet);
+      g_object_unref (snippet);
+    }
+
+  return cogl_pipeline_copy (*pipeline);
+}
+
+static CoglPipeline*
+create_source_pipeline (ShellBlurAlgorithm algorithm)
+{
+  /* With dual Kawase, the actor or background texture is downsampled
+   * straight into the first level */
+  switch (algorithm)
+    {
+    case SHELL_BLUR_ALGORITHM_DUAL_KAWASE:
+      return create_kawase_pipeline (FALSE);
+
+    case SHELL_BLUR_ALGORITHM_GAUSSIAN:
+    default:
+      return create_base_pipeline ();
+    }
+}
+
 
 static void
 update_brightness (ShellBlurEffect *self,
@@ -186,16 +290,16 @@ update_fbo (FramebufferData *data,
             unsigned int     height,
             float            downscale_factor)
 {
-  CoglContext *ctx =
-    clutter_backend_get_cogl_context (clutter_get_default_backend ());
-
   g_clear_object (&data->texture);
   g_clear_object (&data->framebuffer);
 
   float new_width = floorf (width / downscale_factor);
   float new_height = floorf (height / downscale_factor);
 
-  data->texture = cogl_texture_2d_new_with_size (ctx, new_width, new_height);
+  if (new_width < 1 || new_height < 1)
+    return FALSE;
+
+  data->texture = st_texture_pool_acquire (new_width, new_height);
   if (!data->texture)
     return FALSE;
 
@@ -274,6 +378,81 @@ clear_framebuffer_data (FramebufferData *fb_data)
   g_clear_object (&fb_data->framebuffer);
 }
 
+static void
+clear_kawase_levels (ShellBlurEffect *self)
+{
+  int i;
+
+  for (i = 0; i < MAX_KAWASE_LEVELS; i++)
+    {
+      clear_framebuffer_data (&self->kawase_levels[i].down);
+      clear_framebuffer_data (&self->kawase_levels[i].up);
+    }
+
+  self->n_kawase_levels = 0;
+}
+
+static gboolean
+update_kawase_fbos (ShellBlurEffect *self,
+                    unsigned int     width,
+                    unsigned int     height)
+{
+  int n_levels;
+  int i;
+
+  if (self->tex_width == width &&
+      self->tex_height == height &&
+      self->n_kawase_levels > 0)
+    {
+      return TRUE;
+    }
+
+  clear_kawase_levels (self);
+
+  n_levels = 0;
+  while (n_levels < MAX_KAWASE_LEVELS &&
+         (width >> (n_levels + 1)) >= MIN_KAWASE_LEVEL_SIZE &&
+         (height >> (n_levels + 1)) >= MIN_KAWASE_LEVEL_SIZE)
+    n_levels++;
+
+  for (i = 0; i < n_levels; i++)
+    {
+      KawaseLevel *level = &self->kawase_levels[i];
+      float downscale_factor = 1 << (i + 1);
+
+      if (G_UNLIKELY (level->down.pipeline == NULL))
+        {
+          level->down.pipeline = create_kawase_pipeline (FALSE);
+          level->up.pipeline = create_kawase_pipeline (TRUE);
+          level->upsample_pipeline = create_kawase_pipeline (TRUE);
+        }
+
+      if (!update_fbo (&level->down, width, height, downscale_factor))
+        goto fail;
+
+      /* The level with the lowest resolution is never upsampled into */
+      if (i < n_levels - 1 &&
+          !update_fbo (&level->up, width, height, downscale_factor))
+        goto fail;
+
+      cogl_pipeline_set_layer_texture (level->upsample_pipeline, 0,
+                                       level->down.texture);
+
+      /* All levels are drawn in the coordinates of the full size texture */
+      setup_projection_matrix (level->down.framebuffer, width, height);
+      if (level->up.framebuffer)
+        setup_projection_matrix (level->up.framebuffer, width, height);
+    }
+
+  self->n_kawase_levels = n_levels;
+
+  return n_levels > 0;
+
+fail:
+  clear_kawase_levels (self);
+  return FALSE;
+}
+
 static float
 calculate_downscale_factor (float width,
                             float height,
@@ -316,6 +495,8 @@ shell_blur_effect_set_actor (ClutterActorMeta *meta,
   clear_framebuffer_data (&self->actor_fb);
   clear_framebuffer_data (&self->background_fb);
   clear_framebuffer_data (&self->brightness_fb);
+  clear_kawase_levels (self);
+  self->cache_flags &= ~BLUR_APPLIED;
 
   /* we keep a back pointer here, to avoid going through the ActorMeta */
   self->actor = clutter_actor_meta_get_actor (meta);
@@ -397,6 +578,132 @@ add_blurred_pipeline (ShellBlurEffect  *self,
                                     });
 }
 
+static void
+calculate_kawase_parameters (float  radius,
+                             int    max_iterations,
+                             int   *n_iterations,
+                             float *offset)
+{
+  int n = 1;
+
+  /* Every iteration doubles the reach of the blur; the sampling offset
+   * covers the radii in between, so that the radius can change
+   * continuously.
+   */
+  while (n < max_iterations && radius > MAX_KAWASE_OFFSET * (1 << n))
+    n++;
+
+  *n_iterations = n;
+  *offset = radius / (1 << n);
+}
+
+static void
+set_kawase_offset (CoglPipeline *pipeline,
+                   CoglTexture  *texture,
+                   float         offset)
+{
+  float pixel_step[2];
+  int location;
+
+  location = cogl_pipeline_get_uniform_location (pipeline, "pixel_step");
+
+  pixel_step[0] = offset / cogl_texture_get_width (texture);
+  pixel_step[1] = offset / cogl_texture_get_height (texture);
+
+  cogl_pipeline_set_uniform_float (pipeline, location, 2, 1, pixel_step);
+}
+
+static ClutterPaintNode *
+add_kawase_layer_node (ShellBlurEffect  *self,
+                       ClutterPaintNode *parent,
+                       FramebufferData  *data,
+                       CoglPipeline     *pipeline,
+                       const char       *name)
+{
+  ClutterPaintNode *layer_node;
+
+  layer_node = clutter_layer_node_new_to_framebuffer (data->framebuffer,
+                                                      pipeline);
+  clutter_paint_node_set_static_name (layer_node, name);
+  clutter_paint_node_add_child (parent, layer_node);
+  clutter_paint_node_add_rectangle (layer_node,
+                                    &(ClutterActorBox) {
+                                      0.f, 0.f,
+                                      self->tex_width,
+                                      self->tex_height,
+                                    });
+
+  return layer_node;
+}
+
+/* Adds the levels used for the current radius, from the outermost
+ * upsampling level to the innermost downsampling one, and returns the
+ * latter for the actor or background to be painted into.
+ */
+static ClutterPaintNode *
+create_kawase_nodes (ShellBlurEffect  *self,
+                     ClutterPaintNode *node)
+{
+  ClutterPaintNode *parent;
+  FramebufferData *source_fb;
+  int n_iterations;
+  float offset;
+  int i;
+
+  calculate_kawase_parameters (self->radius, self->n_kawase_levels,
+                               &n_iterations, &offset);
+
+  parent = clutter_paint_node_ref (node);
+
+  for (i = 0; i < n_iterations - 1; i++)
+    {
+      KawaseLevel *level = &self->kawase_levels[i];
+      ClutterPaintNode *layer_node;
+
+      set_kawase_offset (level->up.pipeline, level->up.texture, offset);
+      layer_node = add_kawase_layer_node (self, parent, &level->up,
+                                          level->up.pipeline,
+                                          "ShellBlurEffect (kawase upsample)");
+      clutter_paint_node_unref (parent);
+      parent = layer_node;
+    }
+
+  for (i = n_iterations - 1; i >= 0; i--)
+    {
+      KawaseLevel *level = &self->kawase_levels[i];
+      CoglPipeline *pipeline;
+      ClutterPaintNode *layer_node;
+
+      if (i == n_iterations - 1)
+        pipeline = level->upsample_pipeline;
+      else
+        pipeline = level->down.pipeline;
+
+      set_kawase_offset (pipeline, level->down.texture, offset);
+      layer_node = add_kawase_layer_node (self, parent, &level->down,
+                                          pipeline,
+                                          "ShellBlurEffect (kawase downsample)");
+      clutter_paint_node_unref (parent);
+      parent = layer_node;
+    }
+
+  switch (self->mode)
+    {
+    case SHELL_BLUR_MODE_ACTOR:
+      source_fb = &self->actor_fb;
+      break;
+
+    case SHELL_BLUR_MODE_BACKGROUND:
+    default:
+      source_fb = &self->background_fb;
+      break;
+    }
+
+  set_kawase_offset (source_fb->pipeline, source_fb->texture, offset);
+
+  return parent;
+}
+
 static ClutterPaintNode *
 create_blur_nodes (ShellBlurEffect  *self,
                    ClutterPaintNode *node,
@@ -420,17 +727,27 @@ create_blur_nodes (ShellBlurEffect  *self,
                                       width, height,
                                     });
 
-  blur_node = clutter_blur_node_new (self->tex_width / self->downscale_factor,
-                                     self->tex_height / self->downscale_factor,
-                                     self->radius / self->downscale_factor);
-  clutter_paint_node_set_static_name (blur_node, "ShellBlurEffect (blur)");
-  clutter_paint_node_add_child (brightness_node, blur_node);
-  clutter_paint_node_add_rectangle (blur_node,
-                                    &(ClutterActorBox) {
-                                      0.f, 0.f,
-                                      cogl_texture_get_width (self->brightness_fb.texture),
-                                      cogl_texture_get_height (self->brightness_fb.texture),
-                                    });
+  switch (self->algorithm)
+    {
+    case SHELL_BLUR_ALGORITHM_DUAL_KAWASE:
+      blur_node = create_kawase_nodes (self, brightness_node);
+      break;
+
+    case SHELL_BLUR_ALGORITHM_GAUSSIAN:
+    default:
+      blur_node = clutter_blur_node_new (self->tex_width / self->downscale_factor,
+                                         self->tex_height / self->downscale_factor,
+                                         self->radius / self->downscale_factor);
+      clutter_paint_node_set_static_name (blur_node, "ShellBlurEffect (blur)");
+      clutter_paint_node_add_child (brightness_node, blur_node);
+      clutter_paint_node_add_rectangle (blur_node,
+                                        &(ClutterActorBox) {
+                                          0.f, 0.f,
+                                          cogl_texture_get_width (self->brightness_fb.texture),
+                                          cogl_texture_get_height (self->brightness_fb.texture),
+                                        });
+      break;
+    }
 
   self->cache_flags |= BLUR_APPLIED;
 
@@ -496,11 +813,18 @@ update_framebuffers (ShellBlurEffect     *self,
 
   clutter_actor_box_get_size (source_actor_box, &width, &height);
 
-  downscale_factor = calculate_downscale_factor (width, height, self->radius);
+  /* The dual Kawase levels take care of downscaling */
+  if (self->algorithm == SHELL_BLUR_ALGORITHM_DUAL_KAWASE)
+    downscale_factor = 1.0;
+  else
+    downscale_factor = calculate_downscale_factor (width, height, self->radius);
 
   updated = update_actor_fbo (self, width, height, downscale_factor) &&
             update_brightness_fbo (self, width, height, downscale_factor);
 
+  if (self->algorithm == SHELL_BLUR_ALGORITHM_DUAL_KAWASE)
+    updated = updated && update_kawase_fbos (self, width, height);
+
   if (self->mode == SHELL_BLUR_MODE_BACKGROUND)
     updated = updated && update_background_fbo (self, width, height);
 
@@ -581,8 +905,41 @@ paint_actor_offscreen (ShellBlurEffect         *self,
     }
 }
 
+/* The background is copied from the stage view being painted; it is only
+ * known to be unchanged when the same view is painted again and none of
+ * the area beneath the actor is part of what is being redrawn.
+ */
+static gboolean
+background_changed (ShellBlurEffect     *self,
+                    ClutterPaintContext *paint_context)
+{
+  const MtkRegion *redraw_clip;
+  MtkRectangle rect;
+  float x, y, width, height;
+
+  if (clutter_paint_context_get_stage_view (paint_context) != self->background_view)
+    return TRUE;
+
+  redraw_clip = clutter_paint_context_get_redraw_clip (paint_context);
+  if (!redraw_clip)
+    return TRUE;
+
+  clutter_actor_get_transformed_position (self->actor, &x, &y);
+  clutter_actor_get_transformed_size (self->actor, &width, &height);
+
+  rect = (MtkRectangle) {
+    .x = floorf (x),
+    .y = floorf (y),
+    .width = ceilf (x + width) - floorf (x),
+    .height = ceilf (y + height) - floorf (y),
+  };
+
+  return mtk_region_contains_rectangle (redraw_clip, &rect) != MTK_REGION_OVERLAP_OUT;
+}
+
 static gboolean
 needs_repaint (ShellBlurEffect         *self,
+               ClutterPaintContext     *paint_context,
                ClutterEffectPaintFlags  flags)
 {
   gboolean actor_cached;
@@ -599,7 +956,7 @@ needs_repaint (ShellBlurEffect         *self,
       return actor_dirty || !blur_cached || !actor_cached;
 
     case SHELL_BLUR_MODE_BACKGROUND:
-      return TRUE;
+      return !blur_cached || background_changed (self, paint_context);
     }
 
   return TRUE;
@@ -635,7 +992,7 @@ shell_blur_effect_paint_node (ClutterEffect           *effect,
           break;
         }
 
-      if (needs_repaint (self, flags))
+      if (needs_repaint (self, paint_context, flags))
         {
           ClutterActorBox source_actor_box;
 
@@ -657,6 +1014,8 @@ shell_blur_effect_paint_node (ClutterEffect           *effect,
 
             case SHELL_BLUR_MODE_BACKGROUND:
               paint_background (self, blur_node, paint_context, &source_actor_box);
+              g_set_weak_pointer (&self->background_view,
+                                  clutter_paint_context_get_stage_view (paint_context));
               break;
             }
         }
@@ -693,15 +1052,25 @@ static void
 shell_blur_effect_finalize (GObject *object)
 {
   ShellBlurEffect *self = (ShellBlurEffect *)object;
+  int i;
 
   clear_framebuffer_data (&self->actor_fb);
   clear_framebuffer_data (&self->background_fb);
   clear_framebuffer_data (&self->brightness_fb);
+  clear_kawase_levels (self);
+  g_clear_weak_pointer (&self->background_view);
 
   g_clear_object (&self->actor_fb.pipeline);
   g_clear_object (&self->background_fb.pipeline);
   g_clear_object (&self->brightness_fb.pipeline);
 
+  for (i = 0; i < MAX_KAWASE_LEVELS; i++)
+    {
+      g_clear_object (&self->kawase_levels[i].down.pipeline);
+      g_clear_object (&self->kawase_levels[i].up.pipeline);
+      g_clear_object (&self->kawase_levels[i].upsample_pipeline);
+    }
+
   G_OBJECT_CLASS (shell_blur_effect_parent_class)->finalize (object);
 }
 
@@ -727,6 +1096,10 @@ shell_blur_effect_get_property (GObject    *object,
       g_value_set_enum (value, self->mode);
       break;
 
+    case PROP_ALGORITHM:
+      g_value_set_enum (value, self->algorithm);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -754,6 +1127,10 @@ shell_blur_effect_set_property (GObject      *object,
       shell_blur_effect_set_mode (self, g_value_get_enum (value));
       break;
 
+    case PROP_ALGORITHM:
+      shell_blur_effect_set_algorithm (self, g_value_get_enum (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
@@ -796,6 +1173,14 @@ shell_blur_effect_class_init (ShellBlurEffectClass *klass)
                        SHELL_BLUR_MODE_ACTOR,
                        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_EXPLICIT_NOTIFY);
 
+  properties[PROP_ALGORITHM] =
+    g_param_spec_enum ("algorithm",
+                       "Blur algorithm",
+                       "Blur algorithm",
+                       SHELL_TYPE_BLUR_ALGORITHM,
+                       SHELL_BLUR_ALGORITHM_GAUSSIAN,
+                       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_EXPLICIT_NOTIFY);
+
   g_object_class_install_properties (object_class, N_PROPS, properties);
 }
 
@@ -803,6 +1188,7 @@ static void
 shell_blur_effect_init (ShellBlurEffect *self)
 {
   self->mode = SHELL_BLUR_MODE_ACTOR;
+  self->algorithm = SHELL_BLUR_ALGORITHM_GAUSSIAN;
   self->radius = 0;
   self->brightness = 1.f;
 
@@ -908,3 +1294,39 @@ shell_blur_effect_set_mode (ShellBlurEffect *self,
 
   g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_MODE]);
 }
+
+ShellBlurAlgorithm
+shell_blur_effect_get_algorithm (ShellBlurEffect *self)
+{
+  g_return_val_if_fail (SHELL_IS_BLUR_EFFECT (self), -1);
+
+  return self->algorithm;
+}
+
+void
+shell_blur_effect_set_algorithm (ShellBlurEffect    *self,
+                                 ShellBlurAlgorithm  algorithm)
+{
+  g_return_if_fail (SHELL_IS_BLUR_EFFECT (self));
+
+  if (self->algorithm == algorithm)
+    return;
+
+  self->algorithm = algorithm;
+  self->cache_flags &= ~(ACTOR_PAINTED | BLUR_APPLIED);
+
+  /* The actor and background textures are sampled differently */
+  clear_framebuffer_data (&self->actor_fb);
+  clear_framebuffer_data (&self->background_fb);
+  g_clear_object (&self->actor_fb.pipeline);
+  g_clear_object (&self->background_fb.pipeline);
+  self->actor_fb.pipeline = create_source_pipeline (algorithm);
+  self->background_fb.pipeline = create_source_pipeline (algorithm);
+
+  clear_kawase_levels (self);
+
+  if (self->actor)
+    clutter_effect_queue_repaint (CLUTTER_EFFECT (self));
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_ALGORITHM]);
+}
@@ -37,6 +37,20 @@ typedef enum
   SHELL_BLUR_MODE_BACKGROUND,
 } ShellBlurMode;
 
+/**
+ * ShellBlurAlgorithm:
+ * @SHELL_BLUR_ALGORITHM_GAUSSIAN: a gaussian blur on a downscaled copy
+ * @SHELL_BLUR_ALGORITHM_DUAL_KAWASE: a dual Kawase blur over a chain of
+ *   progressively downscaled copies
+ *
+ * The algorithm used to blur.
+ */
+typedef enum
+{
+  SHELL_BLUR_ALGORITHM_GAUSSIAN,
+  SHELL_BLUR_ALGORITHM_DUAL_KAWASE,
+} ShellBlurAlgorithm;
+
 #define SHELL_TYPE_BLUR_EFFECT (shell_blur_effect_get_type())
 G_DECLARE_FINAL_TYPE (ShellBlurEffect, shell_blur_effect, SHELL, BLUR_EFFECT, ClutterEffect)
 
@@ -54,4 +68,8 @@ ShellBlurMode shell_blur_effect_get_mode (ShellBlurEffect *self);
 void shell_blur_effect_set_mode (ShellBlurEffect *self,
                                  ShellBlurMode    mode);
 
+ShellBlurAlgorithm shell_blur_effect_get_algorithm (ShellBlurEffect *self);
+void shell_blur_effect_set_algorithm (ShellBlurEffect    *self,
+                                      ShellBlurAlgorithm  algorithm);
+
 G_END_DECLS
@@ -29,6 +29,7 @@
 #endif
 
 #define RECONNECT_DELAY_MS 5000
+#define RECONNECT_MAX_DELAY_MS (5 * 60 * 1000)
 #define DISABLE_DELAY_MS 500
 
 enum {
@@ -45,8 +46,11 @@ struct _ShellCameraMonitor {
   gboolean cameras_in_use;
 
 #ifdef HAVE_PIPEWIRE
-  GPtrArray *node_list;
+  GHashTable *nodes; /* bound ID -> struct pw_proxy * */
+  guint n_running_nodes;
+  guint update_state_id;
   guint reconnect_id;
+  guint reconnect_delay_ms;
   guint delayed_disable_id;
 
   GSource *pipewire_source;
@@ -89,25 +93,14 @@ delayed_disable_state (gpointer data)
 }
 
 static void
-shell_camera_monitor_update_state (ShellCameraMonitor *monitor)
+shell_camera_monitor_update_state (gpointer data)
 {
-  gboolean new_cameras_in_use = FALSE;
-  int i;
+  ShellCameraMonitor *monitor = SHELL_CAMERA_MONITOR (data);
+  gboolean new_cameras_in_use;
 
-  for (i = 0; i < monitor->node_list->len; i++)
-    {
-      struct pw_proxy *proxy;
-      Node *node;
+  monitor->update_state_id = 0;
 
-      proxy = g_ptr_array_index (monitor->node_list, i);
-      node = pw_proxy_get_user_data (proxy);
-
-      if (node->running)
-        {
-          new_cameras_in_use = TRUE;
-          break;
-        }
-    }
+  new_cameras_in_use = monitor->n_running_nodes > 0;
 
   if (new_cameras_in_use)
     g_clear_handle_id (&monitor->delayed_disable_id, g_source_remove);
@@ -126,11 +119,42 @@ shell_camera_monitor_update_state (ShellCameraMonitor *monitor)
     }
 }
 
+/* Nodes change state in bursts, as when docks come and go, so the
+ * state is only looked at again once per main loop iteration */
+static void
+shell_camera_monitor_queue_update_state (ShellCameraMonitor *monitor)
+{
+  if (monitor->update_state_id != 0)
+    return;
+
+  monitor->update_state_id =
+    g_idle_add_once (shell_camera_monitor_update_state, monitor);
+}
+
+static void
+node_set_running (Node     *node,
+                  gboolean  running)
+{
+  if (node->running == running)
+    return;
+
+  node->running = running;
+
+  if (running)
+    node->monitor->n_running_nodes++;
+  else
+    node->monitor->n_running_nodes--;
+
+  shell_camera_monitor_queue_update_state (node->monitor);
+}
+
 static void
 proxy_destroy (void *data)
 {
   Node *node = data;
 
+  node_set_running (node, FALSE);
+
   spa_hook_remove (&node->proxy_listener);
   spa_hook_remove (&node->object_listener);
 }
@@ -146,9 +170,7 @@ node_event_info (void                      *data,
 {
   Node *node = data;
 
-  node->running = (info->state == PW_NODE_STATE_RUNNING);
-
-  shell_camera_monitor_update_state (node->monitor);
+  node_set_running (node, info->state == PW_NODE_STATE_RUNNING);
 }
 
 static const struct pw_node_events node_events = {
@@ -169,6 +191,9 @@ registry_event_global (void                  *data,
   const char *prop_str;
   Node *node;
 
+  /* The connection works, start over with short delays */
+  monitor->reconnect_delay_ms = RECONNECT_DELAY_MS;
+
   if (!props || !(spa_streq (type, PW_TYPE_INTERFACE_Node)))
     return;
 
@@ -194,7 +219,7 @@ registry_event_global (void                  *data,
                                 &node_events,
                                 node);
 
-  g_ptr_array_add (monitor->node_list, proxy);
+  g_hash_table_replace (monitor->nodes, GUINT_TO_POINTER (id), proxy);
 }
 
 static void
@@ -202,23 +227,8 @@ registry_event_global_remove (void     *data,
                               uint32_t  id)
 {
   ShellCameraMonitor *monitor = SHELL_CAMERA_MONITOR (data);
-  struct pw_proxy *proxy_to_remove = NULL;
-  int i;
-
-  for (i = 0; i < monitor->node_list->len; i++)
-    {
-      struct pw_proxy *proxy;
-
-      proxy = g_ptr_array_index (monitor->node_list, i);
-      if (pw_proxy_get_bound_id (proxy) == id)
-        {
-          proxy_to_remove = proxy;
-          break;
-        }
-    }
 
-  if (proxy_to_remove)
-    g_ptr_array_remove (monitor->node_list, proxy_to_remove);
+  g_hash_table_remove (monitor->nodes, GUINT_TO_POINTER (id));
 }
 
 static const struct pw_registry_events registry_events = {
@@ -227,6 +237,19 @@ static const struct pw_registry_events registry_events = {
   .global_remove = registry_event_global_remove,
 };
 
+static void idle_reconnect (gpointer data);
+
+/* Waits twice as long after every failed attempt */
+static void
+shell_camera_monitor_schedule_reconnect (ShellCameraMonitor *monitor)
+{
+  monitor->reconnect_id =
+    g_timeout_add_once (monitor->reconnect_delay_ms, idle_reconnect, monitor);
+
+  monitor->reconnect_delay_ms = MIN (monitor->reconnect_delay_ms * 2,
+                                     RECONNECT_MAX_DELAY_MS);
+}
+
 static void
 idle_reconnect (gpointer data)
 {
@@ -235,8 +258,7 @@ idle_reconnect (gpointer data)
   if (shell_camera_monitor_connect_core (monitor))
     monitor->reconnect_id = 0;
   else
-    monitor->reconnect_id =
-      g_timeout_add_once (RECONNECT_DELAY_MS, idle_reconnect, monitor);
+    shell_camera_monitor_schedule_reconnect (monitor);
 }
 
 static void
@@ -259,8 +281,7 @@ on_core_error (void       *data,
         }
 
       if (monitor->reconnect_id == 0)
-        monitor->reconnect_id =
-          g_timeout_add_once (RECONNECT_DELAY_MS, idle_reconnect, monitor);
+        shell_camera_monitor_schedule_reconnect (monitor);
     }
 }
 
@@ -294,7 +315,8 @@ shell_camera_monitor_connect_core (ShellCameraMonitor *monitor)
 static void
 shell_camera_monitor_disconnect_core (ShellCameraMonitor *monitor)
 {
-  g_ptr_array_set_size (monitor->node_list, 0);
+  g_hash_table_remove_all (monitor->nodes);
+  g_clear_handle_id (&monitor->update_state_id, g_source_remove);
   g_clear_handle_id (&monitor->delayed_disable_id, g_source_remove);
 
   spa_hook_remove (&monitor->registry_listener);
@@ -379,7 +401,7 @@ shell_camera_monitor_finalize (GObject *object)
   ShellCameraMonitor *monitor = SHELL_CAMERA_MONITOR (object);
 
   shell_camera_monitor_disconnect_core (monitor);
-  g_clear_pointer (&monitor->node_list, g_ptr_array_unref);
+  g_clear_pointer (&monitor->nodes, g_hash_table_unref);
   g_clear_pointer (&monitor->context, pw_context_destroy);
   g_clear_pointer (&monitor->pipewire_source, g_source_destroy);
   g_clear_handle_id (&monitor->reconnect_id, g_source_remove);
@@ -432,8 +454,9 @@ shell_camera_monitor_init (ShellCameraMonitor *monitor)
 #ifdef HAVE_PIPEWIRE
   struct pw_loop *pipewire_loop;
 
-  monitor->node_list =
-    g_ptr_array_new_full (5, (GDestroyNotify) pw_proxy_destroy);
+  monitor->nodes = g_hash_table_new_full (NULL, NULL, NULL,
+                                          (GDestroyNotify) pw_proxy_destroy);
+  monitor->reconnect_delay_ms = RECONNECT_DELAY_MS;
 
   pw_init (NULL, NULL);
 
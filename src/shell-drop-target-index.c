@@ -0,0 +1,283 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * ShellDropTargetIndex:
+ *
+ * Finds drop targets under a point without picking the stage.
+ *
+ * Registered actors are filed by their stage extents in a grid of
+ * cells, so that a lookup only looks at the few targets around the
+ * point. A lookup returns the innermost registered actor containing the
+ * point, and nothing whenever the answer might differ from picking:
+ * when the point is outside every target, when two unrelated targets
+ * overlap, or when a target is transparent. Callers pick the stage
+ * then.
+ *
+ * Only actors which nothing else is stacked on during drags should be
+ * registered, since the index doesn't know about other actors.
+ */
+
+#include "config.h"
+
+#include <math.h>
+
+#include "shell-drop-target-index.h"
+
+#define CELL_SIZE 128
+
+struct _ShellDropTargetIndex
+{
+  GObject parent_instance;
+
+  GPtrArray *actors;
+
+  /* GPtrArrays of actors, by cell */
+  GHashTable *cells;
+  gboolean dirty;
+};
+
+G_DEFINE_FINAL_TYPE (ShellDropTargetIndex, shell_drop_target_index,
+                     G_TYPE_OBJECT)
+
+static gpointer
+cell_key (int column,
+          int row)
+{
+  return GUINT_TO_POINTER (((guint) column & 0xffff) << 16 |
+                           ((guint) row & 0xffff));
+}
+
+static int
+cell_of (float coord)
+{
+  return (int) floorf (coord / CELL_SIZE);
+}
+
+static void
+add_to_cells (ShellDropTargetIndex *self,
+              ClutterActor         *actor)
+{
+  graphene_rect_t extents;
+  int column, row;
+
+  if (!clutter_actor_is_mapped (actor))
+    return;
+
+  clutter_actor_get_transformed_extents (actor, &extents);
+
+  for (column = cell_of (extents.origin.x);
+       column <= cell_of (extents.origin.x + extents.size.width);
+       column++)
+    {
+      for (row = cell_of (extents.origin.y);
+           row <= cell_of (extents.origin.y + extents.size.height);
+           row++)
+        {
+          gpointer key = cell_key (column, row);
+          GPtrArray *cell = g_hash_table_lookup (self->cells, key);
+
+          if (cell == NULL)
+            {
+              cell = g_ptr_array_new ();
+              g_hash_table_insert (self->cells, key, cell);
+            }
+
+          g_ptr_array_add (cell, actor);
+        }
+    }
+}
+
+static void
+ensure_cells (ShellDropTargetIndex *self)
+{
+  unsigned int i;
+
+  if (!self->dirty)
+    return;
+
+  g_hash_table_remove_all (self->cells);
+
+  for (i = 0; i < self->actors->len; i++)
+    add_to_cells (self, g_ptr_array_index (self->actors, i));
+
+  self->dirty = FALSE;
+}
+
+static void
+on_actor_destroy (ClutterActor         *actor,
+                  ShellDropTargetIndex *self)
+{
+  shell_drop_target_index_remove (self, actor);
+}
+
+static void
+shell_drop_target_index_dispose (GObject *object)
+{
+  ShellDropTargetIndex *self = SHELL_DROP_TARGET_INDEX (object);
+
+  while (self->actors->len > 0)
+    shell_drop_target_index_remove (self, g_ptr_array_index (self->actors, 0));
+
+  G_OBJECT_CLASS (shell_drop_target_index_parent_class)->dispose (object);
+}
+
+static void
+shell_drop_target_index_finalize (GObject *object)
+{
+  ShellDropTargetIndex *self = SHELL_DROP_TARGET_INDEX (object);
+
+  g_ptr_array_unref (self->actors);
+  g_hash_table_unref (self->cells);
+
+  G_OBJECT_CLASS (shell_drop_target_index_parent_class)->finalize (object);
+}
+
+static void
+shell_drop_target_index_class_init (ShellDropTargetIndexClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = shell_drop_target_index_dispose;
+  object_class->finalize = shell_drop_target_index_finalize;
+}
+
+static void
+shell_drop_target_index_init (ShellDropTargetIndex *self)
+{
+  self->actors = g_ptr_array_new ();
+  self->cells = g_hash_table_new_full (NULL, NULL, NULL,
+                                       (GDestroyNotify) g_ptr_array_unref);
+}
+
+/**
+ * shell_drop_target_index_new:
+ *
+ * Returns: (transfer full): a new #ShellDropTargetIndex
+ */
+ShellDropTargetIndex *
+shell_drop_target_index_new (void)
+{
+  return g_object_new (SHELL_TYPE_DROP_TARGET_INDEX, NULL);
+}
+
+/**
+ * shell_drop_target_index_add:
+ * @self: a #ShellDropTargetIndex
+ * @actor: the actor of a drop target
+ *
+ * Registers @actor until it is removed or destroyed.
+ */
+void
+shell_drop_target_index_add (ShellDropTargetIndex *self,
+                             ClutterActor         *actor)
+{
+  g_return_if_fail (SHELL_IS_DROP_TARGET_INDEX (self));
+  g_return_if_fail (CLUTTER_IS_ACTOR (actor));
+
+  if (g_ptr_array_find (self->actors, actor, NULL))
+    return;
+
+  g_ptr_array_add (self->actors, actor);
+  g_signal_connect (actor, "destroy", G_CALLBACK (on_actor_destroy), self);
+  g_signal_connect_swapped (actor, "notify::allocation",
+                            G_CALLBACK (shell_drop_target_index_invalidate),
+                            self);
+  g_signal_connect_swapped (actor, "notify::mapped",
+                            G_CALLBACK (shell_drop_target_index_invalidate),
+                            self);
+
+  self->dirty = TRUE;
+}
+
+/**
+ * shell_drop_target_index_remove:
+ * @self: a #ShellDropTargetIndex
+ * @actor: the actor of a drop target
+ *
+ * Unregisters @actor.
+ */
+void
+shell_drop_target_index_remove (ShellDropTargetIndex *self,
+                                ClutterActor         *actor)
+{
+  g_return_if_fail (SHELL_IS_DROP_TARGET_INDEX (self));
+  g_return_if_fail (CLUTTER_IS_ACTOR (actor));
+
+  if (!g_ptr_array_remove (self->actors, actor))
+    return;
+
+  g_signal_handlers_disconnect_by_data (actor, self);
+
+  self->dirty = TRUE;
+}
+
+/**
+ * shell_drop_target_index_invalidate:
+ * @self: a #ShellDropTargetIndex
+ *
+ * Files the targets again on the next lookup. Moving a target only
+ * makes lookups fall back to picking until then, lookups are never
+ * wrong because of it.
+ */
+void
+shell_drop_target_index_invalidate (ShellDropTargetIndex *self)
+{
+  g_return_if_fail (SHELL_IS_DROP_TARGET_INDEX (self));
+
+  self->dirty = TRUE;
+}
+
+/**
+ * shell_drop_target_index_lookup:
+ * @self: a #ShellDropTargetIndex
+ * @x: the X coordinate of the point, in stage coordinates
+ * @y: the Y coordinate of the point, in stage coordinates
+ *
+ * Looks up the innermost target containing the point.
+ *
+ * Returns: (transfer none) (nullable): the target, or %NULL if the
+ *   stage needs to be picked instead
+ */
+ClutterActor *
+shell_drop_target_index_lookup (ShellDropTargetIndex *self,
+                                float                 x,
+                                float                 y)
+{
+  ClutterActor *target = NULL;
+  GPtrArray *cell;
+  unsigned int i;
+
+  g_return_val_if_fail (SHELL_IS_DROP_TARGET_INDEX (self), NULL);
+
+  ensure_cells (self);
+
+  cell = g_hash_table_lookup (self->cells, cell_key (cell_of (x), cell_of (y)));
+  if (cell == NULL)
+    return NULL;
+
+  for (i = 0; i < cell->len; i++)
+    {
+      ClutterActor *actor = g_ptr_array_index (cell, i);
+      graphene_rect_t extents;
+
+      /* The cells may be out of date, check where the actor is now */
+      if (!clutter_actor_is_mapped (actor))
+        continue;
+
+      clutter_actor_get_transformed_extents (actor, &extents);
+      if (!graphene_rect_contains_point (&extents,
+                                         &GRAPHENE_POINT_INIT (x, y)))
+        continue;
+
+      /* Whether picking sees transparent actors is up to Clutter */
+      if (clutter_actor_get_paint_opacity (actor) == 0)
+        return NULL;
+
+      if (target == NULL || clutter_actor_contains (target, actor))
+        target = actor;
+      else if (!clutter_actor_contains (actor, target))
+        return NULL;
+    }
+
+  return target;
+}
@@ -0,0 +1,24 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#pragma once
+
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+
+#define SHELL_TYPE_DROP_TARGET_INDEX (shell_drop_target_index_get_type ())
+G_DECLARE_FINAL_TYPE (ShellDropTargetIndex, shell_drop_target_index,
+                      SHELL, DROP_TARGET_INDEX, GObject)
+
+ShellDropTargetIndex *shell_drop_target_index_new (void);
+
+void shell_drop_target_index_add        (ShellDropTargetIndex *self,
+                                         ClutterActor         *actor);
+void shell_drop_target_index_remove     (ShellDropTargetIndex *self,
+                                         ClutterActor         *actor);
+void shell_drop_target_index_invalidate (ShellDropTargetIndex *self);
+
+ClutterActor *shell_drop_target_index_lookup (ShellDropTargetIndex *self,
+                                              float                 x,
+                                              float                 y);
+
+G_END_DECLS
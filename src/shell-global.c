@@ -1,5 +1,7 @@
 /* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
 
+#define _GNU_SOURCE
+
 #include "config.h"
 
 #include <dirent.h>
@@ -16,6 +18,7 @@
 #include <locale.h>
 
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 #include <girepository.h>
 #include <meta/meta-backend.h>
 #include <meta/meta-context.h>
@@ -51,6 +54,36 @@
 
 static ShellGlobal *the_object = NULL;
 
+/* Where the time of one stage update went, in microseconds */
+typedef struct {
+  gint64 start_time;
+  gint64 style_time;
+  gint64 layout_time;
+  gint64 paint_time;
+  gint64 gpu_time;
+  gint64 update_time;
+  gint64 interval;
+  gboolean dropped;
+
+  /* The view the update was for */
+  int monitor;
+  float refresh_rate;
+  gboolean painted;
+  /* When the frame reached the screen, 0 until it did, -1 if it never
+   * did or it isn't known */
+  gint64 presentation_time;
+} ShellFrameRecord;
+
+/* How many of the most recent updates may still be waiting to be
+ * presented, see record_presentation() */
+#define N_UNPRESENTED_FRAME_RECORDS 8
+
+/* Delay before changes to runtime and persistent state are written */
+#define STATE_SAVE_DELAY_MS 500
+
+/* Number of updates ShellGlobal:frame-stats keeps */
+#define N_FRAME_RECORDS 256
+
 struct _ShellGlobal {
   GObject parent;
 
@@ -68,6 +101,7 @@ struct _ShellGlobal {
   MetaPlugin *plugin;
   ShellWM *wm;
   GSettings *settings;
+  GHashTable *schema_settings;
   const char *datadir;
   char *imagedir;
   char *userdatadir;
@@ -82,19 +116,47 @@ struct _ShellGlobal {
 
   StFocusManager *focus_manager;
 
+  GListStore *window_actors;
+
   guint work_count;
   GSList *leisure_closures;
   guint leisure_function_id;
 
+  GQueue idle_work[SHELL_IDLE_PRIORITY_LOW + 1];
+  guint last_idle_work_id;
+  guint idle_work_timeout_id;
+  gint64 idle_frame_end;
+  gint64 idle_frame_interval;
+  gint64 last_swap;
+  gint64 last_presentation;
+  guint leisure_timeout_id;
+
   GHashTable *save_ops;
+  GHashTable *state_entries;
 
   gboolean frame_timestamps;
   gboolean frame_finish_timestamp;
 
+  gboolean frame_stats;
+  ShellFrameRecord *frame_records;
+  guint n_frame_records;
+  guint next_frame_record;
+  ShellFrameRecord current_frame;
+  gint64 frame_phase_start;
+  gint64 last_frame_end;
+
   GDBusProxy *switcheroo_control;
   GCancellable *switcheroo_cancellable;
 
+  GMemoryMonitor *memory_monitor;
+
   gboolean force_animations;
+
+  guint pointer_watch_interval;
+  guint pointer_watch_timeout_id;
+  gint64 last_pointer_motion;
+  int pointer_x;
+  int pointer_y;
 };
 
 enum {
@@ -119,6 +181,7 @@ enum {
   PROP_FOCUS_MANAGER,
   PROP_FRAME_TIMESTAMPS,
   PROP_FRAME_FINISH_TIMESTAMP,
+  PROP_FRAME_STATS,
   PROP_SWITCHEROO_CONTROL,
   PROP_FORCE_ANIMATIONS,
   PROP_AUTOMATION_SCRIPT,
@@ -134,6 +197,8 @@ enum
  NOTIFY_ERROR,
  LOCATE_POINTER,
  SHUTDOWN,
+ MEMORY_PRESSURE,
+ POINTER_MOTION,
  LAST_SIGNAL
 };
 
@@ -248,6 +313,25 @@ shell_global_set_property(GObject         *object,
           }
       }
       break;
+    case PROP_FRAME_STATS:
+      {
+        gboolean enable = g_value_get_boolean (value);
+
+        if (global->frame_stats != enable)
+          {
+            global->frame_stats = enable;
+
+            g_clear_pointer (&global->frame_records, g_free);
+            global->n_frame_records = 0;
+            global->next_frame_record = 0;
+            global->last_frame_end = 0;
+            if (enable)
+              global->frame_records = g_new0 (ShellFrameRecord, N_FRAME_RECORDS);
+
+            g_object_notify_by_pspec (object, props[PROP_FRAME_STATS]);
+          }
+      }
+      break;
     case PROP_FORCE_ANIMATIONS:
       global->force_animations = g_value_get_boolean (value);
       break;
@@ -337,6 +421,9 @@ shell_global_get_property(GObject         *object,
     case PROP_FRAME_FINISH_TIMESTAMP:
       g_value_set_boolean (value, global->frame_finish_timestamp);
       break;
+    case PROP_FRAME_STATS:
+      g_value_set_boolean (value, global->frame_stats);
+      break;
     case PROP_SWITCHEROO_CONTROL:
       g_value_set_object (value, global->switcheroo_control);
       break;
@@ -382,6 +469,40 @@ switcheroo_vanished_cb (GDBusConnection *connection,
   g_object_notify_by_pspec (G_OBJECT (global), props[PROP_SWITCHEROO_CONTROL]);
 }
 
+static void
+collect_js_garbage (ShellGlobal *global)
+{
+  ShellPerfLog *perf_log = shell_perf_log_get_default ();
+  gint64 start_time = g_get_monotonic_time ();
+
+  shell_perf_log_event (perf_log, "gjs.gcStart");
+  gjs_context_gc (global->js_context);
+  shell_perf_log_event (perf_log, "gjs.gcDone");
+
+  shell_perf_log_update_histogram (perf_log, "gjs.gcPause",
+                                   g_get_monotonic_time () - start_time);
+}
+
+static void
+on_low_memory_warning (GMemoryMonitor             *monitor,
+                       GMemoryMonitorWarningLevel  level,
+                       ShellGlobal                *global)
+{
+  g_debug ("Low memory warning, level %d", level);
+
+  st_texture_cache_trim (st_texture_cache_get_default (), level);
+
+  if (global->stage)
+    st_theme_context_trim (st_theme_context_get_for_stage (global->stage),
+                           level);
+
+  g_signal_emit (global, shell_global_signals[MEMORY_PRESSURE], 0, level);
+
+  /* Let go of whatever the caches in JS just dropped */
+  if (level >= G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM)
+    collect_js_garbage (global);
+}
+
 static void
 shell_global_init (ShellGlobal *global)
 {
@@ -429,6 +550,8 @@ shell_global_init (ShellGlobal *global)
   g_free (path);
 
   global->settings = g_settings_new ("org.gnome.shell");
+  global->schema_settings = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                   g_free, g_object_unref);
 
   if (shell_js)
     {
@@ -475,6 +598,15 @@ shell_global_init (ShellGlobal *global)
   global->save_ops = g_hash_table_new_full (g_file_hash,
                                             (GEqualFunc) g_file_equal,
                                             g_object_unref, g_object_unref);
+  global->state_entries = g_hash_table_new_full (g_file_hash,
+                                                 (GEqualFunc) g_file_equal,
+                                                 NULL,
+                                                 (GDestroyNotify) state_entry_free);
+
+  global->window_actors = g_list_store_new (META_TYPE_WINDOW_ACTOR);
+
+  global->pointer_x = G_MININT;
+  global->pointer_y = G_MININT;
 
   global->switcheroo_cancellable = g_cancellable_new ();
   g_bus_watch_name (G_BUS_TYPE_SYSTEM,
@@ -484,6 +616,24 @@ shell_global_init (ShellGlobal *global)
                     switcheroo_vanished_cb,
                     global,
                     NULL);
+
+  /* For the collections forced on memory pressure */
+  shell_perf_log_define_event (shell_perf_log_get_default (),
+                               "gjs.gcStart",
+                               "Start of a full JavaScript garbage collection",
+                               "");
+  shell_perf_log_define_event (shell_perf_log_get_default (),
+                               "gjs.gcDone",
+                               "End of a full JavaScript garbage collection",
+                               "");
+  shell_perf_log_define_histogram (shell_perf_log_get_default (),
+                                   "gjs.gcPause",
+                                   "Duration of full JavaScript garbage collections, in microseconds");
+
+  /* Reports pressure from the kernel (PSI) or low-memory-monitor */
+  global->memory_monitor = g_memory_monitor_dup_default ();
+  g_signal_connect (global->memory_monitor, "low-memory-warning",
+                    G_CALLBACK (on_low_memory_warning), global);
 }
 
 static void
@@ -493,24 +643,35 @@ shell_global_finalize (GObject *object)
 
   g_clear_object (&global->js_context);
   g_object_unref (global->settings);
+  g_clear_pointer (&global->schema_settings, g_hash_table_unref);
 
   g_clear_object (&global->window_tracker);
   g_clear_object (&global->app_system);
   g_clear_object (&global->app_cache);
   g_clear_object (&global->app_usage);
 
+  g_clear_object (&global->window_actors);
+
+  g_clear_handle_id (&global->pointer_watch_timeout_id, g_source_remove);
+
   the_object = NULL;
 
   g_cancellable_cancel (global->switcheroo_cancellable);
   g_clear_object (&global->switcheroo_cancellable);
 
+  g_signal_handlers_disconnect_by_func (global->memory_monitor,
+                                        on_low_memory_warning, global);
+  g_clear_object (&global->memory_monitor);
+
   g_clear_object (&global->userdatadir_path);
+  g_clear_pointer (&global->frame_records, g_free);
   g_clear_object (&global->runtime_state_path);
 
   g_free (global->session_mode);
   g_free (global->imagedir);
   g_free (global->userdatadir);
 
+  g_hash_table_unref (global->state_entries);
   g_hash_table_unref (global->save_ops);
 
   G_OBJECT_CLASS(shell_global_parent_class)->finalize (object);
@@ -549,6 +710,44 @@ shell_global_class_init (ShellGlobalClass *klass)
                     NULL, NULL, NULL,
                     G_TYPE_NONE, 0);
 
+  /**
+   * ShellGlobal::memory-pressure:
+   * @global: the #ShellGlobal
+   * @level: a #GMemoryMonitorWarningLevel
+   *
+   * Emitted when the system is running low on memory, after the St
+   * caches were trimmed. Caches should release more the higher @level
+   * is, starting with what is cheapest to recreate.
+   */
+  shell_global_signals[MEMORY_PRESSURE] =
+      g_signal_new ("memory-pressure",
+                    G_TYPE_FROM_CLASS (klass),
+                    G_SIGNAL_RUN_LAST,
+                    0,
+                    NULL, NULL, NULL,
+                    G_TYPE_NONE, 1,
+                    G_TYPE_MEMORY_MONITOR_WARNING_LEVEL);
+
+  /**
+   * ShellGlobal::pointer-motion:
+   * @global: the #ShellGlobal
+   * @x: the X coordinate of the pointer, in global coordinates
+   * @y: the Y coordinate of the pointer, in global coordinates
+   *
+   * Emitted when the pointer moved, at most once per the interval set
+   * with shell_global_set_pointer_watch_interval(), and never while the
+   * pointer doesn't move.
+   */
+  shell_global_signals[POINTER_MOTION] =
+      g_signal_new ("pointer-motion",
+                    G_TYPE_FROM_CLASS (klass),
+                    G_SIGNAL_RUN_LAST,
+                    0,
+                    NULL, NULL, NULL,
+                    G_TYPE_NONE, 2,
+                    G_TYPE_INT,
+                    G_TYPE_INT);
+
   props[PROP_SESSION_MODE] =
     g_param_spec_string ("session-mode",
                          "Session Mode",
@@ -682,6 +881,13 @@ shell_global_class_init (ShellGlobalClass *klass)
                           FALSE,
                           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_EXPLICIT_NOTIFY);
 
+  props[PROP_FRAME_STATS] =
+    g_param_spec_boolean ("frame-stats",
+                          "Frame Statistics",
+                          "Whether to keep a record of where the time of recent frames went",
+                          FALSE,
+                          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_EXPLICIT_NOTIFY);
+
   props[PROP_SWITCHEROO_CONTROL] =
     g_param_spec_object ("switcheroo-control",
                          "switcheroo-control",
@@ -875,6 +1081,95 @@ shell_global_get_window_actors (ShellGlobal *global)
   return g_list_reverse (filtered);
 }
 
+/**
+ * shell_global_get_window_actors_model:
+ *
+ * Gets the #MetaWindowActor of the windows on the screen in stacking
+ * order, like shell_global_get_window_actors(). The model is kept up to
+ * date as windows come, go and are restacked, so it can be held on to
+ * rather than asking for a new list every time.
+ *
+ * Return value: (transfer none): the model of window actors
+ */
+GListModel *
+shell_global_get_window_actors_model (ShellGlobal *global)
+{
+  g_return_val_if_fail (SHELL_IS_GLOBAL (global), NULL);
+
+  return G_LIST_MODEL (global->window_actors);
+}
+
+static gboolean
+window_actor_at (GListModel *model,
+                 guint       position,
+                 gpointer    actor)
+{
+  g_autoptr (GObject) item = g_list_model_get_item (model, position);
+
+  return item == actor;
+}
+
+static void
+sync_window_actors (ShellGlobal *global)
+{
+  GListModel *model = G_LIST_MODEL (global->window_actors);
+  g_autoptr (GPtrArray) actors = NULL;
+  guint n_items, start, old_end, new_end;
+  GList *l;
+
+  actors = g_ptr_array_new ();
+  for (l = meta_get_window_actors (global->meta_display); l; l = l->next)
+    if (!meta_window_actor_is_destroyed (l->data))
+      g_ptr_array_add (actors, l->data);
+
+  /* Only replace what lies between the unchanged ends, so that a new
+   * window or a restack changes as few items as possible */
+  n_items = g_list_model_get_n_items (model);
+  start = 0;
+  while (start < n_items && start < actors->len &&
+         window_actor_at (model, start, actors->pdata[start]))
+    start++;
+
+  old_end = n_items;
+  new_end = actors->len;
+  while (old_end > start && new_end > start &&
+         window_actor_at (model, old_end - 1, actors->pdata[new_end - 1]))
+    {
+      old_end--;
+      new_end--;
+    }
+
+  if (old_end == start && new_end == start)
+    return;
+
+  g_list_store_splice (global->window_actors, start, old_end - start,
+                       actors->pdata + start, new_end - start);
+}
+
+static void
+on_window_unmanaged (MetaWindow  *window,
+                     ShellGlobal *global)
+{
+  sync_window_actors (global);
+}
+
+static void
+on_window_created (MetaDisplay *display,
+                   MetaWindow  *window,
+                   ShellGlobal *global)
+{
+  g_signal_connect_object (window, "unmanaged",
+                           G_CALLBACK (on_window_unmanaged), global, 0);
+  sync_window_actors (global);
+}
+
+static void
+on_restacked (MetaDisplay *display,
+              ShellGlobal *global)
+{
+  sync_window_actors (global);
+}
+
 static void
 global_stage_notify_width (GObject    *gobject,
                            GParamSpec *pspec,
@@ -929,7 +1224,16 @@ global_stage_after_paint (ClutterStage     *stage,
   /* At this point, we've finished all layout and painting, but haven't
    * actually flushed or swapped */
 
-  if (global->frame_timestamps && global->frame_finish_timestamp)
+  if (global->frame_stats)
+    {
+      gint64 now = g_get_monotonic_time ();
+
+      global->current_frame.paint_time = now - global->frame_phase_start;
+      global->frame_phase_start = now;
+    }
+
+  if ((global->frame_timestamps || global->frame_stats) &&
+      global->frame_finish_timestamp)
     {
       /* It's interesting to find out when the paint actually finishes
        * on the GPU. We could wait for this asynchronously with
@@ -951,11 +1255,175 @@ global_stage_after_paint (ClutterStage     *stage,
       cogl_flush ();
       finish ();
 
-      shell_perf_log_event (shell_perf_log_get_default (),
-                            "clutter.paintCompletedTimestamp");
+      if (global->frame_timestamps)
+        shell_perf_log_event (shell_perf_log_get_default (),
+                              "clutter.paintCompletedTimestamp");
+
+      if (global->frame_stats)
+        global->current_frame.gpu_time =
+          g_get_monotonic_time () - global->frame_phase_start;
+    }
+}
+
+/* The frame clock of a view runs an update as: the ::before-update
+ * handlers, which include flushing queued style changes, then layout,
+ * ::prepare-frame, painting between ::before-paint and ::after-paint,
+ * and finally swapping buffers before ::after-update. */
+static void
+frame_stats_before_update (ClutterStage     *stage,
+                           ClutterStageView *stage_view,
+                           ClutterFrame     *frame,
+                           ShellGlobal      *global)
+{
+  ShellFrameRecord *record = &global->current_frame;
+
+  if (!global->frame_stats)
+    return;
+
+  memset (record, 0, sizeof (ShellFrameRecord));
+  record->start_time = g_get_monotonic_time ();
+  record->gpu_time = -1;
+  if (global->last_frame_end != 0)
+    record->interval = record->start_time - global->last_frame_end;
+
+  global->frame_phase_start = record->start_time;
+}
+
+static void
+frame_stats_after_before_update (ClutterStage     *stage,
+                                 ClutterStageView *stage_view,
+                                 ClutterFrame     *frame,
+                                 ShellGlobal      *global)
+{
+  gint64 now;
+
+  if (!global->frame_stats || global->current_frame.start_time == 0)
+    return;
+
+  now = g_get_monotonic_time ();
+  global->current_frame.style_time = now - global->frame_phase_start;
+  global->frame_phase_start = now;
+}
+
+static void
+frame_stats_prepare_frame (ClutterStage     *stage,
+                           ClutterStageView *stage_view,
+                           ClutterFrame     *frame,
+                           ShellGlobal      *global)
+{
+  gint64 now;
+
+  if (!global->frame_stats || global->current_frame.start_time == 0)
+    return;
+
+  now = g_get_monotonic_time ();
+  global->current_frame.layout_time = now - global->frame_phase_start;
+  global->frame_phase_start = now;
+}
+
+static void
+frame_stats_before_paint (ClutterStage     *stage,
+                          ClutterStageView *stage_view,
+                          ClutterFrame     *frame,
+                          ShellGlobal      *global)
+{
+  if (!global->frame_stats || global->current_frame.start_time == 0)
+    return;
+
+  global->current_frame.painted = TRUE;
+  global->frame_phase_start = g_get_monotonic_time ();
+}
+
+static int
+get_view_monitor (ShellGlobal      *global,
+                  ClutterStageView *stage_view)
+{
+  MtkRectangle layout;
+
+  clutter_stage_view_get_layout (stage_view, &layout);
+  return meta_display_get_monitor_index_for_rect (global->meta_display,
+                                                  &layout);
+}
+
+/* Views present their frames in the order they were painted, so the
+ * oldest of the recent updates of the view that is still waiting is
+ * the one that got presented */
+static void
+record_presentation (ShellGlobal      *global,
+                     ClutterStageView *stage_view,
+                     ClutterFrameInfo *frame_info)
+{
+  int monitor;
+  guint i, n;
+
+  if (frame_info->presentation_time <= 0)
+    return;
+
+  monitor = get_view_monitor (global, stage_view);
+  n = MIN (global->n_frame_records, N_UNPRESENTED_FRAME_RECORDS);
+
+  for (i = n; i > 0; i--)
+    {
+      guint index = (global->next_frame_record + N_FRAME_RECORDS - i) % N_FRAME_RECORDS;
+      ShellFrameRecord *record = &global->frame_records[index];
+
+      if (record->monitor == monitor && record->presentation_time == 0 &&
+          record->start_time <= frame_info->presentation_time)
+        {
+          record->presentation_time = frame_info->presentation_time;
+          break;
+        }
     }
 }
 
+static void
+frame_stats_after_update (ClutterStage     *stage,
+                          ClutterStageView *stage_view,
+                          ClutterFrame     *frame,
+                          ShellGlobal      *global)
+{
+  ShellFrameRecord *record = &global->current_frame;
+  float refresh_rate;
+
+  if (!global->frame_stats || record->start_time == 0)
+    return;
+
+  global->last_frame_end = g_get_monotonic_time ();
+  record->update_time = global->last_frame_end - record->start_time;
+
+  /* An update that takes longer than a refresh cycle misses the next
+   * presentation, or makes the following update start late */
+  refresh_rate = clutter_stage_view_get_refresh_rate (stage_view);
+  if (refresh_rate > 0.0)
+    record->dropped = record->update_time > G_USEC_PER_SEC / refresh_rate;
+
+  record->monitor = get_view_monitor (global, stage_view);
+  record->refresh_rate = refresh_rate;
+  /* Updates that didn't paint have nothing to present */
+  record->presentation_time = record->painted ? 0 : -1;
+
+  global->frame_records[global->next_frame_record] = *record;
+  global->next_frame_record = (global->next_frame_record + 1) % N_FRAME_RECORDS;
+  global->n_frame_records = MIN (global->n_frame_records + 1, N_FRAME_RECORDS);
+
+  record->start_time = 0;
+}
+
+/* Idle work is sliced to fit between updates, so it needs to know when
+ * the last one ended and how often they come */
+static void
+idle_work_after_update (ClutterStage     *stage,
+                        ClutterStageView *stage_view,
+                        ClutterFrame     *frame,
+                        ShellGlobal      *global)
+{
+  float refresh_rate = clutter_stage_view_get_refresh_rate (stage_view);
+
+  global->idle_frame_end = g_get_monotonic_time ();
+  if (refresh_rate > 0.0)
+    global->idle_frame_interval = G_USEC_PER_SEC / refresh_rate;
+}
+
 static gboolean
 global_stage_after_swap (gpointer data)
 {
@@ -963,6 +1431,8 @@ global_stage_after_swap (gpointer data)
 
   ShellGlobal *global = SHELL_GLOBAL (data);
 
+  global->last_swap = g_get_monotonic_time ();
+
   if (global->frame_timestamps)
     shell_perf_log_event (shell_perf_log_get_default (),
                           "clutter.stagePaintDone");
@@ -970,6 +1440,24 @@ global_stage_after_swap (gpointer data)
   return TRUE;
 }
 
+static void schedule_idle_work (ShellGlobal *global);
+
+static void
+global_stage_presented (ClutterStage     *stage,
+                        ClutterStageView *stage_view,
+                        ClutterFrameInfo *frame_info,
+                        ShellGlobal      *global)
+{
+  global->last_presentation = g_get_monotonic_time ();
+
+  if (global->frame_stats)
+    record_presentation (global, stage_view, frame_info);
+
+  /* Leisure functions waited for the frame to reach the screen */
+  if (global->leisure_closures && global->work_count == 0)
+    schedule_idle_work (global);
+}
+
 static void
 update_scaling_factor (ShellGlobal  *global,
                        MetaSettings *settings)
@@ -1057,6 +1545,22 @@ _shell_global_set_plugin (ShellGlobal *global,
                                          global_stage_after_swap,
                                          global, NULL);
 
+  g_signal_connect (global->stage, "presented",
+                    G_CALLBACK (global_stage_presented), global);
+
+  g_signal_connect (global->stage, "before-update",
+                    G_CALLBACK (frame_stats_before_update), global);
+  g_signal_connect_after (global->stage, "before-update",
+                          G_CALLBACK (frame_stats_after_before_update), global);
+  g_signal_connect (global->stage, "prepare-frame",
+                    G_CALLBACK (frame_stats_prepare_frame), global);
+  g_signal_connect (global->stage, "before-paint",
+                    G_CALLBACK (frame_stats_before_paint), global);
+  g_signal_connect (global->stage, "after-update",
+                    G_CALLBACK (frame_stats_after_update), global);
+  g_signal_connect (global->stage, "after-update",
+                    G_CALLBACK (idle_work_after_update), global);
+
   shell_perf_log_define_event (shell_perf_log_get_default(),
                                "clutter.stagePaintStart",
                                "Start of stage page repaint",
@@ -1084,6 +1588,12 @@ _shell_global_set_plugin (ShellGlobal *global,
 
   global->focus_manager = st_focus_manager_get_for_stage (global->stage);
 
+  g_signal_connect_object (display, "window-created",
+                           G_CALLBACK (on_window_created), global, 0);
+  g_signal_connect_object (display, "restacked",
+                           G_CALLBACK (on_restacked), global, 0);
+  sync_window_actors (global);
+
   update_scaling_factor (global, settings);
 }
 
@@ -1182,11 +1692,46 @@ pre_exec_close_fds(void)
   fdwalk (set_cloexec, GINT_TO_POINTER(3));
 }
 
+static void flush_state (ShellGlobal *global);
+
+/* Writes what the shell built up since it started to the on-disk caches,
+ * and turns those on for the restarted process, so that it loads the
+ * parsed stylesheets, the app search index and the decoded icons rather
+ * than building them again. The caches check the files they were built
+ * from, so they are safe to keep using after the restart. Variables
+ * that are already set are left alone, to allow turning caches off.
+ */
+static void
+save_reexec_snapshot (ShellGlobal *global)
+{
+  flush_state (global);
+
+  if (global->stage)
+    {
+      StThemeContext *context = st_theme_context_get_for_stage (global->stage);
+      StTheme *theme = st_theme_context_get_theme (context);
+
+      if (theme)
+        st_theme_save_cache (theme);
+    }
+
+  shell_app_cache_save_index (shell_app_cache_get_default ());
+  st_texture_cache_flush (st_texture_cache_get_default ());
+
+  g_setenv ("ST_STYLESHEET_CACHE", "1", FALSE);
+  g_setenv ("ST_ICON_BITMAP_CACHE", "1", FALSE);
+  g_setenv ("SHELL_APP_INDEX", "1", FALSE);
+}
+
 /**
  * shell_global_reexec_self:
  * @global: A #ShellGlobal
  *
  * Restart the current process.  Only intended for development purposes.
+ *
+ * Saved state and the caches of parsed stylesheets, of the app search
+ * index and of decoded icons are written out first, and the restarted
+ * process starts from them.
  */
 void
 shell_global_reexec_self (ShellGlobal *global)
@@ -1263,6 +1808,8 @@ shell_global_reexec_self (ShellGlobal *global)
   return;
 #endif
 
+  save_reexec_snapshot (global);
+
   /* Close all file descriptors other than stdin/stdout/stderr, otherwise
    * they will leak and stay open after the exec. In particular, this is
    * important for file descriptors that represent mapped graphics buffer
@@ -1335,6 +1882,103 @@ shell_global_get_pointer (ShellGlobal         *global,
   *mods = raw_mods & CLUTTER_MODIFIER_MASK;
 }
 
+static void
+emit_pointer_motion (ShellGlobal *global)
+{
+  ClutterModifierType mods;
+  int x, y;
+
+  global->last_pointer_motion = g_get_monotonic_time ();
+
+  shell_global_get_pointer (global, &x, &y, &mods);
+  if (x == global->pointer_x && y == global->pointer_y)
+    return;
+
+  global->pointer_x = x;
+  global->pointer_y = y;
+
+  g_signal_emit (global, shell_global_signals[POINTER_MOTION], 0, x, y);
+}
+
+static void
+on_pointer_watch_timeout (gpointer user_data)
+{
+  ShellGlobal *global = user_data;
+
+  global->pointer_watch_timeout_id = 0;
+  emit_pointer_motion (global);
+}
+
+static void
+on_cursor_position_invalidated (MetaCursorTracker *tracker,
+                                ShellGlobal       *global)
+{
+  gint64 now, next_motion;
+
+  /* The pending update picks up this motion too */
+  if (global->pointer_watch_timeout_id != 0)
+    return;
+
+  now = g_get_monotonic_time ();
+  next_motion = global->last_pointer_motion +
+                (gint64) global->pointer_watch_interval * 1000;
+
+  if (now >= next_motion)
+    {
+      emit_pointer_motion (global);
+      return;
+    }
+
+  global->pointer_watch_timeout_id =
+    g_timeout_add_once ((next_motion - now) / 1000 + 1,
+                        on_pointer_watch_timeout, global);
+  g_source_set_name_by_id (global->pointer_watch_timeout_id,
+                           "[gnome-shell] pointer motion");
+}
+
+/**
+ * shell_global_set_pointer_watch_interval:
+ * @global: the #ShellGlobal
+ * @interval_ms: the minimum time between two ::pointer-motion emissions,
+ *   in milliseconds, or 0 to stop watching the pointer
+ *
+ * Starts or stops emitting #ShellGlobal::pointer-motion as the pointer
+ * moves. The pointer is tracked by the cursor tracker rather than
+ * polled, so nothing runs while the pointer doesn't move.
+ */
+void
+shell_global_set_pointer_watch_interval (ShellGlobal *global,
+                                         guint        interval_ms)
+{
+  MetaCursorTracker *tracker;
+
+  g_return_if_fail (SHELL_IS_GLOBAL (global));
+
+  if (global->pointer_watch_interval == interval_ms)
+    return;
+
+  tracker = meta_cursor_tracker_get_for_display (global->meta_display);
+
+  if (global->pointer_watch_interval == 0)
+    {
+      meta_cursor_tracker_track_position (tracker);
+      g_signal_connect (tracker, "position-invalidated",
+                        G_CALLBACK (on_cursor_position_invalidated), global);
+    }
+  else if (interval_ms == 0)
+    {
+      g_signal_handlers_disconnect_by_func (tracker,
+                                            on_cursor_position_invalidated,
+                                            global);
+      meta_cursor_tracker_untrack_position (tracker);
+      g_clear_handle_id (&global->pointer_watch_timeout_id, g_source_remove);
+      global->pointer_x = G_MININT;
+      global->pointer_y = G_MININT;
+    }
+
+  global->pointer_watch_interval = interval_ms;
+}
+
 /**
  * shell_global_get_switcheroo_control:
  * @global: A #ShellGlobal
@@ -1366,21 +2010,57 @@ shell_global_get_settings (ShellGlobal *global)
 }
 
 /**
- * shell_global_get_current_time:
+ * shell_global_get_schema_settings:
  * @global: A #ShellGlobal
+ * @schema_id: the ID of a schema
  *
- * Returns: the current X server time from the current Clutter, Gdk, or X
- * event. If called from outside an event handler, this may return
- * %Clutter.CURRENT_TIME (aka 0), or it may return a slightly
- * out-of-date timestamp.
+ * Get a GSettings instance for @schema_id that is shared by all its
+ * users, so that the schema is only looked up and watched for changes
+ * once, however many parts of the shell read it. Users that change
+ * the instance itself, like delaying its changes, should create their
+ * own instead.
+ *
+ * Return value: (transfer none): The GSettings object
  */
-guint32
-shell_global_get_current_time (ShellGlobal *global)
+GSettings *
+shell_global_get_schema_settings (ShellGlobal *global,
+                                  const char  *schema_id)
 {
-  guint32 time;
+  GSettings *settings;
 
-  /* meta_display_get_current_time() will return the correct time
-     when handling an X or Gdk event, but will return CurrentTime
+  g_return_val_if_fail (SHELL_IS_GLOBAL (global), NULL);
+  g_return_val_if_fail (schema_id != NULL, NULL);
+
+  if (g_strcmp0 (schema_id, "org.gnome.shell") == 0)
+    return global->settings;
+
+  settings = g_hash_table_lookup (global->schema_settings, schema_id);
+  if (settings == NULL)
+    {
+      settings = g_settings_new (schema_id);
+      g_hash_table_insert (global->schema_settings,
+                           g_strdup (schema_id), settings);
+    }
+
+  return settings;
+}
+
+/**
+ * shell_global_get_current_time:
+ * @global: A #ShellGlobal
+ *
+ * Returns: the current X server time from the current Clutter, Gdk, or X
+ * event. If called from outside an event handler, this may return
+ * %Clutter.CURRENT_TIME (aka 0), or it may return a slightly
+ * out-of-date timestamp.
+ */
+guint32
+shell_global_get_current_time (ShellGlobal *global)
+{
+  guint32 time;
+
+  /* meta_display_get_current_time() will return the correct time
+     when handling an X or Gdk event, but will return CurrentTime
      from some Clutter event callbacks.
 
      clutter_get_current_event_time() will return the correct time
@@ -1477,29 +2157,240 @@ typedef struct
   GDestroyNotify notify;
 } LeisureClosure;
 
+typedef struct
+{
+  guint id;
+  ShellIdlePriority priority;
+  gint64 deadline;
+  ShellIdleWorkFunc func;
+  gpointer user_data;
+  GDestroyNotify notify;
+
+  gboolean running;
+  gboolean removed;
+} IdleWork;
+
+/* Time kept free before the next frame is due when frames are drawn */
+#define IDLE_WORK_FRAME_MARGIN_US 2000
+
+#define IDLE_WORK_DEFAULT_FRAME_INTERVAL_US (G_USEC_PER_SEC / 60)
+
+/* Swaps whose presentation is not reported within this time, such as
+ * those on a turned off monitor, don't keep the shell from being at
+ * leisure */
+#define LEISURE_PRESENTATION_TIMEOUT_US G_USEC_PER_SEC
+
+static void
+idle_work_free (IdleWork *work)
+{
+  if (work->notify)
+    work->notify (work->user_data);
+
+  g_free (work);
+}
+
 static gboolean
-run_leisure_functions (gpointer data)
+has_idle_work (ShellGlobal *global)
+{
+  int priority;
+
+  for (priority = 0; priority <= SHELL_IDLE_PRIORITY_LOW; priority++)
+    {
+      if (!g_queue_is_empty (&global->idle_work[priority]))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Work past its deadline goes first, whatever its priority; the rest
+ * only while no other work is going on. */
+static GList *
+find_idle_work (ShellGlobal *global,
+                gint64       now,
+                int         *priority_out)
+{
+  int priority;
+  GList *l;
+
+  for (priority = 0; priority <= SHELL_IDLE_PRIORITY_LOW; priority++)
+    {
+      for (l = global->idle_work[priority].head; l; l = l->next)
+        {
+          IdleWork *work = l->data;
+
+          if (work->deadline != 0 && work->deadline <= now)
+            {
+              *priority_out = priority;
+              return l;
+            }
+        }
+    }
+
+  if (global->work_count > 0)
+    return NULL;
+
+  for (priority = 0; priority <= SHELL_IDLE_PRIORITY_LOW; priority++)
+    {
+      if (!g_queue_is_empty (&global->idle_work[priority]))
+        {
+          *priority_out = priority;
+          return global->idle_work[priority].head;
+        }
+    }
+
+  return NULL;
+}
+
+/* While frames are drawn, slices may run until shortly before the next
+ * one is due; otherwise an update might start any time, and is
+ * delayed by at most half a refresh cycle. */
+static gint64
+get_idle_slice_end (ShellGlobal *global,
+                    gint64       now)
+{
+  gint64 interval = global->idle_frame_interval;
+  gint64 next_frame;
+
+  if (interval == 0)
+    interval = IDLE_WORK_DEFAULT_FRAME_INTERVAL_US;
+
+  next_frame = global->idle_frame_end + interval;
+  if (next_frame > now)
+    return next_frame - IDLE_WORK_FRAME_MARGIN_US;
+
+  return now + interval / 2;
+}
+
+static gboolean
+on_idle_work_timeout (gpointer data)
 {
   ShellGlobal *global = data;
+
+  global->idle_work_timeout_id = 0;
+  schedule_idle_work (global);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Wakes up for the earliest deadline of work waiting for the shell to
+ * become idle */
+static void
+update_idle_work_timeout (ShellGlobal *global)
+{
+  gint64 deadline = G_MAXINT64;
+  int priority;
+  GList *l;
+
+  g_clear_handle_id (&global->idle_work_timeout_id, g_source_remove);
+
+  for (priority = 0; priority <= SHELL_IDLE_PRIORITY_LOW; priority++)
+    {
+      for (l = global->idle_work[priority].head; l; l = l->next)
+        {
+          IdleWork *work = l->data;
+
+          if (work->deadline != 0)
+            deadline = MIN (deadline, work->deadline);
+        }
+    }
+
+  if (deadline == G_MAXINT64)
+    return;
+
+  deadline = MAX (deadline - g_get_monotonic_time (), 0);
+  global->idle_work_timeout_id =
+    g_timeout_add_full (G_PRIORITY_LOW,
+                        (deadline + 999) / 1000,
+                        on_idle_work_timeout,
+                        global, NULL);
+  g_source_set_name_by_id (global->idle_work_timeout_id,
+                           "[gnome-shell] idle_work_timeout");
+}
+
+static gboolean
+on_leisure_timeout (gpointer data)
+{
+  ShellGlobal *global = data;
+
+  global->leisure_timeout_id = 0;
+  schedule_idle_work (global);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* The shell is at leisure once no redraw is queued, no update ran for a
+ * whole refresh cycle, which rules out running transitions, since they
+ * update on every cycle, and the last swap was presented, so the GPU is
+ * done with it. Returns how long to wait before checking again
+ * otherwise; 0 stands for waiting for a presentation or redraw. */
+static gboolean
+is_at_leisure (ShellGlobal *global,
+               gint64      *wait)
+{
+  gint64 now = g_get_monotonic_time ();
+  gint64 interval = global->idle_frame_interval;
+  GList *l;
+
+  *wait = 0;
+
+  if (interval == 0)
+    interval = IDLE_WORK_DEFAULT_FRAME_INTERVAL_US;
+
+  for (l = clutter_stage_peek_stage_views (global->stage); l; l = l->next)
+    {
+      if (clutter_stage_is_redraw_queued_on_view (global->stage, l->data))
+        return FALSE;
+    }
+
+  if (global->last_presentation < global->last_swap &&
+      now - global->last_swap < LEISURE_PRESENTATION_TIMEOUT_US)
+    {
+      *wait = global->last_swap + LEISURE_PRESENTATION_TIMEOUT_US - now;
+      return FALSE;
+    }
+
+  if (now - global->idle_frame_end < interval + IDLE_WORK_FRAME_MARGIN_US)
+    {
+      *wait = global->idle_frame_end + interval + IDLE_WORK_FRAME_MARGIN_US - now;
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+run_leisure_functions (ShellGlobal *global)
+{
   GSList *closures;
   GSList *iter;
+  gint64 wait;
 
-  global->leisure_function_id = 0;
+  g_clear_handle_id (&global->leisure_timeout_id, g_source_remove);
 
-  /* We started more work since we scheduled the idle */
-  if (global->work_count > 0)
-    return FALSE;
+  if (!global->leisure_closures)
+    return;
 
-  /* No leisure closures, so we are done */
-  if (global->leisure_closures == NULL)
-    return FALSE;
+  if (!is_at_leisure (global, &wait))
+    {
+      /* Check again once the current frames are done, or when the
+       * next one is presented */
+      global->leisure_timeout_id =
+        g_timeout_add_full (G_PRIORITY_LOW,
+                            MAX ((wait + 999) / 1000, 1),
+                            on_leisure_timeout,
+                            global, NULL);
+      g_source_set_name_by_id (global->leisure_timeout_id,
+                               "[gnome-shell] leisure_timeout");
+      return;
+    }
 
   closures = global->leisure_closures;
   global->leisure_closures = NULL;
 
   for (iter = closures; iter; iter = iter->next)
     {
-      LeisureClosure *closure = closures->data;
+      LeisureClosure *closure = iter->data;
       closure->func (closure->user_data);
 
       if (closure->notify)
@@ -1509,27 +2400,68 @@ run_leisure_functions (gpointer data)
     }
 
   g_slist_free (closures);
+}
 
-  return FALSE;
+static gboolean
+run_idle_work (gpointer data)
+{
+  ShellGlobal *global = data;
+  gint64 now = g_get_monotonic_time ();
+  gint64 slice_end = get_idle_slice_end (global, now);
+  GList *link;
+  int priority;
+
+  global->leisure_function_id = 0;
+
+  /* Run at least one slice, and more while there is time left; a slice
+   * that is done goes on with the next one of the same work */
+  while ((link = find_idle_work (global, now, &priority)))
+    {
+      IdleWork *work = link->data;
+      gboolean more;
+
+      work->running = TRUE;
+      more = work->func (work->user_data);
+      work->running = FALSE;
+
+      if (!more || work->removed)
+        {
+          g_queue_remove (&global->idle_work[priority], work);
+          idle_work_free (work);
+        }
+
+      now = g_get_monotonic_time ();
+      if (now >= slice_end)
+        break;
+    }
+
+  update_idle_work_timeout (global);
+
+  /* We started more work since we scheduled the idle */
+  if (global->work_count > 0)
+    return G_SOURCE_REMOVE;
+
+  if (has_idle_work (global))
+    schedule_idle_work (global);
+  else
+    run_leisure_functions (global);
+
+  return G_SOURCE_REMOVE;
 }
 
 static void
-schedule_leisure_functions (ShellGlobal *global)
+schedule_idle_work (ShellGlobal *global)
 {
-  /* This is called when we think we are ready to run leisure functions
-   * by our own accounting. We try to handle other types of business
-   * (like ClutterAnimation) by adding a low priority idle function.
-   *
-   * This won't work properly if the mainloop goes idle waiting for
-   * the vertical blanking interval or waiting for work being done
-   * in another thread.
+  /* This is called when we think we are ready to run idle work and
+   * leisure functions by our own accounting. Whether the stage is done
+   * drawing as well is up to run_leisure_functions().
    */
   if (!global->leisure_function_id)
     {
       global->leisure_function_id = g_idle_add_full (G_PRIORITY_LOW,
-                                                     run_leisure_functions,
+                                                     run_idle_work,
                                                      global, NULL);
-      g_source_set_name_by_id (global->leisure_function_id, "[gnome-shell] run_leisure_functions");
+      g_source_set_name_by_id (global->leisure_function_id, "[gnome-shell] run_idle_work");
     }
 }
 
@@ -1564,8 +2496,7 @@ shell_global_end_work (ShellGlobal *global)
 
   global->work_count--;
   if (global->work_count == 0)
-    schedule_leisure_functions (global);
-
+    schedule_idle_work (global);
 }
 
 /**
@@ -1577,10 +2508,9 @@ shell_global_end_work (ShellGlobal *global)
  *
  * Schedules a function to be called the next time the shell is idle.
  * Idle means here no animations, no redrawing, and no ongoing background
- * work. Since there is currently no way to hook into the Clutter master
- * clock and know when is running, the implementation here is somewhat
- * approximation. Animations may be detected as terminating early if they
- * can be drawn fast enough so that the event loop goes idle between frames.
+ * work, including work added with shell_global_add_idle_work(). The
+ * stage counts as done drawing once no redraw is queued, no update ran
+ * for a whole refresh cycle, and the last frame was presented.
  *
  * The intent of this function is for performance measurement runs
  * where a number of actions should be run serially and each action is
@@ -1603,7 +2533,100 @@ shell_global_run_at_leisure (ShellGlobal         *global,
                                              closure);
 
   if (global->work_count == 0)
-    schedule_leisure_functions (global);
+    schedule_idle_work (global);
+}
+
+/**
+ * shell_global_add_idle_work:
+ * @global: the #ShellGlobal
+ * @priority: the priority of the work
+ * @deadline: time in milliseconds after which the work runs even if the
+ *   shell is busy, or 0 to wait for it to be idle however long it takes
+ * @func: function doing a slice of the work
+ * @user_data: data to pass to @func
+ * @notify: function to call to free @user_data
+ *
+ * Adds work to do while the shell is idle, in the sense of
+ * shell_global_begin_work(). The work is done in slices: @func is called
+ * repeatedly, doing a bit of the work each time, until it returns
+ * %FALSE. Slices of higher priority work run first, and as many run
+ * in a row as fit before the next frame is due, so that the work
+ * doesn't make the shell miss frames.
+ *
+ * Returns: an ID to pass to shell_global_remove_idle_work()
+ */
+guint
+shell_global_add_idle_work (ShellGlobal       *global,
+                            ShellIdlePriority  priority,
+                            guint              deadline,
+                            ShellIdleWorkFunc  func,
+                            gpointer           user_data,
+                            GDestroyNotify     notify)
+{
+  IdleWork *work;
+
+  g_return_val_if_fail (SHELL_IS_GLOBAL (global), 0);
+  g_return_val_if_fail (priority <= SHELL_IDLE_PRIORITY_LOW, 0);
+
+  work = g_new0 (IdleWork, 1);
+  work->id = ++global->last_idle_work_id;
+  work->priority = priority;
+  work->func = func;
+  work->user_data = user_data;
+  work->notify = notify;
+
+  if (deadline > 0)
+    work->deadline = g_get_monotonic_time () + deadline * (gint64) 1000;
+
+  g_queue_push_tail (&global->idle_work[priority], work);
+
+  if (global->work_count == 0)
+    schedule_idle_work (global);
+  else
+    update_idle_work_timeout (global);
+
+  return work->id;
+}
+
+/**
+ * shell_global_remove_idle_work:
+ * @global: the #ShellGlobal
+ * @id: the ID returned by shell_global_add_idle_work()
+ *
+ * Stops work added with shell_global_add_idle_work() before it is done.
+ */
+void
+shell_global_remove_idle_work (ShellGlobal *global,
+                               guint        id)
+{
+  int priority;
+  GList *l;
+
+  g_return_if_fail (SHELL_IS_GLOBAL (global));
+
+  for (priority = 0; priority <= SHELL_IDLE_PRIORITY_LOW; priority++)
+    {
+      for (l = global->idle_work[priority].head; l; l = l->next)
+        {
+          IdleWork *work = l->data;
+
+          if (work->id != id)
+            continue;
+
+          /* Running work is freed once its slice returns */
+          if (work->running)
+            {
+              work->removed = TRUE;
+            }
+          else
+            {
+              g_queue_delete_link (&global->idle_work[priority], l);
+              idle_work_free (work);
+            }
+
+          return;
+        }
+    }
 }
 
 const char *
@@ -1708,13 +2731,84 @@ replace_variant_cb (GObject      *object,
   g_hash_table_remove (global->save_ops, object);
 }
 
+/* Runtime and persistent state is kept in memory once read or set.
+ * Changes are written back a moment later, so that a burst of them for
+ * the same key only leads to a single write. */
+typedef struct
+{
+  ShellGlobal *global;
+  GFile *path;
+  GBytes *bytes;
+  guint save_id;
+} StateEntry;
+
 static void
-save_variant (ShellGlobal *global,
-              GFile       *dir,
-              const char  *property_name,
-              GVariant    *variant)
+state_entry_free (StateEntry *entry)
+{
+  g_clear_handle_id (&entry->save_id, g_source_remove);
+  g_clear_pointer (&entry->bytes, g_bytes_unref);
+  g_object_unref (entry->path);
+  g_free (entry);
+}
+
+static GBytes *
+load_state (GFile *path)
+{
+  GBytes *bytes = NULL;
+  GMappedFile *mfile;
+  char *pathstr;
+  GError *local_error = NULL;
+
+  pathstr = g_file_get_path (path);
+  mfile = g_mapped_file_new (pathstr, FALSE, &local_error);
+  if (!mfile)
+    {
+      if (!g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        {
+          g_warning ("Failed to open runtime state: %s", local_error->message);
+        }
+      g_clear_error (&local_error);
+    }
+  else
+    {
+      bytes = g_mapped_file_get_bytes (mfile);
+      g_mapped_file_unref (mfile);
+    }
+
+  g_free (pathstr);
+
+  return bytes;
+}
+
+static StateEntry *
+get_state_entry (ShellGlobal *global,
+                 GFile       *dir,
+                 const char  *property_name,
+                 gboolean     load)
+{
+  g_autoptr (GFile) path = g_file_get_child (dir, property_name);
+  StateEntry *entry;
+
+  entry = g_hash_table_lookup (global->state_entries, path);
+  if (entry)
+    return entry;
+
+  entry = g_new0 (StateEntry, 1);
+  entry->global = global;
+  entry->path = g_steal_pointer (&path);
+  if (load)
+    entry->bytes = load_state (entry->path);
+
+  g_hash_table_insert (global->state_entries, entry->path, entry);
+
+  return entry;
+}
+
+static void
+save_state_entry (StateEntry *entry)
 {
-  GFile *path = g_file_get_child (dir, property_name);
+  ShellGlobal *global = entry->global;
+  GFile *path = entry->path;
   GCancellable *cancellable;
 
   cancellable = g_hash_table_lookup (global->save_ops, path);
@@ -1723,64 +2817,168 @@ save_variant (ShellGlobal *global,
   cancellable = g_cancellable_new ();
   g_hash_table_insert (global->save_ops, g_object_ref (path), cancellable);
 
-  if (variant == NULL || g_variant_get_data (variant) == NULL)
+  if (entry->bytes == NULL)
     {
       g_file_delete_async (path, G_PRIORITY_DEFAULT, cancellable,
                            delete_variant_cb, global);
     }
   else
     {
-      g_autoptr(GBytes) bytes = NULL;
-
-      bytes = g_bytes_new_with_free_func (g_variant_get_data (variant),
-                                          g_variant_get_size (variant),
-                                          (GDestroyNotify)g_variant_unref,
-                                          g_variant_ref (variant));
       /* g_file_replace_contents_async() can potentially fsync() from the
        * calling thread when completing the asynchronous task. Instead, we
        * want to force that fsync() to a thread to avoid blocking the
        * compositor main loop. Using our own replace_contents_async()
        * simply executes the operation synchronously from a thread.
        */
-      replace_contents_async (path, bytes, cancellable, replace_variant_cb, global);
+      replace_contents_async (path, entry->bytes, cancellable,
+                              replace_variant_cb, global);
+    }
+}
+
+static gboolean
+on_state_save_timeout (gpointer data)
+{
+  StateEntry *entry = data;
+
+  entry->save_id = 0;
+  save_state_entry (entry);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+save_variant (ShellGlobal *global,
+              GFile       *dir,
+              const char  *property_name,
+              GVariant    *variant)
+{
+  StateEntry *entry = get_state_entry (global, dir, property_name, FALSE);
+
+  g_clear_pointer (&entry->bytes, g_bytes_unref);
+
+  if (variant != NULL)
+    {
+      g_autoptr (GVariant) value = g_variant_ref_sink (variant);
+
+      /* Empty values unset the property, like they did when they
+       * were read back from an empty file */
+      if (g_variant_get_size (value) > 0)
+        entry->bytes = g_variant_get_data_as_bytes (value);
     }
 
-  g_object_unref (path);
+  /* Writes happen at most once per delay, rather than being pushed back
+   * by every change, so that a stream of changes still gets saved */
+  if (!entry->save_id)
+    {
+      entry->save_id = g_timeout_add (STATE_SAVE_DELAY_MS,
+                                      on_state_save_timeout, entry);
+      g_source_set_name_by_id (entry->save_id, "[gnome-shell] save_state");
+    }
 }
 
 static GVariant *
-load_variant (GFile      *dir,
-              const char *property_type,
-              const char *property_name)
+load_variant (ShellGlobal *global,
+              GFile       *dir,
+              const char  *property_type,
+              const char  *property_name)
 {
-  GVariant *res = NULL;
-  GMappedFile *mfile;
-  GFile *path = g_file_get_child (dir, property_name);
-  char *pathstr;
-  GError *local_error = NULL;
+  StateEntry *entry = get_state_entry (global, dir, property_name, TRUE);
 
-  pathstr = g_file_get_path (path);
-  mfile = g_mapped_file_new (pathstr, FALSE, &local_error);
-  if (!mfile)
+  if (!entry->bytes)
+    return NULL;
+
+  return g_variant_new_from_bytes (G_VARIANT_TYPE (property_type),
+                                   entry->bytes, FALSE);
+}
+
+/* Writes out all state that still waits to be saved, without leaving
+ * anything to the main loop. Everything is written to temporary files
+ * first, and synced to disk with a single syncfs() per directory before
+ * the files are moved into place, so the batch can't leave truncated
+ * files behind. */
+static void
+flush_state (ShellGlobal *global)
+{
+  g_autoptr (GPtrArray) pending = g_ptr_array_new ();
+  g_autoptr (GHashTable) dirs = NULL;
+  GHashTableIter iter;
+  StateEntry *entry;
+  GFile *dir;
+  guint i;
+
+  dirs = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                g_object_unref, NULL);
+
+  g_hash_table_iter_init (&iter, global->state_entries);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
     {
-      if (!g_error_matches (local_error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+      GCancellable *cancellable;
+      g_autofree char *path = NULL;
+      g_autofree char *tmp_path = NULL;
+      g_autoptr (GError) error = NULL;
+      const char *data;
+      gsize len;
+
+      cancellable = g_hash_table_lookup (global->save_ops, entry->path);
+      if (!entry->save_id && !cancellable)
+        continue;
+
+      g_clear_handle_id (&entry->save_id, g_source_remove);
+      g_cancellable_cancel (cancellable);
+
+      path = g_file_get_path (entry->path);
+
+      if (entry->bytes == NULL)
         {
-          g_warning ("Failed to open runtime state: %s", local_error->message);
+          if (g_unlink (path) < 0 && errno != ENOENT)
+            g_warning ("Could not delete runtime/persistent state file: %s",
+                       g_strerror (errno));
+          continue;
         }
-      g_clear_error (&local_error);
+
+      tmp_path = g_strconcat (path, ".tmp", NULL);
+      data = g_bytes_get_data (entry->bytes, &len);
+
+      if (!g_file_set_contents_full (tmp_path, data, len,
+                                     G_FILE_SET_CONTENTS_NONE, 0600,
+                                     &error))
+        {
+          g_warning ("Could not replace runtime/persistent state file: %s",
+                     error->message);
+          continue;
+        }
+
+      g_ptr_array_add (pending, entry);
+      g_hash_table_add (dirs, g_file_get_parent (entry->path));
     }
-  else
+
+  g_hash_table_iter_init (&iter, dirs);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &dir, NULL))
     {
-      GBytes *bytes = g_mapped_file_get_bytes (mfile);
-      res = g_variant_new_from_bytes (G_VARIANT_TYPE (property_type), bytes, FALSE);
-      g_bytes_unref (bytes);
-      g_mapped_file_unref (mfile);
+      g_autofree char *dir_path = g_file_get_path (dir);
+      int fd = open (dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+      if (fd < 0 || syncfs (fd) < 0)
+        g_warning ("Could not sync runtime/persistent state: %s",
+                   g_strerror (errno));
+
+      if (fd >= 0)
+        close (fd);
     }
 
-  g_object_unref (path);
-  g_free (pathstr);
+  for (i = 0; i < pending->len; i++)
+    {
+      g_autofree char *path = NULL;
+      g_autofree char *tmp_path = NULL;
 
-  return res;
+      entry = g_ptr_array_index (pending, i);
+      path = g_file_get_path (entry->path);
+      tmp_path = g_strconcat (path, ".tmp", NULL);
+
+      if (g_rename (tmp_path, path) < 0)
+        g_warning ("Could not replace runtime/persistent state file: %s",
+                   g_strerror (errno));
+    }
 }
 
 /**
@@ -1815,7 +3013,8 @@ shell_global_get_runtime_state (ShellGlobal  *global,
                                 const char   *property_type,
                                 const char   *property_name)
 {
-  return load_variant (global->runtime_state_path, property_type, property_name);
+  return load_variant (global, global->runtime_state_path,
+                       property_type, property_name);
 }
 
 /**
@@ -1850,7 +3049,101 @@ shell_global_get_persistent_state (ShellGlobal  *global,
                                    const char   *property_type,
                                    const char   *property_name)
 {
-  return load_variant (global->userdatadir_path, property_type, property_name);
+  return load_variant (global, global->userdatadir_path,
+                       property_type, property_name);
+}
+
+/**
+ * shell_global_get_frame_stats:
+ * @global: a #ShellGlobal
+ *
+ * Gets the records of the most recent stage updates, oldest first, while
+ * #ShellGlobal:frame-stats is enabled. Each record is a tuple of the
+ * monotonic time the update started at, the time spent in
+ * ::before-update handlers, mostly resolving styles, in layout, in
+ * painting, waiting for the GPU (or -1 unless
+ * #ShellGlobal:frame-finish-timestamp is set), the whole update, the
+ * time since the previous update ended, and whether the update took
+ * longer than a refresh cycle. Times are in microseconds.
+ *
+ * Returns: (transfer full): a #GVariant of type a(xxxxxxxb)
+ */
+GVariant *
+shell_global_get_frame_stats (ShellGlobal *global)
+{
+  GVariantBuilder builder;
+  guint i;
+
+  g_return_val_if_fail (SHELL_IS_GLOBAL (global), NULL);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(xxxxxxxb)"));
+
+  for (i = 0; i < global->n_frame_records; i++)
+    {
+      guint index = (global->next_frame_record + N_FRAME_RECORDS -
+                     global->n_frame_records + i) % N_FRAME_RECORDS;
+      ShellFrameRecord *record = &global->frame_records[index];
+
+      g_variant_builder_add (&builder, "(xxxxxxxb)",
+                             record->start_time,
+                             record->style_time,
+                             record->layout_time,
+                             record->paint_time,
+                             record->gpu_time,
+                             record->update_time,
+                             record->interval,
+                             record->dropped);
+    }
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+/**
+ * shell_global_get_view_frame_stats:
+ * @global: a #ShellGlobal
+ *
+ * Gets the same stage updates as shell_global_get_frame_stats(), but
+ * with what tells the updates of different monitors apart, which can
+ * refresh at different rates. Each record is a tuple of the index of
+ * the monitor of the view that was updated, its refresh rate, the
+ * monotonic time the update started at, the time the whole update took,
+ * the time from the start of the update until the frame was presented
+ * (or -1 if it wasn't, or isn't yet), and whether the update missed its
+ * deadline by taking longer than a refresh cycle. Times are in
+ * microseconds.
+ *
+ * Returns: (transfer full): a #GVariant of type a(idxxxb)
+ */
+GVariant *
+shell_global_get_view_frame_stats (ShellGlobal *global)
+{
+  GVariantBuilder builder;
+  guint i;
+
+  g_return_val_if_fail (SHELL_IS_GLOBAL (global), NULL);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(idxxxb)"));
+
+  for (i = 0; i < global->n_frame_records; i++)
+    {
+      guint index = (global->next_frame_record + N_FRAME_RECORDS -
+                     global->n_frame_records + i) % N_FRAME_RECORDS;
+      ShellFrameRecord *record = &global->frame_records[index];
+      gint64 latency = -1;
+
+      if (record->presentation_time > 0)
+        latency = record->presentation_time - record->start_time;
+
+      g_variant_builder_add (&builder, "(idxxxb)",
+                             record->monitor,
+                             (double) record->refresh_rate,
+                             record->start_time,
+                             record->update_time,
+                             latency,
+                             record->dropped);
+    }
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
 }
 
 void
@@ -1863,6 +3156,9 @@ void
 _shell_global_notify_shutdown (ShellGlobal *global)
 {
   g_signal_emit (global, shell_global_signals[SHUTDOWN], 0);
+
+  /* After ::shutdown, to include any state saved by its handlers */
+  flush_state (global);
 }
 
 /**
@@ -22,7 +22,10 @@ MetaContext          *shell_global_get_context               (ShellGlobal *globa
 ClutterStage         *shell_global_get_stage                 (ShellGlobal *global);
 MetaDisplay          *shell_global_get_display               (ShellGlobal *global);
 GList                *shell_global_get_window_actors         (ShellGlobal *global);
+GListModel           *shell_global_get_window_actors_model   (ShellGlobal *global);
 GSettings            *shell_global_get_settings              (ShellGlobal *global);
+GSettings            *shell_global_get_schema_settings       (ShellGlobal *global,
+                                                              const char  *schema_id);
 guint32               shell_global_get_current_time          (ShellGlobal *global);
 MetaWorkspaceManager *shell_global_get_workspace_manager     (ShellGlobal *global);
 
@@ -36,6 +39,9 @@ void    shell_global_get_pointer             (ShellGlobal         *global,
                                               int                 *y,
                                               ClutterModifierType *mods);
 
+void    shell_global_set_pointer_watch_interval (ShellGlobal *global,
+                                                 guint        interval_ms);
+
 typedef struct {
   guint glibc_uordblks;
 
@@ -61,6 +67,40 @@ void shell_global_run_at_leisure (ShellGlobal          *global,
                                   gpointer              user_data,
                                   GDestroyNotify        notify);
 
+/**
+ * ShellIdlePriority:
+ * @SHELL_IDLE_PRIORITY_HIGH: work the user is likely to wait for soon
+ * @SHELL_IDLE_PRIORITY_DEFAULT: the priority of most idle work
+ * @SHELL_IDLE_PRIORITY_LOW: work that only improves later responsiveness
+ *
+ * The priority of work added with shell_global_add_idle_work().
+ */
+typedef enum
+{
+  SHELL_IDLE_PRIORITY_HIGH,
+  SHELL_IDLE_PRIORITY_DEFAULT,
+  SHELL_IDLE_PRIORITY_LOW,
+} ShellIdlePriority;
+
+/**
+ * ShellIdleWorkFunc:
+ * @data: the data passed to shell_global_add_idle_work()
+ *
+ * Does a slice of work added with shell_global_add_idle_work().
+ *
+ * Returns: %TRUE if there is more work left to do
+ */
+typedef gboolean (*ShellIdleWorkFunc) (gpointer data);
+
+guint shell_global_add_idle_work    (ShellGlobal       *global,
+                                     ShellIdlePriority  priority,
+                                     guint              deadline,
+                                     ShellIdleWorkFunc  func,
+                                     gpointer           user_data,
+                                     GDestroyNotify     notify);
+void  shell_global_remove_idle_work (ShellGlobal       *global,
+                                     guint              id);
+
 
 /* Misc utilities / Shell API */
 GDBusProxy *
@@ -93,6 +133,9 @@ GVariant * shell_global_get_persistent_state    (ShellGlobal  *global,
                                                  const char   *property_type,
                                                  const char   *property_name);
 
+GVariant * shell_global_get_frame_stats         (ShellGlobal  *global);
+GVariant * shell_global_get_view_frame_stats    (ShellGlobal  *global);
+
 ShellWindowTracker * shell_global_get_window_tracker (ShellGlobal *global);
 
 ShellAppSystem *     shell_global_get_app_system     (ShellGlobal *global);
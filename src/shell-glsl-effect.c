@@ -7,21 +7,140 @@
  * A #ShellGLSLEffect is a #ClutterOffscreenEffect that allows
  * running custom GLSL to the vertex and fragment stages of the
  * graphic pipeline.
+ *
+ * Effects of the same type can share their uniforms with
+ * shell_glsl_effect_share_uniforms(), so that effects applied to many
+ * actors with the same parameters are updated together and paint with
+ * identical pipeline state.
  */
 
 #include "config.h"
 
 #include <cogl/cogl.h>
 #include "shell-glsl-effect.h"
+#include "st.h"
+
+typedef struct _UniformValue
+{
+  int uniform;
+  gboolean is_matrix;
+  gboolean transpose;
+  int n_components;
+  int count;
+  float *value;
+} UniformValue;
+
+/* The effects sharing their uniforms, and the values of the uniforms */
+typedef struct _UniformGroup
+{
+  grefcount ref_count;
+
+  GPtrArray *effects;
+  GHashTable *values;
+} UniformGroup;
 
 typedef struct _ShellGLSLEffectPrivate ShellGLSLEffectPrivate;
 struct _ShellGLSLEffectPrivate
 {
   CoglPipeline  *pipeline;
+
+  UniformGroup  *uniform_group;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (ShellGLSLEffect, shell_glsl_effect, CLUTTER_TYPE_OFFSCREEN_EFFECT);
 
+G_DEFINE_QUARK (shell-glsl-effect-uniform-locations, uniform_locations)
+
+static void
+uniform_value_free (UniformValue *uniform_value)
+{
+  g_free (uniform_value->value);
+  g_free (uniform_value);
+}
+
+static UniformGroup *
+uniform_group_new (void)
+{
+  UniformGroup *group = g_new0 (UniformGroup, 1);
+
+  g_ref_count_init (&group->ref_count);
+  group->effects = g_ptr_array_new ();
+  group->values = g_hash_table_new_full (NULL, NULL, NULL,
+                                         (GDestroyNotify) uniform_value_free);
+
+  return group;
+}
+
+static void
+uniform_group_unref (UniformGroup *group)
+{
+  if (!g_ref_count_dec (&group->ref_count))
+    return;
+
+  g_ptr_array_unref (group->effects);
+  g_hash_table_unref (group->values);
+  g_free (group);
+}
+
+static void
+apply_uniform_value (ShellGLSLEffect    *effect,
+                     const UniformValue *uniform_value)
+{
+  ShellGLSLEffectPrivate *priv = shell_glsl_effect_get_instance_private (effect);
+
+  if (uniform_value->is_matrix)
+    cogl_pipeline_set_uniform_matrix (priv->pipeline,
+                                      uniform_value->uniform,
+                                      uniform_value->n_components,
+                                      uniform_value->count,
+                                      uniform_value->transpose,
+                                      uniform_value->value);
+  else
+    cogl_pipeline_set_uniform_float (priv->pipeline,
+                                     uniform_value->uniform,
+                                     uniform_value->n_components,
+                                     uniform_value->count,
+                                     uniform_value->value);
+}
+
+static void
+set_uniform_value (ShellGLSLEffect *effect,
+                   UniformValue    *uniform_value)
+{
+  ShellGLSLEffectPrivate *priv = shell_glsl_effect_get_instance_private (effect);
+  UniformGroup *group = priv->uniform_group;
+  guint i;
+
+  g_hash_table_replace (group->values,
+                        GINT_TO_POINTER (uniform_value->uniform),
+                        uniform_value);
+
+  for (i = 0; i < group->effects->len; i++)
+    {
+      ShellGLSLEffect *other = g_ptr_array_index (group->effects, i);
+      ClutterActor *actor;
+
+      apply_uniform_value (other, uniform_value);
+
+      /* Whoever sets the uniform takes care of its own actor, as before */
+      actor = clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (other));
+      if (other != effect && actor != NULL)
+        clutter_actor_queue_redraw (actor);
+    }
+}
+
+static void
+leave_uniform_group (ShellGLSLEffect *effect)
+{
+  ShellGLSLEffectPrivate *priv = shell_glsl_effect_get_instance_private (effect);
+
+  if (priv->uniform_group == NULL)
+    return;
+
+  g_ptr_array_remove_fast (priv->uniform_group->effects, effect);
+  g_clear_pointer (&priv->uniform_group, uniform_group_unref);
+}
+
 static CoglPipeline *
 shell_glsl_effect_create_pipeline (ClutterOffscreenEffect *effect,
                                    CoglTexture            *texture)
@@ -87,6 +206,7 @@ shell_glsl_effect_dispose (GObject *gobject)
 
   priv = shell_glsl_effect_get_instance_private (self);
 
+  leave_uniform_group (self);
   g_clear_object (&priv->pipeline);
 
   G_OBJECT_CLASS (shell_glsl_effect_parent_class)->dispose (gobject);
@@ -95,6 +215,10 @@ shell_glsl_effect_dispose (GObject *gobject)
 static void
 shell_glsl_effect_init (ShellGLSLEffect *effect)
 {
+  ShellGLSLEffectPrivate *priv = shell_glsl_effect_get_instance_private (effect);
+
+  priv->uniform_group = uniform_group_new ();
+  g_ptr_array_add (priv->uniform_group->effects, effect);
 }
 
 static void
@@ -130,6 +254,14 @@ shell_glsl_effect_constructed (GObject *object)
   cogl_pipeline_set_layer_null_texture (klass->base_pipeline, 0);
 }
 
+static CoglTexture *
+shell_glsl_effect_create_texture (ClutterOffscreenEffect *effect,
+                                   float                   width,
+                                   float                   height)
+{
+  return st_texture_pool_acquire (MAX (width, 1), MAX (height, 1));
+}
+
 static void
 shell_glsl_effect_class_init (ShellGLSLEffectClass *klass)
 {
@@ -138,6 +270,7 @@ shell_glsl_effect_class_init (ShellGLSLEffectClass *klass)
 
   offscreen_class = CLUTTER_OFFSCREEN_EFFECT_CLASS (klass);
   offscreen_class->create_pipeline = shell_glsl_effect_create_pipeline;
+  offscreen_class->create_texture = shell_glsl_effect_create_texture;
 
   gobject_class->constructed = shell_glsl_effect_constructed;
   gobject_class->dispose = shell_glsl_effect_dispose;
@@ -148,6 +281,8 @@ shell_glsl_effect_class_init (ShellGLSLEffectClass *klass)
  * @effect: a #ShellGLSLEffect
  * @name: the uniform name
  *
+ * The locations are looked up once per effect type.
+ *
  * Returns: the location of the uniform named @name, that can be
  *          passed to shell_glsl_effect_set_uniform_float().
  */
@@ -156,7 +291,25 @@ shell_glsl_effect_get_uniform_location (ShellGLSLEffect *effect,
                                         const char      *name)
 {
   ShellGLSLEffectPrivate *priv = shell_glsl_effect_get_instance_private (effect);
-  return cogl_pipeline_get_uniform_location (priv->pipeline, name);
+  GType type = G_OBJECT_TYPE (effect);
+  GHashTable *locations;
+  gpointer location;
+  int uniform;
+
+  locations = g_type_get_qdata (type, uniform_locations_quark ());
+  if (G_UNLIKELY (locations == NULL))
+    {
+      locations = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+      g_type_set_qdata (type, uniform_locations_quark (), locations);
+    }
+
+  if (g_hash_table_lookup_extended (locations, name, NULL, &location))
+    return GPOINTER_TO_INT (location);
+
+  uniform = cogl_pipeline_get_uniform_location (priv->pipeline, name);
+  g_hash_table_insert (locations, g_strdup (name), GINT_TO_POINTER (uniform));
+
+  return uniform;
 }
 
 /**
@@ -174,10 +327,14 @@ shell_glsl_effect_set_uniform_float (ShellGLSLEffect *effect,
                                      int              total_count,
                                      const float     *value)
 {
-  ShellGLSLEffectPrivate *priv = shell_glsl_effect_get_instance_private (effect);
-  cogl_pipeline_set_uniform_float (priv->pipeline, uniform,
-                                   n_components, total_count / n_components,
-                                   value);
+  UniformValue *uniform_value = g_new0 (UniformValue, 1);
+
+  uniform_value->uniform = uniform;
+  uniform_value->n_components = n_components;
+  uniform_value->count = total_count / n_components;
+  uniform_value->value = g_memdup2 (value, total_count * sizeof (float));
+
+  set_uniform_value (effect, uniform_value);
 }
 
 /**
@@ -197,9 +354,53 @@ shell_glsl_effect_set_uniform_matrix (ShellGLSLEffect *effect,
                                       int              total_count,
                                       const float     *value)
 {
-  ShellGLSLEffectPrivate *priv = shell_glsl_effect_get_instance_private (effect);
-  cogl_pipeline_set_uniform_matrix (priv->pipeline, uniform,
-                                    dimensions,
-                                    total_count / (dimensions * dimensions),
-                                    transpose, value);
+  UniformValue *uniform_value = g_new0 (UniformValue, 1);
+
+  uniform_value->uniform = uniform;
+  uniform_value->is_matrix = TRUE;
+  uniform_value->transpose = transpose;
+  uniform_value->n_components = dimensions;
+  uniform_value->count = total_count / (dimensions * dimensions);
+  uniform_value->value = g_memdup2 (value, total_count * sizeof (float));
+
+  set_uniform_value (effect, uniform_value);
+}
+
+/**
+ * shell_glsl_effect_share_uniforms:
+ * @effect: a #ShellGLSLEffect
+ * @source: a #ShellGLSLEffect of the same type as @effect
+ *
+ * Makes @effect take the uniform values of @source, and keeps the
+ * uniforms of all the effects sharing them the same from then on:
+ * setting a uniform on one of them sets it on all of them, and queues
+ * a redraw of the other actors.
+ */
+void
+shell_glsl_effect_share_uniforms (ShellGLSLEffect *effect,
+                                  ShellGLSLEffect *source)
+{
+  ShellGLSLEffectPrivate *priv, *source_priv;
+  GHashTableIter iter;
+  UniformValue *uniform_value;
+
+  g_return_if_fail (SHELL_IS_GLSL_EFFECT (effect));
+  g_return_if_fail (SHELL_IS_GLSL_EFFECT (source));
+  g_return_if_fail (G_OBJECT_TYPE (effect) == G_OBJECT_TYPE (source));
+
+  priv = shell_glsl_effect_get_instance_private (effect);
+  source_priv = shell_glsl_effect_get_instance_private (source);
+
+  if (priv->uniform_group == source_priv->uniform_group)
+    return;
+
+  leave_uniform_group (effect);
+
+  priv->uniform_group = source_priv->uniform_group;
+  g_ref_count_inc (&priv->uniform_group->ref_count);
+  g_ptr_array_add (priv->uniform_group->effects, effect);
+
+  g_hash_table_iter_init (&iter, priv->uniform_group->values);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &uniform_value))
+    apply_uniform_value (effect, uniform_value);
 }
@@ -58,4 +58,7 @@ void shell_glsl_effect_set_uniform_matrix   (ShellGLSLEffect *effect,
                                              int              total_count,
                                              const float     *value);
 
+void shell_glsl_effect_share_uniforms       (ShellGLSLEffect *effect,
+                                             ShellGLSLEffect *source);
+
 #endif /* __SHELL_GLSL_EFFECT_H__ */
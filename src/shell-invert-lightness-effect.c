@@ -39,6 +39,8 @@
 
 #include <cogl/cogl.h>
 
+#include "st.h"
+
 struct _ShellInvertLightnessEffect
 {
   ClutterOffscreenEffect parent_instance;
@@ -83,6 +85,14 @@ shell_glsl_effect_create_pipeline (ClutterOffscreenEffect *effect,
   return g_object_ref (self->pipeline);
 }
 
+static CoglTexture *
+shell_invert_lightness_effect_create_texture (ClutterOffscreenEffect *effect,
+                                               float                   width,
+                                               float                   height)
+{
+  return st_texture_pool_acquire (MAX (width, 1), MAX (height, 1));
+}
+
 static void
 shell_invert_lightness_effect_dispose (GObject *gobject)
 {
@@ -101,6 +111,7 @@ shell_invert_lightness_effect_class_init (ShellInvertLightnessEffectClass *klass
 
   offscreen_class = CLUTTER_OFFSCREEN_EFFECT_CLASS (klass);
   offscreen_class->create_pipeline = shell_glsl_effect_create_pipeline;
+  offscreen_class->create_texture = shell_invert_lightness_effect_create_texture;
 
   gobject_class->dispose = shell_invert_lightness_effect_dispose;
 }
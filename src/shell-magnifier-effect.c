@@ -0,0 +1,313 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * ShellMagnifierEffect:
+ *
+ * The color adjustments of a magnifier zoom region in one pass.
+ *
+ * Applies lightness inversion, then brightness and contrast, then
+ * desaturation, like #ShellInvertLightnessEffect,
+ * #ClutterBrightnessContrastEffect and #ClutterDesaturateEffect added in
+ * that order would. Those need an offscreen each, which at the size of a
+ * full screen zoom region adds up to several screen-sized textures
+ * rendered per frame.
+ *
+ * The effect disables itself while none of the adjustments change
+ * anything.
+ */
+
+#include "config.h"
+
+#include <math.h>
+
+#include <cogl/cogl.h>
+
+#include "shell-magnifier-effect.h"
+#include "st.h"
+
+struct _ShellMagnifierEffect
+{
+  ClutterOffscreenEffect parent_instance;
+
+  CoglPipeline *pipeline;
+
+  gboolean invert_lightness;
+  float saturation;
+  float brightness[3];
+  float contrast[3];
+
+  int invert_lightness_uniform;
+  int desaturation_uniform;
+  int brightness_multiplier_uniform;
+  int brightness_offset_uniform;
+  int contrast_uniform;
+};
+
+G_DEFINE_FINAL_TYPE (ShellMagnifierEffect, shell_magnifier_effect,
+                     CLUTTER_TYPE_OFFSCREEN_EFFECT)
+
+static CoglPipeline *base_pipeline = NULL;
+
+static const char *magnifier_effect_declarations =
+  "uniform float invert_lightness;\n"
+  "uniform float desaturation;\n"
+  "uniform vec3 brightness_multiplier;\n"
+  "uniform vec3 brightness_offset;\n"
+  "uniform vec3 contrast;\n";
+
+/* Works on premultiplied colors, like the effects it stands in for */
+static const char *magnifier_effect_source =
+  "vec3 effect = cogl_color_out.rgb;\n"
+  "float alpha = cogl_color_out.a;\n"
+  "\n"
+  "float max_color = max (effect.r, max (effect.g, effect.b));\n"
+  "float min_color = min (effect.r, min (effect.g, effect.b));\n"
+  "float lightness = (max_color + min_color) / 2.0;\n"
+  "effect += invert_lightness * (1.0 - 2.0 * lightness);\n"
+  "\n"
+  "effect = effect * brightness_multiplier + brightness_offset * alpha;\n"
+  "effect = (effect - 0.5 * alpha) * contrast + 0.5 * alpha;\n"
+  "\n"
+  "vec3 gray = vec3 (dot (vec3 (0.299, 0.587, 0.114), effect));\n"
+  "effect = mix (effect, gray, desaturation);\n"
+  "\n"
+  "cogl_color_out.rgb = effect;\n";
+
+static gboolean
+shell_magnifier_effect_is_identity (ShellMagnifierEffect *self)
+{
+  int i;
+
+  if (self->invert_lightness || self->saturation != 1.0f)
+    return FALSE;
+
+  for (i = 0; i < 3; i++)
+    {
+      if (self->brightness[i] != 0.0f || self->contrast[i] != 0.0f)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+shell_magnifier_effect_update (ShellMagnifierEffect *self)
+{
+  float brightness_multiplier[3];
+  float brightness_offset[3];
+  float contrast[3];
+  int i;
+
+  /* Same mapping as ClutterBrightnessContrastEffect */
+  for (i = 0; i < 3; i++)
+    {
+      if (self->brightness[i] > 0.0f)
+        {
+          brightness_multiplier[i] = 1.0f - self->brightness[i];
+          brightness_offset[i] = self->brightness[i];
+        }
+      else
+        {
+          brightness_multiplier[i] = 1.0f + self->brightness[i];
+          brightness_offset[i] = 0.0f;
+        }
+
+      if (self->contrast[i] > 0.0f)
+        contrast[i] = tanf ((1.0f + self->contrast[i]) * G_PI_4);
+      else
+        contrast[i] = 1.0f + self->contrast[i];
+    }
+
+  cogl_pipeline_set_uniform_1f (self->pipeline,
+                                self->invert_lightness_uniform,
+                                self->invert_lightness ? 1.0f : 0.0f);
+  cogl_pipeline_set_uniform_1f (self->pipeline,
+                                self->desaturation_uniform,
+                                1.0f - self->saturation);
+  cogl_pipeline_set_uniform_float (self->pipeline,
+                                   self->brightness_multiplier_uniform,
+                                   3, 1, brightness_multiplier);
+  cogl_pipeline_set_uniform_float (self->pipeline,
+                                   self->brightness_offset_uniform,
+                                   3, 1, brightness_offset);
+  cogl_pipeline_set_uniform_float (self->pipeline,
+                                   self->contrast_uniform,
+                                   3, 1, contrast);
+
+  clutter_actor_meta_set_enabled (CLUTTER_ACTOR_META (self),
+                                  !shell_magnifier_effect_is_identity (self));
+  clutter_effect_queue_repaint (CLUTTER_EFFECT (self));
+}
+
+static CoglPipeline *
+shell_magnifier_effect_create_pipeline (ClutterOffscreenEffect *effect,
+                                        CoglTexture            *texture)
+{
+  ShellMagnifierEffect *self = SHELL_MAGNIFIER_EFFECT (effect);
+
+  cogl_pipeline_set_layer_texture (self->pipeline, 0, texture);
+
+  return g_object_ref (self->pipeline);
+}
+
+static CoglTexture *
+shell_magnifier_effect_create_texture (ClutterOffscreenEffect *effect,
+                                       float                   width,
+                                       float                   height)
+{
+  return st_texture_pool_acquire (MAX (width, 1), MAX (height, 1));
+}
+
+static void
+shell_magnifier_effect_dispose (GObject *object)
+{
+  ShellMagnifierEffect *self = SHELL_MAGNIFIER_EFFECT (object);
+
+  g_clear_object (&self->pipeline);
+
+  G_OBJECT_CLASS (shell_magnifier_effect_parent_class)->dispose (object);
+}
+
+static void
+shell_magnifier_effect_class_init (ShellMagnifierEffectClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  ClutterOffscreenEffectClass *offscreen_class =
+    CLUTTER_OFFSCREEN_EFFECT_CLASS (klass);
+
+  object_class->dispose = shell_magnifier_effect_dispose;
+
+  offscreen_class->create_pipeline = shell_magnifier_effect_create_pipeline;
+  offscreen_class->create_texture = shell_magnifier_effect_create_texture;
+}
+
+static void
+shell_magnifier_effect_init (ShellMagnifierEffect *self)
+{
+  if (G_UNLIKELY (base_pipeline == NULL))
+    {
+      CoglSnippet *snippet;
+      CoglContext *ctx =
+        clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+      base_pipeline = cogl_pipeline_new (ctx);
+
+      snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_FRAGMENT,
+                                  magnifier_effect_declarations,
+                                  magnifier_effect_source);
+      cogl_pipeline_add_snippet (base_pipeline, snippet);
+      g_object_unref (snippet);
+
+      cogl_pipeline_set_layer_null_texture (base_pipeline, 0);
+    }
+
+  self->pipeline = cogl_pipeline_copy (base_pipeline);
+
+  self->invert_lightness_uniform =
+    cogl_pipeline_get_uniform_location (self->pipeline, "invert_lightness");
+  self->desaturation_uniform =
+    cogl_pipeline_get_uniform_location (self->pipeline, "desaturation");
+  self->brightness_multiplier_uniform =
+    cogl_pipeline_get_uniform_location (self->pipeline, "brightness_multiplier");
+  self->brightness_offset_uniform =
+    cogl_pipeline_get_uniform_location (self->pipeline, "brightness_offset");
+  self->contrast_uniform =
+    cogl_pipeline_get_uniform_location (self->pipeline, "contrast");
+
+  self->saturation = 1.0f;
+
+  shell_magnifier_effect_update (self);
+}
+
+/**
+ * shell_magnifier_effect_new:
+ *
+ * Returns: (transfer full): a new #ShellMagnifierEffect
+ */
+ClutterEffect *
+shell_magnifier_effect_new (void)
+{
+  return g_object_new (SHELL_TYPE_MAGNIFIER_EFFECT, NULL);
+}
+
+/**
+ * shell_magnifier_effect_set_invert_lightness:
+ * @self: a #ShellMagnifierEffect
+ * @invert: whether to invert the lightness of colors
+ *
+ * Sets whether dark colors become light and light colors dark, keeping
+ * their hue.
+ */
+void
+shell_magnifier_effect_set_invert_lightness (ShellMagnifierEffect *self,
+                                             gboolean              invert)
+{
+  g_return_if_fail (SHELL_IS_MAGNIFIER_EFFECT (self));
+
+  self->invert_lightness = !!invert;
+  shell_magnifier_effect_update (self);
+}
+
+/**
+ * shell_magnifier_effect_set_color_saturation:
+ * @self: a #ShellMagnifierEffect
+ * @saturation: the saturation, from 0.0 for grayscale to 1.0 for the
+ *   original colors
+ *
+ * Sets the color saturation.
+ */
+void
+shell_magnifier_effect_set_color_saturation (ShellMagnifierEffect *self,
+                                             float                 saturation)
+{
+  g_return_if_fail (SHELL_IS_MAGNIFIER_EFFECT (self));
+
+  self->saturation = CLAMP (saturation, 0.0f, 1.0f);
+  shell_magnifier_effect_update (self);
+}
+
+/**
+ * shell_magnifier_effect_set_brightness:
+ * @self: a #ShellMagnifierEffect
+ * @red: the change of brightness of the red channel, from -1.0 to 1.0
+ * @green: the change of brightness of the green channel, from -1.0 to 1.0
+ * @blue: the change of brightness of the blue channel, from -1.0 to 1.0
+ *
+ * Sets the brightness, with 0.0 leaving a channel unchanged.
+ */
+void
+shell_magnifier_effect_set_brightness (ShellMagnifierEffect *self,
+                                       float                 red,
+                                       float                 green,
+                                       float                 blue)
+{
+  g_return_if_fail (SHELL_IS_MAGNIFIER_EFFECT (self));
+
+  self->brightness[0] = CLAMP (red, -1.0f, 1.0f);
+  self->brightness[1] = CLAMP (green, -1.0f, 1.0f);
+  self->brightness[2] = CLAMP (blue, -1.0f, 1.0f);
+  shell_magnifier_effect_update (self);
+}
+
+/**
+ * shell_magnifier_effect_set_contrast:
+ * @self: a #ShellMagnifierEffect
+ * @red: the change of contrast of the red channel, from -1.0 to 1.0
+ * @green: the change of contrast of the green channel, from -1.0 to 1.0
+ * @blue: the change of contrast of the blue channel, from -1.0 to 1.0
+ *
+ * Sets the contrast, with 0.0 leaving a channel unchanged.
+ */
+void
+shell_magnifier_effect_set_contrast (ShellMagnifierEffect *self,
+                                     float                 red,
+                                     float                 green,
+                                     float                 blue)
+{
+  g_return_if_fail (SHELL_IS_MAGNIFIER_EFFECT (self));
+
+  self->contrast[0] = CLAMP (red, -1.0f, 1.0f);
+  self->contrast[1] = CLAMP (green, -1.0f, 1.0f);
+  self->contrast[2] = CLAMP (blue, -1.0f, 1.0f);
+  shell_magnifier_effect_update (self);
+}
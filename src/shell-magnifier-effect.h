@@ -0,0 +1,27 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#pragma once
+
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+
+#define SHELL_TYPE_MAGNIFIER_EFFECT (shell_magnifier_effect_get_type ())
+G_DECLARE_FINAL_TYPE (ShellMagnifierEffect, shell_magnifier_effect,
+                      SHELL, MAGNIFIER_EFFECT, ClutterOffscreenEffect)
+
+ClutterEffect *shell_magnifier_effect_new (void);
+
+void shell_magnifier_effect_set_invert_lightness (ShellMagnifierEffect *self,
+                                                  gboolean              invert);
+void shell_magnifier_effect_set_color_saturation (ShellMagnifierEffect *self,
+                                                  float                 saturation);
+void shell_magnifier_effect_set_brightness       (ShellMagnifierEffect *self,
+                                                  float                 red,
+                                                  float                 green,
+                                                  float                 blue);
+void shell_magnifier_effect_set_contrast         (ShellMagnifierEffect *self,
+                                                  float                 red,
+                                                  float                 green,
+                                                  float                 blue);
+
+G_END_DECLS
@@ -35,8 +35,15 @@ enum {
 
 static gint signals[SIGNAL_LAST];
 
+/* How long secrets found in the keyring are kept after the last lookup,
+ * so that the requests of a reconnection burst only search once, in
+ * seconds */
+#define SECRETS_CACHE_TIMEOUT 10
+
+typedef struct _SecretLookup SecretLookup;
+
 typedef struct {
-  GCancellable *                    cancellable;
+  SecretLookup                     *lookup;
   ShellNetworkAgent                *self;
 
   gchar                            *request_id;
@@ -51,9 +58,25 @@ typedef struct {
   GVariantBuilder                   builder_vpn;
 } ShellAgentRequest;
 
+/* A keyring search for the secrets of a setting of a connection, shared
+ * by the requests waiting for it */
+struct _SecretLookup {
+  ShellNetworkAgent                *self;
+  gchar                            *key;
+  GCancellable                     *cancellable;
+  GList                            *requests;
+  guint                             cancel_id;
+};
+
 struct _ShellNetworkAgentPrivate {
   /* <gchar *request_id, ShellAgentRequest *request> */
   GHashTable *requests;
+
+  /* <gchar *uuid/setting_name, SecretLookup *lookup> */
+  GHashTable *lookups;
+  /* <gchar *uuid/setting_name, GList *items> */
+  GHashTable *secrets;
+  guint secrets_timeout_id;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (ShellNetworkAgent, shell_network_agent, NM_TYPE_SECRET_AGENT_OLD)
@@ -69,13 +92,47 @@ static const SecretSchema network_agent_schema = {
     }
 };
 
+static gboolean
+cancel_unused_lookup_cb (gpointer user_data)
+{
+  SecretLookup *lookup = user_data;
+
+  lookup->cancel_id = 0;
+
+  if (lookup->requests == NULL)
+    g_cancellable_cancel (lookup->cancellable);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+secret_lookup_free (SecretLookup *lookup)
+{
+  g_clear_handle_id (&lookup->cancel_id, g_source_remove);
+  g_object_unref (lookup->cancellable);
+  g_object_unref (lookup->self);
+  g_free (lookup->key);
+  g_free (lookup);
+}
+
 static void
 shell_agent_request_free (gpointer data)
 {
   ShellAgentRequest *request = data;
 
-  g_cancellable_cancel (request->cancellable);
-  g_object_unref (request->cancellable);
+  /* Requests replaced by new ones for the same secrets leave the search
+   * just before their replacement joins it, so only cancel it, and any
+   * unlock prompt, if nobody joined by the next iteration
+   */
+  if (request->lookup)
+    {
+      SecretLookup *lookup = request->lookup;
+
+      lookup->requests = g_list_remove (lookup->requests, request);
+      if (lookup->requests == NULL && lookup->cancel_id == 0)
+        lookup->cancel_id = g_idle_add (cancel_unused_lookup_cb, lookup);
+    }
+
   g_object_unref (request->self);
   g_object_unref (request->connection);
   g_free (request->setting_name);
@@ -86,6 +143,63 @@ shell_agent_request_free (gpointer data)
   g_free (request);
 }
 
+static void
+free_secret_items (gpointer data)
+{
+  g_list_free_full (data, g_object_unref);
+}
+
+static gchar *
+get_secrets_key (NMConnection *connection,
+                 const gchar  *setting_name)
+{
+  return g_strdup_printf ("%s/%s", nm_connection_get_uuid (connection), setting_name);
+}
+
+static gboolean
+clear_secrets_cb (gpointer user_data)
+{
+  ShellNetworkAgentPrivate *priv = user_data;
+
+  priv->secrets_timeout_id = 0;
+  g_hash_table_remove_all (priv->secrets);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+cache_secrets (ShellNetworkAgent *self,
+               const gchar       *key,
+               GList             *items)
+{
+  ShellNetworkAgentPrivate *priv = self->priv;
+
+  g_hash_table_replace (priv->secrets, g_strdup (key),
+                        g_list_copy_deep (items, (GCopyFunc) g_object_ref, NULL));
+
+  g_clear_handle_id (&priv->secrets_timeout_id, g_source_remove);
+  priv->secrets_timeout_id = g_timeout_add_seconds (SECRETS_CACHE_TIMEOUT,
+                                                    clear_secrets_cb, priv);
+  g_source_set_name_by_id (priv->secrets_timeout_id,
+                           "[gnome-shell] clear_secrets_cb");
+}
+
+static void
+uncache_connection_secrets (ShellNetworkAgent *self,
+                            const gchar       *uuid)
+{
+  g_autofree gchar *prefix = g_strconcat (uuid, "/", NULL);
+  GHashTableIter iter;
+  const gchar *key;
+
+  g_hash_table_iter_init (&iter, self->priv->secrets);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &key, NULL))
+    {
+      if (g_str_has_prefix (key, prefix))
+        g_hash_table_iter_remove (&iter);
+    }
+}
+
 static void
 shell_agent_request_cancel (ShellAgentRequest *request)
 {
@@ -114,6 +228,9 @@ shell_network_agent_init (ShellNetworkAgent *agent)
   priv = agent->priv = shell_network_agent_get_instance_private (agent);
   priv->requests = g_hash_table_new_full (g_str_hash, g_str_equal,
 					  g_free, shell_agent_request_free);
+  priv->lookups = g_hash_table_new (g_str_hash, g_str_equal);
+  priv->secrets = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, free_secret_items);
 }
 
 static void
@@ -143,6 +260,13 @@ shell_network_agent_finalize (GObject *object)
   g_hash_table_destroy (priv->requests);
   g_error_free (error);
 
+  /* Lookups keep the agent alive until they finish */
+  g_assert (g_hash_table_size (priv->lookups) == 0);
+  g_hash_table_destroy (priv->lookups);
+
+  g_clear_handle_id (&priv->secrets_timeout_id, g_source_remove);
+  g_hash_table_destroy (priv->secrets);
+
   G_OBJECT_CLASS (shell_network_agent_parent_class)->finalize (object);
 }
 
@@ -231,45 +355,49 @@ is_connection_always_ask (NMConnection *connection)
   return FALSE;
 }
 
-static void
-get_secrets_keyring_cb (GObject            *source,
-                        GAsyncResult       *result,
-                        gpointer            user_data)
+static gboolean
+items_have_secrets (GList *items)
 {
-  ShellAgentRequest *closure;
-  ShellNetworkAgent *self;
-  ShellNetworkAgentPrivate *priv;
-  GError *secret_error = NULL;
-  GError *error = NULL;
-  GList *items;
   GList *l;
-  gboolean secrets_found = FALSE;
-  GVariantBuilder builder_setting, builder_connection;
-  g_autoptr (GVariant) setting = NULL;
 
-  items = secret_service_search_finish (NULL, result, &secret_error);
-
-  if (g_error_matches (secret_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+  for (l = items; l; l = g_list_next (l))
     {
-      g_error_free (secret_error);
-      return;
+      SecretValue *secret = secret_item_get_secret (l->data);
+
+      if (secret != NULL)
+        {
+          secret_value_unref (secret);
+          return TRUE;
+        }
     }
 
-  closure = user_data;
-  self = closure->self;
-  priv  = self->priv;
+  return FALSE;
+}
 
-  if (secret_error != NULL)
-    {
-      g_set_error (&error,
-                   NM_SECRET_AGENT_ERROR,
-                   NM_SECRET_AGENT_ERROR_FAILED,
-                   "Internal error while retrieving secrets from the keyring (%s)", secret_error->message);
-      g_error_free (secret_error);
-      closure->callback (NM_SECRET_AGENT_OLD (closure->self), closure->connection, NULL, error, closure->callback_data);
+static void
+return_keyring_error (ShellAgentRequest *closure,
+                      GError            *secret_error)
+{
+  GError *error = NULL;
 
-      goto out;
-    }
+  g_set_error (&error,
+               NM_SECRET_AGENT_ERROR,
+               NM_SECRET_AGENT_ERROR_FAILED,
+               "Internal error while retrieving secrets from the keyring (%s)", secret_error->message);
+  closure->callback (NM_SECRET_AGENT_OLD (closure->self), closure->connection, NULL, error, closure->callback_data);
+
+  g_hash_table_remove (closure->self->priv->requests, closure->request_id);
+  g_clear_error (&error);
+}
+
+static void
+return_keyring_secrets (ShellAgentRequest *closure,
+                        GList             *items)
+{
+  GList *l;
+  gboolean secrets_found = FALSE;
+  GVariantBuilder builder_setting, builder_connection;
+  g_autoptr (GVariant) setting = NULL;
 
   g_variant_builder_init (&builder_setting, NM_VARIANT_TYPE_SETTING);
 
@@ -304,7 +432,6 @@ get_secrets_keyring_cb (GObject            *source,
       secret_value_unref (secret);
     }
 
-  g_list_free_full (items, g_object_unref);
   setting = g_variant_ref_sink (g_variant_builder_end (&builder_setting));
 
   /* All VPN requests get sent to the VPN's auth dialog, since it knows better
@@ -332,9 +459,47 @@ get_secrets_keyring_cb (GObject            *source,
                      g_variant_builder_end (&builder_connection), NULL,
                      closure->callback_data);
 
- out:
-  g_hash_table_remove (priv->requests, closure->request_id);
-  g_clear_error (&error);
+  g_hash_table_remove (closure->self->priv->requests, closure->request_id);
+}
+
+static void
+get_secrets_keyring_cb (GObject            *source,
+                        GAsyncResult       *result,
+                        gpointer            user_data)
+{
+  SecretLookup *lookup = user_data;
+  ShellNetworkAgent *self = lookup->self;
+  GError *secret_error = NULL;
+  GList *items;
+  GList *requests;
+  GList *l;
+
+  items = secret_service_search_finish (NULL, result, &secret_error);
+
+  if (g_hash_table_lookup (self->priv->lookups, lookup->key) == lookup)
+    g_hash_table_remove (self->priv->lookups, lookup->key);
+
+  /* Only keep what would spare the next requests asking again */
+  if (secret_error == NULL && items_have_secrets (items))
+    cache_secrets (self, lookup->key, items);
+
+  requests = g_list_reverse (g_steal_pointer (&lookup->requests));
+  for (l = requests; l; l = g_list_next (l))
+    ((ShellAgentRequest *) l->data)->lookup = NULL;
+
+  for (l = requests; l; l = g_list_next (l))
+    {
+      if (secret_error != NULL)
+        return_keyring_error (l->data, secret_error);
+      else
+        return_keyring_secrets (l->data, items);
+    }
+
+  g_list_free (requests);
+  g_list_free_full (items, g_object_unref);
+  g_clear_error (&secret_error);
+
+  secret_lookup_free (lookup);
 }
 
 static void
@@ -348,9 +513,13 @@ shell_network_agent_get_secrets (NMSecretAgentOld                 *agent,
 				 gpointer                          callback_data)
 {
   ShellNetworkAgent *self = SHELL_NETWORK_AGENT (agent);
+  ShellNetworkAgentPrivate *priv = self->priv;
   ShellAgentRequest *request;
+  SecretLookup *lookup;
   GHashTable *attributes;
+  GList *items;
   char *request_id;
+  char *key;
 
   request_id = g_strdup_printf ("%s/%s", connection_path, setting_name);
   if ((request = g_hash_table_lookup (self->priv->requests, request_id)) != NULL)
@@ -364,7 +533,6 @@ shell_network_agent_get_secrets (NMSecretAgentOld                 *agent,
 
   request = g_new0 (ShellAgentRequest, 1);
   request->self = g_object_ref (self);
-  request->cancellable = g_cancellable_new ();
   request->connection = g_object_ref (connection);
   request->setting_name = g_strdup (setting_name);
   request->hints = g_strdupv ((gchar **)hints);
@@ -377,15 +545,48 @@ shell_network_agent_get_secrets (NMSecretAgentOld                 *agent,
 
   g_variant_builder_init (&request->builder_vpn, G_VARIANT_TYPE ("a{ss}"));
 
+  key = get_secrets_key (connection, setting_name);
+
+  /* The secrets that were found didn't do */
+  if (flags & NM_SECRET_AGENT_GET_SECRETS_FLAG_REQUEST_NEW)
+    g_hash_table_remove (priv->secrets, key);
+
   if ((flags & NM_SECRET_AGENT_GET_SECRETS_FLAG_REQUEST_NEW) ||
       ((flags & NM_SECRET_AGENT_GET_SECRETS_FLAG_ALLOW_INTERACTION)
        && is_connection_always_ask (request->connection)))
     {
       request->entries = g_variant_dict_new (NULL);
       request_secrets_from_ui (request);
+      g_free (key);
+      return;
+    }
+
+  items = g_hash_table_lookup (priv->secrets, key);
+  if (items != NULL)
+    {
+      return_keyring_secrets (request, items);
+      g_free (key);
+      return;
+    }
+
+  /* Requests for the same secrets wait for the same search */
+  lookup = g_hash_table_lookup (priv->lookups, key);
+  if (lookup != NULL && !g_cancellable_is_cancelled (lookup->cancellable))
+    {
+      lookup->requests = g_list_prepend (lookup->requests, request);
+      request->lookup = lookup;
+      g_free (key);
       return;
     }
 
+  lookup = g_new0 (SecretLookup, 1);
+  lookup->self = g_object_ref (self);
+  lookup->key = key;
+  lookup->cancellable = g_cancellable_new ();
+  lookup->requests = g_list_prepend (NULL, request);
+  request->lookup = lookup;
+  g_hash_table_replace (priv->lookups, lookup->key, lookup);
+
   attributes = secret_attributes_build (&network_agent_schema,
                                         SHELL_KEYRING_UUID_TAG, nm_connection_get_uuid (connection),
                                         SHELL_KEYRING_SN_TAG, setting_name,
@@ -393,7 +594,7 @@ shell_network_agent_get_secrets (NMSecretAgentOld                 *agent,
 
   secret_service_search (NULL, &network_agent_schema, attributes,
                          SECRET_SEARCH_ALL | SECRET_SEARCH_UNLOCK | SECRET_SEARCH_LOAD_SECRETS,
-                         request->cancellable, get_secrets_keyring_cb, request);
+                         lookup->cancellable, get_secrets_keyring_cb, lookup);
 
   g_hash_table_unref (attributes);
 }
@@ -853,6 +1054,8 @@ shell_network_agent_delete_secrets (NMSecretAgentOld                  *agent,
   uuid = nm_setting_connection_get_uuid (s_con);
   g_assert (uuid);
 
+  uncache_connection_secrets (SHELL_NETWORK_AGENT (agent), uuid);
+
   secret_password_clear (&network_agent_schema, NULL, delete_items_cb, r,
                          SHELL_KEYRING_UUID_TAG, uuid,
                          NULL);
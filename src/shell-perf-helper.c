@@ -13,6 +13,10 @@
 
 #include <gtk/gtk.h>
 
+#ifdef GDK_WINDOWING_WAYLAND
+#include <gdk/wayland/gdkwayland.h>
+#endif
+
 #define BUS_NAME "org.gnome.Shell.PerfHelper"
 
 static const gchar introspection_xml[] =
@@ -27,6 +31,9 @@ static const gchar introspection_xml[] =
 	  "      <arg type='b' name='redraws' direction='in'/>"
 	  "      <arg type='b' name='text_input' direction='in'/>"
 	  "    </method>"
+	  "    <method name='CreateWindows'>"
+	  "      <arg type='a(iia{sv})' name='windows' direction='in'/>"
+	  "    </method>"
 	  "    <method name='WaitWindows'/>"
 	  "    <method name='DestroyWindows'/>"
 	  "  </interface>"
@@ -63,6 +70,8 @@ G_DECLARE_FINAL_TYPE (PerfHelperWindow, perf_helper_window, PERF_HELPER, WINDOW,
 struct _PerfHelperWindow {
   GtkApplicationWindow parent;
 
+  char *app_id;
+
   guint mapped : 1;
   guint exposed : 1;
   guint pending : 1;
@@ -73,10 +82,17 @@ G_DEFINE_TYPE (PerfHelperWindow, perf_helper_window, GTK_TYPE_APPLICATION_WINDOW
 #define PERF_HELPER_TYPE_WINDOW_CONTENT (perf_helper_window_content_get_type ())
 G_DECLARE_FINAL_TYPE (PerfHelperWindowContent, perf_helper_window_content, PERF_HELPER, WINDOW_CONTENT, GtkWidget)
 
+typedef enum {
+  PERF_HELPER_DAMAGE_NONE,
+  PERF_HELPER_DAMAGE_LINES,
+  PERF_HELPER_DAMAGE_FULL,
+  PERF_HELPER_DAMAGE_PARTIAL,
+} PerfHelperDamage;
+
 struct _PerfHelperWindowContent {
   GtkWidget parent;
 
-  guint redraws : 1;
+  PerfHelperDamage damage;
 
   gint64 start_time;
   gint64 time;
@@ -142,6 +158,15 @@ perf_helper_window_realize (GtkWidget *widget)
   g_signal_connect_object (surface,
                            "notify::mapped", G_CALLBACK (on_surface_mapped),
                            widget, G_CONNECT_DEFAULT);
+
+#if defined (GDK_WINDOWING_WAYLAND) && GTK_CHECK_VERSION (4,10,0)
+  /* Lets tests group windows into several apps; on X11 all windows
+   * share the WM_CLASS of the helper.
+   */
+  if (PERF_HELPER_WINDOW (widget)->app_id && GDK_IS_WAYLAND_TOPLEVEL (surface))
+    gdk_wayland_toplevel_set_application_id (GDK_TOPLEVEL (surface),
+                                             PERF_HELPER_WINDOW (widget)->app_id);
+#endif
 }
 
 static void
@@ -163,6 +188,7 @@ perf_helper_window_snapshot (GtkWidget   *widget,
 
 #define LINE_WIDTH 10
 #define MARGIN 40
+#define DAMAGE_SIZE 32
 
 static void
 perf_helper_window_content_snapshot (GtkWidget   *widget,
@@ -172,7 +198,7 @@ perf_helper_window_content_snapshot (GtkWidget   *widget,
   GdkRGBA line_color;
   graphene_rect_t bounds;
   int width, height;
-  double x_offset, y_offset;
+  double position, x_offset, y_offset;
 
   GTK_WIDGET_CLASS (perf_helper_window_content_parent_class)->snapshot (widget, snapshot);
 
@@ -185,9 +211,10 @@ perf_helper_window_content_snapshot (GtkWidget   *widget,
    * is drastrically wrong.
    */
 
-  if (content->redraws)
+  position = (content->time - content->start_time) / 1000000.;
+
+  if (content->damage == PERF_HELPER_DAMAGE_LINES)
     {
-      double position = (content->time - content->start_time) / 1000000.;
       x_offset = 20 * cos (2 * M_PI * position);
       y_offset = 20 * sin (2 * M_PI * position);
     }
@@ -196,6 +223,27 @@ perf_helper_window_content_snapshot (GtkWidget   *widget,
       x_offset = y_offset = 0;
     }
 
+  /* With full damage the whole window changes color every frame, while
+   * with partial damage only a small square moves around, so that the
+   * compositor can limit the repaint to a small region.
+   */
+  if (content->damage == PERF_HELPER_DAMAGE_FULL)
+    {
+      GdkRGBA fill_color = { 0.5 + 0.5 * sin (2 * M_PI * position), 0.5, 0.5, 1.0 };
+
+      graphene_rect_init (&bounds, 0, 0, width, height);
+      gtk_snapshot_append_color (snapshot, &fill_color, &bounds);
+    }
+  else if (content->damage == PERF_HELPER_DAMAGE_PARTIAL)
+    {
+      GdkRGBA square_color = { 0.0, 0.0, 1.0, 1.0 };
+      double square_x = (width - DAMAGE_SIZE) * (0.5 + 0.5 * cos (2 * M_PI * position));
+      double square_y = (height - DAMAGE_SIZE) * (0.5 + 0.5 * sin (2 * M_PI * position));
+
+      graphene_rect_init (&bounds, square_x, square_y, DAMAGE_SIZE, DAMAGE_SIZE);
+      gtk_snapshot_append_color (snapshot, &square_color, &bounds);
+    }
+
   graphene_rect_init (&bounds, MARGIN + x_offset, 0, LINE_WIDTH, height);
   gtk_snapshot_append_color (snapshot, &line_color, &bounds);
 
@@ -227,30 +275,32 @@ tick_callback (GtkWidget     *widget,
 }
 
 static GtkWidget *
-perf_helper_window_content_new (gboolean redraws) {
+perf_helper_window_content_new (PerfHelperDamage damage) {
   PerfHelperWindowContent *content;
   GtkWidget *widget;
 
   content = g_object_new (PERF_HELPER_TYPE_WINDOW_CONTENT, NULL);
 
-  content->redraws = redraws;
+  content->damage = damage;
 
   widget = GTK_WIDGET (content);
 
-  if (redraws)
+  if (damage != PERF_HELPER_DAMAGE_NONE)
     gtk_widget_add_tick_callback (widget, tick_callback, content, NULL);
 
   return widget;
 }
 
 static void
-create_window (PerfHelperApp *app,
-               int            width,
-               int            height,
-               gboolean       alpha,
-               gboolean       maximized,
-               gboolean       redraws,
-               gboolean       text_input)
+create_window (PerfHelperApp    *app,
+               int               width,
+               int               height,
+               gboolean          alpha,
+               gboolean          maximized,
+               PerfHelperDamage  damage,
+               gboolean          text_input,
+               const char       *app_id,
+               const char       *title)
 {
   PerfHelperWindow *window;
   GtkWidget *child;
@@ -258,6 +308,10 @@ create_window (PerfHelperApp *app,
   window = g_object_new (PERF_HELPER_TYPE_WINDOW,
                          "application", app,
                          NULL);
+  window->app_id = g_strdup (app_id);
+
+  if (title)
+    gtk_window_set_title (GTK_WINDOW (window), title);
 
   if (maximized)
     gtk_window_maximize (GTK_WINDOW (window));
@@ -269,7 +323,7 @@ create_window (PerfHelperApp *app,
   else
     {
       gtk_widget_add_css_class(GTK_WIDGET (window), alpha ? "alpha" : "solid");
-      child = perf_helper_window_content_new (redraws);
+      child = perf_helper_window_content_new (damage);
     }
 
   gtk_window_set_child (GTK_WINDOW (window), child);
@@ -278,6 +332,53 @@ create_window (PerfHelperApp *app,
   gtk_window_present (GTK_WINDOW (window));
 }
 
+static PerfHelperDamage
+parse_damage (const char *damage)
+{
+  if (g_strcmp0 (damage, "lines") == 0)
+    return PERF_HELPER_DAMAGE_LINES;
+  else if (g_strcmp0 (damage, "full") == 0)
+    return PERF_HELPER_DAMAGE_FULL;
+  else if (g_strcmp0 (damage, "partial") == 0)
+    return PERF_HELPER_DAMAGE_PARTIAL;
+  else
+    return PERF_HELPER_DAMAGE_NONE;
+}
+
+static void
+create_windows (PerfHelperApp *app,
+                GVariant      *windows)
+{
+  GVariantIter iter;
+  GVariant *options;
+  int width, height;
+
+  g_variant_iter_init (&iter, windows);
+  while (g_variant_iter_next (&iter, "(ii@a{sv})", &width, &height, &options))
+    {
+      gboolean alpha = FALSE, maximized = FALSE, redraws = FALSE, text_input = FALSE;
+      const char *damage = NULL, *app_id = NULL, *title = NULL;
+      PerfHelperDamage window_damage;
+
+      g_variant_lookup (options, "alpha", "b", &alpha);
+      g_variant_lookup (options, "maximized", "b", &maximized);
+      g_variant_lookup (options, "redraws", "b", &redraws);
+      g_variant_lookup (options, "text-input", "b", &text_input);
+      g_variant_lookup (options, "damage", "&s", &damage);
+      g_variant_lookup (options, "app-id", "&s", &app_id);
+      g_variant_lookup (options, "title", "&s", &title);
+
+      window_damage = parse_damage (damage);
+      if (window_damage == PERF_HELPER_DAMAGE_NONE && redraws)
+        window_damage = PERF_HELPER_DAMAGE_LINES;
+
+      create_window (app, width, height, alpha, maximized,
+                     window_damage, text_input, app_id, title);
+
+      g_variant_unref (options);
+    }
+}
+
 static void
 finish_wait_windows (PerfHelperApp *app)
 {
@@ -339,7 +440,18 @@ handle_method_call (GDBusConnection       *connection,
                      &width, &height,
                      &alpha, &maximized, &redraws, &text_input);
 
-      create_window (app, width, height, alpha, maximized, redraws, text_input);
+      create_window (app, width, height, alpha, maximized,
+                     redraws ? PERF_HELPER_DAMAGE_LINES : PERF_HELPER_DAMAGE_NONE,
+                     text_input, NULL, NULL);
+      g_dbus_method_invocation_return_value (invocation, NULL);
+    }
+  else if (g_strcmp0 (method_name, "CreateWindows") == 0)
+    {
+      g_autoptr (GVariant) windows = NULL;
+
+      g_variant_get (parameters, "(@a(iia{sv}))", &windows);
+
+      create_windows (app, windows);
       g_dbus_method_invocation_return_value (invocation, NULL);
     }
   else if (g_strcmp0 (method_name, "WaitWindows") == 0)
@@ -449,11 +561,24 @@ perf_helper_window_init (PerfHelperWindow *window)
   window->pending = TRUE;
 }
 
+static void
+perf_helper_window_finalize (GObject *object)
+{
+  PerfHelperWindow *window = PERF_HELPER_WINDOW (object);
+
+  g_free (window->app_id);
+
+  G_OBJECT_CLASS (perf_helper_window_parent_class)->finalize (object);
+}
+
 static void
 perf_helper_window_class_init (PerfHelperWindowClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
+  object_class->finalize = perf_helper_window_finalize;
+
   widget_class->realize = perf_helper_window_realize;
   widget_class->snapshot = perf_helper_window_snapshot;
 }
@@ -3,6 +3,7 @@
 #include "config.h"
 
 #include <string.h>
+#include <unistd.h>
 
 #include "shell-perf-log.h"
 
@@ -11,6 +12,8 @@ typedef struct _ShellPerfStatistic ShellPerfStatistic;
 typedef struct _ShellPerfStatisticsClosure ShellPerfStatisticsClosure;
 typedef union  _ShellPerfStatisticValue ShellPerfStatisticValue;
 typedef struct _ShellPerfBlock ShellPerfBlock;
+typedef struct _ShellPerfThreadLog ShellPerfThreadLog;
+typedef struct _ShellPerfHistogram ShellPerfHistogram;
 
 /**
  * SECTION:shell-perf-log
@@ -31,11 +34,18 @@ typedef struct _ShellPerfBlock ShellPerfBlock;
  * Arguments are identified by a D-Bus style signature; at the moment
  * only a limited number of event signatures are supported to
  * simplify the code.
+ *
+ * Events can be recorded from any thread; each thread appends to a log
+ * of its own without taking locks, and the logs are merged by time on
+ * replay. Statistics are only meant to be updated from the main thread.
  */
 struct _ShellPerfLog
 {
   GObject parent;
 
+  /* Protects the event and statistic definitions, which other threads
+   * look up while recording */
+  GRWLock events_lock;
   GPtrArray *events;
   GHashTable *events_by_name;
   GPtrArray *statistics;
@@ -43,10 +53,13 @@ struct _ShellPerfLog
 
   GPtrArray *statistics_closures;
 
-  GQueue *blocks;
+  GPtrArray *histograms;
+  GHashTable *histograms_by_name;
+
+  GMutex thread_logs_lock;
+  GPtrArray *thread_logs;
 
   gint64 start_time;
-  gint64 last_time;
 
   guint statistics_timeout_id;
 
@@ -78,6 +91,29 @@ struct _ShellPerfStatistic
   guint recorded : 1;
 };
 
+/* Histograms count values in buckets that are linear below
+ * 2^HISTOGRAM_SUB_BITS and split every further power of two into
+ * 2^HISTOGRAM_SUB_BITS buckets, so any value is known to within about
+ * 6% from a fixed, small number of buckets. */
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_N_BUCKETS ((63 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+struct _ShellPerfHistogram
+{
+  char *name;
+
+  /* Counted atomically, other threads may add values */
+  guint32 counts[HISTOGRAM_N_BUCKETS];
+  /* The counts at the previous statistics collection */
+  guint32 collected_counts[HISTOGRAM_N_BUCKETS];
+
+  char *count_name;
+  char *p50_name;
+  char *p90_name;
+  char *p99_name;
+};
+
 struct _ShellPerfStatisticsClosure
 {
   ShellPerfStatisticsCallback callback;
@@ -100,10 +136,23 @@ struct _ShellPerfStatisticsClosure
 
 struct _ShellPerfBlock
 {
+  /* Both are written by the recording thread and read atomically by
+   * the replaying one; once @next is set, the block is complete */
+  ShellPerfBlock *next;
   guint32 bytes;
   guchar buffer[BLOCK_SIZE];
 };
 
+/* The events recorded by one thread. Only that thread appends to it;
+ * a log outlives its thread, since its events are still replayed. */
+struct _ShellPerfThreadLog
+{
+  ShellPerfBlock *head;
+  ShellPerfBlock *tail;
+
+  gint64 last_time;
+};
+
 /* Number of milliseconds between periodic statistics collection when
  * events are enabled. Statistics collection can also be explicitly
  * triggered.
@@ -127,12 +176,16 @@ get_time (void)
 static void
 shell_perf_log_init (ShellPerfLog *perf_log)
 {
+  g_rw_lock_init (&perf_log->events_lock);
   perf_log->events = g_ptr_array_new ();
   perf_log->events_by_name = g_hash_table_new (g_str_hash, g_str_equal);
   perf_log->statistics = g_ptr_array_new ();
   perf_log->statistics_by_name = g_hash_table_new (g_str_hash, g_str_equal);
   perf_log->statistics_closures = g_ptr_array_new ();
-  perf_log->blocks = g_queue_new ();
+  perf_log->histograms = g_ptr_array_new ();
+  perf_log->histograms_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+  g_mutex_init (&perf_log->thread_logs_lock);
+  perf_log->thread_logs = g_ptr_array_new ();
 
   /* This event is used when timestamp deltas are greater than
    * fits in a gint32. 0xffffffff microseconds is about 70 minutes, so this
@@ -155,7 +208,7 @@ shell_perf_log_init (ShellPerfLog *perf_log)
                                "x");
   g_assert (perf_log->events->len == EVENT_STATISTICS_COLLECTED + 1);
 
-  perf_log->start_time = perf_log->last_time = get_time();
+  perf_log->start_time = get_time();
 }
 
 static void
@@ -229,7 +282,9 @@ define_event (ShellPerfLog *perf_log,
               const char   *description,
               const char   *signature)
 {
-  ShellPerfEvent *event;
+  ShellPerfEvent *event = NULL;
+
+  g_rw_lock_writer_lock (&perf_log->events_lock);
 
   if (strcmp (signature, "") != 0 &&
       strcmp (signature, "s") != 0 &&
@@ -237,26 +292,26 @@ define_event (ShellPerfLog *perf_log,
       strcmp (signature, "x") != 0)
     {
       g_warning ("Only supported event signatures are '', 's', 'i', and 'x'\n");
-      return NULL;
+      goto out;
     }
 
   if (perf_log->events->len == 65536)
     {
       g_warning ("Maximum number of events defined\n");
-      return NULL;
+      goto out;
     }
 
   /* We could do stricter validation, but this will break our JSON dumps */
   if (strchr (name, '"') != NULL)
     {
       g_warning ("Event names can't include '\"'");
-      return NULL;
+      goto out;
     }
 
   if (g_hash_table_lookup (perf_log->events_by_name, name) != NULL)
     {
       g_warning ("Duplicate event event for '%s'\n", name);
-      return NULL;
+      goto out;
     }
 
   event = g_new (ShellPerfEvent, 1);
@@ -269,6 +324,9 @@ define_event (ShellPerfLog *perf_log,
   g_ptr_array_add (perf_log->events, event);
   g_hash_table_insert (perf_log->events_by_name, event->name, event);
 
+out:
+  g_rw_lock_writer_unlock (&perf_log->events_lock);
+
   return event;
 }
 
@@ -297,12 +355,30 @@ shell_perf_log_define_event (ShellPerfLog *perf_log,
   define_event (perf_log, name, description, signature);
 }
 
+/* Events are never freed, so they can be used after dropping the lock */
+static ShellPerfEvent *
+get_event (ShellPerfLog *perf_log,
+           guint16       id)
+{
+  ShellPerfEvent *event;
+
+  g_rw_lock_reader_lock (&perf_log->events_lock);
+  event = g_ptr_array_index (perf_log->events, id);
+  g_rw_lock_reader_unlock (&perf_log->events_lock);
+
+  return event;
+}
+
 static ShellPerfEvent *
 lookup_event (ShellPerfLog *perf_log,
               const char   *name,
               const char   *signature)
 {
-  ShellPerfEvent *event = g_hash_table_lookup (perf_log->events_by_name, name);
+  ShellPerfEvent *event;
+
+  g_rw_lock_reader_lock (&perf_log->events_lock);
+  event = g_hash_table_lookup (perf_log->events_by_name, name);
+  g_rw_lock_reader_unlock (&perf_log->events_lock);
 
   if (G_UNLIKELY (event == NULL))
     {
@@ -320,6 +396,28 @@ lookup_event (ShellPerfLog *perf_log,
   return event;
 }
 
+static ShellPerfThreadLog *
+get_thread_log (ShellPerfLog *perf_log)
+{
+  static GPrivate thread_log_key = G_PRIVATE_INIT (NULL);
+  ShellPerfThreadLog *thread_log;
+
+  thread_log = g_private_get (&thread_log_key);
+  if (G_LIKELY (thread_log != NULL))
+    return thread_log;
+
+  thread_log = g_new0 (ShellPerfThreadLog, 1);
+  thread_log->last_time = perf_log->start_time;
+
+  g_mutex_lock (&perf_log->thread_logs_lock);
+  g_ptr_array_add (perf_log->thread_logs, thread_log);
+  g_mutex_unlock (&perf_log->thread_logs_lock);
+
+  g_private_set (&thread_log_key, thread_log);
+
+  return thread_log;
+}
+
 static void
 record_event (ShellPerfLog   *perf_log,
               gint64          event_time,
@@ -327,6 +425,7 @@ record_event (ShellPerfLog   *perf_log,
               const guchar   *bytes,
               size_t          bytes_len)
 {
+  ShellPerfThreadLog *thread_log;
   ShellPerfBlock *block;
   size_t total_bytes;
   guint32 time_delta;
@@ -342,31 +441,38 @@ record_event (ShellPerfLog   *perf_log,
       return;
     }
 
-  if (event_time > perf_log->last_time + G_GINT64_CONSTANT(0xffffffff))
+  thread_log = get_thread_log (perf_log);
+
+  if (event_time > thread_log->last_time + G_GINT64_CONSTANT(0xffffffff))
     {
-      perf_log->last_time = event_time;
+      thread_log->last_time = event_time;
       record_event (perf_log, event_time,
-                    lookup_event (perf_log, "perf.setTime", "x"),
+                    get_event (perf_log, EVENT_SET_TIME),
                     (const guchar *)&event_time, sizeof(gint64));
       time_delta = 0;
     }
-  else if (event_time < perf_log->last_time)
+  else if (event_time < thread_log->last_time)
     time_delta = 0;
   else
-    time_delta = (guint32)(event_time - perf_log->last_time);
+    time_delta = (guint32)(event_time - thread_log->last_time);
 
-  perf_log->last_time = event_time;
+  thread_log->last_time = event_time;
 
-  if (perf_log->blocks->tail == NULL ||
-      total_bytes + ((ShellPerfBlock *)perf_log->blocks->tail->data)->bytes > BLOCK_SIZE)
+  block = thread_log->tail;
+  if (block == NULL || total_bytes + block->bytes > BLOCK_SIZE)
     {
-      block = g_new (ShellPerfBlock, 1);
-      block->bytes = 0;
-      g_queue_push_tail (perf_log->blocks, block);
-    }
-  else
-    {
-      block = (ShellPerfBlock *)perf_log->blocks->tail->data;
+      ShellPerfBlock *new_block;
+
+      new_block = g_new (ShellPerfBlock, 1);
+      new_block->next = NULL;
+      new_block->bytes = 0;
+
+      if (block != NULL)
+        g_atomic_pointer_set (&block->next, new_block);
+      else
+        g_atomic_pointer_set (&thread_log->head, new_block);
+
+      thread_log->tail = block = new_block;
     }
 
   pos = block->bytes;
@@ -378,7 +484,8 @@ record_event (ShellPerfLog   *perf_log,
   memcpy (block->buffer + pos, bytes, bytes_len);
   pos += bytes_len;
 
-  block->bytes = pos;
+  /* Publish the event to replay */
+  g_atomic_int_set (&block->bytes, pos);
 }
 
 /**
@@ -580,12 +687,252 @@ shell_perf_log_update_statistic_x (ShellPerfLog *perf_log,
   statistic->initialized = TRUE;
 }
 
+static guint
+histogram_bucket_for_value (gint64 value)
+{
+  int exponent;
+
+  if (value < HISTOGRAM_SUB_BUCKETS)
+    return MAX (value, 0);
+
+  exponent = g_bit_storage (value) - 1;
+
+  return (exponent - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS +
+         ((value >> (exponent - HISTOGRAM_SUB_BITS)) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+/* The middle of the range of values a bucket counts */
+static gint64
+histogram_bucket_value (guint bucket)
+{
+  int shift;
+
+  if (bucket < HISTOGRAM_SUB_BUCKETS)
+    return bucket;
+
+  shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+
+  return ((gint64)(HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) << shift) +
+         (((gint64) 1 << shift) >> 1);
+}
+
+static gint64
+histogram_percentile (const guint32 *counts,
+                      guint64        total,
+                      double         percentile)
+{
+  guint64 target, seen = 0;
+  double exact;
+  guint i;
+
+  if (total == 0)
+    return 0;
+
+  exact = total * CLAMP (percentile, 0.0, 100.0) / 100.0;
+  target = (guint64) exact;
+  if (target < exact || target == 0)
+    target++;
+
+  for (i = 0; i < HISTOGRAM_N_BUCKETS; i++)
+    {
+      seen += counts[i];
+      if (seen >= target)
+        return histogram_bucket_value (i);
+    }
+
+  return histogram_bucket_value (HISTOGRAM_N_BUCKETS - 1);
+}
+
+/**
+ * shell_perf_log_define_histogram:
+ * @perf_log: a #ShellPerfLog
+ * @name: name of the histogram. This should follow the same guidelines
+ *  as for shell_perf_log_define_event()
+ * @description: human readable description of the histogram
+ *
+ * Defines a histogram, which counts how often values, like the latency
+ * of some operation, occur. Values are added with
+ * shell_perf_log_update_histogram(), from any thread.
+ *
+ * Whenever statistics are collected, the number of values added since
+ * the previous collection and their 50th, 90th and 99th percentile are
+ * recorded as the 64-bit statistics @name.count, @name.p50, @name.p90
+ * and @name.p99.
+ */
+void
+shell_perf_log_define_histogram (ShellPerfLog *perf_log,
+                                 const char   *name,
+                                 const char   *description)
+{
+  ShellPerfHistogram *histogram;
+
+  if (g_hash_table_lookup (perf_log->histograms_by_name, name) != NULL)
+    {
+      g_warning ("Duplicate histogram '%s'\n", name);
+      return;
+    }
+
+  histogram = g_new0 (ShellPerfHistogram, 1);
+  histogram->name = g_strdup (name);
+  histogram->count_name = g_strconcat (name, ".count", NULL);
+  histogram->p50_name = g_strconcat (name, ".p50", NULL);
+  histogram->p90_name = g_strconcat (name, ".p90", NULL);
+  histogram->p99_name = g_strconcat (name, ".p99", NULL);
+
+  shell_perf_log_define_statistic (perf_log, histogram->count_name, description, "x");
+  shell_perf_log_define_statistic (perf_log, histogram->p50_name, description, "x");
+  shell_perf_log_define_statistic (perf_log, histogram->p90_name, description, "x");
+  shell_perf_log_define_statistic (perf_log, histogram->p99_name, description, "x");
+
+  g_rw_lock_writer_lock (&perf_log->events_lock);
+  g_ptr_array_add (perf_log->histograms, histogram);
+  g_hash_table_insert (perf_log->histograms_by_name, histogram->name, histogram);
+  g_rw_lock_writer_unlock (&perf_log->events_lock);
+}
+
+static ShellPerfHistogram *
+lookup_histogram (ShellPerfLog *perf_log,
+                  const char   *name)
+{
+  ShellPerfHistogram *histogram;
+
+  g_rw_lock_reader_lock (&perf_log->events_lock);
+  histogram = g_hash_table_lookup (perf_log->histograms_by_name, name);
+  g_rw_lock_reader_unlock (&perf_log->events_lock);
+
+  if (G_UNLIKELY (histogram == NULL))
+    g_warning ("Unknown histogram '%s'\n", name);
+
+  return histogram;
+}
+
+/**
+ * shell_perf_log_update_histogram:
+ * @perf_log: a #ShellPerfLog
+ * @name: name of the histogram
+ * @value: the value to add, negative values count as 0
+ *
+ * Adds a value to a histogram. Unlike other statistics, histograms can
+ * be updated from any thread.
+ */
+void
+shell_perf_log_update_histogram (ShellPerfLog *perf_log,
+                                 const char   *name,
+                                 gint64        value)
+{
+  ShellPerfHistogram *histogram;
+
+  if (!perf_log->enabled)
+    return;
+
+  histogram = lookup_histogram (perf_log, name);
+  if (G_UNLIKELY (histogram == NULL))
+    return;
+
+  g_atomic_int_inc (&histogram->counts[histogram_bucket_for_value (value)]);
+}
+
+/**
+ * shell_perf_log_get_histogram_percentile:
+ * @perf_log: a #ShellPerfLog
+ * @name: name of the histogram
+ * @percentile: the percentile to get, between 0 and 100
+ *
+ * Gets a percentile of all values added to a histogram since it was
+ * defined or last reset with shell_perf_log_reset_histogram().
+ *
+ * Return value: the value below which @percentile percent of the values
+ *   fall, or 0 if there are none
+ */
+gint64
+shell_perf_log_get_histogram_percentile (ShellPerfLog *perf_log,
+                                         const char   *name,
+                                         double        percentile)
+{
+  ShellPerfHistogram *histogram;
+  guint32 counts[HISTOGRAM_N_BUCKETS];
+  guint64 total = 0;
+  guint i;
+
+  histogram = lookup_histogram (perf_log, name);
+  if (G_UNLIKELY (histogram == NULL))
+    return 0;
+
+  for (i = 0; i < HISTOGRAM_N_BUCKETS; i++)
+    {
+      counts[i] = g_atomic_int_get (&histogram->counts[i]);
+      total += counts[i];
+    }
+
+  return histogram_percentile (counts, total, percentile);
+}
+
+/**
+ * shell_perf_log_reset_histogram:
+ * @perf_log: a #ShellPerfLog
+ * @name: name of the histogram
+ *
+ * Forgets about all values added to a histogram so far. Values that
+ * other threads add at the same time may or may not survive.
+ */
+void
+shell_perf_log_reset_histogram (ShellPerfLog *perf_log,
+                                const char   *name)
+{
+  ShellPerfHistogram *histogram;
+  guint i;
+
+  histogram = lookup_histogram (perf_log, name);
+  if (G_UNLIKELY (histogram == NULL))
+    return;
+
+  for (i = 0; i < HISTOGRAM_N_BUCKETS; i++)
+    {
+      g_atomic_int_set (&histogram->counts[i], 0);
+      histogram->collected_counts[i] = 0;
+    }
+}
+
+/* Turns what was added to a histogram since the previous collection into
+ * its statistics */
+static void
+collect_histogram (ShellPerfLog       *perf_log,
+                   ShellPerfHistogram *histogram)
+{
+  guint32 delta[HISTOGRAM_N_BUCKETS];
+  guint64 total = 0;
+  guint i;
+
+  for (i = 0; i < HISTOGRAM_N_BUCKETS; i++)
+    {
+      guint32 count = g_atomic_int_get (&histogram->counts[i]);
+
+      /* Counts only shrink when reset, then everything is new */
+      if (count < histogram->collected_counts[i])
+        histogram->collected_counts[i] = 0;
+
+      delta[i] = count - histogram->collected_counts[i];
+      histogram->collected_counts[i] = count;
+      total += delta[i];
+    }
+
+  shell_perf_log_update_statistic_x (perf_log, histogram->count_name, total);
+  shell_perf_log_update_statistic_x (perf_log, histogram->p50_name,
+                                     histogram_percentile (delta, total, 50));
+  shell_perf_log_update_statistic_x (perf_log, histogram->p90_name,
+                                     histogram_percentile (delta, total, 90));
+  shell_perf_log_update_statistic_x (perf_log, histogram->p99_name,
+                                     histogram_percentile (delta, total, 99));
+}
+
 /**
  * shell_perf_log_add_statistics_callback:
  * @perf_log: a #ShellPerfLog
- * @callback: function to call before recording statistics
+ * @callback: (scope notified) (closure user_data): function to call
+ *   before recording statistics
  * @user_data: data to pass to @callback
- * @notify: function to call when @user_data is no longer needed
+ * @notify: (destroy user_data): function to call when @user_data is no
+ *   longer needed
  *
  * Adds a function that will be called before statistics are recorded.
  * The function would typically compute one or more statistics values
@@ -612,8 +959,9 @@ shell_perf_log_add_statistics_callback (ShellPerfLog               *perf_log,
  * @perf_log: a #ShellPerfLog
  *
  * Calls all the update functions added with
- * shell_perf_log_add_statistics_callback() and then records events
- * for all statistics, followed by a perf.statisticsCollected event.
+ * shell_perf_log_add_statistics_callback(), updates the statistics of
+ * histograms and then records events for all statistics, followed by a
+ * perf.statisticsCollected event.
  */
 void
 shell_perf_log_collect_statistics (ShellPerfLog *perf_log)
@@ -633,6 +981,9 @@ shell_perf_log_collect_statistics (ShellPerfLog *perf_log)
       closure->callback (perf_log, closure->user_data);
     }
 
+  for (i = 0; i < perf_log->histograms->len; i++)
+    collect_histogram (perf_log, g_ptr_array_index (perf_log->histograms, i));
+
   collection_time = get_time() - event_time;
 
   for (i = 0; i < perf_log->statistics->len; i++)
@@ -673,10 +1024,99 @@ shell_perf_log_collect_statistics (ShellPerfLog *perf_log)
     }
 
   record_event (perf_log, event_time,
-                g_ptr_array_index (perf_log->events, EVENT_STATISTICS_COLLECTED),
+                get_event (perf_log, EVENT_STATISTICS_COLLECTED),
                 (const guchar *)&collection_time, sizeof (gint64));
 }
 
+typedef struct {
+  ShellPerfBlock *block;
+  guint32 pos;
+  guint32 bytes;
+
+  /* The next event of the thread log, if @valid */
+  gboolean valid;
+  gint64 event_time;
+  ShellPerfEvent *event;
+  const guchar *arg;
+} ReplayCursor;
+
+static void
+replay_cursor_init (ReplayCursor       *cursor,
+                    ShellPerfLog       *perf_log,
+                    ShellPerfThreadLog *thread_log)
+{
+  cursor->block = g_atomic_pointer_get (&thread_log->head);
+  cursor->pos = 0;
+  cursor->bytes = cursor->block ? g_atomic_int_get (&cursor->block->bytes) : 0;
+  cursor->event_time = perf_log->start_time;
+}
+
+/* Reads the next event of the cursor's log, skipping over the internal
+ * perf.setTime events */
+static void
+replay_cursor_next (ReplayCursor *cursor,
+                    ShellPerfLog *perf_log)
+{
+  cursor->valid = FALSE;
+
+  while (cursor->block != NULL)
+    {
+      ShellPerfBlock *block = cursor->block;
+      ShellPerfEvent *event;
+      guint16 id;
+      guint32 time_delta;
+
+      if (cursor->pos >= cursor->bytes)
+        {
+          ShellPerfBlock *next;
+
+          /* Once the next block exists, this one won't grow any further,
+           * so check for that before taking the final size */
+          next = g_atomic_pointer_get (&block->next);
+          cursor->bytes = g_atomic_int_get (&block->bytes);
+          if (cursor->pos < cursor->bytes)
+            continue;
+
+          if (next == NULL)
+            return;
+
+          cursor->block = next;
+          cursor->pos = 0;
+          cursor->bytes = g_atomic_int_get (&next->bytes);
+          continue;
+        }
+
+      memcpy (&time_delta, block->buffer + cursor->pos, sizeof (guint32));
+      cursor->pos += sizeof (guint32);
+      memcpy (&id, block->buffer + cursor->pos, sizeof (guint16));
+      cursor->pos += sizeof (guint16);
+
+      if (id == EVENT_SET_TIME)
+        {
+          /* Internal, we don't include in the replay */
+          memcpy (&cursor->event_time, block->buffer + cursor->pos, sizeof (gint64));
+          cursor->pos += sizeof (gint64);
+          continue;
+        }
+
+      event = get_event (perf_log, id);
+
+      cursor->event_time += time_delta;
+      cursor->event = event;
+      cursor->arg = block->buffer + cursor->pos;
+      cursor->valid = TRUE;
+
+      if (strcmp (event->signature, "i") == 0)
+        cursor->pos += sizeof (gint32);
+      else if (strcmp (event->signature, "x") == 0)
+        cursor->pos += sizeof (gint64);
+      else if (strcmp (event->signature, "s") == 0)
+        cursor->pos += strlen ((char *)cursor->arg) + 1;
+
+      return;
+    }
+}
+
 /**
  * shell_perf_log_replay:
  * @perf_log: a #ShellPerfLog
@@ -684,82 +1124,82 @@ shell_perf_log_collect_statistics (ShellPerfLog *perf_log)
  * @user_data: data to pass to @replay_function
  *
  * Replays the log by calling the given function for each event
- * in the log.
+ * in the log. Events recorded from different threads are interleaved
+ * by time. Events that another thread records while the log is
+ * replayed may or may not be included.
  */
 void
 shell_perf_log_replay (ShellPerfLog            *perf_log,
                        ShellPerfReplayFunction  replay_function,
                        gpointer                 user_data)
 {
-  gint64 event_time = perf_log->start_time;
-  GList *iter;
+  g_autofree ReplayCursor *cursors = NULL;
+  guint n_cursors, i;
+
+  g_mutex_lock (&perf_log->thread_logs_lock);
+  n_cursors = perf_log->thread_logs->len;
+  cursors = g_new0 (ReplayCursor, n_cursors);
+  for (i = 0; i < n_cursors; i++)
+    replay_cursor_init (&cursors[i], perf_log,
+                        g_ptr_array_index (perf_log->thread_logs, i));
+  g_mutex_unlock (&perf_log->thread_logs_lock);
 
-  for (iter = perf_log->blocks->head; iter; iter = iter->next)
+  for (i = 0; i < n_cursors; i++)
+    replay_cursor_next (&cursors[i], perf_log);
+
+  while (TRUE)
     {
-      ShellPerfBlock *block = iter->data;
-      guint32 pos = 0;
+      ReplayCursor *cursor = NULL;
+      ShellPerfEvent *event;
+      GValue arg = { 0, };
 
-      while (pos < block->bytes)
+      /* There are only ever a handful of threads, so a linear scan for
+       * the earliest event is cheap enough */
+      for (i = 0; i < n_cursors; i++)
         {
-          ShellPerfEvent *event;
-          guint16 id;
-          guint32 time_delta;
-          GValue arg = { 0, };
+          if (cursors[i].valid &&
+              (cursor == NULL || cursors[i].event_time < cursor->event_time))
+            cursor = &cursors[i];
+        }
 
-          memcpy (&time_delta, block->buffer + pos, sizeof (guint32));
-          pos += sizeof (guint32);
-          memcpy (&id, block->buffer + pos, sizeof (guint16));
-          pos += sizeof (guint16);
+      if (cursor == NULL)
+        break;
 
-          if (id == EVENT_SET_TIME)
-            {
-              /* Internal, we don't include in the replay */
-              memcpy (&event_time, block->buffer + pos, sizeof (gint64));
-              pos += sizeof (gint64);
-              continue;
-            }
-          else
-            {
-              event_time += time_delta;
-            }
+      event = cursor->event;
 
-          event = g_ptr_array_index (perf_log->events, id);
+      if (strcmp (event->signature, "") == 0)
+        {
+          /* We need to pass something, so pass an empty string */
+          g_value_init (&arg, G_TYPE_STRING);
+        }
+      else if (strcmp (event->signature, "i") == 0)
+        {
+          gint32 l;
 
-          if (strcmp (event->signature, "") == 0)
-            {
-              /* We need to pass something, so pass an empty string */
-              g_value_init (&arg, G_TYPE_STRING);
-            }
-          else if (strcmp (event->signature, "i") == 0)
-            {
-              gint32 l;
+          memcpy (&l, cursor->arg, sizeof (gint32));
 
-              memcpy (&l, block->buffer + pos, sizeof (gint32));
-              pos += sizeof (gint32);
+          g_value_init (&arg, G_TYPE_INT);
+          g_value_set_int (&arg, l);
+        }
+      else if (strcmp (event->signature, "x") == 0)
+        {
+          gint64 l;
 
-              g_value_init (&arg, G_TYPE_INT);
-              g_value_set_int (&arg, l);
-            }
-          else if (strcmp (event->signature, "x") == 0)
-            {
-              gint64 l;
+          memcpy (&l, cursor->arg, sizeof (gint64));
 
-              memcpy (&l, block->buffer + pos, sizeof (gint64));
-              pos += sizeof (gint64);
+          g_value_init (&arg, G_TYPE_INT64);
+          g_value_set_int64 (&arg, l);
+        }
+      else if (strcmp (event->signature, "s") == 0)
+        {
+          g_value_init (&arg, G_TYPE_STRING);
+          g_value_set_string (&arg, (char *)cursor->arg);
+        }
 
-              g_value_init (&arg, G_TYPE_INT64);
-              g_value_set_int64 (&arg, l);
-            }
-          else if (strcmp (event->signature, "s") == 0)
-            {
-              g_value_init (&arg, G_TYPE_STRING);
-              g_value_set_string (&arg, (char *)block->buffer + pos);
-              pos += strlen ((char *)(block->buffer + pos)) + 1;
-            }
+      replay_function (cursor->event_time, event->name, event->signature, &arg, user_data);
+      g_value_unset (&arg);
 
-          replay_function (event_time, event->name, event->signature, &arg, user_data);
-          g_value_unset (&arg);
-        }
+      replay_cursor_next (cursor, perf_log);
     }
 }
 
@@ -821,6 +1261,8 @@ shell_perf_log_dump_events (ShellPerfLog   *perf_log,
   output = g_string_new (NULL);
   g_string_append (output, "[ ");
 
+  g_rw_lock_reader_lock (&perf_log->events_lock);
+
   for (i = 0; i < perf_log->events->len; i++)
     {
       ShellPerfEvent *event = g_ptr_array_index (perf_log->events, i);
@@ -843,6 +1285,8 @@ shell_perf_log_dump_events (ShellPerfLog   *perf_log,
         g_free (escaped_description);
     }
 
+  g_rw_lock_reader_unlock (&perf_log->events_lock);
+
   g_string_append (output, " ]");
 
   return write_string (out, g_string_free (output, FALSE), error);
@@ -957,3 +1401,132 @@ shell_perf_log_dump_log (ShellPerfLog   *perf_log,
 
   return TRUE;
 }
+
+static void
+append_json_string (GString    *output,
+                    const char *str)
+{
+  const char *p;
+
+  g_string_append_c (output, '"');
+
+  for (p = str; *p; p++)
+    {
+      if (*p == '"' || *p == '\\')
+        g_string_append_printf (output, "\\%c", *p);
+      else if ((guchar)*p < 0x20)
+        g_string_append_printf (output, "\\u%04x", (guchar)*p);
+      else
+        g_string_append_c (output, *p);
+    }
+
+  g_string_append_c (output, '"');
+}
+
+/**
+ * shell_perf_log_dump_trace:
+ * @perf_log: a #ShellPerfLog
+ * @out: output stream into which to write the trace
+ * @error: location to store #GError, or %NULL
+ *
+ * Writes the performance event log to the specified output stream in
+ * the Trace Event format, as read by Perfetto, Sysprof and Chrome's
+ * trace viewer. Events become instant events on the thread that recorded
+ * them, and statistics become counters. Timestamps are in microseconds
+ * of the monotonic clock, so the trace lines up with other captures of
+ * the same session. As with shell_perf_log_dump_log(), @out should
+ * generally be buffered.
+ *
+ * Return value: %TRUE if the dump succeeded. %FALSE if an IO error occurred
+ */
+gboolean
+shell_perf_log_dump_trace (ShellPerfLog   *perf_log,
+                           GOutputStream  *out,
+                           GError        **error)
+{
+  g_autoptr (GString) output = NULL;
+  g_autofree ReplayCursor *cursors = NULL;
+  gboolean first = TRUE;
+  guint n_cursors, i;
+  pid_t pid = getpid ();
+
+  g_mutex_lock (&perf_log->thread_logs_lock);
+  n_cursors = perf_log->thread_logs->len;
+  cursors = g_new0 (ReplayCursor, n_cursors);
+  for (i = 0; i < n_cursors; i++)
+    replay_cursor_init (&cursors[i], perf_log,
+                        g_ptr_array_index (perf_log->thread_logs, i));
+  g_mutex_unlock (&perf_log->thread_logs_lock);
+
+  if (!write_string (out, "{ \"traceEvents\": [\n  ", error))
+    return FALSE;
+
+  output = g_string_new (NULL);
+
+  /* The format doesn't need events in order, so write out one thread
+   * after the other */
+  for (i = 0; i < n_cursors; i++)
+    {
+      ReplayCursor *cursor = &cursors[i];
+
+      for (replay_cursor_next (cursor, perf_log);
+           cursor->valid;
+           replay_cursor_next (cursor, perf_log))
+        {
+          ShellPerfEvent *event = cursor->event;
+          gboolean is_statistic;
+
+          g_rw_lock_reader_lock (&perf_log->events_lock);
+          is_statistic = g_hash_table_contains (perf_log->statistics_by_name, event->name);
+          g_rw_lock_reader_unlock (&perf_log->events_lock);
+
+          g_string_truncate (output, 0);
+
+          if (!first)
+            g_string_append (output, ",\n  ");
+          first = FALSE;
+
+          g_string_append (output, "{ \"name\": ");
+          append_json_string (output, event->name);
+          if (is_statistic)
+            g_string_append (output, ", \"ph\": \"C\"");
+          else
+            g_string_append (output, ", \"ph\": \"i\", \"s\": \"t\"");
+          g_string_append_printf (output,
+                                  ", \"cat\": \"shell\", "
+                                  "\"ts\": %" G_GINT64_FORMAT ", "
+                                  "\"pid\": %d, \"tid\": %u",
+                                  cursor->event_time, (int) pid, i + 1);
+
+          if (strcmp (event->signature, "i") == 0)
+            {
+              gint32 l;
+
+              memcpy (&l, cursor->arg, sizeof (gint32));
+              g_string_append_printf (output, ", \"args\": { \"%s\": %d }",
+                                      is_statistic ? "value" : "arg", l);
+            }
+          else if (strcmp (event->signature, "x") == 0)
+            {
+              gint64 l;
+
+              memcpy (&l, cursor->arg, sizeof (gint64));
+              g_string_append_printf (output, ", \"args\": { \"%s\": %" G_GINT64_FORMAT " }",
+                                      is_statistic ? "value" : "arg", l);
+            }
+          else if (strcmp (event->signature, "s") == 0)
+            {
+              g_string_append (output, ", \"args\": { \"arg\": ");
+              append_json_string (output, (const char *)cursor->arg);
+              g_string_append (output, " }");
+            }
+
+          g_string_append (output, " }");
+
+          if (!write_string (out, output->str, error))
+            return FALSE;
+        }
+    }
+
+  return write_string (out, " ],\n  \"displayTimeUnit\": \"ms\" }\n", error);
+}
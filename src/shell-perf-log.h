@@ -43,6 +43,18 @@ void shell_perf_log_update_statistic_x (ShellPerfLog *perf_log,
                                         const char   *name,
                                         gint64        value);
 
+void   shell_perf_log_define_histogram         (ShellPerfLog *perf_log,
+                                                const char   *name,
+                                                const char   *description);
+void   shell_perf_log_update_histogram         (ShellPerfLog *perf_log,
+                                                const char   *name,
+                                                gint64        value);
+gint64 shell_perf_log_get_histogram_percentile (ShellPerfLog *perf_log,
+                                                const char   *name,
+                                                double        percentile);
+void   shell_perf_log_reset_histogram          (ShellPerfLog *perf_log,
+                                                const char   *name);
+
 typedef void (*ShellPerfStatisticsCallback) (ShellPerfLog *perf_log,
                                              gpointer      data);
 
@@ -69,6 +81,9 @@ gboolean shell_perf_log_dump_events (ShellPerfLog   *perf_log,
 gboolean shell_perf_log_dump_log    (ShellPerfLog   *perf_log,
                                      GOutputStream  *out,
                                      GError        **error);
+gboolean shell_perf_log_dump_trace  (ShellPerfLog   *perf_log,
+                                     GOutputStream  *out,
+                                     GError        **error);
 
 G_END_DECLS
 
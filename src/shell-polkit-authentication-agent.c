@@ -51,6 +51,8 @@ struct _ShellPolkitAuthenticationAgent {
 
   GList *scheduled_requests;
   AuthRequest *current_request;
+  /* Scheduled requests that the current one authenticates for, too */
+  GList *batched_requests;
 
   gpointer handle;
 };
@@ -311,6 +313,11 @@ shell_polkit_authentication_agent_unregister (ShellPolkitAuthenticationAgent *ag
       g_list_foreach (agent->scheduled_requests, (GFunc)auth_request_dismiss, NULL);
       agent->scheduled_requests = NULL;
     }
+  if (agent->batched_requests != NULL)
+    {
+      g_list_foreach (agent->batched_requests, (GFunc)auth_request_dismiss, NULL);
+      agent->batched_requests = NULL;
+    }
   if (agent->current_request != NULL)
     auth_request_dismiss (agent->current_request);
 
@@ -334,7 +341,10 @@ auth_request_complete (AuthRequest *request,
                request->action_id, request->cookie);
 
   if (!is_current)
-    agent->scheduled_requests = g_list_remove (agent->scheduled_requests, request);
+    {
+      agent->scheduled_requests = g_list_remove (agent->scheduled_requests, request);
+      agent->batched_requests = g_list_remove (agent->batched_requests, request);
+    }
   g_cancellable_disconnect (request->cancellable, request->handler_id);
 
   if (dismissed)
@@ -350,10 +360,68 @@ auth_request_complete (AuthRequest *request,
   if (is_current)
     {
       agent->current_request = NULL;
+
+      /* Whatever the current request didn't authenticate for gets its
+       * own turn again, in the order it was scheduled in */
+      if (dismissed)
+        {
+          g_list_foreach (agent->batched_requests, (GFunc)auth_request_dismiss, NULL);
+          g_clear_pointer (&agent->batched_requests, g_list_free);
+        }
+      else
+        {
+          agent->scheduled_requests = g_list_concat (g_steal_pointer (&agent->batched_requests),
+                                                     agent->scheduled_requests);
+        }
+
       maybe_process_next_request (agent);
     }
 }
 
+static gboolean
+identities_equal (GList *identities,
+                  GList *other_identities)
+{
+  GList *l, *ll;
+
+  for (l = identities, ll = other_identities;
+       l != NULL && ll != NULL;
+       l = l->next, ll = ll->next)
+    {
+      if (!polkit_identity_equal (l->data, ll->data))
+        return FALSE;
+    }
+
+  return l == NULL && ll == NULL;
+}
+
+/* Authenticating for @request also authenticates for @other if both are
+ * for the same action, asked by the same caller for the same subject,
+ * and can be authenticated by the same identities */
+static gboolean
+auth_request_can_batch (AuthRequest *request,
+                        AuthRequest *other)
+{
+  const char * const keys[] = { "polkit.subject-pid", "polkit.caller-pid" };
+  size_t i;
+
+  if (g_strcmp0 (request->action_id, other->action_id) != 0)
+    return FALSE;
+
+  /* Without these there's no telling whether both have the same
+   * subject, so requests without them are never batched */
+  for (i = 0; i < G_N_ELEMENTS (keys); i++)
+    {
+      const char *value = polkit_details_lookup (request->details, keys[i]);
+
+      if (value == NULL ||
+          g_strcmp0 (value, polkit_details_lookup (other->details, keys[i])) != 0)
+        return FALSE;
+    }
+
+  return identities_equal (request->identities, other->identities);
+}
+
 static void
 maybe_process_next_request (ShellPolkitAuthenticationAgent *agent)
 {
@@ -365,9 +433,25 @@ maybe_process_next_request (ShellPolkitAuthenticationAgent *agent)
 
       request = agent->scheduled_requests->data;
 
+      GList *l, *next;
+
       agent->current_request = request;
       agent->scheduled_requests = g_list_remove (agent->scheduled_requests, request);
 
+      for (l = agent->scheduled_requests; l != NULL; l = next)
+        {
+          AuthRequest *other = l->data;
+
+          next = l->next;
+
+          if (!auth_request_can_batch (request, other))
+            continue;
+
+          print_debug ("BATCHING %s cookie %s", other->action_id, other->cookie);
+          agent->scheduled_requests = g_list_delete_link (agent->scheduled_requests, l);
+          agent->batched_requests = g_list_append (agent->batched_requests, other);
+        }
+
       print_debug ("INITIATING %s cookie %s", request->action_id, request->cookie);
       auth_request_initiate (request);
     }
@@ -418,6 +502,16 @@ initiate_authentication_finish (PolkitAgentListener  *listener,
   return g_task_propagate_boolean (G_TASK (res), error);
 }
 
+/**
+ * shell_polkit_authentication_agent_complete:
+ * @agent: a #ShellPolkitAuthenticationAgent
+ * @dismissed: whether the user dismissed the authentication dialog
+ *
+ * Completes the current request. If it was dismissed, the requests
+ * batched with it are dismissed as well; otherwise those that weren't
+ * completed with shell_polkit_authentication_agent_complete_batched()
+ * are scheduled again.
+ */
 void
 shell_polkit_authentication_agent_complete (ShellPolkitAuthenticationAgent *agent,
                                             gboolean                        dismissed)
@@ -427,3 +521,64 @@ shell_polkit_authentication_agent_complete (ShellPolkitAuthenticationAgent *agen
 
   auth_request_complete (agent->current_request, dismissed);
 }
+
+/**
+ * shell_polkit_authentication_agent_get_batched_cookies:
+ * @agent: a #ShellPolkitAuthenticationAgent
+ *
+ * Gets the cookies of the scheduled requests that are for the same
+ * action, caller, subject and identities as the current request, so
+ * that the authentication dialog can authenticate for all of them at
+ * once. Each still needs an agent session of its own.
+ *
+ * Returns: (transfer full): the cookies of the batched requests
+ */
+char **
+shell_polkit_authentication_agent_get_batched_cookies (ShellPolkitAuthenticationAgent *agent)
+{
+  GPtrArray *cookies;
+  GList *l;
+
+  g_return_val_if_fail (SHELL_IS_POLKIT_AUTHENTICATION_AGENT (agent), NULL);
+
+  cookies = g_ptr_array_new ();
+  for (l = agent->batched_requests; l != NULL; l = l->next)
+    {
+      AuthRequest *request = l->data;
+
+      g_ptr_array_add (cookies, g_strdup (request->cookie));
+    }
+  g_ptr_array_add (cookies, NULL);
+
+  return (char **) g_ptr_array_free (cookies, FALSE);
+}
+
+/**
+ * shell_polkit_authentication_agent_complete_batched:
+ * @agent: a #ShellPolkitAuthenticationAgent
+ * @cookie: the cookie of a batched request
+ *
+ * Completes the batched request with @cookie, after an agent session
+ * for it succeeded. Requests that were cancelled in the meantime are
+ * ignored.
+ */
+void
+shell_polkit_authentication_agent_complete_batched (ShellPolkitAuthenticationAgent *agent,
+                                                    const char                     *cookie)
+{
+  GList *l;
+
+  g_return_if_fail (SHELL_IS_POLKIT_AUTHENTICATION_AGENT (agent));
+  g_return_if_fail (cookie != NULL);
+
+  for (l = agent->batched_requests; l != NULL; l = l->next)
+    {
+      AuthRequest *request = l->data;
+
+      if (g_strcmp0 (request->cookie, cookie) == 0)
+        {
+          auth_request_complete (request, FALSE);
+          return;
+        }
+    }
+}
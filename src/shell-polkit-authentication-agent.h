@@ -27,6 +27,9 @@ ShellPolkitAuthenticationAgent *shell_polkit_authentication_agent_new (void);
 
 void                            shell_polkit_authentication_agent_complete (ShellPolkitAuthenticationAgent *agent,
                                                                             gboolean                        dismissed);
+char **                         shell_polkit_authentication_agent_get_batched_cookies (ShellPolkitAuthenticationAgent *agent);
+void                            shell_polkit_authentication_agent_complete_batched (ShellPolkitAuthenticationAgent *agent,
+                                                                                    const char                     *cookie);
 void                            shell_polkit_authentication_agent_register (ShellPolkitAuthenticationAgent *agent,
                                                                             GError                        **error_out);
 void                            shell_polkit_authentication_agent_unregister (ShellPolkitAuthenticationAgent *agent);
@@ -1,5 +1,7 @@
 /* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
 
+#define _GNU_SOURCE
+
 #include <clutter/clutter.h>
 #include <cogl/cogl.h>
 #include <meta/display.h>
@@ -7,6 +9,14 @@
 #include <meta/meta-plugin.h>
 #include <meta/meta-cursor-tracker.h>
 #include <st/st.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <math.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <zlib.h>
 
 #include "shell-global.h"
 #include "shell-screenshot.h"
@@ -54,6 +64,9 @@ struct _ShellScreenshotPrivate
   GDateTime *datetime;
 
   cairo_surface_t *image;
+  GArray *tiles;
+  int tiles_width;
+  int tiles_height;
   MtkRectangle screenshot_area;
 
   gboolean include_frame;
@@ -62,13 +75,43 @@ struct _ShellScreenshotPrivate
   ClutterContent *cursor_content;
   graphene_point_t cursor_point;
   float cursor_scale;
+
+  ShellScreenshotFormat format;
+  int compression_level;
+
+  /* Raw screenshots are grabbed into the memory of a memfd */
+  gboolean raw;
+  int memfd;
+  int raw_width;
+  int raw_height;
+  int raw_stride;
+
+  CoglFramebuffer *pick_framebuffer;
+  CoglPixelBuffer *pick_buffer;
+  CoglColor picked_color;
+  gboolean picking;
 };
 
 G_DEFINE_TYPE_WITH_PRIVATE (ShellScreenshot, shell_screenshot, G_TYPE_OBJECT);
 
+static void
+shell_screenshot_finalize (GObject *object)
+{
+  ShellScreenshotPrivate *priv = SHELL_SCREENSHOT (object)->priv;
+
+  g_clear_object (&priv->pick_framebuffer);
+  g_clear_object (&priv->pick_buffer);
+
+  G_OBJECT_CLASS (shell_screenshot_parent_class)->finalize (object);
+}
+
 static void
 shell_screenshot_class_init (ShellScreenshotClass *screenshot_class)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (screenshot_class);
+
+  object_class->finalize = shell_screenshot_finalize;
+
   signals[SCREENSHOT_TAKEN] =
     g_signal_new ("screenshot-taken",
                   G_TYPE_FROM_CLASS(screenshot_class),
@@ -85,6 +128,9 @@ shell_screenshot_init (ShellScreenshot *screenshot)
 {
   screenshot->priv = shell_screenshot_get_instance_private (screenshot);
   screenshot->priv->global = shell_global_get ();
+  screenshot->priv->format = SHELL_SCREENSHOT_FORMAT_PNG;
+  screenshot->priv->compression_level = Z_DEFAULT_COMPRESSION;
+  screenshot->priv->memfd = -1;
 }
 
 static void
@@ -100,6 +146,7 @@ on_screenshot_written (GObject      *source,
   g_object_unref (result);
 
   g_clear_pointer (&priv->image, cairo_surface_destroy);
+  g_clear_pointer (&priv->tiles, g_array_unref);
   g_clear_object (&priv->stream);
   g_clear_pointer (&priv->datetime, g_date_time_unref);
 }
@@ -275,48 +322,931 @@ util_pixbuf_from_surface (cairo_surface_t *surface,
                         width, height);
     }
 
-  cairo_surface_destroy (surface);
+  cairo_surface_destroy (surface);
+
+  return dest;
+}
+
+/* Screenshots are encoded straight from the image surface, one row at
+ * a time, rather than through a GdkPixbuf copy of the whole image.
+ * PNG data is deflated in horizontal strips on as many threads as
+ * there are processors; each strip but the last ends on a sync flush,
+ * so the raw deflate streams can be concatenated into one zlib stream
+ * whose checksum is combined from those of the strips.
+ */
+
+/* Fewer rows than this are not worth a thread of their own */
+#define PNG_MIN_STRIP_ROWS 64
+#define PNG_DEFLATE_CHUNK (64 * 1024)
+
+#define QOI_BUFFER_SIZE (64 * 1024)
+
+enum
+{
+  PNG_FILTER_NONE = 0,
+  PNG_FILTER_SUB = 1,
+  PNG_FILTER_UP = 2,
+};
+
+/* A screenshot to encode, put together from one or more tiles, such as
+ * the separately read back contents of each monitor. Rows are stitched
+ * as they get encoded, so the tiles are never copied into one image;
+ * pixels that no tile covers are transparent.
+ */
+typedef struct
+{
+  cairo_surface_t *surface;
+  int x;
+  int y;
+} ImageTile;
+
+typedef struct
+{
+  int width;
+  int height;
+  gboolean has_alpha;
+  ImageTile *tiles;
+  int n_tiles;
+} EncodeImage;
+
+typedef struct
+{
+  const EncodeImage *image;
+  int level;
+  int first_row;
+  int n_rows;
+
+  GByteArray *output;
+  uLong adler;
+  uLong length;
+  gboolean failed;
+} PngStrip;
+
+static cairo_surface_t *
+coerce_to_encodable_image (cairo_surface_t *surface,
+                           cairo_content_t  content)
+{
+  int width, height;
+
+  if (cairo_surface_get_type (surface) == CAIRO_SURFACE_TYPE_IMAGE &&
+      cairo_image_surface_get_format (surface) == util_cairo_format_for_content (content))
+    {
+      surface = cairo_surface_reference (surface);
+    }
+  else
+    {
+      width = cairo_image_surface_get_width (surface);
+      height = cairo_image_surface_get_height (surface);
+      surface = util_cairo_surface_coerce_to_image (surface, content,
+                                                    0, 0,
+                                                    width, height);
+    }
+
+  cairo_surface_flush (surface);
+
+  return surface;
+}
+
+static void
+encode_image_init (EncodeImage     *image,
+                   const ImageTile *tiles,
+                   int              n_tiles,
+                   int              width,
+                   int              height)
+{
+  cairo_content_t content = CAIRO_CONTENT_COLOR;
+  int i;
+
+  /* Gaps between tiles need to stay transparent */
+  if (n_tiles > 1)
+    content = CAIRO_CONTENT_COLOR_ALPHA;
+
+  for (i = 0; i < n_tiles; i++)
+    content |= cairo_surface_get_content (tiles[i].surface);
+
+  image->width = width;
+  image->height = height;
+  image->has_alpha = !!(content & CAIRO_CONTENT_ALPHA);
+  image->tiles = g_new (ImageTile, n_tiles);
+  image->n_tiles = n_tiles;
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      image->tiles[i] = tiles[i];
+      image->tiles[i].surface =
+        coerce_to_encodable_image (tiles[i].surface, content);
+    }
+}
+
+static void
+encode_image_clear (EncodeImage *image)
+{
+  int i;
+
+  for (i = 0; i < image->n_tiles; i++)
+    cairo_surface_destroy (image->tiles[i].surface);
+
+  g_clear_pointer (&image->tiles, g_free);
+  image->n_tiles = 0;
+}
+
+static void
+convert_row (guchar            *dest,
+             const EncodeImage *image,
+             int                row)
+{
+  int bpp = image->has_alpha ? 4 : 3;
+  int i;
+
+  if (image->n_tiles > 1)
+    memset (dest, 0, image->width * bpp);
+
+  for (i = 0; i < image->n_tiles; i++)
+    {
+      const ImageTile *tile = &image->tiles[i];
+      guchar *data = cairo_image_surface_get_data (tile->surface);
+      int stride = cairo_image_surface_get_stride (tile->surface);
+      int width = MIN (cairo_image_surface_get_width (tile->surface),
+                       image->width - tile->x);
+      int height = cairo_image_surface_get_height (tile->surface);
+
+      if (row < tile->y || row >= tile->y + height || width <= 0)
+        continue;
+
+      if (image->has_alpha)
+        convert_alpha (dest + tile->x * bpp, 0, data, stride,
+                       0, row - tile->y, width, 1);
+      else
+        convert_no_alpha (dest + tile->x * bpp, 0, data, stride,
+                          0, row - tile->y, width, 1);
+    }
+}
+
+/* Picks the filter leaving the smaller residuals, the heuristic libpng
+ * uses, between the two that suit screen contents: Sub for horizontal
+ * runs of color and Up for vertical ones.
+ */
+static void
+filter_row (guchar       *dest,
+            const guchar *row,
+            const guchar *prev,
+            int           row_bytes,
+            int           bpp,
+            int           level)
+{
+  unsigned int sub_sum = 0, up_sum = 0;
+  int i;
+
+  if (level == Z_NO_COMPRESSION)
+    {
+      dest[0] = PNG_FILTER_NONE;
+      memcpy (dest + 1, row, row_bytes);
+      return;
+    }
+
+  for (i = 0; i < row_bytes; i++)
+    {
+      guchar left = i >= bpp ? row[i - bpp] : 0;
+      guchar up = prev ? prev[i] : 0;
+
+      sub_sum += ABS ((gint8) (row[i] - left));
+      up_sum += ABS ((gint8) (row[i] - up));
+    }
+
+  if (up_sum < sub_sum)
+    {
+      dest[0] = PNG_FILTER_UP;
+      for (i = 0; i < row_bytes; i++)
+        dest[i + 1] = row[i] - (prev ? prev[i] : 0);
+    }
+  else
+    {
+      dest[0] = PNG_FILTER_SUB;
+      for (i = 0; i < row_bytes; i++)
+        dest[i + 1] = row[i] - (i >= bpp ? row[i - bpp] : 0);
+    }
+}
+
+static gboolean
+deflate_to_array (z_stream   *zs,
+                  GByteArray *output,
+                  int         flush)
+{
+  do
+    {
+      guint length = output->len;
+
+      g_byte_array_set_size (output, length + PNG_DEFLATE_CHUNK);
+      zs->next_out = output->data + length;
+      zs->avail_out = PNG_DEFLATE_CHUNK;
+
+      if (deflate (zs, flush) == Z_STREAM_ERROR)
+        return FALSE;
+
+      g_byte_array_set_size (output, length + PNG_DEFLATE_CHUNK - zs->avail_out);
+    }
+  while (zs->avail_out == 0);
+
+  return TRUE;
+}
+
+static gpointer
+deflate_strip (gpointer data)
+{
+  PngStrip *strip = data;
+  int height = strip->image->height;
+  int bpp = strip->image->has_alpha ? 4 : 3;
+  int row_bytes = strip->image->width * bpp;
+  g_autofree guchar *row = g_malloc (row_bytes);
+  g_autofree guchar *prev = NULL;
+  g_autofree guchar *line = g_malloc (row_bytes + 1);
+  gboolean last = strip->first_row + strip->n_rows == height;
+  z_stream zs = { 0, };
+  int y;
+
+  if (deflateInit2 (&zs, strip->level, Z_DEFLATED, -MAX_WBITS, 8,
+                    Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+      strip->failed = TRUE;
+      return NULL;
+    }
+
+  if (strip->first_row > 0)
+    {
+      prev = g_malloc (row_bytes);
+      convert_row (prev, strip->image, strip->first_row - 1);
+    }
+
+  strip->adler = adler32 (0L, Z_NULL, 0);
+
+  for (y = strip->first_row; y < strip->first_row + strip->n_rows; y++)
+    {
+      convert_row (row, strip->image, y);
+      filter_row (line, row, prev, row_bytes, bpp, strip->level);
+
+      strip->adler = adler32 (strip->adler, line, row_bytes + 1);
+      strip->length += row_bytes + 1;
+
+      zs.next_in = line;
+      zs.avail_in = row_bytes + 1;
+      if (!deflate_to_array (&zs, strip->output, Z_NO_FLUSH))
+        {
+          strip->failed = TRUE;
+          break;
+        }
+
+      if (!prev)
+        prev = g_malloc (row_bytes);
+      memcpy (prev, row, row_bytes);
+    }
+
+  if (!strip->failed &&
+      !deflate_to_array (&zs, strip->output, last ? Z_FINISH : Z_SYNC_FLUSH))
+    strip->failed = TRUE;
+
+  deflateEnd (&zs);
+
+  return NULL;
+}
+
+static gboolean
+write_png_chunk (GOutputStream  *stream,
+                 const char     *type,
+                 const guchar   *data,
+                 gsize           length,
+                 GCancellable   *cancellable,
+                 GError        **error)
+{
+  guint32 header[2];
+  guint32 crc;
+
+  header[0] = GUINT32_TO_BE (length);
+  memcpy (&header[1], type, 4);
+
+  crc = crc32 (0L, (const Bytef *) type, 4);
+  if (length > 0)
+    crc = crc32 (crc, data, length);
+  crc = GUINT32_TO_BE (crc);
+
+  return g_output_stream_write_all (stream, header, sizeof (header), NULL,
+                                    cancellable, error) &&
+         (length == 0 ||
+          g_output_stream_write_all (stream, data, length, NULL,
+                                     cancellable, error)) &&
+         g_output_stream_write_all (stream, &crc, sizeof (crc), NULL,
+                                    cancellable, error);
+}
+
+/* Text that is not plain ASCII can't be stored as Latin-1 tEXt, so it
+ * goes into an uncompressed iTXt chunk as UTF-8, as GdkPixbuf does.
+ */
+static gboolean
+write_png_text (GOutputStream  *stream,
+                const char     *key,
+                const char     *text,
+                GCancellable   *cancellable,
+                GError        **error)
+{
+  static const guint8 itxt_fields[] = { 0, 0, 0, 0 };
+  g_autoptr (GByteArray) data = g_byte_array_new ();
+  gboolean is_ascii = g_str_is_ascii (text);
+
+  g_byte_array_append (data, (const guint8 *) key, strlen (key) + 1);
+  if (!is_ascii)
+    g_byte_array_append (data, itxt_fields, sizeof (itxt_fields));
+  g_byte_array_append (data, (const guint8 *) text, strlen (text));
+
+  return write_png_chunk (stream, is_ascii ? "tEXt" : "iTXt",
+                          data->data, data->len,
+                          cancellable, error);
+}
+
+static gboolean
+write_png (GOutputStream      *stream,
+           const EncodeImage  *image,
+           int                 level,
+           const char         *creation_time,
+           GCancellable       *cancellable,
+           GError            **error)
+{
+  g_autofree PngStrip *strips = NULL;
+  g_autofree GThread **threads = NULL;
+  guint8 ihdr[13];
+  guint32 value;
+  uLong adler;
+  gboolean success = TRUE;
+  int width = image->width;
+  int height = image->height;
+  int n_strips, i;
+
+  value = GUINT32_TO_BE (width);
+  memcpy (ihdr, &value, 4);
+  value = GUINT32_TO_BE (height);
+  memcpy (ihdr + 4, &value, 4);
+  ihdr[8] = 8; /* bit depth */
+  ihdr[9] = image->has_alpha ? 6 : 2; /* RGBA or RGB */
+  ihdr[10] = 0; /* deflate */
+  ihdr[11] = 0; /* adaptive filtering */
+  ihdr[12] = 0; /* no interlacing */
+
+  if (!g_output_stream_write_all (stream, "\x89PNG\r\n\x1a\n", 8, NULL,
+                                  cancellable, error) ||
+      !write_png_chunk (stream, "IHDR", ihdr, sizeof (ihdr),
+                        cancellable, error) ||
+      !write_png_text (stream, "Software", "gnome-screenshot",
+                       cancellable, error) ||
+      !write_png_text (stream, "Creation Time", creation_time,
+                       cancellable, error))
+    return FALSE;
+
+  n_strips = CLAMP (height / PNG_MIN_STRIP_ROWS, 1, (int) g_get_num_processors ());
+  strips = g_new0 (PngStrip, n_strips);
+  threads = g_new0 (GThread *, n_strips);
+
+  for (i = 0; i < n_strips; i++)
+    {
+      strips[i].image = image;
+      strips[i].level = level;
+      strips[i].first_row = height * i / n_strips;
+      strips[i].n_rows = height * (i + 1) / n_strips - strips[i].first_row;
+      strips[i].output = g_byte_array_new ();
+    }
+
+  /* zlib header: deflate with a 32K window, no preset dictionary */
+  g_byte_array_append (strips[0].output, (const guint8 *) "\x78\x01", 2);
+
+  for (i = 1; i < n_strips; i++)
+    threads[i] = g_thread_new ("screenshot-png", deflate_strip, &strips[i]);
+  deflate_strip (&strips[0]);
+  for (i = 1; i < n_strips; i++)
+    g_thread_join (threads[i]);
+
+  adler = adler32 (0L, Z_NULL, 0);
+  for (i = 0; i < n_strips; i++)
+    {
+      success = success && !strips[i].failed;
+      adler = adler32_combine (adler, strips[i].adler, strips[i].length);
+    }
+
+  value = GUINT32_TO_BE (adler);
+  g_byte_array_append (strips[n_strips - 1].output, (const guint8 *) &value, 4);
+
+  if (!success)
+    g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                         "Failed to compress screenshot");
+
+  for (i = 0; i < n_strips; i++)
+    {
+      success = success &&
+                write_png_chunk (stream, "IDAT",
+                                 strips[i].output->data, strips[i].output->len,
+                                 cancellable, error);
+      g_byte_array_unref (strips[i].output);
+    }
+
+  success = success &&
+            write_png_chunk (stream, "IEND", NULL, 0, cancellable, error);
+
+  return success;
+}
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xc0
+#define QOI_OP_RGB 0xfe
+#define QOI_OP_RGBA 0xff
+
+#define QOI_HASH(r, g, b, a) (((r) * 3 + (g) * 5 + (b) * 7 + (a) * 11) % 64)
+
+static gboolean
+write_qoi (GOutputStream      *stream,
+           const EncodeImage  *image,
+           GCancellable       *cancellable,
+           GError            **error)
+{
+  g_autofree guchar *row = NULL;
+  g_autofree guchar *buffer = g_malloc (QOI_BUFFER_SIZE);
+  guint8 index[64][4] = { { 0, }, };
+  guint8 prev[4] = { 0, 0, 0, 255 };
+  guint32 value;
+  gboolean has_alpha = image->has_alpha;
+  gboolean success = TRUE;
+  int width = image->width;
+  int height = image->height;
+  int bpp;
+  int run = 0;
+  int pos = 0;
+  int x, y;
+
+  bpp = has_alpha ? 4 : 3;
+  row = g_malloc (width * bpp);
+
+  memcpy (buffer, "qoif", 4);
+  value = GUINT32_TO_BE (width);
+  memcpy (buffer + 4, &value, 4);
+  value = GUINT32_TO_BE (height);
+  memcpy (buffer + 8, &value, 4);
+  buffer[12] = bpp;
+  buffer[13] = 0; /* sRGB with linear alpha */
+  pos = 14;
+
+  for (y = 0; y < height && success; y++)
+    {
+      convert_row (row, image, y);
+
+      for (x = 0; x < width; x++)
+        {
+          const guint8 *p = row + x * bpp;
+          guint8 px[4] = { p[0], p[1], p[2], has_alpha ? p[3] : 255 };
+
+          if (memcmp (px, prev, 4) == 0)
+            {
+              if (++run == 62)
+                {
+                  buffer[pos++] = QOI_OP_RUN | (run - 1);
+                  run = 0;
+                }
+            }
+          else
+            {
+              int hash = QOI_HASH (px[0], px[1], px[2], px[3]);
+
+              if (run > 0)
+                {
+                  buffer[pos++] = QOI_OP_RUN | (run - 1);
+                  run = 0;
+                }
+
+              if (memcmp (index[hash], px, 4) == 0)
+                {
+                  buffer[pos++] = QOI_OP_INDEX | hash;
+                }
+              else if (px[3] == prev[3])
+                {
+                  gint8 vr = px[0] - prev[0];
+                  gint8 vg = px[1] - prev[1];
+                  gint8 vb = px[2] - prev[2];
+                  gint8 vg_r = vr - vg;
+                  gint8 vg_b = vb - vg;
+
+                  if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2)
+                    {
+                      buffer[pos++] = QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+                    }
+                  else if (vg_r > -9 && vg_r < 8 && vg > -33 && vg < 32 &&
+                           vg_b > -9 && vg_b < 8)
+                    {
+                      buffer[pos++] = QOI_OP_LUMA | (vg + 32);
+                      buffer[pos++] = (vg_r + 8) << 4 | (vg_b + 8);
+                    }
+                  else
+                    {
+                      buffer[pos++] = QOI_OP_RGB;
+                      buffer[pos++] = px[0];
+                      buffer[pos++] = px[1];
+                      buffer[pos++] = px[2];
+                    }
+                }
+              else
+                {
+                  buffer[pos++] = QOI_OP_RGBA;
+                  memcpy (buffer + pos, px, 4);
+                  pos += 4;
+                }
+
+              memcpy (index[hash], px, 4);
+              memcpy (prev, px, 4);
+            }
+
+          /* Flush before the buffer can't take the largest operation */
+          if (pos > QOI_BUFFER_SIZE - 8)
+            {
+              success = g_output_stream_write_all (stream, buffer, pos, NULL,
+                                                   cancellable, error);
+              pos = 0;
+              if (!success)
+                break;
+            }
+        }
+    }
+
+  if (success)
+    {
+      if (run > 0)
+        buffer[pos++] = QOI_OP_RUN | (run - 1);
+
+      /* End marker */
+      memcpy (buffer + pos, "\0\0\0\0\0\0\0\1", 8);
+      pos += 8;
+
+      success = g_output_stream_write_all (stream, buffer, pos, NULL,
+                                           cancellable, error);
+    }
+
+  return success;
+}
+
+static void
+write_screenshot_thread (GTask        *result,
+                         gpointer      object,
+                         gpointer      task_data,
+                         GCancellable *cancellable)
+{
+  ShellScreenshot *screenshot = SHELL_SCREENSHOT (object);
+  ShellScreenshotPrivate *priv;
+  g_autoptr (GOutputStream) stream = NULL;
+  g_autofree char *creation_time = NULL;
+  EncodeImage image;
+  GError *error = NULL;
+
+  g_assert (screenshot != NULL);
+
+  priv = screenshot->priv;
+
+  stream = g_object_ref (priv->stream);
+
+  if (priv->tiles)
+    {
+      encode_image_init (&image,
+                         (ImageTile *) priv->tiles->data, priv->tiles->len,
+                         priv->tiles_width, priv->tiles_height);
+    }
+  else
+    {
+      ImageTile tile = { priv->image, 0, 0 };
+
+      encode_image_init (&image, &tile, 1,
+                         cairo_image_surface_get_width (priv->image),
+                         cairo_image_surface_get_height (priv->image));
+    }
+
+  creation_time = g_date_time_format (priv->datetime, "%c");
+
+  if (!creation_time)
+    creation_time = g_date_time_format (priv->datetime, "%FT%T%z");
+
+  if (priv->format == SHELL_SCREENSHOT_FORMAT_QOI)
+    write_qoi (stream, &image, cancellable, &error);
+  else
+    write_png (stream, &image, priv->compression_level, creation_time,
+               cancellable, &error);
+
+  encode_image_clear (&image);
+
+  if (error)
+    g_task_return_error (result, error);
+  else
+    g_task_return_boolean (result, TRUE);
+}
+
+static const cairo_user_data_key_t memfd_mapping_key;
+
+typedef struct
+{
+  void *data;
+  size_t size;
+} MemfdMapping;
+
+static void
+unmap_memfd (void *data)
+{
+  MemfdMapping *mapping = data;
+
+  munmap (mapping->data, mapping->size);
+  g_free (mapping);
+}
+
+/* The surface maps the memfd; destroying it unmaps the memory, which
+ * must happen before the memfd can be sealed against writes.
+ */
+static cairo_surface_t *
+create_memfd_image (int  width,
+                    int  height,
+                    int *memfd)
+{
+  int stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, width);
+  size_t size = (size_t) stride * height;
+  g_autofd int fd = -1;
+  cairo_surface_t *image;
+  MemfdMapping *mapping;
+  void *data;
+
+  fd = memfd_create ("gnome-shell-screenshot", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd < 0 || ftruncate (fd, size) < 0)
+    {
+      g_warning ("Failed to create screenshot memfd: %s", g_strerror (errno));
+      return NULL;
+    }
+
+  data = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED)
+    {
+      g_warning ("Failed to map screenshot memfd: %s", g_strerror (errno));
+      return NULL;
+    }
+
+  image = cairo_image_surface_create_for_data (data, CAIRO_FORMAT_ARGB32,
+                                               width, height, stride);
+
+  mapping = g_new0 (MemfdMapping, 1);
+  mapping->data = data;
+  mapping->size = size;
+  cairo_surface_set_user_data (image, &memfd_mapping_key, mapping, unmap_memfd);
+
+  *memfd = g_steal_fd (&fd);
+
+  return image;
+}
+
+static cairo_surface_t *
+create_image (ShellScreenshot *screenshot,
+              int              width,
+              int              height)
+{
+  ShellScreenshotPrivate *priv = screenshot->priv;
+
+  if (priv->raw)
+    return create_memfd_image (width, height, &priv->memfd);
+
+  return cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+}
+
+typedef void (* GrabDoneFunc) (ShellScreenshot *screenshot,
+                               GTask           *result);
+
+/* A grab of one or more images, the screenshot itself or one tile per
+ * monitor, that calls done once all of them arrived.
+ */
+typedef struct
+{
+  ShellScreenshot *screenshot;
+  GTask *result;
+  GrabDoneFunc done;
+
+  int n_pending;
+  gboolean failed;
+} GrabRequest;
+
+static GrabRequest *
+grab_request_new (ShellScreenshot *screenshot,
+                  int              n_images,
+                  GrabDoneFunc     done,
+                  GTask           *result)
+{
+  GrabRequest *request = g_new0 (GrabRequest, 1);
+
+  request->screenshot = g_object_ref (screenshot);
+  request->result = g_object_ref (result);
+  request->done = done;
+  request->n_pending = n_images;
+
+  return request;
+}
+
+/* Takes ownership of image, which is NULL if grabbing it failed; tile is
+ * the index into priv->tiles, or -1 for a single image.
+ */
+static void
+grab_request_add_image (GrabRequest     *request,
+                        int              tile,
+                        cairo_surface_t *image)
+{
+  ShellScreenshot *screenshot = request->screenshot;
+  ShellScreenshotPrivate *priv = screenshot->priv;
+
+  if (!image)
+    request->failed = TRUE;
+  else if (tile < 0)
+    priv->image = image;
+  else
+    g_array_index (priv->tiles, ImageTile, tile).surface = image;
+
+  if (--request->n_pending > 0)
+    return;
+
+  if (request->failed)
+    {
+      g_clear_pointer (&priv->image, cairo_surface_destroy);
+      g_clear_pointer (&priv->tiles, g_array_unref);
+      g_clear_fd (&priv->memfd, NULL);
+    }
+  else
+    {
+      priv->datetime = g_date_time_new_now_local ();
+    }
+
+  request->done (screenshot, request->result);
+
+  g_object_unref (request->result);
+  g_object_unref (request->screenshot);
+  g_free (request);
+}
+
+/* Stage contents read back asynchronously: painted into an offscreen
+ * framebuffer, transferred into a pixel buffer object by the GPU, and
+ * copied out once a fence signals that the transfer is complete.
+ */
+typedef struct
+{
+  GrabRequest *request;
+  int tile;
+
+  CoglFramebuffer *framebuffer;
+  CoglPixelBuffer *pixel_buffer;
+  int width;
+  int height;
+  int stride;
+} GrabReadback;
+
+static void
+grab_readback_free (GrabReadback *readback)
+{
+  g_clear_object (&readback->pixel_buffer);
+  g_clear_object (&readback->framebuffer);
+  g_free (readback);
+}
+
+static void
+finish_readback (gpointer data)
+{
+  GrabReadback *readback = data;
+  CoglBuffer *buffer = COGL_BUFFER (readback->pixel_buffer);
+  cairo_surface_t *image = NULL;
+  guint8 *pixels;
+
+  pixels = cogl_buffer_map (buffer, COGL_BUFFER_ACCESS_READ, 0);
+  if (pixels)
+    {
+      if (readback->tile < 0)
+        image = create_image (readback->request->screenshot,
+                              readback->width, readback->height);
+      else
+        image = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                            readback->width,
+                                            readback->height);
+
+      if (image)
+        {
+          cairo_surface_flush (image);
+          memcpy (cairo_image_surface_get_data (image), pixels,
+                  readback->stride * readback->height);
+          cairo_surface_mark_dirty (image);
+        }
+
+      cogl_buffer_unmap (buffer);
+    }
+  else
+    {
+      g_warning ("Failed to take screenshot: Could not map pixel buffer");
+    }
 
-  return dest;
+  grab_request_add_image (readback->request, readback->tile, image);
+  grab_readback_free (readback);
 }
 
 static void
-write_screenshot_thread (GTask        *result,
-                         gpointer      object,
-                         gpointer      task_data,
-                         GCancellable *cancellable)
+on_readback_fence (CoglFence *fence,
+                   gpointer   user_data)
 {
-  ShellScreenshot *screenshot = SHELL_SCREENSHOT (object);
-  ShellScreenshotPrivate *priv;
-  g_autoptr (GOutputStream) stream = NULL;
-  g_autoptr(GdkPixbuf) pixbuf = NULL;
-  g_autofree char *creation_time = NULL;
-  GError *error = NULL;
+  /* Cogl still uses the framebuffer after the callback returns, so
+   * only drop it from an idle */
+  g_idle_add_once (finish_readback, user_data);
+}
 
-  g_assert (screenshot != NULL);
+static gboolean
+readback_supported (void)
+{
+  CoglContext *ctx =
+    clutter_backend_get_cogl_context (clutter_get_default_backend ());
 
-  priv = screenshot->priv;
+  return cogl_context_has_feature (ctx, COGL_FEATURE_ID_FENCE) &&
+         cogl_context_has_feature (ctx, COGL_FEATURE_ID_MAP_BUFFER_FOR_READ);
+}
 
-  stream = g_object_ref (priv->stream);
+static gboolean
+start_readback (ShellScreenshot  *screenshot,
+                MtkRectangle     *rect,
+                int               width,
+                int               height,
+                float             scale,
+                ClutterPaintFlag  paint_flags,
+                GrabRequest      *request,
+                int               tile)
+{
+  ShellScreenshotPrivate *priv = screenshot->priv;
+  ClutterStage *stage = shell_global_get_stage (priv->global);
+  CoglContext *ctx;
+  CoglTexture *texture;
+  CoglOffscreen *offscreen;
+  CoglBitmap *bitmap;
+  GrabReadback *readback;
+  gboolean read;
+  g_autoptr (GError) error = NULL;
 
-  pixbuf = util_pixbuf_from_surface (priv->image,
-                                     0, 0,
-                                     cairo_image_surface_get_width (priv->image),
-                                     cairo_image_surface_get_height (priv->image));
-  creation_time = g_date_time_format (priv->datetime, "%c");
+  if (!readback_supported ())
+    return FALSE;
 
-  if (!creation_time)
-    creation_time = g_date_time_format (priv->datetime, "%FT%T%z");
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  texture = cogl_texture_2d_new_with_size (ctx, width, height);
+  offscreen = cogl_offscreen_new_with_texture (texture);
+  g_object_unref (texture);
 
-  gdk_pixbuf_save_to_stream (pixbuf, stream, "png", NULL, &error,
-                             "tEXt::Software", "gnome-screenshot",
-                             "tEXt::Creation Time", creation_time,
-                             NULL);
+  if (!cogl_framebuffer_allocate (COGL_FRAMEBUFFER (offscreen), &error))
+    {
+      g_object_unref (offscreen);
+      return FALSE;
+    }
 
-  if (error)
-    g_task_return_error (result, error);
+  readback = g_new0 (GrabReadback, 1);
+  readback->request = request;
+  readback->tile = tile;
+  readback->framebuffer = COGL_FRAMEBUFFER (offscreen);
+  readback->width = width;
+  readback->height = height;
+  readback->stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, width);
+  readback->pixel_buffer = cogl_pixel_buffer_new (ctx,
+                                                  readback->stride * height,
+                                                  NULL);
+
+  clutter_stage_paint_to_framebuffer (stage, readback->framebuffer,
+                                      rect, scale, paint_flags);
+
+  /* Reading into a bitmap backed by the pixel buffer only queues the
+   * transfer, rather than waiting for the GPU to finish painting */
+  bitmap = cogl_bitmap_new_from_buffer (COGL_BUFFER (readback->pixel_buffer),
+                                        COGL_PIXEL_FORMAT_CAIRO_ARGB32_COMPAT,
+                                        width, height,
+                                        readback->stride, 0);
+  read = cogl_framebuffer_read_pixels_into_bitmap (readback->framebuffer,
+                                                   0, 0,
+                                                   COGL_READ_PIXELS_COLOR_BUFFER,
+                                                   bitmap);
+  g_object_unref (bitmap);
+
+  if (!read)
+    {
+      grab_readback_free (readback);
+      return FALSE;
+    }
+
+  if (cogl_framebuffer_add_fence_callback (readback->framebuffer,
+                                           on_readback_fence,
+                                           readback))
+    cogl_framebuffer_flush (readback->framebuffer);
   else
-    g_task_return_boolean (result, TRUE);
+    finish_readback (readback);
+
+  return TRUE;
+}
+
+static ClutterPaintFlag
+get_paint_flags (ShellScreenshotFlag flags)
+{
+  if (flags & SHELL_SCREENSHOT_FLAG_INCLUDE_CURSOR)
+    return CLUTTER_PAINT_FLAG_FORCE_CURSORS;
+  else
+    return CLUTTER_PAINT_FLAG_NO_CURSORS;
 }
 
 static void
@@ -325,7 +1255,9 @@ do_grab_screenshot (ShellScreenshot     *screenshot,
                     int                  y,
                     int                  width,
                     int                  height,
-                    ShellScreenshotFlag  flags)
+                    ShellScreenshotFlag  flags,
+                    GrabDoneFunc         done,
+                    GTask               *result)
 {
   ShellScreenshotPrivate *priv = screenshot->priv;
   ClutterStage *stage = shell_global_get_stage (priv->global);
@@ -334,35 +1266,156 @@ do_grab_screenshot (ShellScreenshot     *screenshot,
   int image_height;
   float scale;
   cairo_surface_t *image;
-  ClutterPaintFlag paint_flags = CLUTTER_PAINT_FLAG_NONE;
+  ClutterPaintFlag paint_flags = get_paint_flags (flags);
+  GrabRequest *request;
   g_autoptr (GError) error = NULL;
 
   clutter_stage_get_capture_final_size (stage, &screenshot_rect,
                                         &image_width,
                                         &image_height,
                                         &scale);
-  image = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-                                      image_width, image_height);
 
-  if (flags & SHELL_SCREENSHOT_FLAG_INCLUDE_CURSOR)
-    paint_flags |= CLUTTER_PAINT_FLAG_FORCE_CURSORS;
-  else
-    paint_flags |= CLUTTER_PAINT_FLAG_NO_CURSORS;
-  if (!clutter_stage_paint_to_buffer (stage, &screenshot_rect, scale,
+  request = grab_request_new (screenshot, 1, done, result);
+
+  if (start_readback (screenshot, &screenshot_rect,
+                      image_width, image_height, scale,
+                      paint_flags, request, -1))
+    return;
+
+  image = create_image (screenshot, image_width, image_height);
+  if (image &&
+      !clutter_stage_paint_to_buffer (stage, &screenshot_rect, scale,
                                       cairo_image_surface_get_data (image),
                                       cairo_image_surface_get_stride (image),
                                       COGL_PIXEL_FORMAT_CAIRO_ARGB32_COMPAT,
                                       paint_flags,
                                       &error))
     {
-      cairo_surface_destroy (image);
+      g_clear_pointer (&image, cairo_surface_destroy);
       g_warning ("Failed to take screenshot: %s", error->message);
+    }
+
+  grab_request_add_image (request, -1, image);
+}
+
+static void
+clear_image_tile (gpointer data)
+{
+  ImageTile *tile = data;
+
+  g_clear_pointer (&tile->surface, cairo_surface_destroy);
+}
+
+/* Reads back every monitor on its own, so the GPU transfers of all of
+ * them run at once, and the encoder stitches the resulting tiles rather
+ * than everything going through a single screen-sized bitmap.
+ */
+static void
+grab_monitor_tiles (ShellScreenshot     *screenshot,
+                    ShellScreenshotFlag  flags,
+                    GrabDoneFunc         done,
+                    GTask               *result)
+{
+  ShellScreenshotPrivate *priv = screenshot->priv;
+  MetaDisplay *display = shell_global_get_display (priv->global);
+  ClutterStage *stage = shell_global_get_stage (priv->global);
+  int n_monitors = meta_display_get_n_monitors (display);
+  ClutterPaintFlag paint_flags = get_paint_flags (flags);
+  GrabRequest *request;
+  float scale;
+  int i;
+
+  /* All tiles share the scale of the whole screen, so that they fit
+   * together without seams */
+  clutter_stage_get_capture_final_size (stage, &priv->screenshot_area,
+                                        &priv->tiles_width,
+                                        &priv->tiles_height,
+                                        &scale);
+
+  priv->tiles = g_array_sized_new (FALSE, TRUE, sizeof (ImageTile), n_monitors);
+  g_array_set_clear_func (priv->tiles, clear_image_tile);
+
+  request = grab_request_new (screenshot, n_monitors, done, result);
+
+  for (i = 0; i < n_monitors; i++)
+    {
+      ImageTile tile = { NULL, };
+      MtkRectangle rect;
+      int x2, y2;
+
+      meta_display_get_monitor_geometry (display, i, &rect);
+
+      tile.x = roundf (rect.x * scale);
+      tile.y = roundf (rect.y * scale);
+      x2 = MIN (roundf ((rect.x + rect.width) * scale), priv->tiles_width);
+      y2 = MIN (roundf ((rect.y + rect.height) * scale), priv->tiles_height);
+      g_array_append_val (priv->tiles, tile);
+
+      if (x2 <= tile.x || y2 <= tile.y ||
+          !start_readback (screenshot, &rect,
+                           x2 - tile.x, y2 - tile.y, scale,
+                           paint_flags, request, i))
+        grab_request_add_image (request, i, NULL);
+    }
+}
+
+static void
+write_screenshot (ShellScreenshot *screenshot,
+                  GTask           *result)
+{
+  GTask *task;
+
+  if (!screenshot->priv->image && !screenshot->priv->tiles)
+    {
+      g_task_report_new_error (screenshot, on_screenshot_written, result, NULL,
+                               G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "Capturing screen failed");
       return;
     }
 
-  priv->image = image;
+  task = g_task_new (screenshot, NULL, on_screenshot_written, result);
+  g_task_run_in_thread (task, write_screenshot_thread);
+  g_object_unref (task);
+}
 
-  priv->datetime = g_date_time_new_now_local ();
+static void
+seal_raw_screenshot (ShellScreenshot *screenshot,
+                     GTask           *result)
+{
+  ShellScreenshotPrivate *priv = screenshot->priv;
+  g_autofd int fd = g_steal_fd (&priv->memfd);
+  g_autoptr (GTask) task = result;
+
+  priv->raw = FALSE;
+
+  if (!priv->image)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "Capturing screen failed");
+      return;
+    }
+
+  priv->raw_width = cairo_image_surface_get_width (priv->image);
+  priv->raw_height = cairo_image_surface_get_height (priv->image);
+  priv->raw_stride = cairo_image_surface_get_stride (priv->image);
+
+  cairo_surface_flush (priv->image);
+  g_clear_pointer (&priv->image, cairo_surface_destroy);
+  g_clear_pointer (&priv->datetime, g_date_time_unref);
+
+  if (fcntl (fd, F_ADD_SEALS,
+             F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0)
+    {
+      int saved_errno = errno;
+
+      g_task_return_new_error (task, G_IO_ERROR,
+                               g_io_error_from_errno (saved_errno),
+                               "Failed to seal screenshot: %s",
+                               g_strerror (saved_errno));
+      return;
+    }
+
+  g_task_return_int (task, g_steal_fd (&fd));
 }
 
 static void
@@ -445,23 +1498,26 @@ grab_screenshot (ShellScreenshot     *screenshot,
   ShellScreenshotPrivate *priv = screenshot->priv;
   MetaDisplay *display;
   int width, height;
-  GTask *task;
 
   display = shell_global_get_display (priv->global);
   meta_display_get_size (display, &width, &height);
 
-  do_grab_screenshot (screenshot,
-                      0, 0, width, height,
-                      flags);
-
   priv->screenshot_area.x = 0;
   priv->screenshot_area.y = 0;
   priv->screenshot_area.width = width;
   priv->screenshot_area.height = height;
 
-  task = g_task_new (screenshot, NULL, on_screenshot_written, result);
-  g_task_run_in_thread (task, write_screenshot_thread);
-  g_object_unref (task);
+  if (meta_display_get_n_monitors (display) > 1 && !priv->raw &&
+      readback_supported ())
+    {
+      grab_monitor_tiles (screenshot, flags, write_screenshot, result);
+      return;
+    }
+
+  do_grab_screenshot (screenshot,
+                      0, 0, width, height,
+                      flags,
+                      write_screenshot, result);
 }
 
 static void
@@ -669,7 +1725,6 @@ on_after_paint (ClutterStage     *stage,
   ShellScreenshot *screenshot = g_task_get_task_data (result);
   ShellScreenshotPrivate *priv = screenshot->priv;
   MetaDisplay *display = shell_global_get_display (priv->global);
-  GTask *task;
 
   g_signal_handlers_disconnect_by_func (stage, on_after_paint, result);
 
@@ -680,10 +1735,9 @@ on_after_paint (ClutterStage     *stage,
                           priv->screenshot_area.y,
                           priv->screenshot_area.width,
                           priv->screenshot_area.height,
-                          priv->flags);
-
-      task = g_task_new (screenshot, NULL, on_screenshot_written, result);
-      g_task_run_in_thread (task, write_screenshot_thread);
+                          priv->flags,
+                          priv->raw ? seal_raw_screenshot : write_screenshot,
+                          result);
     }
   else
     {
@@ -725,7 +1779,7 @@ shell_screenshot_screenshot (ShellScreenshot     *screenshot,
 
   priv = screenshot->priv;
 
-  if (priv->stream != NULL) {
+  if (priv->stream != NULL || priv->raw) {
     if (callback)
       g_task_report_new_error (screenshot,
                                callback,
@@ -892,69 +1946,174 @@ shell_screenshot_screenshot_stage_to_content_finish (ShellScreenshot   *screensh
   g_return_val_if_fail (g_async_result_is_tagged (result,
                                                   shell_screenshot_screenshot_stage_to_content),
                         FALSE);
-
-  content = g_task_propagate_pointer (G_TASK (result), error);
-  if (!content)
-    return NULL;
-
-  if (scale)
-    *scale = priv->scale;
-
-  if (cursor_content)
-    *cursor_content = g_steal_pointer (&priv->cursor_content);
-  else
-    g_clear_pointer (&priv->cursor_content, g_object_unref);
-
-  if (cursor_point)
-    *cursor_point = priv->cursor_point;
-
-  if (cursor_scale)
-    *cursor_scale = priv->cursor_scale;
-
-  return content;
+
+  content = g_task_propagate_pointer (G_TASK (result), error);
+  if (!content)
+    return NULL;
+
+  if (scale)
+    *scale = priv->scale;
+
+  if (cursor_content)
+    *cursor_content = g_steal_pointer (&priv->cursor_content);
+  else
+    g_clear_pointer (&priv->cursor_content, g_object_unref);
+
+  if (cursor_point)
+    *cursor_point = priv->cursor_point;
+
+  if (cursor_scale)
+    *cursor_scale = priv->cursor_scale;
+
+  return content;
+}
+
+/**
+ * shell_screenshot_screenshot_area:
+ * @screenshot: the #ShellScreenshot
+ * @x: The X coordinate of the area
+ * @y: The Y coordinate of the area
+ * @width: The width of the area
+ * @height: The height of the area
+ * @stream: The stream for the screenshot
+ * @callback: (scope async): function to call returning success or failure
+ * of the async grabbing
+ * @user_data: the data to pass to callback function
+ *
+ * Takes a screenshot of the passed in area and saves it
+ * in @stream as png image.
+ *
+ */
+void
+shell_screenshot_screenshot_area (ShellScreenshot     *screenshot,
+                                  int                  x,
+                                  int                  y,
+                                  int                  width,
+                                  int                  height,
+                                  GOutputStream       *stream,
+                                  GAsyncReadyCallback  callback,
+                                  gpointer             user_data)
+{
+  ShellScreenshotPrivate *priv;
+  GTask *result;
+
+  g_return_if_fail (SHELL_IS_SCREENSHOT (screenshot));
+  g_return_if_fail (G_IS_OUTPUT_STREAM (stream));
+
+  priv = screenshot->priv;
+
+  if (priv->stream != NULL || priv->raw) {
+    if (callback)
+      g_task_report_new_error (screenshot,
+                               callback,
+                               NULL,
+                               shell_screenshot_screenshot_area,
+                               G_IO_ERROR,
+                               G_IO_ERROR_PENDING,
+                               "Only one screenshot operation at a time "
+                               "is permitted");
+    return;
+  }
+
+  result = g_task_new (screenshot, NULL, callback, user_data);
+  g_task_set_source_tag (result, shell_screenshot_screenshot_area);
+  g_task_set_task_data (result, screenshot, NULL);
+
+  priv->stream = g_object_ref (stream);
+  priv->screenshot_area.x = x;
+  priv->screenshot_area.y = y;
+  priv->screenshot_area.width = width;
+  priv->screenshot_area.height = height;
+
+
+  if (meta_is_wayland_compositor ())
+    {
+      do_grab_screenshot (screenshot,
+                          priv->screenshot_area.x,
+                          priv->screenshot_area.y,
+                          priv->screenshot_area.width,
+                          priv->screenshot_area.height,
+                          SHELL_SCREENSHOT_FLAG_NONE,
+                          write_screenshot, result);
+
+      g_signal_emit (screenshot, signals[SCREENSHOT_TAKEN], 0,
+                     (MtkRectangle *) &priv->screenshot_area);
+    }
+  else
+    {
+      MetaDisplay *display = shell_global_get_display (priv->global);
+      ClutterStage *stage = shell_global_get_stage (priv->global);
+
+      meta_disable_unredirect_for_display (display);
+      clutter_actor_queue_redraw (CLUTTER_ACTOR (stage));
+      priv->flags = SHELL_SCREENSHOT_FLAG_NONE;
+      priv->mode = SHELL_SCREENSHOT_AREA;
+      g_signal_connect (stage, "after-paint",
+                        G_CALLBACK (on_after_paint), result);
+    }
+}
+
+/**
+ * shell_screenshot_screenshot_area_finish:
+ * @screenshot: the #ShellScreenshot
+ * @result: the #GAsyncResult that was provided to the callback
+ * @area: (out) (transfer none): the area that was grabbed in screen coordinates
+ * @error: #GError for error reporting
+ *
+ * Finish the asynchronous operation started by shell_screenshot_screenshot_area()
+ * and obtain its result.
+ *
+ * Returns: whether the operation was successful
+ *
+ */
+gboolean
+shell_screenshot_screenshot_area_finish (ShellScreenshot  *screenshot,
+                                         GAsyncResult     *result,
+                                         MtkRectangle    **area,
+                                         GError          **error)
+{
+  g_return_val_if_fail (SHELL_IS_SCREENSHOT (screenshot), FALSE);
+  g_return_val_if_fail (G_IS_TASK (result), FALSE);
+  g_return_val_if_fail (g_async_result_is_tagged (result,
+                                                  shell_screenshot_screenshot_area),
+                        FALSE);
+  return finish_screenshot (screenshot, result, area, error);
 }
 
 /**
- * shell_screenshot_screenshot_area:
+ * shell_screenshot_screenshot_raw:
  * @screenshot: the #ShellScreenshot
- * @x: The X coordinate of the area
- * @y: The Y coordinate of the area
- * @width: The width of the area
- * @height: The height of the area
- * @stream: The stream for the screenshot
+ * @include_cursor: Whether to include the cursor or not
+ * @area: (nullable): the area to grab, or %NULL for the whole screen
  * @callback: (scope async): function to call returning success or failure
  * of the async grabbing
  * @user_data: the data to pass to callback function
  *
- * Takes a screenshot of the passed in area and saves it
- * in @stream as png image.
+ * Takes a screenshot of @area without encoding it, grabbing the pixels
+ * straight into the memory of a sealed memfd.
  *
  */
 void
-shell_screenshot_screenshot_area (ShellScreenshot     *screenshot,
-                                  int                  x,
-                                  int                  y,
-                                  int                  width,
-                                  int                  height,
-                                  GOutputStream       *stream,
-                                  GAsyncReadyCallback  callback,
-                                  gpointer             user_data)
+shell_screenshot_screenshot_raw (ShellScreenshot     *screenshot,
+                                 gboolean             include_cursor,
+                                 const MtkRectangle  *area,
+                                 GAsyncReadyCallback  callback,
+                                 gpointer             user_data)
 {
   ShellScreenshotPrivate *priv;
+  ShellScreenshotFlag flags;
   GTask *result;
-  g_autoptr (GTask) task = NULL;
 
   g_return_if_fail (SHELL_IS_SCREENSHOT (screenshot));
-  g_return_if_fail (G_IS_OUTPUT_STREAM (stream));
 
   priv = screenshot->priv;
 
-  if (priv->stream != NULL) {
+  if (priv->stream != NULL || priv->raw) {
     if (callback)
       g_task_report_new_error (screenshot,
                                callback,
-                               NULL,
-                               shell_screenshot_screenshot_area,
+                               user_data,
+                               shell_screenshot_screenshot_raw,
                                G_IO_ERROR,
                                G_IO_ERROR_PENDING,
                                "Only one screenshot operation at a time "
@@ -963,15 +2122,29 @@ shell_screenshot_screenshot_area (ShellScreenshot     *screenshot,
   }
 
   result = g_task_new (screenshot, NULL, callback, user_data);
-  g_task_set_source_tag (result, shell_screenshot_screenshot_area);
+  g_task_set_source_tag (result, shell_screenshot_screenshot_raw);
   g_task_set_task_data (result, screenshot, NULL);
 
-  priv->stream = g_object_ref (stream);
-  priv->screenshot_area.x = x;
-  priv->screenshot_area.y = y;
-  priv->screenshot_area.width = width;
-  priv->screenshot_area.height = height;
+  priv->raw = TRUE;
+
+  if (area)
+    {
+      priv->screenshot_area = *area;
+    }
+  else
+    {
+      MetaDisplay *display = shell_global_get_display (priv->global);
+
+      priv->screenshot_area.x = 0;
+      priv->screenshot_area.y = 0;
+      meta_display_get_size (display,
+                             &priv->screenshot_area.width,
+                             &priv->screenshot_area.height);
+    }
 
+  flags = SHELL_SCREENSHOT_FLAG_NONE;
+  if (include_cursor)
+    flags |= SHELL_SCREENSHOT_FLAG_INCLUDE_CURSOR;
 
   if (meta_is_wayland_compositor ())
     {
@@ -980,13 +2153,11 @@ shell_screenshot_screenshot_area (ShellScreenshot     *screenshot,
                           priv->screenshot_area.y,
                           priv->screenshot_area.width,
                           priv->screenshot_area.height,
-                          SHELL_SCREENSHOT_FLAG_NONE);
+                          flags,
+                          seal_raw_screenshot, result);
 
       g_signal_emit (screenshot, signals[SCREENSHOT_TAKEN], 0,
                      (MtkRectangle *) &priv->screenshot_area);
-
-      task = g_task_new (screenshot, NULL, on_screenshot_written, result);
-      g_task_run_in_thread (task, write_screenshot_thread);
     }
   else
     {
@@ -995,7 +2166,7 @@ shell_screenshot_screenshot_area (ShellScreenshot     *screenshot,
 
       meta_disable_unredirect_for_display (display);
       clutter_actor_queue_redraw (CLUTTER_ACTOR (stage));
-      priv->flags = SHELL_SCREENSHOT_FLAG_NONE;
+      priv->flags = flags;
       priv->mode = SHELL_SCREENSHOT_AREA;
       g_signal_connect (stage, "after-paint",
                         G_CALLBACK (on_after_paint), result);
@@ -1003,30 +2174,60 @@ shell_screenshot_screenshot_area (ShellScreenshot     *screenshot,
 }
 
 /**
- * shell_screenshot_screenshot_area_finish:
+ * shell_screenshot_screenshot_raw_finish:
  * @screenshot: the #ShellScreenshot
  * @result: the #GAsyncResult that was provided to the callback
+ * @width: (out): the width of the image, in pixels
+ * @height: (out): the height of the image, in pixels
+ * @stride: (out): the distance between rows of the image, in bytes
  * @area: (out) (transfer none): the area that was grabbed in screen coordinates
  * @error: #GError for error reporting
  *
- * Finish the asynchronous operation started by shell_screenshot_screenshot_area()
+ * Finish the asynchronous operation started by shell_screenshot_screenshot_raw()
  * and obtain its result.
  *
- * Returns: whether the operation was successful
+ * The image is in premultiplied ARGB32 format: every pixel is a 32-bit
+ * value in native byte order, with alpha in the upper 8 bits, like
+ * %CAIRO_FORMAT_ARGB32.
+ *
+ * Returns: a sealed memfd holding the image, owned by the caller, or -1
+ * on error
  *
  */
-gboolean
-shell_screenshot_screenshot_area_finish (ShellScreenshot  *screenshot,
-                                         GAsyncResult     *result,
-                                         MtkRectangle    **area,
-                                         GError          **error)
+int
+shell_screenshot_screenshot_raw_finish (ShellScreenshot  *screenshot,
+                                        GAsyncResult     *result,
+                                        int              *width,
+                                        int              *height,
+                                        int              *stride,
+                                        MtkRectangle    **area,
+                                        GError          **error)
 {
-  g_return_val_if_fail (SHELL_IS_SCREENSHOT (screenshot), FALSE);
-  g_return_val_if_fail (G_IS_TASK (result), FALSE);
+  ShellScreenshotPrivate *priv;
+  int fd;
+
+  g_return_val_if_fail (SHELL_IS_SCREENSHOT (screenshot), -1);
+  g_return_val_if_fail (G_IS_TASK (result), -1);
   g_return_val_if_fail (g_async_result_is_tagged (result,
-                                                  shell_screenshot_screenshot_area),
-                        FALSE);
-  return finish_screenshot (screenshot, result, area, error);
+                                                  shell_screenshot_screenshot_raw),
+                        -1);
+
+  priv = screenshot->priv;
+
+  fd = g_task_propagate_int (G_TASK (result), error);
+  if (fd < 0)
+    return -1;
+
+  if (width)
+    *width = priv->raw_width;
+  if (height)
+    *height = priv->raw_height;
+  if (stride)
+    *stride = priv->raw_stride;
+  if (area)
+    *area = &priv->screenshot_area;
+
+  return fd;
 }
 
 /**
@@ -1063,7 +2264,7 @@ shell_screenshot_screenshot_window (ShellScreenshot     *screenshot,
   display = shell_global_get_display (priv->global);
   window = meta_display_get_focus_window (display);
 
-  if (priv->stream != NULL || !window) {
+  if (priv->stream != NULL || priv->raw || !window) {
     if (callback)
       g_task_report_new_error (screenshot,
                                callback,
@@ -1112,6 +2313,128 @@ shell_screenshot_screenshot_window_finish (ShellScreenshot  *screenshot,
   return finish_screenshot (screenshot, result, area, error);
 }
 
+/* Colors are picked by painting only the picked pixel, into a small
+ * offscreen framebuffer that is kept around for the next pick, and
+ * reading the pixel back asynchronously where possible. No image
+ * surface is involved, so picking as the pointer moves stays cheap.
+ */
+static gboolean
+ensure_pick_framebuffer (ShellScreenshot  *screenshot,
+                         CoglContext      *ctx,
+                         int               width,
+                         int               height,
+                         GError          **error)
+{
+  ShellScreenshotPrivate *priv = screenshot->priv;
+  CoglTexture *texture;
+  CoglOffscreen *offscreen;
+
+  if (priv->pick_framebuffer &&
+      cogl_framebuffer_get_width (priv->pick_framebuffer) == width &&
+      cogl_framebuffer_get_height (priv->pick_framebuffer) == height)
+    return TRUE;
+
+  g_clear_object (&priv->pick_framebuffer);
+
+  texture = cogl_texture_2d_new_with_size (ctx, width, height);
+  offscreen = cogl_offscreen_new_with_texture (texture);
+  g_object_unref (texture);
+
+  if (!cogl_framebuffer_allocate (COGL_FRAMEBUFFER (offscreen), error))
+    {
+      g_object_unref (offscreen);
+      return FALSE;
+    }
+
+  priv->pick_framebuffer = COGL_FRAMEBUFFER (offscreen);
+
+  return TRUE;
+}
+
+static void
+set_picked_color (ShellScreenshot *screenshot,
+                  const guint8    *pixel)
+{
+  ShellScreenshotPrivate *priv = screenshot->priv;
+
+  priv->picked_color.red = pixel[0];
+  priv->picked_color.green = pixel[1];
+  priv->picked_color.blue = pixel[2];
+  priv->picked_color.alpha = pixel[3];
+}
+
+static void
+finish_pick (gpointer data)
+{
+  GTask *result = data;
+  ShellScreenshot *screenshot = g_task_get_source_object (result);
+  CoglBuffer *buffer = COGL_BUFFER (screenshot->priv->pick_buffer);
+  guint8 *pixel;
+
+  screenshot->priv->picking = FALSE;
+
+  pixel = cogl_buffer_map (buffer, COGL_BUFFER_ACCESS_READ, 0);
+  if (pixel)
+    {
+      set_picked_color (screenshot, pixel);
+      cogl_buffer_unmap (buffer);
+      g_task_return_boolean (result, TRUE);
+    }
+  else
+    {
+      g_task_return_new_error (result, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "Picking color failed");
+    }
+
+  g_object_unref (result);
+}
+
+static void
+on_pick_fence (CoglFence *fence,
+               gpointer   user_data)
+{
+  g_idle_add_once (finish_pick, user_data);
+}
+
+static gboolean
+start_pick_readback (ShellScreenshot *screenshot,
+                     CoglContext     *ctx,
+                     GTask           *result)
+{
+  ShellScreenshotPrivate *priv = screenshot->priv;
+  CoglBitmap *bitmap;
+  gboolean read;
+
+  if (!readback_supported ())
+    return FALSE;
+
+  if (!priv->pick_buffer)
+    priv->pick_buffer = cogl_pixel_buffer_new (ctx, 4, NULL);
+
+  bitmap = cogl_bitmap_new_from_buffer (COGL_BUFFER (priv->pick_buffer),
+                                        COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                        1, 1, 4, 0);
+  read = cogl_framebuffer_read_pixels_into_bitmap (priv->pick_framebuffer,
+                                                   0, 0,
+                                                   COGL_READ_PIXELS_COLOR_BUFFER,
+                                                   bitmap);
+  g_object_unref (bitmap);
+
+  if (!read)
+    return FALSE;
+
+  priv->picking = TRUE;
+
+  if (cogl_framebuffer_add_fence_callback (priv->pick_framebuffer,
+                                           on_pick_fence,
+                                           g_object_ref (result)))
+    cogl_framebuffer_flush (priv->pick_framebuffer);
+  else
+    finish_pick (g_object_ref (result));
+
+  return TRUE;
+}
+
 /**
  * shell_screenshot_pick_color:
  * @screenshot: the #ShellScreenshot
@@ -1131,7 +2454,14 @@ shell_screenshot_pick_color (ShellScreenshot     *screenshot,
                              gpointer             user_data)
 {
   ShellScreenshotPrivate *priv;
+  ClutterStage *stage;
+  CoglContext *ctx;
+  MtkRectangle rect = { x, y, 1, 1 };
+  int width, height;
+  float scale;
+  guint8 pixel[4];
   g_autoptr (GTask) result = NULL;
+  g_autoptr (GError) error = NULL;
 
   g_return_if_fail (SHELL_IS_SCREENSHOT (screenshot));
 
@@ -1140,33 +2470,46 @@ shell_screenshot_pick_color (ShellScreenshot     *screenshot,
 
   priv = screenshot->priv;
 
-  priv->screenshot_area.x = x;
-  priv->screenshot_area.y = y;
-  priv->screenshot_area.width = 1;
-  priv->screenshot_area.height = 1;
+  if (priv->picking)
+    {
+      g_task_return_new_error (result, G_IO_ERROR, G_IO_ERROR_PENDING,
+                               "A color is already being picked");
+      return;
+    }
 
-  do_grab_screenshot (screenshot,
-                      priv->screenshot_area.x,
-                      priv->screenshot_area.y,
-                      1,
-                      1,
-                      SHELL_SCREENSHOT_FLAG_NONE);
+  stage = shell_global_get_stage (priv->global);
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+  /* Paint at the scale of the monitor, so that the pixel is the one
+   * shown rather than a blend of its neighbors */
+  clutter_stage_get_capture_final_size (stage, &rect, &width, &height, &scale);
+
+  if (!ensure_pick_framebuffer (screenshot, ctx, width, height, &error))
+    {
+      g_task_return_error (result, g_steal_pointer (&error));
+      return;
+    }
+
+  clutter_stage_paint_to_framebuffer (stage, priv->pick_framebuffer,
+                                      &rect, scale,
+                                      CLUTTER_PAINT_FLAG_NO_CURSORS);
+
+  if (start_pick_readback (screenshot, ctx, result))
+    return;
+
+  if (!cogl_framebuffer_read_pixels (priv->pick_framebuffer, 0, 0, 1, 1,
+                                     COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                     pixel))
+    {
+      g_task_return_new_error (result, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "Picking color failed");
+      return;
+    }
 
+  set_picked_color (screenshot, pixel);
   g_task_return_boolean (result, TRUE);
 }
 
-#if G_BYTE_ORDER == G_LITTLE_ENDIAN
-#define INDEX_A 3
-#define INDEX_R 2
-#define INDEX_G 1
-#define INDEX_B 0
-#else
-#define INDEX_A 0
-#define INDEX_R 1
-#define INDEX_G 2
-#define INDEX_B 3
-#endif
-
 /**
  * shell_screenshot_pick_color_finish:
  * @screenshot: the #ShellScreenshot
@@ -1186,8 +2529,6 @@ shell_screenshot_pick_color_finish (ShellScreenshot  *screenshot,
                                     CoglColor        *color,
                                     GError          **error)
 {
-  ShellScreenshotPrivate *priv;
-
   g_return_val_if_fail (SHELL_IS_SCREENSHOT (screenshot), FALSE);
   g_return_val_if_fail (G_IS_TASK (result), FALSE);
   g_return_val_if_fail (color != NULL, FALSE);
@@ -1198,29 +2539,11 @@ shell_screenshot_pick_color_finish (ShellScreenshot  *screenshot,
   if (!g_task_propagate_boolean (G_TASK (result), error))
     return FALSE;
 
-  priv = screenshot->priv;
-
-  /* protect against mutter changing the format used for stage captures */
-  g_assert (cairo_image_surface_get_format (priv->image) == CAIRO_FORMAT_ARGB32);
-
-  if (color)
-    {
-      uint8_t *data = cairo_image_surface_get_data (priv->image);
-
-      color->alpha = data[INDEX_A];
-      color->red   = data[INDEX_R];
-      color->green = data[INDEX_G];
-      color->blue  = data[INDEX_B];
-    }
+  *color = screenshot->priv->picked_color;
 
   return TRUE;
 }
 
-#undef INDEX_A
-#undef INDEX_R
-#undef INDEX_G
-#undef INDEX_B
-
 static void
 composite_to_stream_on_png_saved (GObject      *pixbuf,
                                   GAsyncResult *result,
@@ -1237,6 +2560,92 @@ composite_to_stream_on_png_saved (GObject      *pixbuf,
   g_object_unref (task);
 }
 
+/* Longest side of the preview shown in the screenshot notification */
+#define PREVIEW_SIZE 256
+
+/* Scales the composited screenshot down on the GPU, so that only the
+ * pixels of the preview are read back and uploaded again.
+ */
+static ClutterContent *
+create_preview (CoglContext *ctx,
+                CoglTexture *texture)
+{
+  int width = cogl_texture_get_width (texture);
+  int height = cogl_texture_get_height (texture);
+  int preview_width, preview_height, stride;
+  CoglTexture *target;
+  CoglOffscreen *offscreen;
+  CoglFramebuffer *framebuffer;
+  CoglPipeline *pipeline;
+  ClutterContent *preview;
+  g_autofree guint8 *pixels = NULL;
+  g_autoptr (GError) error = NULL;
+
+  if (width >= height)
+    {
+      preview_width = MIN (width, PREVIEW_SIZE);
+      preview_height = MAX (roundf (height * (float) preview_width / width), 1);
+    }
+  else
+    {
+      preview_height = MIN (height, PREVIEW_SIZE);
+      preview_width = MAX (roundf (width * (float) preview_height / height), 1);
+    }
+
+  target = cogl_texture_2d_new_with_size (ctx, preview_width, preview_height);
+  offscreen = cogl_offscreen_new_with_texture (target);
+  framebuffer = COGL_FRAMEBUFFER (offscreen);
+  g_object_unref (target);
+
+  if (!cogl_framebuffer_allocate (framebuffer, &error))
+    {
+      g_warning ("Failed to create screenshot preview: %s", error->message);
+      g_object_unref (offscreen);
+      return NULL;
+    }
+
+  cogl_framebuffer_orthographic (framebuffer, 0, 0,
+                                 preview_width, preview_height, -1, 1);
+
+  pipeline = cogl_pipeline_new (ctx);
+  cogl_pipeline_set_layer_texture (pipeline, 0, texture);
+  cogl_pipeline_set_layer_filters (pipeline, 0,
+                                   COGL_PIPELINE_FILTER_LINEAR_MIPMAP_LINEAR,
+                                   COGL_PIPELINE_FILTER_LINEAR);
+  cogl_pipeline_set_blend (pipeline, "RGBA = ADD (SRC_COLOR, 0)", NULL);
+  cogl_framebuffer_draw_rectangle (framebuffer, pipeline,
+                                   0, 0, preview_width, preview_height);
+  g_object_unref (pipeline);
+
+  stride = preview_width * 4;
+  pixels = g_malloc (stride * preview_height);
+
+  if (!cogl_framebuffer_read_pixels (framebuffer, 0, 0,
+                                     preview_width, preview_height,
+                                     COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                     pixels))
+    {
+      g_warning ("Failed to create screenshot preview: Could not read pixels");
+      g_object_unref (offscreen);
+      return NULL;
+    }
+
+  g_object_unref (offscreen);
+
+  preview = st_image_content_new_with_preferred_size (preview_width,
+                                                      preview_height);
+  if (!clutter_image_set_data (CLUTTER_IMAGE (preview), pixels,
+                               COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                               preview_width, preview_height, stride,
+                               &error))
+    {
+      g_warning ("Failed to create screenshot preview: %s", error->message);
+      g_clear_object (&preview);
+    }
+
+  return preview;
+}
+
 /**
  * shell_screenshot_composite_to_stream:
  * @texture: the source texture
@@ -1256,7 +2665,9 @@ composite_to_stream_on_png_saved (GObject      *pixbuf,
  * @user_data: the data to pass to callback function
  *
  * Composite a rectangle defined by x, y, width, height from the texture to a
- * pixbuf and write it as a PNG image into the stream.
+ * pixbuf and write it as a PNG image into the stream. A downscaled preview
+ * of the image is made along the way, see
+ * shell_screenshot_composite_to_stream_finish().
  *
  */
 void
@@ -1275,14 +2686,18 @@ shell_screenshot_composite_to_stream (CoglTexture         *texture,
                                       gpointer             user_data)
 {
   CoglContext *ctx;
-  CoglTexture *sub_texture;
+  CoglTexture *target;
+  CoglOffscreen *offscreen;
+  CoglFramebuffer *framebuffer;
+  CoglPipeline *pipeline;
+  ClutterContent *preview;
   cairo_surface_t *surface;
-  cairo_surface_t *cursor_surface;
-  cairo_t *cr;
+  float texture_width, texture_height;
   g_autoptr (GTask) task = NULL;
   g_autoptr (GdkPixbuf) pixbuf = NULL;
   g_autofree char *creation_time = NULL;
   g_autoptr (GDateTime) date_time = NULL;
+  g_autoptr (GError) error = NULL;
 
   task = g_task_new (NULL, NULL, callback, user_data);
   g_task_set_source_tag (task, shell_screenshot_composite_to_stream);
@@ -1295,47 +2710,80 @@ shell_screenshot_composite_to_stream (CoglTexture         *texture,
       height = cogl_texture_get_height (texture);
     }
 
+  /* Crop and draw the cursor on the GPU, so that only the selected
+   * area is read back, once.
+   */
   ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
-  sub_texture = cogl_sub_texture_new (ctx, texture, x, y, width, height);
+  target = cogl_texture_2d_new_with_size (ctx, width, height);
+  offscreen = cogl_offscreen_new_with_texture (target);
+  framebuffer = COGL_FRAMEBUFFER (offscreen);
+  g_object_unref (target);
 
-  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-                                        cogl_texture_get_width (sub_texture),
-                                        cogl_texture_get_height (sub_texture));
-
-  cogl_texture_get_data (sub_texture, COGL_PIXEL_FORMAT_CAIRO_ARGB32_COMPAT,
-                         cairo_image_surface_get_stride (surface),
-                         cairo_image_surface_get_data (surface));
-  cairo_surface_mark_dirty (surface);
-
-  g_object_unref (sub_texture);
+  if (!cogl_framebuffer_allocate (framebuffer, &error))
+    {
+      g_object_unref (offscreen);
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
 
-  cairo_surface_set_device_scale (surface, scale, scale);
+  cogl_framebuffer_orthographic (framebuffer, 0, 0, width, height, -1, 1);
+  cogl_framebuffer_clear4f (framebuffer, COGL_BUFFER_BIT_COLOR, 0, 0, 0, 0);
+
+  texture_width = cogl_texture_get_width (texture);
+  texture_height = cogl_texture_get_height (texture);
+
+  pipeline = cogl_pipeline_new (ctx);
+  cogl_pipeline_set_layer_texture (pipeline, 0, texture);
+  cogl_pipeline_set_layer_filters (pipeline, 0,
+                                   COGL_PIPELINE_FILTER_NEAREST,
+                                   COGL_PIPELINE_FILTER_NEAREST);
+  cogl_pipeline_set_blend (pipeline, "RGBA = ADD (SRC_COLOR, 0)", NULL);
+  cogl_framebuffer_draw_textured_rectangle (framebuffer, pipeline,
+                                            0, 0, width, height,
+                                            x / texture_width,
+                                            y / texture_height,
+                                            (x + width) / texture_width,
+                                            (y + height) / texture_height);
+  g_object_unref (pipeline);
 
   if (cursor != NULL)
     {
-      // Paint the cursor on top.
-      cursor_surface =
-        cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-                                    cogl_texture_get_width (cursor),
-                                    cogl_texture_get_height (cursor));
-      cogl_texture_get_data (cursor, COGL_PIXEL_FORMAT_CAIRO_ARGB32_COMPAT,
-                             cairo_image_surface_get_stride (cursor_surface),
-                             cairo_image_surface_get_data (cursor_surface));
-      cairo_surface_mark_dirty (cursor_surface);
+      // Paint the cursor on top, at the size it has on the source texture.
+      float cursor_width =
+        cogl_texture_get_width (cursor) * cursor_scale * scale;
+      float cursor_height =
+        cogl_texture_get_height (cursor) * cursor_scale * scale;
 
-      cairo_surface_set_device_scale (cursor_surface,
-                                      1 / cursor_scale,
-                                      1 / cursor_scale);
+      pipeline = cogl_pipeline_new (ctx);
+      cogl_pipeline_set_layer_texture (pipeline, 0, cursor);
+      cogl_framebuffer_draw_textured_rectangle (framebuffer, pipeline,
+                                                cursor_x - x,
+                                                cursor_y - y,
+                                                cursor_x - x + cursor_width,
+                                                cursor_y - y + cursor_height,
+                                                0, 0, 1, 1);
+      g_object_unref (pipeline);
+    }
 
-      cr = cairo_create (surface);
-      cairo_set_source_surface (cr, cursor_surface,
-                                (cursor_x - x) / scale,
-                                (cursor_y - y) / scale);
-      cairo_paint (cr);
-      cairo_destroy (cr);
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
 
-      cairo_surface_destroy (cursor_surface);
+  if (!cogl_framebuffer_read_pixels (framebuffer, 0, 0, width, height,
+                                     COGL_PIXEL_FORMAT_CAIRO_ARGB32_COMPAT,
+                                     cairo_image_surface_get_data (surface)))
+    {
+      cairo_surface_destroy (surface);
+      g_object_unref (offscreen);
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "Failed to read back the screenshot");
+      return;
     }
+  cairo_surface_mark_dirty (surface);
+
+  preview = create_preview (ctx, target);
+  if (preview)
+    g_task_set_task_data (task, preview, g_object_unref);
+
+  g_object_unref (offscreen);
 
   /* Save to an image. */
   pixbuf = util_pixbuf_from_surface (surface,
@@ -1361,6 +2809,8 @@ shell_screenshot_composite_to_stream (CoglTexture         *texture,
 /**
  * shell_screenshot_composite_to_stream_finish:
  * @result: the #GAsyncResult that was provided to the callback
+ * @preview: (out) (optional) (nullable) (transfer full): return location
+ *   for a preview of the image, at most 256 pixels wide and high
  * @error: #GError for error reporting
  *
  * Finish the asynchronous operation started by
@@ -1371,15 +2821,27 @@ shell_screenshot_composite_to_stream (CoglTexture         *texture,
  *
  */
 GdkPixbuf *
-shell_screenshot_composite_to_stream_finish (GAsyncResult  *result,
-                                             GError       **error)
+shell_screenshot_composite_to_stream_finish (GAsyncResult    *result,
+                                             ClutterContent **preview,
+                                             GError         **error)
 {
+  GdkPixbuf *pixbuf;
+
   g_return_val_if_fail (G_IS_TASK (result), FALSE);
   g_return_val_if_fail (g_async_result_is_tagged (result,
                                                   shell_screenshot_composite_to_stream),
                         FALSE);
 
-  return g_task_propagate_pointer (G_TASK (result), error);
+  pixbuf = g_task_propagate_pointer (G_TASK (result), error);
+
+  if (preview)
+    {
+      ClutterContent *content = g_task_get_task_data (G_TASK (result));
+
+      *preview = pixbuf && content ? g_object_ref (content) : NULL;
+    }
+
+  return pixbuf;
 }
 
 ShellScreenshot *
@@ -1387,3 +2849,40 @@ shell_screenshot_new (void)
 {
   return g_object_new (SHELL_TYPE_SCREENSHOT, NULL);
 }
+
+/**
+ * shell_screenshot_set_format:
+ * @screenshot: the #ShellScreenshot
+ * @format: the image format to write
+ *
+ * Sets the image format of the screenshots written by @screenshot,
+ * %SHELL_SCREENSHOT_FORMAT_PNG by default.
+ */
+void
+shell_screenshot_set_format (ShellScreenshot       *screenshot,
+                             ShellScreenshotFormat  format)
+{
+  g_return_if_fail (SHELL_IS_SCREENSHOT (screenshot));
+
+  screenshot->priv->format = format;
+}
+
+/**
+ * shell_screenshot_set_compression_level:
+ * @screenshot: the #ShellScreenshot
+ * @level: the compression level, from 0 (none) to 9 (best), or -1 for
+ *   the default
+ *
+ * Sets the compression level of PNG screenshots written by @screenshot.
+ * Level 1 is several times faster than the default on large screens,
+ * for somewhat larger files.
+ */
+void
+shell_screenshot_set_compression_level (ShellScreenshot *screenshot,
+                                        int              level)
+{
+  g_return_if_fail (SHELL_IS_SCREENSHOT (screenshot));
+  g_return_if_fail (level >= -1 && level <= 9);
+
+  screenshot->priv->compression_level = level;
+}
@@ -16,8 +16,26 @@
 G_DECLARE_FINAL_TYPE (ShellScreenshot, shell_screenshot,
                       SHELL, SCREENSHOT, GObject)
 
+/**
+ * ShellScreenshotFormat:
+ * @SHELL_SCREENSHOT_FORMAT_PNG: PNG image
+ * @SHELL_SCREENSHOT_FORMAT_QOI: "Quite OK Image" format, lossless and much
+ *   faster to encode than PNG, at the cost of larger files
+ *
+ * The image format screenshots are written in.
+ */
+typedef enum {
+  SHELL_SCREENSHOT_FORMAT_PNG,
+  SHELL_SCREENSHOT_FORMAT_QOI
+} ShellScreenshotFormat;
+
 ShellScreenshot *shell_screenshot_new (void);
 
+void    shell_screenshot_set_format           (ShellScreenshot       *screenshot,
+                                               ShellScreenshotFormat  format);
+void    shell_screenshot_set_compression_level (ShellScreenshot *screenshot,
+                                                int              level);
+
 void    shell_screenshot_screenshot_area      (ShellScreenshot      *screenshot,
                                                int                   x,
                                                int                   y,
@@ -31,6 +49,19 @@ gboolean shell_screenshot_screenshot_area_finish (ShellScreenshot  *screenshot,
                                                   MtkRectangle    **area,
                                                   GError          **error);
 
+void    shell_screenshot_screenshot_raw       (ShellScreenshot     *screenshot,
+                                               gboolean             include_cursor,
+                                               const MtkRectangle  *area,
+                                               GAsyncReadyCallback  callback,
+                                               gpointer             user_data);
+int      shell_screenshot_screenshot_raw_finish (ShellScreenshot  *screenshot,
+                                                 GAsyncResult     *result,
+                                                 int              *width,
+                                                 int              *height,
+                                                 int              *stride,
+                                                 MtkRectangle    **area,
+                                                 GError          **error);
+
 void    shell_screenshot_screenshot_window    (ShellScreenshot     *screenshot,
                                                gboolean             include_frame,
                                                gboolean             include_cursor,
@@ -86,7 +117,8 @@ void shell_screenshot_composite_to_stream (CoglTexture         *texture,
                                            GOutputStream       *stream,
                                            GAsyncReadyCallback  callback,
                                            gpointer             user_data);
-GdkPixbuf *shell_screenshot_composite_to_stream_finish (GAsyncResult  *result,
-                                                        GError       **error);
+GdkPixbuf *shell_screenshot_composite_to_stream_finish (GAsyncResult    *result,
+                                                        ClutterContent **preview,
+                                                        GError         **error);
 
 #endif /* ___SHELL_SCREENSHOT_H__ */
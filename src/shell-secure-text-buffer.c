@@ -39,10 +39,125 @@ struct _ShellSecureTextBuffer {
 };
 
 /* Initial size of buffer, in bytes */
-#define MIN_SIZE 16
+#define MIN_SIZE 64
 
 G_DEFINE_TYPE (ShellSecureTextBuffer, shell_secure_text_buffer, CLUTTER_TYPE_TEXT_BUFFER);
 
+/* Passwords typed into prompts are kept in slots of a secure memory
+ * arena that is allocated once and never released, so that prompts
+ * neither lock pages nor allocate as text is typed, and the locked
+ * memory doesn't depend on how many prompts were shown. Slots are wiped
+ * when the text moves to another one or the buffer goes away. Longer
+ * text, or text of more buffers than there are slots, falls back to
+ * allocating secure memory.
+ */
+typedef struct {
+  gsize size;
+  guint n_slots;
+} SizeClass;
+
+static const SizeClass size_classes[] = {
+  { 64, 8 },
+  { 256, 4 },
+  { 1024, 2 },
+};
+
+static gchar *arena = NULL;
+static gsize arena_size = 0;
+/* One bit per slot, in the order of the size classes */
+static guint32 arena_used = 0;
+
+static gboolean
+arena_contains (const gchar *text)
+{
+  return arena != NULL && text >= arena && text < arena + arena_size;
+}
+
+static void
+ensure_arena (void)
+{
+  guint i;
+
+  if (arena != NULL)
+    return;
+
+  for (i = 0; i < G_N_ELEMENTS (size_classes); i++)
+    arena_size += size_classes[i].size * size_classes[i].n_slots;
+
+  arena = gcr_secure_memory_alloc (arena_size);
+}
+
+/* Allocates at least *size bytes, and sets *size to what was allocated */
+static gchar *
+secure_text_alloc (gsize *size)
+{
+  gsize offset = 0;
+  guint slot = 0;
+  guint i, j;
+
+  ensure_arena ();
+
+  for (i = 0; i < G_N_ELEMENTS (size_classes); i++)
+    {
+      const SizeClass *size_class = &size_classes[i];
+
+      if (size_class->size < *size)
+        {
+          offset += size_class->size * size_class->n_slots;
+          slot += size_class->n_slots;
+          continue;
+        }
+
+      for (j = 0; j < size_class->n_slots; j++, slot++)
+        {
+          if (arena_used & (1u << slot))
+            continue;
+
+          arena_used |= 1u << slot;
+          *size = size_class->size;
+          return arena + offset + j * size_class->size;
+        }
+
+      /* Try the larger size classes, rather than allocating */
+      offset += size_class->size * size_class->n_slots;
+    }
+
+  return gcr_secure_memory_alloc (*size);
+}
+
+static void
+secure_text_free (gchar *text,
+                  gsize  size)
+{
+  gsize offset = 0;
+  guint slot = 0;
+  guint i;
+
+  if (!arena_contains (text))
+    {
+      gcr_secure_memory_free (text);
+      return;
+    }
+
+  memset (text, 0, size);
+
+  for (i = 0; i < G_N_ELEMENTS (size_classes); i++)
+    {
+      const SizeClass *size_class = &size_classes[i];
+      gsize class_size = size_class->size * size_class->n_slots;
+
+      if (text < arena + offset + class_size)
+        {
+          slot += (text - arena - offset) / size_class->size;
+          arena_used &= ~(1u << slot);
+          return;
+        }
+
+      offset += class_size;
+      slot += size_class->n_slots;
+    }
+}
+
 static const gchar *
 shell_secure_text_buffer_real_get_text (ClutterTextBuffer *buffer,
                                         gsize             *n_bytes)
@@ -77,6 +192,8 @@ shell_secure_text_buffer_real_insert_text (ClutterTextBuffer *buffer,
   /* Need more memory */
   if (n_bytes + self->text_bytes + 1 > self->text_size)
     {
+      gsize old_size = self->text_size;
+
       /* Calculate our new buffer size */
       while (n_bytes + self->text_bytes + 1 > self->text_size)
         {
@@ -103,7 +220,19 @@ shell_secure_text_buffer_real_insert_text (ClutterTextBuffer *buffer,
                 }
             }
         }
-      self->text = gcr_secure_memory_realloc (self->text, self->text_size);
+
+      if (self->text)
+        {
+          gchar *text = secure_text_alloc (&self->text_size);
+
+          memcpy (text, self->text, self->text_bytes + 1);
+          secure_text_free (self->text, old_size);
+          self->text = text;
+        }
+      else
+        {
+          self->text = secure_text_alloc (&self->text_size);
+        }
     }
 
   /* Actual text insertion */
@@ -161,7 +290,7 @@ shell_secure_text_buffer_finalize (GObject *obj)
 
   if (self->text)
     {
-      gcr_secure_memory_strfree (self->text);
+      secure_text_free (self->text, self->text_size);
       self->text = NULL;
       self->text_bytes = self->text_size = 0;
       self->text_chars = 0;
@@ -0,0 +1,237 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/**
+ * ShellThumbnailEffect:
+ *
+ * An offscreen effect for small previews of live contents, like the
+ * windows in workspace thumbnails.
+ *
+ * The actor is rendered into an offscreen, which is painted instead of
+ * the actor until the actor is damaged. Damage is only picked up once
+ * per update interval, so that windows which redraw all the time don't
+ * have their previews rendered again on every frame.
+ */
+
+#include "config.h"
+
+#include "shell-thumbnail-effect.h"
+
+#define DEFAULT_UPDATE_INTERVAL_MS 200
+
+struct _ShellThumbnailEffect
+{
+  ClutterOffscreenEffect parent_instance;
+
+  unsigned int update_interval;
+
+  int64_t last_update_us;
+  guint update_id;
+};
+
+enum
+{
+  PROP_0,
+
+  PROP_UPDATE_INTERVAL,
+
+  N_PROPS
+};
+
+static GParamSpec *properties[N_PROPS] = { NULL, };
+
+G_DEFINE_FINAL_TYPE (ShellThumbnailEffect, shell_thumbnail_effect,
+                     CLUTTER_TYPE_OFFSCREEN_EFFECT)
+
+static void
+on_update_timeout (gpointer user_data)
+{
+  ShellThumbnailEffect *self = user_data;
+  ClutterActor *actor;
+
+  self->update_id = 0;
+
+  /* Effects can't queue a redraw of the actor itself, so the actor
+   * would be painted from the offscreen again */
+  actor = clutter_actor_meta_get_actor (CLUTTER_ACTOR_META (self));
+  if (actor != NULL)
+    clutter_actor_queue_redraw (actor);
+}
+
+static void
+shell_thumbnail_effect_paint (ClutterEffect           *effect,
+                              ClutterPaintNode        *node,
+                              ClutterPaintContext     *paint_context,
+                              ClutterEffectPaintFlags  flags)
+{
+  ShellThumbnailEffect *self = SHELL_THUMBNAIL_EFFECT (effect);
+  ClutterOffscreenEffect *offscreen_effect = CLUTTER_OFFSCREEN_EFFECT (effect);
+  ClutterEffectClass *parent_class =
+    CLUTTER_EFFECT_CLASS (shell_thumbnail_effect_parent_class);
+
+  if ((flags & CLUTTER_EFFECT_PAINT_ACTOR_DIRTY) != 0 &&
+      clutter_offscreen_effect_get_texture (offscreen_effect) != NULL)
+    {
+      int64_t now_us = g_get_monotonic_time ();
+      int64_t next_update_us =
+        self->last_update_us + (int64_t) self->update_interval * 1000;
+
+      if (now_us < next_update_us)
+        {
+          /* Paint what is there, and pick up the damage later */
+          if (self->update_id == 0)
+            {
+              self->update_id =
+                g_timeout_add_once ((next_update_us - now_us) / 1000 + 1,
+                                    on_update_timeout, self);
+              g_source_set_name_by_id (self->update_id,
+                                       "[gnome-shell] thumbnail effect update");
+            }
+
+          flags &= ~CLUTTER_EFFECT_PAINT_ACTOR_DIRTY;
+        }
+      else
+        {
+          self->last_update_us = now_us;
+        }
+    }
+  else if ((flags & CLUTTER_EFFECT_PAINT_ACTOR_DIRTY) != 0)
+    {
+      self->last_update_us = g_get_monotonic_time ();
+    }
+
+  parent_class->paint (effect, node, paint_context, flags);
+}
+
+static void
+shell_thumbnail_effect_set_actor (ClutterActorMeta *meta,
+                                  ClutterActor     *actor)
+{
+  ShellThumbnailEffect *self = SHELL_THUMBNAIL_EFFECT (meta);
+
+  g_clear_handle_id (&self->update_id, g_source_remove);
+  self->last_update_us = 0;
+
+  CLUTTER_ACTOR_META_CLASS (shell_thumbnail_effect_parent_class)->set_actor (meta, actor);
+}
+
+static void
+shell_thumbnail_effect_dispose (GObject *object)
+{
+  ShellThumbnailEffect *self = SHELL_THUMBNAIL_EFFECT (object);
+
+  g_clear_handle_id (&self->update_id, g_source_remove);
+
+  G_OBJECT_CLASS (shell_thumbnail_effect_parent_class)->dispose (object);
+}
+
+static void
+shell_thumbnail_effect_get_property (GObject    *object,
+                                     guint       prop_id,
+                                     GValue     *value,
+                                     GParamSpec *pspec)
+{
+  ShellThumbnailEffect *self = SHELL_THUMBNAIL_EFFECT (object);
+
+  switch (prop_id)
+    {
+    case PROP_UPDATE_INTERVAL:
+      g_value_set_uint (value, self->update_interval);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+shell_thumbnail_effect_set_property (GObject      *object,
+                                     guint         prop_id,
+                                     const GValue *value,
+                                     GParamSpec   *pspec)
+{
+  ShellThumbnailEffect *self = SHELL_THUMBNAIL_EFFECT (object);
+
+  switch (prop_id)
+    {
+    case PROP_UPDATE_INTERVAL:
+      shell_thumbnail_effect_set_update_interval (self, g_value_get_uint (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+shell_thumbnail_effect_class_init (ShellThumbnailEffectClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  ClutterActorMetaClass *meta_class = CLUTTER_ACTOR_META_CLASS (klass);
+  ClutterEffectClass *effect_class = CLUTTER_EFFECT_CLASS (klass);
+
+  object_class->dispose = shell_thumbnail_effect_dispose;
+  object_class->get_property = shell_thumbnail_effect_get_property;
+  object_class->set_property = shell_thumbnail_effect_set_property;
+
+  meta_class->set_actor = shell_thumbnail_effect_set_actor;
+
+  effect_class->paint = shell_thumbnail_effect_paint;
+
+  /**
+   * ShellThumbnailEffect:update-interval:
+   *
+   * The minimum time between two renderings of the actor, in
+   * milliseconds
+   */
+  properties[PROP_UPDATE_INTERVAL] =
+    g_param_spec_uint ("update-interval", NULL, NULL,
+                       0, G_MAXUINT, DEFAULT_UPDATE_INTERVAL_MS,
+                       G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_EXPLICIT_NOTIFY);
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+static void
+shell_thumbnail_effect_init (ShellThumbnailEffect *self)
+{
+  self->update_interval = DEFAULT_UPDATE_INTERVAL_MS;
+}
+
+/**
+ * shell_thumbnail_effect_new:
+ *
+ * Returns: (transfer full): a new #ShellThumbnailEffect
+ */
+ClutterEffect *
+shell_thumbnail_effect_new (void)
+{
+  return g_object_new (SHELL_TYPE_THUMBNAIL_EFFECT, NULL);
+}
+
+unsigned int
+shell_thumbnail_effect_get_update_interval (ShellThumbnailEffect *self)
+{
+  g_return_val_if_fail (SHELL_IS_THUMBNAIL_EFFECT (self), 0);
+
+  return self->update_interval;
+}
+
+/**
+ * shell_thumbnail_effect_set_update_interval:
+ * @self: a #ShellThumbnailEffect
+ * @interval_ms: the minimum time between two renderings, in milliseconds
+ *
+ * Sets how often the actor is rendered again at most, when damaged.
+ */
+void
+shell_thumbnail_effect_set_update_interval (ShellThumbnailEffect *self,
+                                            unsigned int          interval_ms)
+{
+  g_return_if_fail (SHELL_IS_THUMBNAIL_EFFECT (self));
+
+  if (self->update_interval == interval_ms)
+    return;
+
+  self->update_interval = interval_ms;
+  g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_UPDATE_INTERVAL]);
+}
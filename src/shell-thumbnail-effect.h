@@ -0,0 +1,18 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+#pragma once
+
+#include <clutter/clutter.h>
+
+G_BEGIN_DECLS
+
+#define SHELL_TYPE_THUMBNAIL_EFFECT (shell_thumbnail_effect_get_type ())
+G_DECLARE_FINAL_TYPE (ShellThumbnailEffect, shell_thumbnail_effect,
+                      SHELL, THUMBNAIL_EFFECT, ClutterOffscreenEffect)
+
+ClutterEffect *shell_thumbnail_effect_new (void);
+
+unsigned int shell_thumbnail_effect_get_update_interval (ShellThumbnailEffect *self);
+void         shell_thumbnail_effect_set_update_interval (ShellThumbnailEffect *self,
+                                                         unsigned int          interval_ms);
+
+G_END_DECLS
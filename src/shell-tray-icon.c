@@ -20,6 +20,14 @@ enum {
 
 typedef struct _ShellTrayIconPrivate ShellTrayIconPrivate;
 
+/* Each icon is embedded in a socket window of its own, placed where the
+ * icon shows on the stage, and painted by cloning the window actor of
+ * that socket. Sharing one window between the icons would save the
+ * compositing of a window each, but icons place their menus by the
+ * position of their window, which would then be that of the shared
+ * one rather than their own.
+ */
+
 struct _ShellTrayIcon
 {
   ClutterClone parent;
@@ -0,0 +1,679 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+
+/* Window Thumbnail Layout Algorithm
+ * =================================
+ *
+ * General overview
+ * ----------------
+ *
+ * The window thumbnail layout algorithm calculates some optimal layout
+ * by computing layouts with some number of rows, calculating how good
+ * each layout is, and stopping iterating when it finds one that is worse
+ * than the previous layout. A layout consists of which windows are in
+ * which rows, row sizes and other general state tracking that would make
+ * calculating window positions from this information fairly easy.
+ *
+ * After a layout is computed that's considered the best layout, we
+ * compute the layout scale to fit it in the area, and then compute
+ * slots (sizes and positions) for each thumbnail.
+ *
+ * Layout generation
+ * -----------------
+ *
+ * Layout generation is naive and simple: we simply add windows to a row
+ * until we've added too many windows to a row, and then make a new row,
+ * until we have our required N rows. The potential issue with this strategy
+ * is that we may have too many windows at the bottom in some pathological
+ * cases, which tends to make the thumbnails have the shape of a pile of
+ * sand with a peak, with one window at the top.
+ *
+ * Scaling factors
+ * ---------------
+ *
+ * Thumbnail position is mostly straightforward -- the main issue is
+ * computing an optimal scale for each window that fits the constraints,
+ * and doesn't make the thumbnail too small to see. There are two factors
+ * involved in thumbnail scale to make sure that these two goals are met:
+ * the window scale (calculated when the windows are set) and the layout
+ * scale (calculated by compute_scale_and_space()).
+ *
+ * The calculation logic becomes slightly more complicated because row
+ * and column spacing are not scaled, they're constant, so we can't
+ * simply generate a bunch of window positions and then scale it. In
+ * practice, it's not too bad -- we can simply try to fit the layout
+ * in the input area minus whatever spacing we have, and then add
+ * it back afterwards.
+ *
+ * The window scale is constant for the window's size regardless of the
+ * input area or the layout scale or rows or anything else, and right
+ * now just enlarges the window if it's too small. The fact that this
+ * factor is stable makes it easy to calculate, so there's no sense
+ * in not applying it in most calculations.
+ *
+ * The layout scale depends on the input area, the rows, etc, but is the
+ * same for the entire layout, rather than being per-window. After
+ * generating the rows of windows, we basically do some basic math to
+ * fit the full, unscaled layout to the input area, as described above.
+ *
+ * With these two factors combined, the final scale of each thumbnail is
+ * simply windowScale * layoutScale... almost.
+ *
+ * There's one additional constraint: the thumbnail scale must never be
+ * larger than WINDOW_PREVIEW_MAXIMUM_SCALE, which means that the inequality:
+ *
+ *   windowScale * layoutScale <= WINDOW_PREVIEW_MAXIMUM_SCALE
+ *
+ * must always be true. This is for each individual window -- while we
+ * could adjust layoutScale to make the largest thumbnail smaller than
+ * WINDOW_PREVIEW_MAXIMUM_SCALE, it would shrink windows which are already
+ * under the inequality. To solve this, we simply cheat: we simply keep
+ * each window's "cell" area to be the same, but we shrink the thumbnail
+ * and center it horizontally, and align it to the bottom vertically.
+ *
+ * Caching
+ * -------
+ *
+ * Workspaces lay out their windows for every monitor and every frame
+ * of the overview transition, so the layout is computed once for a set
+ * of windows, and the slots once for an area, and both are kept until
+ * something they depend on changes.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "shell-unaligned-layout.h"
+
+#define WINDOW_PREVIEW_MAXIMUM_SCALE 0.95
+
+/* When calculating a layout, we calculate the scale of windows and the percent
+ * of the available area the new layout uses. If the values for the new layout,
+ * when weighted with the values as below, are worse than the previous layout's,
+ * we stop looking for a new layout and use the previous layout.
+ * Otherwise, we keep looking for a new layout. */
+#define LAYOUT_SCALE_WEIGHT 1
+#define LAYOUT_SPACE_WEIGHT 0.1
+
+/* Values per window in the boxes passed in, and per slot passed out */
+#define N_BOX_VALUES 4
+#define N_SLOT_VALUES 5
+
+typedef struct
+{
+  double x, y;
+  double width, height;
+
+  /* The scale applied in addition to the overall layout scale */
+  double scale;
+} WindowInfo;
+
+typedef struct
+{
+  /* Position of the row */
+  double x, y;
+
+  /* Scaled versions of full_width and full_height, where the width also
+   * has the spacing in between windows, as that is constant */
+  double width, height;
+
+  double full_width, full_height;
+  double additional_scale;
+
+  /* Indices of the windows in the row, from left to right */
+  GArray *windows;
+} Row;
+
+typedef struct
+{
+  GArray *rows;
+
+  guint max_columns;
+  double grid_width, grid_height;
+  double scale;
+} Layout;
+
+struct _ShellUnalignedLayout
+{
+  GObject parent;
+
+  GArray *windows;
+  Layout *layout;
+
+  /* What the layout was computed for */
+  GArray *boxes;
+  double monitor_height;
+  double row_spacing;
+  double column_spacing;
+  double area_width;
+  double area_height;
+
+  /* The slots of the layout, and the area they were computed for */
+  GArray *slots;
+  double slots_area[4];
+};
+
+G_DEFINE_TYPE (ShellUnalignedLayout, shell_unaligned_layout, G_TYPE_OBJECT);
+
+static void
+row_clear (Row *row)
+{
+  g_clear_pointer (&row->windows, g_array_unref);
+}
+
+static Layout *
+layout_new (void)
+{
+  Layout *layout = g_new0 (Layout, 1);
+
+  layout->rows = g_array_new (FALSE, TRUE, sizeof (Row));
+  g_array_set_clear_func (layout->rows, (GDestroyNotify) row_clear);
+
+  return layout;
+}
+
+static void
+layout_free (Layout *layout)
+{
+  g_array_unref (layout->rows);
+  g_free (layout);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (Layout, layout_free)
+
+static double
+window_info_get_center_x (const WindowInfo *info)
+{
+  return info->x + info->width / 2;
+}
+
+static double
+window_info_get_center_y (const WindowInfo *info)
+{
+  return info->y + info->height / 2;
+}
+
+static int
+compare_center_x (gconstpointer a,
+                  gconstpointer b,
+                  gpointer      user_data)
+{
+  GArray *windows = user_data;
+  const WindowInfo *info_a = &g_array_index (windows, WindowInfo, *(guint *) a);
+  const WindowInfo *info_b = &g_array_index (windows, WindowInfo, *(guint *) b);
+  double center_a = window_info_get_center_x (info_a);
+  double center_b = window_info_get_center_x (info_b);
+
+  return (center_a > center_b) - (center_a < center_b);
+}
+
+static int
+compare_center_y (gconstpointer a,
+                  gconstpointer b,
+                  gpointer      user_data)
+{
+  GArray *windows = user_data;
+  const WindowInfo *info_a = &g_array_index (windows, WindowInfo, *(guint *) a);
+  const WindowInfo *info_b = &g_array_index (windows, WindowInfo, *(guint *) b);
+  double center_a = window_info_get_center_y (info_a);
+  double center_b = window_info_get_center_y (info_b);
+
+  return (center_a > center_b) - (center_a < center_b);
+}
+
+static gboolean
+keep_same_row (const Row *row,
+               double     width,
+               double     ideal_row_width)
+{
+  double old_ratio, new_ratio;
+
+  if (row->full_width + width <= ideal_row_width)
+    return TRUE;
+
+  old_ratio = row->full_width / ideal_row_width;
+  new_ratio = (row->full_width + width) / ideal_row_width;
+
+  return fabs (1 - new_ratio) < fabs (1 - old_ratio);
+}
+
+static Layout *
+compute_layout (ShellUnalignedLayout *self,
+                guint                 n_rows)
+{
+  g_autoptr (GArray) sorted = NULL;
+  Layout *layout;
+  const Row *max_row = NULL;
+  double total_width = 0;
+  double ideal_row_width;
+  guint window_idx = 0;
+  guint i;
+
+  for (i = 0; i < self->windows->len; i++)
+    {
+      const WindowInfo *info = &g_array_index (self->windows, WindowInfo, i);
+
+      total_width += info->width * info->scale;
+    }
+
+  ideal_row_width = total_width / n_rows;
+
+  /* Sort windows vertically to minimize travel distance.
+   * This affects what rows the windows get placed in. */
+  sorted = g_array_sized_new (FALSE, FALSE, sizeof (guint), self->windows->len);
+  for (i = 0; i < self->windows->len; i++)
+    g_array_append_val (sorted, i);
+  g_array_sort_with_data (sorted, compare_center_y, self->windows);
+
+  layout = layout_new ();
+  g_array_set_size (layout->rows, n_rows);
+
+  for (i = 0; i < n_rows; i++)
+    {
+      Row *row = &g_array_index (layout->rows, Row, i);
+
+      row->windows = g_array_new (FALSE, FALSE, sizeof (guint));
+
+      for (; window_idx < sorted->len; window_idx++)
+        {
+          guint index = g_array_index (sorted, guint, window_idx);
+          const WindowInfo *info = &g_array_index (self->windows, WindowInfo, index);
+          double width = info->width * info->scale;
+          double height = info->height * info->scale;
+
+          row->full_height = MAX (row->full_height, height);
+
+          /* Either the new width is below the ideal width, or nearer to
+           * it than the old width */
+          if (keep_same_row (row, width, ideal_row_width) || i == n_rows - 1)
+            {
+              g_array_append_val (row->windows, index);
+              row->full_width += width;
+            }
+          else
+            {
+              break;
+            }
+        }
+    }
+
+  for (i = 0; i < n_rows; i++)
+    {
+      Row *row = &g_array_index (layout->rows, Row, i);
+
+      /* Sort windows horizontally to minimize travel distance.
+       * This affects in what order the windows end up in a row. */
+      g_array_sort_with_data (row->windows, compare_center_x, self->windows);
+
+      if (max_row == NULL || row->full_width > max_row->full_width)
+        max_row = row;
+      layout->grid_height += row->full_height;
+    }
+
+  layout->max_columns = max_row->windows->len;
+  layout->grid_width = max_row->full_width;
+
+  return layout;
+}
+
+static void
+compute_scale_and_space (ShellUnalignedLayout *self,
+                         Layout               *layout,
+                         double               *scale_out,
+                         double               *space_out)
+{
+  /* Without windows there are no columns either */
+  double hspacing = ((double) layout->max_columns - 1) * self->column_spacing;
+  double vspacing = ((double) layout->rows->len - 1) * self->row_spacing;
+  double spaced_width = self->area_width - hspacing;
+  double spaced_height = self->area_height - vspacing;
+  double horizontal_scale = spaced_width / layout->grid_width;
+  double vertical_scale = spaced_height / layout->grid_height;
+  double scaled_layout_width, scaled_layout_height;
+  double scale;
+
+  /* Thumbnails should be less than 70% of the original size */
+  scale = MIN (MIN (horizontal_scale, vertical_scale),
+               WINDOW_PREVIEW_MAXIMUM_SCALE);
+
+  scaled_layout_width = layout->grid_width * scale + hspacing;
+  scaled_layout_height = layout->grid_height * scale + vspacing;
+
+  layout->scale = scale;
+
+  *scale_out = scale;
+  *space_out = (scaled_layout_width * scaled_layout_height) /
+               (self->area_width * self->area_height);
+}
+
+static gboolean
+is_better_scale_and_space (double old_scale,
+                           double old_space,
+                           double scale,
+                           double space)
+{
+  double space_power = (space - old_space) * LAYOUT_SPACE_WEIGHT;
+  double scale_power = (scale - old_scale) * LAYOUT_SCALE_WEIGHT;
+
+  if (scale > old_scale && space > old_space)
+    return TRUE; /* Win win -- better scale and better space */
+  else if (scale > old_scale && space <= old_space)
+    return scale_power > space_power;
+  else if (scale <= old_scale && space > old_space)
+    return space_power > scale_power;
+  else
+    return FALSE; /* Lose -- worse scale and space */
+}
+
+static Layout *
+compute_best_layout (ShellUnalignedLayout *self)
+{
+  g_autoptr (Layout) last_layout = NULL;
+  int last_n_columns = -1;
+  double last_scale = 0;
+  double last_space = 0;
+  guint n_rows;
+
+  for (n_rows = 1; ; n_rows++)
+    {
+      g_autoptr (Layout) layout = NULL;
+      int n_columns = (self->windows->len + n_rows - 1) / n_rows;
+      double scale, space;
+
+      /* If adding a new row does not change column count just stop
+       * (for instance: 9 windows, with 3 rows -> 3 columns, 4 rows ->
+       * 3 columns as well => just use 3 rows then) */
+      if (n_columns == last_n_columns)
+        break;
+
+      layout = compute_layout (self, n_rows);
+      compute_scale_and_space (self, layout, &scale, &space);
+
+      if (last_layout != NULL &&
+          !is_better_scale_and_space (last_scale, last_space, scale, space))
+        break;
+
+      g_clear_pointer (&last_layout, layout_free);
+      last_layout = g_steal_pointer (&layout);
+      last_n_columns = n_columns;
+      last_scale = scale;
+      last_space = space;
+    }
+
+  return g_steal_pointer (&last_layout);
+}
+
+static void
+compute_window_slots (ShellUnalignedLayout *self,
+                      double                area_x,
+                      double                area_y,
+                      double                area_width,
+                      double                area_height)
+{
+  Layout *layout = self->layout;
+  guint n_rows = layout->rows->len;
+  double height_without_spacing = 0;
+  double vertical_spacing, additional_vertical_scale;
+  double compensation = 0;
+  double y = 0;
+  guint i, j;
+
+  g_array_set_size (self->slots, 0);
+
+  for (i = 0; i < n_rows; i++)
+    {
+      Row *row = &g_array_index (layout->rows, Row, i);
+
+      row->width = row->full_width * layout->scale +
+                   ((double) row->windows->len - 1) * self->column_spacing;
+      row->height = row->full_height * layout->scale;
+      height_without_spacing += row->height;
+    }
+
+  vertical_spacing = ((double) n_rows - 1) * self->row_spacing;
+  additional_vertical_scale =
+    MIN (1, (area_height - vertical_spacing) / height_without_spacing);
+
+  /* Keep track how much smaller the grid becomes due to scaling,
+   * so it can be centered again */
+  for (i = 0; i < n_rows; i++)
+    {
+      Row *row = &g_array_index (layout->rows, Row, i);
+      double horizontal_spacing, width_without_spacing;
+      double additional_horizontal_scale;
+
+      /* If this row doesn't fit in the actual geometry, then apply
+       * an additional scale to it */
+      horizontal_spacing = ((double) row->windows->len - 1) * self->column_spacing;
+      width_without_spacing = row->width - horizontal_spacing;
+      additional_horizontal_scale =
+        MIN (1, (area_width - horizontal_spacing) / width_without_spacing);
+
+      if (additional_horizontal_scale < additional_vertical_scale)
+        {
+          row->additional_scale = additional_horizontal_scale;
+          /* Only consider the scaling in addition to the vertical
+           * scaling for centering */
+          compensation += (additional_vertical_scale - additional_horizontal_scale) * row->height;
+        }
+      else
+        {
+          /* No compensation when scaling vertically, since centering
+           * based on a too large height would undo what vertical
+           * scaling is trying to achieve */
+          row->additional_scale = additional_vertical_scale;
+        }
+
+      row->x = area_x +
+               MAX (area_width - (width_without_spacing * row->additional_scale + horizontal_spacing), 0) / 2;
+      row->y = area_y +
+               MAX (area_height - (height_without_spacing + vertical_spacing), 0) / 2 + y;
+      y += row->height * row->additional_scale + self->row_spacing;
+    }
+
+  compensation /= 2;
+
+  for (i = 0; i < n_rows; i++)
+    {
+      const Row *row = &g_array_index (layout->rows, Row, i);
+      double row_y = row->y + compensation;
+      double row_height = row->height * row->additional_scale;
+      double x = row->x;
+
+      for (j = 0; j < row->windows->len; j++)
+        {
+          guint index = g_array_index (row->windows, guint, j);
+          const WindowInfo *info = &g_array_index (self->windows, WindowInfo, index);
+          double s = layout->scale * info->scale * row->additional_scale;
+          double cell_width = info->width * s;
+          double cell_height = info->height * s;
+          double slot[N_SLOT_VALUES];
+          double clone_width, clone_height;
+          double clone_x, clone_y;
+
+          s = MIN (s, WINDOW_PREVIEW_MAXIMUM_SCALE);
+          clone_width = info->width * s;
+          clone_height = info->height * s;
+
+          clone_x = x + (cell_width - clone_width) / 2;
+
+          /* If there's only one row, align windows vertically centered
+           * inside the row, otherwise align them to its bottom edge */
+          if (n_rows == 1)
+            clone_y = row_y + (row_height - clone_height) / 2;
+          else
+            clone_y = row_y + row_height - cell_height;
+
+          /* Align with the pixel grid to prevent blurry windows at scale = 1 */
+          slot[0] = floor (clone_x);
+          slot[1] = floor (clone_y);
+          slot[2] = clone_width;
+          slot[3] = clone_height;
+          slot[4] = index;
+          g_array_append_vals (self->slots, slot, N_SLOT_VALUES);
+
+          x += cell_width + self->column_spacing;
+        }
+    }
+}
+
+static void
+shell_unaligned_layout_finalize (GObject *object)
+{
+  ShellUnalignedLayout *self = SHELL_UNALIGNED_LAYOUT (object);
+
+  g_clear_pointer (&self->layout, layout_free);
+  g_clear_pointer (&self->windows, g_array_unref);
+  g_clear_pointer (&self->boxes, g_array_unref);
+  g_clear_pointer (&self->slots, g_array_unref);
+
+  G_OBJECT_CLASS (shell_unaligned_layout_parent_class)->finalize (object);
+}
+
+static void
+shell_unaligned_layout_init (ShellUnalignedLayout *self)
+{
+  self->windows = g_array_new (FALSE, FALSE, sizeof (WindowInfo));
+  self->boxes = g_array_new (FALSE, FALSE, sizeof (double));
+  self->slots = g_array_new (FALSE, FALSE, sizeof (double));
+}
+
+static void
+shell_unaligned_layout_class_init (ShellUnalignedLayoutClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = shell_unaligned_layout_finalize;
+}
+
+/**
+ * shell_unaligned_layout_new:
+ *
+ * Returns: (transfer full): a new #ShellUnalignedLayout
+ */
+ShellUnalignedLayout *
+shell_unaligned_layout_new (void)
+{
+  return g_object_new (SHELL_TYPE_UNALIGNED_LAYOUT, NULL);
+}
+
+/**
+ * shell_unaligned_layout_compute_layout:
+ * @self: a #ShellUnalignedLayout
+ * @boxes: (array length=n_values): the bounding boxes of the windows,
+ *   as x, y, width and height of each
+ * @n_values: the number of values in @boxes
+ * @monitor_height: the height of the monitor of the windows
+ * @row_spacing: the spacing between rows
+ * @column_spacing: the spacing between windows of a row
+ * @area_width: the width of the area to lay out the windows in
+ * @area_height: the height of the area to lay out the windows in
+ *
+ * Arranges the windows in the rows that scale them best to the area.
+ * Nothing is done when called with the same arguments as the last time.
+ */
+void
+shell_unaligned_layout_compute_layout (ShellUnalignedLayout *self,
+                                       const double         *boxes,
+                                       int                   n_values,
+                                       double                monitor_height,
+                                       double                row_spacing,
+                                       double                column_spacing,
+                                       double                area_width,
+                                       double                area_height)
+{
+  int n_windows, i;
+
+  g_return_if_fail (SHELL_IS_UNALIGNED_LAYOUT (self));
+  g_return_if_fail (n_values % N_BOX_VALUES == 0);
+
+  if (self->layout != NULL &&
+      self->boxes->len == (guint) n_values &&
+      memcmp (self->boxes->data, boxes, n_values * sizeof (double)) == 0 &&
+      self->monitor_height == monitor_height &&
+      self->row_spacing == row_spacing &&
+      self->column_spacing == column_spacing &&
+      self->area_width == area_width &&
+      self->area_height == area_height)
+    return;
+
+  g_array_set_size (self->boxes, 0);
+  g_array_append_vals (self->boxes, boxes, n_values);
+  self->monitor_height = monitor_height;
+  self->row_spacing = row_spacing;
+  self->column_spacing = column_spacing;
+  self->area_width = area_width;
+  self->area_height = area_height;
+
+  n_windows = n_values / N_BOX_VALUES;
+  g_array_set_size (self->windows, n_windows);
+
+  for (i = 0; i < n_windows; i++)
+    {
+      WindowInfo *info = &g_array_index (self->windows, WindowInfo, i);
+      double ratio;
+
+      info->x = boxes[i * N_BOX_VALUES];
+      info->y = boxes[i * N_BOX_VALUES + 1];
+      info->width = boxes[i * N_BOX_VALUES + 2];
+      info->height = boxes[i * N_BOX_VALUES + 3];
+
+      /* Since windows are aligned next to each other, the height of the
+       * thumbnails is much more important to preserve than the width of
+       * them, so two windows with equal height, but maybe differing
+       * widths line up.
+       *
+       * Bump up the size of small windows a bit, mapping the ratio
+       * from [0, 1] to [1.5, 1], so that they look good. */
+      ratio = info->height / monitor_height;
+      info->scale = 1.5 + (1 - 1.5) * ratio;
+    }
+
+  g_clear_pointer (&self->layout, layout_free);
+  self->layout = compute_best_layout (self);
+
+  /* The slots are for the previous layout */
+  g_array_set_size (self->slots, 0);
+  memset (self->slots_area, 0, sizeof (self->slots_area));
+}
+
+/**
+ * shell_unaligned_layout_compute_window_slots:
+ * @self: a #ShellUnalignedLayout
+ * @x: the X coordinate of the area to place the windows in
+ * @y: the Y coordinate of the area
+ * @width: the width of the area
+ * @height: the height of the area
+ * @n_values: (out): the number of values in the returned array
+ *
+ * Computes where each window of the layout goes in the area. The slots
+ * are kept until the layout or the area change.
+ *
+ * Returns: (array length=n_values) (transfer full): the slots of the
+ *   windows, as x, y, width, height and the index of the window in the
+ *   boxes of the layout for each
+ */
+double *
+shell_unaligned_layout_compute_window_slots (ShellUnalignedLayout *self,
+                                             double                x,
+                                             double                y,
+                                             double                width,
+                                             double                height,
+                                             int                  *n_values)
+{
+  double area[4] = { x, y, width, height };
+
+  g_return_val_if_fail (SHELL_IS_UNALIGNED_LAYOUT (self), NULL);
+  g_return_val_if_fail (self->layout != NULL, NULL);
+
+  if (self->slots->len == 0 ||
+      memcmp (self->slots_area, area, sizeof (area)) != 0)
+    {
+      compute_window_slots (self, x, y, width, height);
+      memcpy (self->slots_area, area, sizeof (area));
+    }
+
+  *n_values = self->slots->len;
+  return g_memdup2 (self->slots->data, self->slots->len * sizeof (double));
+}
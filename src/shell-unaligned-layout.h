@@ -0,0 +1,32 @@
+#ifndef __SHELL_UNALIGNED_LAYOUT_H__
+#define __SHELL_UNALIGNED_LAYOUT_H__
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define SHELL_TYPE_UNALIGNED_LAYOUT (shell_unaligned_layout_get_type ())
+G_DECLARE_FINAL_TYPE (ShellUnalignedLayout, shell_unaligned_layout,
+                      SHELL, UNALIGNED_LAYOUT, GObject)
+
+ShellUnalignedLayout * shell_unaligned_layout_new (void);
+
+void shell_unaligned_layout_compute_layout (ShellUnalignedLayout *self,
+                                            const double         *boxes,
+                                            int                   n_values,
+                                            double                monitor_height,
+                                            double                row_spacing,
+                                            double                column_spacing,
+                                            double                area_width,
+                                            double                area_height);
+
+double * shell_unaligned_layout_compute_window_slots (ShellUnalignedLayout *self,
+                                                      double                x,
+                                                      double                y,
+                                                      double                width,
+                                                      double                height,
+                                                      int                  *n_values);
+
+G_END_DECLS
+
+#endif /* __SHELL_UNALIGNED_LAYOUT_H__ */
@@ -80,6 +80,28 @@ shell_util_set_hidden_from_pick (ClutterActor *actor,
     }
 }
 
+/**
+ * shell_util_disconnect_handlers:
+ * @instance: A #GObject
+ * @handler_ids: (array length=n_handler_ids): handler IDs of @instance
+ * @n_handler_ids: the number of handler IDs
+ *
+ * Disconnects a group of signal handlers of @instance in one go, rather
+ * than with one call per handler.
+ */
+void
+shell_util_disconnect_handlers (GObject      *instance,
+                                const gulong *handler_ids,
+                                int           n_handler_ids)
+{
+  int i;
+
+  g_return_if_fail (G_IS_OBJECT (instance));
+
+  for (i = 0; i < n_handler_ids; i++)
+    g_signal_handler_disconnect (instance, handler_ids[i]);
+}
+
 /**
  * shell_util_get_week_start:
  *
@@ -14,6 +14,10 @@ G_BEGIN_DECLS
 void     shell_util_set_hidden_from_pick       (ClutterActor     *actor,
                                                 gboolean          hidden);
 
+void     shell_util_disconnect_handlers        (GObject          *instance,
+                                                const gulong     *handler_ids,
+                                                int               n_handler_ids);
+
 int      shell_util_get_week_start             (void);
 
 const char *shell_util_translate_time_string   (const char *str);
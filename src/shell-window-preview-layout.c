@@ -11,8 +11,20 @@ struct _ShellWindowPreviewLayoutPrivate
 {
   ClutterActor *container;
   GHashTable *windows;
+  GHashTable *window_actors;
 
   ClutterActorBox bounding_box;
+
+  /* The union of the frame rects of the windows, kept up to date as
+   * windows grow, and only recomputed from all windows when one that
+   * was on its edge shrinks, moves or leaves */
+  MtkRectangle bounding_rect;
+  gboolean bounding_rect_invalid;
+
+  /* Windows change in bursts, so the bounding box is only updated once
+   * per frame, before the stage is laid out */
+  ClutterStage *update_stage;
+  gulong before_update_id;
 };
 
 enum
@@ -34,12 +46,16 @@ typedef struct _WindowInfo
   MetaWindow *window;
   ClutterActor *window_actor;
 
+  MtkRectangle frame_rect;
+
   gulong size_changed_id;
   gulong position_changed_id;
   gulong window_actor_destroy_id;
   gulong destroy_id;
 } WindowInfo;
 
+static void ensure_bounding_box (ShellWindowPreviewLayout *self);
+
 static void
 shell_window_preview_layout_get_property (GObject      *object,
                                           unsigned int  property_id,
@@ -54,6 +70,7 @@ shell_window_preview_layout_get_property (GObject      *object,
   switch (property_id)
     {
     case PROP_BOUNDING_BOX:
+      ensure_bounding_box (self);
       g_value_set_boxed (value, &priv->bounding_box);
       break;
 
@@ -90,6 +107,8 @@ shell_window_preview_layout_get_preferred_width (ClutterLayoutManager *layout,
 
   priv = shell_window_preview_layout_get_instance_private (self);
 
+  ensure_bounding_box (self);
+
   if (min_width_p)
     *min_width_p = 0;
 
@@ -109,6 +128,8 @@ shell_window_preview_layout_get_preferred_height (ClutterLayoutManager *layout,
 
   priv = shell_window_preview_layout_get_instance_private (self);
 
+  ensure_bounding_box (self);
+
   if (min_height_p)
     *min_height_p = 0;
 
@@ -131,6 +152,8 @@ shell_window_preview_layout_allocate (ClutterLayoutManager   *layout,
 
   priv = shell_window_preview_layout_get_instance_private (self);
 
+  ensure_bounding_box (self);
+
   bounding_box_width = clutter_actor_box_get_width (&priv->bounding_box);
   bounding_box_height = clutter_actor_box_get_height (&priv->bounding_box);
 
@@ -188,59 +211,183 @@ shell_window_preview_layout_allocate (ClutterLayoutManager   *layout,
     }
 }
 
+static gboolean
+rect_is_on_edge (const MtkRectangle *rect,
+                 const MtkRectangle *bounding_rect)
+{
+  return rect->x <= bounding_rect->x ||
+         rect->y <= bounding_rect->y ||
+         rect->x + rect->width >= bounding_rect->x + bounding_rect->width ||
+         rect->y + rect->height >= bounding_rect->y + bounding_rect->height;
+}
+
 static void
-on_layout_changed (ShellWindowPreviewLayout *self)
+recompute_bounding_rect (ShellWindowPreviewLayout *self)
 {
   ShellWindowPreviewLayoutPrivate *priv;
   GHashTableIter iter;
   gpointer value;
   gboolean first_rect = TRUE;
-  MtkRectangle bounding_rect = { 0, };
-  ClutterActorBox old_bounding_box;
 
   priv = shell_window_preview_layout_get_instance_private (self);
 
-  old_bounding_box =
-    (ClutterActorBox) CLUTTER_ACTOR_BOX_INIT (priv->bounding_box.x1,
-                                              priv->bounding_box.y1,
-                                              priv->bounding_box.x2,
-                                              priv->bounding_box.y2);
+  priv->bounding_rect = (MtkRectangle) { 0, };
 
   g_hash_table_iter_init (&iter, priv->windows);
   while (g_hash_table_iter_next (&iter, NULL, &value))
     {
       WindowInfo *window_info = value;
-      MtkRectangle frame_rect;
-
-      meta_window_get_frame_rect (window_info->window, &frame_rect);
 
       if (first_rect)
         {
-          bounding_rect = frame_rect;
+          priv->bounding_rect = window_info->frame_rect;
           first_rect = FALSE;
           continue;
         }
 
-      mtk_rectangle_union (&frame_rect, &bounding_rect, &bounding_rect);
+      mtk_rectangle_union (&window_info->frame_rect,
+                           &priv->bounding_rect,
+                           &priv->bounding_rect);
     }
 
+  priv->bounding_rect_invalid = FALSE;
+}
+
+static void
+stop_waiting_for_update (ShellWindowPreviewLayout *self)
+{
+  ShellWindowPreviewLayoutPrivate *priv;
+
+  priv = shell_window_preview_layout_get_instance_private (self);
+
+  if (priv->update_stage)
+    g_clear_signal_handler (&priv->before_update_id, priv->update_stage);
+  priv->update_stage = NULL;
+}
+
+static void
+update_bounding_box (ShellWindowPreviewLayout *self)
+{
+  ShellWindowPreviewLayoutPrivate *priv;
+  ClutterActorBox old_bounding_box;
+
+  priv = shell_window_preview_layout_get_instance_private (self);
+
+  stop_waiting_for_update (self);
+
+  if (priv->bounding_rect_invalid)
+    recompute_bounding_rect (self);
+
+  old_bounding_box =
+    (ClutterActorBox) CLUTTER_ACTOR_BOX_INIT (priv->bounding_box.x1,
+                                              priv->bounding_box.y1,
+                                              priv->bounding_box.x2,
+                                              priv->bounding_box.y2);
+
   clutter_actor_box_set_origin (&priv->bounding_box,
-                                (float) bounding_rect.x,
-                                (float) bounding_rect.y);
+                                (float) priv->bounding_rect.x,
+                                (float) priv->bounding_rect.y);
   clutter_actor_box_set_size (&priv->bounding_box,
-                              (float) bounding_rect.width,
-                              (float) bounding_rect.height);
+                              (float) priv->bounding_rect.width,
+                              (float) priv->bounding_rect.height);
 
   if (!clutter_actor_box_equal (&priv->bounding_box, &old_bounding_box))
     g_object_notify_by_pspec (G_OBJECT (self), obj_props[PROP_BOUNDING_BOX]);
+}
+
+static void
+ensure_bounding_box (ShellWindowPreviewLayout *self)
+{
+  ShellWindowPreviewLayoutPrivate *priv;
+
+  priv = shell_window_preview_layout_get_instance_private (self);
+
+  if (priv->update_stage)
+    update_bounding_box (self);
+}
+
+static void
+on_stage_before_update (ClutterStage             *stage,
+                        ClutterStageView         *view,
+                        ClutterFrame             *frame,
+                        ShellWindowPreviewLayout *self)
+{
+  update_bounding_box (self);
+}
+
+static void
+on_layout_changed (ShellWindowPreviewLayout *self)
+{
+  ShellWindowPreviewLayoutPrivate *priv;
+  ClutterActor *stage = NULL;
+
+  priv = shell_window_preview_layout_get_instance_private (self);
+
+  if (priv->container)
+    stage = clutter_actor_get_stage (priv->container);
+
+  /* Without a stage, there are no frames to wait for */
+  if (stage == NULL)
+    {
+      update_bounding_box (self);
+    }
+  else if (priv->update_stage == NULL)
+    {
+      priv->update_stage = CLUTTER_STAGE (stage);
+      priv->before_update_id =
+        g_signal_connect_object (stage, "before-update",
+                                 G_CALLBACK (on_stage_before_update), self, 0);
+      clutter_stage_schedule_update (priv->update_stage);
+    }
 
   clutter_layout_manager_layout_changed (CLUTTER_LAYOUT_MANAGER (self));
 }
 
+static void
+add_window_rect (ShellWindowPreviewLayout *self,
+                 const MtkRectangle       *frame_rect)
+{
+  ShellWindowPreviewLayoutPrivate *priv;
+
+  priv = shell_window_preview_layout_get_instance_private (self);
+
+  if (priv->bounding_rect_invalid)
+    return;
+
+  if (g_hash_table_size (priv->windows) == 1)
+    priv->bounding_rect = *frame_rect;
+  else
+    mtk_rectangle_union (frame_rect, &priv->bounding_rect, &priv->bounding_rect);
+}
+
 static void
 on_window_size_position_changed (MetaWindow               *window,
                                  ShellWindowPreviewLayout *self)
 {
+  ShellWindowPreviewLayoutPrivate *priv;
+  WindowInfo *window_info;
+  ClutterActor *actor;
+  MtkRectangle old_rect;
+
+  priv = shell_window_preview_layout_get_instance_private (self);
+
+  actor = g_hash_table_lookup (priv->window_actors, window);
+  window_info = g_hash_table_lookup (priv->windows, actor);
+
+  old_rect = window_info->frame_rect;
+  meta_window_get_frame_rect (window, &window_info->frame_rect);
+
+  if (mtk_rectangle_equal (&old_rect, &window_info->frame_rect))
+    return;
+
+  /* A window inside the box can only grow it; one on its edge may
+   * have taken the edge with it */
+  if (rect_is_on_edge (&old_rect, &priv->bounding_rect) &&
+      !mtk_rectangle_contains_rect (&window_info->frame_rect, &old_rect))
+    priv->bounding_rect_invalid = TRUE;
+  else
+    add_window_rect (self, &window_info->frame_rect);
+
   on_layout_changed (self);
 }
 
@@ -275,6 +422,8 @@ shell_window_preview_layout_dispose (GObject *gobject)
 
   priv = shell_window_preview_layout_get_instance_private (self);
 
+  stop_waiting_for_update (self);
+
   g_hash_table_iter_init (&iter, priv->windows);
   while (g_hash_table_iter_next (&iter, &key, &value))
     {
@@ -290,6 +439,7 @@ shell_window_preview_layout_dispose (GObject *gobject)
     }
 
   g_hash_table_remove_all (priv->windows);
+  g_hash_table_remove_all (priv->window_actors);
 
   G_OBJECT_CLASS (shell_window_preview_layout_parent_class)->dispose (gobject);
 }
@@ -303,6 +453,7 @@ shell_window_preview_layout_finalize (GObject *gobject)
   priv = shell_window_preview_layout_get_instance_private (self);
 
   g_hash_table_destroy (priv->windows);
+  g_hash_table_destroy (priv->window_actors);
 
   G_OBJECT_CLASS (shell_window_preview_layout_parent_class)->finalize (gobject);
 }
@@ -316,6 +467,7 @@ shell_window_preview_layout_init (ShellWindowPreviewLayout *self)
 
   priv->windows = g_hash_table_new_full (NULL, NULL, NULL,
                                          (GDestroyNotify) g_free);
+  priv->window_actors = g_hash_table_new (NULL, NULL);
 }
 
 static void
@@ -365,22 +517,14 @@ shell_window_preview_layout_add_window (ShellWindowPreviewLayout *self,
   ShellWindowPreviewLayoutPrivate *priv;
   ClutterActor *window_actor, *actor;
   WindowInfo *window_info;
-  GHashTableIter iter;
-  gpointer value;
 
   g_return_val_if_fail (SHELL_IS_WINDOW_PREVIEW_LAYOUT (self), NULL);
   g_return_val_if_fail (META_IS_WINDOW (window), NULL);
 
   priv = shell_window_preview_layout_get_instance_private (self);
 
-  g_hash_table_iter_init (&iter, priv->windows);
-  while (g_hash_table_iter_next (&iter, NULL, &value))
-    {
-      WindowInfo *info = value;
-
-      if (info->window == window)
-        return NULL;
-    }
+  if (g_hash_table_contains (priv->window_actors, window))
+    return NULL;
 
   window_actor = CLUTTER_ACTOR (meta_window_get_compositor_private (window));
   actor = clutter_clone_new (window_actor);
@@ -389,6 +533,7 @@ shell_window_preview_layout_add_window (ShellWindowPreviewLayout *self,
 
   window_info->window = window;
   window_info->window_actor = window_actor;
+  meta_window_get_frame_rect (window, &window_info->frame_rect);
   window_info->size_changed_id =
     g_signal_connect (window, "size-changed",
                       G_CALLBACK (on_window_size_position_changed), self);
@@ -403,9 +548,11 @@ shell_window_preview_layout_add_window (ShellWindowPreviewLayout *self,
                       G_CALLBACK (on_actor_destroyed), self);
 
   g_hash_table_insert (priv->windows, actor, window_info);
+  g_hash_table_insert (priv->window_actors, window, actor);
 
   clutter_actor_add_child (priv->container, actor);
 
+  add_window_rect (self, &window_info->frame_rect);
   on_layout_changed (self);
 
   return actor;
@@ -426,37 +573,30 @@ shell_window_preview_layout_remove_window (ShellWindowPreviewLayout *self,
 {
   ShellWindowPreviewLayoutPrivate *priv;
   ClutterActor *actor;
-  WindowInfo *window_info = NULL;
-  GHashTableIter iter;
-  gpointer key, value;
+  WindowInfo *window_info;
 
   g_return_if_fail (SHELL_IS_WINDOW_PREVIEW_LAYOUT (self));
   g_return_if_fail (META_IS_WINDOW (window));
 
   priv = shell_window_preview_layout_get_instance_private (self);
 
-  g_hash_table_iter_init (&iter, priv->windows);
-  while (g_hash_table_iter_next (&iter, &key, &value))
-    {
-      WindowInfo *info = value;
-
-      if (info->window == window)
-        {
-          actor = CLUTTER_ACTOR (key);
-          window_info = info;
-          break;
-        }
-    }
-
-  if (window_info == NULL)
+  actor = g_hash_table_lookup (priv->window_actors, window);
+  if (actor == NULL)
     return;
 
+  window_info = g_hash_table_lookup (priv->windows, actor);
+
   g_clear_signal_handler (&window_info->size_changed_id, window);
   g_clear_signal_handler (&window_info->position_changed_id, window);
   g_clear_signal_handler (&window_info->window_actor_destroy_id, window_info->window_actor);
   g_clear_signal_handler (&window_info->destroy_id, actor);
 
+  /* Windows inside the box don't hold up any of its edges */
+  if (rect_is_on_edge (&window_info->frame_rect, &priv->bounding_rect))
+    priv->bounding_rect_invalid = TRUE;
+
   g_hash_table_remove (priv->windows, actor);
+  g_hash_table_remove (priv->window_actors, window);
 
   clutter_actor_remove_child (priv->container, actor);
 
@@ -16,6 +16,7 @@
 
 #include "shell-window-tracker-private.h"
 #include "shell-app-private.h"
+#include "shell-app-system-private.h"
 #include "shell-global.h"
 #include "st.h"
 
@@ -44,6 +45,13 @@ struct _ShellWindowTracker
 
   /* <MetaWindow * window, ShellApp *app> */
   GHashTable *window_to_app;
+
+  /* <int pid, GPtrArray *windows> of tracked windows */
+  GHashTable *pid_to_windows;
+
+  /* <char *wm_class_key, char *app_id>, with "" if nothing matched */
+  GHashTable *wm_class_to_app_id;
+  guint wm_class_serial;
 };
 
 G_DEFINE_TYPE (ShellWindowTracker, shell_window_tracker, G_TYPE_OBJECT);
@@ -138,27 +146,22 @@ check_app_id_prefix (ShellApp   *app,
 }
 
 /*
- * get_app_from_window_wmclass:
+ * lookup_app_from_wmclass:
  *
- * Looks only at the given window, and attempts to determine
- * an application based on WM_CLASS.  If one can't be determined,
- * return %NULL.
+ * Attempts to determine an application based on WM_CLASS.  If one
+ * can't be determined, return %NULL.
  *
- * Return value: (transfer full): A newly-referenced #ShellApp, or %NULL
+ * Return value: (transfer none): A #ShellApp, or %NULL
  */
 static ShellApp *
-get_app_from_window_wmclass (MetaWindow  *window)
+lookup_app_from_wmclass (ShellAppSystem *appsys,
+                         const char     *wm_class,
+                         const char     *wm_instance,
+                         const char     *sandbox_id)
 {
   ShellApp *app;
-  ShellAppSystem *appsys;
-  const char *wm_class;
-  const char *wm_instance;
-  const char *sandbox_id;
   g_autofree char *app_prefix = NULL;
 
-  appsys = shell_app_system_get_default ();
-
-  sandbox_id = meta_window_get_sandboxed_app_id (window);
   if (sandbox_id)
     app_prefix = g_strdup_printf ("%s.", sandbox_id);
 
@@ -193,30 +196,87 @@ get_app_from_window_wmclass (MetaWindow  *window)
   */
 
   /* first try a match from WM_CLASS (instance part) to StartupWMClass */
-  wm_instance = meta_window_get_wm_class_instance (window);
   app = shell_app_system_lookup_startup_wmclass (appsys, wm_instance);
   if (app != NULL && check_app_id_prefix (app, app_prefix))
-    return g_object_ref (app);
+    return app;
 
   /* then try a match from WM_CLASS to StartupWMClass */
-  wm_class = meta_window_get_wm_class (window);
   app = shell_app_system_lookup_startup_wmclass (appsys, wm_class);
   if (app != NULL && check_app_id_prefix (app, app_prefix))
-    return g_object_ref (app);
+    return app;
 
   /* then try a match from WM_CLASS (instance part) to .desktop */
   app = shell_app_system_lookup_desktop_wmclass (appsys, wm_instance);
   if (app != NULL && check_app_id_prefix (app, app_prefix))
-    return g_object_ref (app);
+    return app;
 
   /* finally, try a match from WM_CLASS to .desktop */
   app = shell_app_system_lookup_desktop_wmclass (appsys, wm_class);
   if (app != NULL && check_app_id_prefix (app, app_prefix))
-    return g_object_ref (app);
+    return app;
 
   return NULL;
 }
 
+/*
+ * get_app_from_window_wmclass:
+ *
+ * Looks only at the given window, and attempts to determine
+ * an application based on WM_CLASS.  If one can't be determined,
+ * return %NULL.
+ *
+ * Results are remembered until the installed apps change, as windows
+ * with the same WM_CLASS keep getting retracked.
+ *
+ * Return value: (transfer full): A newly-referenced #ShellApp, or %NULL
+ */
+static ShellApp *
+get_app_from_window_wmclass (ShellWindowTracker *tracker,
+                             MetaWindow         *window)
+{
+  ShellAppSystem *appsys;
+  ShellApp *app;
+  const char *wm_class;
+  const char *wm_instance;
+  const char *sandbox_id;
+  const char *app_id;
+  g_autofree char *key = NULL;
+  guint serial;
+
+  appsys = shell_app_system_get_default ();
+
+  serial = _shell_app_system_get_installed_serial (appsys);
+  if (serial != tracker->wm_class_serial)
+    {
+      g_hash_table_remove_all (tracker->wm_class_to_app_id);
+      tracker->wm_class_serial = serial;
+    }
+
+  wm_class = meta_window_get_wm_class (window);
+  wm_instance = meta_window_get_wm_class_instance (window);
+  sandbox_id = meta_window_get_sandboxed_app_id (window);
+
+  key = g_strjoin ("\x1f",
+                   wm_class ? wm_class : "",
+                   wm_instance ? wm_instance : "",
+                   sandbox_id ? sandbox_id : "",
+                   NULL);
+
+  app_id = g_hash_table_lookup (tracker->wm_class_to_app_id, key);
+  if (app_id != NULL)
+    {
+      app = *app_id ? shell_app_system_lookup_app (appsys, app_id) : NULL;
+      return app ? g_object_ref (app) : NULL;
+    }
+
+  app = lookup_app_from_wmclass (appsys, wm_class, wm_instance, sandbox_id);
+  g_hash_table_insert (tracker->wm_class_to_app_id,
+                       g_steal_pointer (&key),
+                       g_strdup (app ? shell_app_get_id (app) : ""));
+
+  return app ? g_object_ref (app) : NULL;
+}
+
 /*
  * get_app_from_id:
  * @window: a #MetaWindow
@@ -419,7 +479,7 @@ get_app_for_window (ShellWindowTracker    *tracker,
   /* Check if the app's WM_CLASS specifies an app; this is
    * canonical if it does.
    */
-  result = get_app_from_window_wmclass (window);
+  result = get_app_from_window_wmclass (tracker, window);
   if (result != NULL)
     return result;
 
@@ -553,6 +613,52 @@ on_window_unmanaged (MetaWindow *window,
   disassociate_window (SHELL_WINDOW_TRACKER (user_data), window);
 }
 
+static void
+add_window_pid (ShellWindowTracker *self,
+                MetaWindow         *window)
+{
+  GPtrArray *windows;
+  pid_t pid;
+
+  if (meta_window_is_remote (window))
+    return;
+
+  pid = meta_window_get_pid (window);
+  if (pid < 1)
+    return;
+
+  windows = g_hash_table_lookup (self->pid_to_windows, GINT_TO_POINTER (pid));
+  if (windows == NULL)
+    {
+      windows = g_ptr_array_new ();
+      g_hash_table_insert (self->pid_to_windows, GINT_TO_POINTER (pid), windows);
+    }
+
+  g_ptr_array_add (windows, window);
+
+  /* Remove it under the same pid, whatever the window says later */
+  g_object_set_data (G_OBJECT (window), "shell-tracked-pid", GINT_TO_POINTER (pid));
+}
+
+static void
+remove_window_pid (ShellWindowTracker *self,
+                   MetaWindow         *window)
+{
+  GPtrArray *windows;
+  gpointer pid;
+
+  pid = g_object_steal_data (G_OBJECT (window), "shell-tracked-pid");
+  if (pid == NULL)
+    return;
+
+  windows = g_hash_table_lookup (self->pid_to_windows, pid);
+  g_assert (windows != NULL);
+
+  g_ptr_array_remove_fast (windows, window);
+  if (windows->len == 0)
+    g_hash_table_remove (self->pid_to_windows, pid);
+}
+
 static void
 track_window (ShellWindowTracker *self,
               MetaWindow      *window)
@@ -565,6 +671,7 @@ track_window (ShellWindowTracker *self,
 
   /* At this point we've stored the association from window -> application */
   g_hash_table_insert (self->window_to_app, window, app);
+  add_window_pid (self, window);
 
   g_signal_connect (window, "notify::wm-class", G_CALLBACK (on_wm_class_changed), self);
   g_signal_connect (window, "notify::title", G_CALLBACK (on_title_changed), self);
@@ -597,6 +704,7 @@ disassociate_window (ShellWindowTracker   *self,
   g_object_ref (app);
 
   g_hash_table_remove (self->window_to_app, window);
+  remove_window_pid (self, window);
 
   _shell_app_remove_window (app, window);
   g_signal_handlers_disconnect_by_func (window, G_CALLBACK (on_wm_class_changed), self);
@@ -673,6 +781,10 @@ shell_window_tracker_init (ShellWindowTracker *self)
 
   self->window_to_app = g_hash_table_new_full (g_direct_hash, g_direct_equal,
                                                NULL, (GDestroyNotify) g_object_unref);
+  self->wm_class_to_app_id = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                    g_free, g_free);
+  self->pid_to_windows = g_hash_table_new_full (NULL, NULL, NULL,
+                                                (GDestroyNotify) g_ptr_array_unref);
 
 
   g_signal_connect (sn, "changed",
@@ -691,6 +803,8 @@ shell_window_tracker_finalize (GObject *object)
   ShellWindowTracker *self = SHELL_WINDOW_TRACKER (object);
 
   g_hash_table_destroy (self->window_to_app);
+  g_hash_table_destroy (self->wm_class_to_app_id);
+  g_hash_table_destroy (self->pid_to_windows);
 
   G_OBJECT_CLASS (shell_window_tracker_parent_class)->finalize(object);
 }
@@ -729,33 +843,28 @@ ShellApp *
 shell_window_tracker_get_app_from_pid (ShellWindowTracker *tracker,
                                        int                 pid)
 {
-  GSList *running = shell_app_system_get_running (shell_app_system_get_default());
-  GSList *iter;
+  GPtrArray *windows;
   ShellApp *result = NULL;
+  guint i;
 
-  for (iter = running; iter; iter = iter->next)
+  windows = g_hash_table_lookup (tracker->pid_to_windows, GINT_TO_POINTER (pid));
+  if (windows == NULL)
+    return NULL;
+
+  /* Several running apps may share a process, prefer the one that
+   * sorts first, as shell_app_system_get_running() does */
+  for (i = 0; i < windows->len; i++)
     {
-      ShellApp *app = iter->data;
-      GSList *pids = shell_app_get_pids (app);
-      GSList *pids_iter;
+      ShellApp *app = g_hash_table_lookup (tracker->window_to_app,
+                                           g_ptr_array_index (windows, i));
 
-      for (pids_iter = pids; pids_iter; pids_iter = pids_iter->next)
-        {
-          int app_pid = GPOINTER_TO_INT (pids_iter->data);
-          if (app_pid == pid)
-            {
-              result = app;
-              break;
-            }
-        }
-      g_slist_free (pids);
+      if (app == result || shell_app_get_state (app) != SHELL_APP_STATE_RUNNING)
+        continue;
 
-      if (result != NULL)
-        break;
+      if (result == NULL || shell_app_compare (app, result) < 0)
+        result = app;
     }
 
-  g_slist_free (running);
-
   return result;
 }
 
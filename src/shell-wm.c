@@ -6,14 +6,43 @@
 
 #include <meta/meta-enum-types.h>
 #include <meta/keybindings.h>
+#include <meta/display.h>
+#include <meta/meta-window-actor.h>
+#include <meta/window.h>
+#include <st/st.h>
 
 #include "shell-wm-private.h"
+#include "shell-enum-types.h"
 #include "shell-global.h"
 
+#define MINIMIZE_WINDOW_ANIMATION_TIME 400
+#define SHOW_WINDOW_ANIMATION_TIME 150
+#define DIALOG_SHOW_WINDOW_ANIMATION_TIME 100
+#define DESTROY_WINDOW_ANIMATION_TIME 150
+#define DIALOG_DESTROY_WINDOW_ANIMATION_TIME 100
+
+typedef struct _WindowEffect
+{
+  ShellWM *wm;
+  MetaWindowActor *actor;
+  ShellWMEffect effect;
+
+  const char *property;
+  ClutterTransition *transition;
+  gulong stopped_id;
+  gulong destroy_id;
+} WindowEffect;
+
 struct _ShellWM {
   GObject parent;
 
   MetaPlugin *plugin;
+
+  /* Running effects by window actor, and the actors whose effect
+   * completed since the last ::window-effects-completed */
+  GHashTable *window_effects;
+  GPtrArray *completed_actors;
+  guint completed_idle_id;
 };
 
 /* Signals */
@@ -35,6 +64,7 @@ enum
   CONFIRM_DISPLAY_CHANGE,
   CREATE_CLOSE_DIALOG,
   CREATE_INHIBIT_SHORTCUTS_DIALOG,
+  WINDOW_EFFECTS_COMPLETED,
 
   LAST_SIGNAL
 };
@@ -43,14 +73,26 @@ G_DEFINE_TYPE(ShellWM, shell_wm, G_TYPE_OBJECT);
 
 static guint shell_wm_signals [LAST_SIGNAL] = { 0 };
 
+static void window_effect_free (WindowEffect *window_effect);
+
 static void
 shell_wm_init (ShellWM *wm)
 {
+  wm->window_effects =
+    g_hash_table_new_full (NULL, NULL,
+                           NULL, (GDestroyNotify) window_effect_free);
+  wm->completed_actors = g_ptr_array_new_with_free_func (g_object_unref);
 }
 
 static void
 shell_wm_finalize (GObject *object)
 {
+  ShellWM *wm = SHELL_WM (object);
+
+  g_clear_handle_id (&wm->completed_idle_id, g_source_remove);
+  g_hash_table_destroy (wm->window_effects);
+  g_ptr_array_unref (wm->completed_actors);
+
   G_OBJECT_CLASS (shell_wm_parent_class)->finalize (object);
 }
 
@@ -202,6 +244,23 @@ shell_wm_class_init (ShellWMClass *klass)
                   0,
                   NULL, NULL, NULL,
                   META_TYPE_INHIBIT_SHORTCUTS_DIALOG, 1, META_TYPE_WINDOW);
+  /**
+   * ShellWM::window-effects-completed:
+   * @wm: The WM
+   * @actors: (element-type MetaWindowActor): the window actors
+   *
+   * Emitted once for all the effects started with
+   * shell_wm_start_window_effect() that completed at about the same
+   * time, right before they are reported to mutter as completed.
+   */
+  shell_wm_signals[WINDOW_EFFECTS_COMPLETED] =
+    g_signal_new ("window-effects-completed",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 1,
+                  G_TYPE_PTR_ARRAY);
 }
 
 void
@@ -314,6 +373,17 @@ void
 _shell_wm_kill_window_effects (ShellWM         *wm,
                                MetaWindowActor *actor)
 {
+  WindowEffect *window_effect;
+
+  window_effect = g_hash_table_lookup (wm->window_effects, actor);
+  if (window_effect)
+    {
+      /* Mutter expects killed effects to be completed right away */
+      clutter_actor_remove_transition (CLUTTER_ACTOR (actor),
+                                       window_effect->property);
+      shell_wm_flush_window_effects (wm);
+    }
+
   g_signal_emit (wm, shell_wm_signals[KILL_WINDOW_EFFECTS], 0, actor);
 }
 
@@ -460,3 +530,379 @@ shell_wm_new (MetaPlugin *plugin)
 
   return wm;
 }
+
+static void
+window_effect_free (WindowEffect *window_effect)
+{
+  g_clear_signal_handler (&window_effect->stopped_id, window_effect->transition);
+  g_clear_signal_handler (&window_effect->destroy_id, window_effect->actor);
+  g_clear_object (&window_effect->transition);
+  g_free (window_effect);
+}
+
+static void
+reset_window_actor (MetaWindowActor *window_actor)
+{
+  ClutterActor *actor = CLUTTER_ACTOR (window_actor);
+
+  clutter_actor_remove_all_transitions (actor);
+  clutter_actor_set_opacity (actor, 255);
+  clutter_actor_set_pivot_point (actor, 0, 0);
+  clutter_actor_set_scale (actor, 1, 1);
+  clutter_actor_set_translation (actor, 0, 0, 0);
+}
+
+static void
+complete_window_effect (ShellWM         *wm,
+                        MetaWindowActor *actor,
+                        ShellWMEffect    effect)
+{
+  switch (effect)
+    {
+    case SHELL_WM_EFFECT_MAP:
+    case SHELL_WM_EFFECT_MAP_DIALOG:
+      reset_window_actor (actor);
+      shell_wm_completed_map (wm, actor);
+      break;
+
+    case SHELL_WM_EFFECT_DESTROY:
+    case SHELL_WM_EFFECT_DESTROY_DIALOG:
+      shell_wm_completed_destroy (wm, actor);
+      break;
+
+    case SHELL_WM_EFFECT_MINIMIZE:
+    case SHELL_WM_EFFECT_MINIMIZE_FADE:
+      reset_window_actor (actor);
+      shell_wm_completed_minimize (wm, actor);
+      break;
+
+    case SHELL_WM_EFFECT_UNMINIMIZE:
+    case SHELL_WM_EFFECT_UNMINIMIZE_FADE:
+      reset_window_actor (actor);
+      shell_wm_completed_unminimize (wm, actor);
+      break;
+    }
+}
+
+/**
+ * shell_wm_flush_window_effects:
+ * @wm: the ShellWM
+ *
+ * Emits #ShellWM::window-effects-completed for the effects that
+ * completed but weren't reported yet, and reports them to mutter.
+ * This normally happens in an idle, so that the effects of windows
+ * that were mapped together complete together.
+ */
+void
+shell_wm_flush_window_effects (ShellWM *wm)
+{
+  g_autoptr (GPtrArray) actors = NULL;
+  unsigned int i;
+
+  g_return_if_fail (SHELL_IS_WM (wm));
+
+  g_clear_handle_id (&wm->completed_idle_id, g_source_remove);
+
+  if (wm->completed_actors->len == 0)
+    return;
+
+  actors = g_steal_pointer (&wm->completed_actors);
+  wm->completed_actors = g_ptr_array_new_with_free_func (g_object_unref);
+
+  g_signal_emit (wm, shell_wm_signals[WINDOW_EFFECTS_COMPLETED], 0, actors);
+
+  for (i = 0; i < actors->len; i++)
+    {
+      MetaWindowActor *actor = g_ptr_array_index (actors, i);
+      ShellWMEffect effect;
+
+      effect = GPOINTER_TO_INT (g_object_steal_data (G_OBJECT (actor),
+                                                     "shell-wm-effect"));
+      complete_window_effect (wm, actor, effect);
+    }
+}
+
+static gboolean
+flush_window_effects_in_idle (gpointer data)
+{
+  ShellWM *wm = data;
+
+  wm->completed_idle_id = 0;
+  shell_wm_flush_window_effects (wm);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+window_effect_done (WindowEffect *window_effect)
+{
+  ShellWM *wm = window_effect->wm;
+  MetaWindowActor *actor = window_effect->actor;
+
+  g_object_set_data (G_OBJECT (actor), "shell-wm-effect",
+                     GINT_TO_POINTER (window_effect->effect));
+  g_ptr_array_add (wm->completed_actors, g_object_ref (actor));
+
+  if (window_effect->transition)
+    {
+      meta_enable_unredirect_for_display (shell_global_get_display (shell_global_get ()));
+      shell_global_end_work (shell_global_get ());
+    }
+
+  g_hash_table_remove (wm->window_effects, actor);
+
+  if (wm->completed_idle_id == 0)
+    {
+      wm->completed_idle_id = g_idle_add_full (G_PRIORITY_HIGH,
+                                               flush_window_effects_in_idle,
+                                               wm, NULL);
+      g_source_set_name_by_id (wm->completed_idle_id,
+                               "[gnome-shell] flush_window_effects_in_idle");
+    }
+}
+
+static void
+on_transition_stopped (ClutterTransition *transition,
+                       gboolean           is_finished,
+                       WindowEffect      *window_effect)
+{
+  window_effect_done (window_effect);
+}
+
+static void
+on_window_actor_destroy (MetaWindowActor *actor,
+                         WindowEffect    *window_effect)
+{
+  ShellWM *wm = window_effect->wm;
+
+  meta_enable_unredirect_for_display (shell_global_get_display (shell_global_get ()));
+  shell_global_end_work (shell_global_get ());
+
+  g_hash_table_remove (wm->window_effects, actor);
+}
+
+static unsigned int
+get_effect_duration (ShellWMEffect effect)
+{
+  unsigned int duration = 0;
+  gboolean enable_animations;
+  double slow_down_factor;
+
+  switch (effect)
+    {
+    case SHELL_WM_EFFECT_MAP:
+      duration = SHOW_WINDOW_ANIMATION_TIME;
+      break;
+    case SHELL_WM_EFFECT_MAP_DIALOG:
+      duration = DIALOG_SHOW_WINDOW_ANIMATION_TIME;
+      break;
+    case SHELL_WM_EFFECT_DESTROY:
+      duration = DESTROY_WINDOW_ANIMATION_TIME;
+      break;
+    case SHELL_WM_EFFECT_DESTROY_DIALOG:
+      duration = DIALOG_DESTROY_WINDOW_ANIMATION_TIME;
+      break;
+    case SHELL_WM_EFFECT_MINIMIZE:
+    case SHELL_WM_EFFECT_MINIMIZE_FADE:
+    case SHELL_WM_EFFECT_UNMINIMIZE:
+    case SHELL_WM_EFFECT_UNMINIMIZE_FADE:
+      duration = MINIMIZE_WINDOW_ANIMATION_TIME;
+      break;
+    }
+
+  /* Like adjustAnimationTime() */
+  g_object_get (st_settings_get (),
+                "enable-animations", &enable_animations,
+                "slow-down-factor", &slow_down_factor,
+                NULL);
+
+  if (!enable_animations)
+    return 0;
+
+  return duration * slow_down_factor;
+}
+
+/* Sets the initial state of the effect and eases @actor to its final
+ * state, returning the name of a property that is always animated */
+static const char *
+ease_window_actor (ClutterActor       *actor,
+                   ShellWMEffect       effect,
+                   const MtkRectangle *rect)
+{
+  MetaWindow *window = meta_window_actor_get_meta_window (META_WINDOW_ACTOR (actor));
+  float width = clutter_actor_get_width (actor);
+  float height = clutter_actor_get_height (actor);
+  MtkRectangle buffer_rect;
+
+  switch (effect)
+    {
+    case SHELL_WM_EFFECT_MAP:
+      clutter_actor_set_pivot_point (actor, 0.5, 1.0);
+      clutter_actor_set_scale (actor, 0.01, 0.05);
+      clutter_actor_set_opacity (actor, 0);
+      clutter_actor_show (actor);
+
+      clutter_actor_save_easing_state (actor);
+      clutter_actor_set_easing_mode (actor, CLUTTER_EASE_OUT_EXPO);
+      clutter_actor_set_easing_duration (actor, get_effect_duration (effect));
+      clutter_actor_set_opacity (actor, 255);
+      clutter_actor_set_scale (actor, 1, 1);
+      clutter_actor_restore_easing_state (actor);
+      return "opacity";
+
+    case SHELL_WM_EFFECT_MAP_DIALOG:
+      clutter_actor_set_pivot_point (actor, 0.5, 0.5);
+      clutter_actor_set_scale (actor, clutter_actor_get_scale_x (actor), 0);
+      clutter_actor_set_opacity (actor, 0);
+      clutter_actor_show (actor);
+
+      clutter_actor_save_easing_state (actor);
+      clutter_actor_set_easing_mode (actor, CLUTTER_EASE_OUT_QUAD);
+      clutter_actor_set_easing_duration (actor, get_effect_duration (effect));
+      clutter_actor_set_opacity (actor, 255);
+      clutter_actor_set_scale (actor, 1, 1);
+      clutter_actor_restore_easing_state (actor);
+      return "opacity";
+
+    case SHELL_WM_EFFECT_DESTROY:
+      clutter_actor_set_pivot_point (actor, 0.5, 0.5);
+
+      clutter_actor_save_easing_state (actor);
+      clutter_actor_set_easing_mode (actor, CLUTTER_EASE_OUT_QUAD);
+      clutter_actor_set_easing_duration (actor, get_effect_duration (effect));
+      clutter_actor_set_opacity (actor, 0);
+      clutter_actor_set_scale (actor, 0.8, 0.8);
+      clutter_actor_restore_easing_state (actor);
+      return "opacity";
+
+    case SHELL_WM_EFFECT_DESTROY_DIALOG:
+      clutter_actor_set_pivot_point (actor, 0.5, 0.5);
+
+      clutter_actor_save_easing_state (actor);
+      clutter_actor_set_easing_mode (actor, CLUTTER_EASE_OUT_QUAD);
+      clutter_actor_set_easing_duration (actor, get_effect_duration (effect));
+      clutter_actor_set_scale (actor, clutter_actor_get_scale_x (actor), 0);
+      clutter_actor_restore_easing_state (actor);
+      return "scale-y";
+
+    case SHELL_WM_EFFECT_MINIMIZE_FADE:
+      clutter_actor_set_scale (actor, 1, 1);
+
+      clutter_actor_save_easing_state (actor);
+      clutter_actor_set_easing_mode (actor, CLUTTER_EASE_OUT_EXPO);
+      clutter_actor_set_easing_duration (actor, get_effect_duration (effect));
+      clutter_actor_set_opacity (actor, 0);
+      clutter_actor_restore_easing_state (actor);
+      return "opacity";
+
+    case SHELL_WM_EFFECT_MINIMIZE:
+      clutter_actor_set_scale (actor, 1, 1);
+
+      clutter_actor_save_easing_state (actor);
+      clutter_actor_set_easing_mode (actor, CLUTTER_EASE_OUT_EXPO);
+      clutter_actor_set_easing_duration (actor, get_effect_duration (effect));
+      clutter_actor_set_opacity (actor, 0);
+      clutter_actor_set_scale (actor,
+                               width > 0 ? rect->width / width : 0,
+                               height > 0 ? rect->height / height : 0);
+      clutter_actor_set_position (actor, rect->x, rect->y);
+      clutter_actor_restore_easing_state (actor);
+      return "opacity";
+
+    case SHELL_WM_EFFECT_UNMINIMIZE_FADE:
+      clutter_actor_set_opacity (actor, 0);
+      clutter_actor_set_scale (actor, 1, 1);
+
+      clutter_actor_save_easing_state (actor);
+      clutter_actor_set_easing_mode (actor, CLUTTER_EASE_OUT_EXPO);
+      clutter_actor_set_easing_duration (actor, get_effect_duration (effect));
+      clutter_actor_set_opacity (actor, 255);
+      clutter_actor_restore_easing_state (actor);
+      return "opacity";
+
+    case SHELL_WM_EFFECT_UNMINIMIZE:
+      clutter_actor_set_position (actor, rect->x, rect->y);
+      clutter_actor_set_scale (actor,
+                               width > 0 ? rect->width / width : 0,
+                               height > 0 ? rect->height / height : 0);
+      clutter_actor_show (actor);
+
+      meta_window_get_buffer_rect (window, &buffer_rect);
+
+      clutter_actor_save_easing_state (actor);
+      clutter_actor_set_easing_mode (actor, CLUTTER_EASE_OUT_EXPO);
+      clutter_actor_set_easing_duration (actor, get_effect_duration (effect));
+      clutter_actor_set_scale (actor, 1, 1);
+      clutter_actor_set_position (actor, buffer_rect.x, buffer_rect.y);
+      clutter_actor_restore_easing_state (actor);
+      return "scale-x";
+    }
+
+  g_assert_not_reached ();
+}
+
+/**
+ * shell_wm_start_window_effect:
+ * @wm: the ShellWM
+ * @actor: the MetaWindowActor actor
+ * @effect: the effect to run
+ * @rect: (nullable): the rectangle a window minimizes to or unminimizes
+ *   from, such as its icon geometry
+ *
+ * Runs one of the standard window effects natively, instead of
+ * through transitions set up from JS, and completes it with
+ * shell_wm_completed_map() and friends once it is done. The effects of
+ * windows that finish together are announced with a single
+ * #ShellWM::window-effects-completed.
+ */
+void
+shell_wm_start_window_effect (ShellWM            *wm,
+                              MetaWindowActor    *actor,
+                              ShellWMEffect       effect,
+                              const MtkRectangle *rect)
+{
+  WindowEffect *window_effect;
+
+  g_return_if_fail (SHELL_IS_WM (wm));
+  g_return_if_fail (META_IS_WINDOW_ACTOR (actor));
+  g_return_if_fail (rect != NULL ||
+                    (effect != SHELL_WM_EFFECT_MINIMIZE &&
+                     effect != SHELL_WM_EFFECT_UNMINIMIZE));
+
+  /* Complete a running effect first, as mutter would have killed it */
+  window_effect = g_hash_table_lookup (wm->window_effects, actor);
+  if (window_effect)
+    clutter_actor_remove_transition (CLUTTER_ACTOR (actor),
+                                     window_effect->property);
+
+  window_effect = g_new0 (WindowEffect, 1);
+  window_effect->wm = wm;
+  window_effect->actor = actor;
+  window_effect->effect = effect;
+  g_hash_table_replace (wm->window_effects, actor, window_effect);
+
+  window_effect->property = ease_window_actor (CLUTTER_ACTOR (actor),
+                                               effect, rect);
+  window_effect->transition =
+    clutter_actor_get_transition (CLUTTER_ACTOR (actor),
+                                  window_effect->property);
+
+  /* Without animations, the actor is in its final state already */
+  if (window_effect->transition == NULL)
+    {
+      window_effect_done (window_effect);
+      return;
+    }
+
+  g_object_ref (window_effect->transition);
+
+  meta_disable_unredirect_for_display (shell_global_get_display (shell_global_get ()));
+  shell_global_begin_work (shell_global_get ());
+
+  window_effect->stopped_id =
+    g_signal_connect (window_effect->transition, "stopped",
+                      G_CALLBACK (on_transition_stopped), window_effect);
+  window_effect->destroy_id =
+    g_signal_connect (actor, "destroy",
+                      G_CALLBACK (on_window_actor_destroy), window_effect);
+}
@@ -4,12 +4,38 @@
 
 #include <glib-object.h>
 #include <meta/meta-plugin.h>
+#include <mtk/mtk.h>
 
 G_BEGIN_DECLS
 
 #define SHELL_TYPE_WM (shell_wm_get_type ())
 G_DECLARE_FINAL_TYPE (ShellWM, shell_wm, SHELL, WM, GObject)
 
+/**
+ * ShellWMEffect:
+ * @SHELL_WM_EFFECT_MAP: a normal window is mapped
+ * @SHELL_WM_EFFECT_MAP_DIALOG: a dialog is mapped
+ * @SHELL_WM_EFFECT_DESTROY: a normal window is destroyed
+ * @SHELL_WM_EFFECT_DESTROY_DIALOG: a dialog is destroyed
+ * @SHELL_WM_EFFECT_MINIMIZE: a window shrinks into a rectangle
+ * @SHELL_WM_EFFECT_MINIMIZE_FADE: a window fades out
+ * @SHELL_WM_EFFECT_UNMINIMIZE: a window grows out of a rectangle
+ * @SHELL_WM_EFFECT_UNMINIMIZE_FADE: a window fades in
+ *
+ * The window effects run by shell_wm_start_window_effect().
+ */
+typedef enum
+{
+  SHELL_WM_EFFECT_MAP,
+  SHELL_WM_EFFECT_MAP_DIALOG,
+  SHELL_WM_EFFECT_DESTROY,
+  SHELL_WM_EFFECT_DESTROY_DIALOG,
+  SHELL_WM_EFFECT_MINIMIZE,
+  SHELL_WM_EFFECT_MINIMIZE_FADE,
+  SHELL_WM_EFFECT_UNMINIMIZE,
+  SHELL_WM_EFFECT_UNMINIMIZE_FADE,
+} ShellWMEffect;
+
 ShellWM *shell_wm_new                        (MetaPlugin      *plugin);
 
 void     shell_wm_completed_minimize         (ShellWM         *wm,
@@ -27,6 +53,12 @@ void     shell_wm_completed_switch_workspace (ShellWM         *wm);
 void     shell_wm_complete_display_change    (ShellWM         *wm,
                                               gboolean         ok);
 
+void     shell_wm_start_window_effect        (ShellWM            *wm,
+                                              MetaWindowActor    *actor,
+                                              ShellWMEffect       effect,
+                                              const MtkRectangle *rect);
+void     shell_wm_flush_window_effects       (ShellWM            *wm);
+
 G_END_DECLS
 
 #endif /* __SHELL_WM_H__ */
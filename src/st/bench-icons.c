@@ -0,0 +1,684 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * bench-icons.c: benchmark for icon theme lookups and icon loading
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Times icon lookups in the Adwaita and hicolor themes, when installed,
+ * and in a generated theme with thousands of icons: loading the theme,
+ * looking up every icon for the first time and again, fallback chains
+ * of missing names, lookups and decoding straight from the icon caches,
+ * and loading icons through the texture cache, along with what they
+ * take up in it. The results can be written in the format of
+ * performance scripts, to compare runs with gnome-shell-perf-tool.
+ */
+
+#include <clutter/clutter.h>
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include "st-icon-cache.h"
+#include "st-icon-theme.h"
+#include "st-texture-cache.h"
+#include <errno.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <meta-test/meta-context-test.h>
+
+#define SYNTHETIC_THEME "BenchSynthetic"
+#define LOAD_TIMEOUT 10
+
+static int opt_iterations = 5;
+static int opt_synthetic_icons = 4000;
+static int opt_texture_icons = 200;
+static int opt_size = 48;
+static char *opt_output = NULL;
+
+static GOptionEntry opt_entries[] =
+  {
+    { "iterations", 'n', 0, G_OPTION_ARG_INT, &opt_iterations, "Number of times to repeat warm lookups", "N" },
+    { "synthetic-icons", 's', 0, G_OPTION_ARG_INT, &opt_synthetic_icons, "Number of icons in the generated theme", "N" },
+    { "texture-icons", 't', 0, G_OPTION_ARG_INT, &opt_texture_icons, "Icons of each theme to load through the texture cache", "N" },
+    { "size", 'z', 0, G_OPTION_ARG_INT, &opt_size, "Size to look up icons at", "N" },
+    { "output", 'o', 0, G_OPTION_ARG_FILENAME, &opt_output, "Write the results as JSON to FILE", "FILE" },
+    { NULL }
+  };
+
+typedef struct {
+  const char *label;
+  const char *name;
+} BenchTheme;
+
+static const BenchTheme themes[] = {
+  { "adwaita", "Adwaita" },
+  { "hicolor", "hicolor" },
+  { "synthetic", SYNTHETIC_THEME },
+};
+
+static const struct {
+  const char *path;
+  int size;
+} synthetic_directories[] = {
+  { "16x16/apps", 16 },
+  { "48x48/apps", 48 },
+};
+
+typedef struct {
+  char *name;
+  char *description;
+  const char *units;
+  double value;
+} Metric;
+
+typedef struct {
+  char *name;
+  int directory_index;
+} CachedIcon;
+
+static GPtrArray *metrics;
+
+static void
+metric_free (Metric *metric)
+{
+  g_free (metric->name);
+  g_free (metric->description);
+  g_free (metric);
+}
+
+static void
+add_metric (const BenchTheme *theme,
+            const char       *name,
+            const char       *description,
+            const char       *units,
+            double            value)
+{
+  Metric *metric = g_new0 (Metric, 1);
+
+  /* Named like the metrics of performance scripts, e.g. adwaitaLoadTime */
+  metric->name = g_strconcat (theme->label, name, NULL);
+  metric->description = g_strdup_printf ("%s, in %s", description, theme->name);
+  metric->units = units;
+  metric->value = value;
+  g_ptr_array_add (metrics, metric);
+}
+
+static double
+get_rate (guint  n_operations,
+          gint64 elapsed)
+{
+  return n_operations * (double) G_USEC_PER_SEC / MAX (elapsed, 1);
+}
+
+static void
+spawn_update_icon_cache (const char *theme_dir)
+{
+  const char *programs[] = { "gtk4-update-icon-cache", "gtk-update-icon-cache" };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (programs); i++)
+    {
+      g_autofree char *program = g_find_program_in_path (programs[i]);
+      g_autoptr (GError) error = NULL;
+      const char *argv[] = {
+        program, "--quiet", "--include-image-data", theme_dir, NULL
+      };
+      int wait_status;
+
+      if (!program)
+        continue;
+
+      if (g_spawn_sync (NULL, (char **) argv, NULL, G_SPAWN_DEFAULT,
+                        NULL, NULL, NULL, NULL, &wait_status, &error) &&
+          g_spawn_check_wait_status (wait_status, &error))
+        return;
+
+      g_printerr ("%s failed: %s\n", programs[i], error->message);
+    }
+
+  g_printerr ("No icon cache for the generated theme\n");
+}
+
+static void
+write_synthetic_theme (const char *data_home)
+{
+  g_autofree char *theme_dir = NULL;
+  g_autofree char *index_path = NULL;
+  g_autoptr (GError) error = NULL;
+  GString *index;
+  guint i;
+  int j;
+
+  theme_dir = g_build_filename (data_home, "icons", SYNTHETIC_THEME, NULL);
+
+  index = g_string_new ("[Icon Theme]\n"
+                        "Name=" SYNTHETIC_THEME "\n"
+                        "Inherits=hicolor\n"
+                        "Directories=");
+  for (i = 0; i < G_N_ELEMENTS (synthetic_directories); i++)
+    g_string_append_printf (index, "%s%s",
+                            i > 0 ? "," : "",
+                            synthetic_directories[i].path);
+  g_string_append (index, "\n");
+
+  for (i = 0; i < G_N_ELEMENTS (synthetic_directories); i++)
+    {
+      g_autoptr (GdkPixbuf) pixbuf = NULL;
+      g_autofree char *dir = NULL;
+      int size = synthetic_directories[i].size;
+
+      g_string_append_printf (index,
+                              "\n[%s]\nSize=%d\nContext=Applications\nType=Fixed\n",
+                              synthetic_directories[i].path, size);
+
+      dir = g_build_filename (theme_dir, synthetic_directories[i].path, NULL);
+      if (g_mkdir_with_parents (dir, 0755) < 0)
+        g_error ("Failed to create %s: %s", dir, g_strerror (errno));
+
+      pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, TRUE, 8, size, size);
+
+      for (j = 0; j < opt_synthetic_icons; j++)
+        {
+          g_autofree char *basename = NULL;
+          g_autofree char *path = NULL;
+
+          gdk_pixbuf_fill (pixbuf, ((guint32) j * 2654435761u) | 0xff);
+
+          basename = g_strdup_printf ("bench-icon-%05d.png", j);
+          path = g_build_filename (dir, basename, NULL);
+          if (!gdk_pixbuf_save (pixbuf, path, "png", &error, NULL))
+            g_error ("Failed to write %s: %s", path, error->message);
+        }
+    }
+
+  index_path = g_build_filename (theme_dir, "index.theme", NULL);
+  if (!g_file_set_contents (index_path, index->str, index->len, &error))
+    g_error ("Failed to write %s: %s", index_path, error->message);
+
+  g_string_free (index, TRUE);
+
+  /* After the icons, or the cache would be out of date */
+  spawn_update_icon_cache (theme_dir);
+}
+
+static void
+remove_tree (const char *path)
+{
+  GDir *dir = g_dir_open (path, 0, NULL);
+
+  if (dir)
+    {
+      const char *name;
+
+      while ((name = g_dir_read_name (dir)))
+        {
+          g_autofree char *child = g_build_filename (path, name, NULL);
+
+          remove_tree (child);
+        }
+
+      g_dir_close (dir);
+    }
+
+  g_remove (path);
+}
+
+static char *
+find_theme_dir (const char *theme_name)
+{
+  const char * const *data_dirs = g_get_system_data_dirs ();
+  g_autofree char *user_dir = NULL;
+  int i;
+
+  user_dir = g_build_filename (g_get_user_data_dir (), "icons", theme_name, NULL);
+  if (g_file_test (user_dir, G_FILE_TEST_IS_DIR))
+    return g_steal_pointer (&user_dir);
+
+  for (i = 0; data_dirs[i]; i++)
+    {
+      g_autofree char *dir = g_build_filename (data_dirs[i], "icons", theme_name, NULL);
+
+      if (g_file_test (dir, G_FILE_TEST_IS_DIR))
+        return g_steal_pointer (&dir);
+    }
+
+  return NULL;
+}
+
+static void
+set_icon_theme (GSettings  *interface_settings,
+                const char *theme_name)
+{
+  int i;
+
+  /* StSettings, and so the icon theme of the texture cache, follow the
+   * desktop interface settings; let them see the change */
+  g_settings_set_string (interface_settings, "icon-theme", theme_name);
+  g_settings_sync ();
+
+  for (i = 0; i < 100 && g_main_context_iteration (NULL, FALSE); i++)
+    ;
+}
+
+static int
+compare_strings (gconstpointer a,
+                 gconstpointer b)
+{
+  return strcmp (*(const char **) a, *(const char **) b);
+}
+
+static GPtrArray *
+list_icons (StIconTheme *icon_theme)
+{
+  GPtrArray *icons = g_ptr_array_new_with_free_func (g_object_unref);
+  g_autoptr (GPtrArray) names = g_ptr_array_new_with_free_func (g_free);
+  GList *list, *l;
+  guint i;
+
+  list = st_icon_theme_list_icons (icon_theme, NULL);
+  for (l = list; l; l = l->next)
+    g_ptr_array_add (names, l->data);
+  g_list_free (list);
+
+  /* In the same order on every run */
+  g_ptr_array_sort (names, compare_strings);
+
+  for (i = 0; i < names->len; i++)
+    g_ptr_array_add (icons, g_themed_icon_new (names->pdata[i]));
+
+  return icons;
+}
+
+static guint
+lookup_icons (StIconTheme *icon_theme,
+              GPtrArray   *icons)
+{
+  guint i, n_found = 0;
+
+  for (i = 0; i < icons->len; i++)
+    {
+      g_autoptr (StIconInfo) info = NULL;
+
+      info = st_icon_theme_lookup_by_gicon (icon_theme, icons->pdata[i],
+                                            opt_size, 0);
+      if (info)
+        n_found++;
+    }
+
+  return n_found;
+}
+
+static GPtrArray *
+bench_lookups (const BenchTheme *theme)
+{
+  g_autoptr (StIconTheme) icon_theme = st_icon_theme_new ();
+  g_autoptr (GPtrArray) fallback_chains = NULL;
+  GPtrArray *icons;
+  gint64 start, elapsed;
+  guint i, n_found;
+  int j;
+
+  /* Any lookup loads the theme and those it inherits from */
+  start = g_get_monotonic_time ();
+  st_icon_theme_has_icon (icon_theme, "bench-icons-load");
+  add_metric (theme, "LoadTime", "Time to load the theme", "us",
+              g_get_monotonic_time () - start);
+
+  icons = list_icons (icon_theme);
+  if (icons->len == 0)
+    return icons;
+
+  /* Keep every icon info around, so that warm lookups all hit */
+  st_icon_theme_set_info_cache_size (icon_theme, icons->len);
+
+  start = g_get_monotonic_time ();
+  n_found = lookup_icons (icon_theme, icons);
+  elapsed = g_get_monotonic_time () - start;
+  add_metric (theme, "ColdLookupRate",
+              "Icons looked up per second for the first time", "lookups/s",
+              get_rate (icons->len, elapsed));
+
+  if (n_found < icons->len)
+    g_printerr ("%s: %u of %u listed icons not found\n",
+                theme->name, icons->len - n_found, icons->len);
+
+  start = g_get_monotonic_time ();
+  for (j = 0; j < opt_iterations; j++)
+    lookup_icons (icon_theme, icons);
+  elapsed = g_get_monotonic_time () - start;
+  add_metric (theme, "WarmLookupRate",
+              "Icons looked up per second again", "lookups/s",
+              get_rate (icons->len * opt_iterations, elapsed));
+
+  /* Like the names of an application's icon followed by generic ones,
+   * where only the last is in the theme */
+  fallback_chains = g_ptr_array_new_with_free_func ((GDestroyNotify) g_strfreev);
+  for (i = 0; i < icons->len; i++)
+    {
+      const char *name = g_themed_icon_get_names (icons->pdata[i])[0];
+      char **chain = g_new0 (char *, 4);
+
+      chain[0] = g_strdup_printf ("%s-bench-missing", name);
+      chain[1] = g_strdup_printf ("org.example.BenchMissing%u", i);
+      chain[2] = g_strdup (name);
+      g_ptr_array_add (fallback_chains, chain);
+    }
+
+  start = g_get_monotonic_time ();
+  for (j = 0; j < opt_iterations; j++)
+    {
+      for (i = 0; i < fallback_chains->len; i++)
+        {
+          g_autoptr (StIconInfo) info = NULL;
+
+          info = st_icon_theme_choose_icon (icon_theme,
+                                            fallback_chains->pdata[i],
+                                            opt_size, 0);
+        }
+    }
+  elapsed = g_get_monotonic_time () - start;
+  add_metric (theme, "FallbackLookupRate",
+              "Chains of two missing names and a present one resolved per second",
+              "lookups/s",
+              get_rate (fallback_chains->len * opt_iterations, elapsed));
+
+  return icons;
+}
+
+static void
+collect_cached_icon (const char *icon_name,
+                     int         directory_index,
+                     gpointer    user_data)
+{
+  GArray *cached_icons = user_data;
+  CachedIcon cached_icon = { g_strdup (icon_name), directory_index };
+
+  g_array_append_val (cached_icons, cached_icon);
+}
+
+static void
+cached_icon_clear (CachedIcon *cached_icon)
+{
+  g_free (cached_icon->name);
+}
+
+static void
+bench_icon_cache (const BenchTheme *theme,
+                  const char       *theme_dir)
+{
+  g_autoptr (GArray) cached_icons = NULL;
+  StIconCache *cache;
+  gint64 start, elapsed;
+  guint i, n_decoded = 0;
+  int j;
+
+  cache = st_icon_cache_new_for_path (theme_dir);
+  if (!cache)
+    {
+      g_printerr ("%s: no icon cache\n", theme->name);
+      return;
+    }
+
+  cached_icons = g_array_new (FALSE, FALSE, sizeof (CachedIcon));
+  g_array_set_clear_func (cached_icons, (GDestroyNotify) cached_icon_clear);
+  st_icon_cache_foreach_icon (cache, collect_cached_icon, cached_icons);
+
+  start = g_get_monotonic_time ();
+  for (j = 0; j < opt_iterations; j++)
+    {
+      for (i = 0; i < cached_icons->len; i++)
+        st_icon_cache_has_icon (cache, g_array_index (cached_icons, CachedIcon, i).name);
+    }
+  elapsed = g_get_monotonic_time () - start;
+  add_metric (theme, "IconCacheLookupRate",
+              "Icons looked up per second in the icon cache", "lookups/s",
+              get_rate (cached_icons->len * opt_iterations, elapsed));
+
+  /* Only caches generated with --include-image-data hold images */
+  start = g_get_monotonic_time ();
+  for (i = 0; i < cached_icons->len; i++)
+    {
+      CachedIcon *cached_icon = &g_array_index (cached_icons, CachedIcon, i);
+      g_autoptr (GdkPixbuf) pixbuf = NULL;
+
+      pixbuf = st_icon_cache_get_icon (cache, cached_icon->name,
+                                       cached_icon->directory_index);
+      if (pixbuf)
+        n_decoded++;
+    }
+  elapsed = g_get_monotonic_time () - start;
+
+  if (n_decoded > 0)
+    add_metric (theme, "IconCacheDecodeTime",
+                "Time to get an image from the icon cache", "us",
+                (double) elapsed / n_decoded);
+
+  st_icon_cache_unref (cache);
+}
+
+static void
+destroy_actor (ClutterActor *actor)
+{
+  clutter_actor_destroy (actor);
+  g_object_unref (actor);
+}
+
+static gboolean
+on_load_timeout (gpointer data)
+{
+  gboolean *timed_out = data;
+
+  *timed_out = TRUE;
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+all_loaded (GPtrArray *actors)
+{
+  guint i;
+
+  for (i = 0; i < actors->len; i++)
+    {
+      if (!clutter_actor_get_content (actors->pdata[i]))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Returns the time from the first request until every icon has its
+ * texture, or -1 if they didn't all load */
+static gint64
+load_textures (GPtrArray *icons,
+               guint      n_icons,
+               GPtrArray *actors)
+{
+  StTextureCache *cache = st_texture_cache_get_default ();
+  gboolean timed_out = FALSE;
+  gint64 start, elapsed;
+  guint timeout_id, i;
+
+  start = g_get_monotonic_time ();
+
+  for (i = 0; i < n_icons; i++)
+    {
+      ClutterActor *actor;
+
+      actor = st_texture_cache_load_gicon (cache, NULL,
+                                           icons->pdata[i * icons->len / n_icons],
+                                           opt_size, 1, 1.0);
+      if (actor)
+        g_ptr_array_add (actors, g_object_ref_sink (actor));
+    }
+
+  timeout_id = g_timeout_add_seconds (LOAD_TIMEOUT, on_load_timeout, &timed_out);
+  while (!all_loaded (actors) && !timed_out)
+    g_main_context_iteration (NULL, TRUE);
+
+  elapsed = g_get_monotonic_time () - start;
+
+  if (timed_out)
+    return -1;
+
+  g_source_remove (timeout_id);
+  return elapsed;
+}
+
+static void
+bench_texture_cache (const BenchTheme *theme,
+                     GPtrArray        *icons)
+{
+  StTextureCache *cache = st_texture_cache_get_default ();
+  g_autoptr (GPtrArray) cold_actors = NULL;
+  g_autoptr (GPtrArray) warm_actors = NULL;
+  guint n_icons = MIN ((guint) opt_texture_icons, icons->len);
+  gint64 elapsed;
+
+  if (n_icons == 0)
+    return;
+
+  cold_actors = g_ptr_array_new_with_free_func ((GDestroyNotify) destroy_actor);
+  warm_actors = g_ptr_array_new_with_free_func ((GDestroyNotify) destroy_actor);
+
+  elapsed = load_textures (icons, n_icons, cold_actors);
+  if (elapsed < 0)
+    {
+      g_printerr ("%s: icons did not load in %d seconds\n",
+                  theme->name, LOAD_TIMEOUT);
+      return;
+    }
+  add_metric (theme, "TextureMissTime",
+              "Time to load and decode an icon that isn't cached", "us",
+              (double) elapsed / n_icons);
+
+  add_metric (theme, "TextureCacheMemory",
+              "Memory used in the texture cache by the loaded icons", "bytes",
+              st_texture_cache_get_memory_usage (cache));
+
+  elapsed = load_textures (icons, n_icons, warm_actors);
+  if (elapsed >= 0)
+    add_metric (theme, "TextureHitTime",
+                "Time to load an icon that is cached", "us",
+                (double) elapsed / n_icons);
+
+  /* Leave an empty cache for the next theme */
+  g_clear_pointer (&cold_actors, g_ptr_array_unref);
+  g_clear_pointer (&warm_actors, g_ptr_array_unref);
+  st_texture_cache_trim (cache, G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL);
+}
+
+static void
+write_results (void)
+{
+  g_autoptr (GError) error = NULL;
+  GString *json = g_string_new ("{ \"metrics\": [\n");
+  guint i;
+
+  for (i = 0; i < metrics->len; i++)
+    {
+      Metric *metric = metrics->pdata[i];
+
+      g_string_append_printf (json,
+                              "  { \"name\": \"%s\", \"description\": \"%s\","
+                              " \"units\": \"%s\", \"value\": %.3f }%s\n",
+                              metric->name,
+                              metric->description,
+                              metric->units,
+                              metric->value,
+                              i < metrics->len - 1 ? "," : "");
+    }
+
+  g_string_append (json, "] }\n");
+
+  if (!g_file_set_contents (opt_output, json->str, json->len, &error))
+    g_error ("Failed to write results: %s", error->message);
+
+  g_string_free (json, TRUE);
+}
+
+int
+main (int argc, char **argv)
+{
+  MetaContext *context;
+  g_autoptr (GError) error = NULL;
+  g_autoptr (GSettings) interface_settings = NULL;
+  g_autofree char *data_home = NULL;
+  guint i;
+
+  /* Before anything reads them: leave the settings of the session
+   * alone, and put the generated theme on the icon theme search path */
+  g_setenv ("GSETTINGS_BACKEND", "memory", TRUE);
+
+  data_home = g_dir_make_tmp ("bench-icons-XXXXXX", &error);
+  if (!data_home)
+    g_error ("Failed to create data directory: %s", error->message);
+  g_setenv ("XDG_DATA_HOME", data_home, TRUE);
+
+  context = meta_create_test_context (META_CONTEXT_TEST_TYPE_TEST,
+                                      META_CONTEXT_TEST_FLAG_NONE);
+  meta_context_add_option_entries (context, opt_entries, NULL);
+  if (!meta_context_configure (context, &argc, &argv, &error))
+    g_error ("Failed to configure: %s", error->message);
+
+  if (argc != 1 || opt_iterations < 1 || opt_size < 1)
+    {
+      g_printerr ("Usage: %s [OPTION…]\n", g_get_prgname ());
+      return 1;
+    }
+
+  if (!meta_context_setup (context, &error))
+    g_error ("Failed to setup: %s", error->message);
+
+  metrics = g_ptr_array_new_with_free_func ((GDestroyNotify) metric_free);
+  interface_settings = g_settings_new ("org.gnome.desktop.interface");
+
+  write_synthetic_theme (data_home);
+
+  for (i = 0; i < G_N_ELEMENTS (themes); i++)
+    {
+      g_autoptr (GPtrArray) icons = NULL;
+      g_autofree char *theme_dir = find_theme_dir (themes[i].name);
+
+      if (!theme_dir)
+        {
+          g_printerr ("%s: not installed, skipping\n", themes[i].name);
+          continue;
+        }
+
+      set_icon_theme (interface_settings, themes[i].name);
+
+      icons = bench_lookups (&themes[i]);
+      bench_icon_cache (&themes[i], theme_dir);
+      bench_texture_cache (&themes[i], icons);
+    }
+
+  g_print ("%d generated icons, size %d, %d iterations\n",
+           opt_synthetic_icons, opt_size, opt_iterations);
+  for (i = 0; i < metrics->len; i++)
+    {
+      Metric *metric = metrics->pdata[i];
+
+      g_print ("%-32s %14.3f %-10s # %s\n",
+               metric->name, metric->value, metric->units,
+               metric->description);
+    }
+
+  if (opt_output)
+    write_results ();
+
+  remove_tree (data_home);
+  g_ptr_array_unref (metrics);
+
+  g_object_unref (context);
+
+  return 0;
+}
@@ -0,0 +1,407 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * bench-theme.c: benchmark for the CSS cascade and theme node rendering
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Loads a stylesheet, such as gnome-shell.css, plus generated stylesheets
+ * standing in for those of extensions, builds a large tree of theme nodes
+ * and times the separate stages of styling it. The results can be written
+ * in the format of performance scripts, to compare runs with
+ * gnome-shell-perf-tool.
+ */
+
+#include <clutter/clutter.h>
+#include "st-theme.h"
+#include "st-theme-context.h"
+#include "st-theme-node-private.h"
+#include "st-theme-private.h"
+#include "st-bin.h"
+#include "st-box-layout.h"
+#include "st-button.h"
+#include "st-icon.h"
+#include "st-label.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <meta-test/meta-context-test.h>
+#include <meta/meta-backend.h>
+
+static int opt_iterations = 5;
+static int opt_depth = 5;
+static int opt_branching = 6;
+static int opt_extensions = 10;
+static int opt_extension_rules = 200;
+static char *opt_output = NULL;
+
+static GOptionEntry opt_entries[] =
+  {
+    { "iterations", 'n', 0, G_OPTION_ARG_INT, &opt_iterations, "Number of times to run each stage", "N" },
+    { "depth", 'd', 0, G_OPTION_ARG_INT, &opt_depth, "Depth of the node tree", "N" },
+    { "branching", 'b', 0, G_OPTION_ARG_INT, &opt_branching, "Children of each node in the tree", "N" },
+    { "extensions", 'e', 0, G_OPTION_ARG_INT, &opt_extensions, "Number of extension stylesheets to generate", "N" },
+    { "extension-rules", 'r', 0, G_OPTION_ARG_INT, &opt_extension_rules, "Rules in each extension stylesheet", "N" },
+    { "output", 'o', 0, G_OPTION_ARG_FILENAME, &opt_output, "Write the results as JSON to FILE", "FILE" },
+    { NULL }
+  };
+
+/* Style classes used by the shell theme, so that nodes match real rules */
+static const char *style_classes[] = {
+  "panel-button",
+  "popup-menu",
+  "popup-menu-item",
+  "popup-sub-menu",
+  "quick-toggle",
+  "quick-settings",
+  "app-well-app",
+  "overview-tile",
+  "overview-icon",
+  "search-section",
+  "search-result-icon",
+  "list-search-result",
+  "message",
+  "message-list",
+  "notification-banner",
+  "calendar",
+  "calendar-day",
+  "window-caption",
+  "workspace-thumbnail",
+  "dash-item-container",
+  "button",
+  "modal-dialog",
+  "switcher-list",
+  "osd-window",
+};
+
+static const char *pseudo_classes[] = {
+  NULL,
+  NULL,
+  NULL,
+  "hover",
+  "active",
+  "focus",
+  "checked",
+  "insensitive",
+};
+
+typedef struct {
+  const char *name;
+  const char *description;
+  gint64 total_time;
+} Stage;
+
+enum {
+  STAGE_PARSE,
+  STAGE_CREATE,
+  STAGE_MATCH,
+  STAGE_PROPERTIES,
+  STAGE_GEOMETRY,
+  STAGE_BACKGROUND,
+  STAGE_PAINT,
+
+  N_STAGES
+};
+
+static Stage stages[N_STAGES] = {
+  { "parseTime", "Time to parse the stylesheets", 0 },
+  { "createTime", "Time to create the theme nodes", 0 },
+  { "matchTime", "Time to match the rules of all nodes", 0 },
+  { "propertiesTime", "Time to resolve the properties of all nodes", 0 },
+  { "geometryTime", "Time to resolve the geometry of all nodes", 0 },
+  { "backgroundTime", "Time to resolve the backgrounds of all nodes", 0 },
+  { "paintTime", "Time to render and paint the backgrounds of all nodes", 0 },
+};
+
+static ClutterActor *stage;
+static StThemeContext *theme_context;
+static GPtrArray *extension_files;
+
+static GFile *
+write_extension_stylesheet (int index)
+{
+  GString *css = g_string_new (NULL);
+  g_autoptr (GError) error = NULL;
+  g_autofree char *path = NULL;
+  int fd, i;
+
+  /* Rules scoped to the extension's own classes, as well as rules
+   * overriding the shell's, like many extensions add */
+  for (i = 0; i < opt_extension_rules; i++)
+    {
+      const char *style_class = style_classes[(index + i) % G_N_ELEMENTS (style_classes)];
+
+      if (i % 4 == 0)
+        g_string_append_printf (css,
+                                ".%s:hover { background-color: rgba(%d, %d, 255, 0.5); }\n",
+                                style_class, i % 256, index % 256);
+      else if (i % 4 == 1)
+        g_string_append_printf (css,
+                                ".extension-%d-%d .%s { padding: %dpx; border-radius: 6px; }\n",
+                                index, i, style_class, i % 12);
+      else if (i % 4 == 2)
+        g_string_append_printf (css,
+                                "StBoxLayout.extension-%d-%d > StLabel { color: #%06x; }\n",
+                                index, i, (index * 7919 + i * 104729) & 0xffffff);
+      else
+        g_string_append_printf (css,
+                                "#extension-%d-%d { background-gradient-direction: vertical;"
+                                " background-gradient-start: #333; background-gradient-end: #111; }\n",
+                                index, i);
+    }
+
+  fd = g_file_open_tmp ("bench-theme-XXXXXX.css", &path, &error);
+  if (fd < 0)
+    g_error ("Failed to create stylesheet: %s", error->message);
+  close (fd);
+
+  if (!g_file_set_contents (path, css->str, css->len, &error))
+    g_error ("Failed to write stylesheet: %s", error->message);
+
+  g_string_free (css, TRUE);
+
+  return g_file_new_for_path (path);
+}
+
+static StTheme *
+load_theme (GFile *stylesheet)
+{
+  StTheme *theme = st_theme_new (stylesheet, NULL, NULL);
+  guint i;
+
+  for (i = 0; i < extension_files->len; i++)
+    {
+      g_autoptr (GError) error = NULL;
+
+      if (!st_theme_load_stylesheet (theme, extension_files->pdata[i], &error))
+        g_error ("Failed to load stylesheet: %s", error->message);
+    }
+
+  return theme;
+}
+
+static GType
+element_type_for_depth (int depth,
+                        int index)
+{
+  if (depth == opt_depth)
+    return index % 2 ? ST_TYPE_LABEL : ST_TYPE_ICON;
+
+  switch (index % 3)
+    {
+    case 0:
+      return ST_TYPE_BOX_LAYOUT;
+    case 1:
+      return ST_TYPE_BUTTON;
+    default:
+      return ST_TYPE_BIN;
+    }
+}
+
+static void
+create_tree (StThemeNode *parent,
+             int          depth,
+             GPtrArray   *nodes)
+{
+  int i;
+
+  for (i = 0; i < opt_branching; i++)
+    {
+      int index = nodes->len;
+      g_autofree char *element_class = NULL;
+      g_autofree char *element_id = NULL;
+      StThemeNode *node;
+
+      if (index % 5 == 0)
+        element_class = g_strdup_printf ("%s extension-%d-%d",
+                                         style_classes[index % G_N_ELEMENTS (style_classes)],
+                                         index % MAX (opt_extensions, 1),
+                                         index % MAX (opt_extension_rules, 1));
+      else
+        element_class = g_strdup (style_classes[index % G_N_ELEMENTS (style_classes)]);
+
+      if (index % 17 == 0)
+        element_id = g_strdup_printf ("extension-%d-%d",
+                                      index % MAX (opt_extensions, 1),
+                                      index % MAX (opt_extension_rules, 1));
+
+      node = st_theme_node_new (theme_context, parent, NULL,
+                                element_type_for_depth (depth, index),
+                                element_id,
+                                element_class,
+                                pseudo_classes[index % G_N_ELEMENTS (pseudo_classes)],
+                                index % 23 == 0 ? "padding: 4px;" : NULL);
+      g_ptr_array_add (nodes, node);
+
+      if (depth < opt_depth)
+        create_tree (node, depth + 1, nodes);
+    }
+}
+
+static void
+run_iteration (GFile *stylesheet)
+{
+  g_autoptr (GPtrArray) nodes = g_ptr_array_new_with_free_func (g_object_unref);
+  ClutterPaintNode *root;
+  StTheme *theme;
+  gint64 start;
+  guint i;
+
+  start = g_get_monotonic_time ();
+  theme = load_theme (stylesheet);
+  stages[STAGE_PARSE].total_time += g_get_monotonic_time () - start;
+
+  st_theme_context_set_theme (theme_context, theme);
+
+  start = g_get_monotonic_time ();
+  create_tree (st_theme_context_get_root_node (theme_context), 1, nodes);
+  stages[STAGE_CREATE].total_time += g_get_monotonic_time () - start;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < nodes->len; i++)
+    g_ptr_array_unref (_st_theme_get_matched_properties (theme, nodes->pdata[i]));
+  stages[STAGE_MATCH].total_time += g_get_monotonic_time () - start;
+
+  /* Any property lookup runs the cascade for a node */
+  start = g_get_monotonic_time ();
+  for (i = 0; i < nodes->len; i++)
+    st_theme_node_get_font (nodes->pdata[i]);
+  stages[STAGE_PROPERTIES].total_time += g_get_monotonic_time () - start;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < nodes->len; i++)
+    _st_theme_node_ensure_geometry (nodes->pdata[i]);
+  stages[STAGE_GEOMETRY].total_time += g_get_monotonic_time () - start;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < nodes->len; i++)
+    _st_theme_node_ensure_background (nodes->pdata[i]);
+  stages[STAGE_BACKGROUND].total_time += g_get_monotonic_time () - start;
+
+  root = clutter_actor_node_new (stage, 255);
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < nodes->len; i++)
+    {
+      StThemeNodePaintState state;
+      ClutterActorBox box = { 0, 0, 48 + i % 200, 32 + i % 100 };
+
+      st_theme_node_paint_state_init (&state);
+      st_theme_node_paint (nodes->pdata[i], &state, root, &box, 255, 1.0);
+      st_theme_node_paint_state_free (&state);
+    }
+  stages[STAGE_PAINT].total_time += g_get_monotonic_time () - start;
+
+  clutter_paint_node_unref (root);
+
+  g_clear_pointer (&nodes, g_ptr_array_unref);
+  st_theme_context_set_theme (theme_context, NULL);
+  g_object_unref (theme);
+}
+
+static void
+write_results (void)
+{
+  g_autoptr (GError) error = NULL;
+  GString *json = g_string_new ("{ \"metrics\": [\n");
+  int i;
+
+  for (i = 0; i < N_STAGES; i++)
+    g_string_append_printf (json,
+                            "  { \"name\": \"%s\", \"description\": \"%s\","
+                            " \"units\": \"us\", \"value\": %" G_GINT64_FORMAT " }%s\n",
+                            stages[i].name,
+                            stages[i].description,
+                            stages[i].total_time / opt_iterations,
+                            i < N_STAGES - 1 ? "," : "");
+
+  g_string_append (json, "] }\n");
+
+  if (!g_file_set_contents (opt_output, json->str, json->len, &error))
+    g_error ("Failed to write results: %s", error->message);
+
+  g_string_free (json, TRUE);
+}
+
+int
+main (int argc, char **argv)
+{
+  MetaContext *context;
+  g_autoptr (GError) error = NULL;
+  g_autoptr (GFile) stylesheet = NULL;
+  g_autofree char *cwd = NULL;
+  MetaBackend *backend;
+  int n_nodes, level_nodes, i;
+
+  /* meta_init() cds to $HOME */
+  cwd = g_get_current_dir ();
+
+  context = meta_create_test_context (META_CONTEXT_TEST_TYPE_TEST,
+                                      META_CONTEXT_TEST_FLAG_NONE);
+  meta_context_add_option_entries (context, opt_entries, NULL);
+  if (!meta_context_configure (context, &argc, &argv, &error))
+    g_error ("Failed to configure: %s", error->message);
+
+  if (argc != 2 || opt_iterations < 1)
+    {
+      g_printerr ("Usage: %s [OPTION…] STYLESHEET\n", g_get_prgname ());
+      return 1;
+    }
+
+  stylesheet = g_file_new_for_commandline_arg_and_cwd (argv[1], cwd);
+
+  if (!meta_context_setup (context, &error))
+    g_error ("Failed to setup: %s", error->message);
+
+  if (chdir (cwd) < 0)
+    g_error ("chdir('%s') failed: %s", cwd, g_strerror (errno));
+
+  backend = meta_context_get_backend (context);
+  stage = meta_backend_get_stage (backend);
+  theme_context = st_theme_context_get_for_stage (CLUTTER_STAGE (stage));
+
+  extension_files = g_ptr_array_new_with_free_func (g_object_unref);
+  for (i = 0; i < opt_extensions; i++)
+    g_ptr_array_add (extension_files, write_extension_stylesheet (i));
+
+  for (i = 0; i < opt_iterations; i++)
+    run_iteration (stylesheet);
+
+  n_nodes = 0;
+  level_nodes = 1;
+  for (i = 0; i < opt_depth; i++)
+    {
+      level_nodes *= opt_branching;
+      n_nodes += level_nodes;
+    }
+
+  g_print ("%d nodes, %d extension stylesheets of %d rules, %d iterations\n",
+           n_nodes, opt_extensions, opt_extension_rules, opt_iterations);
+  for (i = 0; i < N_STAGES; i++)
+    g_print ("%-16s %10.3f ms  # %s\n",
+             stages[i].name,
+             stages[i].total_time / (1000. * opt_iterations),
+             stages[i].description);
+
+  if (opt_output)
+    write_results ();
+
+  for (i = 0; i < extension_files->len; i++)
+    g_file_delete (extension_files->pdata[i], NULL, NULL);
+  g_ptr_array_unref (extension_files);
+
+  g_object_unref (context);
+
+  return 0;
+}
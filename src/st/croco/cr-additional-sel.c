@@ -22,6 +22,7 @@
  *
  */
 
+#include "cr-arena.h"
 #include "cr-additional-sel.h"
 #include "string.h"
 
@@ -47,15 +48,13 @@ cr_additional_sel_new (void)
 {
         CRAdditionalSel *result = NULL;
 
-        result = g_try_malloc (sizeof (CRAdditionalSel));
+        result = cr_arena_alloc0 (sizeof (CRAdditionalSel));
 
         if (result == NULL) {
                 cr_utils_trace_debug ("Out of memory");
                 return NULL;
         }
 
-        memset (result, 0, sizeof (CRAdditionalSel));
-
         return result;
 }
 
@@ -494,5 +493,5 @@ cr_additional_sel_destroy (CRAdditionalSel * a_this)
                 cr_additional_sel_destroy (a_this->next);
         }
 
-        g_free (a_this);
+        cr_arena_free (a_this);
 }
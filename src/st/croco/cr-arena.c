@@ -0,0 +1,217 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset: 8-*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+#include <string.h>
+#include "cr-arena.h"
+#include "cr-utils.h"
+
+/*
+ *Every block handed out by cr_arena_alloc0() is preceded by
+ *a header telling whether it lives in an arena, so that
+ *cr_arena_free() works on both kinds of blocks.
+ */
+typedef union {
+        CRArena *arena;
+        gint64 align_int;
+        gdouble align_double;
+} CRArenaHeader;
+
+#define CR_ARENA_ALIGN (sizeof (CRArenaHeader))
+#define CR_ARENA_CHUNK_SIZE 16384
+
+typedef struct _CRArenaChunk CRArenaChunk;
+
+struct _CRArenaChunk {
+        CRArenaChunk *next;
+        gsize size;
+        gsize used;
+        /* followed by the data, suitably aligned */
+};
+
+#define CR_ARENA_ROUND_UP(size) \
+        (((size) + CR_ARENA_ALIGN - 1) / CR_ARENA_ALIGN * CR_ARENA_ALIGN)
+#define CR_ARENA_CHUNK_HEADER_SIZE CR_ARENA_ROUND_UP (sizeof (CRArenaChunk))
+#define CR_ARENA_CHUNK_DATA(chunk) \
+        ((guchar *) (chunk) + CR_ARENA_CHUNK_HEADER_SIZE)
+
+struct _CRArena {
+        /* the chunk blocks are carved from; the others are full */
+        CRArenaChunk *chunks;
+};
+
+static GPrivate current_arena;
+
+/**
+ * cr_arena_new:
+ *
+ *Returns a new, empty, #CRArena.
+ */
+CRArena *
+cr_arena_new (void)
+{
+        return g_new0 (CRArena, 1);
+}
+
+/**
+ * cr_arena_destroy:
+ *@a_this: the #CRArena to destroy.
+ *
+ *Frees @a_this along with all the memory allocated from it.
+ *The objects must not be used anymore.
+ */
+void
+cr_arena_destroy (CRArena * a_this)
+{
+        CRArenaChunk *chunk = NULL,
+                *next = NULL;
+
+        g_return_if_fail (a_this);
+
+        for (chunk = a_this->chunks; chunk; chunk = next) {
+                next = chunk->next;
+                g_free (chunk);
+        }
+        g_free (a_this);
+}
+
+/**
+ * cr_arena_push:
+ *@a_this: the #CRArena to allocate from, or NULL for the heap.
+ *
+ *Makes @a_this the current arena of the calling thread.
+ *
+ *Returns the previous current arena, to be passed to cr_arena_pop().
+ */
+CRArena *
+cr_arena_push (CRArena * a_this)
+{
+        CRArena *previous = g_private_get (&current_arena);
+
+        g_private_set (&current_arena, a_this);
+
+        return previous;
+}
+
+/**
+ * cr_arena_pop:
+ *@a_previous: the value returned by the matching cr_arena_push().
+ *
+ *Restores the current arena of the calling thread.
+ */
+void
+cr_arena_pop (CRArena * a_previous)
+{
+        g_private_set (&current_arena, a_previous);
+}
+
+static CRArenaChunk *
+cr_arena_add_chunk (CRArena * a_this, gsize a_min_size)
+{
+        CRArenaChunk *chunk = NULL;
+        gsize size = MAX (a_min_size, CR_ARENA_CHUNK_SIZE);
+
+        chunk = g_try_malloc (CR_ARENA_CHUNK_HEADER_SIZE + size);
+        if (!chunk)
+                return NULL;
+
+        chunk->size = size;
+        chunk->used = 0;
+
+        if (a_this->chunks && size > CR_ARENA_CHUNK_SIZE) {
+                /*
+                 *Oversized blocks get a chunk of their own; keep
+                 *carving from the current one.
+                 */
+                chunk->next = a_this->chunks->next;
+                a_this->chunks->next = chunk;
+        } else {
+                chunk->next = a_this->chunks;
+                a_this->chunks = chunk;
+        }
+
+        return chunk;
+}
+
+/**
+ * cr_arena_alloc0:
+ *@a_size: the size of the block to allocate.
+ *
+ *Allocates a zero-filled block of @a_size bytes from the current
+ *arena of the calling thread, or from the heap if there is none.
+ *The block must be released with cr_arena_free().
+ *
+ *Returns the block, or NULL if out of memory.
+ */
+gpointer
+cr_arena_alloc0 (gsize a_size)
+{
+        CRArena *arena = g_private_get (&current_arena);
+        CRArenaHeader *header = NULL;
+        gsize size = CR_ARENA_ROUND_UP (sizeof (CRArenaHeader) + a_size);
+
+        if (arena) {
+                CRArenaChunk *chunk = arena->chunks;
+
+                if (!chunk || chunk->size - chunk->used < size) {
+                        chunk = cr_arena_add_chunk (arena, size);
+                        if (!chunk) {
+                                cr_utils_trace_info ("Out of memory");
+                                return NULL;
+                        }
+                }
+
+                header = (CRArenaHeader *) (CR_ARENA_CHUNK_DATA (chunk)
+                                            + chunk->used);
+                chunk->used += size;
+                /* chunks are not zeroed, blocks are never reused */
+                memset (header, 0, size);
+                header->arena = arena;
+        } else {
+                header = g_try_malloc0 (size);
+                if (!header) {
+                        cr_utils_trace_info ("Out of memory");
+                        return NULL;
+                }
+        }
+
+        return header + 1;
+}
+
+/**
+ * cr_arena_free:
+ *@a_mem: a block returned by cr_arena_alloc0(), or NULL.
+ *
+ *Frees @a_mem if it was allocated from the heap; blocks
+ *from an arena are only freed with it.
+ */
+void
+cr_arena_free (gpointer a_mem)
+{
+        CRArenaHeader *header = NULL;
+
+        if (!a_mem)
+                return;
+
+        header = (CRArenaHeader *) a_mem - 1;
+        if (!header->arena)
+                g_free (header);
+}
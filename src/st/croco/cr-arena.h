@@ -0,0 +1,61 @@
+/* -*- Mode: C; indent-tabs-mode:nil; c-basic-offset: 8-*- */
+
+/*
+ * This file is part of The Croco Library
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2.1 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ *
+ * See COPYRIGHTS file for copyright information.
+ */
+
+/**
+ *@file
+ *Declaration file of the #CRArena class.
+ */
+
+#ifndef __CR_ARENA_H__
+#define __CR_ARENA_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ *A region allocator for the small objects of the object model
+ *(terms, declarations, selectors, strings...).
+ *
+ *While an arena is the current arena of a thread (see cr_arena_push()),
+ *cr_arena_alloc0() carves the objects out of large contiguous chunks
+ *of the arena instead of allocating them one by one. cr_arena_free()
+ *is a no-op for such objects: their memory is only given back,
+ *all at once, by cr_arena_destroy().
+ */
+typedef struct _CRArena CRArena ;
+
+CRArena * cr_arena_new (void) ;
+
+void cr_arena_destroy (CRArena *a_this) ;
+
+CRArena * cr_arena_push (CRArena *a_this) ;
+
+void cr_arena_pop (CRArena *a_previous) ;
+
+gpointer cr_arena_alloc0 (gsize a_size) ;
+
+void cr_arena_free (gpointer a_mem) ;
+
+G_END_DECLS
+
+#endif /*__CR_ARENA_H__*/
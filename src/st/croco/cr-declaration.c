@@ -23,6 +23,7 @@
 
 
 #include <string.h>
+#include "cr-arena.h"
 #include "cr-declaration.h"
 #include "cr-statement.h"
 #include "cr-parser.h"
@@ -86,12 +87,11 @@ cr_declaration_new (CRStatement * a_statement,
                                           || (a_statement->type
                                               == AT_PAGE_RULE_STMT)), NULL);
 
-        result = g_try_malloc (sizeof (CRDeclaration));
+        result = cr_arena_alloc0 (sizeof (CRDeclaration));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
         }
-        memset (result, 0, sizeof (CRDeclaration));
         result->property = a_property;
         result->value = a_value;
 
@@ -780,7 +780,7 @@ cr_declaration_destroy (CRDeclaration * a_this)
          * Meanwhile, free each property/value pair contained in the list.
          */
         for (; cur; cur = cur->prev) {
-                g_free (cur->next);
+                cr_arena_free (cur->next);
                 cur->next = NULL;
 
                 if (cur->property) {
@@ -794,5 +794,5 @@ cr_declaration_destroy (CRDeclaration * a_this)
                 }
         }
 
-        g_free (a_this);
+        cr_arena_free (a_this);
 }
@@ -738,6 +738,87 @@ cr_input_consume_white_spaces (CRInput * a_this, gulong * a_nb_chars)
         return status;
 }
 
+static gboolean
+cr_input_ascii_byte_matches (guchar a_byte, enum CRAsciiClass a_classes)
+{
+        if ((a_classes & CR_ASCII_ALPHA)
+            && ((a_byte >= 'a' && a_byte <= 'z')
+                || (a_byte >= 'A' && a_byte <= 'Z')))
+                return TRUE;
+        if ((a_classes & CR_ASCII_DIGIT)
+            && a_byte >= '0' && a_byte <= '9')
+                return TRUE;
+        if ((a_classes & CR_ASCII_NMCHAR_PUNCT)
+            && (a_byte == '-' || a_byte == '_'))
+                return TRUE;
+        if ((a_classes & CR_ASCII_WHITE_SPACE)
+            && (a_byte == ' ' || a_byte == '\t' || a_byte == '\n'
+                || a_byte == '\r' || a_byte == '\f'))
+                return TRUE;
+        if ((a_classes & CR_ASCII_NOT_STAR) && a_byte != '*')
+                return TRUE;
+        return FALSE;
+}
+
+/**
+ * cr_input_read_ascii_run:
+ *@a_this: the current instance of #CRInput.
+ *@a_classes: the set of ASCII byte classes to consume.
+ *@a_out: if non NULL, the consumed bytes are appended to it.
+ *
+ *Consumes the longest run of ASCII bytes belonging to @a_classes
+ *directly from the input buffer, updating the line and column
+ *numbers exactly like successive calls to cr_input_read_char() would.
+ *The run stops at the first byte that isn't in @a_classes, at the
+ *first non ASCII byte and at the end of the input, so that the caller
+ *can go on with the per character (UTF-8 decoding) path from there.
+ *
+ *Returns the number of bytes consumed.
+ */
+gulong
+cr_input_read_ascii_run (CRInput * a_this, enum CRAsciiClass a_classes,
+                         GString * a_out)
+{
+        CRInputPriv *priv = NULL;
+        gulong start = 0,
+                index = 0;
+
+        g_return_val_if_fail (a_this && PRIVATE (a_this), 0);
+
+        priv = PRIVATE (a_this);
+        if (priv->end_of_input == TRUE)
+                return 0;
+
+        start = index = priv->next_byte_index;
+        while (index < priv->nb_bytes) {
+                guchar byte = priv->in_buf[index];
+
+                if (byte >= 0x80
+                    || cr_input_ascii_byte_matches (byte, a_classes) == FALSE)
+                        break;
+
+                if (priv->end_of_line == TRUE) {
+                        priv->col = 1;
+                        priv->line++;
+                        priv->end_of_line = FALSE;
+                } else if (byte != '\n') {
+                        priv->col++;
+                }
+                if (byte == '\n')
+                        priv->end_of_line = TRUE;
+
+                index++;
+        }
+
+        if (a_out && index > start)
+                g_string_append_len (a_out, (const gchar *) priv->in_buf + start,
+                                     index - start);
+
+        priv->next_byte_index = index;
+
+        return index - start;
+}
+
 /**
  * cr_input_peek_char:
  *@a_this: the current instance of #CRInput.
@@ -60,6 +60,20 @@ struct _CRInputPos
         glong next_byte_index ;
 } ;
 
+/**
+ *Classes of ASCII bytes that can be consumed in one go
+ *by cr_input_read_ascii_run().
+ */
+enum CRAsciiClass
+{
+        CR_ASCII_ALPHA = 1 << 0,        /* [a-zA-Z] */
+        CR_ASCII_DIGIT = 1 << 1,        /* [0-9] */
+        CR_ASCII_NMCHAR_PUNCT = 1 << 2, /* [-_] */
+        CR_ASCII_WHITE_SPACE = 1 << 3,  /* [ \t\n\r\f] */
+        CR_ASCII_NOT_STAR = 1 << 4,     /* [^*] */
+        CR_ASCII_NMCHAR = CR_ASCII_ALPHA | CR_ASCII_DIGIT | CR_ASCII_NMCHAR_PUNCT
+} ;
+
 CRInput *
 cr_input_new_from_buf (guchar *a_buf, gulong a_len,
                        enum CREncoding a_enc, gboolean a_free_buf) ;
@@ -92,6 +106,10 @@ cr_input_consume_char (CRInput *a_this, guint32 a_char) ;
 enum CRStatus
 cr_input_consume_white_spaces (CRInput *a_this, gulong *a_nb_chars) ;
 
+gulong
+cr_input_read_ascii_run (CRInput *a_this, enum CRAsciiClass a_classes,
+                         GString *a_out) ;
+
 enum CRStatus
 cr_input_peek_byte (CRInput const *a_this, enum CRSeekPos a_origin,
                     gulong a_offset, guchar *a_byte) ;
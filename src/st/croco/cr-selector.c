@@ -21,6 +21,7 @@
  */
 
 #include <string.h>
+#include "cr-arena.h"
 #include "cr-selector.h"
 #include "cr-parser.h"
 
@@ -40,12 +41,11 @@ cr_selector_new (CRSimpleSel * a_simple_sel)
 {
         CRSelector *result = NULL;
 
-        result = g_try_malloc (sizeof (CRSelector));
+        result = cr_arena_alloc0 (sizeof (CRSelector));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
         }
-        memset (result, 0, sizeof (CRSelector));
         result->simple_sel = a_simple_sel;
         return result;
 }
@@ -267,14 +267,14 @@ cr_selector_destroy (CRSelector * a_this)
 
         /*in case the list has only one element */
         if (cur && !cur->prev) {
-                g_free (cur);
+                cr_arena_free (cur);
                 return;
         }
 
         /*walk backward the list and free each "next element" */
         for (cur = cur->prev; cur && cur->prev; cur = cur->prev) {
                 if (cur->next) {
-                        g_free (cur->next);
+                        cr_arena_free (cur->next);
                         cur->next = NULL;
                 }
         }
@@ -283,9 +283,9 @@ cr_selector_destroy (CRSelector * a_this)
                 return;
 
         if (cur->next) {
-                g_free (cur->next);
+                cr_arena_free (cur->next);
                 cur->next = NULL;
         }
 
-        g_free (cur);
+        cr_arena_free (cur);
 }
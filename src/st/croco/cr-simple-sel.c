@@ -23,6 +23,7 @@
 
 #include <string.h>
 #include <glib.h>
+#include "cr-arena.h"
 #include "cr-simple-sel.h"
 
 /**
@@ -37,13 +38,11 @@ cr_simple_sel_new (void)
 {
         CRSimpleSel *result = NULL;
 
-        result = g_try_malloc (sizeof (CRSimpleSel));
+        result = cr_arena_alloc0 (sizeof (CRSimpleSel));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
         }
-        memset (result, 0, sizeof (CRSimpleSel));
-
         return result;
 }
 
@@ -318,6 +317,6 @@ cr_simple_sel_destroy (CRSimpleSel * a_this)
         }
 
         if (a_this) {
-                g_free (a_this);
+                cr_arena_free (a_this);
         }
 }
@@ -22,6 +22,7 @@
  */
 
 #include <string.h>
+#include "cr-arena.h"
 #include "cr-string.h"
 
 /**
@@ -34,12 +35,11 @@ cr_string_new (void)
 {
 	CRString *result = NULL ;
 
-	result = g_try_malloc (sizeof (CRString)) ;
+	result = cr_arena_alloc0 (sizeof (CRString)) ;
 	if (!result) {
 		cr_utils_trace_info ("Out of memory") ;
 		return NULL ;
 	}
-	memset (result, 0, sizeof (CRString)) ;
         result->stryng = g_string_new (NULL) ;
 	return result ;
 }
@@ -164,5 +164,5 @@ cr_string_destroy (CRString *a_this)
 		g_string_free (a_this->stryng, TRUE) ;
 		a_this->stryng = NULL ;
 	}
-	g_free (a_this) ;
+	cr_arena_free (a_this) ;
 }
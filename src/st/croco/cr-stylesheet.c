@@ -173,5 +173,9 @@ cr_stylesheet_destroy (CRStyleSheet * a_this)
                 cr_statement_destroy (a_this->statements);
                 a_this->statements = NULL;
         }
+        if (a_this->arena) {
+                cr_arena_destroy (a_this->arena);
+                a_this->arena = NULL;
+        }
         g_free (a_this);
 }
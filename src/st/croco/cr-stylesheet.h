@@ -25,6 +25,7 @@
 #define __CR_STYLESHEET_H__
 
 #include "cr-utils.h"
+#include "cr-arena.h"
 #include "cr-statement.h"
 
 G_BEGIN_DECLS
@@ -73,6 +74,12 @@ struct _CRStyleSheet
 	 */
 	gpointer app_data ;
 
+        /**
+         *the arena the statements were allocated from, if
+         *any. It is destroyed along with the stylesheet.
+         */
+        CRArena *arena ;
+
 	/**
 	 *the reference count of this instance
 	 *Please, don't never ever modify it
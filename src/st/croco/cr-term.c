@@ -23,6 +23,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include "cr-arena.h"
 #include "cr-term.h"
 #include "cr-num.h"
 #include "cr-parser.h"
@@ -86,12 +87,11 @@ cr_term_new (void)
 {
         CRTerm *result = NULL;
 
-        result = g_try_malloc (sizeof (CRTerm));
+        result = cr_arena_alloc0 (sizeof (CRTerm));
         if (!result) {
                 cr_utils_trace_info ("Out of memory");
                 return NULL;
         }
-        memset (result, 0, sizeof (CRTerm));
         return result;
 }
 
@@ -774,13 +774,18 @@ cr_term_destroy (CRTerm * a_this)
 
         cr_term_clear (a_this);
 
+        if (a_this->app_data) {
+                cr_arena_free (a_this->app_data);
+                a_this->app_data = NULL;
+        }
+
         if (a_this->next) {
                 cr_term_destroy (a_this->next);
                 a_this->next = NULL;
         }
 
         if (a_this) {
-                g_free (a_this);
+                cr_arena_free (a_this);
         }
 
 }
@@ -124,7 +124,8 @@ struct _CRTerm
 
         /**
          *A spare pointer, just in case.
-         *Can be used by the application.
+         *Can be used by the application; it is owned
+         *by the term and must come from cr_arena_alloc0 ().
          */
         gpointer app_data ;
 
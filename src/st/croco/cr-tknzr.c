@@ -290,6 +290,11 @@ cr_tknzr_parse_w (CRTknzr * a_this,
         RECORD_CUR_BYTE_ADDR (a_this, a_start);
         *a_end = *a_start;
 
+        if (cr_input_read_ascii_run (PRIVATE (a_this)->input,
+                                     CR_ASCII_WHITE_SPACE, NULL) > 0) {
+                RECORD_CUR_BYTE_ADDR (a_this, a_end);
+        }
+
         for (;;) {
                 gboolean is_eof = FALSE;
 
@@ -407,10 +412,9 @@ cr_tknzr_try_to_skip_spaces (CRTknzr * a_this)
         }
 
         if (cr_utils_is_white_space (cur_char) == TRUE) {
-                gulong nb_chars = -1; /*consume all spaces */
-
-                status = cr_input_consume_white_spaces
-                        (PRIVATE (a_this)->input, &nb_chars);
+                /*consume all spaces; they are all ASCII */
+                cr_input_read_ascii_run (PRIVATE (a_this)->input,
+                                         CR_ASCII_WHITE_SPACE, NULL);
         }
 
         return status;
@@ -447,12 +451,16 @@ cr_tknzr_parse_comment (CRTknzr * a_this,
         READ_NEXT_CHAR (a_this, &cur_char);
         ENSURE_PARSING_COND (cur_char == '*');
         comment = cr_string_new ();
+        cr_input_read_ascii_run (PRIVATE (a_this)->input,
+                                 CR_ASCII_NOT_STAR, comment->stryng);
         for (;;) { /* [^*]* */
                 PEEK_NEXT_CHAR (a_this, &next_char);
                 if (next_char == '*')
                         break;
                 READ_NEXT_CHAR (a_this, &cur_char);
                 g_string_append_unichar (comment->stryng, cur_char);
+                cr_input_read_ascii_run (PRIVATE (a_this)->input,
+                                         CR_ASCII_NOT_STAR, comment->stryng);
         }
         /* Stop condition: next_char == '*' */
         for (;;) { /* \*+ */
@@ -469,12 +477,17 @@ cr_tknzr_parse_comment (CRTknzr * a_this,
                         break;
                 READ_NEXT_CHAR(a_this, &cur_char);
                 g_string_append_unichar (comment->stryng, cur_char);
+                cr_input_read_ascii_run (PRIVATE (a_this)->input,
+                                         CR_ASCII_NOT_STAR, comment->stryng);
                 for (;;) { /* [^*]* */
                         PEEK_NEXT_CHAR (a_this, &next_char);
                         if (next_char == '*')
                                 break;
                         READ_NEXT_CHAR (a_this, &cur_char);
                         g_string_append_unichar (comment->stryng, cur_char);
+                        cr_input_read_ascii_run (PRIVATE (a_this)->input,
+                                                 CR_ASCII_NOT_STAR,
+                                                 comment->stryng);
                 }
                 /* Stop condition: next_char = '*', no need to verify, because peek and read exit to error anyway */
                 for (;;) { /* \*+ */
@@ -964,6 +977,13 @@ cr_tknzr_parse_ident (CRTknzr * a_this, CRString ** a_str)
         }
         g_string_append_unichar (stringue->stryng, tmp_char);
         for (;;) {
+                /*
+                 *Take the plain ASCII part of the name in one go and
+                 *only go through the UTF-8 aware path for escapes
+                 *and non ASCII characters.
+                 */
+                cr_input_read_ascii_run (PRIVATE (a_this)->input,
+                                         CR_ASCII_NMCHAR, stringue->stryng);
                 status = cr_tknzr_parse_nmchar (a_this, 
                                                 &tmp_char, 
                                                 NULL);
@@ -1049,6 +1069,8 @@ cr_tknzr_parse_name (CRTknzr * a_this,
                         break;                
                 g_string_append_unichar ((*a_str)->stryng, 
                                          tmp_char);
+                cr_input_read_ascii_run (PRIVATE (a_this)->input,
+                                         CR_ASCII_NMCHAR, (*a_str)->stryng);
         }
         if (i > 0) {
                 cr_parsing_location_copy 
@@ -1543,12 +1565,34 @@ cr_tknzr_parse_num (CRTknzr * a_this,
                         parsed = FALSE;  /* In CSS, there must be at least
                                             one digit after `.'. */
                 } else if (IS_NUM (next_char)) {
-                        READ_NEXT_CHAR (a_this, &cur_char);
+                        glong index = 0;
+                        guchar *digits = NULL;
+                        gulong nb_digits = 0,
+                                i = 0;
+
+                        /*consume the whole run of digits at once */
+                        cr_input_get_cur_index (PRIVATE (a_this)->input,
+                                                &index);
+                        digits = cr_input_get_byte_addr
+                                (PRIVATE (a_this)->input, index);
+                        if (digits)
+                                nb_digits = cr_input_read_ascii_run
+                                        (PRIVATE (a_this)->input,
+                                         CR_ASCII_DIGIT, NULL);
+                        if (nb_digits == 0) {
+                                READ_NEXT_CHAR (a_this, &cur_char);
+                                numerator = numerator * 10 + (cur_char - '0');
+                                if (parsing_dec) {
+                                        denominator *= 10;
+                                }
+                        }
                         parsed = TRUE;
 
-                        numerator = numerator * 10 + (cur_char - '0');
-                        if (parsing_dec) {
-                                denominator *= 10;
+                        for (i = 0; i < nb_digits; i++) {
+                                numerator = numerator * 10 + (digits[i] - '0');
+                                if (parsing_dec) {
+                                        denominator *= 10;
+                                }
                         }
                 } else {
                         break;
@@ -24,6 +24,7 @@
 #include "libcroco-config.h"
 
 #include "cr-utils.h"
+#include "cr-arena.h"
 #include "cr-pseudo.h"
 #include "cr-term.h"
 #include "cr-attr-sel.h"
@@ -37,6 +37,14 @@
 #include "st-adjustment.h"
 #include "st-private.h"
 
+/* Flings decay exponentially with this time constant, in ms */
+#define FLING_TIME_CONSTANT 325.0
+/* Angular frequency of the critically damped spring, per ms */
+#define SPRING_FREQUENCY 0.02
+/* Kinetic scrolling stops below this velocity, in units per ms */
+#define KINETIC_MIN_VELOCITY 0.01
+#define SPRING_MIN_DISTANCE 0.5
+
 typedef struct _StAdjustmentPrivate StAdjustmentPrivate;
 
 struct _StAdjustmentPrivate
@@ -49,6 +57,12 @@ struct _StAdjustmentPrivate
 
   GHashTable *transitions;
 
+  /* Kinetic scrolling, integrated on the frame clock of the actor */
+  ClutterTimeline *kinetic_timeline;
+  gdouble kinetic_velocity;
+  gdouble kinetic_target;
+  guint kinetic_spring : 1;
+
   gdouble  lower;
   gdouble  upper;
   gdouble  value;
@@ -190,6 +204,18 @@ st_adjustment_get_property (GObject    *gobject,
     }
 }
 
+static void
+clear_kinetic_timeline (StAdjustment *adj)
+{
+  StAdjustmentPrivate *priv = st_adjustment_get_instance_private (adj);
+
+  if (priv->kinetic_timeline == NULL)
+    return;
+
+  clutter_timeline_stop (priv->kinetic_timeline);
+  g_clear_object (&priv->kinetic_timeline);
+}
+
 static void
 actor_destroyed (gpointer  user_data,
                  GObject  *where_the_object_was)
@@ -197,6 +223,7 @@ actor_destroyed (gpointer  user_data,
   StAdjustment *adj = ST_ADJUSTMENT (user_data);
   StAdjustmentPrivate *priv = st_adjustment_get_instance_private (adj);
 
+  clear_kinetic_timeline (adj);
   priv->actor = NULL;
 
   g_object_notify_by_pspec (G_OBJECT (adj), props[PROP_ACTOR]);
@@ -213,6 +240,8 @@ st_adjustment_set_actor (StAdjustment *adj,
   if (priv->actor == actor)
     return;
 
+  clear_kinetic_timeline (adj);
+
   if (priv->actor)
     g_object_weak_unref (G_OBJECT (priv->actor), actor_destroyed, adj);
   priv->actor = actor;
@@ -272,6 +301,7 @@ st_adjustment_dispose (GObject *object)
   StAdjustmentPrivate *priv;
 
   priv = st_adjustment_get_instance_private (ST_ADJUSTMENT (object));
+  clear_kinetic_timeline (ST_ADJUSTMENT (object));
   if (priv->actor)
     {
       g_object_weak_unref (G_OBJECT (priv->actor), actor_destroyed, object);
@@ -972,6 +1002,8 @@ st_adjustment_add_transition (StAdjustment      *adjustment,
       return;
     }
 
+  st_adjustment_stop_kinetic (adjustment);
+
   clutter_transition_set_animatable (transition, CLUTTER_ANIMATABLE (adjustment));
 
   clos = g_new (TransitionClosure, 1);
@@ -1015,3 +1047,207 @@ st_adjustment_remove_transition (StAdjustment *adjustment,
 
   remove_transition (adjustment, name);
 }
+
+static void
+kinetic_new_frame (ClutterTimeline *timeline,
+                   int              msecs,
+                   StAdjustment    *adjustment)
+{
+  StAdjustmentPrivate *priv = st_adjustment_get_instance_private (adjustment);
+  double dt, decay, lower, upper;
+
+  dt = clutter_timeline_get_delta (timeline);
+  if (dt <= 0)
+    return;
+
+  lower = priv->lower;
+  upper = MAX (priv->lower, priv->upper - priv->page_size);
+
+  if (priv->kinetic_spring)
+    {
+      /* Closed form of a critically damped spring, so that long frames
+       * can't make it overshoot or diverge */
+      double a, b, offset;
+
+      /* The bounds may have changed since the target was set */
+      priv->kinetic_target = CLAMP (priv->kinetic_target, lower, upper);
+
+      a = priv->value - priv->kinetic_target;
+      b = priv->kinetic_velocity + SPRING_FREQUENCY * a;
+
+      decay = exp (-SPRING_FREQUENCY * dt);
+      offset = (a + b * dt) * decay;
+      priv->kinetic_velocity = (b - SPRING_FREQUENCY * (a + b * dt)) * decay;
+
+      if (fabs (offset) < SPRING_MIN_DISTANCE &&
+          fabs (priv->kinetic_velocity) < KINETIC_MIN_VELOCITY)
+        {
+          st_adjustment_stop_kinetic (adjustment);
+          st_adjustment_set_value (adjustment, priv->kinetic_target);
+          return;
+        }
+
+      st_adjustment_set_value (adjustment, priv->kinetic_target + offset);
+    }
+  else
+    {
+      decay = exp (-dt / FLING_TIME_CONSTANT);
+      st_adjustment_set_value (adjustment,
+                               priv->value +
+                               priv->kinetic_velocity * FLING_TIME_CONSTANT * (1 - decay));
+      priv->kinetic_velocity *= decay;
+
+      if (fabs (priv->kinetic_velocity) < KINETIC_MIN_VELOCITY ||
+          (priv->kinetic_velocity < 0 && priv->value <= lower) ||
+          (priv->kinetic_velocity > 0 && priv->value >= upper))
+        st_adjustment_stop_kinetic (adjustment);
+    }
+}
+
+static gboolean
+start_kinetic (StAdjustment *adjustment)
+{
+  StAdjustmentPrivate *priv = st_adjustment_get_instance_private (adjustment);
+
+  if (priv->actor == NULL)
+    return FALSE;
+
+  if (priv->kinetic_timeline == NULL)
+    {
+      /* The duration doesn't matter, the timeline only provides frame
+       * callbacks until we stop it */
+      priv->kinetic_timeline = clutter_timeline_new_for_actor (priv->actor, 1000);
+      clutter_timeline_set_repeat_count (priv->kinetic_timeline, -1);
+      g_signal_connect (priv->kinetic_timeline, "new-frame",
+                        G_CALLBACK (kinetic_new_frame), adjustment);
+    }
+
+  if (!clutter_timeline_is_playing (priv->kinetic_timeline))
+    clutter_timeline_start (priv->kinetic_timeline);
+
+  return TRUE;
+}
+
+/**
+ * st_adjustment_fling:
+ * @adjustment: A #StAdjustment
+ * @velocity: the initial velocity, in units per second
+ *
+ * Starts kinetic scrolling, like after lifting the fingers off a
+ * touchpad: the value keeps moving with @velocity, which decays until it
+ * comes to a stop or reaches the bounds of the adjustment.
+ *
+ * The value is updated on each frame of #StAdjustment:actor, without
+ * creating a #ClutterTransition. Without an actor, the value jumps to
+ * where the movement would have stopped.
+ */
+void
+st_adjustment_fling (StAdjustment *adjustment,
+                     gdouble       velocity)
+{
+  StAdjustmentPrivate *priv;
+
+  g_return_if_fail (ST_IS_ADJUSTMENT (adjustment));
+
+  priv = st_adjustment_get_instance_private (adjustment);
+
+  priv->kinetic_spring = FALSE;
+  priv->kinetic_velocity = velocity / 1000.0;
+
+  if (fabs (priv->kinetic_velocity) < KINETIC_MIN_VELOCITY)
+    {
+      st_adjustment_stop_kinetic (adjustment);
+      return;
+    }
+
+  if (!start_kinetic (adjustment))
+    {
+      st_adjustment_set_value (adjustment,
+                               priv->value +
+                               priv->kinetic_velocity * FLING_TIME_CONSTANT);
+      priv->kinetic_velocity = 0;
+    }
+}
+
+/**
+ * st_adjustment_spring_to:
+ * @adjustment: A #StAdjustment
+ * @value: the value to move to
+ *
+ * Smoothly moves the value to @value, following a critically damped
+ * spring. Calling this again before the value arrives retargets the
+ * movement and keeps its current velocity, so it can be called for
+ * every step of e.g. a scroll wheel.
+ *
+ * Like st_adjustment_fling(), the value is updated on each frame of
+ * #StAdjustment:actor, and set right away without an actor.
+ */
+void
+st_adjustment_spring_to (StAdjustment *adjustment,
+                         gdouble       value)
+{
+  StAdjustmentPrivate *priv;
+
+  g_return_if_fail (ST_IS_ADJUSTMENT (adjustment));
+
+  priv = st_adjustment_get_instance_private (adjustment);
+
+  value = CLAMP (value,
+                 priv->lower,
+                 MAX (priv->lower, priv->upper - priv->page_size));
+
+  /* Carry over the velocity of a fling or an earlier target */
+  if (!st_adjustment_is_kinetic (adjustment))
+    priv->kinetic_velocity = 0;
+
+  priv->kinetic_spring = TRUE;
+  priv->kinetic_target = value;
+
+  if (!start_kinetic (adjustment))
+    {
+      st_adjustment_stop_kinetic (adjustment);
+      st_adjustment_set_value (adjustment, value);
+    }
+}
+
+/**
+ * st_adjustment_stop_kinetic:
+ * @adjustment: A #StAdjustment
+ *
+ * Stops a movement started with st_adjustment_fling() or
+ * st_adjustment_spring_to(), leaving the value where it is.
+ */
+void
+st_adjustment_stop_kinetic (StAdjustment *adjustment)
+{
+  StAdjustmentPrivate *priv;
+
+  g_return_if_fail (ST_IS_ADJUSTMENT (adjustment));
+
+  priv = st_adjustment_get_instance_private (adjustment);
+
+  priv->kinetic_velocity = 0;
+
+  if (priv->kinetic_timeline)
+    clutter_timeline_stop (priv->kinetic_timeline);
+}
+
+/**
+ * st_adjustment_is_kinetic:
+ * @adjustment: A #StAdjustment
+ *
+ * Returns: %TRUE if the value is moving after st_adjustment_fling() or
+ *   st_adjustment_spring_to()
+ */
+gboolean
+st_adjustment_is_kinetic (StAdjustment *adjustment)
+{
+  StAdjustmentPrivate *priv;
+
+  g_return_val_if_fail (ST_IS_ADJUSTMENT (adjustment), FALSE);
+
+  priv = st_adjustment_get_instance_private (adjustment);
+
+  return priv->kinetic_timeline != NULL &&
+         clutter_timeline_is_playing (priv->kinetic_timeline);
+}
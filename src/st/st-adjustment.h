@@ -87,6 +87,13 @@ void                st_adjustment_add_transition    (StAdjustment      *adjustme
 void                st_adjustment_remove_transition (StAdjustment      *adjustment,
                                                      const char        *name);
 
+void                st_adjustment_fling             (StAdjustment      *adjustment,
+                                                     gdouble            velocity);
+void                st_adjustment_spring_to         (StAdjustment      *adjustment,
+                                                     gdouble            value);
+void                st_adjustment_stop_kinetic      (StAdjustment      *adjustment);
+gboolean            st_adjustment_is_kinetic        (StAdjustment      *adjustment);
+
 G_END_DECLS
 
 #endif /* __ST_ADJUSTMENT_H__ */
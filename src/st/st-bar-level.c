@@ -0,0 +1,698 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-bar-level.c: a level bar painted without rasterizing
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SECTION:st-bar-level
+ * @short_description: a horizontal bar showing a level
+ *
+ * #StBarLevel shows #StBarLevel:value as a rounded bar filling up to
+ * #StBarLevel:maximum-value, with values past #StBarLevel:overdrive-start
+ * in a different color. It is styled with the -barlevel-height,
+ * -barlevel-background-color, -barlevel-active-background-color,
+ * -barlevel-overdrive-color and -barlevel-overdrive-separator-width
+ * properties, and if -slider-handle-radius is set, a handle is drawn at
+ * the value in the foreground color.
+ *
+ * The bar is painted with color rectangles and a circle texture that is
+ * only rendered again when the style or scale changes, so changing or
+ * animating the value doesn't rasterize anything.
+ */
+
+#include <math.h>
+
+#include "st-bar-level.h"
+
+#include "st-private.h"
+
+typedef struct _StBarLevelPrivate StBarLevelPrivate;
+struct _StBarLevelPrivate
+{
+  double value;
+  double maximum_value;
+  double overdrive_start;
+
+  float bar_height;
+  float separator_width;
+  float handle_radius;
+
+  CoglColor bar_color;
+  CoglColor active_color;
+  CoglColor overdrive_color;
+  CoglColor foreground_color;
+
+  /* White circles, for the ends of the bar and for the handle */
+  CoglPipeline *bar_circle;
+  int bar_circle_size;
+  CoglPipeline *handle_circle;
+  int handle_circle_size;
+};
+
+G_DEFINE_TYPE_WITH_PRIVATE (StBarLevel, st_bar_level, ST_TYPE_WIDGET);
+
+enum {
+  PROP_0,
+
+  PROP_VALUE,
+  PROP_MAXIMUM_VALUE,
+  PROP_OVERDRIVE_START,
+
+  N_PROPS
+};
+
+static GParamSpec *props[N_PROPS] = { NULL, };
+
+typedef enum {
+  CIRCLE_FULL,
+  CIRCLE_LEFT,
+  CIRCLE_RIGHT,
+} CircleShape;
+
+typedef struct {
+  ClutterPaintNode *root;
+  float x;
+  float y;
+  float width;
+  gboolean rtl;
+  guint8 opacity;
+} PaintContext;
+
+static CoglPipeline *
+create_circle_pipeline (int size)
+{
+  CoglContext *ctx;
+  CoglPipeline *pipeline;
+  CoglTexture *texture;
+  cairo_surface_t *surface;
+  cairo_t *cr;
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, size, size);
+  cr = cairo_create (surface);
+  cairo_set_source_rgba (cr, 1.0, 1.0, 1.0, 1.0);
+  cairo_arc (cr, size / 2.0, size / 2.0, size / 2.0, 0, 2 * G_PI);
+  cairo_fill (cr);
+  cairo_destroy (cr);
+  cairo_surface_flush (surface);
+
+  texture = cogl_texture_2d_new_from_data (ctx, size, size,
+                                           COGL_PIXEL_FORMAT_CAIRO_ARGB32_COMPAT,
+                                           cairo_image_surface_get_stride (surface),
+                                           cairo_image_surface_get_data (surface),
+                                           NULL);
+  cairo_surface_destroy (surface);
+
+  if (texture == NULL)
+    return NULL;
+
+  pipeline = cogl_pipeline_new (ctx);
+  cogl_pipeline_set_layer_texture (pipeline, 0, texture);
+  g_object_unref (texture);
+
+  return pipeline;
+}
+
+static CoglPipeline *
+ensure_circle (CoglPipeline **pipeline,
+               int           *size,
+               float          radius,
+               float          scale)
+{
+  int new_size = ceilf (2 * radius * scale);
+
+  if (*pipeline != NULL && *size == new_size)
+    return *pipeline;
+
+  g_clear_object (pipeline);
+  *size = new_size;
+
+  if (new_size > 0)
+    *pipeline = create_circle_pipeline (new_size);
+
+  return *pipeline;
+}
+
+static void
+paint_rectangle (PaintContext    *ctx,
+                 const CoglColor *color,
+                 float            x1,
+                 float            y1,
+                 float            x2,
+                 float            y2)
+{
+  g_autoptr (ClutterPaintNode) node = NULL;
+  ClutterActorBox box;
+  CoglColor node_color = *color;
+
+  if (x2 <= x1 || y2 <= y1)
+    return;
+
+  if (ctx->rtl)
+    {
+      float tmp = x1;
+
+      x1 = ctx->width - x2;
+      x2 = ctx->width - tmp;
+    }
+
+  node_color.alpha = color->alpha * ctx->opacity / 255;
+  if (node_color.alpha == 0)
+    return;
+
+  box.x1 = ctx->x + x1;
+  box.y1 = ctx->y + y1;
+  box.x2 = ctx->x + x2;
+  box.y2 = ctx->y + y2;
+
+  node = clutter_color_node_new (&node_color);
+  clutter_paint_node_set_static_name (node, "StBarLevel (bar)");
+  clutter_paint_node_add_child (ctx->root, node);
+  clutter_paint_node_add_rectangle (node, &box);
+}
+
+static void
+paint_circle (PaintContext    *ctx,
+              CoglPipeline    *circle,
+              const CoglColor *color,
+              float            center_x,
+              float            center_y,
+              float            radius,
+              CircleShape      shape)
+{
+  g_autoptr (ClutterPaintNode) node = NULL;
+  g_autoptr (CoglPipeline) pipeline = NULL;
+  ClutterActorBox box;
+  CoglColor pipeline_color;
+  float alpha, tx1 = 0.0, tx2 = 1.0;
+
+  if (circle == NULL || radius <= 0)
+    return;
+
+  alpha = (color->alpha / 255.0) * (ctx->opacity / 255.0);
+  if (alpha == 0)
+    return;
+
+  if (ctx->rtl)
+    {
+      center_x = ctx->width - center_x;
+
+      if (shape == CIRCLE_LEFT)
+        shape = CIRCLE_RIGHT;
+      else if (shape == CIRCLE_RIGHT)
+        shape = CIRCLE_LEFT;
+    }
+
+  box.x1 = ctx->x + center_x - radius;
+  box.y1 = ctx->y + center_y - radius;
+  box.x2 = ctx->x + center_x + radius;
+  box.y2 = ctx->y + center_y + radius;
+
+  if (shape == CIRCLE_LEFT)
+    {
+      box.x2 = ctx->x + center_x;
+      tx2 = 0.5;
+    }
+  else if (shape == CIRCLE_RIGHT)
+    {
+      box.x1 = ctx->x + center_x;
+      tx1 = 0.5;
+    }
+
+  /* The circle is white, so the premultiplied color tints it */
+  cogl_color_init_from_4f (&pipeline_color,
+                           alpha * color->red / 255.0,
+                           alpha * color->green / 255.0,
+                           alpha * color->blue / 255.0,
+                           alpha);
+
+  pipeline = cogl_pipeline_copy (circle);
+  cogl_pipeline_set_color (pipeline, &pipeline_color);
+
+  node = clutter_pipeline_node_new (pipeline);
+  clutter_paint_node_set_static_name (node, "StBarLevel (rounded end)");
+  clutter_paint_node_add_child (ctx->root, node);
+  clutter_paint_node_add_texture_rectangle (node, &box, tx1, 0.0, tx2, 1.0);
+}
+
+static void
+st_bar_level_paint_node (ClutterActor     *actor,
+                         ClutterPaintNode *root)
+{
+  StBarLevel *bar = ST_BAR_LEVEL (actor);
+  StBarLevelPrivate *priv = st_bar_level_get_instance_private (bar);
+  StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (actor));
+  ClutterActorBox allocation, content_box;
+  const CoglColor *color;
+  CoglPipeline *bar_circle;
+  PaintContext ctx;
+  float width, height, scale;
+  float radius, top, bottom, middle;
+  float end_x, separator_x, separator_width, x;
+  gboolean overdrive_active;
+
+  clutter_actor_get_allocation_box (actor, &allocation);
+  st_theme_node_get_content_box (theme_node, &allocation, &content_box);
+
+  width = content_box.x2 - content_box.x1;
+  height = content_box.y2 - content_box.y1;
+  if (width <= 0 || height <= 0)
+    return;
+
+  ctx.root = root;
+  ctx.x = content_box.x1;
+  ctx.y = content_box.y1;
+  ctx.width = width;
+  ctx.rtl = clutter_actor_get_text_direction (actor) == CLUTTER_TEXT_DIRECTION_RTL;
+  ctx.opacity = clutter_actor_get_paint_opacity (actor);
+
+  scale = clutter_actor_get_resource_scale (actor);
+
+  radius = MIN (width, priv->bar_height) / 2;
+  top = (height - priv->bar_height) / 2;
+  bottom = (height + priv->bar_height) / 2;
+  middle = height / 2;
+
+  bar_circle = ensure_circle (&priv->bar_circle, &priv->bar_circle_size,
+                              radius, scale);
+
+  end_x = 0;
+  if (priv->maximum_value > 0)
+    end_x = radius + (width - 2 * radius) * priv->value / priv->maximum_value;
+
+  separator_x = radius +
+    (width - 2 * radius) * priv->overdrive_start / priv->maximum_value;
+
+  overdrive_active = priv->overdrive_start != priv->maximum_value;
+  separator_width = overdrive_active ? priv->separator_width : 0;
+
+  /* background bar */
+  paint_rectangle (&ctx, &priv->bar_color, end_x, top, width - radius, bottom);
+  paint_circle (&ctx, bar_circle, &priv->bar_color,
+                width - radius, middle, radius, CIRCLE_RIGHT);
+
+  /* normal progress bar */
+  color = priv->value > 0 ? &priv->active_color : &priv->bar_color;
+  x = MIN (end_x, separator_x - separator_width / 2);
+  paint_circle (&ctx, bar_circle, color, radius, middle, radius, CIRCLE_LEFT);
+  paint_rectangle (&ctx, color, radius, top, x, bottom);
+
+  /* overdrive progress bar */
+  x = MIN (end_x, separator_x) + separator_width / 2;
+  if (priv->value > priv->overdrive_start)
+    paint_rectangle (&ctx, &priv->overdrive_color, x, top, end_x, bottom);
+
+  /* end of the progress bar */
+  if (priv->value > 0)
+    {
+      color = priv->value <= priv->overdrive_start
+        ? &priv->active_color
+        : &priv->overdrive_color;
+      paint_circle (&ctx, bar_circle, color, end_x, middle, radius, CIRCLE_RIGHT);
+    }
+
+  /* overdrive separator */
+  if (overdrive_active)
+    {
+      color = priv->value <= priv->overdrive_start
+        ? &priv->foreground_color
+        : &priv->bar_color;
+      paint_rectangle (&ctx, color,
+                       separator_x - separator_width / 2, top,
+                       separator_x + separator_width / 2, bottom);
+    }
+
+  /* handle */
+  if (priv->handle_radius > 0 && priv->maximum_value > 0)
+    {
+      CoglPipeline *handle_circle;
+      float handle_inset = ceilf (priv->handle_radius);
+
+      handle_circle = ensure_circle (&priv->handle_circle,
+                                     &priv->handle_circle_size,
+                                     priv->handle_radius, scale);
+
+      x = handle_inset +
+        (width - 2 * handle_inset) * priv->value / priv->maximum_value;
+      paint_circle (&ctx, handle_circle, &priv->foreground_color,
+                    x, middle, priv->handle_radius, CIRCLE_FULL);
+    }
+}
+
+static void
+st_bar_level_get_preferred_width (ClutterActor *actor,
+                                  float         for_height,
+                                  float        *min_width_p,
+                                  float        *natural_width_p)
+{
+  StBarLevelPrivate *priv =
+    st_bar_level_get_instance_private (ST_BAR_LEVEL (actor));
+  StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (actor));
+  float width = MAX (priv->separator_width, 2 * priv->handle_radius);
+
+  if (min_width_p)
+    *min_width_p = width;
+  if (natural_width_p)
+    *natural_width_p = width;
+
+  st_theme_node_adjust_preferred_width (theme_node, min_width_p, natural_width_p);
+}
+
+static void
+st_bar_level_get_preferred_height (ClutterActor *actor,
+                                   float         for_width,
+                                   float        *min_height_p,
+                                   float        *natural_height_p)
+{
+  StBarLevelPrivate *priv =
+    st_bar_level_get_instance_private (ST_BAR_LEVEL (actor));
+  StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (actor));
+  float height = MAX (priv->bar_height, 2 * priv->handle_radius);
+
+  if (min_height_p)
+    *min_height_p = height;
+  if (natural_height_p)
+    *natural_height_p = height;
+
+  st_theme_node_adjust_preferred_height (theme_node, min_height_p, natural_height_p);
+}
+
+static void
+st_bar_level_style_changed (StWidget *widget)
+{
+  StBarLevelPrivate *priv =
+    st_bar_level_get_instance_private (ST_BAR_LEVEL (widget));
+  StThemeNode *theme_node = st_widget_get_theme_node (widget);
+
+  priv->bar_height = st_theme_node_get_length (theme_node, "-barlevel-height");
+  priv->separator_width =
+    st_theme_node_get_length (theme_node, "-barlevel-overdrive-separator-width");
+  priv->handle_radius =
+    st_theme_node_get_length (theme_node, "-slider-handle-radius");
+
+  st_theme_node_get_color (theme_node, "-barlevel-background-color",
+                           &priv->bar_color);
+  st_theme_node_get_color (theme_node, "-barlevel-active-background-color",
+                           &priv->active_color);
+  st_theme_node_get_color (theme_node, "-barlevel-overdrive-color",
+                           &priv->overdrive_color);
+  st_theme_node_get_foreground_color (theme_node, &priv->foreground_color);
+
+  clutter_actor_queue_relayout (CLUTTER_ACTOR (widget));
+
+  ST_WIDGET_CLASS (st_bar_level_parent_class)->style_changed (widget);
+}
+
+static void
+st_bar_level_set_property (GObject      *object,
+                           guint         prop_id,
+                           const GValue *value,
+                           GParamSpec   *pspec)
+{
+  StBarLevel *bar = ST_BAR_LEVEL (object);
+
+  switch (prop_id)
+    {
+    case PROP_VALUE:
+      st_bar_level_set_value (bar, g_value_get_double (value));
+      break;
+
+    case PROP_MAXIMUM_VALUE:
+      st_bar_level_set_maximum_value (bar, g_value_get_double (value));
+      break;
+
+    case PROP_OVERDRIVE_START:
+      st_bar_level_set_overdrive_start (bar, g_value_get_double (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+st_bar_level_get_property (GObject    *object,
+                           guint       prop_id,
+                           GValue     *value,
+                           GParamSpec *pspec)
+{
+  StBarLevelPrivate *priv =
+    st_bar_level_get_instance_private (ST_BAR_LEVEL (object));
+
+  switch (prop_id)
+    {
+    case PROP_VALUE:
+      g_value_set_double (value, priv->value);
+      break;
+
+    case PROP_MAXIMUM_VALUE:
+      g_value_set_double (value, priv->maximum_value);
+      break;
+
+    case PROP_OVERDRIVE_START:
+      g_value_set_double (value, priv->overdrive_start);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+st_bar_level_dispose (GObject *object)
+{
+  StBarLevelPrivate *priv =
+    st_bar_level_get_instance_private (ST_BAR_LEVEL (object));
+
+  g_clear_object (&priv->bar_circle);
+  g_clear_object (&priv->handle_circle);
+
+  G_OBJECT_CLASS (st_bar_level_parent_class)->dispose (object);
+}
+
+static void
+st_bar_level_class_init (StBarLevelClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  ClutterActorClass *actor_class = CLUTTER_ACTOR_CLASS (klass);
+  StWidgetClass *widget_class = ST_WIDGET_CLASS (klass);
+
+  object_class->set_property = st_bar_level_set_property;
+  object_class->get_property = st_bar_level_get_property;
+  object_class->dispose = st_bar_level_dispose;
+
+  actor_class->paint_node = st_bar_level_paint_node;
+  actor_class->get_preferred_width = st_bar_level_get_preferred_width;
+  actor_class->get_preferred_height = st_bar_level_get_preferred_height;
+
+  widget_class->style_changed = st_bar_level_style_changed;
+
+  /**
+   * StBarLevel:value:
+   *
+   * The level shown by the bar, between 0 and #StBarLevel:maximum-value.
+   * Like any double property, it can be eased.
+   */
+  props[PROP_VALUE] =
+    g_param_spec_double ("value", NULL, NULL,
+                         0.0, 2.0, 0.0,
+                         ST_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
+  /**
+   * StBarLevel:maximum-value:
+   *
+   * The level at which the bar is full.
+   */
+  props[PROP_MAXIMUM_VALUE] =
+    g_param_spec_double ("maximum-value", NULL, NULL,
+                         1.0, 2.0, 1.0,
+                         ST_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
+  /**
+   * StBarLevel:overdrive-start:
+   *
+   * The level past which the bar is shown in the overdrive color. It is
+   * the same as #StBarLevel:maximum-value when there is no overdrive.
+   */
+  props[PROP_OVERDRIVE_START] =
+    g_param_spec_double ("overdrive-start", NULL, NULL,
+                         1.0, 2.0, 1.0,
+                         ST_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
+  g_object_class_install_properties (object_class, N_PROPS, props);
+}
+
+static void
+st_bar_level_init (StBarLevel *bar)
+{
+  StBarLevelPrivate *priv = st_bar_level_get_instance_private (bar);
+
+  priv->maximum_value = 1.0;
+  priv->overdrive_start = 1.0;
+}
+
+/**
+ * st_bar_level_new:
+ *
+ * Creates a new #StBarLevel.
+ *
+ * Returns: a new #StBarLevel
+ */
+StWidget *
+st_bar_level_new (void)
+{
+  return g_object_new (ST_TYPE_BAR_LEVEL, NULL);
+}
+
+/**
+ * st_bar_level_set_value:
+ * @bar: a #StBarLevel
+ * @value: the new value
+ *
+ * Sets the level shown by @bar, clamped to its maximum value.
+ */
+void
+st_bar_level_set_value (StBarLevel *bar,
+                        double      value)
+{
+  StBarLevelPrivate *priv;
+
+  g_return_if_fail (ST_IS_BAR_LEVEL (bar));
+
+  priv = st_bar_level_get_instance_private (bar);
+
+  value = CLAMP (value, 0.0, priv->maximum_value);
+  if (priv->value == value)
+    return;
+
+  priv->value = value;
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (bar));
+  g_object_notify_by_pspec (G_OBJECT (bar), props[PROP_VALUE]);
+}
+
+/**
+ * st_bar_level_get_value:
+ * @bar: a #StBarLevel
+ *
+ * Returns: the level shown by @bar
+ */
+double
+st_bar_level_get_value (StBarLevel *bar)
+{
+  StBarLevelPrivate *priv;
+
+  g_return_val_if_fail (ST_IS_BAR_LEVEL (bar), 0.0);
+
+  priv = st_bar_level_get_instance_private (bar);
+  return priv->value;
+}
+
+/**
+ * st_bar_level_set_maximum_value:
+ * @bar: a #StBarLevel
+ * @maximum_value: the new maximum value, at least 1
+ *
+ * Sets the level at which @bar is full.
+ */
+void
+st_bar_level_set_maximum_value (StBarLevel *bar,
+                                double      maximum_value)
+{
+  StBarLevelPrivate *priv;
+
+  g_return_if_fail (ST_IS_BAR_LEVEL (bar));
+
+  priv = st_bar_level_get_instance_private (bar);
+
+  maximum_value = MAX (maximum_value, 1.0);
+  if (priv->maximum_value == maximum_value)
+    return;
+
+  priv->maximum_value = maximum_value;
+  priv->overdrive_start = MIN (priv->overdrive_start, priv->maximum_value);
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (bar));
+  g_object_notify_by_pspec (G_OBJECT (bar), props[PROP_MAXIMUM_VALUE]);
+}
+
+/**
+ * st_bar_level_get_maximum_value:
+ * @bar: a #StBarLevel
+ *
+ * Returns: the level at which @bar is full
+ */
+double
+st_bar_level_get_maximum_value (StBarLevel *bar)
+{
+  StBarLevelPrivate *priv;
+
+  g_return_val_if_fail (ST_IS_BAR_LEVEL (bar), 1.0);
+
+  priv = st_bar_level_get_instance_private (bar);
+  return priv->maximum_value;
+}
+
+/**
+ * st_bar_level_set_overdrive_start:
+ * @bar: a #StBarLevel
+ * @overdrive_start: the new start of the overdrive
+ *
+ * Sets the level past which @bar is shown in the overdrive color. It
+ * can't be greater than the maximum value.
+ */
+void
+st_bar_level_set_overdrive_start (StBarLevel *bar,
+                                  double      overdrive_start)
+{
+  StBarLevelPrivate *priv;
+
+  g_return_if_fail (ST_IS_BAR_LEVEL (bar));
+
+  priv = st_bar_level_get_instance_private (bar);
+
+  if (priv->overdrive_start == overdrive_start)
+    return;
+
+  if (overdrive_start > priv->maximum_value)
+    {
+      g_warning ("Tried to set overdrive value to %f, which is a number "
+                 "greater than the maximum allowed value %f",
+                 overdrive_start, priv->maximum_value);
+      return;
+    }
+
+  priv->overdrive_start = overdrive_start;
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (bar));
+  g_object_notify_by_pspec (G_OBJECT (bar), props[PROP_OVERDRIVE_START]);
+}
+
+/**
+ * st_bar_level_get_overdrive_start:
+ * @bar: a #StBarLevel
+ *
+ * Returns: the level past which @bar is shown in the overdrive color
+ */
+double
+st_bar_level_get_overdrive_start (StBarLevel *bar)
+{
+  StBarLevelPrivate *priv;
+
+  g_return_val_if_fail (ST_IS_BAR_LEVEL (bar), 1.0);
+
+  priv = st_bar_level_get_instance_private (bar);
+  return priv->overdrive_start;
+}
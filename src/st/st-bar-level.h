@@ -0,0 +1,50 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-bar-level.h: a level bar painted without rasterizing
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined(ST_H_INSIDE) && !defined(ST_COMPILATION)
+#error "Only <st/st.h> can be included directly.h"
+#endif
+
+#pragma once
+
+#include <st/st-widget.h>
+
+G_BEGIN_DECLS
+
+#define ST_TYPE_BAR_LEVEL (st_bar_level_get_type ())
+G_DECLARE_DERIVABLE_TYPE (StBarLevel, st_bar_level, ST, BAR_LEVEL, StWidget)
+
+struct _StBarLevelClass
+{
+  StWidgetClass parent_class;
+};
+
+StWidget *st_bar_level_new                 (void);
+
+void      st_bar_level_set_value           (StBarLevel *bar,
+                                            double      value);
+double    st_bar_level_get_value           (StBarLevel *bar);
+
+void      st_bar_level_set_maximum_value   (StBarLevel *bar,
+                                            double      maximum_value);
+double    st_bar_level_get_maximum_value   (StBarLevel *bar);
+
+void      st_bar_level_set_overdrive_start (StBarLevel *bar,
+                                            double      overdrive_start);
+double    st_bar_level_get_overdrive_start (StBarLevel *bar);
+
+G_END_DECLS
@@ -32,8 +32,26 @@
 
 #include <meta/display.h>
 #include <meta/meta-selection-source-memory.h>
+#include <meta/meta-selection-source.h>
 #include <meta/meta-selection.h>
 
+/* A selection source reading its content from a file whenever it is
+ * pasted, so that large content isn't kept in memory */
+#define ST_TYPE_CLIPBOARD_FILE_SOURCE (st_clipboard_file_source_get_type ())
+G_DECLARE_FINAL_TYPE (StClipboardFileSource, st_clipboard_file_source,
+                      ST, CLIPBOARD_FILE_SOURCE, MetaSelectionSource)
+
+struct _StClipboardFileSource
+{
+  MetaSelectionSource parent;
+
+  char *mimetype;
+  GFile *file;
+};
+
+G_DEFINE_TYPE (StClipboardFileSource, st_clipboard_file_source,
+               META_TYPE_SELECTION_SOURCE)
+
 G_DEFINE_TYPE (StClipboard, st_clipboard, G_TYPE_OBJECT)
 
 typedef struct _TransferData TransferData;
@@ -54,6 +72,95 @@ const char *supported_mimetypes[] = {
 
 static MetaSelection *meta_selection = NULL;
 
+static void
+file_read_cb (GFile        *file,
+              GAsyncResult *res,
+              GTask        *task)
+{
+  GFileInputStream *stream;
+  GError *error = NULL;
+
+  stream = g_file_read_finish (file, res, &error);
+  if (stream)
+    g_task_return_pointer (task, stream, g_object_unref);
+  else
+    g_task_return_error (task, error);
+
+  g_object_unref (task);
+}
+
+static void
+st_clipboard_file_source_read_async (MetaSelectionSource *source,
+                                     const char          *mimetype,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data)
+{
+  StClipboardFileSource *file_source = ST_CLIPBOARD_FILE_SOURCE (source);
+  GTask *task;
+
+  task = g_task_new (source, cancellable, callback, user_data);
+  g_task_set_source_tag (task, st_clipboard_file_source_read_async);
+
+  if (g_strcmp0 (mimetype, file_source->mimetype) != 0)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "Mimetype not in selection");
+      g_object_unref (task);
+      return;
+    }
+
+  g_file_read_async (file_source->file, G_PRIORITY_DEFAULT, cancellable,
+                     (GAsyncReadyCallback) file_read_cb, task);
+}
+
+static GInputStream *
+st_clipboard_file_source_read_finish (MetaSelectionSource  *source,
+                                      GAsyncResult         *result,
+                                      GError              **error)
+{
+  g_assert (g_task_get_source_tag (G_TASK (result)) ==
+            st_clipboard_file_source_read_async);
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+static GList *
+st_clipboard_file_source_get_mimetypes (MetaSelectionSource *source)
+{
+  StClipboardFileSource *file_source = ST_CLIPBOARD_FILE_SOURCE (source);
+
+  return g_list_prepend (NULL, g_strdup (file_source->mimetype));
+}
+
+static void
+st_clipboard_file_source_finalize (GObject *object)
+{
+  StClipboardFileSource *file_source = ST_CLIPBOARD_FILE_SOURCE (object);
+
+  g_free (file_source->mimetype);
+  g_object_unref (file_source->file);
+
+  G_OBJECT_CLASS (st_clipboard_file_source_parent_class)->finalize (object);
+}
+
+static void
+st_clipboard_file_source_class_init (StClipboardFileSourceClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  MetaSelectionSourceClass *source_class = META_SELECTION_SOURCE_CLASS (klass);
+
+  object_class->finalize = st_clipboard_file_source_finalize;
+
+  source_class->read_async = st_clipboard_file_source_read_async;
+  source_class->read_finish = st_clipboard_file_source_read_finish;
+  source_class->get_mimetypes = st_clipboard_file_source_get_mimetypes;
+}
+
+static void
+st_clipboard_file_source_init (StClipboardFileSource *file_source)
+{
+}
+
 static void
 st_clipboard_class_init (StClipboardClass *klass)
 {
@@ -160,9 +267,25 @@ transfer_bytes_cb (MetaSelection *selection,
   ((StClipboardContentCallbackFunc) data->callback) (data->clipboard, bytes,
                                                      data->user_data);
   g_object_unref (data->stream);
+  g_free (data);
   g_clear_pointer (&bytes, g_bytes_unref);
 }
 
+static void
+transfer_stream_cb (MetaSelection *selection,
+                    GAsyncResult  *res,
+                    GTask         *task)
+{
+  GError *error = NULL;
+
+  if (meta_selection_transfer_finish (selection, res, &error))
+    g_task_return_boolean (task, TRUE);
+  else
+    g_task_return_error (task, error);
+
+  g_object_unref (task);
+}
+
 /**
  * st_clipboard_get_mimetypes:
  * @clipboard: a #StClipboard
@@ -278,6 +401,78 @@ st_clipboard_get_content (StClipboard                    *clipboard,
                                  data);
 }
 
+/**
+ * st_clipboard_transfer_content_async:
+ * @clipboard: A #StCliboard
+ * @type: The type of clipboard data you want
+ * @mimetype: The mimetype to get content for
+ * @stream: the stream to write the content to
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: function to be called when the content is written
+ * @user_data: data to be passed to the callback
+ *
+ * Writes the content of the clipboard to @stream as it is received,
+ * such as to a file, instead of gathering it in memory like
+ * st_clipboard_get_content() does. @stream is not closed.
+ */
+void
+st_clipboard_transfer_content_async (StClipboard         *clipboard,
+                                     StClipboardType      type,
+                                     const char          *mimetype,
+                                     GOutputStream       *stream,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data)
+{
+  MetaSelectionType selection_type;
+  GTask *task;
+
+  g_return_if_fail (ST_IS_CLIPBOARD (clipboard));
+  g_return_if_fail (meta_selection != NULL);
+  g_return_if_fail (mimetype != NULL);
+  g_return_if_fail (G_IS_OUTPUT_STREAM (stream));
+
+  task = g_task_new (clipboard, cancellable, callback, user_data);
+  g_task_set_source_tag (task, st_clipboard_transfer_content_async);
+
+  if (!convert_type (type, &selection_type))
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                               "Invalid clipboard type");
+      g_object_unref (task);
+      return;
+    }
+
+  meta_selection_transfer_async (meta_selection,
+                                 selection_type,
+                                 mimetype, -1,
+                                 stream, cancellable,
+                                 (GAsyncReadyCallback) transfer_stream_cb,
+                                 task);
+}
+
+/**
+ * st_clipboard_transfer_content_finish:
+ * @clipboard: A #StCliboard
+ * @result: the #GAsyncResult
+ * @error: return location for a #GError
+ *
+ * Finishes a transfer started with st_clipboard_transfer_content_async().
+ *
+ * Returns: %TRUE if all of the content was written
+ */
+gboolean
+st_clipboard_transfer_content_finish (StClipboard   *clipboard,
+                                      GAsyncResult  *result,
+                                      GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, clipboard), FALSE);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                        st_clipboard_transfer_content_async, FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
 /**
  * st_clipboard_set_content:
  * @clipboard: A #StClipboard
@@ -320,6 +515,44 @@ st_clipboard_set_content (StClipboard     *clipboard,
   g_object_unref (source);
 }
 
+/**
+ * st_clipboard_set_content_from_file:
+ * @clipboard: A #StClipboard
+ * @type: The type of clipboard that you want to set
+ * @mimetype: content mimetype
+ * @file: the file holding the content
+ *
+ * Sets the clipboard content to that of @file. Unlike with
+ * st_clipboard_set_content(), the content isn't kept in memory, but
+ * read from @file again whenever it is pasted, so @file must stay
+ * around as long as it is on the clipboard.
+ **/
+void
+st_clipboard_set_content_from_file (StClipboard     *clipboard,
+                                    StClipboardType  type,
+                                    const char      *mimetype,
+                                    GFile           *file)
+{
+  MetaSelectionType selection_type;
+  StClipboardFileSource *source;
+
+  g_return_if_fail (ST_IS_CLIPBOARD (clipboard));
+  g_return_if_fail (meta_selection != NULL);
+  g_return_if_fail (mimetype != NULL);
+  g_return_if_fail (G_IS_FILE (file));
+
+  if (!convert_type (type, &selection_type))
+    return;
+
+  source = g_object_new (ST_TYPE_CLIPBOARD_FILE_SOURCE, NULL);
+  source->mimetype = g_strdup (mimetype);
+  source->file = g_object_ref (file);
+
+  meta_selection_set_owner (meta_selection, selection_type,
+                            META_SELECTION_SOURCE (source));
+  g_object_unref (source);
+}
+
 /**
  * st_clipboard_set_text:
  * @clipboard: A #StClipboard
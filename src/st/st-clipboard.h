@@ -24,7 +24,7 @@
 #ifndef _ST_CLIPBOARD_H
 #define _ST_CLIPBOARD_H
 
-#include <glib-object.h>
+#include <gio/gio.h>
 #include <meta/meta-selection.h>
 
 G_BEGIN_DECLS
@@ -98,6 +98,22 @@ void st_clipboard_get_content (StClipboard                    *clipboard,
                                StClipboardContentCallbackFunc  callback,
                                gpointer                        user_data);
 
+void st_clipboard_set_content_from_file (StClipboard     *clipboard,
+                                         StClipboardType  type,
+                                         const char      *mimetype,
+                                         GFile           *file);
+
+void     st_clipboard_transfer_content_async  (StClipboard          *clipboard,
+                                               StClipboardType       type,
+                                               const char           *mimetype,
+                                               GOutputStream        *stream,
+                                               GCancellable         *cancellable,
+                                               GAsyncReadyCallback   callback,
+                                               gpointer              user_data);
+gboolean st_clipboard_transfer_content_finish (StClipboard          *clipboard,
+                                               GAsyncResult         *result,
+                                               GError              **error);
+
 void st_clipboard_set_selection (MetaSelection *selection);
 
 G_END_DECLS
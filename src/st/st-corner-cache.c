@@ -0,0 +1,288 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-corner-cache.c: On-disk cache of rendered corner textures
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Rounded corners are rasterized with cairo the first time each
+ * combination of radius, border widths, colors and scale is used, which
+ * adds up to a few hundred masks when first showing the overview after
+ * login. When enabled by setting ST_CORNER_CACHE=1 in the environment,
+ * the rendered pixels are written to a single file in the user cache
+ * directory, keyed by the corner spec string, and the whole file is
+ * mapped in on the first lookup of the next session.
+ *
+ * The file is rewritten a few seconds after new corners were rendered.
+ * A version mismatch or corruption just discards its contents.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "st-corner-cache.h"
+
+#define CACHE_MAGIC "StCorner"
+#define CACHE_MAGIC_LEN 8
+#define CACHE_FORMAT_VERSION 1
+
+#define MAX_CORNERS 2048
+#define SAVE_TIMEOUT_S 5
+
+typedef struct {
+  guint size;
+  GBytes *pixels;
+} CornerEntry;
+
+static GHashTable *corners = NULL;
+static guint save_timeout_id = 0;
+
+gboolean
+_st_corner_cache_is_enabled (void)
+{
+  static int enabled = -1;
+
+  if (G_UNLIKELY (enabled < 0))
+    enabled = g_strcmp0 (g_getenv ("ST_CORNER_CACHE"), "1") == 0;
+
+  return enabled;
+}
+
+static guint32
+version_hash (void)
+{
+  return g_str_hash (PACKAGE_VERSION) ^ (guint32) sizeof (gpointer);
+}
+
+static char *
+get_cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           "gnome-shell", "corners.bin", NULL);
+}
+
+static void
+corner_entry_free (CornerEntry *entry)
+{
+  g_bytes_unref (entry->pixels);
+  g_free (entry);
+}
+
+static gsize
+corner_data_size (guint size)
+{
+  return (gsize) size * size * 4;
+}
+
+static void
+write_uint32 (GByteArray *buf,
+              guint32     value)
+{
+  g_byte_array_append (buf, (const guint8 *) &value, sizeof (value));
+}
+
+static gboolean
+save_corners (gpointer data)
+{
+  g_autoptr (GByteArray) buf = NULL;
+  g_autofree char *path = NULL;
+  g_autofree char *dir = NULL;
+  GHashTableIter iter;
+  const char *key;
+  CornerEntry *entry;
+
+  save_timeout_id = 0;
+
+  buf = g_byte_array_new ();
+  g_byte_array_append (buf, (const guint8 *) CACHE_MAGIC, CACHE_MAGIC_LEN);
+  write_uint32 (buf, CACHE_FORMAT_VERSION);
+  write_uint32 (buf, version_hash ());
+  write_uint32 (buf, g_hash_table_size (corners));
+
+  g_hash_table_iter_init (&iter, corners);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *) &entry))
+    {
+      write_uint32 (buf, strlen (key));
+      g_byte_array_append (buf, (const guint8 *) key, strlen (key));
+      write_uint32 (buf, entry->size);
+      g_byte_array_append (buf,
+                           g_bytes_get_data (entry->pixels, NULL),
+                           g_bytes_get_size (entry->pixels));
+    }
+
+  path = get_cache_path ();
+  dir = g_path_get_dirname (path);
+
+  if (g_mkdir_with_parents (dir, 0700) == 0)
+    g_file_set_contents (path, (const char *) buf->data, buf->len, NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+read_uint32 (GBytes  *bytes,
+             gsize   *offset,
+             guint32 *value)
+{
+  gsize length;
+  const guint8 *data = g_bytes_get_data (bytes, &length);
+
+  if (length - *offset < sizeof (guint32))
+    return FALSE;
+
+  memcpy (value, data + *offset, sizeof (guint32));
+  *offset += sizeof (guint32);
+
+  return TRUE;
+}
+
+/* Entries point into the mapped file, which stays mapped for as long
+ * as any of them are alive */
+static void
+load_corners (void)
+{
+  g_autoptr (GMappedFile) mapped_file = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+  g_autofree char *path = NULL;
+  const guint8 *data;
+  gsize length, offset;
+  guint32 version, hash, n_entries, i;
+
+  path = get_cache_path ();
+  mapped_file = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped_file == NULL)
+    return;
+
+  bytes = g_mapped_file_get_bytes (mapped_file);
+  data = g_bytes_get_data (bytes, &length);
+
+  if (length < CACHE_MAGIC_LEN ||
+      memcmp (data, CACHE_MAGIC, CACHE_MAGIC_LEN) != 0)
+    return;
+
+  offset = CACHE_MAGIC_LEN;
+  if (!read_uint32 (bytes, &offset, &version) ||
+      !read_uint32 (bytes, &offset, &hash) ||
+      !read_uint32 (bytes, &offset, &n_entries) ||
+      version != CACHE_FORMAT_VERSION ||
+      hash != version_hash () ||
+      n_entries > MAX_CORNERS)
+    return;
+
+  for (i = 0; i < n_entries; i++)
+    {
+      CornerEntry *entry;
+      guint32 key_len, size;
+      char *key;
+
+      if (!read_uint32 (bytes, &offset, &key_len) ||
+          length - offset < key_len)
+        break;
+
+      key = g_strndup ((const char *) data + offset, key_len);
+      offset += key_len;
+
+      if (!read_uint32 (bytes, &offset, &size) ||
+          size == 0 || size > G_MAXUINT16 ||
+          length - offset < corner_data_size (size))
+        {
+          g_free (key);
+          break;
+        }
+
+      entry = g_new0 (CornerEntry, 1);
+      entry->size = size;
+      entry->pixels = g_bytes_new_from_bytes (bytes, offset, corner_data_size (size));
+      offset += corner_data_size (size);
+
+      g_hash_table_replace (corners, key, entry);
+    }
+}
+
+static void
+ensure_corners (void)
+{
+  if (G_LIKELY (corners != NULL))
+    return;
+
+  corners = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                   g_free,
+                                   (GDestroyNotify) corner_entry_free);
+  load_corners ();
+}
+
+/**
+ * _st_corner_cache_lookup:
+ * @key: the string describing the corner
+ * @size: (out): return location for the width and height of the corner
+ *
+ * Looks up a corner rendered in this or a previous session.
+ *
+ * Returns: (transfer full) (nullable): the premultiplied ARGB32 pixels
+ *   of the corner, with a rowstride of 4 * @size
+ */
+GBytes *
+_st_corner_cache_lookup (const char *key,
+                         guint      *size)
+{
+  CornerEntry *entry;
+
+  ensure_corners ();
+
+  entry = g_hash_table_lookup (corners, key);
+  if (entry == NULL)
+    return NULL;
+
+  *size = entry->size;
+
+  return g_bytes_ref (entry->pixels);
+}
+
+/**
+ * _st_corner_cache_insert:
+ * @key: the string describing the corner
+ * @size: the width and height of the corner
+ * @data: the premultiplied ARGB32 pixels of the corner, with a rowstride
+ *   of 4 * @size
+ *
+ * Adds a freshly rendered corner to the cache, which is written to disk
+ * shortly after. Failures are silently ignored, the cache is purely an
+ * optimization.
+ */
+void
+_st_corner_cache_insert (const char   *key,
+                         guint         size,
+                         const guint8 *data)
+{
+  CornerEntry *entry;
+
+  ensure_corners ();
+
+  if (g_hash_table_size (corners) >= MAX_CORNERS ||
+      g_hash_table_contains (corners, key))
+    return;
+
+  entry = g_new0 (CornerEntry, 1);
+  entry->size = size;
+  entry->pixels = g_bytes_new (data, corner_data_size (size));
+
+  g_hash_table_insert (corners, g_strdup (key), entry);
+
+  if (save_timeout_id == 0)
+    {
+      save_timeout_id = g_timeout_add_seconds (SAVE_TIMEOUT_S, save_corners, NULL);
+      g_source_set_name_by_id (save_timeout_id, "[gnome-shell] save_corners");
+    }
+}
@@ -0,0 +1,36 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-corner-cache.h: On-disk cache of rendered corner textures
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __ST_CORNER_CACHE_H__
+#define __ST_CORNER_CACHE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gboolean _st_corner_cache_is_enabled (void);
+
+GBytes  *_st_corner_cache_lookup     (const char   *key,
+                                      guint        *size);
+void     _st_corner_cache_insert     (const char   *key,
+                                      guint         size,
+                                      const guint8 *data);
+
+G_END_DECLS
+
+#endif /* __ST_CORNER_CACHE_H__ */
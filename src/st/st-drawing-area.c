@@ -29,6 +29,10 @@
  * #StDrawingArea::repaint signal will be emitted by default when the area is
  * resized or the CSS style changes; you can use the
  * st_drawing_area_queue_repaint() as well.
+ *
+ * The painted contents are kept between repaints, so when only part of
+ * the area changes, st_drawing_area_queue_repaint_area() repaints and
+ * uploads just that part.
  */
 
 #include "st-drawing-area.h"
@@ -44,10 +48,15 @@ struct _StDrawingAreaPrivate {
   int height;
   float scale_factor;
 
+  /* The painted contents, and the scale they were painted at */
+  cairo_surface_t *surface;
+  float surface_scale;
+
+  /* The parts of the surface that changed since they were last
+   * uploaded to the texture, in device pixels */
+  cairo_region_t *damage;
   CoglTexture *texture;
-  CoglBitmap *buffer;
 
-  gboolean dirty;
   guint in_repaint : 1;
 };
 
@@ -89,15 +98,48 @@ st_drawing_area_paint_node (ClutterActor     *actor,
   StDrawingArea *area = ST_DRAWING_AREA (actor);
   StDrawingAreaPrivate *priv = st_drawing_area_get_instance_private (area);
   ClutterPaintNode *node;
+  int width, height, stride;
+  const uint8_t *data;
 
-  if (priv->buffer == NULL)
+  if (priv->surface == NULL)
     return;
 
-  if (priv->dirty)
-    g_clear_object (&priv->texture);
+  width = cairo_image_surface_get_width (priv->surface);
+  height = cairo_image_surface_get_height (priv->surface);
+  stride = cairo_image_surface_get_stride (priv->surface);
+  data = cairo_image_surface_get_data (priv->surface);
 
   if (priv->texture == NULL)
-    priv->texture = cogl_texture_2d_new_from_bitmap (priv->buffer);
+    {
+      CoglContext *ctx;
+
+      ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+      priv->texture = cogl_texture_2d_new_from_data (ctx, width, height,
+                                                     COGL_PIXEL_FORMAT_CAIRO_ARGB32_COMPAT,
+                                                     stride, data,
+                                                     NULL);
+    }
+  else
+    {
+      int i, n_rects = cairo_region_num_rectangles (priv->damage);
+
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_rectangle_int_t rect;
+
+          cairo_region_get_rectangle (priv->damage, i, &rect);
+          cogl_texture_set_region (priv->texture,
+                                   rect.x, rect.y,
+                                   rect.x, rect.y,
+                                   rect.width, rect.height,
+                                   width, height,
+                                   COGL_PIXEL_FORMAT_CAIRO_ARGB32_COMPAT,
+                                   stride, data);
+        }
+    }
+
+  g_clear_pointer (&priv->damage, cairo_region_destroy);
+  priv->damage = cairo_region_create ();
 
   if (priv->texture == NULL)
     return;
@@ -106,8 +148,6 @@ st_drawing_area_paint_node (ClutterActor     *actor,
   clutter_paint_node_set_static_name (node, "Canvas Content");
   clutter_paint_node_add_child (root, node);
   clutter_paint_node_unref (node);
-
-  priv->dirty = FALSE;
 }
 
 static void
@@ -143,7 +183,8 @@ st_drawing_area_finalize (GObject *self)
   StDrawingAreaPrivate *priv =
       st_drawing_area_get_instance_private (ST_DRAWING_AREA (self));
 
-  g_clear_object (&priv->buffer);
+  g_clear_pointer (&priv->surface, cairo_surface_destroy);
+  g_clear_pointer (&priv->damage, cairo_region_destroy);
   g_clear_object (&priv->texture);
 
   G_OBJECT_CLASS (st_drawing_area_parent_class)->finalize (self);
@@ -179,72 +220,83 @@ st_drawing_area_init (StDrawingArea *area)
   priv->width = -1;
   priv->height = -1;
   priv->scale_factor = 1.0f;
+  priv->damage = cairo_region_create ();
 }
 
 static void
-st_drawing_area_emit_repaint (StDrawingArea *area)
+st_drawing_area_emit_repaint (StDrawingArea               *area,
+                              const cairo_rectangle_int_t *clip)
 {
   StDrawingAreaPrivate *priv = st_drawing_area_get_instance_private (area);
+  cairo_rectangle_int_t rect;
   int real_width, real_height;
-  cairo_surface_t *surface;
-  gboolean mapped_buffer;
-  unsigned char *data;
-  CoglBuffer *buffer;
   cairo_t *cr;
 
   g_assert (priv->height > 0 && priv->width > 0);
 
-  priv->dirty = TRUE;
-
   real_width = ceilf (priv->width * priv->scale_factor);
   real_height = ceilf (priv->height * priv->scale_factor);
 
-  if (priv->buffer == NULL)
+  /* The surface is kept for as long as the size doesn't change, and only
+   * a new surface needs all of it painted and uploaded */
+  if (priv->surface != NULL &&
+      (cairo_image_surface_get_width (priv->surface) != real_width ||
+       cairo_image_surface_get_height (priv->surface) != real_height ||
+       priv->surface_scale != priv->scale_factor))
+    g_clear_pointer (&priv->surface, cairo_surface_destroy);
+
+  if (priv->surface == NULL)
     {
-      CoglContext *ctx;
+      priv->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                                  real_width,
+                                                  real_height);
+      cairo_surface_set_device_scale (priv->surface,
+                                      priv->scale_factor,
+                                      priv->scale_factor);
+      priv->surface_scale = priv->scale_factor;
+
+      g_clear_object (&priv->texture);
+      clip = NULL;
+    }
 
-      ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
-      priv->buffer = cogl_bitmap_new_with_size (ctx,
-                                                real_width,
-                                                real_height,
-                                                COGL_PIXEL_FORMAT_CAIRO_ARGB32_COMPAT);
+  if (cairo_surface_status (priv->surface) != CAIRO_STATUS_SUCCESS)
+    {
+      g_clear_pointer (&priv->surface, cairo_surface_destroy);
+      return;
     }
 
-  buffer = COGL_BUFFER (cogl_bitmap_get_buffer (priv->buffer));
-  if (buffer == NULL)
-    return;
+  /* Round the area out to whole device pixels */
+  rect.x = 0;
+  rect.y = 0;
+  rect.width = real_width;
+  rect.height = real_height;
 
-  cogl_buffer_set_update_hint (buffer, COGL_BUFFER_UPDATE_HINT_DYNAMIC);
+  if (clip != NULL)
+    {
+      int x1, y1, x2, y2;
 
-  data = cogl_buffer_map (buffer,
-                          COGL_BUFFER_ACCESS_READ_WRITE,
-                          COGL_BUFFER_MAP_HINT_DISCARD);
+      x1 = MAX (floorf (clip->x * priv->scale_factor), 0);
+      y1 = MAX (floorf (clip->y * priv->scale_factor), 0);
+      x2 = MIN (ceilf ((clip->x + clip->width) * priv->scale_factor), real_width);
+      y2 = MIN (ceilf ((clip->y + clip->height) * priv->scale_factor), real_height);
 
-  if (data != NULL)
-    {
-      int bitmap_stride = cogl_bitmap_get_rowstride (priv->buffer);
-
-      surface = cairo_image_surface_create_for_data (data,
-                                                     CAIRO_FORMAT_ARGB32,
-                                                     real_width,
-                                                     real_height,
-                                                     bitmap_stride);
-      mapped_buffer = TRUE;
-    }
-  else
-    {
-      surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-                                            real_width,
-                                            real_height);
+      if (x2 <= x1 || y2 <= y1)
+        return;
 
-      mapped_buffer = FALSE;
+      rect.x = x1;
+      rect.y = y1;
+      rect.width = x2 - x1;
+      rect.height = y2 - y1;
     }
 
-  cairo_surface_set_device_scale (surface,
-                                  priv->scale_factor,
-                                  priv->scale_factor);
+  priv->context = cr = cairo_create (priv->surface);
 
-  priv->context = cr = cairo_create (surface);
+  cairo_rectangle (cr,
+                   rect.x / priv->scale_factor,
+                   rect.y / priv->scale_factor,
+                   rect.width / priv->scale_factor,
+                   rect.height / priv->scale_factor);
+  cairo_clip (cr);
 
   priv->in_repaint = TRUE;
 
@@ -259,19 +311,10 @@ st_drawing_area_emit_repaint (StDrawingArea *area)
   priv->in_repaint = FALSE;
 
   cairo_destroy (cr);
+  cairo_surface_flush (priv->surface);
 
-  if (mapped_buffer)
-    cogl_buffer_unmap (buffer);
-  else
-    {
-      int size = cairo_image_surface_get_stride (surface) * priv->height;
-      cogl_buffer_set_data (buffer,
-                            0,
-                            cairo_image_surface_get_data (surface),
-                            size);
-    }
-
-  cairo_surface_destroy (surface);
+  cairo_region_union_rectangle (priv->damage, &rect);
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (area));
 }
 
 /**
@@ -293,13 +336,53 @@ st_drawing_area_queue_repaint (StDrawingArea *area)
 
   priv = st_drawing_area_get_instance_private (area);
 
-  g_clear_object (&priv->buffer);
+  if (priv->width <= 0 || priv->height <= 0)
+    {
+      g_clear_pointer (&priv->surface, cairo_surface_destroy);
+      return;
+    }
+
+  st_drawing_area_emit_repaint (area, NULL);
+}
+
+/**
+ * st_drawing_area_queue_repaint_area:
+ * @area: the #StDrawingArea
+ * @x: the X coordinate of the area to repaint
+ * @y: the Y coordinate of the area to repaint
+ * @width: the width of the area to repaint
+ * @height: the height of the area to repaint
+ *
+ * Like st_drawing_area_queue_repaint(), but only the given part of the
+ * area is repainted; the #StDrawingArea::repaint signal is emitted with
+ * the context clipped to it, and the rest keeps what was last painted
+ * there. The coordinates are relative to the content area, in the same
+ * units as st_drawing_area_get_surface_size().
+ */
+void
+st_drawing_area_queue_repaint_area (StDrawingArea *area,
+                                    int            x,
+                                    int            y,
+                                    int            width,
+                                    int            height)
+{
+  StDrawingAreaPrivate *priv;
+  cairo_rectangle_int_t clip = { x, y, width, height };
+
+  g_return_if_fail (ST_IS_DRAWING_AREA (area));
+
+  priv = st_drawing_area_get_instance_private (area);
 
   if (priv->width <= 0 || priv->height <= 0)
+    {
+      g_clear_pointer (&priv->surface, cairo_surface_destroy);
+      return;
+    }
+
+  if (width <= 0 || height <= 0)
     return;
 
-  clutter_actor_queue_redraw (CLUTTER_ACTOR (area));
-  st_drawing_area_emit_repaint (area);
+  st_drawing_area_emit_repaint (area, &clip);
 }
 
 /**
@@ -35,10 +35,15 @@ struct _StDrawingAreaClass
     void (*repaint) (StDrawingArea *area);
 };
 
-void     st_drawing_area_queue_repaint    (StDrawingArea *area);
-cairo_t *st_drawing_area_get_context      (StDrawingArea *area);
-void     st_drawing_area_get_surface_size (StDrawingArea *area,
-                                           guint         *width,
-                                           guint         *height);
+void     st_drawing_area_queue_repaint      (StDrawingArea *area);
+void     st_drawing_area_queue_repaint_area (StDrawingArea *area,
+                                             int            x,
+                                             int            y,
+                                             int            width,
+                                             int            height);
+cairo_t *st_drawing_area_get_context        (StDrawingArea *area);
+void     st_drawing_area_get_surface_size   (StDrawingArea *area,
+                                             guint         *width,
+                                             guint         *height);
 
 #endif /* __ST_DRAWING_AREA_H__ */
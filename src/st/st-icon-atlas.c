@@ -0,0 +1,264 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-icon-atlas.c: Shared textures for small icons
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Every icon normally gets a texture of its own, so a page of the app
+ * grid binds dozens of textures per frame. When enabled by setting
+ * ST_ICON_ATLAS=1 in the environment, icons up to ATLAS_MAX_ICON_SIZE
+ * pixels are instead packed into shared textures, one grid of equally
+ * sized cells per icon size. Icons painted from the same atlas use the
+ * same pipeline, which lets Cogl merge their rectangles into a single
+ * draw call.
+ *
+ * Cells have a transparent gutter so that filtering doesn't pick up
+ * neighbouring icons. A cell is released when its image is finalized,
+ * and an atlas goes away with its last icon.
+ */
+
+#include "config.h"
+
+#include "st-icon-atlas.h"
+#include "st-image-content-private.h"
+
+#define ATLAS_SIZE 1024
+#define ATLAS_MAX_ICON_SIZE 128
+#define ATLAS_GUTTER 1
+
+typedef struct {
+  CoglTexture *texture;
+  int cell_size;
+  int cells_per_row;
+  guint n_cells;
+  guint n_used;
+  gboolean *used;
+} IconAtlas;
+
+typedef struct {
+  IconAtlas *atlas;
+  guint index;
+} AtlasCell;
+
+static GPtrArray *atlases = NULL;
+
+gboolean
+_st_icon_atlas_is_enabled (void)
+{
+  static int enabled = -1;
+
+  if (G_UNLIKELY (enabled < 0))
+    enabled = g_strcmp0 (g_getenv ("ST_ICON_ATLAS"), "1") == 0;
+
+  return enabled;
+}
+
+static void
+icon_atlas_free (IconAtlas *atlas)
+{
+  g_clear_object (&atlas->texture);
+  g_free (atlas->used);
+  g_free (atlas);
+}
+
+static IconAtlas *
+icon_atlas_new (int cell_size)
+{
+  g_autofree guint8 *pixels = NULL;
+  g_autoptr (GError) error = NULL;
+  IconAtlas *atlas;
+  CoglContext *ctx;
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+  /* Start out transparent, the gutters are never written to */
+  pixels = g_malloc0 (ATLAS_SIZE * ATLAS_SIZE * 4);
+
+  atlas = g_new0 (IconAtlas, 1);
+  atlas->texture = cogl_texture_2d_new_from_data (ctx,
+                                                  ATLAS_SIZE, ATLAS_SIZE,
+                                                  COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                                                  ATLAS_SIZE * 4,
+                                                  pixels,
+                                                  &error);
+  if (atlas->texture == NULL)
+    {
+      g_warning ("Failed to allocate icon atlas: %s", error->message);
+      g_free (atlas);
+      return NULL;
+    }
+
+  atlas->cell_size = cell_size;
+  atlas->cells_per_row = ATLAS_SIZE / cell_size;
+  atlas->n_cells = atlas->cells_per_row * atlas->cells_per_row;
+  atlas->used = g_new0 (gboolean, atlas->n_cells);
+
+  return atlas;
+}
+
+static void
+get_cell_origin (IconAtlas *atlas,
+                 guint      index,
+                 int       *x,
+                 int       *y)
+{
+  *x = (index % atlas->cells_per_row) * atlas->cell_size;
+  *y = (index / atlas->cells_per_row) * atlas->cell_size;
+}
+
+static void
+release_cell (gpointer  data,
+              GObject  *where_the_image_was)
+{
+  AtlasCell *cell = data;
+  IconAtlas *atlas = cell->atlas;
+
+  atlas->used[cell->index] = FALSE;
+  atlas->n_used--;
+
+  if (atlas->n_used == 0)
+    {
+      g_ptr_array_remove_fast (atlases, atlas);
+    }
+  else
+    {
+      g_autofree guint8 *pixels = NULL;
+      int x, y;
+
+      /* The next icon may not cover all of the cell, so don't leave
+       * anything behind that it could bleed into */
+      pixels = g_malloc0 (atlas->cell_size * atlas->cell_size * 4);
+      get_cell_origin (atlas, cell->index, &x, &y);
+      cogl_texture_set_region (atlas->texture,
+                               0, 0,
+                               x, y,
+                               atlas->cell_size, atlas->cell_size,
+                               atlas->cell_size, atlas->cell_size,
+                               COGL_PIXEL_FORMAT_RGBA_8888_PRE,
+                               atlas->cell_size * 4,
+                               pixels);
+    }
+
+  g_free (cell);
+}
+
+static AtlasCell *
+allocate_cell (int cell_size)
+{
+  IconAtlas *atlas = NULL;
+  AtlasCell *cell;
+  guint i;
+
+  if (G_UNLIKELY (atlases == NULL))
+    atlases = g_ptr_array_new_with_free_func ((GDestroyNotify) icon_atlas_free);
+
+  for (i = 0; i < atlases->len; i++)
+    {
+      IconAtlas *candidate = g_ptr_array_index (atlases, i);
+
+      if (candidate->cell_size == cell_size &&
+          candidate->n_used < candidate->n_cells)
+        {
+          atlas = candidate;
+          break;
+        }
+    }
+
+  if (atlas == NULL)
+    {
+      atlas = icon_atlas_new (cell_size);
+      if (atlas == NULL)
+        return NULL;
+
+      g_ptr_array_add (atlases, atlas);
+    }
+
+  cell = g_new0 (AtlasCell, 1);
+  cell->atlas = atlas;
+
+  for (i = 0; i < atlas->n_cells; i++)
+    {
+      if (!atlas->used[i])
+        break;
+    }
+
+  g_assert (i < atlas->n_cells);
+
+  cell->index = i;
+  atlas->used[i] = TRUE;
+  atlas->n_used++;
+
+  return cell;
+}
+
+/**
+ * _st_icon_atlas_create_image:
+ * @pixbuf: the decoded icon
+ * @preferred_width: the width to paint the icon at
+ * @preferred_height: the height to paint the icon at
+ *
+ * Copies @pixbuf into a free cell of an atlas.
+ *
+ * Returns: (transfer full) (nullable): an #StImageContent painting the
+ *   icon from the atlas, or %NULL if the icon should get a texture of
+ *   its own
+ */
+ClutterContent *
+_st_icon_atlas_create_image (GdkPixbuf *pixbuf,
+                             int        preferred_width,
+                             int        preferred_height)
+{
+  ClutterContent *image;
+  AtlasCell *cell;
+  int width, height, x, y;
+
+  width = gdk_pixbuf_get_width (pixbuf);
+  height = gdk_pixbuf_get_height (pixbuf);
+
+  if (width > ATLAS_MAX_ICON_SIZE || height > ATLAS_MAX_ICON_SIZE ||
+      gdk_pixbuf_get_bits_per_sample (pixbuf) != 8)
+    return NULL;
+
+  cell = allocate_cell (MAX (width, height) + 2 * ATLAS_GUTTER);
+  if (cell == NULL)
+    return NULL;
+
+  get_cell_origin (cell->atlas, cell->index, &x, &y);
+  x += ATLAS_GUTTER;
+  y += ATLAS_GUTTER;
+
+  if (!cogl_texture_set_region (cell->atlas->texture,
+                                0, 0,
+                                x, y,
+                                width, height,
+                                width, height,
+                                gdk_pixbuf_get_has_alpha (pixbuf) ?
+                                  COGL_PIXEL_FORMAT_RGBA_8888 : COGL_PIXEL_FORMAT_RGB_888,
+                                gdk_pixbuf_get_rowstride (pixbuf),
+                                gdk_pixbuf_read_pixels (pixbuf)))
+    {
+      release_cell (cell, NULL);
+      return NULL;
+    }
+
+  image = st_image_content_new_with_preferred_size (preferred_width,
+                                                    preferred_height);
+  st_image_content_set_atlas_region (ST_IMAGE_CONTENT (image),
+                                     cell->atlas->texture,
+                                     x, y, width, height);
+  g_object_weak_ref (G_OBJECT (image), release_cell, cell);
+
+  return image;
+}
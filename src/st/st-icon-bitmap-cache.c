@@ -0,0 +1,372 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-icon-bitmap-cache.c: On-disk cache of decoded icons
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Every icon of the app grid is decoded from PNG or SVG again on the
+ * first time it is shown in a session. When enabled by setting
+ * ST_ICON_BITMAP_CACHE=1 in the environment, decoded icons are written
+ * to a single file in the user cache directory, and the whole file is
+ * mapped in on the first lookup of the next session, so that icons can
+ * be uploaded straight from the mapping.
+ *
+ * Keys include the path, modification time and size of the icon file
+ * on top of the texture cache key, so changed icons miss the cache.
+ * The file is rewritten a few seconds after new icons were decoded.
+ * A version mismatch or corruption just discards its contents.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "st-icon-bitmap-cache.h"
+
+#define CACHE_MAGIC "StIconBm"
+#define CACHE_MAGIC_LEN 8
+#define CACHE_FORMAT_VERSION 1
+
+#define MAX_CACHE_BYTES (64 * 1024 * 1024)
+#define MAX_ICON_SIZE 2048
+#define SAVE_TIMEOUT_S 5
+
+typedef struct {
+  guint width;
+  guint height;
+  guint rowstride;
+  gboolean has_alpha;
+  GBytes *pixels;
+} IconEntry;
+
+static GHashTable *icons = NULL;
+static gsize total_bytes = 0;
+static guint save_timeout_id = 0;
+
+gboolean
+_st_icon_bitmap_cache_is_enabled (void)
+{
+  static int enabled = -1;
+
+  if (G_UNLIKELY (enabled < 0))
+    enabled = g_strcmp0 (g_getenv ("ST_ICON_BITMAP_CACHE"), "1") == 0;
+
+  return enabled;
+}
+
+static guint32
+version_hash (void)
+{
+  return g_str_hash (PACKAGE_VERSION) ^ (guint32) sizeof (gpointer);
+}
+
+static char *
+get_cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           "gnome-shell", "icons.bin", NULL);
+}
+
+static void
+icon_entry_free (IconEntry *entry)
+{
+  g_bytes_unref (entry->pixels);
+  g_free (entry);
+}
+
+/* Same as gdk_pixbuf_get_byte_length(), the last row isn't padded */
+static gsize
+icon_data_size (guint    width,
+                guint    height,
+                guint    rowstride,
+                gboolean has_alpha)
+{
+  return (gsize) rowstride * (height - 1) + width * (has_alpha ? 4 : 3);
+}
+
+static void
+write_uint32 (GByteArray *buf,
+              guint32     value)
+{
+  g_byte_array_append (buf, (const guint8 *) &value, sizeof (value));
+}
+
+static gboolean
+save_icons (gpointer data)
+{
+  g_autoptr (GByteArray) buf = NULL;
+  g_autofree char *path = NULL;
+  g_autofree char *dir = NULL;
+  GHashTableIter iter;
+  const char *key;
+  IconEntry *entry;
+
+  save_timeout_id = 0;
+
+  buf = g_byte_array_sized_new (total_bytes);
+  g_byte_array_append (buf, (const guint8 *) CACHE_MAGIC, CACHE_MAGIC_LEN);
+  write_uint32 (buf, CACHE_FORMAT_VERSION);
+  write_uint32 (buf, version_hash ());
+  write_uint32 (buf, g_hash_table_size (icons));
+
+  g_hash_table_iter_init (&iter, icons);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *) &entry))
+    {
+      write_uint32 (buf, strlen (key));
+      g_byte_array_append (buf, (const guint8 *) key, strlen (key));
+      write_uint32 (buf, entry->width);
+      write_uint32 (buf, entry->height);
+      write_uint32 (buf, entry->rowstride);
+      write_uint32 (buf, entry->has_alpha);
+      g_byte_array_append (buf,
+                           g_bytes_get_data (entry->pixels, NULL),
+                           g_bytes_get_size (entry->pixels));
+    }
+
+  path = get_cache_path ();
+  dir = g_path_get_dirname (path);
+
+  if (g_mkdir_with_parents (dir, 0700) == 0)
+    g_file_set_contents (path, (const char *) buf->data, buf->len, NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+read_uint32 (GBytes  *bytes,
+             gsize   *offset,
+             guint32 *value)
+{
+  gsize length;
+  const guint8 *data = g_bytes_get_data (bytes, &length);
+
+  if (length - *offset < sizeof (guint32))
+    return FALSE;
+
+  memcpy (value, data + *offset, sizeof (guint32));
+  *offset += sizeof (guint32);
+
+  return TRUE;
+}
+
+/* Entries point into the mapped file, which stays mapped for as long
+ * as any of them, or any pixbuf created from them, are alive */
+static void
+load_icons (void)
+{
+  g_autoptr (GMappedFile) mapped_file = NULL;
+  g_autoptr (GBytes) bytes = NULL;
+  g_autofree char *path = NULL;
+  const guint8 *data;
+  gsize length, offset;
+  guint32 version, hash, n_entries, i;
+
+  path = get_cache_path ();
+  mapped_file = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped_file == NULL)
+    return;
+
+  bytes = g_mapped_file_get_bytes (mapped_file);
+  data = g_bytes_get_data (bytes, &length);
+
+  if (length < CACHE_MAGIC_LEN ||
+      memcmp (data, CACHE_MAGIC, CACHE_MAGIC_LEN) != 0)
+    return;
+
+  offset = CACHE_MAGIC_LEN;
+  if (!read_uint32 (bytes, &offset, &version) ||
+      !read_uint32 (bytes, &offset, &hash) ||
+      !read_uint32 (bytes, &offset, &n_entries) ||
+      version != CACHE_FORMAT_VERSION ||
+      hash != version_hash ())
+    return;
+
+  for (i = 0; i < n_entries; i++)
+    {
+      IconEntry *entry;
+      guint32 key_len, width, height, rowstride, has_alpha;
+      gsize data_size;
+      char *key;
+
+      if (!read_uint32 (bytes, &offset, &key_len) ||
+          length - offset < key_len)
+        break;
+
+      key = g_strndup ((const char *) data + offset, key_len);
+      offset += key_len;
+
+      if (!read_uint32 (bytes, &offset, &width) ||
+          !read_uint32 (bytes, &offset, &height) ||
+          !read_uint32 (bytes, &offset, &rowstride) ||
+          !read_uint32 (bytes, &offset, &has_alpha) ||
+          width == 0 || width > MAX_ICON_SIZE ||
+          height == 0 || height > MAX_ICON_SIZE ||
+          has_alpha > 1 ||
+          rowstride < width * (has_alpha ? 4 : 3) ||
+          rowstride > MAX_ICON_SIZE * 4)
+        {
+          g_free (key);
+          break;
+        }
+
+      data_size = icon_data_size (width, height, rowstride, has_alpha);
+      if (length - offset < data_size ||
+          total_bytes + data_size > MAX_CACHE_BYTES)
+        {
+          g_free (key);
+          break;
+        }
+
+      entry = g_new0 (IconEntry, 1);
+      entry->width = width;
+      entry->height = height;
+      entry->rowstride = rowstride;
+      entry->has_alpha = has_alpha;
+      entry->pixels = g_bytes_new_from_bytes (bytes, offset, data_size);
+      offset += data_size;
+
+      total_bytes += data_size;
+      g_hash_table_replace (icons, key, entry);
+    }
+}
+
+static void
+ensure_icons (void)
+{
+  if (G_LIKELY (icons != NULL))
+    return;
+
+  icons = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                 g_free,
+                                 (GDestroyNotify) icon_entry_free);
+  load_icons ();
+}
+
+/**
+ * _st_icon_bitmap_cache_get_key:
+ * @filename: (nullable): the file the icon is loaded from
+ * @request_key: the texture cache key of the icon, describing its size,
+ *   scale, style and colors
+ *
+ * Returns: (transfer full) (nullable): the key to use for the icon, or
+ *   %NULL if it can't be cached
+ */
+char *
+_st_icon_bitmap_cache_get_key (const char *filename,
+                               const char *request_key)
+{
+  GStatBuf stat_buf;
+
+  if (filename == NULL || g_stat (filename, &stat_buf) != 0)
+    return NULL;
+
+  return g_strdup_printf ("%s:%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT ":%s",
+                          filename,
+                          (gint64) stat_buf.st_mtime,
+                          (gint64) stat_buf.st_size,
+                          request_key);
+}
+
+/**
+ * _st_icon_bitmap_cache_lookup:
+ * @key: a key from _st_icon_bitmap_cache_get_key()
+ *
+ * Looks up an icon decoded in this or a previous session.
+ *
+ * Returns: (transfer full) (nullable): a pixbuf sharing the cached pixels
+ */
+GdkPixbuf *
+_st_icon_bitmap_cache_lookup (const char *key)
+{
+  IconEntry *entry;
+
+  ensure_icons ();
+
+  entry = g_hash_table_lookup (icons, key);
+  if (entry == NULL)
+    return NULL;
+
+  return gdk_pixbuf_new_from_bytes (entry->pixels,
+                                    GDK_COLORSPACE_RGB,
+                                    entry->has_alpha,
+                                    8,
+                                    entry->width,
+                                    entry->height,
+                                    entry->rowstride);
+}
+
+/**
+ * _st_icon_bitmap_cache_insert:
+ * @key: a key from _st_icon_bitmap_cache_get_key()
+ * @pixbuf: the decoded icon
+ *
+ * Adds a freshly decoded icon to the cache, which is written to disk
+ * shortly after. Failures are silently ignored, the cache is purely an
+ * optimization.
+ */
+void
+_st_icon_bitmap_cache_insert (const char *key,
+                              GdkPixbuf  *pixbuf)
+{
+  IconEntry *entry;
+  gsize data_size;
+
+  ensure_icons ();
+
+  if (gdk_pixbuf_get_colorspace (pixbuf) != GDK_COLORSPACE_RGB ||
+      gdk_pixbuf_get_bits_per_sample (pixbuf) != 8 ||
+      gdk_pixbuf_get_width (pixbuf) > MAX_ICON_SIZE ||
+      gdk_pixbuf_get_height (pixbuf) > MAX_ICON_SIZE)
+    return;
+
+  data_size = gdk_pixbuf_get_byte_length (pixbuf);
+
+  if (total_bytes + data_size > MAX_CACHE_BYTES ||
+      g_hash_table_contains (icons, key))
+    return;
+
+  entry = g_new0 (IconEntry, 1);
+  entry->width = gdk_pixbuf_get_width (pixbuf);
+  entry->height = gdk_pixbuf_get_height (pixbuf);
+  entry->rowstride = gdk_pixbuf_get_rowstride (pixbuf);
+  entry->has_alpha = gdk_pixbuf_get_has_alpha (pixbuf);
+  entry->pixels = g_bytes_new (gdk_pixbuf_read_pixels (pixbuf), data_size);
+
+  total_bytes += data_size;
+  g_hash_table_insert (icons, g_strdup (key), entry);
+
+  if (save_timeout_id == 0)
+    {
+      save_timeout_id = g_timeout_add_seconds (SAVE_TIMEOUT_S, save_icons, NULL);
+      g_source_set_name_by_id (save_timeout_id, "[gnome-shell] save_icons");
+    }
+}
+
+/**
+ * _st_icon_bitmap_cache_flush:
+ *
+ * Writes icons that are waiting to be saved right away, rather than
+ * after the usual delay.
+ */
+void
+_st_icon_bitmap_cache_flush (void)
+{
+  if (save_timeout_id == 0)
+    return;
+
+  g_clear_handle_id (&save_timeout_id, g_source_remove);
+  save_icons (NULL);
+}
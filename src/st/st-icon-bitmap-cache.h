@@ -0,0 +1,38 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-icon-bitmap-cache.h: On-disk cache of decoded icons
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __ST_ICON_BITMAP_CACHE_H__
+#define __ST_ICON_BITMAP_CACHE_H__
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+G_BEGIN_DECLS
+
+gboolean   _st_icon_bitmap_cache_is_enabled (void);
+
+char      *_st_icon_bitmap_cache_get_key    (const char *filename,
+                                             const char *request_key);
+
+GdkPixbuf *_st_icon_bitmap_cache_lookup     (const char *key);
+void       _st_icon_bitmap_cache_insert     (const char *key,
+                                             GdkPixbuf  *pixbuf);
+void       _st_icon_bitmap_cache_flush      (void);
+
+G_END_DECLS
+
+#endif /* __ST_ICON_BITMAP_CACHE_H__ */
@@ -335,6 +335,40 @@ st_icon_cache_add_icons (StIconCache *cache,
     }
 }
 
+void
+st_icon_cache_foreach_icon (StIconCache            *cache,
+                            StIconCacheForeachFunc  func,
+                            gpointer                user_data)
+{
+  guint32 hash_offset, n_buckets;
+  guint32 chain_offset;
+  guint32 image_list_offset, n_images;
+  int i, j;
+
+  hash_offset = GET_UINT32 (cache->buffer, 4);
+  n_buckets = GET_UINT32 (cache->buffer, hash_offset);
+
+  for (i = 0; i < n_buckets; i++)
+    {
+      chain_offset = GET_UINT32 (cache->buffer, hash_offset + 4 + 4 * i);
+      while (chain_offset != 0xffffffff)
+        {
+          guint32 name_offset = GET_UINT32 (cache->buffer, chain_offset + 4);
+          char *name = cache->buffer + name_offset;
+
+          image_list_offset = GET_UINT32 (cache->buffer, chain_offset + 8);
+          n_images = GET_UINT32 (cache->buffer, image_list_offset);
+
+          for (j = 0; j < n_images; j++)
+            func (name,
+                  GET_UINT16 (cache->buffer, image_list_offset + 4 + 8 * j),
+                  user_data);
+
+          chain_offset = GET_UINT32 (cache->buffer, chain_offset);
+        }
+    }
+}
+
 gboolean
 st_icon_cache_has_icon (StIconCache *cache,
                         const char  *icon_name)
@@ -36,6 +36,14 @@ void st_icon_cache_add_icons (StIconCache *cache,
                               const char  *directory,
                               GHashTable  *hash_table);
 
+typedef void (* StIconCacheForeachFunc) (const char *icon_name,
+                                         int         directory_index,
+                                         gpointer    user_data);
+
+void st_icon_cache_foreach_icon (StIconCache            *cache,
+                                 StIconCacheForeachFunc  func,
+                                 gpointer                user_data);
+
 int st_icon_cache_get_icon_flags (StIconCache *cache,
                                   const char  *icon_name,
                                   int          directory_index);
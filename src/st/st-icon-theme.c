@@ -75,7 +75,8 @@ typedef enum
   ICON_SUFFIX_SYMBOLIC_PNG = 1 << 4
 } IconSuffix;
 
-#define INFO_CACHE_LRU_SIZE 32
+#define INFO_CACHE_LRU_DEFAULT_SIZE 32
+#define INFO_CACHE_LRU_MAX_SIZE 1024
 #if 0
 #define DEBUG_CACHE(args) g_print args
 #else
@@ -87,7 +88,10 @@ struct _StIconTheme
   GObject parent_instance;
 
   GHashTable *info_cache;
-  GList *info_cache_lru;
+  GQueue info_cache_lru;
+  guint info_cache_lru_size;
+  guint info_cache_hits;
+  guint info_cache_misses;
 
   char *current_theme;
   char **search_path;
@@ -104,6 +108,19 @@ struct _StIconTheme
   GList *themes;
   GHashTable *unthemed_icons;
 
+  /* Merged view of the icon indexes of all themes and the icon caches,
+   * built on the first lookup like those of the themes
+   */
+  GHashTable *composite_index; /* icon name -> GPtrArray of IconTheme */
+
+  /* The directories are watched with file monitors, which bump
+   * generation when they change. Directories that couldn't be
+   * monitored are stat:ed for changes every few seconds instead.
+   */
+  int generation;
+  int valid_generation;
+  gboolean needs_polling;
+
   /* time when we last stat:ed for theme changes */
   int64_t last_stat_time;
   GList *dir_mtimes;
@@ -135,6 +152,7 @@ struct _StIconInfo
    */
   IconInfoKey key;
   StIconTheme *in_cache;
+  GList lru_link;
 
   char *filename;
   GFile *icon_file;
@@ -161,6 +179,7 @@ struct _StIconInfo
   guint emblems_applied : 1;
   guint is_svg          : 1;
   guint is_resource     : 1;
+  guint in_lru          : 1;
 
   /* Cached information if we go ahead and try to load
    * the icon.
@@ -173,6 +192,11 @@ struct _StIconInfo
 
   SymbolicPixbufCache *symbolic_pixbuf_cache;
 
+  /* A symbolic SVG rendered once with the colors of the
+   * .symbolic.png format, which any colors can be applied to
+   */
+  GdkPixbuf *symbolic_base;
+
   int symbolic_width;
   int symbolic_height;
 };
@@ -186,6 +210,9 @@ typedef struct
 
   /* In search order */
   GList *dirs;
+
+  /* Built on the first lookup, as themes are reloaded on changes */
+  GHashTable *icon_index; /* icon name -> GPtrArray of IconThemeDir */
 } IconTheme;
 
 typedef struct
@@ -207,6 +234,8 @@ typedef struct
   StIconCache *cache;
 
   GHashTable *icons;
+
+  int position; /* in the dirs of the theme */
 } IconThemeDir;
 
 typedef struct
@@ -222,6 +251,7 @@ typedef struct
   time_t mtime;
   StIconCache *cache;
   gboolean exists;
+  GFileMonitor *monitor;
 } IconThemeDirMtime;
 
 static void st_icon_theme_finalize (GObject *object);
@@ -235,8 +265,6 @@ static StIconInfo * theme_lookup_icon (IconTheme  *theme,
 static void theme_list_icons (IconTheme  *theme,
                               GHashTable *icons,
                               GQuark      context);
-static gboolean theme_has_icon (IconTheme  *theme,
-                                const char *icon_name);
 static void theme_list_contexts (IconTheme  *theme,
                                  GHashTable *contexts);
 static void theme_subdir_load (StIconTheme *icon_theme,
@@ -259,6 +287,8 @@ static IconSuffix suffix_from_name (const char *name);
 static void remove_from_lru_cache (StIconTheme *icon_theme,
                                    StIconInfo  *icon_info);
 static gboolean icon_info_ensure_scale_and_pixbuf (StIconInfo *icon_info);
+static GPtrArray *lookup_composite_index (StIconTheme *icon_theme,
+                                          const char  *icon_name);
 
 enum
 {
@@ -423,6 +453,22 @@ pixbuf_supports_svg (void)
   return found_svg;
 }
 
+/* The LRU size can be overridden with ST_ICON_INFO_CACHE_SIZE, which
+ * helps sessions with many apps or extensions showing lots of icons */
+static guint
+get_default_lru_size (void)
+{
+  const char *env = g_getenv ("ST_ICON_INFO_CACHE_SIZE");
+  guint64 size;
+
+  if (env == NULL || !g_ascii_string_to_unsigned (env, 10,
+                                                  0, INFO_CACHE_LRU_MAX_SIZE,
+                                                  &size, NULL))
+    return INFO_CACHE_LRU_DEFAULT_SIZE;
+
+  return size;
+}
+
 /* The icon info was removed from the icon_info_hash hash table */
 static void
 icon_info_uncached (StIconInfo *icon_info)
@@ -451,6 +497,8 @@ st_icon_theme_init (StIconTheme *icon_theme)
 
   icon_theme->info_cache = g_hash_table_new_full (icon_info_key_hash, icon_info_key_equal, NULL,
                                                   (GDestroyNotify)icon_info_uncached);
+  g_queue_init (&icon_theme->info_cache_lru);
+  icon_theme->info_cache_lru_size = get_default_lru_size ();
 
   xdg_data_dirs = g_get_system_data_dirs ();
   for (i = 0; xdg_data_dirs[i]; i++) ;
@@ -483,9 +531,61 @@ st_icon_theme_init (StIconTheme *icon_theme)
   update_current_theme (icon_theme);
 }
 
+static void
+on_dir_changed (GFileMonitor      *monitor,
+                GFile             *file,
+                GFile             *other_file,
+                GFileMonitorEvent  event_type,
+                StIconTheme       *icon_theme)
+{
+  /* Only changes of the directory entries affect the mtime of the
+   * directory, which is what the themes used to be validated by */
+  switch (event_type)
+    {
+    case G_FILE_MONITOR_EVENT_CREATED:
+    case G_FILE_MONITOR_EVENT_DELETED:
+    case G_FILE_MONITOR_EVENT_MOVED_IN:
+    case G_FILE_MONITOR_EVENT_MOVED_OUT:
+    case G_FILE_MONITOR_EVENT_RENAMED:
+      g_atomic_int_inc (&icon_theme->generation);
+      break;
+
+    default:
+      break;
+    }
+}
+
+static void
+monitor_dir_mtime (StIconTheme       *icon_theme,
+                   IconThemeDirMtime *dir_mtime)
+{
+  g_autoptr (GFile) file = NULL;
+
+  file = g_file_new_for_path (dir_mtime->dir);
+  dir_mtime->monitor = g_file_monitor_directory (file,
+                                                 G_FILE_MONITOR_WATCH_MOVES,
+                                                 NULL, NULL);
+  if (dir_mtime->monitor == NULL)
+    {
+      icon_theme->needs_polling = TRUE;
+      return;
+    }
+
+  g_signal_connect (dir_mtime->monitor, "changed",
+                    G_CALLBACK (on_dir_changed), icon_theme);
+}
+
 static void
 free_dir_mtime (IconThemeDirMtime *dir_mtime)
 {
+  if (dir_mtime->monitor)
+    {
+      g_signal_handlers_disconnect_by_func (dir_mtime->monitor,
+                                            on_dir_changed, NULL);
+      g_file_monitor_cancel (dir_mtime->monitor);
+      g_object_unref (dir_mtime->monitor);
+    }
+
   if (dir_mtime->cache)
     st_icon_cache_unref (dir_mtime->cache);
 
@@ -540,9 +640,11 @@ blow_themes (StIconTheme *icon_theme)
       g_list_free_full (icon_theme->dir_mtimes, (GDestroyNotify) free_dir_mtime);
       g_hash_table_destroy (icon_theme->unthemed_icons);
     }
+  g_clear_pointer (&icon_theme->composite_index, g_hash_table_unref);
   icon_theme->themes = NULL;
   icon_theme->unthemed_icons = NULL;
   icon_theme->dir_mtimes = NULL;
+  icon_theme->needs_polling = FALSE;
   icon_theme->themes_valid = FALSE;
 }
 
@@ -555,7 +657,7 @@ st_icon_theme_finalize (GObject *object)
   icon_theme = ST_ICON_THEME (object);
 
   g_hash_table_destroy (icon_theme->info_cache);
-  g_assert (icon_theme->info_cache_lru == NULL);
+  g_assert (g_queue_is_empty (&icon_theme->info_cache_lru));
 
   g_clear_handle_id (&icon_theme->theme_changed_idle, g_source_remove);
 
@@ -799,6 +901,7 @@ insert_theme (StIconTheme *icon_theme,
         dir_mtime->mtime = 0;
         dir_mtime->exists = FALSE;
       }
+      monitor_dir_mtime (icon_theme, dir_mtime);
 
       icon_theme->dir_mtimes = g_list_prepend (icon_theme->dir_mtimes, dir_mtime);
     }
@@ -999,6 +1102,9 @@ load_themes (StIconTheme *icon_theme)
   GStatBuf stat_buf;
   GList *d;
 
+  /* Changes from here on invalidate what is loaded below */
+  icon_theme->valid_generation = g_atomic_int_get (&icon_theme->generation);
+
   if (icon_theme->current_theme)
     insert_theme (icon_theme, icon_theme->current_theme);
 
@@ -1027,6 +1133,7 @@ load_themes (StIconTheme *icon_theme)
       dir_mtime->mtime = 0;
       dir_mtime->exists = FALSE;
       dir_mtime->cache = NULL;
+      monitor_dir_mtime (icon_theme, dir_mtime);
 
       if (g_stat (dir, &stat_buf) != 0 || !S_ISDIR (stat_buf.st_mode))
         continue;
@@ -1078,16 +1185,10 @@ ensure_valid_themes (StIconTheme *icon_theme)
     return;
   icon_theme->loading_themes = TRUE;
 
-  if (icon_theme->themes_valid)
+  if (icon_theme->themes_valid && rescan_themes (icon_theme))
     {
-      int64_t time = g_get_monotonic_time ();
-
-      if (ABS (time - icon_theme->last_stat_time) > 5 * G_TIME_SPAN_SECOND &&
-          rescan_themes (icon_theme))
-        {
-          g_hash_table_remove_all (icon_theme->info_cache);
-          blow_themes (icon_theme);
-        }
+      g_hash_table_remove_all (icon_theme->info_cache);
+      blow_themes (icon_theme);
     }
 
   if (!icon_theme->themes_valid)
@@ -1109,27 +1210,35 @@ ensure_valid_themes (StIconTheme *icon_theme)
  * references the info. So, when we get a cache hit
  * we remove it from the list, and when the proxy
  * pixmap is released we put it on the list.
+ *
+ * The list is linked through the infos themselves, so
+ * that touching or dropping an entry doesn't need to
+ * walk it.
  */
 static void
-ensure_lru_cache_space (StIconTheme *icon_theme)
+evict_lru_cache_tail (StIconTheme *icon_theme)
 {
-  GList *l;
+  GList *l = g_queue_peek_tail_link (&icon_theme->info_cache_lru);
+  StIconInfo *icon_info = l->data;
 
-  /* Remove last item if LRU full */
-  l = g_list_nth (icon_theme->info_cache_lru, INFO_CACHE_LRU_SIZE - 1);
-  if (l)
-    {
-      StIconInfo *icon_info = l->data;
+  DEBUG_CACHE (("removing (due to out of space) %p (%s %d 0x%x) from LRU cache (cache size %d)\n",
+                icon_info,
+                g_strjoinv (",", icon_info->key.icon_names),
+                icon_info->key.size, icon_info->key.flags,
+                icon_theme->info_cache_lru.length));
 
-      DEBUG_CACHE (("removing (due to out of space) %p (%s %d 0x%x) from LRU cache (cache size %d)\n",
-                    icon_info,
-                    g_strjoinv (",", icon_info->key.icon_names),
-                    icon_info->key.size, icon_info->key.flags,
-                    g_list_length (icon_theme->info_cache_lru)));
+  g_queue_unlink (&icon_theme->info_cache_lru, l);
+  icon_info->in_lru = FALSE;
+  g_object_unref (icon_info);
+}
 
-      icon_theme->info_cache_lru = g_list_delete_link (icon_theme->info_cache_lru, l);
-      g_object_unref (icon_info);
-    }
+static void
+ensure_lru_cache_space (StIconTheme *icon_theme)
+{
+  /* Remove last items if LRU full */
+  while (icon_theme->info_cache_lru.length > 0 &&
+         icon_theme->info_cache_lru.length >= icon_theme->info_cache_lru_size)
+    evict_lru_cache_tail (icon_theme);
 }
 
 static void
@@ -1140,28 +1249,29 @@ add_to_lru_cache (StIconTheme *icon_theme,
                 icon_info,
                 g_strjoinv (",", icon_info->key.icon_names),
                 icon_info->key.size, icon_info->key.flags,
-                g_list_length (icon_theme->info_cache_lru)));
+                icon_theme->info_cache_lru.length));
 
-  g_assert (g_list_find (icon_theme->info_cache_lru, icon_info) == NULL);
+  g_assert (!icon_info->in_lru);
+
+  if (icon_theme->info_cache_lru_size == 0)
+    return;
 
   ensure_lru_cache_space (icon_theme);
   /* prepend new info to LRU */
-  icon_theme->info_cache_lru = g_list_prepend (icon_theme->info_cache_lru,
-                                         g_object_ref (icon_info));
+  icon_info->lru_link.data = g_object_ref (icon_info);
+  icon_info->in_lru = TRUE;
+  g_queue_push_head_link (&icon_theme->info_cache_lru, &icon_info->lru_link);
 }
 
 static void
 ensure_in_lru_cache (StIconTheme *icon_theme,
                      StIconInfo  *icon_info)
 {
-  GList *l;
-
-  l = g_list_find (icon_theme->info_cache_lru, icon_info);
-  if (l)
+  if (icon_info->in_lru)
     {
       /* Move to front of LRU if already in it */
-      icon_theme->info_cache_lru = g_list_remove_link (icon_theme->info_cache_lru, l);
-      icon_theme->info_cache_lru = g_list_concat (l, icon_theme->info_cache_lru);
+      g_queue_unlink (&icon_theme->info_cache_lru, &icon_info->lru_link);
+      g_queue_push_head_link (&icon_theme->info_cache_lru, &icon_info->lru_link);
     }
   else
     add_to_lru_cache (icon_theme, icon_info);
@@ -1171,15 +1281,16 @@ static void
 remove_from_lru_cache (StIconTheme *icon_theme,
                        StIconInfo  *icon_info)
 {
-  if (g_list_find (icon_theme->info_cache_lru, icon_info))
+  if (icon_info->in_lru)
     {
       DEBUG_CACHE (("removing %p (%s %d 0x%x) from LRU cache (cache size %d)\n",
                     icon_info,
                     g_strjoinv (",", icon_info->key.icon_names),
                     icon_info->key.size, icon_info->key.flags,
-                    g_list_length (icon_theme->info_cache_lru)));
+                    icon_theme->info_cache_lru.length));
 
-      icon_theme->info_cache_lru = g_list_remove (icon_theme->info_cache_lru, icon_info);
+      g_queue_unlink (&icon_theme->info_cache_lru, &icon_info->lru_link);
+      icon_info->in_lru = FALSE;
       g_object_unref (icon_info);
     }
 }
@@ -1254,7 +1365,6 @@ real_choose_icon (StIconTheme       *icon_theme,
                   int                scale,
                   StIconLookupFlags  flags)
 {
-  GList *l;
   StIconInfo *icon_info = NULL;
   StIconInfo *unscaled_icon_info;
   UnthemedIcon *unthemed_icon = NULL;
@@ -1280,12 +1390,16 @@ real_choose_icon (StIconTheme       *icon_theme,
                     icon_info->key.size, icon_info->key.flags,
                     g_hash_table_size (icon_theme->info_cache)));
 
+      icon_theme->info_cache_hits++;
+
       icon_info = g_object_ref (icon_info);
       remove_from_lru_cache (icon_theme, icon_info);
 
       return icon_info;
     }
 
+  icon_theme->info_cache_misses++;
+
   if (flags & ST_ICON_LOOKUP_NO_SVG)
     allow_svg = FALSE;
   else if (flags & ST_ICON_LOOKUP_FORCE_SVG)
@@ -1295,11 +1409,19 @@ real_choose_icon (StIconTheme       *icon_theme,
 
   for (i = 0; icon_names[i]; i++)
     {
+      GPtrArray *themes;
+      guint j;
+
       icon_name = icon_names[i];
 
-      for (l = icon_theme->themes; l; l = l->next)
+      /* Fallback names are usually missing from all themes */
+      themes = lookup_composite_index (icon_theme, icon_name);
+      if (themes == NULL)
+        continue;
+
+      for (j = 0; j < themes->len; j++)
         {
-          theme = l->data;
+          theme = g_ptr_array_index (themes, j);
 
           icon_info = theme_lookup_icon (theme, icon_name, size, scale, allow_svg);
           if (icon_info)
@@ -1888,29 +2010,12 @@ gboolean
 st_icon_theme_has_icon (StIconTheme *icon_theme,
                         const char  *icon_name)
 {
-  GList *l;
-
   g_return_val_if_fail (ST_IS_ICON_THEME (icon_theme), FALSE);
   g_return_val_if_fail (icon_name != NULL, FALSE);
 
   ensure_valid_themes (icon_theme);
 
-  for (l = icon_theme->dir_mtimes; l; l = l->next)
-    {
-      IconThemeDirMtime *dir_mtime = l->data;
-      StIconCache *cache = dir_mtime->cache;
-
-      if (cache && st_icon_cache_has_icon (cache, icon_name))
-        return TRUE;
-    }
-
-  for (l = icon_theme->themes; l; l = l->next)
-    {
-      if (theme_has_icon (l->data, icon_name))
-        return TRUE;
-    }
-
-  return FALSE;
+  return lookup_composite_index (icon_theme, icon_name) != NULL;
 }
 
 static void
@@ -2112,7 +2217,7 @@ st_icon_theme_list_contexts (StIconTheme *icon_theme)
 }
 
 static gboolean
-rescan_themes (StIconTheme *icon_theme)
+dir_mtimes_changed (StIconTheme *icon_theme)
 {
   IconThemeDirMtime *dir_mtime;
   GList *d;
@@ -2123,6 +2228,10 @@ rescan_themes (StIconTheme *icon_theme)
     {
       dir_mtime = d->data;
 
+      /* changes are reported by the monitor */
+      if (dir_mtime->monitor != NULL)
+        continue;
+
       stat_res = g_stat (dir_mtime->dir, &stat_buf);
 
       /* dir mtime didn't change */
@@ -2143,6 +2252,112 @@ rescan_themes (StIconTheme *icon_theme)
   return FALSE;
 }
 
+/* Doesn't touch the file system unless some directory couldn't be
+ * monitored, and then only every few seconds */
+static gboolean
+rescan_themes (StIconTheme *icon_theme)
+{
+  if (g_atomic_int_get (&icon_theme->generation) != icon_theme->valid_generation)
+    return TRUE;
+
+  if (icon_theme->needs_polling)
+    {
+      int64_t time = g_get_monotonic_time ();
+
+      if (ABS (time - icon_theme->last_stat_time) > 5 * G_TIME_SPAN_SECOND)
+        return dir_mtimes_changed (icon_theme);
+    }
+
+  return FALSE;
+}
+
+/**
+ * st_icon_theme_set_info_cache_size:
+ * @icon_theme: a #StIconTheme
+ * @size: the number of unused icon infos to keep around
+ *
+ * Sets how many icon infos are kept alive after their last user went
+ * away, so that looking them up again is cheap. Setting it to 0 turns
+ * the LRU cache off.
+ */
+void
+st_icon_theme_set_info_cache_size (StIconTheme *icon_theme,
+                                   guint        size)
+{
+  g_return_if_fail (ST_IS_ICON_THEME (icon_theme));
+
+  icon_theme->info_cache_lru_size = MIN (size, INFO_CACHE_LRU_MAX_SIZE);
+
+  while (icon_theme->info_cache_lru.length > icon_theme->info_cache_lru_size)
+    evict_lru_cache_tail (icon_theme);
+}
+
+/**
+ * st_icon_theme_get_info_cache_stats:
+ * @icon_theme: a #StIconTheme
+ * @hits: (out) (optional): return location for the number of lookups
+ *   answered from the cache
+ * @misses: (out) (optional): return location for the number of lookups
+ *   that had to search the themes
+ *
+ * Gets the lookup counters of the icon info cache, since @icon_theme was
+ * created.
+ */
+void
+st_icon_theme_get_info_cache_stats (StIconTheme *icon_theme,
+                                    guint       *hits,
+                                    guint       *misses)
+{
+  g_return_if_fail (ST_IS_ICON_THEME (icon_theme));
+
+  if (hits)
+    *hits = icon_theme->info_cache_hits;
+  if (misses)
+    *misses = icon_theme->info_cache_misses;
+}
+
+/**
+ * st_icon_theme_trim:
+ * @icon_theme: a #StIconTheme
+ * @level: how low the system is on memory
+ *
+ * Releases memory in response to a low memory warning. Lookups stay
+ * correct, they just have to redo some work. On
+ * %G_MEMORY_MONITOR_WARNING_LEVEL_LOW, the icon info LRU cache is
+ * halved; on higher levels, it is emptied. On
+ * %G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL, the icon name indexes of
+ * the themes are dropped as well, until the next lookup.
+ */
+void
+st_icon_theme_trim (StIconTheme                *icon_theme,
+                    GMemoryMonitorWarningLevel  level)
+{
+  guint keep;
+  GList *l;
+
+  g_return_if_fail (ST_IS_ICON_THEME (icon_theme));
+
+  if (level < G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM)
+    keep = icon_theme->info_cache_lru.length / 2;
+  else
+    keep = 0;
+
+  while (icon_theme->info_cache_lru.length > keep)
+    evict_lru_cache_tail (icon_theme);
+
+  if (level < G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL)
+    return;
+
+  g_clear_pointer (&icon_theme->composite_index, g_hash_table_unref);
+
+  for (l = icon_theme->themes; l; l = l->next)
+    {
+      IconTheme *theme = l->data;
+
+      g_clear_pointer (&theme->icon_index, g_hash_table_unref);
+    }
+}
+
 /**
  * st_icon_theme_rescan_if_needed:
  * @icon_theme: a #StIconTheme
@@ -2161,7 +2376,9 @@ st_icon_theme_rescan_if_needed (StIconTheme *icon_theme)
 
   g_return_val_if_fail (ST_IS_ICON_THEME (icon_theme), FALSE);
 
-  retval = rescan_themes (icon_theme);
+  /* Unlike lookups, don't wait for the next poll */
+  retval = rescan_themes (icon_theme) ||
+           (icon_theme->needs_polling && dir_mtimes_changed (icon_theme));
   if (retval)
       do_theme_change (icon_theme);
 
@@ -2177,6 +2394,7 @@ theme_destroy (IconTheme *theme)
   g_free (theme->example);
 
   g_list_free_full (theme->dirs, (GDestroyNotify) theme_dir_destroy);
+  g_clear_pointer (&theme->icon_index, g_hash_table_unref);
 
   g_free (theme);
 }
@@ -2394,6 +2612,220 @@ compare_dir_matches (IconThemeDir *dir_a, int difference_a,
   return diff_a <= diff_b;
 }
 
+typedef struct
+{
+  GHashTable *index;
+  GHashTable *cache_dirs; /* subdir index -> IconThemeDir */
+} IndexBuilder;
+
+static void
+add_index_candidate (GHashTable   *index,
+                     const char   *icon_name,
+                     IconThemeDir *dir)
+{
+  GPtrArray *candidates;
+
+  candidates = g_hash_table_lookup (index, icon_name);
+  if (candidates == NULL)
+    {
+      candidates = g_ptr_array_new ();
+      g_hash_table_insert (index, g_strdup (icon_name), candidates);
+    }
+
+  g_ptr_array_add (candidates, dir);
+}
+
+static void
+add_cached_icon_to_index (const char *icon_name,
+                          int         directory_index,
+                          gpointer    user_data)
+{
+  IndexBuilder *builder = user_data;
+  IconThemeDir *dir;
+
+  dir = g_hash_table_lookup (builder->cache_dirs,
+                             GINT_TO_POINTER (directory_index));
+  if (dir == NULL)
+    return;
+
+  /* The cache stores foo-symbolic.symbolic.png as foo-symbolic.symbolic,
+   * see theme_dir_get_icon_suffix() */
+  if (g_str_has_suffix (icon_name, ".symbolic"))
+    {
+      g_autofree char *base_name = NULL;
+
+      base_name = g_strndup (icon_name, strlen (icon_name) - strlen (".symbolic"));
+      add_index_candidate (builder->index, base_name, dir);
+    }
+  else
+    {
+      add_index_candidate (builder->index, icon_name, dir);
+    }
+}
+
+static int
+compare_dir_positions (gconstpointer a,
+                       gconstpointer b)
+{
+  const IconThemeDir *dir_a = *(IconThemeDir **) a;
+  const IconThemeDir *dir_b = *(IconThemeDir **) b;
+
+  return dir_a->position - dir_b->position;
+}
+
+/* Maps every icon name of the theme to the directories containing it,
+ * in search order, so that lookups don't have to go through all of the
+ * directories for every candidate name */
+static void
+theme_build_icon_index (IconTheme *theme)
+{
+  g_autoptr (GHashTable) caches = NULL;
+  IndexBuilder builder;
+  GHashTableIter iter;
+  gpointer key, value;
+  GList *l;
+  int position = 0;
+
+  builder.index = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free,
+                                         (GDestroyNotify) g_ptr_array_unref);
+
+  /* StIconCache -> (subdir index -> IconThemeDir) */
+  caches = g_hash_table_new_full (NULL, NULL,
+                                  NULL, (GDestroyNotify) g_hash_table_unref);
+
+  for (l = theme->dirs; l; l = l->next)
+    {
+      IconThemeDir *dir = l->data;
+
+      dir->position = position++;
+
+      if (dir->cache)
+        {
+          GHashTable *cache_dirs = g_hash_table_lookup (caches, dir->cache);
+
+          if (cache_dirs == NULL)
+            {
+              cache_dirs = g_hash_table_new (NULL, NULL);
+              g_hash_table_insert (caches, dir->cache, cache_dirs);
+            }
+
+          g_hash_table_insert (cache_dirs,
+                               GINT_TO_POINTER (dir->subdir_index), dir);
+        }
+      else
+        {
+          g_hash_table_iter_init (&iter, dir->icons);
+          while (g_hash_table_iter_next (&iter, &key, NULL))
+            add_index_candidate (builder.index, key, dir);
+        }
+    }
+
+  g_hash_table_iter_init (&iter, caches);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      builder.cache_dirs = value;
+      st_icon_cache_foreach_icon (key, add_cached_icon_to_index, &builder);
+    }
+
+  g_hash_table_iter_init (&iter, builder.index);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      GPtrArray *candidates = value;
+      guint i;
+
+      g_ptr_array_sort (candidates, compare_dir_positions);
+
+      /* foo-symbolic.png and foo-symbolic.symbolic.png may share a dir */
+      for (i = 1; i < candidates->len; )
+        {
+          if (g_ptr_array_index (candidates, i) ==
+              g_ptr_array_index (candidates, i - 1))
+            g_ptr_array_remove_index (candidates, i);
+          else
+            i++;
+        }
+    }
+
+  theme->icon_index = builder.index;
+}
+
+static void
+add_cached_icon_to_composite_index (const char *icon_name,
+                                    int         directory_index,
+                                    gpointer    user_data)
+{
+  GHashTable *composite_index = user_data;
+
+  /* Icons in directories that no theme lists don't have a theme to
+   * be looked up in, but st_icon_theme_has_icon() still knows them */
+  if (!g_hash_table_contains (composite_index, icon_name))
+    g_hash_table_insert (composite_index, g_strdup (icon_name),
+                         g_ptr_array_new ());
+}
+
+/* Maps every icon name known to any theme in the chain to the themes
+ * containing it, in search order, so that each candidate name of a
+ * lookup costs a single hash lookup however many themes are inherited */
+static void
+build_composite_index (StIconTheme *icon_theme)
+{
+  GHashTable *composite_index;
+  GHashTableIter iter;
+  gpointer key;
+  GList *l;
+
+  composite_index = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free,
+                                           (GDestroyNotify) g_ptr_array_unref);
+
+  for (l = icon_theme->themes; l; l = l->next)
+    {
+      IconTheme *theme = l->data;
+
+      if (G_UNLIKELY (theme->icon_index == NULL))
+        theme_build_icon_index (theme);
+
+      g_hash_table_iter_init (&iter, theme->icon_index);
+      while (g_hash_table_iter_next (&iter, &key, NULL))
+        {
+          GPtrArray *themes = g_hash_table_lookup (composite_index, key);
+
+          if (themes == NULL)
+            {
+              themes = g_ptr_array_new ();
+              g_hash_table_insert (composite_index, g_strdup (key), themes);
+            }
+
+          g_ptr_array_add (themes, theme);
+        }
+    }
+
+  for (l = icon_theme->dir_mtimes; l; l = l->next)
+    {
+      IconThemeDirMtime *dir_mtime = l->data;
+
+      if (dir_mtime->cache)
+        st_icon_cache_foreach_icon (dir_mtime->cache,
+                                    add_cached_icon_to_composite_index,
+                                    composite_index);
+    }
+
+  icon_theme->composite_index = composite_index;
+}
+
+/* Returns the themes containing @icon_name, or %NULL if no theme
+ * or icon cache has it */
+static GPtrArray *
+lookup_composite_index (StIconTheme *icon_theme,
+                        const char  *icon_name)
+{
+  if (G_UNLIKELY (icon_theme->composite_index == NULL))
+    build_composite_index (icon_theme);
+
+  return g_hash_table_lookup (icon_theme->composite_index, icon_name);
+}
+
 static StIconInfo *
 theme_lookup_icon (IconTheme  *theme,
                    const char *icon_name,
@@ -2401,21 +2833,26 @@ theme_lookup_icon (IconTheme  *theme,
                    int         scale,
                    gboolean    allow_svg)
 {
-  GList *dirs, *l;
+  GPtrArray *candidates;
   IconThemeDir *dir, *min_dir;
   char *file;
   int min_difference, difference;
   IconSuffix suffix;
+  guint i;
 
   min_difference = G_MAXINT;
   min_dir = NULL;
 
-  dirs = theme->dirs;
+  if (G_UNLIKELY (theme->icon_index == NULL))
+    theme_build_icon_index (theme);
 
-  l = dirs;
-  while (l != NULL)
+  candidates = g_hash_table_lookup (theme->icon_index, icon_name);
+  if (candidates == NULL)
+    return NULL;
+
+  for (i = 0; i < candidates->len; i++)
     {
-      dir = l->data;
+      dir = g_ptr_array_index (candidates, i);
 
       g_debug ("look up icon dir %s", dir->dir);
       suffix = theme_dir_get_icon_suffix (dir, icon_name, NULL);
@@ -2431,8 +2868,6 @@ theme_lookup_icon (IconTheme  *theme,
               min_difference = difference;
             }
         }
-
-      l = l->next;
     }
 
   if (min_dir)
@@ -2508,31 +2943,6 @@ theme_list_icons (IconTheme  *theme,
     }
 }
 
-static gboolean
-theme_has_icon (IconTheme  *theme,
-                const char *icon_name)
-{
-  GList *l;
-
-  for (l = theme->dirs; l; l = l->next)
-    {
-      IconThemeDir *dir = l->data;
-
-      if (dir->cache)
-        {
-          if (st_icon_cache_has_icon (dir->cache, icon_name))
-            return TRUE;
-        }
-      else
-        {
-          if (g_hash_table_lookup (dir->icons, icon_name) != NULL)
-            return TRUE;
-        }
-    }
-
-  return FALSE;
-}
-
 static void
 theme_list_contexts (IconTheme  *theme,
                      GHashTable *contexts)
@@ -2841,6 +3251,8 @@ icon_info_dup (StIconInfo *icon_info)
 
   if (icon_info->cache_pixbuf)
     dup->cache_pixbuf = g_object_ref (icon_info->cache_pixbuf);
+  if (icon_info->symbolic_base)
+    dup->symbolic_base = g_object_ref (icon_info->symbolic_base);
 
   dup->scale = icon_info->scale;
   dup->unscaled_scale = icon_info->unscaled_scale;
@@ -2875,6 +3287,7 @@ st_icon_info_finalize (GObject *object)
   g_clear_object (&icon_info->pixbuf);
   g_clear_object (&icon_info->proxy_pixbuf);
   g_clear_object (&icon_info->cache_pixbuf);
+  g_clear_object (&icon_info->symbolic_base);
   g_clear_error (&icon_info->load_error);
 
   symbolic_pixbuf_cache_free (icon_info->symbolic_pixbuf_cache);
@@ -3637,15 +4050,6 @@ symbolic_cache_get_proxy (SymbolicPixbufCache *symbolic_cache,
   return symbolic_cache->proxy_pixbuf;
 }
 
-static char *
-color_to_string_noalpha (const CoglColor *color)
-{
-  return g_strdup_printf ("rgb(%d,%d,%d)",
-                          color->red,
-                          color->green,
-                          color->blue);
-}
-
 static void
 color_to_pixel(const CoglColor *color,
                uint8_t          pixel[4])
@@ -3685,49 +4089,34 @@ color_symbolic_pixbuf (GdkPixbuf    *symbolic,
   dst_data = gdk_pixbuf_get_pixels (colored);
   dst_stride = gdk_pixbuf_get_rowstride (colored);
 
+  /* Branch-free, so that the compiler can vectorize the inner loop.
+   * Transparent pixels get black, and pixels without any of the
+   * other channels get exactly the foreground color.
+   */
   for (y = 0; y < height; y++)
     {
       src_row = src_data + src_stride * y;
       dst_row = dst_data + dst_stride * y;
       for (x = 0; x < width; x++)
         {
-          guint r, g, b, a;
+          guint a, visible;
           int c1, c2, c3, c4;
 
           a = src_row[3];
+          visible = a != 0;
           dst_row[3] = a * alpha / 255;
 
-          if (a == 0)
-            {
-              dst_row[0] = 0;
-              dst_row[1] = 0;
-              dst_row[2] = 0;
-            }
-          else
-            {
-              c2 = src_row[0];
-              c3 = src_row[1];
-              c4 = src_row[2];
-
-              if (c2 == 0 && c3 == 0 && c4 == 0)
-                {
-                  dst_row[0] = fg_pixel[0];
-                  dst_row[1] = fg_pixel[1];
-                  dst_row[2] = fg_pixel[2];
-                }
-              else
-                {
-                  c1 = 255 - c2 - c3 - c4;
+          c2 = src_row[0];
+          c3 = src_row[1];
+          c4 = src_row[2];
+          c1 = MAX (255 - c2 - c3 - c4, 0);
 
-                  r = fg_pixel[0] * c1 + success_pixel[0] * c2 +  warning_pixel[0] * c3 +  error_pixel[0] * c4;
-                  g = fg_pixel[1] * c1 + success_pixel[1] * c2 +  warning_pixel[1] * c3 +  error_pixel[1] * c4;
-                  b = fg_pixel[2] * c1 + success_pixel[2] * c2 +  warning_pixel[2] * c3 +  error_pixel[2] * c4;
-
-                  dst_row[0] = r / 255;
-                  dst_row[1] = g / 255;
-                  dst_row[2] = b / 255;
-                }
-            }
+          dst_row[0] = visible * ((fg_pixel[0] * c1 + success_pixel[0] * c2 +
+                                   warning_pixel[0] * c3 + error_pixel[0] * c4) / 255);
+          dst_row[1] = visible * ((fg_pixel[1] * c1 + success_pixel[1] * c2 +
+                                   warning_pixel[1] * c3 + error_pixel[1] * c4) / 255);
+          dst_row[2] = visible * ((fg_pixel[2] * c1 + success_pixel[2] * c2 +
+                                   warning_pixel[2] * c3 + error_pixel[2] * c4) / 255);
 
           src_row += 4;
           dst_row += 4;
@@ -3763,17 +4152,17 @@ st_icon_info_load_symbolic_png (StIconInfo    *icon_info,
   return color_symbolic_pixbuf (icon_info->pixbuf, colors);
 }
 
-static GdkPixbuf *
-st_icon_info_load_symbolic_svg (StIconInfo    *icon_info,
-                                StIconColors  *colors,
-                                GError       **error)
+/* Renders the SVG with the foreground black and the success, warning
+ * and error colors in the red, green and blue channels respectively,
+ * like .symbolic.png icons, so that color_symbolic_pixbuf() can apply
+ * any colors without going through the SVG loader again.
+ */
+static gboolean
+icon_info_ensure_symbolic_base (StIconInfo  *icon_info,
+                                GError     **error)
 {
   GInputStream *stream;
   GdkPixbuf *pixbuf;
-  g_autofree char *css_fg = NULL;
-  g_autofree char *css_success = NULL;
-  g_autofree char *css_warning = NULL;
-  g_autofree char *css_error = NULL;
   g_autofree char *width = NULL;
   g_autofree char *height = NULL;
   g_autofree char *file_data = NULL;
@@ -3781,25 +4170,18 @@ st_icon_info_load_symbolic_svg (StIconInfo    *icon_info,
   char *data;
   gsize file_len;
   int symbolic_size;
-  double alpha;
-  char alphastr[G_ASCII_DTOSTR_BUF_SIZE];
-
-  alpha = colors->foreground.alpha / 255.;
 
-  css_fg = color_to_string_noalpha (&colors->foreground);
-
-  css_warning = color_to_string_noalpha (&colors->warning);
-  css_error = color_to_string_noalpha (&colors->error);
-  css_success = color_to_string_noalpha (&colors->success);
+  if (icon_info->symbolic_base != NULL)
+    return TRUE;
 
   if (!g_file_load_contents (icon_info->icon_file, NULL, &file_data, &file_len, NULL, error))
-    return NULL;
+    return FALSE;
 
   if (!icon_info_ensure_scale_and_pixbuf (icon_info))
     {
       g_propagate_error (error, icon_info->load_error);
       icon_info->load_error = NULL;
-      return NULL;
+      return FALSE;
     }
 
   if (icon_info->symbolic_width == 0 ||
@@ -3811,7 +4193,7 @@ st_icon_info_load_symbolic_svg (StIconInfo    *icon_info,
       g_object_unref (stream);
 
       if (!pixbuf)
-        return NULL;
+        return FALSE;
 
       icon_info->symbolic_width = gdk_pixbuf_get_width (pixbuf);
       icon_info->symbolic_height = gdk_pixbuf_get_height (pixbuf);
@@ -3834,8 +4216,6 @@ st_icon_info_load_symbolic_svg (StIconInfo    *icon_info,
 
   escaped_file_data = g_base64_encode ((guchar *) file_data, file_len);
 
-  g_ascii_dtostr (alphastr, G_ASCII_DTOSTR_BUF_SIZE, CLAMP (alpha, 0, 1));
-
   data = g_strconcat ("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n"
                       "<svg version=\"1.1\"\n"
                       "     xmlns=\"http://www.w3.org/2000/svg\"\n"
@@ -3844,19 +4224,19 @@ st_icon_info_load_symbolic_svg (StIconInfo    *icon_info,
                       "     height=\"", height, "\">\n"
                       "  <style type=\"text/css\">\n"
                       "    rect,path,ellipse,circle,polygon {\n"
-                      "      fill: ", css_fg," !important;\n"
+                      "      fill: rgb(0,0,0) !important;\n"
                       "    }\n"
                       "    .warning {\n"
-                      "      fill: ", css_warning, " !important;\n"
+                      "      fill: rgb(0,255,0) !important;\n"
                       "    }\n"
                       "    .error {\n"
-                      "      fill: ", css_error ," !important;\n"
+                      "      fill: rgb(0,0,255) !important;\n"
                       "    }\n"
                       "    .success {\n"
-                      "      fill: ", css_success, " !important;\n"
+                      "      fill: rgb(255,0,0) !important;\n"
                       "    }\n"
                       "  </style>\n"
-                      "  <g opacity=\"", alphastr, "\" ><xi:include href=\"data:text/xml;base64,", escaped_file_data, "\"/></g>\n"
+                      "  <g><xi:include href=\"data:text/xml;base64,", escaped_file_data, "\"/></g>\n"
                       "</svg>",
                       NULL);
 
@@ -3869,7 +4249,32 @@ st_icon_info_load_symbolic_svg (StIconInfo    *icon_info,
                                                 error);
   g_object_unref (stream);
 
-  return pixbuf;
+  if (pixbuf == NULL)
+    return FALSE;
+
+  /* color_symbolic_pixbuf() expects RGBA */
+  if (!gdk_pixbuf_get_has_alpha (pixbuf))
+    {
+      GdkPixbuf *with_alpha = gdk_pixbuf_add_alpha (pixbuf, FALSE, 0, 0, 0);
+
+      g_object_unref (pixbuf);
+      pixbuf = with_alpha;
+    }
+
+  icon_info->symbolic_base = pixbuf;
+
+  return TRUE;
+}
+
+static GdkPixbuf *
+st_icon_info_load_symbolic_svg (StIconInfo    *icon_info,
+                                StIconColors  *colors,
+                                GError       **error)
+{
+  if (!icon_info_ensure_symbolic_base (icon_info, error))
+    return NULL;
+
+  return color_symbolic_pixbuf (icon_info->symbolic_base, colors);
 }
 
 
@@ -4132,6 +4537,10 @@ st_icon_info_load_symbolic_finish (StIconInfo    *icon_info,
 
       g_assert (pixbuf != NULL); /* we checked for !had_error above */
 
+      /* Keep the rendered SVG around for the next colors */
+      if (icon_info->symbolic_base == NULL && data->dup->symbolic_base != NULL)
+        icon_info->symbolic_base = g_object_ref (data->dup->symbolic_base);
+
       symbolic_cache = symbolic_pixbuf_cache_matches (icon_info->symbolic_pixbuf_cache,
                                                       data->colors);
 
@@ -168,6 +168,16 @@ GList * st_icon_theme_list_contexts (StIconTheme *icon_theme);
 
 gboolean st_icon_theme_rescan_if_needed (StIconTheme *icon_theme);
 
+void st_icon_theme_set_info_cache_size (StIconTheme *icon_theme,
+                                        guint        size);
+
+void st_icon_theme_get_info_cache_stats (StIconTheme *icon_theme,
+                                         guint       *hits,
+                                         guint       *misses);
+
+void st_icon_theme_trim (StIconTheme                *icon_theme,
+                         GMemoryMonitorWarningLevel  level);
+
 StIconInfo * st_icon_info_new_for_pixbuf (StIconTheme *icon_theme,
                                           GdkPixbuf   *pixbuf);
 
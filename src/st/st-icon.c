@@ -67,6 +67,8 @@ struct _StIconPrivate
   gboolean         is_themed;
   gboolean         is_symbolic;
 
+  StTextureCachePriority load_priority;
+
   StIconColors     *colors;
 
   CoglPipeline    *shadow_pipeline;
@@ -86,6 +88,20 @@ static GIcon *default_gicon = NULL;
 #define IMAGE_MISSING_ICON_NAME "image-missing"
 #define DEFAULT_ICON_SIZE 48
 
+static void
+clear_pending_texture (StIcon *icon)
+{
+  StIconPrivate *priv = icon->priv;
+
+  if (priv->pending_texture == NULL)
+    return;
+
+  st_texture_cache_cancel_load (st_texture_cache_get_default (),
+                                priv->pending_texture);
+  clutter_actor_destroy (priv->pending_texture);
+  g_clear_object (&priv->pending_texture);
+}
+
 static void
 on_icon_theme_changed (StIcon *icon)
 {
@@ -180,12 +196,7 @@ st_icon_dispose (GObject *gobject)
       priv->icon_texture = NULL;
     }
 
-  if (priv->pending_texture)
-    {
-      clutter_actor_destroy (priv->pending_texture);
-      g_object_unref (priv->pending_texture);
-      priv->pending_texture = NULL;
-    }
+  clear_pending_texture (ST_ICON (gobject));
 
   g_clear_signal_handler (&priv->icon_theme_changed_id,
                           st_texture_cache_get_default ());
@@ -518,32 +529,6 @@ opacity_changed_cb (GObject *object,
   st_icon_finish_update (icon);
 }
 
-static ClutterActor *
-load_gicon (StTextureCache *cache,
-            StThemeNode    *theme_node,
-            GIcon          *gicon,
-            int             size,
-            int             paint_scale,
-            float           resource_scale,
-            gboolean       *is_themed)
-{
-  ClutterActor *texture;
-
-  g_assert (is_themed != NULL);
-
-  texture = st_texture_cache_load_gicon (cache,
-                                         theme_node,
-                                         gicon,
-                                         size,
-                                         paint_scale,
-                                         resource_scale);
-
-
-  if (texture)
-    *is_themed = G_IS_THEMED_ICON (gicon);
-  return texture;
-}
-
 static void
 st_icon_update (StIcon *icon)
 {
@@ -554,12 +539,12 @@ st_icon_update (StIcon *icon)
   ClutterActor *stage;
   StThemeContext *context;
   float resource_scale;
+  GIcon *icons[3];
+  int n_icons = 0, chosen;
 
   if (priv->pending_texture)
     {
-      clutter_actor_destroy (priv->pending_texture);
-      g_object_unref (priv->pending_texture);
-      priv->pending_texture = NULL;
+      clear_pending_texture (icon);
       priv->opacity_handler_id = 0;
     }
 
@@ -588,38 +573,34 @@ st_icon_update (StIcon *icon)
 
   priv->is_themed = FALSE;
 
+  /* Resolve the whole chain at once, rather than creating a texture
+   * for every icon that turns out not to exist */
   if (priv->gicon != NULL)
-    priv->pending_texture = load_gicon (cache,
-                                        theme_node,
-                                        priv->gicon,
-                                        priv->icon_size / paint_scale,
-                                        paint_scale,
-                                        resource_scale,
-                                        &priv->is_themed);
-
-  if (priv->pending_texture == NULL && priv->fallback_gicon != NULL)
-    priv->pending_texture = load_gicon (cache,
-                                        theme_node,
-                                        priv->fallback_gicon,
-                                        priv->icon_size / paint_scale,
-                                        paint_scale,
-                                        resource_scale,
-                                        &priv->is_themed);
-
-  if (priv->pending_texture == NULL)
-    priv->pending_texture = load_gicon (cache,
-                                        theme_node,
-                                        default_gicon,
-                                        priv->icon_size / paint_scale,
-                                        paint_scale,
-                                        resource_scale,
-                                        &priv->is_themed);
+    icons[n_icons++] = priv->gicon;
+  if (priv->fallback_gicon != NULL)
+    icons[n_icons++] = priv->fallback_gicon;
+  icons[n_icons++] = default_gicon;
+
+  priv->pending_texture =
+    st_texture_cache_load_gicon_with_fallbacks (cache,
+                                                theme_node,
+                                                icons, n_icons,
+                                                priv->icon_size / paint_scale,
+                                                paint_scale,
+                                                resource_scale,
+                                                &chosen);
+  if (priv->pending_texture)
+    priv->is_themed = G_IS_THEMED_ICON (icons[chosen]);
   priv->needs_update = FALSE;
 
   if (priv->pending_texture)
     {
       g_object_ref_sink (priv->pending_texture);
 
+      if (priv->load_priority != ST_TEXTURE_CACHE_PRIORITY_VISIBLE)
+        st_texture_cache_set_load_priority (cache, priv->pending_texture,
+                                            priv->load_priority);
+
       if (clutter_actor_get_opacity (priv->pending_texture) != 0 || priv->icon_texture == NULL)
         {
           /* This icon is ready for showing, or nothing else is already showing */
@@ -931,3 +912,51 @@ st_icon_get_is_symbolic (StIcon *icon)
 
   return icon->priv->is_symbolic;
 }
+
+/**
+ * st_icon_set_load_priority:
+ * @icon: an #StIcon
+ * @priority: a #StTextureCachePriority
+ *
+ * Sets how urgently the icon should be loaded, for instance depending on
+ * whether it is currently scrolled into view. Icons are loaded with
+ * %ST_TEXTURE_CACHE_PRIORITY_VISIBLE by default.
+ */
+void
+st_icon_set_load_priority (StIcon                 *icon,
+                           StTextureCachePriority  priority)
+{
+  StIconPrivate *priv;
+  StTextureCache *cache;
+
+  g_return_if_fail (ST_IS_ICON (icon));
+
+  priv = icon->priv;
+
+  if (priv->load_priority == priority)
+    return;
+
+  priv->load_priority = priority;
+
+  cache = st_texture_cache_get_default ();
+
+  /* The shown texture may be still loading too, if nothing was shown before */
+  if (priv->pending_texture)
+    st_texture_cache_set_load_priority (cache, priv->pending_texture, priority);
+  if (priv->icon_texture)
+    st_texture_cache_set_load_priority (cache, priv->icon_texture, priority);
+}
+
+/**
+ * st_icon_get_load_priority:
+ * @icon: an #StIcon
+ *
+ * Returns: the priority set with st_icon_set_load_priority()
+ */
+StTextureCachePriority
+st_icon_get_load_priority (StIcon *icon)
+{
+  g_return_val_if_fail (ST_IS_ICON (icon), ST_TEXTURE_CACHE_PRIORITY_VISIBLE);
+
+  return icon->priv->load_priority;
+}
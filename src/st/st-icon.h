@@ -33,6 +33,7 @@
 #include <st/st-widget.h>
 
 #include <st/st-types.h>
+#include <st/st-texture-cache.h>
 
 G_BEGIN_DECLS
 
@@ -78,6 +79,10 @@ void         st_icon_set_icon_size (StIcon *icon,
 
 gboolean     st_icon_get_is_symbolic (StIcon *icon);
 
+StTextureCachePriority st_icon_get_load_priority (StIcon                 *icon);
+void                   st_icon_set_load_priority (StIcon                 *icon,
+                                                  StTextureCachePriority  priority);
+
 G_END_DECLS
 
 #endif /* _ST_ICON */
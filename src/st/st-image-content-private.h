@@ -18,6 +18,7 @@
 
 #pragma once
 
+#include "st-icon-colors.h"
 #include "st-image-content.h"
 
 G_BEGIN_DECLS
@@ -27,4 +28,18 @@ void st_image_content_set_is_symbolic (StImageContent *content,
 
 gboolean st_image_content_get_is_symbolic (StImageContent *content);
 
+void st_image_content_set_atlas_region (StImageContent *content,
+                                        CoglTexture    *atlas,
+                                        int             x,
+                                        int             y,
+                                        int             width,
+                                        int             height);
+
+ClutterContent * st_image_content_new_recolored (StImageContent *mask,
+                                                 StIconColors   *colors);
+
+void st_image_content_set_frames (StImageContent *content,
+                                  int             frame_width,
+                                  int             frame_height);
+
 G_END_DECLS
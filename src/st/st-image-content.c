@@ -35,8 +35,51 @@ struct _StImageContentPrivate
   int width;
   int height;
   gboolean is_symbolic;
+
+  /* Set instead of the ClutterImage texture for icons in an atlas,
+   * for recolored views of another image and for sprite sheets */
+  CoglTexture *atlas;
+  graphene_rect_t atlas_region;
+
+  /* A grid of equally sized frames in atlas, see
+   * st_image_content_set_frames() */
+  int n_frames;
+  int n_frame_columns;
+
+  /* Applied on the GPU to a symbolic mask, see
+   * st_image_content_new_recolored() */
+  StImageContent *mask; /* keeps its atlas cell from being reused */
+  StIconColors *colors;
+  CoglPipeline *recolor_pipeline;
+  int opacity_uniform;
+
+  /* The image encoded as PNG for use as a GIcon, and the SHA-256 of
+   * the encoded data identifying its contents, see ensure_encoded() */
+  CoglTexture *encoded_texture;
+  GBytes *encoded;
+  char *checksum;
 };
 
+static const char *recolor_glsl_declarations =
+"uniform vec4 st_fg_color;                                                 \n"
+"uniform vec4 st_success_color;                                            \n"
+"uniform vec4 st_warning_color;                                            \n"
+"uniform vec4 st_error_color;                                              \n"
+"uniform float st_opacity;                                                 \n";
+
+/* The same mapping as for .symbolic.png icons in StIconTheme */
+static const char *recolor_glsl =
+"  float alpha = cogl_color_out.a;                                         \n"
+"  vec3 mask = alpha > 0.0 ? cogl_color_out.rgb / alpha : vec3 (0.0);      \n"
+"  float fg = clamp (1.0 - mask.r - mask.g - mask.b, 0.0, 1.0);            \n"
+"  vec3 color = st_fg_color.rgb * fg +                                     \n"
+"               st_success_color.rgb * mask.r +                            \n"
+"               st_warning_color.rgb * mask.g +                            \n"
+"               st_error_color.rgb * mask.b;                               \n"
+"                                                                          \n"
+"  alpha *= st_fg_color.a * st_opacity;                                    \n"
+"  cogl_color_out = vec4 (color * alpha, alpha);                           \n";
+
 enum
 {
   PROP_0,
@@ -44,6 +87,8 @@ enum
   PROP_PREFERRED_HEIGHT,
 };
 
+static ClutterContentInterface *parent_content_iface = NULL;
+
 static void clutter_content_interface_init (ClutterContentInterface *iface);
 static void g_icon_interface_init (GIconIface *iface);
 static void g_loadable_icon_interface_init (GLoadableIconIface *iface);
@@ -73,6 +118,23 @@ st_image_content_constructed (GObject *object)
                priv->width, priv->height);
 }
 
+static void
+st_image_content_finalize (GObject *object)
+{
+  StImageContent *self = ST_IMAGE_CONTENT (object);
+  StImageContentPrivate *priv = st_image_content_get_instance_private (self);
+
+  g_clear_object (&priv->atlas);
+  g_clear_object (&priv->recolor_pipeline);
+  g_clear_pointer (&priv->colors, st_icon_colors_unref);
+  g_clear_object (&priv->mask);
+  g_clear_object (&priv->encoded_texture);
+  g_clear_pointer (&priv->encoded, g_bytes_unref);
+  g_clear_pointer (&priv->checksum, g_free);
+
+  G_OBJECT_CLASS (st_image_content_parent_class)->finalize (object);
+}
+
 static void
 st_image_content_get_property (GObject    *object,
                                guint       prop_id,
@@ -130,6 +192,7 @@ st_image_content_class_init (StImageContentClass *klass)
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
   object_class->constructed = st_image_content_constructed;
+  object_class->finalize = st_image_content_finalize;
   object_class->get_property = st_image_content_get_property;
   object_class->set_property = st_image_content_set_property;
 
@@ -159,7 +222,7 @@ st_image_content_get_preferred_size (ClutterContent *content,
 
   texture = clutter_image_get_texture (CLUTTER_IMAGE (content));
 
-  if (texture == NULL)
+  if (texture == NULL && priv->atlas == NULL)
     return FALSE;
 
   g_assert_cmpint (priv->width, >, -1);
@@ -174,24 +237,234 @@ st_image_content_get_preferred_size (ClutterContent *content,
   return TRUE;
 }
 
+static CoglPipelineFilter
+pipeline_filter_from_scaling_filter (ClutterScalingFilter filter,
+                                     gboolean             allow_mipmap)
+{
+  switch (filter)
+    {
+    case CLUTTER_SCALING_FILTER_NEAREST:
+      return COGL_PIPELINE_FILTER_NEAREST;
+
+    case CLUTTER_SCALING_FILTER_TRILINEAR:
+      if (allow_mipmap)
+        return COGL_PIPELINE_FILTER_LINEAR_MIPMAP_LINEAR;
+      return COGL_PIPELINE_FILTER_LINEAR;
+
+    case CLUTTER_SCALING_FILTER_LINEAR:
+    default:
+      return COGL_PIPELINE_FILTER_LINEAR;
+    }
+}
+
+static void
+set_color_uniform (CoglPipeline    *pipeline,
+                   const char      *name,
+                   const CoglColor *color)
+{
+  float value[4];
+
+  value[0] = color->red / 255.0;
+  value[1] = color->green / 255.0;
+  value[2] = color->blue / 255.0;
+  value[3] = color->alpha / 255.0;
+
+  cogl_pipeline_set_uniform_float (pipeline,
+                                   cogl_pipeline_get_uniform_location (pipeline, name),
+                                   4, 1, value);
+}
+
+static CoglPipeline *
+create_recolor_pipeline (void)
+{
+  static CoglPipeline *recolor_pipeline = NULL;
+
+  if (G_UNLIKELY (recolor_pipeline == NULL))
+    {
+      CoglContext *ctx =
+        clutter_backend_get_cogl_context (clutter_get_default_backend ());
+      CoglSnippet *snippet;
+
+      recolor_pipeline = cogl_pipeline_new (ctx);
+      cogl_pipeline_set_layer_null_texture (recolor_pipeline, 0);
+
+      snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_FRAGMENT,
+                                  recolor_glsl_declarations,
+                                  recolor_glsl);
+      cogl_pipeline_add_snippet (recolor_pipeline, snippet);
+      g_object_unref (snippet);
+    }
+
+  return cogl_pipeline_copy (recolor_pipeline);
+}
+
+static CoglPipeline *
+get_recolor_pipeline (StImageContent       *self,
+                      ClutterScalingFilter  min_filter,
+                      ClutterScalingFilter  mag_filter,
+                      float                 opacity)
+{
+  StImageContentPrivate *priv = st_image_content_get_instance_private (self);
+
+  if (priv->recolor_pipeline == NULL)
+    {
+      priv->recolor_pipeline = create_recolor_pipeline ();
+      cogl_pipeline_set_layer_texture (priv->recolor_pipeline, 0, priv->atlas);
+
+      set_color_uniform (priv->recolor_pipeline, "st_fg_color",
+                         &priv->colors->foreground);
+      set_color_uniform (priv->recolor_pipeline, "st_success_color",
+                         &priv->colors->success);
+      set_color_uniform (priv->recolor_pipeline, "st_warning_color",
+                         &priv->colors->warning);
+      set_color_uniform (priv->recolor_pipeline, "st_error_color",
+                         &priv->colors->error);
+
+      priv->opacity_uniform =
+        cogl_pipeline_get_uniform_location (priv->recolor_pipeline, "st_opacity");
+    }
+
+  cogl_pipeline_set_layer_filters (priv->recolor_pipeline, 0,
+                                   pipeline_filter_from_scaling_filter (min_filter, TRUE),
+                                   pipeline_filter_from_scaling_filter (mag_filter, FALSE));
+  cogl_pipeline_set_uniform_1f (priv->recolor_pipeline,
+                                priv->opacity_uniform,
+                                opacity);
+
+  return priv->recolor_pipeline;
+}
+
+static void
+st_image_content_paint_content (ClutterContent      *content,
+                                ClutterActor        *actor,
+                                ClutterPaintNode    *root,
+                                ClutterPaintContext *paint_context)
+{
+  StImageContent *self = ST_IMAGE_CONTENT (content);
+  StImageContentPrivate *priv = st_image_content_get_instance_private (self);
+  ClutterScalingFilter min_filter, mag_filter;
+  g_autoptr (ClutterPaintNode) node = NULL;
+  ClutterActorBox box;
+  CoglColor color;
+  float opacity, atlas_width, atlas_height;
+
+  if (priv->atlas == NULL)
+    {
+      parent_content_iface->paint_content (content, actor, root, paint_context);
+      return;
+    }
+
+  clutter_actor_get_content_box (actor, &box);
+  clutter_actor_get_content_scaling_filters (actor, &min_filter, &mag_filter);
+
+  opacity = clutter_actor_get_paint_opacity (actor) / 255.0;
+
+  atlas_width = cogl_texture_get_width (priv->atlas);
+  atlas_height = cogl_texture_get_height (priv->atlas);
+
+  if (priv->colors != NULL)
+    {
+      CoglPipeline *pipeline;
+
+      pipeline = get_recolor_pipeline (self, min_filter, mag_filter, opacity);
+      node = clutter_pipeline_node_new (pipeline);
+      clutter_paint_node_set_static_name (node, "Recolored Image Content");
+    }
+  else
+    {
+      cogl_color_init_from_4f (&color, opacity, opacity, opacity, opacity);
+
+      /* Every icon of an atlas paints with an equal pipeline, which Cogl
+       * batches into one draw call for consecutive icons */
+      node = clutter_texture_node_new (priv->atlas, &color, min_filter, mag_filter);
+      clutter_paint_node_set_static_name (node, "Atlas Image Content");
+    }
+
+  clutter_paint_node_add_texture_rectangle (node, &box,
+                                            priv->atlas_region.origin.x / atlas_width,
+                                            priv->atlas_region.origin.y / atlas_height,
+                                            (priv->atlas_region.origin.x +
+                                             priv->atlas_region.size.width) / atlas_width,
+                                            (priv->atlas_region.origin.y +
+                                             priv->atlas_region.size.height) / atlas_height);
+  clutter_paint_node_add_child (root, node);
+}
+
+static CoglTexture *
+get_image_texture (StImageContent *image)
+{
+  StImageContentPrivate *priv = st_image_content_get_instance_private (image);
+  CoglContext *ctx;
+
+  if (priv->atlas == NULL)
+    {
+      CoglTexture *texture = clutter_image_get_texture (CLUTTER_IMAGE (image));
+
+      return texture ? g_object_ref (texture) : NULL;
+    }
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+  return cogl_sub_texture_new (ctx, priv->atlas,
+                               priv->atlas_region.origin.x,
+                               priv->atlas_region.origin.y,
+                               priv->atlas_region.size.width,
+                               priv->atlas_region.size.height);
+}
+
+/* What the recolor shader does, for reading back recolored images */
+static void
+recolor_pixels (uint8_t      *data,
+                int           n_pixels,
+                StIconColors *colors)
+{
+  const CoglColor *fg = &colors->foreground;
+  const CoglColor *success = &colors->success;
+  const CoglColor *warning = &colors->warning;
+  const CoglColor *error = &colors->error;
+  int i;
+
+  for (i = 0; i < n_pixels; i++, data += 4)
+    {
+      int c1, c2, c3, c4;
+
+      c2 = data[0];
+      c3 = data[1];
+      c4 = data[2];
+      c1 = MAX (255 - c2 - c3 - c4, 0);
+
+      data[0] = (fg->red * c1 + success->red * c2 +
+                 warning->red * c3 + error->red * c4) / 255;
+      data[1] = (fg->green * c1 + success->green * c2 +
+                 warning->green * c3 + error->green * c4) / 255;
+      data[2] = (fg->blue * c1 + success->blue * c2 +
+                 warning->blue * c3 + error->blue * c4) / 255;
+      data[3] = data[3] * fg->alpha / 255;
+    }
+}
+
 static GdkPixbuf*
 pixbuf_from_image (StImageContent *image)
 {
-  CoglTexture *texture;
+  StImageContentPrivate *priv = st_image_content_get_instance_private (image);
+  g_autoptr (CoglTexture) texture = NULL;
   int width, height, rowstride;
   uint8_t *data;
 
-  texture = clutter_image_get_texture (CLUTTER_IMAGE (image));
+  texture = get_image_texture (image);
   if (!texture || !cogl_texture_is_get_data_supported (texture))
     return NULL;
 
   width = cogl_texture_get_width (texture);
-  height = cogl_texture_get_width (texture);
+  height = cogl_texture_get_height (texture);
   rowstride = 4 * width;
   data = g_new (uint8_t, rowstride * height);
 
   cogl_texture_get_data (texture, COGL_PIXEL_FORMAT_RGBA_8888, rowstride, data);
 
+  if (priv->colors != NULL)
+    recolor_pixels (data, width * height, priv->colors);
+
   return gdk_pixbuf_new_from_data ((const guchar *)data,
                                    GDK_COLORSPACE_RGB,
                                    TRUE, 8, width, height, rowstride,
@@ -201,32 +474,138 @@ pixbuf_from_image (StImageContent *image)
 static void
 clutter_content_interface_init (ClutterContentInterface *iface)
 {
+  parent_content_iface = g_type_interface_peek_parent (iface);
+
   iface->get_preferred_size = st_image_content_get_preferred_size;
+  iface->paint_content = st_image_content_paint_content;
+}
+
+/* The texture the image is read back from, which stays the same until
+ * new data is set on the ClutterImage */
+static CoglTexture *
+get_source_texture (StImageContent *image)
+{
+  StImageContentPrivate *priv = st_image_content_get_instance_private (image);
+
+  if (priv->atlas != NULL)
+    return priv->atlas;
+
+  return clutter_image_get_texture (CLUTTER_IMAGE (image));
+}
+
+static GBytes *
+encode_pixbuf (GdkPixbuf  *pixbuf,
+               GError    **error)
+{
+  char *buffer;
+  gsize size;
+
+  if (!gdk_pixbuf_save_to_buffer (pixbuf, &buffer, &size, "png", error, NULL))
+    return NULL;
+
+  return g_bytes_new_take (buffer, size);
+}
+
+static gboolean
+is_encoded (StImageContent *image)
+{
+  StImageContentPrivate *priv = st_image_content_get_instance_private (image);
+
+  return priv->encoded != NULL &&
+         priv->encoded_texture == get_source_texture (image);
+}
+
+static void
+set_encoded (StImageContent *image,
+             CoglTexture    *source,
+             GBytes         *encoded)
+{
+  StImageContentPrivate *priv = st_image_content_get_instance_private (image);
+
+  g_set_object (&priv->encoded_texture, source);
+  g_clear_pointer (&priv->encoded, g_bytes_unref);
+  priv->encoded = g_bytes_ref (encoded);
+
+  g_free (priv->checksum);
+  priv->checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, encoded);
+}
+
+/* Reading back and encoding the image is expensive, so it's done at
+ * most once for as long as the image doesn't change, however often it
+ * is serialized or loaded. The encoded data is the same for identical
+ * images, so that the texture cache decodes and uploads them only once
+ * after a round trip through g_icon_serialize(). */
+static gboolean
+ensure_encoded (StImageContent  *image,
+                GError         **error)
+{
+  g_autoptr (GdkPixbuf) pixbuf = NULL;
+  g_autoptr (GBytes) encoded = NULL;
+
+  if (is_encoded (image))
+    return TRUE;
+
+  pixbuf = pixbuf_from_image (image);
+  if (!pixbuf)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                           "Failed to read texture");
+      return FALSE;
+    }
+
+  encoded = encode_pixbuf (pixbuf, error);
+  if (!encoded)
+    return FALSE;
+
+  set_encoded (image, get_source_texture (image), encoded);
+
+  return TRUE;
 }
 
 static guint
 st_image_content_hash (GIcon *icon)
 {
-  return g_direct_hash (icon);
+  StImageContent *image = ST_IMAGE_CONTENT (icon);
+  StImageContentPrivate *priv = st_image_content_get_instance_private (image);
+
+  if (!ensure_encoded (image, NULL))
+    return g_direct_hash (icon);
+
+  return g_str_hash (priv->checksum);
 }
 
 static gboolean
 st_image_content_equal (GIcon *icon1,
                         GIcon *icon2)
 {
-  return g_direct_equal (icon1, icon2);
+  StImageContent *image1 = ST_IMAGE_CONTENT (icon1);
+  StImageContent *image2 = ST_IMAGE_CONTENT (icon2);
+  StImageContentPrivate *priv1 = st_image_content_get_instance_private (image1);
+  StImageContentPrivate *priv2 = st_image_content_get_instance_private (image2);
+
+  if (icon1 == icon2)
+    return TRUE;
+
+  /* Images that can't be read back only hash by their address */
+  if (!ensure_encoded (image1, NULL) || !ensure_encoded (image2, NULL))
+    return FALSE;
+
+  return g_str_equal (priv1->checksum, priv2->checksum);
 }
 
 static GVariant *
 st_image_content_serialize (GIcon *icon)
 {
-  g_autoptr (GdkPixbuf) pixbuf = NULL;
+  StImageContent *image = ST_IMAGE_CONTENT (icon);
+  StImageContentPrivate *priv = st_image_content_get_instance_private (image);
 
-  pixbuf = pixbuf_from_image (ST_IMAGE_CONTENT (icon));
-  if (!pixbuf)
+  if (!ensure_encoded (image, NULL))
     return NULL;
 
-  return g_icon_serialize (G_ICON (pixbuf));
+  /* The same as g_icon_serialize() of a GBytesIcon */
+  return g_variant_new ("(sv)", "bytes",
+                        g_variant_new_from_bytes (G_VARIANT_TYPE_BYTESTRING,
+                                                  priv->encoded, TRUE));
 }
 
 static void
@@ -244,45 +623,47 @@ st_image_load (GLoadableIcon  *icon,
                GCancellable   *cancellable,
                GError       **error)
 {
-  g_autoptr (GdkPixbuf) pixbuf = NULL;
+  StImageContent *image = ST_IMAGE_CONTENT (icon);
+  StImageContentPrivate *priv = st_image_content_get_instance_private (image);
 
-  pixbuf = pixbuf_from_image (ST_IMAGE_CONTENT (icon));
-  if (!pixbuf)
-    {
-      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
-                           "Failed to read texture");
-      return NULL;
-    }
+  if (!ensure_encoded (image, error))
+    return NULL;
+
+  if (type)
+    *type = g_strdup ("image/png");
+
+  return g_memory_input_stream_new_from_bytes (priv->encoded);
+}
+
+typedef struct {
+  CoglTexture *source;
+  GdkPixbuf *pixbuf;
+} EncodeImageData;
 
-  return g_loadable_icon_load (G_LOADABLE_ICON (pixbuf),
-                               size, type, cancellable, error);
+static void
+encode_image_data_free (EncodeImageData *data)
+{
+  g_object_unref (data->source);
+  g_object_unref (data->pixbuf);
+  g_free (data);
 }
 
 static void
-load_image_thread (GTask        *task,
-                   gpointer      object,
-                   gpointer      task_data,
-                   GCancellable *cancellable)
+encode_image_thread (GTask        *task,
+                     gpointer      object,
+                     gpointer      task_data,
+                     GCancellable *cancellable)
 {
-  GInputStream *stream;
+  EncodeImageData *data = task_data;
+  GBytes *encoded;
   GError *error = NULL;
-  char *type;
 
-  stream = st_image_load (G_LOADABLE_ICON (object),
-                          GPOINTER_TO_INT (task_data),
-                          &type,
-                          cancellable,
-                          &error);
+  encoded = encode_pixbuf (data->pixbuf, &error);
 
   if (error)
-    {
-      g_task_return_error (task, error);
-    }
+    g_task_return_error (task, error);
   else
-    {
-      g_task_set_task_data (task, type, g_free);
-      g_task_return_pointer (task, stream, g_object_unref);
-    }
+    g_task_return_pointer (task, encoded, (GDestroyNotify) g_bytes_unref);
 }
 
 static void
@@ -292,11 +673,37 @@ st_image_load_async (GLoadableIcon       *icon,
                      GAsyncReadyCallback  callback,
                      gpointer             user_data)
 {
+  StImageContent *image = ST_IMAGE_CONTENT (icon);
+  StImageContentPrivate *priv = st_image_content_get_instance_private (image);
   g_autoptr (GTask) task = NULL;
+  EncodeImageData *data;
+  GdkPixbuf *pixbuf;
 
   task = g_task_new (icon, cancellable, callback, user_data);
-  g_task_set_task_data (task, GINT_TO_POINTER (size), NULL);
-  g_task_run_in_thread (task, load_image_thread);
+  g_task_set_source_tag (task, st_image_load_async);
+
+  if (is_encoded (image))
+    {
+      g_task_return_pointer (task, g_bytes_ref (priv->encoded),
+                             (GDestroyNotify) g_bytes_unref);
+      return;
+    }
+
+  /* Textures can only be read back from the main thread */
+  pixbuf = pixbuf_from_image (image);
+  if (!pixbuf)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "Failed to read texture");
+      return;
+    }
+
+  data = g_new0 (EncodeImageData, 1);
+  data->source = g_object_ref (get_source_texture (image));
+  data->pixbuf = pixbuf;
+
+  g_task_set_task_data (task, data, (GDestroyNotify) encode_image_data_free);
+  g_task_run_in_thread (task, encode_image_thread);
 }
 
 static GInputStream *
@@ -305,16 +712,22 @@ st_image_load_finish (GLoadableIcon  *icon,
                       char          **type,
                       GError        **error)
 {
-  GInputStream *stream;
+  StImageContent *image = ST_IMAGE_CONTENT (icon);
+  EncodeImageData *data = g_task_get_task_data (G_TASK (res));
+  g_autoptr (GBytes) encoded = NULL;
 
-  stream = g_task_propagate_pointer (G_TASK (res), error);
-  if (!stream)
+  encoded = g_task_propagate_pointer (G_TASK (res), error);
+  if (!encoded)
     return NULL;
 
+  /* Keep the result unless the image changed in the meantime */
+  if (data && data->source == get_source_texture (image))
+    set_encoded (image, data->source, encoded);
+
   if (type)
-    *type = g_strdup (g_task_get_task_data (G_TASK (res)));
+    *type = g_strdup ("image/png");
 
-  return stream;
+  return g_memory_input_stream_new_from_bytes (encoded);
 }
 
 static void
@@ -370,3 +783,189 @@ st_image_content_get_is_symbolic (StImageContent *content)
   priv = st_image_content_get_instance_private (content);
   return priv->is_symbolic;
 }
+
+/**
+ * st_image_content_set_atlas_region:
+ * @content: a #StImageContent
+ * @atlas: the texture shared with other images
+ * @x: the left edge of the image in @atlas, in pixels
+ * @y: the top edge of the image in @atlas, in pixels
+ * @width: the width of the image in @atlas, in pixels
+ * @height: the height of the image in @atlas, in pixels
+ *
+ * Makes @content paint a region of @atlas rather than a texture of its
+ * own. This is meant for images whose data won't be set again.
+ */
+void
+st_image_content_set_atlas_region (StImageContent *content,
+                                   CoglTexture    *atlas,
+                                   int             x,
+                                   int             y,
+                                   int             width,
+                                   int             height)
+{
+  StImageContentPrivate *priv;
+
+  g_return_if_fail (ST_IS_IMAGE_CONTENT (content));
+
+  priv = st_image_content_get_instance_private (content);
+
+  g_set_object (&priv->atlas, atlas);
+  graphene_rect_init (&priv->atlas_region, x, y, width, height);
+
+  clutter_content_invalidate (CLUTTER_CONTENT (content));
+  clutter_content_invalidate_size (CLUTTER_CONTENT (content));
+}
+
+/**
+ * st_image_content_new_recolored:
+ * @mask: a symbolic #StImageContent, colored like .symbolic.png icons
+ * @colors: the colors to apply to @mask
+ *
+ * Creates a content painting the texture of @mask with @colors applied
+ * in a shader, so that any number of color sets can share one texture.
+ *
+ * Returns: (transfer full) (nullable): the new content, or %NULL if
+ *   @mask has no texture yet
+ */
+ClutterContent *
+st_image_content_new_recolored (StImageContent *mask,
+                                StIconColors   *colors)
+{
+  StImageContentPrivate *mask_priv;
+  StImageContentPrivate *priv;
+  ClutterContent *content;
+  CoglTexture *texture;
+
+  g_return_val_if_fail (ST_IS_IMAGE_CONTENT (mask), NULL);
+  g_return_val_if_fail (colors != NULL, NULL);
+
+  mask_priv = st_image_content_get_instance_private (mask);
+
+  content = st_image_content_new_with_preferred_size (mask_priv->width,
+                                                      mask_priv->height);
+  priv = st_image_content_get_instance_private (ST_IMAGE_CONTENT (content));
+
+  if (mask_priv->atlas != NULL)
+    {
+      priv->atlas = g_object_ref (mask_priv->atlas);
+      priv->atlas_region = mask_priv->atlas_region;
+    }
+  else
+    {
+      texture = clutter_image_get_texture (CLUTTER_IMAGE (mask));
+      if (texture == NULL)
+        {
+          g_object_unref (content);
+          return NULL;
+        }
+
+      priv->atlas = g_object_ref (texture);
+      graphene_rect_init (&priv->atlas_region, 0, 0,
+                          cogl_texture_get_width (texture),
+                          cogl_texture_get_height (texture));
+    }
+
+  priv->is_symbolic = TRUE;
+  priv->mask = g_object_ref (mask);
+  priv->colors = st_icon_colors_ref (colors);
+
+  return content;
+}
+
+/**
+ * st_image_content_set_frames:
+ * @content: a #StImageContent with its data set
+ * @frame_width: the width of a frame, in pixels of the image data
+ * @frame_height: the height of a frame, in pixels of the image data
+ *
+ * Turns @content into a sprite sheet, whose image is a grid of frames
+ * of which one is painted at a time. This is meant for images whose
+ * data won't be set again.
+ */
+void
+st_image_content_set_frames (StImageContent *content,
+                             int             frame_width,
+                             int             frame_height)
+{
+  StImageContentPrivate *priv;
+  CoglTexture *texture;
+  int texture_width, texture_height;
+
+  g_return_if_fail (ST_IS_IMAGE_CONTENT (content));
+  g_return_if_fail (frame_width > 0 && frame_height > 0);
+
+  priv = st_image_content_get_instance_private (content);
+
+  texture = clutter_image_get_texture (CLUTTER_IMAGE (content));
+  g_return_if_fail (texture != NULL);
+
+  texture_width = cogl_texture_get_width (texture);
+  texture_height = cogl_texture_get_height (texture);
+
+  g_set_object (&priv->atlas, texture);
+  priv->n_frame_columns = MAX (texture_width / frame_width, 1);
+  priv->n_frames = priv->n_frame_columns * MAX (texture_height / frame_height, 1);
+
+  /* The preferred size was set for the whole image */
+  priv->width = priv->width * frame_width / texture_width;
+  priv->height = priv->height * frame_height / texture_height;
+
+  graphene_rect_init (&priv->atlas_region, 0, 0, frame_width, frame_height);
+
+  clutter_content_invalidate (CLUTTER_CONTENT (content));
+  clutter_content_invalidate_size (CLUTTER_CONTENT (content));
+}
+
+/**
+ * st_image_content_get_n_frames:
+ * @content: a #StImageContent
+ *
+ * Gets the number of frames of a sprite sheet, as loaded with
+ * st_texture_cache_load_sprite_sheet().
+ *
+ * Returns: the number of frames, or 0 if @content isn't a sprite sheet
+ */
+int
+st_image_content_get_n_frames (StImageContent *content)
+{
+  StImageContentPrivate *priv;
+
+  g_return_val_if_fail (ST_IS_IMAGE_CONTENT (content), 0);
+
+  priv = st_image_content_get_instance_private (content);
+  return priv->n_frames;
+}
+
+/**
+ * st_image_content_set_frame:
+ * @content: a #StImageContent
+ * @frame: the frame to paint, counting row by row from the top left
+ *
+ * Sets the frame of a sprite sheet that @content paints. Frames past
+ * the last one wrap around.
+ */
+void
+st_image_content_set_frame (StImageContent *content,
+                            int             frame)
+{
+  StImageContentPrivate *priv;
+  float frame_width, frame_height;
+
+  g_return_if_fail (ST_IS_IMAGE_CONTENT (content));
+  g_return_if_fail (frame >= 0);
+
+  priv = st_image_content_get_instance_private (content);
+  g_return_if_fail (priv->n_frames > 0);
+
+  frame %= priv->n_frames;
+  frame_width = priv->atlas_region.size.width;
+  frame_height = priv->atlas_region.size.height;
+
+  graphene_rect_init (&priv->atlas_region,
+                      (frame % priv->n_frame_columns) * frame_width,
+                      (frame / priv->n_frame_columns) * frame_height,
+                      frame_width, frame_height);
+
+  clutter_content_invalidate (CLUTTER_CONTENT (content));
+}
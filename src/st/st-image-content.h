@@ -30,4 +30,8 @@ G_DECLARE_FINAL_TYPE (StImageContent, st_image_content,
 ClutterContent *st_image_content_new_with_preferred_size (int width,
                                                           int height);
 
+int             st_image_content_get_n_frames            (StImageContent *content);
+void            st_image_content_set_frame               (StImageContent *content,
+                                                          int             frame);
+
 #endif /* __ST_IMAGE_CONTENT_H__ */
@@ -71,6 +71,21 @@ struct _StLabelPrivate
 
 G_DEFINE_TYPE_WITH_PRIVATE (StLabel, st_label, ST_TYPE_WIDGET);
 
+/* Text shadows are expensive to create, since the text has to be painted
+ * offscreen and blurred; the most recently used ones are kept around for
+ * labels cycling through the same texts, like clocks and OSD values.
+ */
+#define SHADOW_CACHE_SIZE 32
+
+typedef struct
+{
+  char *key;
+  CoglPipeline *pipeline;
+} StLabelShadow;
+
+static GHashTable *shadow_cache = NULL;
+static GQueue shadow_cache_lru = G_QUEUE_INIT;
+
 static GType st_label_accessible_get_type (void) G_GNUC_CONST;
 
 static void
@@ -204,6 +219,103 @@ st_label_dispose (GObject   *object)
   G_OBJECT_CLASS (st_label_parent_class)->dispose (object);
 }
 
+static void
+st_label_shadow_free (StLabelShadow *shadow)
+{
+  g_free (shadow->key);
+  g_clear_object (&shadow->pipeline);
+  g_free (shadow);
+}
+
+/* Everything the shadow texture depends on, or %NULL if the text is
+ * drawn in ways not covered by it */
+static char *
+st_label_get_shadow_key (StLabel *label,
+                         float    width,
+                         float    height,
+                         float    resource_scale)
+{
+  StLabelPrivate *priv = label->priv;
+  ClutterText *text = CLUTTER_TEXT (priv->label);
+  PangoFontDescription *font_desc;
+  g_autofree char *font = NULL;
+
+  if (clutter_text_get_editable (text) ||
+      clutter_text_get_use_markup (text) ||
+      clutter_text_get_attributes (text) != NULL)
+    return NULL;
+
+  font_desc = clutter_text_get_font_description (text);
+  if (font_desc != NULL)
+    font = pango_font_description_to_string (font_desc);
+
+  return g_strdup_printf ("%s|%g|%g|%gx%g|%d%d%d%d%d|%s",
+                          font ? font : "",
+                          priv->shadow_spec->blur,
+                          resource_scale,
+                          width, height,
+                          clutter_text_get_justify (text),
+                          clutter_text_get_line_alignment (text),
+                          clutter_text_get_ellipsize (text),
+                          clutter_text_get_line_wrap (text),
+                          clutter_text_get_single_line_mode (text),
+                          clutter_text_get_text (text));
+}
+
+static CoglPipeline *
+st_label_create_shadow_pipeline (StLabel *label,
+                                 float    width,
+                                 float    height,
+                                 float    resource_scale)
+{
+  StLabelPrivate *priv = label->priv;
+  g_autofree char *key = NULL;
+  StLabelShadow *shadow;
+  CoglPipeline *pipeline;
+  GList *link;
+
+  key = st_label_get_shadow_key (label, width, height, resource_scale);
+
+  if (key != NULL && shadow_cache != NULL)
+    {
+      link = g_hash_table_lookup (shadow_cache, key);
+      if (link != NULL)
+        {
+          g_queue_unlink (&shadow_cache_lru, link);
+          g_queue_push_head_link (&shadow_cache_lru, link);
+
+          /* The shadow color is set on the pipeline when painting */
+          shadow = link->data;
+          return cogl_pipeline_copy (shadow->pipeline);
+        }
+    }
+
+  pipeline = _st_create_shadow_pipeline_from_actor (priv->shadow_spec,
+                                                    priv->label);
+  if (key == NULL || pipeline == NULL)
+    return pipeline;
+
+  if (G_UNLIKELY (shadow_cache == NULL))
+    shadow_cache = g_hash_table_new (g_str_hash, g_str_equal);
+
+  shadow = g_new0 (StLabelShadow, 1);
+  shadow->key = g_steal_pointer (&key);
+  shadow->pipeline = cogl_pipeline_copy (pipeline);
+
+  g_queue_push_head (&shadow_cache_lru, shadow);
+  g_hash_table_insert (shadow_cache, shadow->key, shadow_cache_lru.head);
+
+  if (shadow_cache_lru.length > SHADOW_CACHE_SIZE)
+    {
+      StLabelShadow *oldest = g_queue_pop_tail (&shadow_cache_lru);
+
+      g_hash_table_remove (shadow_cache, oldest->key);
+      st_label_shadow_free (oldest);
+    }
+
+  return pipeline;
+}
+
 static void
 st_label_paint_node (ClutterActor     *actor,
                      ClutterPaintNode *node)
@@ -235,8 +347,9 @@ st_label_paint_node (ClutterActor     *actor,
           priv->shadow_width = width;
           priv->shadow_height = height;
           priv->text_shadow_pipeline =
-            _st_create_shadow_pipeline_from_actor (priv->shadow_spec,
-                                                   priv->label);
+            st_label_create_shadow_pipeline (ST_LABEL (actor),
+                                             width, height,
+                                             resource_scale);
         }
 
       if (priv->text_shadow_pipeline != NULL)
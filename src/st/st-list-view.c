@@ -0,0 +1,717 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-list-view.c: scrollable list that only realizes visible rows
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * SECTION:st-list-view
+ * @short_description: a scrollable list of model items
+ *
+ * #StListView shows the items of a #GListModel as a vertical list of
+ * rows, and is meant to be put into a #StScrollView. Unlike a #StBoxLayout
+ * with one child per item, it only keeps actors for the rows intersecting
+ * the visible page, plus #StListView:overscan rows on either side. Rows
+ * that scroll out of view are hidden and handed to the factory function
+ * again for the next item that comes into view, so memory and layout cost
+ * are proportional to the size of the page rather than to the size of
+ * the model.
+ *
+ * All rows are expected to have the same height; it is taken from the
+ * first realized row.
+ */
+
+#include <math.h>
+
+#include "st-list-view.h"
+
+#include "st-private.h"
+#include "st-scrollable.h"
+
+#define DEFAULT_OVERSCAN 4
+
+struct _StListView
+{
+  StViewport parent;
+
+  GListModel *model;
+  StListViewFactoryFunc factory;
+  gpointer factory_data;
+  GDestroyNotify factory_notify;
+
+  StAdjustment *vadjustment;
+
+  /* rows[i] shows the item at first_row + i, and may be NULL if the
+   * factory failed. Hidden rows waiting to be reused are in pool. */
+  GPtrArray *rows;
+  GPtrArray *pool;
+  guint first_row;
+
+  guint overscan;
+
+  float row_height;
+  float row_min_width;
+  float row_width;
+  float page_height;
+
+  guint in_allocate : 1;
+};
+
+enum {
+  PROP_0,
+
+  PROP_MODEL,
+  PROP_OVERSCAN,
+
+  N_PROPS
+};
+
+static GParamSpec *props[N_PROPS] = { NULL, };
+
+G_DEFINE_TYPE (StListView, st_list_view, ST_TYPE_VIEWPORT)
+
+static guint
+get_n_items (StListView *view)
+{
+  return view->model ? g_list_model_get_n_items (view->model) : 0;
+}
+
+static void
+release_row (StListView   *view,
+             ClutterActor *row)
+{
+  clutter_actor_hide (row);
+  g_ptr_array_add (view->pool, row);
+}
+
+static ClutterActor *
+bind_row (StListView *view,
+          guint       position)
+{
+  g_autoptr (GObject) item = NULL;
+  ClutterActor *row = NULL;
+  ClutterActor *result;
+
+  if (view->pool->len > 0)
+    row = g_ptr_array_steal_index_fast (view->pool, view->pool->len - 1);
+
+  item = g_list_model_get_item (view->model, position);
+  result = view->factory (row, item, view->factory_data);
+
+  if (row != NULL && row != result)
+    clutter_actor_destroy (row);
+
+  g_return_val_if_fail (CLUTTER_IS_ACTOR (result), NULL);
+
+  if (clutter_actor_get_parent (result) != CLUTTER_ACTOR (view))
+    clutter_actor_add_child (CLUTTER_ACTOR (view), result);
+
+  clutter_actor_show (result);
+
+  return result;
+}
+
+/* Rows showing items from @index on no longer show the right item */
+static void
+release_rows_from (StListView *view,
+                   guint       index)
+{
+  guint i;
+
+  for (i = index; i < view->rows->len; i++)
+    {
+      ClutterActor *row = g_ptr_array_index (view->rows, i);
+
+      if (row != NULL)
+        release_row (view, row);
+    }
+
+  if (index < view->rows->len)
+    g_ptr_array_set_size (view->rows, index);
+}
+
+static void
+measure_rows (StListView *view,
+              float       for_width)
+{
+  ClutterActor *sample = NULL;
+  guint i;
+
+  view->row_height = 0;
+  view->row_min_width = 0;
+  view->row_width = 0;
+
+  if (get_n_items (view) == 0)
+    return;
+
+  for (i = 0; i < view->rows->len && sample == NULL; i++)
+    sample = g_ptr_array_index (view->rows, i);
+
+  if (sample == NULL && view->pool->len > 0)
+    sample = g_ptr_array_index (view->pool, 0);
+
+  if (sample == NULL)
+    {
+      sample = bind_row (view, 0);
+      if (sample == NULL)
+        return;
+
+      release_row (view, sample);
+    }
+
+  clutter_actor_get_preferred_width (sample, -1,
+                                     &view->row_min_width,
+                                     &view->row_width);
+  clutter_actor_get_preferred_height (sample,
+                                      for_width >= 0 ? for_width : view->row_width,
+                                      NULL, &view->row_height);
+}
+
+static void
+get_visible_range (StListView *view,
+                   guint       overscan,
+                   guint      *first,
+                   guint      *last)
+{
+  double value, page_height;
+  guint n_items;
+
+  n_items = get_n_items (view);
+
+  if (view->row_height <= 0 || n_items == 0)
+    {
+      *first = *last = 0;
+      return;
+    }
+
+  value = view->vadjustment ? st_adjustment_get_value (view->vadjustment) : 0;
+  page_height = view->page_height;
+
+  *first = MIN (floor (value / view->row_height), n_items);
+  *first = *first > overscan ? *first - overscan : 0;
+
+  *last = ceil ((value + page_height) / view->row_height) + overscan;
+  *last = MIN (*last, n_items);
+}
+
+static void
+update_rows (StListView *view,
+             guint       first,
+             guint       last)
+{
+  g_autoptr (GPtrArray) rows = NULL;
+  guint i;
+
+  rows = g_ptr_array_sized_new (last - first);
+  g_ptr_array_set_size (rows, last - first);
+
+  for (i = 0; i < view->rows->len; i++)
+    {
+      ClutterActor *row = g_ptr_array_index (view->rows, i);
+      guint position = view->first_row + i;
+
+      if (row == NULL)
+        continue;
+
+      if (position >= first && position < last)
+        g_ptr_array_index (rows, position - first) = row;
+      else
+        release_row (view, row);
+    }
+
+  g_ptr_array_set_size (view->rows, 0);
+
+  for (i = 0; i < rows->len; i++)
+    {
+      if (g_ptr_array_index (rows, i) == NULL)
+        g_ptr_array_index (rows, i) = bind_row (view, first + i);
+    }
+
+  g_ptr_array_unref (view->rows);
+  view->rows = g_steal_pointer (&rows);
+  view->first_row = first;
+}
+
+static void
+adjustment_value_notify_cb (StAdjustment *adjustment,
+                            GParamSpec   *pspec,
+                            StListView   *view)
+{
+  guint first, last;
+
+  if (view->in_allocate)
+    return;
+
+  /* Only go through a relayout once rows that aren't realized come into
+   * view, scrolling within the overscan just moves the existing ones */
+  get_visible_range (view, 0, &first, &last);
+
+  if (first < view->first_row || last > view->first_row + view->rows->len)
+    clutter_actor_queue_relayout (CLUTTER_ACTOR (view));
+}
+
+static void
+vadjustment_notify_cb (StListView *view,
+                       GParamSpec *pspec,
+                       gpointer    data)
+{
+  StAdjustment *vadjustment;
+
+  st_scrollable_get_adjustments (ST_SCROLLABLE (view), NULL, &vadjustment);
+
+  if (vadjustment == view->vadjustment)
+    return;
+
+  if (view->vadjustment)
+    {
+      g_signal_handlers_disconnect_by_func (view->vadjustment,
+                                            adjustment_value_notify_cb,
+                                            view);
+      g_clear_object (&view->vadjustment);
+    }
+
+  if (vadjustment)
+    {
+      view->vadjustment = g_object_ref (vadjustment);
+      g_signal_connect (vadjustment, "notify::value",
+                        G_CALLBACK (adjustment_value_notify_cb),
+                        view);
+    }
+
+  clutter_actor_queue_relayout (CLUTTER_ACTOR (view));
+}
+
+static void
+items_changed_cb (GListModel *model,
+                  guint       position,
+                  guint       removed,
+                  guint       added,
+                  StListView *view)
+{
+  release_rows_from (view,
+                     position > view->first_row ? position - view->first_row : 0);
+
+  clutter_actor_queue_relayout (CLUTTER_ACTOR (view));
+}
+
+static void
+clear_rows (StListView *view)
+{
+  g_ptr_array_set_size (view->rows, 0);
+  g_ptr_array_set_size (view->pool, 0);
+  view->first_row = 0;
+
+  clutter_actor_destroy_all_children (CLUTTER_ACTOR (view));
+}
+
+static void
+st_list_view_get_preferred_width (ClutterActor *actor,
+                                  float         for_height,
+                                  float        *min_width_p,
+                                  float        *natural_width_p)
+{
+  StListView *view = ST_LIST_VIEW (actor);
+  StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (actor));
+  float min_width, natural_width;
+
+  st_theme_node_adjust_for_height (theme_node, &for_height);
+
+  if (view->row_height <= 0)
+    measure_rows (view, -1);
+
+  min_width = view->row_min_width;
+  natural_width = view->row_width;
+
+  st_theme_node_adjust_preferred_width (theme_node, &min_width, &natural_width);
+
+  if (min_width_p)
+    *min_width_p = min_width;
+
+  if (natural_width_p)
+    *natural_width_p = natural_width;
+}
+
+static void
+st_list_view_get_preferred_height (ClutterActor *actor,
+                                   float         for_width,
+                                   float        *min_height_p,
+                                   float        *natural_height_p)
+{
+  StListView *view = ST_LIST_VIEW (actor);
+  StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (actor));
+  float height;
+
+  st_theme_node_adjust_for_width (theme_node, &for_width);
+
+  measure_rows (view, for_width);
+  height = get_n_items (view) * view->row_height;
+
+  st_theme_node_adjust_preferred_height (theme_node, &height, NULL);
+
+  if (min_height_p)
+    *min_height_p = height;
+
+  if (natural_height_p)
+    *natural_height_p = height;
+}
+
+static void
+st_list_view_allocate (ClutterActor          *actor,
+                       const ClutterActorBox *box)
+{
+  StListView *view = ST_LIST_VIEW (actor);
+  StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (actor));
+  StAdjustment *hadjustment;
+  ClutterActorBox content_box;
+  float avail_width, avail_height, content_height;
+  guint first, last, i;
+
+  clutter_actor_set_allocation (actor, box);
+
+  st_theme_node_get_content_box (theme_node, box, &content_box);
+  clutter_actor_box_get_size (&content_box, &avail_width, &avail_height);
+
+  view->in_allocate = TRUE;
+
+  measure_rows (view, avail_width);
+  view->page_height = avail_height;
+  content_height = get_n_items (view) * view->row_height;
+
+  /* update adjustments for scrolling */
+  if (view->vadjustment)
+    {
+      double prev_value;
+
+      prev_value = st_adjustment_get_value (view->vadjustment);
+
+      st_adjustment_set_values (view->vadjustment,
+                                prev_value,
+                                0.0,
+                                MAX (content_height, avail_height),
+                                view->row_height > 0 ? view->row_height
+                                                     : avail_height / 6,
+                                avail_height - avail_height / 6,
+                                avail_height);
+    }
+
+  /* Rows always span the whole width */
+  st_scrollable_get_adjustments (ST_SCROLLABLE (view), &hadjustment, NULL);
+  if (hadjustment)
+    st_adjustment_set_values (hadjustment,
+                              0.0, 0.0,
+                              avail_width,
+                              avail_width / 6,
+                              avail_width - avail_width / 6,
+                              avail_width);
+
+  view->in_allocate = FALSE;
+
+  get_visible_range (view, view->overscan, &first, &last);
+  update_rows (view, first, last);
+
+  for (i = 0; i < view->rows->len; i++)
+    {
+      ClutterActor *row = g_ptr_array_index (view->rows, i);
+      ClutterActorBox child_box;
+
+      if (row == NULL)
+        continue;
+
+      child_box.x1 = content_box.x1;
+      child_box.x2 = content_box.x2;
+      child_box.y1 = content_box.y1 + (first + i) * view->row_height;
+      child_box.y2 = child_box.y1 + view->row_height;
+
+      clutter_actor_allocate (row, &child_box);
+    }
+}
+
+static void
+st_list_view_child_removed (ClutterActor *container,
+                            ClutterActor *actor)
+{
+  StListView *view = ST_LIST_VIEW (container);
+  guint index;
+
+  if (g_ptr_array_find (view->pool, actor, &index))
+    g_ptr_array_remove_index_fast (view->pool, index);
+  else if (g_ptr_array_find (view->rows, actor, &index))
+    g_ptr_array_index (view->rows, index) = NULL;
+}
+
+static void
+st_list_view_get_property (GObject    *object,
+                           guint       property_id,
+                           GValue     *value,
+                           GParamSpec *pspec)
+{
+  StListView *view = ST_LIST_VIEW (object);
+
+  switch (property_id)
+    {
+    case PROP_MODEL:
+      g_value_set_object (value, view->model);
+      break;
+
+    case PROP_OVERSCAN:
+      g_value_set_uint (value, view->overscan);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+st_list_view_set_property (GObject      *object,
+                           guint         property_id,
+                           const GValue *value,
+                           GParamSpec   *pspec)
+{
+  StListView *view = ST_LIST_VIEW (object);
+
+  switch (property_id)
+    {
+    case PROP_OVERSCAN:
+      st_list_view_set_overscan (view, g_value_get_uint (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+    }
+}
+
+static void
+st_list_view_dispose (GObject *object)
+{
+  StListView *view = ST_LIST_VIEW (object);
+
+  st_list_view_set_model (view, NULL, NULL, NULL, NULL);
+
+  if (view->vadjustment)
+    {
+      g_signal_handlers_disconnect_by_func (view->vadjustment,
+                                            adjustment_value_notify_cb,
+                                            view);
+      g_clear_object (&view->vadjustment);
+    }
+
+  G_OBJECT_CLASS (st_list_view_parent_class)->dispose (object);
+}
+
+static void
+st_list_view_finalize (GObject *object)
+{
+  StListView *view = ST_LIST_VIEW (object);
+
+  g_ptr_array_unref (view->rows);
+  g_ptr_array_unref (view->pool);
+
+  G_OBJECT_CLASS (st_list_view_parent_class)->finalize (object);
+}
+
+static void
+st_list_view_class_init (StListViewClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  ClutterActorClass *actor_class = CLUTTER_ACTOR_CLASS (klass);
+
+  object_class->get_property = st_list_view_get_property;
+  object_class->set_property = st_list_view_set_property;
+  object_class->dispose = st_list_view_dispose;
+  object_class->finalize = st_list_view_finalize;
+
+  actor_class->get_preferred_width = st_list_view_get_preferred_width;
+  actor_class->get_preferred_height = st_list_view_get_preferred_height;
+  actor_class->allocate = st_list_view_allocate;
+  actor_class->child_removed = st_list_view_child_removed;
+
+  /**
+   * StListView:model:
+   *
+   * The #GListModel whose items are shown.
+   */
+  props[PROP_MODEL] =
+    g_param_spec_object ("model",
+                         "Model",
+                         "The model whose items are shown",
+                         G_TYPE_LIST_MODEL,
+                         ST_PARAM_READABLE);
+
+  /**
+   * StListView:overscan:
+   *
+   * The number of rows realized above and below the visible page, so
+   * that scrolling by a few rows doesn't need to set up new ones.
+   */
+  props[PROP_OVERSCAN] =
+    g_param_spec_uint ("overscan",
+                       "Overscan",
+                       "Number of rows realized outside of the visible page",
+                       0, G_MAXUINT, DEFAULT_OVERSCAN,
+                       ST_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
+  g_object_class_install_properties (object_class, N_PROPS, props);
+}
+
+static void
+st_list_view_init (StListView *view)
+{
+  view->rows = g_ptr_array_new ();
+  view->pool = g_ptr_array_new ();
+  view->overscan = DEFAULT_OVERSCAN;
+
+  g_signal_connect (view, "notify::vadjustment",
+                    G_CALLBACK (vadjustment_notify_cb), NULL);
+}
+
+/**
+ * st_list_view_new:
+ *
+ * Creates a new, empty #StListView.
+ *
+ * Returns: a new #StListView
+ */
+StWidget *
+st_list_view_new (void)
+{
+  return g_object_new (ST_TYPE_LIST_VIEW, NULL);
+}
+
+/**
+ * st_list_view_set_model:
+ * @view: a #StListView
+ * @model: (nullable): a #GListModel
+ * @factory: (nullable): function setting up the row for an item
+ * @user_data: data passed to @factory
+ * @notify: function called on @user_data when the model is replaced
+ *
+ * Shows the items of @model, using @factory to create rows for them and
+ * to update rows that went out of view to show a different item.
+ * Any rows created for the previous model are destroyed.
+ */
+void
+st_list_view_set_model (StListView            *view,
+                        GListModel            *model,
+                        StListViewFactoryFunc  factory,
+                        gpointer               user_data,
+                        GDestroyNotify         notify)
+{
+  g_return_if_fail (ST_IS_LIST_VIEW (view));
+  g_return_if_fail (model == NULL || G_IS_LIST_MODEL (model));
+  g_return_if_fail (model == NULL || factory != NULL);
+
+  if (view->model)
+    {
+      g_signal_handlers_disconnect_by_func (view->model,
+                                            items_changed_cb,
+                                            view);
+      g_clear_object (&view->model);
+    }
+
+  if (view->factory_notify)
+    view->factory_notify (view->factory_data);
+
+  clear_rows (view);
+
+  view->factory = factory;
+  view->factory_data = user_data;
+  view->factory_notify = notify;
+  view->row_height = 0;
+
+  if (model)
+    {
+      view->model = g_object_ref (model);
+      g_signal_connect (model, "items-changed",
+                        G_CALLBACK (items_changed_cb), view);
+    }
+
+  clutter_actor_queue_relayout (CLUTTER_ACTOR (view));
+  g_object_notify_by_pspec (G_OBJECT (view), props[PROP_MODEL]);
+}
+
+/**
+ * st_list_view_get_model:
+ * @view: a #StListView
+ *
+ * Returns: (transfer none) (nullable): the model shown by @view
+ */
+GListModel *
+st_list_view_get_model (StListView *view)
+{
+  g_return_val_if_fail (ST_IS_LIST_VIEW (view), NULL);
+
+  return view->model;
+}
+
+/**
+ * st_list_view_set_overscan:
+ * @view: a #StListView
+ * @overscan: the number of rows
+ *
+ * Sets the number of rows realized above and below the visible page.
+ */
+void
+st_list_view_set_overscan (StListView *view,
+                           guint       overscan)
+{
+  g_return_if_fail (ST_IS_LIST_VIEW (view));
+
+  if (view->overscan == overscan)
+    return;
+
+  view->overscan = overscan;
+
+  clutter_actor_queue_relayout (CLUTTER_ACTOR (view));
+  g_object_notify_by_pspec (G_OBJECT (view), props[PROP_OVERSCAN]);
+}
+
+/**
+ * st_list_view_get_overscan:
+ * @view: a #StListView
+ *
+ * Returns: the number of rows realized above and below the visible page
+ */
+guint
+st_list_view_get_overscan (StListView *view)
+{
+  g_return_val_if_fail (ST_IS_LIST_VIEW (view), 0);
+
+  return view->overscan;
+}
+
+/**
+ * st_list_view_scroll_to:
+ * @view: a #StListView
+ * @position: the position of an item in the model
+ *
+ * Scrolls as little as necessary for the row at @position to be
+ * fully visible.
+ */
+void
+st_list_view_scroll_to (StListView *view,
+                        guint       position)
+{
+  g_return_if_fail (ST_IS_LIST_VIEW (view));
+
+  if (view->vadjustment == NULL || position >= get_n_items (view))
+    return;
+
+  if (view->row_height <= 0)
+    measure_rows (view, -1);
+
+  st_adjustment_clamp_page (view->vadjustment,
+                            position * view->row_height,
+                            (position + 1) * view->row_height);
+}
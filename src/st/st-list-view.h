@@ -0,0 +1,63 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-list-view.h: scrollable list that only realizes visible rows
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU Lesser General Public License,
+ * version 2.1, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined(ST_H_INSIDE) && !defined(ST_COMPILATION)
+#error "Only <st/st.h> can be included directly.h"
+#endif
+
+#pragma once
+
+#include <gio/gio.h>
+#include <st/st-viewport.h>
+
+G_BEGIN_DECLS
+
+#define ST_TYPE_LIST_VIEW (st_list_view_get_type ())
+G_DECLARE_FINAL_TYPE (StListView, st_list_view, ST, LIST_VIEW, StViewport)
+
+/**
+ * StListViewFactoryFunc:
+ * @row: (nullable): a row that went out of view and can be reused, or %NULL
+ * @item: (type GObject): the item of the model to show
+ * @user_data: data passed to st_list_view_set_model()
+ *
+ * Sets up a row showing @item. If @row is not %NULL, the function should
+ * update and return it; returning a different actor destroys @row.
+ *
+ * Returns: (transfer none): the row showing @item
+ */
+typedef ClutterActor * (* StListViewFactoryFunc) (ClutterActor *row,
+                                                  GObject      *item,
+                                                  gpointer      user_data);
+
+StWidget   *st_list_view_new          (void);
+
+void        st_list_view_set_model    (StListView            *view,
+                                       GListModel            *model,
+                                       StListViewFactoryFunc  factory,
+                                       gpointer               user_data,
+                                       GDestroyNotify         notify);
+GListModel *st_list_view_get_model    (StListView            *view);
+
+void        st_list_view_set_overscan (StListView            *view,
+                                       guint                  overscan);
+guint       st_list_view_get_overscan (StListView            *view);
+
+void        st_list_view_scroll_to    (StListView            *view,
+                                       guint                  position);
+
+G_END_DECLS
@@ -114,6 +114,7 @@ _st_set_text_from_style (ClutterText *text,
   CoglColor color;
   StTextDecoration decoration;
   PangoAttrList *attribs = NULL;
+  PangoAttrList *old_attribs;
   const PangoFontDescription *font;
   PangoAttribute *foreground;
   StTextAlign align;
@@ -179,7 +180,12 @@ _st_set_text_from_style (ClutterText *text,
       g_free (font_features);
     }
 
-  clutter_text_set_attributes (text, attribs);
+  /* Setting attributes drops the layouts ClutterText cached, and most
+   * style changes (like :hover) don't change them, so avoid shaping the
+   * text again for nothing */
+  old_attribs = clutter_text_get_attributes (text);
+  if (old_attribs == NULL || !pango_attr_list_equal (old_attribs, attribs))
+    clutter_text_set_attributes (text, attribs);
 
   if (attribs)
     pango_attr_list_unref (attribs);
@@ -239,19 +245,26 @@ _st_create_texture_pipeline (CoglTexture *src_texture)
  * Shadows
  *****/
 
-static gdouble *
+/* Kernel weights are fixed-point with BLUR_KERNEL_SHIFT fractional bits;
+ * a full kernel applied to 8-bit values still fits in 32 bits. */
+#define BLUR_KERNEL_SHIFT 16
+#define BLUR_KERNEL_ONE (1 << BLUR_KERNEL_SHIFT)
+
+static guint32 *
 calculate_gaussian_kernel (gdouble   sigma,
                            guint     n_values)
 {
-  gdouble *ret, sum;
+  g_autofree gdouble *values = NULL;
+  gdouble sum;
   gdouble exp_divisor;
+  guint32 *ret, total;
   int half, i;
 
   g_return_val_if_fail (sigma > 0, NULL);
 
   half = n_values / 2;
 
-  ret = g_malloc (n_values * sizeof (gdouble));
+  values = g_new (gdouble, n_values);
   sum = 0.0;
 
   exp_divisor = 2 * sigma * sigma;
@@ -259,17 +272,51 @@ calculate_gaussian_kernel (gdouble   sigma,
   /* n_values of 1D Gauss function */
   for (i = 0; i < (int)n_values; i++)
     {
-      ret[i] = exp (-(i - half) * (i - half) / exp_divisor);
-      sum += ret[i];
+      values[i] = exp (-(i - half) * (i - half) / exp_divisor);
+      sum += values[i];
     }
 
-  /* normalize */
+  /* normalize, and give the rounding error to the center so that
+   * the weights add up to exactly one */
+  ret = g_new (guint32, n_values);
+  total = 0;
+
   for (i = 0; i < (int)n_values; i++)
-    ret[i] /= sum;
+    {
+      ret[i] = (guint32) (values[i] / sum * BLUR_KERNEL_ONE + 0.5);
+      total += ret[i];
+    }
+
+  ret[half] += BLUR_KERNEL_ONE - total;
 
   return ret;
 }
 
+/* The convolution is done a row at a time into an accumulator, so both
+ * passes run over contiguous memory and the inner loops vectorize */
+static inline void
+blur_accumulate_row (guint32      *acc,
+                     const guchar *row,
+                     guint32       weight,
+                     gint          n)
+{
+  gint x;
+
+  for (x = 0; x < n; x++)
+    acc[x] += row[x] * weight;
+}
+
+static inline void
+blur_store_row (guchar        *row,
+                const guint32 *acc,
+                gint           n)
+{
+  gint x;
+
+  for (x = 0; x < n; x++)
+    row[x] = (acc[x] + BLUR_KERNEL_ONE / 2) >> BLUR_KERNEL_SHIFT;
+}
+
 static guchar *
 blur_pixels (guchar  *pixels_in,
              gint     width_in,
@@ -299,10 +346,11 @@ blur_pixels (guchar  *pixels_in,
     }
   else
     {
-      gdouble *kernel;
+      guint32 *kernel;
+      guint32 *acc;
       guchar  *line;
       gint     n_values, half;
-      gint     x_in, y_in, x_out, y_out, i;
+      gint     y_in, y_out, i;
 
       n_values = (gint) 5 * sigma;
       half = n_values / 2;
@@ -312,98 +360,169 @@ blur_pixels (guchar  *pixels_in,
       *rowstride_out = (*width_out + 3) & ~3;
 
       pixels_out = g_malloc0 (*rowstride_out * *height_out);
-      line       = g_malloc0 (*rowstride_out);
+      /* A row of the output padded with 'half' transparent pixels
+       * on each side */
+      line       = g_malloc0 (*width_out + 2 * half);
+      acc        = g_new (guint32, *width_out);
 
       kernel = calculate_gaussian_kernel (sigma, n_values);
 
       /* vertical blur */
-      for (x_in = 0; x_in < width_in; x_in++)
-        for (y_out = 0; y_out < *height_out; y_out++)
-          {
-            guchar *pixel_in, *pixel_out;
-            gint i0, i1;
-
-            y_in = y_out - half;
-
-            /* We read from the source at 'y = y_in + i - half'; clamp the
-             * full i range [0, n_values) so that y is in [0, height_in).
-             */
-            i0 = MAX (half - y_in, 0);
-            i1 = MIN (height_in + half - y_in, n_values);
-
-            pixel_in  =  pixels_in + (y_in + i0 - half) * rowstride_in + x_in;
-            pixel_out =  pixels_out + y_out * *rowstride_out + (x_in + half);
-
-            for (i = i0; i < i1; i++)
-              {
-                *pixel_out += *pixel_in * kernel[i];
-                pixel_in += rowstride_in;
-              }
-          }
+      for (y_out = 0; y_out < *height_out; y_out++)
+        {
+          gint i0, i1;
+
+          y_in = y_out - half;
+
+          /* We read from the source at 'y = y_in + i - half'; clamp the
+           * full i range [0, n_values) so that y is in [0, height_in).
+           */
+          i0 = MAX (half - y_in, 0);
+          i1 = MIN (height_in + half - y_in, n_values);
+
+          memset (acc, 0, width_in * sizeof (guint32));
+
+          for (i = i0; i < i1; i++)
+            blur_accumulate_row (acc,
+                                 pixels_in + (y_in + i - half) * rowstride_in,
+                                 kernel[i], width_in);
+
+          blur_store_row (pixels_out + y_out * *rowstride_out + half,
+                          acc, width_in);
+        }
 
       /* horizontal blur */
       for (y_out = 0; y_out < *height_out; y_out++)
         {
-          memcpy (line, pixels_out + y_out * *rowstride_out, *rowstride_out);
-
-          for (x_out = 0; x_out < *width_out; x_out++)
-            {
-              gint i0, i1;
-              guchar *pixel_out, *pixel_in;
-
-              /* We read from the source at 'x = x_out + i - half'; clamp the
-               * full i range [0, n_values) so that x is in [0, width_out).
-               */
-              i0 = MAX (half - x_out, 0);
-              i1 = MIN (*width_out + half - x_out, n_values);
-
-              pixel_in  = line + x_out + i0 - half;
-              pixel_out = pixels_out + *rowstride_out * y_out + x_out;
-
-              *pixel_out = 0;
-              for (i = i0; i < i1; i++)
-                {
-                  *pixel_out += *pixel_in * kernel[i];
-                  pixel_in++;
-                }
-            }
+          guchar *row_out = pixels_out + y_out * *rowstride_out;
+
+          /* We read from the source at 'x = x_out + i - half', which is
+           * 'x_out + i' in the padded line.
+           */
+          memcpy (line + half, row_out, *width_out);
+          memset (acc, 0, *width_out * sizeof (guint32));
+
+          for (i = 0; i < n_values; i++)
+            blur_accumulate_row (acc, line + i, kernel[i], *width_out);
+
+          blur_store_row (row_out, acc, *width_out);
         }
+
       g_free (kernel);
+      g_free (acc);
       g_free (line);
     }
 
   return pixels_out;
 }
 
-CoglPipeline *
-_st_create_shadow_pipeline (StShadow    *shadow_spec,
-                            CoglTexture *src_texture,
-                            float        resource_scale)
+/* Blurred shadow textures are shared between all shadows with the same
+ * blur radius created from the same source texture; the color, offset
+ * and spread only come into play when painting. An entry lives as long
+ * as its source texture.
+ */
+typedef struct {
+  CoglTexture *source;
+  float radius;
+  CoglTexture *texture;
+} StShadowCacheEntry;
+
+static GHashTable *shadow_cache = NULL;
+
+static guint
+shadow_cache_entry_hash (gconstpointer data)
+{
+  const StShadowCacheEntry *entry = data;
+  gint radius = (gint) roundf (entry->radius * 100);
+
+  return g_direct_hash (entry->source) ^ g_int_hash (&radius);
+}
+
+static gboolean
+shadow_cache_entry_equal (gconstpointer a,
+                          gconstpointer b)
+{
+  const StShadowCacheEntry *entry_a = a;
+  const StShadowCacheEntry *entry_b = b;
+
+  return entry_a->source == entry_b->source &&
+         entry_a->radius == entry_b->radius;
+}
+
+static void
+shadow_cache_entry_free (StShadowCacheEntry *entry)
+{
+  g_clear_object (&entry->texture);
+  g_free (entry);
+}
+
+static void
+on_shadow_source_finalized (gpointer  data,
+                            GObject  *where_the_object_was)
+{
+  StShadowCacheEntry *entry = data;
+
+  /* The source pointer is only used as a key from here on */
+  g_hash_table_remove (shadow_cache, entry);
+}
+
+static CoglTexture *
+shadow_cache_lookup (CoglTexture *source,
+                     float        radius)
+{
+  StShadowCacheEntry key = { source, radius, NULL };
+  StShadowCacheEntry *entry;
+
+  if (shadow_cache == NULL)
+    return NULL;
+
+  entry = g_hash_table_lookup (shadow_cache, &key);
+
+  return entry ? entry->texture : NULL;
+}
+
+static void
+shadow_cache_insert (CoglTexture *source,
+                     float        radius,
+                     CoglTexture *texture)
+{
+  StShadowCacheEntry *entry;
+
+  if (G_UNLIKELY (shadow_cache == NULL))
+    shadow_cache = g_hash_table_new_full (shadow_cache_entry_hash,
+                                          shadow_cache_entry_equal,
+                                          (GDestroyNotify) shadow_cache_entry_free,
+                                          NULL);
+
+  entry = g_new0 (StShadowCacheEntry, 1);
+  entry->source = source;
+  entry->radius = radius;
+  entry->texture = g_object_ref (texture);
+
+  g_object_weak_ref (G_OBJECT (source), on_shadow_source_finalized, entry);
+  g_hash_table_add (shadow_cache, entry);
+}
+
+static CoglTexture *
+create_shadow_texture (CoglContext *ctx,
+                       CoglTexture *src_texture,
+                       float        radius)
 {
-  ClutterBackend *backend = clutter_get_default_backend ();
-  CoglContext *ctx = clutter_backend_get_cogl_context (backend);
   g_autoptr (ClutterPaintNode) texture_node = NULL;
   g_autoptr (ClutterPaintNode) blur_node = NULL;
   g_autoptr (CoglOffscreen) offscreen = NULL;
   g_autoptr (GError) error = NULL;
   ClutterPaintContext *paint_context;
   CoglFramebuffer *fb;
-  CoglPipeline *pipeline;
   CoglTexture *texture;
   float sampling_radius;
-  float radius;
   int src_height, dst_height;
   int src_width, dst_width;
   CoglPipeline *texture_pipeline;
 
   static CoglPipelineKey texture_pipeline_key =
     "st-create-shadow-pipeline-saturate-alpha";
-  static CoglPipeline *shadow_pipeline_template = NULL;
 
-  g_return_val_if_fail (shadow_spec != NULL, NULL);
-  g_return_val_if_fail (src_texture != NULL, NULL);
-
-  radius = resource_scale * shadow_spec->blur;
   sampling_radius = ceilf (radius);
 
   src_width = cogl_texture_get_width (src_texture);
@@ -477,6 +596,43 @@ _st_create_shadow_pipeline (StShadow    *shadow_spec,
   clutter_paint_node_paint (blur_node, paint_context);
   clutter_paint_context_destroy (paint_context);
 
+  return texture;
+}
+
+static CoglPipeline *
+create_shadow_pipeline (StShadow    *shadow_spec,
+                        CoglTexture *src_texture,
+                        float        resource_scale,
+                        gboolean     use_cache)
+{
+  ClutterBackend *backend = clutter_get_default_backend ();
+  CoglContext *ctx = clutter_backend_get_cogl_context (backend);
+  CoglPipeline *pipeline;
+  CoglTexture *texture;
+  float radius;
+
+  static CoglPipeline *shadow_pipeline_template = NULL;
+
+  g_return_val_if_fail (shadow_spec != NULL, NULL);
+  g_return_val_if_fail (src_texture != NULL, NULL);
+
+  radius = resource_scale * shadow_spec->blur;
+
+  texture = use_cache ? shadow_cache_lookup (src_texture, radius) : NULL;
+  if (texture != NULL)
+    {
+      g_object_ref (texture);
+    }
+  else
+    {
+      texture = create_shadow_texture (ctx, src_texture, radius);
+      if (texture == NULL)
+        return NULL;
+
+      if (use_cache)
+        shadow_cache_insert (src_texture, radius, texture);
+    }
+
   if (G_UNLIKELY (shadow_pipeline_template == NULL))
     {
       shadow_pipeline_template = cogl_pipeline_new (ctx);
@@ -497,6 +653,14 @@ _st_create_shadow_pipeline (StShadow    *shadow_spec,
   return pipeline;
 }
 
+CoglPipeline *
+_st_create_shadow_pipeline (StShadow    *shadow_spec,
+                            CoglTexture *src_texture,
+                            float        resource_scale)
+{
+  return create_shadow_pipeline (shadow_spec, src_texture, resource_scale, TRUE);
+}
+
 CoglPipeline *
 _st_create_shadow_pipeline_from_actor (StShadow     *shadow_spec,
                                        ClutterActor *actor)
@@ -580,9 +744,11 @@ _st_create_shadow_pipeline_from_actor (StShadow     *shadow_spec,
 
       g_object_unref (fb);
 
-      shadow_pipeline = _st_create_shadow_pipeline (shadow_spec,
-                                                    g_steal_pointer (&buffer),
-                                                    resource_scale);
+      /* The offscreen buffer is never shared, so don't cache its shadow */
+      shadow_pipeline = create_shadow_pipeline (shadow_spec,
+                                                g_steal_pointer (&buffer),
+                                                resource_scale,
+                                                FALSE);
     }
 
   return shadow_pipeline;
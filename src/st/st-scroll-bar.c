@@ -703,6 +703,9 @@ handle_button_press_event_cb (ClutterActor *actor,
 
   st_widget_add_style_pseudo_class (ST_WIDGET (priv->handle), "active");
 
+  if (priv->adjustment)
+    st_adjustment_stop_kinetic (priv->adjustment);
+
   /* Account for the scrollbar-trough-handle nesting. */
   priv->x_origin += clutter_actor_get_x (priv->trough);
   priv->y_origin += clutter_actor_get_y (priv->trough);
@@ -854,6 +857,8 @@ trough_button_press_event_cb (ClutterActor *actor,
   if (priv->adjustment == NULL)
     return FALSE;
 
+  st_adjustment_stop_kinetic (priv->adjustment);
+
   clutter_event_get_position (event, &coords);
 
   priv->move_x = coords.x;
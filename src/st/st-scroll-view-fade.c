@@ -26,6 +26,7 @@
 #include "st-theme-node.h"
 #include "st-scroll-bar.h"
 #include "st-scrollable.h"
+#include "st-texture-pool.h"
 
 #include <clutter/clutter.h>
 #include <cogl/cogl.h>
@@ -354,6 +355,14 @@ st_scroll_view_fade_get_property (GObject *object,
     }
 }
 
+static CoglTexture *
+st_scroll_view_fade_create_texture (ClutterOffscreenEffect *effect,
+                                     float                   width,
+                                     float                   height)
+{
+  return st_texture_pool_acquire (MAX (width, 1), MAX (height, 1));
+}
+
 static void
 st_scroll_view_fade_class_init (StScrollViewFadeClass *klass)
 {
@@ -373,6 +382,7 @@ st_scroll_view_fade_class_init (StScrollViewFadeClass *klass)
 
   offscreen_class = CLUTTER_OFFSCREEN_EFFECT_CLASS (klass);
   offscreen_class->paint_target = st_scroll_view_fade_paint_target;
+  offscreen_class->create_texture = st_scroll_view_fade_create_texture;
 
   /**
    * StScrollViewFade:fade-margins:
@@ -83,10 +83,22 @@ struct _StScrollViewPrivate
   gfloat        row_size;
   gfloat        column_size;
 
+  /* Fading into a solid color by painting over the edges, instead of
+   * through the offscreen fade effect */
+  CoglColor     fade_color;
+  ClutterMargin fade_margins;
+
+  /* Velocities of touchpad scrolling, in units per second */
+  guint32       last_scroll_time;
+  gdouble       hvelocity;
+  gdouble       vvelocity;
+
   guint         row_size_set : 1;
   guint         column_size_set : 1;
   guint         mouse_scroll : 1;
   guint         overlay_scrollbars : 1;
+  guint         kinetic_scroll : 1;
+  guint         fade_overlay : 1;
   guint         hscrollbar_visible : 1;
   guint         vscrollbar_visible : 1;
 };
@@ -107,6 +119,7 @@ enum {
   PROP_VSCROLLBAR_VISIBLE,
   PROP_MOUSE_SCROLL,
   PROP_OVERLAY_SCROLLBARS,
+  PROP_KINETIC_SCROLL,
 
   N_PROPS
 };
@@ -157,6 +170,9 @@ st_scroll_view_get_property (GObject    *object,
     case PROP_OVERLAY_SCROLLBARS:
       g_value_set_boolean (value, priv->overlay_scrollbars);
       break;
+    case PROP_KINETIC_SCROLL:
+      g_value_set_boolean (value, priv->kinetic_scroll);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     }
@@ -174,6 +190,7 @@ void
 st_scroll_view_update_fade_effect (StScrollView  *scroll,
                                    ClutterMargin *fade_margins)
 {
+  StScrollViewPrivate *priv = st_scroll_view_get_instance_private (scroll);
   ClutterEffect *fade_effect =
     clutter_actor_get_effect (CLUTTER_ACTOR (scroll), "fade");
 
@@ -183,9 +200,14 @@ st_scroll_view_update_fade_effect (StScrollView  *scroll,
       fade_effect = NULL;
     }
 
-  /* A fade amount of other than 0 enables the effect. */
-  if (fade_margins->left != 0. || fade_margins->right != 0. ||
-      fade_margins->top != 0. || fade_margins->bottom != 0.)
+  priv->fade_margins = *fade_margins;
+  clutter_actor_queue_redraw (CLUTTER_ACTOR (scroll));
+
+  /* A fade amount of other than 0 enables the effect. The overlay
+   * is painted by st_scroll_view_paint() instead. */
+  if (!priv->fade_overlay &&
+      (fade_margins->left != 0. || fade_margins->right != 0. ||
+       fade_margins->top != 0. || fade_margins->bottom != 0.))
     {
       if (fade_effect == NULL)
         {
@@ -228,6 +250,10 @@ st_scroll_view_set_property (GObject      *object,
       st_scroll_view_set_overlay_scrollbars (self,
                                              g_value_get_boolean (value));
       break;
+    case PROP_KINETIC_SCROLL:
+      st_scroll_view_set_kinetic_scrolling (self,
+                                            g_value_get_boolean (value));
+      break;
     case PROP_HSCROLLBAR_POLICY:
       st_scroll_view_set_policy (self,
                                  g_value_get_enum (value),
@@ -276,6 +302,148 @@ st_scroll_view_dispose (GObject *object)
   G_OBJECT_CLASS (st_scroll_view_parent_class)->dispose (object);
 }
 
+static void
+paint_fade_gradient (CoglFramebuffer *framebuffer,
+                     CoglPipeline    *pipeline,
+                     const CoglColor *color,
+                     float            x1,
+                     float            y1,
+                     float            x2,
+                     float            y2,
+                     gboolean         vertical,
+                     gboolean         opaque_start)
+{
+  g_autoptr (CoglPrimitive) primitive = NULL;
+  CoglContext *ctx = cogl_framebuffer_get_context (framebuffer);
+  CoglVertexP2C4 verts[4];
+  uint8_t start_alpha = opaque_start ? 0xff : 0;
+  uint8_t end_alpha = opaque_start ? 0 : 0xff;
+  int i;
+
+  /* Triangle strip with the start edge first */
+  if (vertical)
+    {
+      verts[0] = (CoglVertexP2C4) { x1, y1 };
+      verts[1] = (CoglVertexP2C4) { x2, y1 };
+      verts[2] = (CoglVertexP2C4) { x1, y2 };
+      verts[3] = (CoglVertexP2C4) { x2, y2 };
+    }
+  else
+    {
+      verts[0] = (CoglVertexP2C4) { x1, y1 };
+      verts[1] = (CoglVertexP2C4) { x1, y2 };
+      verts[2] = (CoglVertexP2C4) { x2, y1 };
+      verts[3] = (CoglVertexP2C4) { x2, y2 };
+    }
+
+  /* The colors are premultiplied, so scaling all components fades */
+  for (i = 0; i < 4; i++)
+    {
+      uint8_t alpha = i < 2 ? start_alpha : end_alpha;
+
+      verts[i].r = color->red * alpha / 0xff;
+      verts[i].g = color->green * alpha / 0xff;
+      verts[i].b = color->blue * alpha / 0xff;
+      verts[i].a = color->alpha * alpha / 0xff;
+    }
+
+  primitive = cogl_primitive_new_p2c4 (ctx, COGL_VERTICES_MODE_TRIANGLE_STRIP,
+                                       G_N_ELEMENTS (verts), verts);
+  cogl_primitive_draw (primitive, framebuffer, pipeline);
+}
+
+static gboolean
+adjustment_needs_fade (StAdjustment *adjustment,
+                       gboolean     *at_start,
+                       gboolean     *at_end)
+{
+  double value, lower, upper, page_size;
+
+  st_adjustment_get_values (adjustment, &value, &lower, &upper, NULL, NULL, &page_size);
+
+  *at_start = value > lower + 0.1;
+  *at_end = value < upper - page_size - 0.1;
+
+  return *at_start || *at_end;
+}
+
+/* For content on a solid background, fading to the background color
+ * gives the same result as the fade effect, without rendering the
+ * whole scroll view offscreen first */
+static void
+paint_fade_overlay (StScrollView    *self,
+                    CoglFramebuffer *framebuffer)
+{
+  StScrollViewPrivate *priv = st_scroll_view_get_instance_private (self);
+  StThemeNode *theme_node = st_widget_get_theme_node (ST_WIDGET (self));
+  static CoglPipeline *pipeline = NULL;
+  ClutterActorBox allocation, box;
+  CoglColor color;
+  gboolean top, bottom, left, right;
+  float h_offset, v_offset;
+
+  if (G_UNLIKELY (pipeline == NULL))
+    pipeline = cogl_pipeline_new (cogl_framebuffer_get_context (framebuffer));
+
+  clutter_actor_get_allocation_box (CLUTTER_ACTOR (self), &allocation);
+  clutter_actor_box_set_origin (&allocation, 0, 0);
+  st_theme_node_get_content_box (theme_node, &allocation, &box);
+
+  st_scroll_view_get_bar_offsets (self, &h_offset, &v_offset);
+  if (clutter_actor_get_text_direction (CLUTTER_ACTOR (self)) == CLUTTER_TEXT_DIRECTION_RTL)
+    box.x1 += h_offset;
+  else
+    box.x2 -= h_offset;
+  box.y2 -= v_offset;
+
+  color = priv->fade_color;
+  color.alpha = color.alpha * clutter_actor_get_paint_opacity (CLUTTER_ACTOR (self)) / 0xff;
+  cogl_color_premultiply (&color);
+
+  top = bottom = left = right = FALSE;
+  adjustment_needs_fade (priv->vadjustment, &top, &bottom);
+  adjustment_needs_fade (priv->hadjustment, &left, &right);
+
+  if (clutter_actor_get_text_direction (CLUTTER_ACTOR (self)) == CLUTTER_TEXT_DIRECTION_RTL)
+    {
+      gboolean tmp = left;
+
+      left = right;
+      right = tmp;
+    }
+
+  if (top && priv->fade_margins.top > 0)
+    paint_fade_gradient (framebuffer, pipeline, &color,
+                         box.x1, box.y1, box.x2, box.y1 + priv->fade_margins.top,
+                         TRUE, TRUE);
+  if (bottom && priv->fade_margins.bottom > 0)
+    paint_fade_gradient (framebuffer, pipeline, &color,
+                         box.x1, box.y2 - priv->fade_margins.bottom, box.x2, box.y2,
+                         TRUE, FALSE);
+  if (left && priv->fade_margins.left > 0)
+    paint_fade_gradient (framebuffer, pipeline, &color,
+                         box.x1, box.y1, box.x1 + priv->fade_margins.left, box.y2,
+                         FALSE, TRUE);
+  if (right && priv->fade_margins.right > 0)
+    paint_fade_gradient (framebuffer, pipeline, &color,
+                         box.x2 - priv->fade_margins.right, box.y1, box.x2, box.y2,
+                         FALSE, FALSE);
+}
+
+static void
+st_scroll_view_paint (ClutterActor        *actor,
+                      ClutterPaintContext *paint_context)
+{
+  StScrollViewPrivate *priv =
+    st_scroll_view_get_instance_private (ST_SCROLL_VIEW (actor));
+
+  CLUTTER_ACTOR_CLASS (st_scroll_view_parent_class)->paint (actor, paint_context);
+
+  if (priv->fade_overlay)
+    paint_fade_overlay (ST_SCROLL_VIEW (actor),
+                        clutter_paint_context_get_framebuffer (paint_context));
+}
+
 static gboolean
 st_scroll_view_get_paint_volume (ClutterActor       *actor,
                                  ClutterPaintVolume *volume)
@@ -713,6 +881,7 @@ adjust_with_direction (StAdjustment           *adj,
       break;
     }
 
+  st_adjustment_stop_kinetic (adj);
   st_adjustment_adjust_for_scroll_event (adj, delta);
 }
 
@@ -720,11 +889,15 @@ static void
 st_scroll_view_style_changed (StWidget *widget)
 {
   StScrollView *self = ST_SCROLL_VIEW (widget);
+  StScrollViewPrivate *priv = st_scroll_view_get_instance_private (self);
   double vfade_offset = 0.0;
   double hfade_offset = 0.0;
 
   StThemeNode *theme_node = st_widget_get_theme_node (widget);
 
+  priv->fade_overlay = st_theme_node_lookup_color (theme_node, "-st-fade-color",
+                                                   FALSE, &priv->fade_color);
+
   st_theme_node_lookup_length (theme_node, "-st-vfade-offset", FALSE, &vfade_offset);
   st_theme_node_lookup_length (theme_node, "-st-hfade-offset", FALSE, &hfade_offset);
   st_scroll_view_update_fade_effect (self,
@@ -738,6 +911,40 @@ st_scroll_view_style_changed (StWidget *widget)
   ST_WIDGET_CLASS (st_scroll_view_parent_class)->style_changed (widget);
 }
 
+/* Scrolling that pauses for longer than this doesn't keep moving */
+#define KINETIC_SCROLL_TIMEOUT_MS 150
+
+static void
+kinetic_scroll (StAdjustment *adjustment,
+                gdouble       delta,
+                guint32       dt,
+                gboolean      finished,
+                gdouble      *velocity)
+{
+  double prev_value;
+
+  st_adjustment_stop_kinetic (adjustment);
+
+  if (dt > KINETIC_SCROLL_TIMEOUT_MS)
+    *velocity = 0;
+
+  if (delta != 0)
+    {
+      prev_value = st_adjustment_get_value (adjustment);
+      st_adjustment_adjust_for_scroll_event (adjustment, delta);
+
+      if (dt > 0)
+        *velocity = (*velocity + (st_adjustment_get_value (adjustment) -
+                                  prev_value) * 1000.0 / dt) / 2;
+    }
+
+  if (finished)
+    {
+      st_adjustment_fling (adjustment, *velocity);
+      *velocity = 0;
+    }
+}
+
 static gboolean
 st_scroll_view_scroll_event (ClutterActor *self,
                              ClutterEvent *event)
@@ -768,8 +975,28 @@ st_scroll_view_scroll_event (ClutterActor *self,
         if (direction == CLUTTER_TEXT_DIRECTION_RTL)
           delta_x *= -1;
 
-        st_adjustment_adjust_for_scroll_event (priv->hadjustment, delta_x);
-        st_adjustment_adjust_for_scroll_event (priv->vadjustment, delta_y);
+        if (priv->kinetic_scroll)
+          {
+            ClutterScrollFinishFlags finish_flags;
+            guint32 time, dt;
+
+            finish_flags = clutter_event_get_scroll_finish_flags (event);
+            time = clutter_event_get_time (event);
+            dt = time - priv->last_scroll_time;
+            priv->last_scroll_time = time;
+
+            kinetic_scroll (priv->hadjustment, delta_x, dt,
+                            !!(finish_flags & CLUTTER_SCROLL_FINISHED_HORIZONTAL),
+                            &priv->hvelocity);
+            kinetic_scroll (priv->vadjustment, delta_y, dt,
+                            !!(finish_flags & CLUTTER_SCROLL_FINISHED_VERTICAL),
+                            &priv->vvelocity);
+          }
+        else
+          {
+            st_adjustment_adjust_for_scroll_event (priv->hadjustment, delta_x);
+            st_adjustment_adjust_for_scroll_event (priv->vadjustment, delta_y);
+          }
       }
       break;
     case CLUTTER_SCROLL_UP:
@@ -848,6 +1075,7 @@ st_scroll_view_class_init (StScrollViewClass *klass)
   object_class->set_property = st_scroll_view_set_property;
   object_class->dispose = st_scroll_view_dispose;
 
+  actor_class->paint = st_scroll_view_paint;
   actor_class->get_paint_volume = st_scroll_view_get_paint_volume;
   actor_class->get_preferred_width = st_scroll_view_get_preferred_width;
   actor_class->get_preferred_height = st_scroll_view_get_preferred_height;
@@ -990,6 +1218,19 @@ st_scroll_view_class_init (StScrollViewClass *klass)
                           FALSE,
                           ST_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * StScrollView:enable-kinetic-scrolling:
+   *
+   * Whether touchpad scrolling keeps moving and slows down after the
+   * fingers are lifted.
+   */
+  props[PROP_KINETIC_SCROLL] =
+    g_param_spec_boolean ("enable-kinetic-scrolling",
+                          "Enable Kinetic Scrolling",
+                          "Keep scrolling after touchpad scrolling ends",
+                          FALSE,
+                          ST_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
   g_object_class_install_properties (object_class, N_PROPS, props);
 }
 
@@ -1448,6 +1689,61 @@ st_scroll_view_get_overlay_scrollbars (StScrollView *scroll)
   return priv->overlay_scrollbars;
 }
 
+/**
+ * st_scroll_view_set_kinetic_scrolling:
+ * @scroll: A #StScrollView
+ * @enabled: %TRUE or %FALSE
+ *
+ * Sets whether touchpad scrolling keeps moving after the fingers are
+ * lifted, slowing down until it stops. See st_adjustment_fling().
+ */
+void
+st_scroll_view_set_kinetic_scrolling (StScrollView *scroll,
+                                      gboolean      enabled)
+{
+  StScrollViewPrivate *priv;
+
+  g_return_if_fail (ST_IS_SCROLL_VIEW (scroll));
+
+  priv = st_scroll_view_get_instance_private (scroll);
+
+  if (priv->kinetic_scroll != enabled)
+    {
+      priv->kinetic_scroll = enabled;
+      priv->hvelocity = priv->vvelocity = 0;
+
+      if (!enabled)
+        {
+          st_adjustment_stop_kinetic (priv->hadjustment);
+          st_adjustment_stop_kinetic (priv->vadjustment);
+        }
+
+      g_object_notify_by_pspec (G_OBJECT (scroll),
+                                props[PROP_KINETIC_SCROLL]);
+    }
+}
+
+/**
+ * st_scroll_view_get_kinetic_scrolling:
+ * @scroll: A #StScrollView
+ *
+ * Gets whether touchpad scrolling keeps moving after the fingers are
+ * lifted.
+ *
+ * Returns: %TRUE if enabled, %FALSE otherwise
+ */
+gboolean
+st_scroll_view_get_kinetic_scrolling (StScrollView *scroll)
+{
+  StScrollViewPrivate *priv;
+
+  g_return_val_if_fail (ST_IS_SCROLL_VIEW (scroll), FALSE);
+
+  priv = st_scroll_view_get_instance_private (scroll);
+
+  return priv->kinetic_scroll;
+}
+
 /**
  * st_scroll_view_set_policy:
  * @scroll: A #StScrollView
@@ -77,6 +77,10 @@ void          st_scroll_view_set_overlay_scrollbars (StScrollView *scroll,
                                                      gboolean      enabled);
 gboolean      st_scroll_view_get_overlay_scrollbars (StScrollView *scroll);
 
+void          st_scroll_view_set_kinetic_scrolling (StScrollView *scroll,
+                                                    gboolean      enabled);
+gboolean      st_scroll_view_get_kinetic_scrolling (StScrollView *scroll);
+
 void          st_scroll_view_set_policy          (StScrollView   *scroll,
                                                   StPolicyType    hscroll,
                                                   StPolicyType    vscroll);
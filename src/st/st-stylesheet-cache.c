@@ -0,0 +1,866 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-stylesheet-cache.c: On-disk cache of parsed stylesheets
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Tokenizing and parsing the theme through libcroco is a noticeable part
+ * of startup on slow machines. When enabled by setting
+ * ST_STYLESHEET_CACHE=1 in the environment, the object model of every
+ * parsed stylesheet is written to a compact binary file in the user cache
+ * directory, and mapped back in on the next start instead of reparsing.
+ *
+ * Only what StTheme actually uses is stored: rulesets and @import rules.
+ * The cache entry is keyed by the URI of the stylesheet and validated
+ * against its modification time and size and the version of the shell.
+ * Any mismatch or corruption simply makes us fall back to parsing.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "st-stylesheet-cache.h"
+
+#define CACHE_MAGIC "StCSSbin"
+#define CACHE_MAGIC_LEN 8
+#define CACHE_FORMAT_VERSION 1
+
+/* Length marker for a NULL string */
+#define NO_STRING G_MAXUINT32
+
+typedef struct {
+  const guint8 *data;
+  gsize length;
+  gsize offset;
+  gboolean error;
+} CacheReader;
+
+gboolean
+_st_stylesheet_cache_is_enabled (void)
+{
+  static int enabled = -1;
+
+  if (G_UNLIKELY (enabled < 0))
+    enabled = g_strcmp0 (g_getenv ("ST_STYLESHEET_CACHE"), "1") == 0;
+
+  return enabled;
+}
+
+static guint32
+version_hash (void)
+{
+  return g_str_hash (PACKAGE_VERSION) ^ (guint32) sizeof (gpointer);
+}
+
+static char *
+get_cache_path (GFile *file)
+{
+  g_autofree char *uri = g_file_get_uri (file);
+  g_autofree char *checksum = NULL;
+  g_autofree char *basename = NULL;
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA256, uri, -1);
+  basename = g_strconcat (checksum, ".bin", NULL);
+
+  return g_build_filename (g_get_user_cache_dir (),
+                           "gnome-shell", "stylesheets", basename, NULL);
+}
+
+static gboolean
+get_file_stamp (GFile   *file,
+                guint64 *mtime,
+                guint64 *size)
+{
+  g_autoptr (GFileInfo) info = NULL;
+
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                            G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  if (info == NULL)
+    return FALSE;
+
+  /* Resources don't have a modification time, but they can only
+   * change together with the shell version */
+  *mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+  *size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+
+  return TRUE;
+}
+
+/* Writing */
+
+static void
+write_uint32 (GByteArray *buf,
+              guint32     value)
+{
+  g_byte_array_append (buf, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+write_uint64 (GByteArray *buf,
+              guint64     value)
+{
+  g_byte_array_append (buf, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+write_double (GByteArray *buf,
+              double      value)
+{
+  g_byte_array_append (buf, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+write_string (GByteArray *buf,
+              CRString   *string)
+{
+  if (string == NULL || string->stryng == NULL)
+    {
+      write_uint32 (buf, NO_STRING);
+      return;
+    }
+
+  write_uint32 (buf, string->stryng->len);
+  g_byte_array_append (buf, (const guint8 *) string->stryng->str, string->stryng->len);
+}
+
+static gboolean
+write_terms (GByteArray *buf,
+             CRTerm     *terms)
+{
+  CRTerm *term;
+  guint32 n_terms = 0;
+
+  for (term = terms; term; term = term->next)
+    n_terms++;
+
+  write_uint32 (buf, n_terms);
+
+  for (term = terms; term; term = term->next)
+    {
+      write_uint32 (buf, term->type);
+      write_uint32 (buf, term->unary_op);
+      write_uint32 (buf, term->the_operator);
+
+      switch (term->type)
+        {
+        case TERM_NUMBER:
+          if (term->content.num == NULL)
+            return FALSE;
+          write_uint32 (buf, term->content.num->type);
+          write_double (buf, term->content.num->val);
+          break;
+
+        case TERM_FUNCTION:
+          write_string (buf, term->content.str);
+          if (!write_terms (buf, term->ext_content.func_param))
+            return FALSE;
+          break;
+
+        case TERM_STRING:
+        case TERM_IDENT:
+        case TERM_URI:
+        case TERM_HASH:
+          write_string (buf, term->content.str);
+          break;
+
+        case TERM_RGB:
+          if (term->content.rgb == NULL)
+            return FALSE;
+          write_uint64 (buf, term->content.rgb->red);
+          write_uint64 (buf, term->content.rgb->green);
+          write_uint64 (buf, term->content.rgb->blue);
+          write_uint32 (buf, term->content.rgb->is_percentage);
+          break;
+
+        case TERM_UNICODERANGE:
+        case TERM_NO_TYPE:
+        default:
+          break;
+        }
+    }
+
+  return TRUE;
+}
+
+static gboolean
+write_simple_sel (GByteArray  *buf,
+                  CRSimpleSel *simple_sel)
+{
+  CRSimpleSel *cur_sel;
+  guint32 n_sels = 0;
+
+  for (cur_sel = simple_sel; cur_sel; cur_sel = cur_sel->next)
+    n_sels++;
+
+  write_uint32 (buf, n_sels);
+
+  for (cur_sel = simple_sel; cur_sel; cur_sel = cur_sel->next)
+    {
+      CRAdditionalSel *add_sel;
+      guint32 n_add_sels = 0;
+
+      write_uint32 (buf, cur_sel->type_mask);
+      write_uint32 (buf, cur_sel->is_case_sentive);
+      write_uint32 (buf, cur_sel->combinator);
+      write_string (buf, cur_sel->name);
+
+      for (add_sel = cur_sel->add_sel; add_sel; add_sel = add_sel->next)
+        n_add_sels++;
+
+      write_uint32 (buf, n_add_sels);
+
+      for (add_sel = cur_sel->add_sel; add_sel; add_sel = add_sel->next)
+        {
+          write_uint32 (buf, add_sel->type);
+
+          switch (add_sel->type)
+            {
+            case CLASS_ADD_SELECTOR:
+              write_string (buf, add_sel->content.class_name);
+              break;
+            case ID_ADD_SELECTOR:
+              write_string (buf, add_sel->content.id_name);
+              break;
+            case PSEUDO_CLASS_ADD_SELECTOR:
+              if (add_sel->content.pseudo == NULL)
+                return FALSE;
+              write_uint32 (buf, add_sel->content.pseudo->type);
+              write_string (buf, add_sel->content.pseudo->name);
+              write_string (buf, add_sel->content.pseudo->extra);
+              break;
+            case NO_ADD_SELECTOR:
+              break;
+            case ATTRIBUTE_ADD_SELECTOR:
+            default:
+              /* Not supported by StTheme anyway; just don't cache
+               * the stylesheet so it keeps warning about it */
+              return FALSE;
+            }
+        }
+    }
+
+  return TRUE;
+}
+
+static gboolean
+write_ruleset (GByteArray  *buf,
+               CRStatement *stmt)
+{
+  CRSelector *cur_sel;
+  CRDeclaration *cur_decl;
+  guint32 n_sels = 0, n_decls = 0;
+
+  for (cur_sel = stmt->kind.ruleset->sel_list; cur_sel; cur_sel = cur_sel->next)
+    n_sels++;
+
+  write_uint32 (buf, n_sels);
+
+  for (cur_sel = stmt->kind.ruleset->sel_list; cur_sel; cur_sel = cur_sel->next)
+    {
+      if (!write_simple_sel (buf, cur_sel->simple_sel))
+        return FALSE;
+    }
+
+  for (cur_decl = stmt->kind.ruleset->decl_list; cur_decl; cur_decl = cur_decl->next)
+    n_decls++;
+
+  write_uint32 (buf, n_decls);
+
+  for (cur_decl = stmt->kind.ruleset->decl_list; cur_decl; cur_decl = cur_decl->next)
+    {
+      if (cur_decl->property == NULL)
+        return FALSE;
+
+      write_string (buf, cur_decl->property);
+      write_uint32 (buf, cur_decl->important);
+      if (!write_terms (buf, cur_decl->value))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+write_stylesheet (GByteArray   *buf,
+                  CRStyleSheet *stylesheet)
+{
+  CRStatement *cur_stmt;
+  guint32 n_stmts = 0;
+
+  for (cur_stmt = stylesheet->statements; cur_stmt; cur_stmt = cur_stmt->next)
+    {
+      if (cur_stmt->type == RULESET_STMT || cur_stmt->type == AT_IMPORT_RULE_STMT)
+        n_stmts++;
+    }
+
+  write_uint32 (buf, n_stmts);
+
+  for (cur_stmt = stylesheet->statements; cur_stmt; cur_stmt = cur_stmt->next)
+    {
+      switch (cur_stmt->type)
+        {
+        case RULESET_STMT:
+          if (cur_stmt->kind.ruleset == NULL ||
+              cur_stmt->kind.ruleset->sel_list == NULL)
+            return FALSE;
+
+          write_uint32 (buf, RULESET_STMT);
+          if (!write_ruleset (buf, cur_stmt))
+            return FALSE;
+          break;
+
+        case AT_IMPORT_RULE_STMT:
+          if (cur_stmt->kind.import_rule == NULL ||
+              cur_stmt->kind.import_rule->url == NULL)
+            return FALSE;
+
+          write_uint32 (buf, AT_IMPORT_RULE_STMT);
+          write_string (buf, cur_stmt->kind.import_rule->url);
+          break;
+
+        default:
+          /* Ignored by StTheme */
+          break;
+        }
+    }
+
+  return TRUE;
+}
+
+/**
+ * _st_stylesheet_cache_save:
+ * @file: the file @stylesheet was parsed from
+ * @stylesheet: a freshly parsed #CRStyleSheet
+ *
+ * Writes @stylesheet to the on-disk cache. Failures are silently
+ * ignored, the cache is purely an optimization.
+ */
+void
+_st_stylesheet_cache_save (GFile        *file,
+                           CRStyleSheet *stylesheet)
+{
+  g_autoptr (GByteArray) buf = NULL;
+  g_autofree char *path = NULL;
+  g_autofree char *dir = NULL;
+  g_autofree char *uri = NULL;
+  guint64 mtime, size;
+
+  if (!get_file_stamp (file, &mtime, &size))
+    return;
+
+  uri = g_file_get_uri (file);
+
+  buf = g_byte_array_new ();
+  g_byte_array_append (buf, (const guint8 *) CACHE_MAGIC, CACHE_MAGIC_LEN);
+  write_uint32 (buf, CACHE_FORMAT_VERSION);
+  write_uint32 (buf, version_hash ());
+  write_uint64 (buf, mtime);
+  write_uint64 (buf, size);
+  write_uint32 (buf, strlen (uri));
+  g_byte_array_append (buf, (const guint8 *) uri, strlen (uri));
+
+  if (!write_stylesheet (buf, stylesheet))
+    return;
+
+  path = get_cache_path (file);
+  dir = g_path_get_dirname (path);
+
+  if (g_mkdir_with_parents (dir, 0700) != 0)
+    return;
+
+  g_file_set_contents (path, (const char *) buf->data, buf->len, NULL);
+}
+
+/* Reading */
+
+static gboolean
+read_bytes (CacheReader *reader,
+            gpointer     dest,
+            gsize        n_bytes)
+{
+  if (reader->error || reader->length - reader->offset < n_bytes)
+    {
+      reader->error = TRUE;
+      memset (dest, 0, n_bytes);
+      return FALSE;
+    }
+
+  memcpy (dest, reader->data + reader->offset, n_bytes);
+  reader->offset += n_bytes;
+
+  return TRUE;
+}
+
+static guint32
+read_uint32 (CacheReader *reader)
+{
+  guint32 value;
+
+  read_bytes (reader, &value, sizeof (value));
+  return value;
+}
+
+static guint64
+read_uint64 (CacheReader *reader)
+{
+  guint64 value;
+
+  read_bytes (reader, &value, sizeof (value));
+  return value;
+}
+
+static double
+read_double (CacheReader *reader)
+{
+  double value;
+
+  read_bytes (reader, &value, sizeof (value));
+  return value;
+}
+
+/* Reads an element count, rejecting counts that can't possibly fit in
+ * the rest of the data so a corrupted file can't make us loop forever */
+static guint32
+read_count (CacheReader *reader)
+{
+  guint32 count = read_uint32 (reader);
+
+  if (count > reader->length - reader->offset)
+    {
+      reader->error = TRUE;
+      return 0;
+    }
+
+  return count;
+}
+
+static CRString *
+read_string (CacheReader *reader)
+{
+  CRString *string;
+  guint32 len;
+
+  len = read_uint32 (reader);
+  if (reader->error || len == NO_STRING)
+    return NULL;
+
+  if (reader->length - reader->offset < len)
+    {
+      reader->error = TRUE;
+      return NULL;
+    }
+
+  string = cr_string_new ();
+  g_string_append_len (string->stryng,
+                       (const char *) reader->data + reader->offset, len);
+  reader->offset += len;
+
+  return string;
+}
+
+static CRTerm *
+read_terms (CacheReader *reader)
+{
+  CRTerm *head = NULL, *tail = NULL;
+  guint32 n_terms, i;
+
+  n_terms = read_count (reader);
+
+  for (i = 0; i < n_terms && !reader->error; i++)
+    {
+      CRTerm *term = cr_term_new ();
+      guint32 type = read_uint32 (reader);
+
+      term->unary_op = read_uint32 (reader);
+      term->the_operator = read_uint32 (reader);
+
+      if (head == NULL)
+        head = term;
+      else
+        tail->next = term;
+      term->prev = tail;
+      tail = term;
+
+      if (term->unary_op > EMPTY_UNARY_UOP || term->the_operator > COMMA)
+        {
+          reader->error = TRUE;
+          break;
+        }
+
+      switch (type)
+        {
+        case TERM_NUMBER:
+          {
+            guint32 num_type = read_uint32 (reader);
+            double val = read_double (reader);
+
+            if (num_type >= NB_NUM_TYPE)
+              reader->error = TRUE;
+
+            if (reader->error)
+              break;
+
+            term->type = TERM_NUMBER;
+            term->content.num = cr_num_new_with_val (val, num_type);
+          }
+          break;
+
+        case TERM_FUNCTION:
+          term->type = TERM_FUNCTION;
+          term->content.str = read_string (reader);
+          if (!reader->error)
+            term->ext_content.func_param = read_terms (reader);
+          break;
+
+        case TERM_STRING:
+        case TERM_IDENT:
+        case TERM_URI:
+        case TERM_HASH:
+          term->type = type;
+          term->content.str = read_string (reader);
+          break;
+
+        case TERM_RGB:
+          {
+            CRRgb *rgb = cr_rgb_new ();
+
+            rgb->red = (glong) read_uint64 (reader);
+            rgb->green = (glong) read_uint64 (reader);
+            rgb->blue = (glong) read_uint64 (reader);
+            rgb->is_percentage = read_uint32 (reader);
+
+            term->type = TERM_RGB;
+            term->content.rgb = rgb;
+          }
+          break;
+
+        case TERM_UNICODERANGE:
+        case TERM_NO_TYPE:
+          term->type = type;
+          break;
+
+        default:
+          reader->error = TRUE;
+          break;
+        }
+    }
+
+  if (reader->error && head)
+    {
+      cr_term_destroy (head);
+      head = NULL;
+    }
+
+  return head;
+}
+
+static CRAdditionalSel *
+read_additional_sel (CacheReader *reader)
+{
+  CRAdditionalSel *add_sel;
+  guint32 type = read_uint32 (reader);
+
+  if (reader->error)
+    return NULL;
+
+  switch (type)
+    {
+    case CLASS_ADD_SELECTOR:
+      add_sel = cr_additional_sel_new_with_type (CLASS_ADD_SELECTOR);
+      cr_additional_sel_set_class_name (add_sel, read_string (reader));
+      break;
+
+    case ID_ADD_SELECTOR:
+      add_sel = cr_additional_sel_new_with_type (ID_ADD_SELECTOR);
+      cr_additional_sel_set_id_name (add_sel, read_string (reader));
+      break;
+
+    case PSEUDO_CLASS_ADD_SELECTOR:
+      {
+        CRPseudo *pseudo = cr_pseudo_new ();
+
+        pseudo->type = read_uint32 (reader);
+        pseudo->name = read_string (reader);
+        pseudo->extra = read_string (reader);
+
+        add_sel = cr_additional_sel_new_with_type (PSEUDO_CLASS_ADD_SELECTOR);
+        cr_additional_sel_set_pseudo (add_sel, pseudo);
+      }
+      break;
+
+    case NO_ADD_SELECTOR:
+      add_sel = cr_additional_sel_new_with_type (NO_ADD_SELECTOR);
+      break;
+
+    default:
+      reader->error = TRUE;
+      return NULL;
+    }
+
+  return add_sel;
+}
+
+static CRSimpleSel *
+read_simple_sel (CacheReader *reader)
+{
+  CRSimpleSel *head = NULL, *tail = NULL;
+  guint32 n_sels, i;
+
+  n_sels = read_count (reader);
+  if (n_sels == 0)
+    reader->error = TRUE;
+
+  for (i = 0; i < n_sels && !reader->error; i++)
+    {
+      CRSimpleSel *simple_sel = cr_simple_sel_new ();
+      CRAdditionalSel *add_tail = NULL;
+      guint32 n_add_sels, j;
+
+      if (head == NULL)
+        head = simple_sel;
+      else
+        tail->next = simple_sel;
+      simple_sel->prev = tail;
+      tail = simple_sel;
+
+      simple_sel->type_mask = read_uint32 (reader);
+      simple_sel->is_case_sentive = read_uint32 (reader);
+      simple_sel->combinator = read_uint32 (reader);
+      simple_sel->name = read_string (reader);
+
+      if (simple_sel->combinator > COMB_GT)
+        reader->error = TRUE;
+
+      n_add_sels = read_count (reader);
+
+      for (j = 0; j < n_add_sels && !reader->error; j++)
+        {
+          CRAdditionalSel *add_sel = read_additional_sel (reader);
+
+          if (add_sel == NULL)
+            break;
+
+          if (add_tail == NULL)
+            simple_sel->add_sel = add_sel;
+          else
+            add_tail->next = add_sel;
+          add_sel->prev = add_tail;
+          add_tail = add_sel;
+        }
+    }
+
+  if (reader->error && head)
+    {
+      cr_simple_sel_destroy (head);
+      head = NULL;
+    }
+
+  return head;
+}
+
+static CRStatement *
+read_ruleset (CacheReader  *reader,
+              CRStyleSheet *stylesheet)
+{
+  CRStatement *stmt;
+  CRSelector *sel_list = NULL;
+  CRDeclaration *decl_list = NULL;
+  guint32 n_sels, n_decls, i;
+
+  n_sels = read_count (reader);
+  if (n_sels == 0)
+    {
+      reader->error = TRUE;
+      return NULL;
+    }
+
+  for (i = 0; i < n_sels && !reader->error; i++)
+    {
+      CRSimpleSel *simple_sel = read_simple_sel (reader);
+
+      if (simple_sel == NULL)
+        break;
+
+      sel_list = cr_selector_append_simple_sel (sel_list, simple_sel);
+    }
+
+  if (reader->error)
+    {
+      if (sel_list)
+        cr_selector_destroy (sel_list);
+      return NULL;
+    }
+
+  stmt = cr_statement_new_ruleset (stylesheet, sel_list, NULL, NULL);
+
+  n_decls = read_count (reader);
+
+  for (i = 0; i < n_decls && !reader->error; i++)
+    {
+      CRDeclaration *decl;
+      CRString *property;
+      gboolean important;
+      CRTerm *value;
+
+      property = read_string (reader);
+      important = read_uint32 (reader);
+      value = read_terms (reader);
+
+      if (property == NULL || reader->error)
+        {
+          reader->error = TRUE;
+          g_clear_pointer (&property, cr_string_destroy);
+          g_clear_pointer (&value, cr_term_destroy);
+          break;
+        }
+
+      decl = cr_declaration_new (stmt, property, value);
+      decl->important = important;
+      decl_list = cr_declaration_append (decl_list, decl);
+    }
+
+  /* cr_statement_ruleset_set_decl_list() is broken */
+  stmt->kind.ruleset->decl_list = decl_list;
+
+  if (reader->error)
+    {
+      cr_statement_destroy (stmt);
+      return NULL;
+    }
+
+  return stmt;
+}
+
+static CRStyleSheet *
+read_stylesheet (CacheReader *reader)
+{
+  CRStyleSheet *stylesheet;
+  CRStatement *tail = NULL;
+  guint32 n_stmts, i;
+
+  stylesheet = cr_stylesheet_new (NULL);
+
+  n_stmts = read_count (reader);
+
+  for (i = 0; i < n_stmts && !reader->error; i++)
+    {
+      CRStatement *stmt = NULL;
+      guint32 type = read_uint32 (reader);
+
+      if (reader->error)
+        break;
+
+      switch (type)
+        {
+        case RULESET_STMT:
+          stmt = read_ruleset (reader, stylesheet);
+          break;
+
+        case AT_IMPORT_RULE_STMT:
+          {
+            CRString *url = read_string (reader);
+
+            if (url == NULL)
+              reader->error = TRUE;
+            else
+              stmt = cr_statement_new_at_import_rule (stylesheet, url, NULL, NULL);
+          }
+          break;
+
+        default:
+          reader->error = TRUE;
+          break;
+        }
+
+      if (stmt == NULL)
+        break;
+
+      /* Link by hand rather than with cr_statement_append(), which
+       * walks the whole list every time */
+      if (tail == NULL)
+        stylesheet->statements = stmt;
+      else
+        tail->next = stmt;
+      stmt->prev = tail;
+      tail = stmt;
+    }
+
+  if (reader->error || reader->offset != reader->length)
+    {
+      cr_stylesheet_destroy (stylesheet);
+      return NULL;
+    }
+
+  return stylesheet;
+}
+
+/**
+ * _st_stylesheet_cache_load:
+ * @file: the stylesheet file
+ *
+ * Looks up a cached object model for @file.
+ *
+ * Returns: (nullable): a new #CRStyleSheet with a reference count of
+ *   zero, like the ones from the parser, or %NULL if there is no valid
+ *   cache entry for the current contents of @file
+ */
+CRStyleSheet *
+_st_stylesheet_cache_load (GFile *file)
+{
+  g_autoptr (GMappedFile) mapped_file = NULL;
+  g_autofree char *path = NULL;
+  g_autofree char *uri = NULL;
+  CacheReader reader = { 0, };
+  char magic[CACHE_MAGIC_LEN];
+  guint64 mtime, size;
+  guint32 uri_len;
+
+  if (!get_file_stamp (file, &mtime, &size))
+    return NULL;
+
+  path = get_cache_path (file);
+  mapped_file = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped_file == NULL)
+    return NULL;
+
+  reader.data = (const guint8 *) g_mapped_file_get_contents (mapped_file);
+  reader.length = g_mapped_file_get_length (mapped_file);
+
+  read_bytes (&reader, magic, CACHE_MAGIC_LEN);
+  if (reader.error || memcmp (magic, CACHE_MAGIC, CACHE_MAGIC_LEN) != 0)
+    return NULL;
+
+  if (read_uint32 (&reader) != CACHE_FORMAT_VERSION ||
+      read_uint32 (&reader) != version_hash () ||
+      read_uint64 (&reader) != mtime ||
+      read_uint64 (&reader) != size)
+    return NULL;
+
+  /* Guard against checksum collisions */
+  uri = g_file_get_uri (file);
+  uri_len = read_uint32 (&reader);
+  if (reader.error ||
+      uri_len != strlen (uri) ||
+      reader.length - reader.offset < uri_len ||
+      memcmp (reader.data + reader.offset, uri, uri_len) != 0)
+    return NULL;
+
+  reader.offset += uri_len;
+
+  return read_stylesheet (&reader);
+}
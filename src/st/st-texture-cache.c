@@ -22,6 +22,8 @@
 #include "config.h"
 
 #include "st-image-content-private.h"
+#include "st-icon-atlas.h"
+#include "st-icon-bitmap-cache.h"
 #include "st-texture-cache.h"
 #include "st-private.h"
 #include "st-settings.h"
@@ -34,6 +36,13 @@
 #define CACHE_PREFIX_FILE "file:"
 #define CACHE_PREFIX_FILE_FOR_CAIRO "file-for-cairo:"
 
+#define LOAD_CHUNK_SIZE (64 * 1024)
+
+/* Decodes beyond this wait in the pending queues, so that loads for
+ * what is on screen don't queue up behind everything else */
+#define MAX_RUNNING_LOADS 4
+#define N_LOAD_PRIORITIES (ST_TEXTURE_CACHE_PRIORITY_BACKGROUND + 1)
+
 struct _StTextureCachePrivate
 {
   StIconTheme *icon_theme;
@@ -47,19 +56,77 @@ struct _StTextureCachePrivate
   /* Presently this is used to de-duplicate requests for GIcons and async URIs. */
   GHashTable *outstanding_requests; /* char * -> AsyncTextureLoadData * */
 
-  /* File monitors to evict cache data on changes */
-  GHashTable *file_monitors; /* char * -> GFileMonitor * */
+  /* Theme images that failed to load in the background, so that
+   * painting doesn't retry them until they change */
+  GHashTable *failed_file_loads; /* Set: char * */
+
+  /* Monitors of the directories of loaded files, to evict cache data
+   * on changes; see ensure_monitor_for_file() */
+  GHashTable *directory_monitors; /* GFile * -> DirectoryMonitor * */
+  /* The files the keys of cached entries were loaded from */
+  GHashTable *monitored_keys; /* char * -> GFile * */
 
   GCancellable *cancellable;
+
+  /* Async loads waiting for a free slot, one queue per priority */
+  GQueue pending_loads[N_LOAD_PRIORITIES]; /* AsyncTextureLoadData * */
+  guint n_running_loads;
+  guint dispatch_id;
+
+  /* Recency of the entries in both keyed caches, for LRU eviction */
+  GHashTable *use_serials; /* char * -> guint */
+  guint next_use_serial;
+
+  guint memory_budget; /* MiB, 0 for unlimited */
+  guint trim_id;
 };
 
 static void st_texture_cache_dispose (GObject *object);
 static void st_texture_cache_finalize (GObject *object);
+static void texture_load_data_free (gpointer p);
+static void release_unused_monitors (StTextureCache *cache);
+
+typedef struct {
+  StTextureCache *cache;
+  GFileMonitor *monitor; /* NULL if the directory can't be monitored */
+  GHashTable *files; /* GFile * -> MonitoredFile * */
+} DirectoryMonitor;
+
+typedef struct {
+  guint n_keys; /* monitored_keys loaded from the file */
+  gboolean permanent; /* loaded without caching */
+} MonitoredFile;
+
+static void
+directory_monitor_free (DirectoryMonitor *directory)
+{
+  if (directory->monitor)
+    {
+      g_signal_handlers_disconnect_by_data (directory->monitor, directory);
+      g_file_monitor_cancel (directory->monitor);
+      g_object_unref (directory->monitor);
+    }
+
+  g_hash_table_destroy (directory->files);
+  g_free (directory);
+}
+
+enum
+{
+  PROP_0,
+
+  PROP_MEMORY_BUDGET,
+
+  N_PROPS
+};
+
+static GParamSpec *props[N_PROPS] = { NULL, };
 
 enum
 {
   ICON_THEME_CHANGED,
   TEXTURE_FILE_CHANGED,
+  EVICTED,
 
   LAST_SIGNAL
 };
@@ -81,24 +148,101 @@ create_invisible_actor (void)
 }
 
 /* Reverse the opacity we added while loading */
+static GQuark
+get_icon_colors_quark (void)
+{
+  static GQuark quark = 0;
+
+  if (G_UNLIKELY (quark == 0))
+    quark = g_quark_from_static_string ("st-texture-cache-icon-colors");
+
+  return quark;
+}
+
 static void
 set_content_from_image (ClutterActor   *actor,
                         ClutterContent *image)
 {
+  g_autoptr (ClutterContent) recolored = NULL;
+  StIconColors *colors;
+
   g_assert (image && CLUTTER_IS_IMAGE (image));
 
-  clutter_actor_set_content (actor, image);
+  /* Symbolic masks shared by all colors, see use_gpu_recolor() */
+  colors = g_object_get_qdata (G_OBJECT (actor), get_icon_colors_quark ());
+  if (colors != NULL &&
+      st_image_content_get_is_symbolic (ST_IMAGE_CONTENT (image)))
+    recolored = st_image_content_new_recolored (ST_IMAGE_CONTENT (image), colors);
+
+  clutter_actor_set_content (actor, recolored ? recolored : image);
   clutter_actor_set_opacity (actor, 255);
 }
 
+static void
+st_texture_cache_set_property (GObject      *object,
+                               guint         prop_id,
+                               const GValue *value,
+                               GParamSpec   *pspec)
+{
+  StTextureCache *cache = ST_TEXTURE_CACHE (object);
+
+  switch (prop_id)
+    {
+    case PROP_MEMORY_BUDGET:
+      st_texture_cache_set_memory_budget (cache, g_value_get_uint (value));
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+st_texture_cache_get_property (GObject    *object,
+                               guint       prop_id,
+                               GValue     *value,
+                               GParamSpec *pspec)
+{
+  StTextureCache *cache = ST_TEXTURE_CACHE (object);
+
+  switch (prop_id)
+    {
+    case PROP_MEMORY_BUDGET:
+      g_value_set_uint (value, cache->priv->memory_budget);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
 static void
 st_texture_cache_class_init (StTextureCacheClass *klass)
 {
   GObjectClass *gobject_class = (GObjectClass *)klass;
 
+  gobject_class->set_property = st_texture_cache_set_property;
+  gobject_class->get_property = st_texture_cache_get_property;
   gobject_class->dispose = st_texture_cache_dispose;
   gobject_class->finalize = st_texture_cache_finalize;
 
+  /**
+   * StTextureCache:memory-budget:
+   *
+   * The amount of memory, in MiB, that cached images may use before the
+   * least recently used ones that are no longer displayed get evicted.
+   * 0 means the cache is not limited.
+   */
+  props[PROP_MEMORY_BUDGET] =
+    g_param_spec_uint ("memory-budget", NULL, NULL,
+                       0, G_MAXUINT, 0,
+                       ST_PARAM_READWRITE |
+                       G_PARAM_EXPLICIT_NOTIFY);
+
+  g_object_class_install_properties (gobject_class, N_PROPS, props);
+
   /**
    * StTextureCache::icon-theme-changed:
    * @self: a #StTextureCache
@@ -127,6 +271,217 @@ st_texture_cache_class_init (StTextureCacheClass *klass)
                   0, /* no default handler slot */
                   NULL, NULL, NULL,
                   G_TYPE_NONE, 1, G_TYPE_FILE);
+
+  /**
+   * StTextureCache::evicted:
+   * @self: a #StTextureCache
+   * @n_entries: the number of evicted entries
+   * @n_bytes: the approximate amount of memory they used
+   *
+   * Emitted after unused entries were evicted to keep the cache within
+   * #StTextureCache:memory-budget.
+   */
+  signals[EVICTED] =
+    g_signal_new ("evicted",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, /* no default handler slot */
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 2, G_TYPE_UINT, G_TYPE_UINT64);
+}
+
+typedef struct {
+  GHashTable *table;
+  const char *key;
+  guint serial;
+  gsize size;
+} TrimCandidate;
+
+static int
+compare_trim_candidates (gconstpointer a,
+                         gconstpointer b)
+{
+  const TrimCandidate *ca = a, *cb = b;
+
+  return ca->serial < cb->serial ? -1 : ca->serial > cb->serial;
+}
+
+static gsize
+get_texture_size (CoglTexture *texture)
+{
+  return (gsize) cogl_texture_get_width (texture) *
+         cogl_texture_get_height (texture) * 4;
+}
+
+/* Returns the approximate memory used by a keyed_cache value, and whether
+ * anything besides the cache holds a reference to it */
+static gsize
+get_cached_object_size (GObject  *object,
+                        gboolean *in_use)
+{
+  CoglTexture *texture;
+
+  if (COGL_IS_TEXTURE (object))
+    {
+      *in_use = object->ref_count > 1;
+      return get_texture_size (COGL_TEXTURE (object));
+    }
+
+  /* Images are handed out by their texture from
+   * st_texture_cache_load_file_to_cogl_texture(), so both count */
+  texture = clutter_image_get_texture (CLUTTER_IMAGE (object));
+  *in_use = object->ref_count > 1 ||
+            (texture && G_OBJECT (texture)->ref_count > 1);
+
+  return texture ? get_texture_size (texture) : 0;
+}
+
+static void
+collect_trim_candidates (StTextureCache *cache,
+                         GHashTable     *table,
+                         gboolean        is_surface,
+                         GArray         *candidates,
+                         guint64        *total)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_hash_table_iter_init (&iter, table);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      TrimCandidate candidate;
+      gboolean in_use;
+
+      if (is_surface)
+        {
+          cairo_surface_t *surface = value;
+
+          candidate.size = (gsize) cairo_image_surface_get_stride (surface) *
+                           cairo_image_surface_get_height (surface);
+          in_use = cairo_surface_get_reference_count (surface) > 1;
+        }
+      else
+        {
+          candidate.size = get_cached_object_size (value, &in_use);
+        }
+
+      *total += candidate.size;
+
+      if (in_use)
+        continue;
+
+      candidate.table = table;
+      candidate.key = key;
+      candidate.serial =
+        GPOINTER_TO_UINT (g_hash_table_lookup (cache->priv->use_serials, key));
+      g_array_append_val (candidates, candidate);
+    }
+}
+
+/* Evicts the least recently used entries that nothing else holds on
+ * to until all entries fit in @budget bytes, but no more than
+ * @max_fraction of those that could be evicted */
+static void
+evict_unused (StTextureCache *cache,
+              guint64         budget,
+              double          max_fraction)
+{
+  StTextureCachePrivate *priv = cache->priv;
+  g_autoptr (GArray) candidates = NULL;
+  guint64 total = 0, n_bytes = 0;
+  guint i, n_candidates, n_entries = 0;
+
+  candidates = g_array_new (FALSE, FALSE, sizeof (TrimCandidate));
+  collect_trim_candidates (cache, priv->keyed_cache, FALSE, candidates, &total);
+  collect_trim_candidates (cache, priv->keyed_surface_cache, TRUE, candidates, &total);
+
+  if (total <= budget)
+    return;
+
+  g_array_sort (candidates, compare_trim_candidates);
+
+  n_candidates = candidates->len * max_fraction;
+
+  for (i = 0; i < n_candidates && total > budget; i++)
+    {
+      TrimCandidate *candidate = &g_array_index (candidates, TrimCandidate, i);
+
+      total -= candidate->size;
+      n_bytes += candidate->size;
+      n_entries++;
+
+      /* The key is owned by the table, so forget it there last */
+      g_hash_table_remove (priv->use_serials, candidate->key);
+      g_hash_table_remove (candidate->table, candidate->key);
+    }
+
+  if (n_entries > 0)
+    {
+      release_unused_monitors (cache);
+      g_signal_emit (cache, signals[EVICTED], 0, n_entries, n_bytes);
+    }
+}
+
+static gboolean
+trim_caches (gpointer data)
+{
+  StTextureCache *cache = data;
+  StTextureCachePrivate *priv = cache->priv;
+  GHashTableIter iter;
+  gpointer key;
+
+  priv->trim_id = 0;
+
+  /* Drop the recency of entries that were removed some other way */
+  g_hash_table_iter_init (&iter, priv->use_serials);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      if (!g_hash_table_contains (priv->keyed_cache, key) &&
+          !g_hash_table_contains (priv->keyed_surface_cache, key))
+        g_hash_table_iter_remove (&iter);
+    }
+
+  release_unused_monitors (cache);
+
+  if (priv->memory_budget == 0)
+    return G_SOURCE_REMOVE;
+
+  evict_unused (cache, (guint64) priv->memory_budget * 1024 * 1024, 1.0);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_trim (StTextureCache *cache)
+{
+  if (cache->priv->trim_id != 0)
+    return;
+
+  cache->priv->trim_id = g_idle_add (trim_caches, cache);
+  g_source_set_name_by_id (cache->priv->trim_id, "[gnome-shell] trim_caches");
+}
+
+/* Marks @key as the most recently used entry of either keyed cache */
+static void
+touch_cached (StTextureCache *cache,
+              const char     *key)
+{
+  g_hash_table_replace (cache->priv->use_serials, g_strdup (key),
+                        GUINT_TO_POINTER (++cache->priv->next_use_serial));
+}
+
+/* Adds a new entry to one of the keyed caches, taking ownership of @value */
+static void
+insert_cached (StTextureCache *cache,
+               GHashTable     *table,
+               const char     *key,
+               gpointer        value)
+{
+  g_hash_table_insert (table, g_strdup (key), value);
+  touch_cached (cache, key);
+
+  if (cache->priv->memory_budget > 0)
+    queue_trim (cache);
 }
 
 /* Evicts all cached textures for named icons */
@@ -180,8 +535,16 @@ st_texture_cache_init (StTextureCache *self)
                                                    g_free, NULL);
   self->priv->outstanding_requests = g_hash_table_new_full (g_str_hash, g_str_equal,
                                                             g_free, NULL);
-  self->priv->file_monitors = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
-                                                     g_object_unref, g_object_unref);
+  self->priv->failed_file_loads = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                         g_free, NULL);
+  self->priv->directory_monitors = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                                          g_object_unref,
+                                                          (GDestroyNotify) directory_monitor_free);
+  self->priv->monitored_keys = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                      g_free, g_object_unref);
+
+  self->priv->use_serials = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                   g_free, NULL);
 
   self->priv->cancellable = g_cancellable_new ();
 }
@@ -190,17 +553,27 @@ static void
 st_texture_cache_dispose (GObject *object)
 {
   StTextureCache *self = (StTextureCache*)object;
+  int i;
 
   g_cancellable_cancel (self->priv->cancellable);
 
+  g_clear_handle_id (&self->priv->trim_id, g_source_remove);
+  g_clear_handle_id (&self->priv->dispatch_id, g_source_remove);
+
+  for (i = 0; i < N_LOAD_PRIORITIES; i++)
+    g_queue_clear_full (&self->priv->pending_loads[i], texture_load_data_free);
+
   g_clear_object (&self->priv->icon_theme);
   g_clear_object (&self->priv->cancellable);
 
   g_clear_pointer (&self->priv->keyed_cache, g_hash_table_destroy);
   g_clear_pointer (&self->priv->keyed_surface_cache, g_hash_table_destroy);
   g_clear_pointer (&self->priv->used_scales, g_hash_table_destroy);
+  g_clear_pointer (&self->priv->failed_file_loads, g_hash_table_destroy);
   g_clear_pointer (&self->priv->outstanding_requests, g_hash_table_destroy);
-  g_clear_pointer (&self->priv->file_monitors, g_hash_table_destroy);
+  g_clear_pointer (&self->priv->monitored_keys, g_hash_table_destroy);
+  g_clear_pointer (&self->priv->directory_monitors, g_hash_table_destroy);
+  g_clear_pointer (&self->priv->use_serials, g_hash_table_destroy);
 
   G_OBJECT_CLASS (st_texture_cache_parent_class)->dispose (object);
 }
@@ -293,12 +666,78 @@ typedef struct {
   StIconInfo *icon_info;
   StIconColors *colors;
   GFile *file;
+
+  StTextureCachePriority priority;
+  GList *pending_link; /* in pending_loads while waiting for a slot */
+
+  char *bitmap_cache_key; /* to store the decoded icon on disk, if set */
+
+  /* Loaded for st_texture_cache_load_file_to_cogl_texture() without
+   * blocking, which is announced with texture-file-changed */
+  gboolean notify_file_loaded;
 } AsyncTextureLoadData;
 
+static GQuark
+get_request_quark (void)
+{
+  static GQuark quark = 0;
+
+  if (G_UNLIKELY (quark == 0))
+    quark = g_quark_from_static_string ("st-texture-cache-request");
+
+  return quark;
+}
+
+static GQuark
+get_priority_quark (void)
+{
+  static GQuark quark = 0;
+
+  if (G_UNLIKELY (quark == 0))
+    quark = g_quark_from_static_string ("st-texture-cache-priority");
+
+  return quark;
+}
+
+/* A request shared by several actors runs at the most urgent priority
+ * any of them asked for */
+static void
+update_request_priority (StTextureCache       *cache,
+                         AsyncTextureLoadData *data)
+{
+  StTextureCachePriority priority = ST_TEXTURE_CACHE_PRIORITY_BACKGROUND;
+  GSList *l;
+
+  for (l = data->actors; l; l = l->next)
+    {
+      StTextureCachePriority actor_priority =
+        GPOINTER_TO_UINT (g_object_get_qdata (l->data, get_priority_quark ()));
+
+      priority = MIN (priority, actor_priority);
+    }
+
+  if (priority == data->priority)
+    return;
+
+  if (data->pending_link)
+    {
+      g_queue_unlink (&cache->priv->pending_loads[data->priority],
+                      data->pending_link);
+      g_queue_push_tail_link (&cache->priv->pending_loads[priority],
+                              data->pending_link);
+    }
+
+  data->priority = priority;
+}
+
 static void
 texture_load_data_free (gpointer p)
 {
   AsyncTextureLoadData *data = p;
+  GSList *l;
+
+  for (l = data->actors; l; l = l->next)
+    g_object_set_qdata (l->data, get_request_quark (), NULL);
 
   if (data->icon_info)
     {
@@ -312,6 +751,8 @@ texture_load_data_free (gpointer p)
   if (data->key)
     g_free (data->key);
 
+  g_free (data->bitmap_cache_key);
+
   if (data->actors)
     g_slist_free_full (data->actors, (GDestroyNotify) g_object_unref);
 
@@ -353,20 +794,22 @@ on_image_size_prepared (GdkPixbufLoader *pixbuf_loader,
                               scaled_height * scale_factor);
 }
 
+/* Feeds the loader as the file is read, so that the whole file never
+ * needs to be in memory. Loaders produce the size picked by
+ * on_image_size_prepared(), which the JPEG loader gets to with DCT
+ * scaling rather than by decoding in full. */
 static GdkPixbuf *
-impl_load_pixbuf_data (const guchar   *data,
-                       gsize           size,
-                       int             available_width,
-                       int             available_height,
-                       int             scale,
-                       GError        **error)
+decode_pixbuf_stream (GInputStream  *stream,
+                      int            available_width,
+                      int            available_height,
+                      int            scale,
+                      GCancellable  *cancellable,
+                      GError       **error)
 {
-  GdkPixbufLoader *pixbuf_loader = NULL;
-  GdkPixbuf *rotated_pixbuf = NULL;
-  GdkPixbuf *pixbuf;
-  gboolean success;
+  g_autoptr (GdkPixbufLoader) pixbuf_loader = NULL;
+  g_autofree guchar *buffer = NULL;
   Dimensions available_dimensions;
-  int width_before_rotation, width_after_rotation;
+  gssize n_read;
 
   pixbuf_loader = gdk_pixbuf_loader_new ();
 
@@ -376,57 +819,44 @@ impl_load_pixbuf_data (const guchar   *data,
   g_signal_connect (pixbuf_loader, "size-prepared",
                     G_CALLBACK (on_image_size_prepared), &available_dimensions);
 
-  success = gdk_pixbuf_loader_write (pixbuf_loader, data, size, error);
-  if (!success)
-    goto out;
-  success = gdk_pixbuf_loader_close (pixbuf_loader, error);
-  if (!success)
-    goto out;
-
-  pixbuf = gdk_pixbuf_loader_get_pixbuf (pixbuf_loader);
-
-  width_before_rotation = gdk_pixbuf_get_width (pixbuf);
-
-  rotated_pixbuf = gdk_pixbuf_apply_embedded_orientation (pixbuf);
-  width_after_rotation = gdk_pixbuf_get_width (rotated_pixbuf);
+  buffer = g_malloc (LOAD_CHUNK_SIZE);
 
-  /* There is currently no way to tell if the pixbuf will need to be rotated before it is loaded,
-   * so we only check that once it is loaded, and reload it again if it needs to be rotated in order
-   * to use the available width and height correctly.
-   * See http://bugzilla.gnome.org/show_bug.cgi?id=579003
-   */
-  if (width_before_rotation != width_after_rotation)
+  while ((n_read = g_input_stream_read (stream, buffer, LOAD_CHUNK_SIZE,
+                                        cancellable, error)) > 0)
     {
-      g_object_unref (pixbuf_loader);
-      g_object_unref (rotated_pixbuf);
-      rotated_pixbuf = NULL;
+      if (!gdk_pixbuf_loader_write (pixbuf_loader, buffer, n_read, error))
+        break;
+    }
 
-      pixbuf_loader = gdk_pixbuf_loader_new ();
+  if (n_read != 0)
+    {
+      gdk_pixbuf_loader_close (pixbuf_loader, NULL);
+      return NULL;
+    }
 
-      /* We know that the image will later be rotated, so we reverse the available dimensions. */
-      available_dimensions.width = available_height;
-      available_dimensions.height = available_width;
-      available_dimensions.scale = scale;
-      g_signal_connect (pixbuf_loader, "size-prepared",
-                        G_CALLBACK (on_image_size_prepared), &available_dimensions);
-
-      success = gdk_pixbuf_loader_write (pixbuf_loader, data, size, error);
-      if (!success)
-        goto out;
+  if (!gdk_pixbuf_loader_close (pixbuf_loader, error))
+    return NULL;
 
-      success = gdk_pixbuf_loader_close (pixbuf_loader, error);
-      if (!success)
-        goto out;
+  return g_object_ref (gdk_pixbuf_loader_get_pixbuf (pixbuf_loader));
+}
 
-      pixbuf = gdk_pixbuf_loader_get_pixbuf (pixbuf_loader);
+static GdkPixbuf *
+decode_pixbuf_file (GFile         *file,
+                    int            available_width,
+                    int            available_height,
+                    int            scale,
+                    GCancellable  *cancellable,
+                    GError       **error)
+{
+  g_autoptr (GFileInputStream) stream = NULL;
 
-      rotated_pixbuf = gdk_pixbuf_apply_embedded_orientation (pixbuf);
-    }
+  stream = g_file_read (file, cancellable, error);
+  if (stream == NULL)
+    return NULL;
 
-out:
-  if (pixbuf_loader)
-    g_object_unref (pixbuf_loader);
-  return rotated_pixbuf;
+  return decode_pixbuf_stream (G_INPUT_STREAM (stream),
+                               available_width, available_height,
+                               scale, cancellable, error);
 }
 
 static GdkPixbuf *
@@ -435,24 +865,44 @@ impl_load_pixbuf_file (GFile          *file,
                        int             available_height,
                        int             paint_scale,
                        float           resource_scale,
+                       GCancellable   *cancellable,
                        GError        **error)
 {
-  GdkPixbuf *pixbuf = NULL;
-  char *contents = NULL;
-  gsize size;
+  g_autoptr (GdkPixbuf) pixbuf = NULL;
+  GdkPixbuf *rotated_pixbuf;
+  int width_before_rotation, width_after_rotation;
+  int scale = ceilf (paint_scale * resource_scale);
+
+  pixbuf = decode_pixbuf_file (file, available_width, available_height,
+                               scale, cancellable, error);
+  if (pixbuf == NULL)
+    return NULL;
+
+  width_before_rotation = gdk_pixbuf_get_width (pixbuf);
+
+  rotated_pixbuf = gdk_pixbuf_apply_embedded_orientation (pixbuf);
+  width_after_rotation = gdk_pixbuf_get_width (rotated_pixbuf);
 
-  if (g_file_load_contents (file, NULL, &contents, &size, NULL, error))
+  /* There is currently no way to tell if the pixbuf will need to be rotated before it is loaded,
+   * so we only check that once it is loaded, and reload it again if it needs to be rotated in order
+   * to use the available width and height correctly.
+   * See http://bugzilla.gnome.org/show_bug.cgi?id=579003
+   */
+  if (width_before_rotation != width_after_rotation)
     {
-      int scale = ceilf (paint_scale * resource_scale);
-      pixbuf = impl_load_pixbuf_data ((const guchar *) contents, size,
-                                      available_width, available_height,
-                                      scale,
-                                      error);
-    }
+      g_clear_object (&rotated_pixbuf);
+      g_clear_object (&pixbuf);
+
+      /* We know that the image will later be rotated, so we reverse the available dimensions. */
+      pixbuf = decode_pixbuf_file (file, available_height, available_width,
+                                   scale, cancellable, error);
+      if (pixbuf == NULL)
+        return NULL;
 
-  g_free (contents);
+      rotated_pixbuf = gdk_pixbuf_apply_embedded_orientation (pixbuf);
+    }
 
-  return pixbuf;
+  return rotated_pixbuf;
 }
 
 static void
@@ -470,7 +920,7 @@ load_pixbuf_thread (GTask        *result,
 
   pixbuf = impl_load_pixbuf_file (data->file, data->width, data->height,
                                   data->paint_scale, data->resource_scale,
-                                  &error);
+                                  cancellable, &error);
 
   if (error != NULL)
     g_task_return_error (result, error);
@@ -486,51 +936,65 @@ load_pixbuf_async_finish (StTextureCache *cache, GAsyncResult *result, GError **
   return g_task_propagate_pointer (G_TASK (result), error);
 }
 
-static ClutterContent *
-pixbuf_to_st_content_image (GdkPixbuf *pixbuf,
-                            int        width,
-                            int        height,
-                            int        paint_scale,
-                            float      resource_scale)
+static void
+get_image_preferred_size (GdkPixbuf *pixbuf,
+                          int       *width,
+                          int       *height,
+                          int        paint_scale,
+                          float      resource_scale)
 {
-  ClutterContent *image;
-  g_autoptr(GError) error = NULL;
-
   float native_width, native_height;
 
   native_width = ceilf (gdk_pixbuf_get_width (pixbuf) / resource_scale);
   native_height = ceilf (gdk_pixbuf_get_height (pixbuf) / resource_scale);
 
-  if (width < 0 && height < 0)
+  if (*width < 0 && *height < 0)
     {
-      width = native_width;
-      height = native_height;
+      *width = native_width;
+      *height = native_height;
     }
-  else if (width < 0)
+  else if (*width < 0)
     {
-      height *= paint_scale;
-      width = native_width * (height / native_height);
+      *height *= paint_scale;
+      *width = native_width * (*height / native_height);
     }
-  else if (height < 0)
+  else if (*height < 0)
     {
-      width *= paint_scale;
-      height = native_height * (width / native_width);
+      *width *= paint_scale;
+      *height = native_height * (*width / native_width);
     }
   else
     {
-      width *= paint_scale;
-      height *= paint_scale;
+      *width *= paint_scale;
+      *height *= paint_scale;
     }
+}
 
-  image = st_image_content_new_with_preferred_size (width, height);
-  clutter_image_set_data (CLUTTER_IMAGE (image),
-                          gdk_pixbuf_get_pixels (pixbuf),
-                          gdk_pixbuf_get_has_alpha (pixbuf) ?
-                            COGL_PIXEL_FORMAT_RGBA_8888 : COGL_PIXEL_FORMAT_RGB_888,
-                          gdk_pixbuf_get_width (pixbuf),
-                          gdk_pixbuf_get_height (pixbuf),
-                          gdk_pixbuf_get_rowstride (pixbuf),
-                          &error);
+static ClutterContent *
+pixbuf_to_st_content_image (GdkPixbuf *pixbuf,
+                            int        width,
+                            int        height,
+                            int        paint_scale,
+                            float      resource_scale)
+{
+  ClutterContent *image;
+  g_autoptr(GError) error = NULL;
+
+  get_image_preferred_size (pixbuf, &width, &height,
+                            paint_scale, resource_scale);
+
+  /* Upload straight from the decoded pixels; unlike get_pixels(),
+   * read_pixels() doesn't duplicate pixbufs wrapping read-only data,
+   * such as the mapped icon bitmap cache */
+  image = st_image_content_new_with_preferred_size (width, height);
+  clutter_image_set_data (CLUTTER_IMAGE (image),
+                          gdk_pixbuf_read_pixels (pixbuf),
+                          gdk_pixbuf_get_has_alpha (pixbuf) ?
+                            COGL_PIXEL_FORMAT_RGBA_8888 : COGL_PIXEL_FORMAT_RGB_888,
+                          gdk_pixbuf_get_width (pixbuf),
+                          gdk_pixbuf_get_height (pixbuf),
+                          gdk_pixbuf_get_rowstride (pixbuf),
+                          &error);
 
   if (error)
     {
@@ -546,7 +1010,8 @@ util_cairo_surface_paint_pixbuf (cairo_surface_t *surface,
                                  const GdkPixbuf *pixbuf)
 {
   int width, height;
-  guchar *gdk_pixels, *cairo_pixels;
+  const guchar *gdk_pixels;
+  guchar *cairo_pixels;
   int gdk_rowstride, cairo_stride;
   int n_channels;
   int j;
@@ -566,7 +1031,7 @@ util_cairo_surface_paint_pixbuf (cairo_surface_t *surface,
 
   width = gdk_pixbuf_get_width (pixbuf);
   height = gdk_pixbuf_get_height (pixbuf);
-  gdk_pixels = gdk_pixbuf_get_pixels (pixbuf);
+  gdk_pixels = gdk_pixbuf_read_pixels (pixbuf);
   gdk_rowstride = gdk_pixbuf_get_rowstride (pixbuf);
   n_channels = gdk_pixbuf_get_n_channels (pixbuf);
   cairo_stride = cairo_image_surface_get_stride (surface);
@@ -574,12 +1039,12 @@ util_cairo_surface_paint_pixbuf (cairo_surface_t *surface,
 
   for (j = height; j; j--)
     {
-      guchar *p = gdk_pixels;
+      const guchar *p = gdk_pixels;
       guchar *q = cairo_pixels;
 
       if (n_channels == 3)
         {
-          guchar *end = p + 3 * width;
+          const guchar *end = p + 3 * width;
 
           while (p < end)
             {
@@ -598,7 +1063,7 @@ util_cairo_surface_paint_pixbuf (cairo_surface_t *surface,
         }
       else
         {
-          guchar *end = p + 4 * width;
+          const guchar *end = p + 4 * width;
           guint t1,t2,t3;
 
 #define MULT(d,c,a,t) G_STMT_START { t = c * a + 0x80; d = ((t >> 8) + t) >> 8; } G_STMT_END
@@ -631,11 +1096,10 @@ util_cairo_surface_paint_pixbuf (cairo_surface_t *surface,
   cairo_surface_mark_dirty (surface);
 }
 
-static void
-util_cairo_set_source_pixbuf (cairo_t         *cr,
-                              const GdkPixbuf *pixbuf,
-                              gdouble          pixbuf_x,
-                              gdouble          pixbuf_y)
+/* Converts the pixbuf straight into the surface handed out, in a single
+ * pass over the pixels */
+static cairo_surface_t *
+pixbuf_to_cairo_surface (GdkPixbuf *pixbuf)
 {
   cairo_format_t format;
   cairo_surface_t *surface;
@@ -645,38 +1109,42 @@ util_cairo_set_source_pixbuf (cairo_t         *cr,
   else
     format = CAIRO_FORMAT_ARGB32;
 
-  surface = cairo_surface_create_similar_image (cairo_get_target (cr),
-                                                format,
-                                                gdk_pixbuf_get_width (pixbuf),
-                                                gdk_pixbuf_get_height (pixbuf));
+  surface = cairo_image_surface_create (format,
+                                        gdk_pixbuf_get_width (pixbuf),
+                                        gdk_pixbuf_get_height (pixbuf));
 
   util_cairo_surface_paint_pixbuf (surface, pixbuf);
 
-  cairo_set_source_surface (cr, surface, pixbuf_x, pixbuf_y);
-  cairo_surface_destroy (surface);
+  return surface;
 }
 
-static cairo_surface_t *
-pixbuf_to_cairo_surface (GdkPixbuf *pixbuf)
+static ClutterContent *
+create_request_image (AsyncTextureLoadData *data,
+                      GdkPixbuf            *pixbuf)
 {
-  cairo_surface_t *dummy_surface;
-  cairo_pattern_t *pattern;
-  cairo_surface_t *surface;
-  cairo_t *cr;
+  ClutterContent *image = NULL;
 
-  dummy_surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 1, 1);
+  if (data->icon_info && _st_icon_atlas_is_enabled ())
+    {
+      int width = data->width, height = data->height;
 
-  cr = cairo_create (dummy_surface);
-  util_cairo_set_source_pixbuf (cr, pixbuf, 0, 0);
-  pattern = cairo_get_source (cr);
-  cairo_pattern_get_surface (pattern, &surface);
-  cairo_surface_reference (surface);
-  cairo_destroy (cr);
-  cairo_surface_destroy (dummy_surface);
+      get_image_preferred_size (pixbuf, &width, &height,
+                                data->paint_scale, data->resource_scale);
+      image = _st_icon_atlas_create_image (pixbuf, width, height);
+    }
 
-  return surface;
+  if (image == NULL)
+    image = pixbuf_to_st_content_image (pixbuf,
+                                        data->width, data->height,
+                                        data->paint_scale,
+                                        data->resource_scale);
+
+  return image;
 }
 
+static void hash_table_insert_scale (GHashTable *hash,
+                                     double      scale);
+
 static void
 finish_texture_load (AsyncTextureLoadData *data,
                      GdkPixbuf            *pixbuf)
@@ -692,6 +1160,9 @@ finish_texture_load (AsyncTextureLoadData *data,
   if (pixbuf == NULL)
     goto out;
 
+  if (data->bitmap_cache_key)
+    _st_icon_bitmap_cache_insert (data->bitmap_cache_key, pixbuf);
+
   if (data->policy != ST_TEXTURE_CACHE_POLICY_NONE)
     {
       gpointer orig_key = NULL, value = NULL;
@@ -699,27 +1170,22 @@ finish_texture_load (AsyncTextureLoadData *data,
       if (!g_hash_table_lookup_extended (cache->priv->keyed_cache, data->key,
                                          &orig_key, &value))
         {
-          image = pixbuf_to_st_content_image (pixbuf,
-                                              data->width, data->height,
-                                              data->paint_scale,
-                                              data->resource_scale);
+          image = create_request_image (data, pixbuf);
           if (!image)
             goto out;
 
-          g_hash_table_insert (cache->priv->keyed_cache, g_strdup (data->key),
-                               g_object_ref (image));
+          insert_cached (cache, cache->priv->keyed_cache, data->key,
+                         g_object_ref (image));
         }
       else
         {
           image = g_object_ref (value);
+          touch_cached (cache, data->key);
         }
     }
   else
     {
-      image = pixbuf_to_st_content_image (pixbuf,
-                                          data->width, data->height,
-                                          data->paint_scale,
-                                          data->resource_scale);
+      image = create_request_image (data, pixbuf);
       if (!image)
         goto out;
     }
@@ -735,9 +1201,42 @@ finish_texture_load (AsyncTextureLoadData *data,
     }
 
 out:
+  if (data->notify_file_loaded)
+    {
+      hash_table_insert_scale (cache->priv->used_scales,
+                               (double) data->resource_scale);
+
+      if (image != NULL)
+        {
+          g_signal_emit (cache, signals[TEXTURE_FILE_CHANGED], 0, data->file);
+        }
+      else
+        {
+          g_autofree char *uri = g_file_get_uri (data->file);
+
+          g_warning ("Failed to load %s", uri);
+          g_hash_table_add (cache->priv->failed_file_loads, g_strdup (data->key));
+        }
+    }
+
   texture_load_data_free (data);
 }
 
+static void dispatch_pending_loads (StTextureCache *cache);
+
+static void
+finish_running_load (AsyncTextureLoadData *data,
+                     GdkPixbuf            *pixbuf)
+{
+  StTextureCache *cache = data->cache;
+
+  finish_texture_load (data, pixbuf);
+
+  g_assert (cache->priv->n_running_loads > 0);
+  cache->priv->n_running_loads--;
+  dispatch_pending_loads (cache);
+}
+
 static void
 on_symbolic_icon_loaded (GObject      *source,
                          GAsyncResult *result,
@@ -745,7 +1244,7 @@ on_symbolic_icon_loaded (GObject      *source,
 {
   GdkPixbuf *pixbuf;
   pixbuf = st_icon_info_load_symbolic_finish (ST_ICON_INFO (source), result, NULL, NULL);
-  finish_texture_load (user_data, pixbuf);
+  finish_running_load (user_data, pixbuf);
   g_clear_object (&pixbuf);
 }
 
@@ -756,7 +1255,7 @@ on_icon_loaded (GObject      *source,
 {
   GdkPixbuf *pixbuf;
   pixbuf = st_icon_info_load_icon_finish (ST_ICON_INFO (source), result, NULL);
-  finish_texture_load (user_data, pixbuf);
+  finish_running_load (user_data, pixbuf);
   g_clear_object (&pixbuf);
 }
 
@@ -767,14 +1266,16 @@ on_pixbuf_loaded (GObject      *source,
 {
   GdkPixbuf *pixbuf;
   pixbuf = load_pixbuf_async_finish (ST_TEXTURE_CACHE (source), result, NULL);
-  finish_texture_load (user_data, pixbuf);
+  finish_running_load (user_data, pixbuf);
   g_clear_object (&pixbuf);
 }
 
 static void
-load_texture_async (StTextureCache       *cache,
+start_texture_load (StTextureCache       *cache,
                     AsyncTextureLoadData *data)
 {
+  cache->priv->n_running_loads++;
+
   if (data->file)
     {
       GTask *task = g_task_new (cache, NULL, on_pixbuf_loaded, data);
@@ -803,6 +1304,55 @@ load_texture_async (StTextureCache       *cache,
     g_assert_not_reached ();
 }
 
+static void
+dispatch_pending_loads (StTextureCache *cache)
+{
+  StTextureCachePrivate *priv = cache->priv;
+  int i;
+
+  for (i = 0; i < N_LOAD_PRIORITIES; i++)
+    {
+      while (priv->n_running_loads < MAX_RUNNING_LOADS &&
+             !g_queue_is_empty (&priv->pending_loads[i]))
+        {
+          AsyncTextureLoadData *data = g_queue_pop_head (&priv->pending_loads[i]);
+
+          data->pending_link = NULL;
+          start_texture_load (cache, data);
+        }
+    }
+}
+
+static gboolean
+dispatch_pending_loads_idle (gpointer user_data)
+{
+  StTextureCache *cache = user_data;
+
+  cache->priv->dispatch_id = 0;
+  dispatch_pending_loads (cache);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Loads are started from an idle, so that callers get the chance to
+ * adjust the priority of the actors they were just handed */
+static void
+load_texture_async (StTextureCache       *cache,
+                    AsyncTextureLoadData *data)
+{
+  GQueue *queue = &cache->priv->pending_loads[data->priority];
+
+  g_queue_push_tail (queue, data);
+  data->pending_link = g_queue_peek_tail_link (queue);
+
+  if (cache->priv->dispatch_id == 0)
+    {
+      cache->priv->dispatch_id = g_idle_add (dispatch_pending_loads_idle, cache);
+      g_source_set_name_by_id (cache->priv->dispatch_id,
+                               "[gnome-shell] dispatch_pending_loads");
+    }
+}
+
 static void
 st_texture_cache_load_surface (ClutterContent  **image,
                                cairo_surface_t  *surface)
@@ -892,7 +1442,11 @@ st_texture_cache_load (StTextureCache       *cache,
     {
       texture = load (cache, key, data, error);
       if (texture && policy == ST_TEXTURE_CACHE_POLICY_FOREVER)
-        g_hash_table_insert (cache->priv->keyed_cache, g_strdup (key), texture);
+        insert_cached (cache, cache->priv->keyed_cache, key, texture);
+    }
+  else
+    {
+      touch_cached (cache, key);
     }
 
   if (texture && policy == ST_TEXTURE_CACHE_POLICY_FOREVER)
@@ -932,6 +1486,7 @@ ensure_request (StTextureCache        *cache,
     {
       /* We had this cached already, just set the texture and we're done. */
       set_content_from_image (actor, image);
+      touch_cached (cache, key);
       return TRUE;
     }
 
@@ -950,38 +1505,185 @@ ensure_request (StTextureCache        *cache,
 
   /* Regardless of whether there was a pending request, prepend our texture here. */
   (*request)->actors = g_slist_prepend ((*request)->actors, g_object_ref (actor));
+  g_object_set_qdata (G_OBJECT (actor), get_request_quark (), *request);
+  update_request_priority (cache, *request);
 
   return had_pending;
 }
 
+/* When enabled by setting ST_ICON_GPU_RECOLOR=1 in the environment,
+ * symbolic icons are loaded once as a mask in the colors of the
+ * .symbolic.png format, and every actor gets the colors of its theme
+ * node applied in a shader. That way one texture serves all color
+ * sets, and switching colors, as on hover, always hits the cache.
+ */
+static gboolean
+use_gpu_recolor (void)
+{
+  static int enabled = -1;
+
+  if (G_UNLIKELY (enabled < 0))
+    enabled = g_strcmp0 (g_getenv ("ST_ICON_GPU_RECOLOR"), "1") == 0;
+
+  return enabled;
+}
+
+static StIconColors *
+get_mask_colors (void)
+{
+  static StIconColors *mask_colors = NULL;
+
+  if (G_UNLIKELY (mask_colors == NULL))
+    {
+      mask_colors = st_icon_colors_new ();
+      cogl_color_init_from_4f (&mask_colors->foreground, 0.0, 0.0, 0.0, 1.0);
+      cogl_color_init_from_4f (&mask_colors->success, 1.0, 0.0, 0.0, 1.0);
+      cogl_color_init_from_4f (&mask_colors->warning, 0.0, 1.0, 0.0, 1.0);
+      cogl_color_init_from_4f (&mask_colors->error, 0.0, 0.0, 1.0, 1.0);
+    }
+
+  return mask_colors;
+}
+
+static GQuark
+get_gicon_string_quark (void)
+{
+  static GQuark quark = 0;
+
+  if (G_UNLIKELY (quark == 0))
+    quark = g_quark_from_static_string ("st-texture-cache-gicon-string");
+
+  return quark;
+}
+
+/* Like g_icon_to_string(), but also identifies image data by its
+ * contents, which is what serialized StImageContents and pixbufs turn
+ * into, so that identical images are decoded and uploaded only once */
+static char *
+compute_gicon_cache_string (GIcon *icon)
+{
+  if (G_IS_BYTES_ICON (icon))
+    {
+      g_autofree char *checksum = NULL;
+
+      checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256,
+                                               g_bytes_icon_get_bytes (G_BYTES_ICON (icon)));
+      return g_strconcat ("bytes:", checksum, NULL);
+    }
+
+  return g_icon_to_string (icon);
+}
+
+/* The same icon object, like the one of an app, is usually loaded by
+ * many actors and again on every style change, so remember its string
+ * rather than serializing it, or checksumming its data, each time.
+ * Emblemed icons can still get emblems added, so they are left out. */
+static char *
+get_gicon_cache_string (GIcon *icon)
+{
+  char *str;
+
+  if (G_IS_EMBLEMED_ICON (icon))
+    return compute_gicon_cache_string (icon);
+
+  str = g_object_get_qdata (G_OBJECT (icon), get_gicon_string_quark ());
+  if (str == NULL)
+    {
+      str = compute_gicon_cache_string (icon);
+      if (str == NULL)
+        return NULL;
+
+      g_object_set_qdata_full (G_OBJECT (icon), get_gicon_string_quark (),
+                               str, g_free);
+    }
+
+  return g_strdup (str);
+}
+
+static ClutterActor *
+load_image_content (GIcon *icon,
+                    float  actor_size)
+{
+  int width, height;
+
+  g_object_get (G_OBJECT (icon),
+                "preferred-width", &width,
+                "preferred-height", &height,
+                NULL);
+  if (width == 0 && height == 0)
+    return NULL;
+
+  return g_object_new (CLUTTER_TYPE_ACTOR,
+                       "content-gravity", CLUTTER_CONTENT_GRAVITY_RESIZE_ASPECT,
+                       "width", actor_size,
+                       "height", actor_size,
+                       "content", CLUTTER_CONTENT (icon),
+                       NULL);
+}
+
+static char *
+get_gicon_cache_key (GIcon         *icon,
+                     gint           size,
+                     gint           scale,
+                     StIconStyle    icon_style,
+                     StIconColors  *colors,
+                     gboolean      *cacheable)
+{
+  g_autofree char *gicon_string = NULL;
+
+  gicon_string = get_gicon_cache_string (icon);
+  *cacheable = gicon_string != NULL;
+
+  if (colors)
+    {
+      /* This raises some doubts about the practice of using string keys */
+      return g_strdup_printf (CACHE_PREFIX_ICON "%s,size=%d,scale=%d,style=%d,colors=%2x%2x%2x%2x,%2x%2x%2x%2x,%2x%2x%2x%2x,%2x%2x%2x%2x",
+                              gicon_string, size, scale, icon_style,
+                              colors->foreground.red, colors->foreground.blue, colors->foreground.green, colors->foreground.alpha,
+                              colors->warning.red, colors->warning.blue, colors->warning.green, colors->warning.alpha,
+                              colors->error.red, colors->error.blue, colors->error.green, colors->error.alpha,
+                              colors->success.red, colors->success.blue, colors->success.green, colors->success.alpha);
+    }
+  else
+    {
+      return g_strdup_printf (CACHE_PREFIX_ICON "%s,size=%d,scale=%d,style=%d",
+                              gicon_string, size, scale, icon_style);
+    }
+}
+
 /**
- * st_texture_cache_load_gicon:
+ * st_texture_cache_load_gicon_with_fallbacks:
  * @cache: A #StTextureCache
  * @theme_node: (nullable): The #StThemeNode to use for colors, or %NULL
  *                            if the icon must not be recolored
- * @icon: the #GIcon to load
+ * @icons: (array length=n_icons): the #GIcons to try, in order
+ * @n_icons: the number of icons in @icons
  * @size: Size of themed
  * @paint_scale: Scale factor of display
  * @resource_scale: Resource scale factor
+ * @chosen: (out) (optional): return location for the index of the icon
+ *   in @icons that was found
  *
- * This method returns a new #ClutterActor for a given #GIcon. If the
- * icon isn't loaded already, the texture will be filled
- * asynchronously.
+ * Like st_texture_cache_load_gicon(), but returns an actor for the first
+ * of @icons that can be found. The icons are resolved one after the other
+ * in a single pass; only the one that is found gets loaded.
  *
- * Returns: (transfer none) (nullable): A new #ClutterActor for the icon, or %NULL if not found
+ * Returns: (transfer none) (nullable): A new #ClutterActor for the icon,
+ *   or %NULL if none was found
  */
 ClutterActor *
-st_texture_cache_load_gicon (StTextureCache    *cache,
-                             StThemeNode       *theme_node,
-                             GIcon             *icon,
-                             gint               size,
-                             gint               paint_scale,
-                             gfloat             resource_scale)
+st_texture_cache_load_gicon_with_fallbacks (StTextureCache  *cache,
+                                            StThemeNode     *theme_node,
+                                            GIcon          **icons,
+                                            int              n_icons,
+                                            gint             size,
+                                            gint             paint_scale,
+                                            gfloat           resource_scale,
+                                            int             *chosen)
 {
   AsyncTextureLoadData *request;
   ClutterActor *actor;
   gint scale;
-  char *gicon_string;
   g_autofree char *key = NULL;
   float actor_size;
   StIconTheme *theme;
@@ -989,28 +1691,14 @@ st_texture_cache_load_gicon (StTextureCache    *cache,
   StIconColors *colors = NULL;
   StIconStyle icon_style = ST_ICON_STYLE_REQUESTED;
   StIconLookupFlags lookup_flags;
+  StIconColors *actor_colors = NULL;
+  StIconInfo *info = NULL;
+  GIcon *icon = NULL;
+  gboolean cacheable = FALSE;
+  int i;
 
   actor_size = size * paint_scale;
 
-  if (ST_IS_IMAGE_CONTENT (icon))
-    {
-      int width, height;
-
-      g_object_get (G_OBJECT (icon),
-                    "preferred-width", &width,
-                    "preferred-height", &height,
-                    NULL);
-      if (width == 0 && height == 0)
-        return NULL;
-
-      return g_object_new (CLUTTER_TYPE_ACTOR,
-                           "content-gravity", CLUTTER_CONTENT_GRAVITY_RESIZE_ASPECT,
-                           "width", actor_size,
-                           "height", actor_size,
-                           "content", CLUTTER_CONTENT (icon),
-                           NULL);
-    }
-
   if (theme_node)
     {
       colors = st_theme_node_get_icon_colors (theme_node);
@@ -1034,41 +1722,86 @@ st_texture_cache_load_gicon (StTextureCache    *cache,
 
   scale = ceilf (paint_scale * resource_scale);
 
-  gicon_string = g_icon_to_string (icon);
+  /* Settle on an icon before creating an actor and a request for it,
+   * which is what a lookup that fails leaves behind otherwise */
+  for (i = 0; i < n_icons; i++)
+    {
+      StIconColors *icon_colors = colors;
+
+      icon = icons[i];
+
+      if (ST_IS_IMAGE_CONTENT (icon))
+        {
+          actor = load_image_content (icon, actor_size);
+          if (actor == NULL)
+            continue;
+
+          if (chosen)
+            *chosen = i;
+          return actor;
+        }
+
+      /* Emblems would be recolored along with the icon */
+      actor_colors = NULL;
+      if (icon_colors && use_gpu_recolor () && !G_IS_EMBLEMED_ICON (icon))
+        {
+          actor_colors = icon_colors;
+          icon_colors = get_mask_colors ();
+        }
+
+      g_clear_pointer (&key, g_free);
+      key = get_gicon_cache_key (icon, size, scale, icon_style, icon_colors,
+                                 &cacheable);
+
+      /* Cached or being loaded means it was found before */
+      if (g_hash_table_contains (cache->priv->keyed_cache, key) ||
+          g_hash_table_contains (cache->priv->outstanding_requests, key))
+        {
+          colors = icon_colors;
+          break;
+        }
+
+      info = st_icon_theme_lookup_by_gicon_for_scale (theme, icon,
+                                                      size, scale,
+                                                      lookup_flags);
+      if (info != NULL)
+        {
+          colors = icon_colors;
+          break;
+        }
+    }
+
+  if (i == n_icons)
+    return NULL;
+
+  if (chosen)
+    *chosen = i;
+
   /* A return value of NULL indicates that the icon can not be serialized,
    * so don't have a unique identifier for it as a cache key, and thus can't
    * be cached. If it is cacheable, we hardcode a policy of FOREVER here for
    * now; we should actually blow this away on icon theme changes probably */
-  policy = gicon_string != NULL ? ST_TEXTURE_CACHE_POLICY_FOREVER
-                                : ST_TEXTURE_CACHE_POLICY_NONE;
-  if (colors)
-    {
-      /* This raises some doubts about the practice of using string keys */
-      key = g_strdup_printf (CACHE_PREFIX_ICON "%s,size=%d,scale=%d,style=%d,colors=%2x%2x%2x%2x,%2x%2x%2x%2x,%2x%2x%2x%2x,%2x%2x%2x%2x",
-                             gicon_string, size, scale, icon_style,
-                             colors->foreground.red, colors->foreground.blue, colors->foreground.green, colors->foreground.alpha,
-                             colors->warning.red, colors->warning.blue, colors->warning.green, colors->warning.alpha,
-                             colors->error.red, colors->error.blue, colors->error.green, colors->error.alpha,
-                             colors->success.red, colors->success.blue, colors->success.green, colors->success.alpha);
-    }
-  else
-    {
-      key = g_strdup_printf (CACHE_PREFIX_ICON "%s,size=%d,scale=%d,style=%d",
-                             gicon_string, size, scale, icon_style);
-    }
-  g_free (gicon_string);
+  policy = cacheable ? ST_TEXTURE_CACHE_POLICY_FOREVER
+                     : ST_TEXTURE_CACHE_POLICY_NONE;
 
   actor = create_invisible_actor ();
   clutter_actor_set_content_gravity  (actor, CLUTTER_CONTENT_GRAVITY_RESIZE_ASPECT);
   clutter_actor_set_size (actor, actor_size, actor_size);
-  if (!ensure_request (cache, key, policy, &request, actor))
+  if (actor_colors)
+    g_object_set_qdata_full (G_OBJECT (actor), get_icon_colors_quark (),
+                             st_icon_colors_ref (actor_colors),
+                             (GDestroyNotify) st_icon_colors_unref);
+  if (ensure_request (cache, key, policy, &request, actor))
+    {
+      g_clear_object (&info);
+    }
+  else
     {
       /* Else, make a new request */
-      StIconInfo *info;
-
-      info = st_icon_theme_lookup_by_gicon_for_scale (theme, icon,
-                                                      size, scale,
-                                                      lookup_flags);
+      if (info == NULL)
+        info = st_icon_theme_lookup_by_gicon_for_scale (theme, icon,
+                                                        size, scale,
+                                                        lookup_flags);
       if (info == NULL)
         {
           g_hash_table_remove (cache->priv->outstanding_requests, key);
@@ -1087,12 +1820,64 @@ st_texture_cache_load_gicon (StTextureCache    *cache,
       request->paint_scale = paint_scale;
       request->resource_scale = resource_scale;
 
+      if (policy == ST_TEXTURE_CACHE_POLICY_FOREVER &&
+          _st_icon_bitmap_cache_is_enabled ())
+        {
+          g_autoptr (GdkPixbuf) pixbuf = NULL;
+
+          request->bitmap_cache_key =
+            _st_icon_bitmap_cache_get_key (st_icon_info_get_filename (info),
+                                           request->key);
+          if (request->bitmap_cache_key)
+            pixbuf = _st_icon_bitmap_cache_lookup (request->bitmap_cache_key);
+
+          if (pixbuf)
+            {
+              /* Decoded in a previous session, no need to wait */
+              g_clear_pointer (&request->bitmap_cache_key, g_free);
+              finish_texture_load (request, pixbuf);
+              return actor;
+            }
+        }
+
       load_texture_async (cache, request);
     }
 
   return actor;
 }
 
+/**
+ * st_texture_cache_load_gicon:
+ * @cache: A #StTextureCache
+ * @theme_node: (nullable): The #StThemeNode to use for colors, or %NULL
+ *                            if the icon must not be recolored
+ * @icon: the #GIcon to load
+ * @size: Size of themed
+ * @paint_scale: Scale factor of display
+ * @resource_scale: Resource scale factor
+ *
+ * This method returns a new #ClutterActor for a given #GIcon. If the
+ * icon isn't loaded already, the texture will be filled
+ * asynchronously.
+ *
+ * Returns: (transfer none) (nullable): A new #ClutterActor for the icon, or %NULL if not found
+ */
+ClutterActor *
+st_texture_cache_load_gicon (StTextureCache    *cache,
+                             StThemeNode       *theme_node,
+                             GIcon             *icon,
+                             gint               size,
+                             gint               paint_scale,
+                             gfloat             resource_scale)
+{
+  return st_texture_cache_load_gicon_with_fallbacks (cache, theme_node,
+                                                     &icon, 1,
+                                                     size,
+                                                     paint_scale,
+                                                     resource_scale,
+                                                     NULL);
+}
+
 static ClutterActor *
 load_from_pixbuf (GdkPixbuf *pixbuf,
                   int        paint_scale,
@@ -1149,7 +1934,8 @@ file_changed_cb (GFileMonitor      *monitor,
                  GFileMonitorEvent  event_type,
                  gpointer           user_data)
 {
-  StTextureCache *cache = user_data;
+  DirectoryMonitor *directory = user_data;
+  StTextureCache *cache = directory->cache;
   char *key;
   guint file_hash;
   g_autoptr (GList) scales = NULL;
@@ -1157,12 +1943,17 @@ file_changed_cb (GFileMonitor      *monitor,
   if (event_type != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT)
     return;
 
+  /* Most of the files in a directory were never loaded */
+  if (!g_hash_table_contains (directory->files, file))
+    return;
+
   file_hash = g_file_hash (file);
   scales = g_hash_table_get_keys (cache->priv->used_scales);
 
   key = g_strdup_printf (CACHE_PREFIX_FILE "%u", file_hash);
   g_hash_table_remove (cache->priv->keyed_cache, key);
   hash_table_remove_with_scales (cache->priv->keyed_cache, scales, key);
+  hash_table_remove_with_scales (cache->priv->failed_file_loads, scales, key);
   g_free (key);
 
   key = g_strdup_printf (CACHE_PREFIX_FILE_FOR_CAIRO "%u", file_hash);
@@ -1173,11 +1964,27 @@ file_changed_cb (GFileMonitor      *monitor,
   g_signal_emit (cache, signals[TEXTURE_FILE_CHANGED], 0, file);
 }
 
+/*
+ * ensure_monitor_for_file:
+ * @cache: A #StTextureCache
+ * @file: the file that was loaded
+ * @key: (nullable): the key @file was cached under, or %NULL if it isn't
+ *
+ * Files are watched through a monitor of their directory that is shared
+ * with the other loaded files there, rather than one monitor each. Files
+ * that are cached are only watched while they have entries in the cache,
+ * other files are watched for good so that #StTextureCache::texture-file-changed
+ * keeps being emitted for them.
+ */
 static void
 ensure_monitor_for_file (StTextureCache *cache,
-                         GFile          *file)
+                         GFile          *file,
+                         const char     *key)
 {
   StTextureCachePrivate *priv = cache->priv;
+  DirectoryMonitor *directory;
+  MonitoredFile *monitored;
+  g_autoptr (GFile) parent = NULL;
 
   /* No point in trying to monitor files that are part of a
    * GResource, since it does not support file monitoring.
@@ -1185,23 +1992,103 @@ ensure_monitor_for_file (StTextureCache *cache,
   if (g_file_has_uri_scheme (file, "resource"))
     return;
 
-  if (g_hash_table_lookup (priv->file_monitors, file) == NULL)
+  if (key && g_hash_table_contains (priv->monitored_keys, key))
+    return;
+
+  parent = g_file_get_parent (file);
+  if (parent == NULL)
+    return;
+
+  directory = g_hash_table_lookup (priv->directory_monitors, parent);
+  if (directory == NULL)
     {
-      GFileMonitor *monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE,
-                                                   NULL, NULL);
-      g_signal_connect (monitor, "changed",
-                        G_CALLBACK (file_changed_cb), cache);
-      g_hash_table_insert (priv->file_monitors, g_object_ref (file), monitor);
+      directory = g_new0 (DirectoryMonitor, 1);
+      directory->cache = cache;
+      directory->files = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                                g_object_unref, g_free);
+      /* Keep the entry even if the directory can't be monitored,
+       * so that it isn't tried again for every file */
+      directory->monitor = g_file_monitor_directory (parent, G_FILE_MONITOR_NONE,
+                                                     NULL, NULL);
+      if (directory->monitor)
+        g_signal_connect (directory->monitor, "changed",
+                          G_CALLBACK (file_changed_cb), directory);
+
+      g_hash_table_insert (priv->directory_monitors, g_object_ref (parent), directory);
     }
-}
 
-typedef struct {
-  GFile *gfile;
-  gint   grid_width, grid_height;
-  gint   paint_scale;
-  gfloat resource_scale;
-  ClutterActor *actor;
-  GCancellable *cancellable;
+  monitored = g_hash_table_lookup (directory->files, file);
+  if (monitored == NULL)
+    {
+      monitored = g_new0 (MonitoredFile, 1);
+      g_hash_table_insert (directory->files, g_object_ref (file), monitored);
+    }
+
+  if (key)
+    {
+      g_hash_table_insert (priv->monitored_keys, g_strdup (key), g_object_ref (file));
+      monitored->n_keys++;
+    }
+  else
+    {
+      monitored->permanent = TRUE;
+    }
+}
+
+static void
+release_monitor_for_file (StTextureCache *cache,
+                          GFile          *file)
+{
+  StTextureCachePrivate *priv = cache->priv;
+  DirectoryMonitor *directory;
+  MonitoredFile *monitored;
+  g_autoptr (GFile) parent = NULL;
+
+  parent = g_file_get_parent (file);
+  directory = g_hash_table_lookup (priv->directory_monitors, parent);
+  monitored = g_hash_table_lookup (directory->files, file);
+
+  if (--monitored->n_keys > 0 || monitored->permanent)
+    return;
+
+  g_hash_table_remove (directory->files, file);
+
+  if (g_hash_table_size (directory->files) == 0)
+    g_hash_table_remove (priv->directory_monitors, parent);
+}
+
+/* Stops watching the files of cache entries that went away */
+static void
+release_unused_monitors (StTextureCache *cache)
+{
+  StTextureCachePrivate *priv = cache->priv;
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_hash_table_iter_init (&iter, priv->monitored_keys);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      g_autoptr (GFile) file = NULL;
+
+      if (g_hash_table_contains (priv->keyed_cache, key) ||
+          g_hash_table_contains (priv->keyed_surface_cache, key) ||
+          g_hash_table_contains (priv->outstanding_requests, key) ||
+          g_hash_table_contains (priv->failed_file_loads, key))
+        continue;
+
+      file = g_object_ref (value);
+      g_hash_table_iter_remove (&iter);
+      release_monitor_for_file (cache, file);
+    }
+}
+
+typedef struct {
+  GFile *gfile;
+  gint   grid_width, grid_height;
+  gint   paint_scale;
+  gfloat resource_scale;
+  ClutterActor *actor;
+  GCancellable *cancellable;
   GFunc load_callback;
   gpointer load_callback_data;
 } AsyncImageData;
@@ -1288,27 +2175,16 @@ on_loader_size_prepared (GdkPixbufLoader *loader,
   gdk_pixbuf_loader_set_size (loader, width * scale, height * scale);
 }
 
-static void
-load_sliced_image (GTask        *result,
-                   gpointer      object,
-                   gpointer      task_data,
-                   GCancellable *cancellable)
+static GdkPixbuf *
+decode_sliced_image (AsyncImageData  *data,
+                     GCancellable    *cancellable)
 {
-  AsyncImageData *data;
-  GList *res = NULL;
-  GdkPixbuf *pix;
-  gint width, height, y, x;
-  gint scale_factor;
+  GdkPixbuf *pix = NULL;
   GdkPixbufLoader *loader = NULL;
   GError *error = NULL;
   gchar *buffer = NULL;
   gsize length;
 
-  g_assert (cancellable);
-
-  data = task_data;
-  g_assert (data);
-
   if (!g_file_load_contents (data->gfile, cancellable, &buffer, &length, NULL, &error))
     {
       g_warning ("Failed to open sliced image: %s", error->message);
@@ -1327,7 +2203,36 @@ load_sliced_image (GTask        *result,
   if (!gdk_pixbuf_loader_close (loader, NULL))
     goto out;
 
-  pix = gdk_pixbuf_loader_get_pixbuf (loader);
+  pix = g_object_ref (gdk_pixbuf_loader_get_pixbuf (loader));
+
+ out:
+  g_clear_object (&loader);
+  g_free (buffer);
+  g_clear_pointer (&error, g_error_free);
+  return pix;
+}
+
+static void
+load_sliced_image (GTask        *result,
+                   gpointer      object,
+                   gpointer      task_data,
+                   GCancellable *cancellable)
+{
+  AsyncImageData *data;
+  GList *res = NULL;
+  g_autoptr (GdkPixbuf) pix = NULL;
+  gint width, height, y, x;
+  gint scale_factor;
+
+  g_assert (cancellable);
+
+  data = task_data;
+  g_assert (data);
+
+  pix = decode_sliced_image (data, cancellable);
+  if (pix == NULL)
+    goto out;
+
   width = gdk_pixbuf_get_width (pix);
   height = gdk_pixbuf_get_height (pix);
   scale_factor = ceilf (data->paint_scale * data->resource_scale);
@@ -1344,11 +2249,8 @@ load_sliced_image (GTask        *result,
     }
 
  out:
-  /* We don't need the original pixbuf anymore, which is owned by the loader,
-   * though the subpixbufs will hold a reference. */
-  g_clear_object (&loader);
-  g_free (buffer);
-  g_clear_pointer (&error, g_error_free);
+  /* We don't need the original pixbuf anymore, though the subpixbufs
+   * will hold a reference. */
   g_task_return_pointer (result, res, free_glist_unref_gobjects);
 }
 
@@ -1413,6 +2315,122 @@ st_texture_cache_load_sliced_image (StTextureCache *cache,
   return actor;
 }
 
+static void
+on_sprite_sheet_loaded (GObject      *source_object,
+                        GAsyncResult *res,
+                        gpointer      user_data)
+{
+  GObject *cache = source_object;
+  AsyncImageData *data = (AsyncImageData *)user_data;
+  GTask *task = G_TASK (res);
+  g_autoptr (GdkPixbuf) pixbuf = NULL;
+  g_autoptr (ClutterContent) image = NULL;
+  int scale_factor;
+
+  if (g_task_had_error (task) || g_cancellable_is_cancelled (data->cancellable))
+    return;
+
+  g_signal_handlers_disconnect_by_func (data->actor,
+                                        on_sliced_image_actor_destroyed,
+                                        task);
+
+  pixbuf = g_task_propagate_pointer (task, NULL);
+  if (pixbuf != NULL)
+    image = pixbuf_to_st_content_image (pixbuf, -1, -1,
+                                        data->paint_scale,
+                                        data->resource_scale);
+
+  if (image != NULL)
+    {
+      scale_factor = ceilf (data->paint_scale * data->resource_scale);
+      st_image_content_set_frames (ST_IMAGE_CONTENT (image),
+                                   data->grid_width * scale_factor,
+                                   data->grid_height * scale_factor);
+      clutter_actor_set_content (data->actor, image);
+    }
+
+  if (data->load_callback != NULL)
+    data->load_callback (cache, data->load_callback_data);
+}
+
+static void
+load_sprite_sheet (GTask        *result,
+                   gpointer      object,
+                   gpointer      task_data,
+                   GCancellable *cancellable)
+{
+  GdkPixbuf *pixbuf;
+
+  pixbuf = decode_sliced_image (task_data, cancellable);
+  g_task_return_pointer (result, pixbuf, g_object_unref);
+}
+
+/**
+ * st_texture_cache_load_sprite_sheet:
+ * @cache: A #StTextureCache
+ * @file: A #GFile
+ * @grid_width: Width in pixels
+ * @grid_height: Height in pixels
+ * @paint_scale: Scale factor of the display
+ * @resource_scale: Resource scale factor
+ * @load_callback: (scope async) (nullable): Function called when the image is loaded, or %NULL
+ * @user_data: Data to pass to the load callback
+ *
+ * Like st_texture_cache_load_sliced_image(), but rather than an actor
+ * for each image, this returns a single actor whose #StImageContent
+ * paints one of the images at a time, selected with
+ * st_image_content_set_frame(). All images share one texture.
+ *
+ * Returns: (transfer none): A new #ClutterActor
+ */
+ClutterActor *
+st_texture_cache_load_sprite_sheet (StTextureCache *cache,
+                                    GFile          *file,
+                                    gint            grid_width,
+                                    gint            grid_height,
+                                    gint            paint_scale,
+                                    gfloat          resource_scale,
+                                    GFunc           load_callback,
+                                    gpointer        user_data)
+{
+  AsyncImageData *data;
+  GTask *result;
+  ClutterActor *actor;
+  GCancellable *cancellable;
+
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_assert (paint_scale > 0);
+  g_assert (resource_scale > 0);
+
+  actor = g_object_new (CLUTTER_TYPE_ACTOR,
+                        "request-mode", CLUTTER_REQUEST_CONTENT_SIZE,
+                        NULL);
+  cancellable = g_cancellable_new ();
+
+  data = g_new0 (AsyncImageData, 1);
+  data->grid_width = grid_width;
+  data->grid_height = grid_height;
+  data->paint_scale = paint_scale;
+  data->resource_scale = resource_scale;
+  data->gfile = g_object_ref (file);
+  data->actor = g_object_ref (actor);
+  data->cancellable = cancellable;
+  data->load_callback = load_callback;
+  data->load_callback_data = user_data;
+
+  result = g_task_new (cache, cancellable, on_sprite_sheet_loaded, data);
+
+  g_signal_connect (actor, "destroy",
+                    G_CALLBACK (on_sliced_image_actor_destroyed), result);
+
+  g_task_set_task_data (result, data, on_data_destroy);
+  g_task_run_in_thread (result, load_sprite_sheet);
+
+  g_object_unref (result);
+
+  return actor;
+}
+
 /**
  * st_texture_cache_load_file_async:
  * @cache: A #StTextureCache
@@ -1471,7 +2489,8 @@ st_texture_cache_load_file_async (StTextureCache *cache,
       load_texture_async (cache, request);
     }
 
-  ensure_monitor_for_file (cache, file);
+  /* Not cached, see policy above */
+  ensure_monitor_for_file (cache, file, NULL);
 
   return actor;
 }
@@ -1499,7 +2518,8 @@ st_texture_cache_load_file_sync_to_cogl_texture (StTextureCache *cache,
   if (image == NULL)
     {
       pixbuf = impl_load_pixbuf_file (file, available_width, available_height,
-                                      paint_scale, resource_scale, error);
+                                      paint_scale, resource_scale,
+                                      NULL, error);
       if (!pixbuf)
         goto out;
 
@@ -1513,10 +2533,14 @@ st_texture_cache_load_file_sync_to_cogl_texture (StTextureCache *cache,
 
       if (policy == ST_TEXTURE_CACHE_POLICY_FOREVER)
         {
-          g_hash_table_insert (cache->priv->keyed_cache, g_strdup (key), image);
+          insert_cached (cache, cache->priv->keyed_cache, key, image);
           hash_table_insert_scale (cache->priv->used_scales, (double)resource_scale);
         }
     }
+  else
+    {
+      touch_cached (cache, key);
+    }
 
   /* Because the texture is loaded synchronously, we won't call
    * clutter_image_set_data(), so it's safe to use the texture
@@ -1524,7 +2548,8 @@ st_texture_cache_load_file_sync_to_cogl_texture (StTextureCache *cache,
   texdata = clutter_image_get_texture (CLUTTER_IMAGE (image));
   g_object_ref (texdata);
 
-  ensure_monitor_for_file (cache, file);
+  ensure_monitor_for_file (cache, file,
+                           policy == ST_TEXTURE_CACHE_POLICY_FOREVER ? key : NULL);
 
 out:
   g_free (key);
@@ -1552,7 +2577,8 @@ st_texture_cache_load_file_sync_to_cairo_surface (StTextureCache        *cache,
   if (surface == NULL)
     {
       pixbuf = impl_load_pixbuf_file (file, available_width, available_height,
-                                      paint_scale, resource_scale, error);
+                                      paint_scale, resource_scale,
+                                      NULL, error);
       if (!pixbuf)
         goto out;
 
@@ -1562,15 +2588,18 @@ st_texture_cache_load_file_sync_to_cairo_surface (StTextureCache        *cache,
       if (policy == ST_TEXTURE_CACHE_POLICY_FOREVER)
         {
           cairo_surface_reference (surface);
-          g_hash_table_insert (cache->priv->keyed_surface_cache,
-                               g_strdup (key), surface);
+          insert_cached (cache, cache->priv->keyed_surface_cache, key, surface);
           hash_table_insert_scale (cache->priv->used_scales, (double)resource_scale);
         }
     }
   else
-    cairo_surface_reference (surface);
+    {
+      cairo_surface_reference (surface);
+      touch_cached (cache, key);
+    }
 
-  ensure_monitor_for_file (cache, file);
+  ensure_monitor_for_file (cache, file,
+                           policy == ST_TEXTURE_CACHE_POLICY_FOREVER ? key : NULL);
 
 out:
   g_free (key);
@@ -1614,6 +2643,118 @@ st_texture_cache_load_file_to_cogl_texture (StTextureCache *cache,
   return texture;
 }
 
+static void
+load_file_to_cogl_texture_in_background (StTextureCache         *cache,
+                                         GFile                  *file,
+                                         gint                    paint_scale,
+                                         gfloat                  resource_scale,
+                                         StTextureCachePriority  priority)
+{
+  AsyncTextureLoadData *request;
+  char *key;
+
+  /* The key of st_texture_cache_load_file_sync_to_cogl_texture() */
+  key = g_strdup_printf (CACHE_PREFIX_FILE "%u%f", g_file_hash (file), resource_scale);
+
+  if (g_hash_table_contains (cache->priv->keyed_cache, key) ||
+      g_hash_table_contains (cache->priv->outstanding_requests, key) ||
+      g_hash_table_contains (cache->priv->failed_file_loads, key))
+    {
+      g_free (key);
+      return;
+    }
+
+  request = g_new0 (AsyncTextureLoadData, 1);
+  g_hash_table_insert (cache->priv->outstanding_requests, g_strdup (key), request);
+
+  request->cache = cache;
+  /* Transfer ownership of key */
+  request->key = key;
+  request->file = g_object_ref (file);
+  request->policy = ST_TEXTURE_CACHE_POLICY_FOREVER;
+  request->width = request->height = -1;
+  request->paint_scale = paint_scale;
+  request->resource_scale = resource_scale;
+  request->priority = priority;
+  request->notify_file_loaded = TRUE;
+
+  ensure_monitor_for_file (cache, file, key);
+
+  load_texture_async (cache, request);
+}
+
+/**
+ * st_texture_cache_try_load_file_to_cogl_texture: (skip)
+ * @cache: A #StTextureCache
+ * @file: A #GFile in supported image format
+ * @paint_scale: Scale factor of the display
+ * @resource_scale: Resource scale factor
+ *
+ * Like st_texture_cache_load_file_to_cogl_texture(), but never decodes
+ * @file on the calling thread. If it wasn't loaded before, loading
+ * starts in the background and %NULL is returned, so that the caller
+ * can paint without it for now. #StTextureCache::texture-file-changed
+ * is emitted for @file once it is loaded.
+ *
+ * Returns: (transfer full) (nullable): a new #CoglTexture, or %NULL
+ */
+CoglTexture *
+st_texture_cache_try_load_file_to_cogl_texture (StTextureCache *cache,
+                                                GFile          *file,
+                                                gint            paint_scale,
+                                                gfloat          resource_scale)
+{
+  ClutterContent *image;
+  CoglTexture *texture;
+  char *key;
+
+  key = g_strdup_printf (CACHE_PREFIX_FILE "%u%f", g_file_hash (file), resource_scale);
+  image = g_hash_table_lookup (cache->priv->keyed_cache, key);
+
+  if (image != NULL)
+    {
+      touch_cached (cache, key);
+      g_free (key);
+
+      texture = clutter_image_get_texture (CLUTTER_IMAGE (image));
+      return texture ? g_object_ref (texture) : NULL;
+    }
+
+  g_free (key);
+
+  load_file_to_cogl_texture_in_background (cache, file,
+                                           paint_scale, resource_scale,
+                                           ST_TEXTURE_CACHE_PRIORITY_VISIBLE);
+  return NULL;
+}
+
+/**
+ * st_texture_cache_prewarm_file:
+ * @cache: A #StTextureCache
+ * @file: A #GFile in supported image format
+ * @paint_scale: Scale factor of the display
+ * @resource_scale: Resource scale factor
+ *
+ * Loads @file in the background, so that a later
+ * st_texture_cache_load_file_to_cogl_texture() for it, such as for a
+ * background-image of the theme, doesn't have to wait for decoding.
+ */
+void
+st_texture_cache_prewarm_file (StTextureCache *cache,
+                               GFile          *file,
+                               gint            paint_scale,
+                               gfloat          resource_scale)
+{
+  g_return_if_fail (ST_IS_TEXTURE_CACHE (cache));
+  g_return_if_fail (G_IS_FILE (file));
+  g_return_if_fail (paint_scale > 0);
+  g_return_if_fail (resource_scale > 0);
+
+  load_file_to_cogl_texture_in_background (cache, file,
+                                           paint_scale, resource_scale,
+                                           ST_TEXTURE_CACHE_PRIORITY_PREFETCH);
+}
+
 /**
  * st_texture_cache_load_file_to_cairo_surface:
  * @cache: A #StTextureCache
@@ -1653,6 +2794,157 @@ st_texture_cache_load_file_to_cairo_surface (StTextureCache *cache,
 
 static StTextureCache *instance = NULL;
 
+/**
+ * st_texture_cache_set_load_priority:
+ * @cache: A #StTextureCache
+ * @actor: an actor returned by st_texture_cache_load_gicon() or
+ *   st_texture_cache_load_file_async()
+ * @priority: the new #StTextureCachePriority
+ *
+ * Changes how urgently the image for @actor gets loaded, for instance
+ * when it scrolls into or out of view. This has no effect once loading
+ * has started.
+ */
+void
+st_texture_cache_set_load_priority (StTextureCache         *cache,
+                                    ClutterActor           *actor,
+                                    StTextureCachePriority  priority)
+{
+  AsyncTextureLoadData *data;
+
+  g_return_if_fail (ST_IS_TEXTURE_CACHE (cache));
+  g_return_if_fail (CLUTTER_IS_ACTOR (actor));
+  g_return_if_fail (priority < N_LOAD_PRIORITIES);
+
+  g_object_set_qdata (G_OBJECT (actor), get_priority_quark (),
+                      GUINT_TO_POINTER (priority));
+
+  data = g_object_get_qdata (G_OBJECT (actor), get_request_quark ());
+  if (data)
+    update_request_priority (cache, data);
+}
+
+/**
+ * st_texture_cache_cancel_load:
+ * @cache: A #StTextureCache
+ * @actor: an actor returned by st_texture_cache_load_gicon() or
+ *   st_texture_cache_load_file_async()
+ *
+ * Stops loading the image for @actor, which will stay empty. The load
+ * itself is dropped if it hasn't started yet and no other actor is
+ * waiting for it.
+ */
+void
+st_texture_cache_cancel_load (StTextureCache *cache,
+                              ClutterActor   *actor)
+{
+  AsyncTextureLoadData *data;
+
+  g_return_if_fail (ST_IS_TEXTURE_CACHE (cache));
+  g_return_if_fail (CLUTTER_IS_ACTOR (actor));
+
+  data = g_object_get_qdata (G_OBJECT (actor), get_request_quark ());
+  if (data == NULL)
+    return;
+
+  g_object_set_qdata (G_OBJECT (actor), get_request_quark (), NULL);
+  data->actors = g_slist_remove (data->actors, actor);
+  g_object_unref (actor);
+
+  if (data->actors != NULL)
+    {
+      update_request_priority (cache, data);
+      return;
+    }
+
+  if (data->pending_link == NULL)
+    return;
+
+  g_queue_delete_link (&cache->priv->pending_loads[data->priority],
+                       data->pending_link);
+  data->pending_link = NULL;
+
+  if (g_hash_table_lookup (cache->priv->outstanding_requests, data->key) == data)
+    g_hash_table_remove (cache->priv->outstanding_requests, data->key);
+
+  texture_load_data_free (data);
+}
+
+/**
+ * st_texture_cache_set_memory_budget:
+ * @cache: A #StTextureCache
+ * @budget: the budget in MiB, or 0 for no limit
+ *
+ * Sets #StTextureCache:memory-budget.
+ */
+void
+st_texture_cache_set_memory_budget (StTextureCache *cache,
+                                    guint           budget)
+{
+  g_return_if_fail (ST_IS_TEXTURE_CACHE (cache));
+
+  if (cache->priv->memory_budget == budget)
+    return;
+
+  cache->priv->memory_budget = budget;
+  if (budget > 0)
+    queue_trim (cache);
+
+  g_object_notify_by_pspec (G_OBJECT (cache), props[PROP_MEMORY_BUDGET]);
+}
+
+/**
+ * st_texture_cache_get_memory_budget:
+ * @cache: A #StTextureCache
+ *
+ * Returns: the value of #StTextureCache:memory-budget
+ */
+guint
+st_texture_cache_get_memory_budget (StTextureCache *cache)
+{
+  g_return_val_if_fail (ST_IS_TEXTURE_CACHE (cache), 0);
+
+  return cache->priv->memory_budget;
+}
+
+/**
+ * st_texture_cache_trim:
+ * @cache: A #StTextureCache
+ * @level: how low the system is on memory
+ *
+ * Releases memory in response to a low memory warning. On
+ * %G_MEMORY_MONITOR_WARNING_LEVEL_LOW, the older half of the images
+ * that aren't in use is evicted; on higher levels, all of them are.
+ * The icon theme is trimmed as well, see st_icon_theme_trim().
+ */
+void
+st_texture_cache_trim (StTextureCache             *cache,
+                       GMemoryMonitorWarningLevel  level)
+{
+  g_return_if_fail (ST_IS_TEXTURE_CACHE (cache));
+
+  evict_unused (cache, 0,
+                level < G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM ? 0.5 : 1.0);
+
+  st_icon_theme_trim (cache->priv->icon_theme, level);
+}
+
+/**
+ * st_texture_cache_flush:
+ * @cache: A #StTextureCache
+ *
+ * Writes decoded icons that are still waiting to be saved to the on-disk
+ * cache enabled with ST_ICON_BITMAP_CACHE=1 right away, so that a process
+ * started next finds them.
+ */
+void
+st_texture_cache_flush (StTextureCache *cache)
+{
+  g_return_if_fail (ST_IS_TEXTURE_CACHE (cache));
+
+  _st_icon_bitmap_cache_flush ();
+}
+
 /**
  * st_texture_cache_get_default:
  *
@@ -1680,3 +2972,46 @@ st_texture_cache_rescan_icon_theme (StTextureCache *cache)
 
   return st_icon_theme_rescan_if_needed (priv->icon_theme);
 }
+
+/**
+ * st_texture_cache_get_icon_lookup_stats:
+ * @cache: A #StTextureCache
+ * @hits: (out) (optional): return location for the number of icon
+ *   lookups answered from the icon theme's cache
+ * @misses: (out) (optional): return location for the number of icon
+ *   lookups that had to search the icon themes
+ */
+void
+st_texture_cache_get_icon_lookup_stats (StTextureCache *cache,
+                                        guint          *hits,
+                                        guint          *misses)
+{
+  g_return_if_fail (ST_IS_TEXTURE_CACHE (cache));
+
+  st_icon_theme_get_info_cache_stats (cache->priv->icon_theme, hits, misses);
+}
+
+/**
+ * st_texture_cache_get_memory_usage:
+ * @cache: A #StTextureCache
+ *
+ * Returns: the approximate amount of memory, in bytes, used by the
+ *   textures and surfaces in the cache, as counted against
+ *   #StTextureCache:memory-budget
+ */
+guint64
+st_texture_cache_get_memory_usage (StTextureCache *cache)
+{
+  g_autoptr (GArray) candidates = NULL;
+  guint64 total = 0;
+
+  g_return_val_if_fail (ST_IS_TEXTURE_CACHE (cache), 0);
+
+  candidates = g_array_new (FALSE, FALSE, sizeof (TrimCandidate));
+  collect_trim_candidates (cache, cache->priv->keyed_cache, FALSE,
+                           candidates, &total);
+  collect_trim_candidates (cache, cache->priv->keyed_surface_cache, TRUE,
+                           candidates, &total);
+
+  return total;
+}
@@ -51,6 +51,21 @@ typedef enum {
   ST_TEXTURE_CACHE_POLICY_FOREVER
 } StTextureCachePolicy;
 
+/**
+ * StTextureCachePriority:
+ * @ST_TEXTURE_CACHE_PRIORITY_VISIBLE: the image is needed on screen now
+ * @ST_TEXTURE_CACHE_PRIORITY_PREFETCH: the image is likely to be shown soon
+ * @ST_TEXTURE_CACHE_PRIORITY_BACKGROUND: the image is not expected to be
+ *   shown any time soon
+ *
+ * How urgently an asynchronous load is needed.
+ */
+typedef enum {
+  ST_TEXTURE_CACHE_PRIORITY_VISIBLE,
+  ST_TEXTURE_CACHE_PRIORITY_PREFETCH,
+  ST_TEXTURE_CACHE_PRIORITY_BACKGROUND
+} StTextureCachePriority;
+
 StTextureCache* st_texture_cache_get_default (void);
 
 ClutterActor *
@@ -63,6 +78,16 @@ st_texture_cache_load_sliced_image (StTextureCache *cache,
                                     GFunc           load_callback,
                                     gpointer        user_data);
 
+ClutterActor *
+st_texture_cache_load_sprite_sheet (StTextureCache *cache,
+                                    GFile          *file,
+                                    gint            grid_width,
+                                    gint            grid_height,
+                                    gint            paint_scale,
+                                    gfloat          resource_scale,
+                                    GFunc           load_callback,
+                                    gpointer        user_data);
+
 GIcon *
 st_texture_cache_load_cairo_surface_to_gicon (StTextureCache  *cache,
                                               cairo_surface_t *surface);
@@ -74,6 +99,15 @@ ClutterActor *st_texture_cache_load_gicon (StTextureCache *cache,
                                            gint            paint_scale,
                                            gfloat          resource_scale);
 
+ClutterActor *st_texture_cache_load_gicon_with_fallbacks (StTextureCache  *cache,
+                                                          StThemeNode     *theme_node,
+                                                          GIcon          **icons,
+                                                          int              n_icons,
+                                                          gint             size,
+                                                          gint             paint_scale,
+                                                          gfloat           resource_scale,
+                                                          int             *chosen);
+
 ClutterActor *st_texture_cache_load_file_async (StTextureCache    *cache,
                                                 GFile             *file,
                                                 int                available_width,
@@ -86,6 +120,16 @@ CoglTexture     *st_texture_cache_load_file_to_cogl_texture (StTextureCache *cac
                                                              gint            paint_scale,
                                                              gfloat          resource_scale);
 
+CoglTexture     *st_texture_cache_try_load_file_to_cogl_texture (StTextureCache *cache,
+                                                                 GFile          *file,
+                                                                 gint            paint_scale,
+                                                                 gfloat          resource_scale);
+
+void             st_texture_cache_prewarm_file (StTextureCache *cache,
+                                                GFile          *file,
+                                                gint            paint_scale,
+                                                gfloat          resource_scale);
+
 cairo_surface_t *st_texture_cache_load_file_to_cairo_surface (StTextureCache *cache,
                                                               GFile          *file,
                                                               gint            paint_scale,
@@ -113,4 +157,25 @@ CoglTexture * st_texture_cache_load (StTextureCache       *cache,
 
 gboolean st_texture_cache_rescan_icon_theme (StTextureCache *cache);
 
+void st_texture_cache_get_icon_lookup_stats (StTextureCache *cache,
+                                             guint          *hits,
+                                             guint          *misses);
+
+guint64 st_texture_cache_get_memory_usage (StTextureCache *cache);
+
+void st_texture_cache_set_load_priority (StTextureCache         *cache,
+                                         ClutterActor           *actor,
+                                         StTextureCachePriority  priority);
+void st_texture_cache_cancel_load       (StTextureCache         *cache,
+                                         ClutterActor           *actor);
+
+void  st_texture_cache_set_memory_budget (StTextureCache *cache,
+                                          guint           budget);
+guint st_texture_cache_get_memory_budget (StTextureCache *cache);
+
+void st_texture_cache_trim (StTextureCache             *cache,
+                            GMemoryMonitorWarningLevel  level);
+
+void st_texture_cache_flush (StTextureCache *cache);
+
 #endif /* __ST_TEXTURE_CACHE_H__ */
@@ -0,0 +1,161 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*- */
+/*
+ * st-texture-pool.c: Pool of offscreen textures shared between effects
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <clutter/clutter.h>
+
+#include "st-texture-pool.h"
+
+/* Released textures are kept around for a little while, so that effects
+ * reallocating their offscreen buffers while animating, or other effects
+ * of the same size, can reuse them instead of allocating new ones. The
+ * pool holds a toggle reference on every texture it handed out, which
+ * tells it when the last user is gone.
+ */
+#define MAX_FREE_BYTES (64 * 1024 * 1024)
+#define FREE_TEXTURE_TIMEOUT_S 5
+
+typedef struct
+{
+  CoglTexture *texture;
+  gint64 release_time;
+} FreeTexture;
+
+/* Most recently released first */
+static GQueue free_textures = G_QUEUE_INIT;
+static gsize free_bytes = 0;
+static guint trim_timeout_id = 0;
+
+static gsize
+texture_bytes (CoglTexture *texture)
+{
+  return (gsize) cogl_texture_get_width (texture) *
+         cogl_texture_get_height (texture) * 4;
+}
+
+static void on_texture_toggled (gpointer  data,
+                                GObject  *object,
+                                gboolean  is_last_ref);
+
+static CoglTexture *
+take_free_texture (GList *link)
+{
+  FreeTexture *free_texture = link->data;
+  CoglTexture *texture = free_texture->texture;
+
+  free_bytes -= texture_bytes (texture);
+  g_queue_delete_link (&free_textures, link);
+  g_free (free_texture);
+
+  return texture;
+}
+
+static gboolean
+trim_free_textures (gpointer data)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  while (free_textures.tail != NULL)
+    {
+      FreeTexture *free_texture = free_textures.tail->data;
+      CoglTexture *texture;
+
+      if (free_bytes <= MAX_FREE_BYTES &&
+          now - free_texture->release_time < FREE_TEXTURE_TIMEOUT_S * G_USEC_PER_SEC)
+        break;
+
+      texture = take_free_texture (free_textures.tail);
+      g_object_remove_toggle_ref (G_OBJECT (texture), on_texture_toggled, NULL);
+    }
+
+  if (free_textures.length == 0)
+    {
+      trim_timeout_id = 0;
+      return G_SOURCE_REMOVE;
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+on_texture_toggled (gpointer  data,
+                    GObject  *object,
+                    gboolean  is_last_ref)
+{
+  FreeTexture *free_texture;
+
+  /* Textures are unlinked from the free list when they are acquired */
+  if (!is_last_ref)
+    return;
+
+  free_texture = g_new0 (FreeTexture, 1);
+  free_texture->texture = COGL_TEXTURE (object);
+  free_texture->release_time = g_get_monotonic_time ();
+
+  g_queue_push_head (&free_textures, free_texture);
+  free_bytes += texture_bytes (free_texture->texture);
+
+  /* Trimming drops the pool's reference, which can't be done from
+   * within the toggle notification */
+  if (trim_timeout_id == 0)
+    {
+      trim_timeout_id = g_timeout_add_seconds (1, trim_free_textures, NULL);
+      g_source_set_name_by_id (trim_timeout_id, "[gnome-shell] trim_free_textures");
+    }
+}
+
+/**
+ * st_texture_pool_acquire:
+ * @width: width of the texture, in pixels
+ * @height: height of the texture, in pixels
+ *
+ * Gets a texture to render offscreen into, reusing a texture of the same
+ * size that was released recently when possible. The texture goes back to
+ * the pool when its last reference is dropped; its contents are undefined,
+ * so it must be cleared before use.
+ *
+ * Returns: (transfer full) (nullable): a #CoglTexture
+ */
+CoglTexture *
+st_texture_pool_acquire (int width,
+                         int height)
+{
+  CoglContext *ctx;
+  CoglTexture *texture;
+  GList *l;
+
+  g_return_val_if_fail (width > 0 && height > 0, NULL);
+
+  for (l = free_textures.head; l != NULL; l = l->next)
+    {
+      FreeTexture *free_texture = l->data;
+
+      if (cogl_texture_get_width (free_texture->texture) == width &&
+          cogl_texture_get_height (free_texture->texture) == height)
+        return g_object_ref (take_free_texture (l));
+    }
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+
+  texture = cogl_texture_2d_new_with_size (ctx, width, height);
+  if (texture == NULL)
+    return NULL;
+
+  g_object_add_toggle_ref (G_OBJECT (texture), on_texture_toggled, NULL);
+
+  return texture;
+}
@@ -40,12 +40,16 @@
 
 #define ACCENT_FG_COLOR     "#ffffff"
 
+#define SWEEP_INTERVAL 500
+
 struct _StThemeContext {
   GObject parent;
 
-  PangoFontDescription *font;
+  const PangoFontDescription *font;
   CoglColor accent_color;
   CoglColor accent_fg_color;
+  /* Unique across contexts, changes with the accent colors */
+  guint accent_serial;
 
   StThemeNode *root_node;
   StTheme *theme;
@@ -53,6 +57,14 @@ struct _StThemeContext {
   /* set of StThemeNode */
   GHashTable *nodes;
 
+  /* set of PangoFontDescription, see _st_theme_context_intern_font() */
+  GHashTable *fonts;
+
+  /* Nodes only held by the set are swept out after every
+   * SWEEP_INTERVAL nodes that were interned, see queue_sweep() */
+  guint n_interned;
+  guint sweep_id;
+
   gulong stylesheets_changed_id;
 
   int scale_factor;
@@ -71,12 +83,15 @@ static GParamSpec *props[N_PROPS] = { NULL, };
 enum
 {
   CHANGED,
+  ACCENT_CHANGED,
 
   LAST_SIGNAL
 };
 
 static guint signals[LAST_SIGNAL] = { 0, };
 
+static guint next_accent_serial = 0;
+
 G_DEFINE_TYPE (StThemeContext, st_theme_context, G_TYPE_OBJECT)
 
 static PangoFontDescription *get_interface_font_description (void);
@@ -87,6 +102,7 @@ static void update_accent_colors (StThemeContext *context);
 static void on_icon_theme_changed (StTextureCache *cache,
                                    StThemeContext *context);
 static void st_theme_context_changed (StThemeContext *context);
+static void st_theme_context_accent_changed (StThemeContext *context);
 
 static void st_theme_context_set_property (GObject      *object,
                                            guint         prop_id,
@@ -129,6 +145,7 @@ st_theme_context_finalize (GObject *object)
                                         context);
 
   g_clear_signal_handler (&context->stylesheets_changed_id, context->theme);
+  g_clear_handle_id (&context->sweep_id, g_source_remove);
 
   if (context->nodes)
     g_hash_table_unref (context->nodes);
@@ -137,7 +154,8 @@ st_theme_context_finalize (GObject *object)
   if (context->theme)
     g_object_unref (context->theme);
 
-  pango_font_description_free (context->font);
+  /* After the nodes, which point to the fonts */
+  g_clear_pointer (&context->fonts, g_hash_table_unref);
 
   G_OBJECT_CLASS (st_theme_context_parent_class)->finalize (object);
 }
@@ -179,12 +197,33 @@ st_theme_context_class_init (StThemeContextClass *klass)
                   0, /* no default handler slot */
                   NULL, NULL, NULL,
                   G_TYPE_NONE, 0);
+
+  /**
+   * StThemeContext::accent-changed:
+   * @self: a #StThemeContext
+   *
+   * Emitted when the accent colors change. Unlike #StThemeContext::changed,
+   * only theme nodes using the accent colors are dropped, so only widgets
+   * with such nodes have to update their style.
+   */
+  signals[ACCENT_CHANGED] =
+    g_signal_new ("accent-changed",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, /* no default handler slot */
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 0);
 }
 
 static void
 st_theme_context_init (StThemeContext *context)
 {
-  context->font = get_interface_font_description ();
+  context->fonts = g_hash_table_new_full ((GHashFunc) pango_font_description_hash,
+                                          (GEqualFunc) pango_font_description_equal,
+                                          (GDestroyNotify) pango_font_description_free,
+                                          NULL);
+  context->font = _st_theme_context_intern_font (context,
+                                                 get_interface_font_description ());
 
   g_signal_connect (st_settings_get (),
                     "notify::font-name",
@@ -331,7 +370,35 @@ update_accent_colors (StThemeContext *context)
 
   cogl_color_from_string (&context->accent_fg_color, ACCENT_FG_COLOR);
 
-  st_theme_context_changed (context);
+  context->accent_serial = ++next_accent_serial;
+
+  st_theme_context_accent_changed (context);
+}
+
+static void
+st_theme_context_accent_changed (StThemeContext *context)
+{
+  GHashTableIter iter;
+  gpointer key;
+
+  if (context->root_node == NULL ||
+      _st_theme_node_uses_accent_color (context->root_node))
+    {
+      st_theme_context_changed (context);
+      return;
+    }
+
+  /* Nodes that refer to the accent colors, directly or through their
+   * ancestors, have resolved them already; all others stay valid, with
+   * whatever they cached */
+  g_hash_table_iter_init (&iter, context->nodes);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      if (_st_theme_node_uses_accent_color (key))
+        g_hash_table_iter_remove (&iter);
+    }
+
+  g_signal_emit (context, signals[ACCENT_CHANGED], 0);
 }
 
 static void
@@ -349,6 +416,7 @@ st_theme_context_changed (StThemeContext *context)
   StThemeNode *old_root = context->root_node;
   context->root_node = NULL;
   g_hash_table_remove_all (context->nodes);
+  context->n_interned = 0;
 
   g_signal_emit (context, signals[CHANGED], 0);
 
@@ -490,8 +558,8 @@ st_theme_context_set_font (StThemeContext             *context,
       pango_font_description_equal (context->font, font))
     return;
 
-  pango_font_description_free (context->font);
-  context->font = pango_font_description_copy (font);
+  context->font = _st_theme_context_intern_font (context,
+                                                 pango_font_description_copy (font));
   st_theme_context_changed (context);
 }
 
@@ -533,6 +601,52 @@ st_theme_context_get_accent_color (StThemeContext *context,
     memcpy (fg_color, &context->accent_fg_color, sizeof (CoglColor));
 }
 
+/*
+ * _st_theme_context_intern_font:
+ * @context: a #StThemeContext
+ * @font: (transfer full): a font description
+ *
+ * Looks up the font description of @context that is equal to @font,
+ * adding @font if there is none, so that theme nodes resolving to the
+ * same font share one description. Interned descriptions must not be
+ * modified, and stay around as long as @context; there are only ever
+ * a few distinct fonts.
+ *
+ * Return value: (transfer none): the interned font description
+ */
+const PangoFontDescription *
+_st_theme_context_intern_font (StThemeContext       *context,
+                               PangoFontDescription *font)
+{
+  PangoFontDescription *interned;
+
+  interned = g_hash_table_lookup (context->fonts, font);
+  if (interned)
+    {
+      pango_font_description_free (font);
+      return interned;
+    }
+
+  g_hash_table_add (context->fonts, font);
+  return font;
+}
+
+/*
+ * _st_theme_context_get_accent_serial:
+ * @context: a #StThemeContext
+ *
+ * Gets a number that changes whenever the accent colors of @context
+ * change, and that no other context shares, so that colors computed
+ * from the accent colors can be cached against it.
+ *
+ * Return value: the accent serial, never 0
+ */
+guint
+_st_theme_context_get_accent_serial (StThemeContext *context)
+{
+  return context->accent_serial;
+}
+
 /**
  * st_theme_context_get_root_node:
  * @context: a #StThemeContext
@@ -553,6 +667,61 @@ st_theme_context_get_root_node (StThemeContext *context)
   return context->root_node;
 }
 
+/* Drops the nodes that nothing but the set holds on to anymore, such
+ * as those of destroyed widgets or of inline styles that changed */
+static void
+sweep_unused_nodes (StThemeContext *context)
+{
+  GHashTableIter iter;
+  gpointer node;
+  guint n_removed;
+
+  /* Interned nodes keep their parents alive, so dropping the unused
+   * leaves can leave more unused nodes behind */
+  do
+    {
+      n_removed = 0;
+
+      g_hash_table_iter_init (&iter, context->nodes);
+      while (g_hash_table_iter_next (&iter, &node, NULL))
+        {
+          if (node != context->root_node &&
+              G_OBJECT (node)->ref_count == 1)
+            {
+              g_hash_table_iter_remove (&iter);
+              n_removed++;
+            }
+        }
+    }
+  while (n_removed > 0);
+
+  context->n_interned = 0;
+}
+
+static gboolean
+sweep_idle (gpointer data)
+{
+  StThemeContext *context = data;
+
+  context->sweep_id = 0;
+  sweep_unused_nodes (context);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Sweeping goes through the whole set, so it is only done every so
+ * often, when nothing more important is going on */
+static void
+queue_sweep (StThemeContext *context)
+{
+  if (context->sweep_id != 0)
+    return;
+
+  context->sweep_id = g_idle_add_full (G_PRIORITY_LOW, sweep_idle,
+                                       context, NULL);
+  g_source_set_name_by_id (context->sweep_id, "[gnome-shell] sweep_unused_nodes");
+}
+
 /**
  * st_theme_context_intern_node:
  * @context: a #StThemeContext
@@ -574,9 +743,36 @@ st_theme_context_intern_node (StThemeContext *context,
     return mine;
 
   g_hash_table_add (context->nodes, g_object_ref (node));
+
+  if (++context->n_interned >= SWEEP_INTERVAL)
+    queue_sweep (context);
+
   return node;
 }
 
+/**
+ * st_theme_context_trim:
+ * @context: a #StThemeContext
+ * @level: how low the system is on memory
+ *
+ * Releases memory in response to a low memory warning. On
+ * %G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM and higher, interned nodes
+ * that no widget uses anymore are dropped right away, along with the
+ * resources they cached, instead of on the next periodic sweep.
+ */
+void
+st_theme_context_trim (StThemeContext             *context,
+                       GMemoryMonitorWarningLevel  level)
+{
+  g_return_if_fail (ST_IS_THEME_CONTEXT (context));
+
+  if (level < G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM)
+    return;
+
+  g_clear_handle_id (&context->sweep_id, g_source_remove);
+  sweep_unused_nodes (context);
+}
+
 /**
  * st_theme_context_get_scale_factor:
  * @context: a #StThemeContext
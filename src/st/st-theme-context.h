@@ -64,6 +64,9 @@ StThemeNode *               st_theme_context_intern_node      (StThemeContext
 
 int st_theme_context_get_scale_factor (StThemeContext *context);
 
+void st_theme_context_trim (StThemeContext             *context,
+                            GMemoryMonitorWarningLevel  level);
+
 G_END_DECLS
 
 #endif /* __ST_THEME_CONTEXT_H__ */
@@ -30,6 +30,7 @@
 #include <stdlib.h>
 #include <math.h>
 
+#include "st-corner-cache.h"
 #include "st-shadow.h"
 #include "st-private.h"
 #include "st-theme-private.h"
@@ -73,7 +74,8 @@ elliptical_arc (cairo_t *cr,
 }
 
 static CoglTexture *
-create_corner_material (StCornerSpec *corner)
+create_corner_material (const char   *key,
+                        StCornerSpec *corner)
 {
   ClutterBackend *backend = clutter_get_default_backend ();
   CoglContext *ctx = clutter_backend_get_cogl_context (backend);
@@ -88,6 +90,25 @@ create_corner_material (StCornerSpec *corner)
   guint max_border_width;
   double device_scaling;
 
+  if (_st_corner_cache_is_enabled ())
+    {
+      g_autoptr (GBytes) pixels = NULL;
+
+      pixels = _st_corner_cache_lookup (key, &size);
+      if (pixels != NULL)
+        {
+          texture = cogl_texture_2d_new_from_data (ctx, size, size,
+                                                   COGL_PIXEL_FORMAT_CAIRO_ARGB32_COMPAT,
+                                                   size * 4,
+                                                   g_bytes_get_data (pixels, NULL),
+                                                   &error);
+          if (texture != NULL)
+            return texture;
+
+          g_clear_error (&error);
+        }
+    }
+
   max_border_width = MAX(corner->border_width_2, corner->border_width_1);
   logical_size = 2 * MAX(max_border_width, corner->radius);
   size = ceilf (logical_size * corner->resource_scale);
@@ -191,6 +212,10 @@ create_corner_material (StCornerSpec *corner)
       g_warning ("Failed to allocate texture: %s", error->message);
       g_error_free (error);
     }
+  else if (_st_corner_cache_is_enabled ())
+    {
+      _st_corner_cache_insert (key, size, data);
+    }
 
   g_free (data);
 
@@ -216,7 +241,7 @@ load_corner (StTextureCache  *cache,
              void            *datap,
              GError         **error)
 {
-  return create_corner_material ((StCornerSpec *) datap);
+  return create_corner_material (key, (StCornerSpec *) datap);
 }
 
 /* To match the CSS specification, we want the border to look like it was
@@ -1362,6 +1387,372 @@ st_theme_node_prerender_background (StThemeNode *node,
   return texture;
 }
 
+/* Draws a rounded box with per-side border widths and a solid or
+ * gradient background directly on the GPU, using the signed distance
+ * to the outer and inner (inside the borders) edges for the coverage.
+ * The texture coordinates span the box from 0 to 1.
+ */
+static const char rounded_box_glsl_declarations[] =
+"uniform vec2 st_size;\n"
+"uniform float st_resource_scale;\n"
+"/* top-left, top-right, bottom-right, bottom-left */\n"
+"uniform vec4 st_border_radius;\n"
+"/* top, right, bottom, left */\n"
+"uniform vec4 st_border_width;\n"
+"uniform vec4 st_border_color;\n"
+"uniform vec4 st_background_start;\n"
+"uniform vec4 st_background_end;\n"
+"uniform int st_gradient_type;\n"
+"\n"
+"float\n"
+"st_rounded_box_distance (vec2 p, vec2 box_min, vec2 box_max,\n"
+"                         vec2 r_tl, vec2 r_tr, vec2 r_br, vec2 r_bl)\n"
+"{\n"
+"  vec2 center = (box_min + box_max) * 0.5;\n"
+"  vec2 d = max (box_min - p, p - box_max);\n"
+"  vec2 r, corner, dir;\n"
+"\n"
+"  if (p.y < center.y)\n"
+"    {\n"
+"      if (p.x < center.x)\n"
+"        { r = r_tl; corner = box_min + r; dir = vec2 (-1.0, -1.0); }\n"
+"      else\n"
+"        { r = r_tr; corner = vec2 (box_max.x - r.x, box_min.y + r.y); dir = vec2 (1.0, -1.0); }\n"
+"    }\n"
+"  else\n"
+"    {\n"
+"      if (p.x < center.x)\n"
+"        { r = r_bl; corner = vec2 (box_min.x + r.x, box_max.y - r.y); dir = vec2 (-1.0, 1.0); }\n"
+"      else\n"
+"        { r = r_br; corner = box_max - r; dir = vec2 (1.0, 1.0); }\n"
+"    }\n"
+"\n"
+"  if (r.x > 0.0 && r.y > 0.0 &&\n"
+"      (p.x - corner.x) * dir.x > 0.0 && (p.y - corner.y) * dir.y > 0.0)\n"
+"    return (length ((p - corner) / r) - 1.0) * min (r.x, r.y);\n"
+"\n"
+"  return max (d.x, d.y);\n"
+"}\n";
+
+static const char rounded_box_glsl[] =
+"vec2 p = cogl_tex_coord_in[0].xy * st_size;\n"
+"vec4 bw = st_border_width;\n"
+"vec4 br = st_border_radius;\n"
+"float outer = st_rounded_box_distance (p, vec2 (0.0), st_size,\n"
+"                                       vec2 (br.x), vec2 (br.y),\n"
+"                                       vec2 (br.z), vec2 (br.w));\n"
+"float inner = st_rounded_box_distance (p, bw.wx, st_size - bw.yz,\n"
+"                                       max (vec2 (br.x) - bw.wx, 0.0),\n"
+"                                       max (vec2 (br.y) - bw.yx, 0.0),\n"
+"                                       max (vec2 (br.z) - bw.yz, 0.0),\n"
+"                                       max (vec2 (br.w) - bw.wz, 0.0));\n"
+"float t = 0.0;\n"
+"\n"
+"if (st_gradient_type == 1)\n"
+"  t = p.y / st_size.y;\n"
+"else if (st_gradient_type == 2)\n"
+"  t = p.x / st_size.x;\n"
+"else if (st_gradient_type == 3)\n"
+"  t = length (p - st_size * 0.5) / (min (st_size.x, st_size.y) * 0.5);\n"
+"\n"
+"vec4 background = mix (st_background_start, st_background_end,\n"
+"                       clamp (t, 0.0, 1.0));\n"
+"float outer_coverage = clamp (0.5 - outer * st_resource_scale, 0.0, 1.0);\n"
+"float inner_coverage = clamp (0.5 - inner * st_resource_scale, 0.0, 1.0);\n"
+"\n"
+"cogl_color_out = mix (st_border_color, background, inner_coverage) *\n"
+"                 outer_coverage * cogl_color_in;\n";
+
+static void
+set_uniform_color (CoglPipeline    *pipeline,
+                   const char      *name,
+                   const CoglColor *color)
+{
+  float values[4];
+
+  /* Premultiplied, like the rest of the pipeline */
+  values[3] = color->alpha / 255.0f;
+  values[0] = color->red / 255.0f * values[3];
+  values[1] = color->green / 255.0f * values[3];
+  values[2] = color->blue / 255.0f * values[3];
+
+  cogl_pipeline_set_uniform_float (pipeline,
+                                   cogl_pipeline_get_uniform_location (pipeline, name),
+                                   4, 1, values);
+}
+
+static CoglPipeline *
+st_theme_node_create_rounded_box_pipeline (StThemeNode *node,
+                                           float        width,
+                                           float        height,
+                                           float        resource_scale)
+{
+  static CoglPipelineKey rounded_box_pipeline_key =
+    "st-theme-node-rounded-box-pipeline";
+  CoglContext *ctx;
+  CoglPipeline *template, *pipeline;
+  CoglColor border_color;
+  guint radius[4];
+  float values[4];
+  int i;
+
+  ctx = clutter_backend_get_cogl_context (clutter_get_default_backend ());
+  template = cogl_context_get_named_pipeline (ctx, &rounded_box_pipeline_key);
+
+  if (G_UNLIKELY (template == NULL))
+    {
+      CoglSnippet *snippet;
+
+      template = cogl_pipeline_new (ctx);
+      /* Only there for the texture coordinates */
+      cogl_pipeline_set_layer_null_texture (template, 0);
+
+      snippet = cogl_snippet_new (COGL_SNIPPET_HOOK_FRAGMENT,
+                                  rounded_box_glsl_declarations,
+                                  rounded_box_glsl);
+      cogl_pipeline_add_snippet (template, snippet);
+      g_object_unref (snippet);
+
+      cogl_context_set_named_pipeline (ctx, &rounded_box_pipeline_key, template);
+    }
+
+  pipeline = cogl_pipeline_copy (template);
+
+  values[0] = width;
+  values[1] = height;
+  cogl_pipeline_set_uniform_float (pipeline,
+                                   cogl_pipeline_get_uniform_location (pipeline, "st_size"),
+                                   2, 1, values);
+  cogl_pipeline_set_uniform_1f (pipeline,
+                                cogl_pipeline_get_uniform_location (pipeline, "st_resource_scale"),
+                                resource_scale);
+
+  st_theme_node_reduce_border_radius (node, width, height, radius);
+  for (i = 0; i < 4; i++)
+    values[i] = radius[i];
+  cogl_pipeline_set_uniform_float (pipeline,
+                                   cogl_pipeline_get_uniform_location (pipeline, "st_border_radius"),
+                                   4, 1, values);
+
+  for (i = 0; i < 4; i++)
+    values[i] = st_theme_node_get_border_width (node, i);
+  cogl_pipeline_set_uniform_float (pipeline,
+                                   cogl_pipeline_get_uniform_location (pipeline, "st_border_width"),
+                                   4, 1, values);
+
+  /* TODO - support non-uniform border colors */
+  get_arbitrary_border_color (node, &border_color);
+  set_uniform_color (pipeline, "st_border_color", &border_color);
+
+  set_uniform_color (pipeline, "st_background_start", &node->background_color);
+  set_uniform_color (pipeline, "st_background_end",
+                     node->background_gradient_type != ST_GRADIENT_NONE
+                     ? &node->background_gradient_end
+                     : &node->background_color);
+
+  cogl_pipeline_set_uniform_1i (pipeline,
+                                cogl_pipeline_get_uniform_location (pipeline, "st_gradient_type"),
+                                node->background_gradient_type == ST_GRADIENT_VERTICAL ? 1 :
+                                node->background_gradient_type == ST_GRADIENT_HORIZONTAL ? 2 :
+                                node->background_gradient_type == ST_GRADIENT_RADIAL ? 3 : 0);
+
+  return pipeline;
+}
+
+static gboolean
+st_theme_node_has_uniform_borders (StThemeNode *node)
+{
+  int side;
+
+  for (side = 0; side < 4; side++)
+    {
+      if (node->border_width[side] > 0 &&
+          !cogl_color_equal (&node->border_color[side],
+                             &node->border_color[ST_SIDE_TOP]))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Whether the nodes paint the same box, with a background color or
+ * gradient and uniform borders, that only differs in its colors.
+ * Transitions between them can then interpolate the colors of the
+ * rounded box pipeline instead of cross-fading between both nodes.
+ */
+gboolean
+_st_theme_node_can_interpolate (StThemeNode *node,
+                                StThemeNode *other)
+{
+  int i;
+
+  if (st_theme_node_get_box_shadow (node) != NULL ||
+      st_theme_node_get_box_shadow (other) != NULL ||
+      st_theme_node_get_background_image (node) != NULL ||
+      st_theme_node_get_background_image (other) != NULL ||
+      st_theme_node_get_border_image (node) != NULL ||
+      st_theme_node_get_border_image (other) != NULL)
+    return FALSE;
+
+  _st_theme_node_ensure_background (node);
+  _st_theme_node_ensure_background (other);
+  _st_theme_node_ensure_geometry (node);
+  _st_theme_node_ensure_geometry (other);
+
+  if (node->outline_width > 0 || other->outline_width > 0)
+    return FALSE;
+
+  if (node->background_gradient_type != other->background_gradient_type)
+    return FALSE;
+
+  for (i = 0; i < 4; i++)
+    {
+      if (node->border_width[i] != other->border_width[i] ||
+          node->border_radius[i] != other->border_radius[i])
+        return FALSE;
+    }
+
+  return st_theme_node_has_uniform_borders (node) &&
+         st_theme_node_has_uniform_borders (other);
+}
+
+/* Creates a pipeline painting the box of @node over texture coordinates
+ * from 0 to 1, whose colors are set by _st_theme_node_interpolate_pipeline()
+ */
+CoglPipeline *
+_st_theme_node_create_interpolation_pipeline (StThemeNode *node,
+                                              float        width,
+                                              float        height,
+                                              float        resource_scale)
+{
+  _st_theme_node_ensure_background (node);
+  _st_theme_node_ensure_geometry (node);
+
+  return st_theme_node_create_rounded_box_pipeline (node, width, height,
+                                                    resource_scale);
+}
+
+static void
+set_uniform_color_mix (CoglPipeline    *pipeline,
+                       const char      *name,
+                       const CoglColor *from,
+                       const CoglColor *to,
+                       float            progress)
+{
+  float from_alpha = from->alpha / 255.0f;
+  float to_alpha = to->alpha / 255.0f;
+  float values[4];
+
+  /* Mixed premultiplied, like cross-fading the painted boxes would */
+  values[0] = (from->red * from_alpha * (1 - progress) +
+               to->red * to_alpha * progress) / 255.0f;
+  values[1] = (from->green * from_alpha * (1 - progress) +
+               to->green * to_alpha * progress) / 255.0f;
+  values[2] = (from->blue * from_alpha * (1 - progress) +
+               to->blue * to_alpha * progress) / 255.0f;
+  values[3] = from_alpha * (1 - progress) + to_alpha * progress;
+
+  cogl_pipeline_set_uniform_float (pipeline,
+                                   cogl_pipeline_get_uniform_location (pipeline, name),
+                                   4, 1, values);
+}
+
+/* Sets the colors of @pipeline at @progress from those of @from to those
+ * of @to, nodes that _st_theme_node_can_interpolate() accepts
+ */
+void
+_st_theme_node_interpolate_pipeline (CoglPipeline *pipeline,
+                                     StThemeNode  *from,
+                                     StThemeNode  *to,
+                                     float         progress)
+{
+  const CoglColor *from_end, *to_end;
+
+  set_uniform_color_mix (pipeline, "st_border_color",
+                         &from->border_color[ST_SIDE_TOP],
+                         &to->border_color[ST_SIDE_TOP],
+                         progress);
+  set_uniform_color_mix (pipeline, "st_background_start",
+                         &from->background_color,
+                         &to->background_color,
+                         progress);
+
+  from_end = from->background_gradient_type != ST_GRADIENT_NONE
+    ? &from->background_gradient_end
+    : &from->background_color;
+  to_end = to->background_gradient_type != ST_GRADIENT_NONE
+    ? &to->background_gradient_end
+    : &to->background_color;
+  set_uniform_color_mix (pipeline, "st_background_end",
+                         from_end, to_end, progress);
+}
+
+/* The extent of the corners and borders on each side of the background */
+static void
+st_theme_node_get_background_slices (StThemeNode *node,
+                                     float       *left,
+                                     float       *right,
+                                     float       *top,
+                                     float       *bottom)
+{
+  *left = MAX (MAX (node->border_radius[ST_CORNER_TOPLEFT],
+                    node->border_radius[ST_CORNER_BOTTOMLEFT]),
+               node->border_width[ST_SIDE_LEFT]);
+  *right = MAX (MAX (node->border_radius[ST_CORNER_TOPRIGHT],
+                     node->border_radius[ST_CORNER_BOTTOMRIGHT]),
+                node->border_width[ST_SIDE_RIGHT]);
+  *top = MAX (MAX (node->border_radius[ST_CORNER_TOPLEFT],
+                   node->border_radius[ST_CORNER_TOPRIGHT]),
+              node->border_width[ST_SIDE_TOP]);
+  *bottom = MAX (MAX (node->border_radius[ST_CORNER_BOTTOMLEFT],
+                      node->border_radius[ST_CORNER_BOTTOMRIGHT]),
+                 node->border_width[ST_SIDE_BOTTOM]);
+}
+
+/* Whether the prerendered background can be rendered at the minimum
+ * box-shadow size along the axes it doesn't vary on, and stretched
+ * between the corners when painted. It then doesn't need to be rendered
+ * again while the allocation changes along those axes only.
+ *
+ * This is limited to nodes with an outer box-shadow, which is created
+ * from the prerendered texture and sliced the same way.
+ */
+static gboolean
+st_theme_node_can_slice_background (StThemeNode *node,
+                                    float        width,
+                                    float        height,
+                                    gboolean    *slice_x,
+                                    gboolean    *slice_y)
+{
+  StShadow *box_shadow_spec;
+  float left, right, top, bottom;
+
+  *slice_x = *slice_y = FALSE;
+
+  box_shadow_spec = st_theme_node_get_box_shadow (node);
+  if (box_shadow_spec == NULL || box_shadow_spec->inset)
+    return FALSE;
+
+  if (st_theme_node_get_background_image (node) != NULL ||
+      st_theme_node_get_border_image (node) != NULL)
+    return FALSE;
+
+  if (node->box_shadow_min_width == 0 || node->box_shadow_min_height == 0 ||
+      width < node->box_shadow_min_width || height < node->box_shadow_min_height)
+    return FALSE;
+
+  st_theme_node_get_background_slices (node, &left, &right, &top, &bottom);
+
+  *slice_x = node->background_gradient_type != ST_GRADIENT_HORIZONTAL &&
+             node->background_gradient_type != ST_GRADIENT_RADIAL &&
+             node->box_shadow_min_width > left + right;
+  *slice_y = node->background_gradient_type != ST_GRADIENT_VERTICAL &&
+             node->background_gradient_type != ST_GRADIENT_RADIAL &&
+             node->box_shadow_min_height > top + bottom;
+
+  return *slice_x || *slice_y;
+}
+
 static void
 st_theme_node_maybe_prerender_background (StThemeNodePaintState *state,
                                           StThemeNode           *node,
@@ -1416,6 +1807,20 @@ st_theme_node_maybe_prerender_background (StThemeNodePaintState *state,
     }
   }
 
+  /* Without anything that needs to be composited with the box, the
+   * cases the cogl code below can't handle are drawn on the GPU
+   * directly rather than prerendered with cairo
+   */
+  if ((node->background_gradient_type != ST_GRADIENT_NONE || has_large_corners) &&
+      box_shadow_spec == NULL &&
+      st_theme_node_get_border_image (node) == NULL &&
+      st_theme_node_get_background_image (node) == NULL)
+    {
+      state->rounded_box_pipeline =
+        st_theme_node_create_rounded_box_pipeline (node, width, height, resource_scale);
+      return;
+    }
+
   state->corner_material[ST_CORNER_TOPLEFT] =
     st_theme_node_lookup_corner (node, width, height, resource_scale, ST_CORNER_TOPLEFT);
   state->corner_material[ST_CORNER_TOPRIGHT] =
@@ -1439,7 +1844,29 @@ st_theme_node_maybe_prerender_background (StThemeNodePaintState *state,
       || (st_theme_node_get_background_image (node) && (has_border || has_border_radius))
       || has_large_corners)
     {
-      state->prerendered_texture = st_theme_node_prerender_background (node, width, height, resource_scale);
+      float prerender_width = width;
+      float prerender_height = height;
+
+      if (st_theme_node_can_slice_background (node, width, height,
+                                              &state->prerendered_slice_x,
+                                              &state->prerendered_slice_y))
+        {
+          if (state->prerendered_slice_x)
+            prerender_width = node->box_shadow_min_width;
+          if (state->prerendered_slice_y)
+            prerender_height = node->box_shadow_min_height;
+
+          /* The box-shadow is created from the prerendered texture */
+          state->box_shadow_width = prerender_width;
+          state->box_shadow_height = prerender_height;
+        }
+
+      state->prerendered_width = prerender_width;
+      state->prerendered_height = prerender_height;
+      state->prerendered_texture = st_theme_node_prerender_background (node,
+                                                                       prerender_width,
+                                                                       prerender_height,
+                                                                       resource_scale);
 
       if (state->prerendered_texture)
         state->prerendered_pipeline = _st_create_texture_pipeline (state->prerendered_texture);
@@ -1476,10 +1903,10 @@ st_theme_node_load_border_image (StThemeNode *node,
 
       file = st_border_image_get_file (border_image);
 
-      node->border_slices_texture = st_texture_cache_load_file_to_cogl_texture (st_texture_cache_get_default (),
-                                                                                file,
-                                                                                node->cached_scale_factor,
-                                                                                resource_scale);
+      node->border_slices_texture = st_texture_cache_try_load_file_to_cogl_texture (st_texture_cache_get_default (),
+                                                                                    file,
+                                                                                    node->cached_scale_factor,
+                                                                                    resource_scale);
       if (node->border_slices_texture == NULL)
         goto out;
 
@@ -1512,10 +1939,10 @@ st_theme_node_load_background_image (StThemeNode *node,
         goto out;
 
       background_image_shadow_spec = st_theme_node_get_background_image_shadow (node);
-      node->background_texture = st_texture_cache_load_file_to_cogl_texture (st_texture_cache_get_default (),
-                                                                             background_image,
-                                                                             node->cached_scale_factor,
-                                                                             resource_scale);
+      node->background_texture = st_texture_cache_try_load_file_to_cogl_texture (st_texture_cache_get_default (),
+                                                                                 background_image,
+                                                                                 node->cached_scale_factor,
+                                                                                 resource_scale);
       if (node->background_texture == NULL)
         goto out;
 
@@ -1595,12 +2022,15 @@ st_theme_node_render_resources (StThemeNodePaintState *state,
   box_shadow_spec = st_theme_node_get_box_shadow (node);
   has_inset_box_shadow = box_shadow_spec && box_shadow_spec->inset;
 
+  /* The prerendered background may be sliced based on the box-shadow
+   * geometry, so this must come first */
+  if (box_shadow_spec && !has_inset_box_shadow)
+    st_theme_node_compute_maximum_borders (state);
+
   st_theme_node_maybe_prerender_background (state, node, width, height, resource_scale);
 
   if (box_shadow_spec && !has_inset_box_shadow)
     {
-      st_theme_node_compute_maximum_borders (state);
-
       if (st_theme_node_load_border_image (node, resource_scale))
         state->box_shadow_pipeline = _st_create_shadow_pipeline (box_shadow_spec,
                                                                  node->border_slices_texture,
@@ -1618,6 +2048,7 @@ st_theme_node_render_resources (StThemeNodePaintState *state,
   if (!node->cached_textures)
     {
       if (state->prerendered_pipeline == NULL &&
+          state->rounded_box_pipeline == NULL &&
           width >= node->box_shadow_min_width &&
           height >= node->box_shadow_min_height)
         {
@@ -1639,8 +2070,24 @@ st_theme_node_update_resources (StThemeNodePaintState *state,
 
   g_return_if_fail (width > 0 && height > 0);
 
+  /* A sliced prerendered background (and the box-shadow created from it)
+   * can be stretched to the new size */
+  if (state->prerendered_pipeline != NULL &&
+      (state->prerendered_slice_x || state->prerendered_slice_y) &&
+      fabsf (state->resource_scale - resource_scale) < FLT_EPSILON &&
+      width >= node->box_shadow_min_width &&
+      height >= node->box_shadow_min_height &&
+      (state->prerendered_slice_x || width == state->alloc_width) &&
+      (state->prerendered_slice_y || height == state->alloc_height))
+    {
+      state->alloc_width = width;
+      state->alloc_height = height;
+      return;
+    }
+
   /* Free handles we can't reuse */
   g_clear_object (&state->prerendered_texture);
+  g_clear_object (&state->rounded_box_pipeline);
 
   if (state->prerendered_pipeline != NULL)
     {
@@ -1695,6 +2142,63 @@ paint_material_with_opacity (ClutterPaintNode *node,
     clutter_paint_node_add_rectangle (pipeline_node, box);
 }
 
+/* The area and texture coordinates of a corner texture, in the format
+ * of clutter_paint_node_add_texture_rectangles() */
+static void
+get_corner_rectangle (StCorner  corner_id,
+                      float     width,
+                      float     height,
+                      guint     size,
+                      float    *rect)
+{
+  switch (corner_id)
+    {
+    case ST_CORNER_TOPLEFT:
+      rect[0] = 0;
+      rect[1] = 0;
+      rect[2] = size;
+      rect[3] = size;
+      rect[4] = 0.0;
+      rect[5] = 0.0;
+      rect[6] = 0.5;
+      rect[7] = 0.5;
+      break;
+    case ST_CORNER_TOPRIGHT:
+      rect[0] = width - size;
+      rect[1] = 0;
+      rect[2] = width;
+      rect[3] = size;
+      rect[4] = 0.5;
+      rect[5] = 0.0;
+      rect[6] = 1.0;
+      rect[7] = 0.5;
+      break;
+    case ST_CORNER_BOTTOMRIGHT:
+      rect[0] = width - size;
+      rect[1] = height - size;
+      rect[2] = width;
+      rect[3] = height;
+      rect[4] = 0.5;
+      rect[5] = 0.5;
+      rect[6] = 1.0;
+      rect[7] = 1.0;
+      break;
+    case ST_CORNER_BOTTOMLEFT:
+      rect[0] = 0;
+      rect[1] = height - size;
+      rect[2] = size;
+      rect[3] = height;
+      rect[4] = 0.0;
+      rect[5] = 0.5;
+      rect[6] = 0.5;
+      rect[7] = 1.0;
+      break;
+    default:
+      g_assert_not_reached();
+      break;
+    }
+}
+
 static void
 st_theme_node_paint_borders (StThemeNodePaintState *state,
                              ClutterPaintNode      *root,
@@ -1821,11 +2325,18 @@ st_theme_node_paint_borders (StThemeNodePaintState *state,
   /* corners */
   if (max_border_radius > 0 && paint_opacity > 0 && !corners_are_transparent)
     {
+      gboolean corner_painted[4] = { FALSE, };
+
       for (corner_id = 0; corner_id < 4; corner_id++)
         {
           g_autoptr (ClutterPaintNode) corners_node = NULL;
+          CoglTexture *texture;
+          float rects[4 * 8];
+          int n_rects = 0;
+          int other_id;
 
-          if (state->corner_material[corner_id] == NULL)
+          if (state->corner_material[corner_id] == NULL ||
+              corner_painted[corner_id])
             continue;
 
           cogl_pipeline_set_color (state->corner_material[corner_id], &pipeline_color);
@@ -1836,55 +2347,25 @@ st_theme_node_paint_borders (StThemeNodePaintState *state,
                                               "StThemeNode (CSS border corners)");
           clutter_paint_node_add_child (root, corners_node);
 
-          switch (corner_id)
+          /* Symmetric corners share the same texture from the texture
+           * cache, so they can be drawn together */
+          texture = cogl_pipeline_get_layer_texture (state->corner_material[corner_id], 0);
+
+          for (other_id = corner_id; other_id < 4; other_id++)
             {
-            case ST_CORNER_TOPLEFT:
-              clutter_paint_node_add_texture_rectangle (corners_node,
-                                                        &(ClutterActorBox) {
-                                                          0, 0,
-                                                          max_width_radius[ST_CORNER_TOPLEFT],
-                                                          max_width_radius[ST_CORNER_TOPLEFT],
-                                                        },
-                                                        0.0, 0.0,
-                                                        0.5, 0.5);
-              break;
-            case ST_CORNER_TOPRIGHT:
-              clutter_paint_node_add_texture_rectangle (corners_node,
-                                                        &(ClutterActorBox) {
-                                                          width - max_width_radius[ST_CORNER_TOPRIGHT],
-                                                          0,
-                                                          width,
-                                                          max_width_radius[ST_CORNER_TOPRIGHT],
-                                                        },
-                                                        0.5, 0.0,
-                                                        1.0, 0.5);
-              break;
-            case ST_CORNER_BOTTOMRIGHT:
-              clutter_paint_node_add_texture_rectangle (corners_node,
-                                                        &(ClutterActorBox) {
-                                                          width - max_width_radius[ST_CORNER_BOTTOMRIGHT],
-                                                          height - max_width_radius[ST_CORNER_BOTTOMRIGHT],
-                                                          width,
-                                                          height,
-                                                        },
-                                                        0.5, 0.5,
-                                                        1.0, 1.0);
-              break;
-            case ST_CORNER_BOTTOMLEFT:
-              clutter_paint_node_add_texture_rectangle (corners_node,
-                                                        &(ClutterActorBox) {
-                                                          0,
-                                                          height - max_width_radius[ST_CORNER_BOTTOMLEFT],
-                                                          max_width_radius[ST_CORNER_BOTTOMLEFT],
-                                                          height,
-                                                        },
-                                                        0.0, 0.5,
-                                                        0.5, 1.0);
-              break;
-            default:
-              g_assert_not_reached();
-              break;
+              if (state->corner_material[other_id] == NULL ||
+                  corner_painted[other_id] ||
+                  cogl_pipeline_get_layer_texture (state->corner_material[other_id], 0) != texture)
+                continue;
+
+              get_corner_rectangle (other_id, width, height,
+                                    max_width_radius[other_id],
+                                    &rects[n_rects * 8]);
+              corner_painted[other_id] = TRUE;
+              n_rects++;
             }
+
+          clutter_paint_node_add_texture_rectangles (corners_node, rects, n_rects);
         }
     }
 
@@ -2503,6 +2984,86 @@ st_theme_node_compute_maximum_borders (StThemeNodePaintState *state)
     }
 }
 
+static void
+st_theme_node_paint_sliced_background (StThemeNodePaintState *state,
+                                       ClutterPaintNode      *root,
+                                       const ClutterActorBox *box,
+                                       guint8                 paint_opacity)
+{
+  g_autoptr (ClutterPaintNode) pipeline_node = NULL;
+  float left, right, top, bottom;
+  float x[4], y[4], tx[4], ty[4];
+  float rectangles[8 * 9];
+  int n_columns, n_rows;
+  int i, j, idx;
+  CoglColor color;
+
+  st_theme_node_get_background_slices (state->node, &left, &right, &top, &bottom);
+
+  x[0] = box->x1;
+  tx[0] = 0.0;
+  if (state->prerendered_slice_x)
+    {
+      x[1] = box->x1 + left;
+      x[2] = box->x2 - right;
+      tx[1] = left / state->prerendered_width;
+      tx[2] = (state->prerendered_width - right) / state->prerendered_width;
+      n_columns = 3;
+    }
+  else
+    {
+      n_columns = 1;
+    }
+  x[n_columns] = box->x2;
+  tx[n_columns] = 1.0;
+
+  y[0] = box->y1;
+  ty[0] = 0.0;
+  if (state->prerendered_slice_y)
+    {
+      y[1] = box->y1 + top;
+      y[2] = box->y2 - bottom;
+      ty[1] = top / state->prerendered_height;
+      ty[2] = (state->prerendered_height - bottom) / state->prerendered_height;
+      n_rows = 3;
+    }
+  else
+    {
+      n_rows = 1;
+    }
+  y[n_rows] = box->y2;
+  ty[n_rows] = 1.0;
+
+  idx = 0;
+  for (j = 0; j < n_rows; j++)
+    {
+      for (i = 0; i < n_columns; i++)
+        {
+          rectangles[idx++] = x[i];
+          rectangles[idx++] = y[j];
+          rectangles[idx++] = x[i + 1];
+          rectangles[idx++] = y[j + 1];
+
+          rectangles[idx++] = tx[i];
+          rectangles[idx++] = ty[j];
+          rectangles[idx++] = tx[i + 1];
+          rectangles[idx++] = ty[j + 1];
+        }
+    }
+
+  cogl_color_init_from_4f (&color,
+                           paint_opacity / 255.0, paint_opacity / 255.0,
+                           paint_opacity / 255.0, paint_opacity / 255.0);
+  cogl_pipeline_set_color (state->prerendered_pipeline, &color);
+
+  pipeline_node = clutter_pipeline_node_new (state->prerendered_pipeline);
+  clutter_paint_node_set_static_name (pipeline_node,
+                                      "StThemeNode (sliced background)");
+  clutter_paint_node_add_child (root, pipeline_node);
+  clutter_paint_node_add_texture_rectangles (pipeline_node, rectangles,
+                                             n_columns * n_rows);
+}
+
 static void
 st_theme_node_paint_sliced_border_image (StThemeNode      *node,
                                          ClutterPaintNode *root,
@@ -2805,10 +3366,26 @@ st_theme_node_paint (StThemeNode           *node,
                                            paint_opacity);
     }
 
-  if (state->prerendered_pipeline != NULL ||
-      st_theme_node_load_border_image (node, resource_scale))
+  if (state->rounded_box_pipeline != NULL)
     {
-      if (state->prerendered_pipeline != NULL)
+      ClutterActorBox coords = { 0, 0, 1, 1 };
+
+      paint_material_with_opacity (root,
+                                   state->rounded_box_pipeline,
+                                   &allocation,
+                                   &coords,
+                                   paint_opacity);
+    }
+  else if (state->prerendered_pipeline != NULL ||
+           st_theme_node_load_border_image (node, resource_scale))
+    {
+      if (state->prerendered_pipeline != NULL &&
+          (state->prerendered_slice_x || state->prerendered_slice_y))
+        {
+          st_theme_node_paint_sliced_background (state, root, &allocation,
+                                                 paint_opacity);
+        }
+      else if (state->prerendered_pipeline != NULL)
         {
           ClutterActorBox paint_box;
 
@@ -2896,6 +3473,7 @@ st_theme_node_paint_state_node_free_internal (StThemeNodePaintState *state,
 
   g_clear_object (&state->prerendered_texture);
   g_clear_object (&state->prerendered_pipeline);
+  g_clear_object (&state->rounded_box_pipeline);
   g_clear_object (&state->box_shadow_pipeline);
 
   for (corner_id = 0; corner_id < 4; corner_id++)
@@ -2946,6 +3524,11 @@ st_theme_node_paint_state_init (StThemeNodePaintState *state)
   state->box_shadow_pipeline = NULL;
   state->prerendered_texture = NULL;
   state->prerendered_pipeline = NULL;
+  state->prerendered_width = 0;
+  state->prerendered_height = 0;
+  state->prerendered_slice_x = FALSE;
+  state->prerendered_slice_y = FALSE;
+  state->rounded_box_pipeline = NULL;
 
   for (corner_id = 0; corner_id < 4; corner_id++)
     state->corner_material[corner_id] = NULL;
@@ -2969,6 +3552,10 @@ st_theme_node_paint_state_copy (StThemeNodePaintState *state,
   state->resource_scale = other->resource_scale;
   state->box_shadow_width = other->box_shadow_width;
   state->box_shadow_height = other->box_shadow_height;
+  state->prerendered_width = other->prerendered_width;
+  state->prerendered_height = other->prerendered_height;
+  state->prerendered_slice_x = other->prerendered_slice_x;
+  state->prerendered_slice_y = other->prerendered_slice_y;
 
   if (other->box_shadow_pipeline)
     state->box_shadow_pipeline = g_object_ref (other->box_shadow_pipeline);
@@ -2976,6 +3563,8 @@ st_theme_node_paint_state_copy (StThemeNodePaintState *state,
     state->prerendered_texture = g_object_ref (other->prerendered_texture);
   if (other->prerendered_pipeline)
     state->prerendered_pipeline = g_object_ref (other->prerendered_pipeline);
+  if (other->rounded_box_pipeline)
+    state->rounded_box_pipeline = g_object_ref (other->rounded_box_pipeline);
   for (corner_id = 0; corner_id < 4; corner_id++)
     if (other->corner_material[corner_id])
       state->corner_material[corner_id] = g_object_ref (other->corner_material[corner_id]);
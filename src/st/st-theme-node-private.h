@@ -23,6 +23,7 @@
 #define __ST_THEME_NODE_PRIVATE_H__
 
 #include "st-theme-node.h"
+#include "st-theme-private.h"
 #include "croco/libcroco.h"
 #include "st-types.h"
 
@@ -35,7 +36,8 @@ struct _StThemeNode {
   StThemeNode *parent_node;
   StTheme *theme;
 
-  PangoFontDescription *font_desc;
+  /* Interned in the context, shared with other nodes */
+  const PangoFontDescription *font_desc;
 
   CoglColor background_color;
   /* If gradient is set, then background_color is the gradient start */
@@ -84,6 +86,15 @@ struct _StThemeNode {
   CRDeclaration **properties;
   int n_properties;
 
+  /* Interned signature of this node in its theme, and the matched
+   * properties shared with the other nodes of the same signature.
+   * If the node has no inline style, @properties points into
+   * @shared_properties. @descendant_signature is the parent signature
+   * of the children of this node. */
+  StThemeSignature *signature;
+  StThemeSignature *descendant_signature;
+  GPtrArray *shared_properties;
+
   /* We hold onto these separately so we can destroy them on finalize */
   CRDeclaration *inline_properties;
 
@@ -101,6 +112,8 @@ struct _StThemeNode {
   guint link_type : 2;
   guint rendered_once : 1;
   guint cached_textures : 1;
+  guint accent_color_checked : 1;
+  guint uses_accent_color : 1;
 
   int box_shadow_min_width;
   int box_shadow_min_height;
@@ -123,6 +136,24 @@ void _st_theme_node_ensure_geometry (StThemeNode *node);
 void _st_theme_node_apply_margins (StThemeNode *node,
                                    ClutterActor *actor);
 
+gboolean _st_theme_node_uses_accent_color (StThemeNode *node);
+void _st_theme_node_fold_color_terms (CRDeclaration *decl_list);
+
+guint _st_theme_context_get_accent_serial (StThemeContext *context);
+const PangoFontDescription *_st_theme_context_intern_font (StThemeContext       *context,
+                                                           PangoFontDescription *font);
+
+gboolean      _st_theme_node_can_interpolate               (StThemeNode  *node,
+                                                            StThemeNode  *other);
+CoglPipeline *_st_theme_node_create_interpolation_pipeline (StThemeNode  *node,
+                                                            float         width,
+                                                            float         height,
+                                                            float         resource_scale);
+void          _st_theme_node_interpolate_pipeline          (CoglPipeline *pipeline,
+                                                            StThemeNode  *from,
+                                                            StThemeNode  *to,
+                                                            float         progress);
+
 G_END_DECLS
 
 #endif /* __ST_THEME_NODE_PRIVATE_H__ */
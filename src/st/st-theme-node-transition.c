@@ -22,6 +22,7 @@
 #include <math.h>
 
 #include "st-theme-node-transition.h"
+#include "st-theme-node-private.h"
 
 enum {
   COMPLETED,
@@ -52,6 +53,9 @@ struct _StThemeNodeTransitionPrivate {
 
   CoglPipeline *material;
 
+  /* Set instead of the offscreens when only colors change */
+  CoglPipeline *interpolation_pipeline;
+
   ClutterTimeline *timeline;
 
   gulong timeline_completed_id;
@@ -201,6 +205,7 @@ st_theme_node_transition_update (StThemeNodeTransition *transition,
           priv->new_theme_node = g_object_ref (new_node);
 
           st_theme_node_paint_state_invalidate (&priv->new_paint_state);
+          priv->needs_setup = TRUE;
         }
     }
 }
@@ -242,6 +247,66 @@ st_theme_node_transition_get_paint_box (StThemeNodeTransition *transition,
   paint_box->y2 = MAX (old_node_box.y2, new_node_box.y2);
 }
 
+static gboolean
+setup_interpolation (StThemeNodeTransition *transition,
+                     const ClutterActorBox *allocation,
+                     float                  resource_scale)
+{
+  StThemeNodeTransitionPrivate *priv = transition->priv;
+
+  g_clear_object (&priv->interpolation_pipeline);
+
+  if (!_st_theme_node_can_interpolate (priv->old_theme_node,
+                                       priv->new_theme_node))
+    return FALSE;
+
+  priv->interpolation_pipeline =
+    _st_theme_node_create_interpolation_pipeline (priv->new_theme_node,
+                                                  allocation->x2 - allocation->x1,
+                                                  allocation->y2 - allocation->y1,
+                                                  resource_scale);
+
+  /* The nodes are painted directly, so nothing stays offscreen */
+  g_clear_object (&priv->old_offscreen);
+  g_clear_object (&priv->new_offscreen);
+  g_clear_object (&priv->old_texture);
+  g_clear_object (&priv->new_texture);
+
+  return TRUE;
+}
+
+static void
+paint_interpolated (StThemeNodeTransition *transition,
+                    ClutterPaintNode      *node,
+                    guint8                 paint_opacity)
+{
+  StThemeNodeTransitionPrivate *priv = transition->priv;
+  g_autoptr (ClutterPaintNode) pipeline_node = NULL;
+  CoglColor pipeline_color;
+  ClutterActorBox box;
+
+  _st_theme_node_interpolate_pipeline (priv->interpolation_pipeline,
+                                       priv->old_theme_node,
+                                       priv->new_theme_node,
+                                       clutter_timeline_get_progress (priv->timeline));
+
+  cogl_color_init_from_4f (&pipeline_color,
+                           paint_opacity / 255.0, paint_opacity / 255.0,
+                           paint_opacity / 255.0, paint_opacity / 255.0);
+  cogl_pipeline_set_color (priv->interpolation_pipeline, &pipeline_color);
+
+  box.x1 = box.y1 = 0;
+  box.x2 = priv->last_allocation.x2 - priv->last_allocation.x1;
+  box.y2 = priv->last_allocation.y2 - priv->last_allocation.y1;
+
+  pipeline_node = clutter_pipeline_node_new (priv->interpolation_pipeline);
+  clutter_paint_node_set_static_name (pipeline_node,
+                                      "StThemeNodeTransition (interpolated)");
+  clutter_paint_node_add_child (node, pipeline_node);
+  clutter_paint_node_add_texture_rectangle (pipeline_node, &box,
+                                            0.0, 0.0, 1.0, 1.0);
+}
+
 static gboolean
 setup_framebuffers (StThemeNodeTransition *transition,
                     ClutterPaintNode      *node,
@@ -379,17 +444,31 @@ st_theme_node_transition_paint (StThemeNodeTransition *transition,
     {
       priv->last_allocation = *allocation;
 
-      calculate_offscreen_box (transition, allocation);
-      priv->needs_setup = clutter_actor_box_get_area (&priv->offscreen_box) == 0 ||
-                          !setup_framebuffers (transition,
-                                               node,
-                                               allocation,
-                                               resource_scale);
+      if (clutter_actor_box_get_area (allocation) > 0 &&
+          setup_interpolation (transition, allocation, resource_scale))
+        {
+          priv->needs_setup = FALSE;
+        }
+      else
+        {
+          calculate_offscreen_box (transition, allocation);
+          priv->needs_setup = clutter_actor_box_get_area (&priv->offscreen_box) == 0 ||
+                              !setup_framebuffers (transition,
+                                                   node,
+                                                   allocation,
+                                                   resource_scale);
+        }
 
       if (priv->needs_setup) /* setting up framebuffers failed */
         return;
     }
 
+  if (priv->interpolation_pipeline != NULL)
+    {
+      paint_interpolated (transition, node, paint_opacity);
+      return;
+    }
+
   cogl_color_init_from_4f (&constant, 0., 0., 0.,
                            clutter_timeline_get_progress (priv->timeline));
   cogl_pipeline_set_layer_combine_constant (priv->material, 1, &constant);
@@ -422,6 +501,7 @@ st_theme_node_transition_dispose (GObject *object)
   g_clear_object (&priv->new_offscreen);
 
   g_clear_object (&priv->material);
+  g_clear_object (&priv->interpolation_pipeline);
 
   if (priv->timeline)
     {
@@ -40,6 +40,27 @@ static const CoglColor DEFAULT_SUCCESS_COLOR = { 0x4e, 0x9a, 0x06, 0xff };
 static const CoglColor DEFAULT_WARNING_COLOR = { 0xf5, 0x79, 0x3e, 0xff };
 static const CoglColor DEFAULT_ERROR_COLOR = { 0xcc, 0x00, 0x00, 0xff };
 
+/* Names of the properties looked up by name in this file */
+/* Calls to the adjust_preferred_*() helpers, which every St widget
+ * makes whenever Clutter's own size request cache misses */
+static guint n_width_requests = 0;
+static guint n_height_requests = 0;
+
+static GQuark quark_color;
+static GQuark quark_st_icon_style;
+static GQuark quark_text_decoration;
+static GQuark quark_font;
+static GQuark quark_font_family;
+static GQuark quark_font_weight;
+static GQuark quark_font_style;
+static GQuark quark_font_variant;
+static GQuark quark_font_size;
+static GQuark quark_font_feature_settings;
+static GQuark quark_border_image;
+static GQuark quark_warning_color;
+static GQuark quark_error_color;
+static GQuark quark_success_color;
+
 G_DEFINE_TYPE (StThemeNode, st_theme_node, G_TYPE_OBJECT)
 
 static void
@@ -57,22 +78,45 @@ st_theme_node_class_init (StThemeNodeClass *klass)
 
   object_class->dispose = st_theme_node_dispose;
   object_class->finalize = st_theme_node_finalize;
+
+  quark_color = g_quark_from_static_string ("color");
+  quark_st_icon_style = g_quark_from_static_string ("-st-icon-style");
+  quark_text_decoration = g_quark_from_static_string ("text-decoration");
+  quark_font = g_quark_from_static_string ("font");
+  quark_font_family = g_quark_from_static_string ("font-family");
+  quark_font_weight = g_quark_from_static_string ("font-weight");
+  quark_font_style = g_quark_from_static_string ("font-style");
+  quark_font_variant = g_quark_from_static_string ("font-variant");
+  quark_font_size = g_quark_from_static_string ("font-size");
+  quark_font_feature_settings = g_quark_from_static_string ("font-feature-settings");
+  quark_border_image = g_quark_from_static_string ("border-image");
+  quark_warning_color = g_quark_from_static_string ("warning-color");
+  quark_error_color = g_quark_from_static_string ("error-color");
+  quark_success_color = g_quark_from_static_string ("success-color");
 }
 
 static void
 maybe_free_properties (StThemeNode *node)
 {
-  if (node->properties)
+  if (node->shared_properties)
+    {
+      if (node->properties != (CRDeclaration **) node->shared_properties->pdata)
+        g_free (node->properties);
+      g_clear_pointer (&node->shared_properties, g_ptr_array_unref);
+    }
+  else
     {
       g_free (node->properties);
-      node->properties = NULL;
-      node->n_properties = 0;
     }
 
+  node->properties = NULL;
+  node->n_properties = 0;
+
   if (node->inline_properties)
     {
-      /* This destroys the list, not just the head of the list */
-      cr_declaration_destroy (node->inline_properties);
+      /* The list may be shared through the theme's inline style cache;
+       * the last reference destroys the list, not just its head */
+      cr_declaration_unref (node->inline_properties);
       node->inline_properties = NULL;
     }
 }
@@ -102,6 +146,9 @@ st_theme_node_dispose (GObject *gobject)
 
   st_theme_node_paint_state_free (&node->cached_state);
 
+  /* The signature is interned in the theme, so drop it first */
+  g_clear_pointer (&node->signature, _st_theme_signature_unref);
+  g_clear_pointer (&node->descendant_signature, _st_theme_signature_unref);
   g_clear_object (&node->theme);
 
   G_OBJECT_CLASS (st_theme_node_parent_class)->dispose (gobject);
@@ -119,8 +166,6 @@ st_theme_node_finalize (GObject *object)
 
   maybe_free_properties (node);
 
-  g_clear_pointer (&node->font_desc, pango_font_description_free);
-
   g_clear_pointer (&node->box_shadow, st_shadow_unref);
   g_clear_pointer (&node->background_image_shadow, st_shadow_unref);
   g_clear_pointer (&node->text_shadow, st_shadow_unref);
@@ -443,16 +488,75 @@ st_theme_node_hash (StThemeNode *node)
   return hash;
 }
 
+static StThemeSignature *
+get_parent_signature (StThemeNode *node,
+                      gboolean    *ok)
+{
+  StThemeNode *parent = node->parent_node;
+
+  *ok = TRUE;
+
+  if (!parent)
+    return NULL;
+
+  /* Signatures are per theme; a subtree with a different theme
+   * than its parent just resolves its properties uncached */
+  if (parent->theme != node->theme)
+    {
+      *ok = FALSE;
+      return NULL;
+    }
+
+  if (!parent->descendant_signature)
+    {
+      StThemeSignature *grandparent_signature;
+
+      grandparent_signature = get_parent_signature (parent, ok);
+      if (!*ok)
+        return NULL;
+
+      parent->descendant_signature =
+        _st_theme_intern_signature (parent->theme, grandparent_signature, parent, TRUE);
+    }
+
+  return parent->descendant_signature;
+}
+
+static StThemeSignature *
+ensure_signature (StThemeNode *node)
+{
+  StThemeSignature *parent_signature;
+  gboolean ok;
+
+  if (node->signature)
+    return node->signature;
+
+  if (!node->theme)
+    return NULL;
+
+  parent_signature = get_parent_signature (node, &ok);
+  if (!ok)
+    return NULL;
+
+  node->signature = _st_theme_intern_signature (node->theme, parent_signature, node, FALSE);
+
+  return node->signature;
+}
+
 static void
 ensure_properties (StThemeNode *node)
 {
   if (!node->properties_computed)
     {
+      StThemeSignature *signature;
       GPtrArray *properties = NULL;
 
       node->properties_computed = TRUE;
 
-      if (node->theme)
+      signature = ensure_signature (node);
+      if (signature)
+        node->shared_properties = _st_theme_signature_get_matched_properties (signature, node);
+      else if (node->theme)
         properties = _st_theme_get_matched_properties (node->theme, node);
 
       if (node->inline_style && *node->inline_style != '\0')
@@ -460,9 +564,23 @@ ensure_properties (StThemeNode *node)
           CRDeclaration *cur_decl;
 
           if (!properties)
-            properties = g_ptr_array_new ();
+            {
+              if (node->shared_properties)
+                {
+                  properties = g_ptr_array_sized_new (node->shared_properties->len);
+                  g_ptr_array_extend (properties, node->shared_properties, NULL, NULL);
+                }
+              else
+                {
+                  properties = g_ptr_array_new ();
+                }
+            }
 
-          node->inline_properties = _st_theme_parse_declaration_list (node->inline_style);
+          if (node->theme)
+            node->inline_properties = _st_theme_get_inline_declarations (node->theme,
+                                                                         node->inline_style);
+          else
+            node->inline_properties = _st_theme_parse_declaration_list (node->inline_style);
           for (cur_decl = node->inline_properties; cur_decl; cur_decl = cur_decl->next)
             g_ptr_array_add (properties, cur_decl);
         }
@@ -472,6 +590,11 @@ ensure_properties (StThemeNode *node)
           node->n_properties = properties->len;
           node->properties = (CRDeclaration **)g_ptr_array_free (properties, FALSE);
         }
+      else if (node->shared_properties)
+        {
+          node->n_properties = node->shared_properties->len;
+          node->properties = (CRDeclaration **) node->shared_properties->pdata;
+        }
     }
 }
 
@@ -516,6 +639,52 @@ term_is_accent_fg_color (CRTerm *term)
           strcmp (term->content.str->stryng->str, "-st-accent-fg-color") == 0);
 }
 
+static gboolean
+term_uses_accent_color (CRTerm *term)
+{
+  for (; term; term = term->next)
+    {
+      if (term_is_accent_color (term) || term_is_accent_fg_color (term))
+        return TRUE;
+
+      if (term->type == TERM_FUNCTION &&
+          term_uses_accent_color (term->ext_content.func_param))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/**
+ * _st_theme_node_uses_accent_color:
+ * @node: a #StThemeNode
+ *
+ * Checks whether any property of @node or of its ancestors, which it
+ * may inherit, refers to the accent colors.
+ *
+ * Returns: whether @node has to be resolved again when they change
+ */
+gboolean
+_st_theme_node_uses_accent_color (StThemeNode *node)
+{
+  if (!node->accent_color_checked)
+    {
+      int i;
+
+      ensure_properties (node);
+
+      node->accent_color_checked = TRUE;
+      node->uses_accent_color =
+        node->parent_node != NULL &&
+        _st_theme_node_uses_accent_color (node->parent_node);
+
+      for (i = 0; i < node->n_properties && !node->uses_accent_color; i++)
+        node->uses_accent_color = term_uses_accent_color (node->properties[i]->value);
+    }
+
+  return node->uses_accent_color;
+}
+
 static int
 color_component_from_double (double component)
 {
@@ -529,6 +698,37 @@ color_component_from_double (double component)
     return (int)(component * 256);
 }
 
+/* The color computed for a color function term of a declaration, kept
+ * in the app_data of the term by _st_theme_node_fold_color_terms() */
+typedef struct {
+  CoglColor color;
+  GetFromTermResult result;
+  /* For terms depending on the accent colors, the accent serial of the
+   * context the color was computed for, 0 if it wasn't yet */
+  guint accent_serial;
+  guint uses_accent_color : 1;
+} ColorTermCache;
+
+static gboolean
+term_is_color_function (CRTerm *term)
+{
+  const char *name;
+
+  if (term->type != TERM_FUNCTION ||
+      !term->content.str ||
+      !term->content.str->stryng ||
+      !term->content.str->stryng->str)
+    return FALSE;
+
+  name = term->content.str->stryng->str;
+
+  return (strcmp (name, "rgba") == 0 ||
+          strcmp (name, "st-transparentize") == 0 ||
+          strcmp (name, "st-mix") == 0 ||
+          strcmp (name, "st-lighten") == 0 ||
+          strcmp (name, "st-darken") == 0);
+}
+
 static GetFromTermResult
 get_color_from_rgba_term (CRTerm    *term,
                           CoglColor *color)
@@ -802,9 +1002,9 @@ get_color_from_darken_term (StThemeNode *node,
 }
 
 static GetFromTermResult
-get_color_from_term (StThemeNode  *node,
-                     CRTerm       *term,
-                     CoglColor    *color)
+compute_color_from_term (StThemeNode  *node,
+                         CRTerm       *term,
+                         CoglColor    *color)
 {
   CRRgb rgb;
   enum CRStatus status;
@@ -897,6 +1097,77 @@ get_color_from_term (StThemeNode  *node,
   return VALUE_FOUND;
 }
 
+static GetFromTermResult
+get_color_from_term (StThemeNode  *node,
+                     CRTerm       *term,
+                     CoglColor    *color)
+{
+  ColorTermCache *cache = term->app_data;
+  guint accent_serial;
+
+  if (cache == NULL)
+    return compute_color_from_term (node, term, color);
+
+  if (cache->uses_accent_color)
+    {
+      accent_serial = _st_theme_context_get_accent_serial (node->context);
+
+      if (cache->accent_serial != accent_serial)
+        {
+          cache->result = compute_color_from_term (node, term, &cache->color);
+          cache->accent_serial = accent_serial;
+        }
+    }
+
+  if (cache->result == VALUE_FOUND)
+    *color = cache->color;
+
+  return cache->result;
+}
+
+/**
+ * _st_theme_node_fold_color_terms:
+ * @decl_list: a list of declarations
+ *
+ * Evaluates the color functions in the values of @decl_list ahead of time,
+ * so that resolving them for every node that matches the declarations
+ * doesn't walk their arguments again. Colors that depend on the accent
+ * colors are instead computed on first use, and again only after the
+ * accent colors changed.
+ *
+ * This doesn't need any theme node or context, so it can be done right
+ * after parsing, in any thread.
+ */
+void
+_st_theme_node_fold_color_terms (CRDeclaration *decl_list)
+{
+  CRDeclaration *decl;
+  CRTerm *term;
+
+  for (decl = decl_list; decl; decl = decl->next)
+    {
+      for (term = decl->value; term; term = term->next)
+        {
+          ColorTermCache *cache;
+
+          if (term->app_data || !term_is_color_function (term))
+            continue;
+
+          cache = cr_arena_alloc0 (sizeof (ColorTermCache));
+          if (!cache)
+            continue;
+
+          /* Only the accent colors need the node */
+          cache->uses_accent_color =
+            term_uses_accent_color (term->ext_content.func_param);
+          if (!cache->uses_accent_color)
+            cache->result = compute_color_from_term (NULL, term, &cache->color);
+
+          term->app_data = cache;
+        }
+    }
+}
+
 /**
  * st_theme_node_lookup_color:
  * @node: a #StThemeNode
@@ -927,18 +1198,24 @@ st_theme_node_lookup_color (StThemeNode  *node,
                             CoglColor    *color)
 {
 
+  GQuark property_quark;
   int i;
 
   g_return_val_if_fail (ST_IS_THEME_NODE(node), FALSE);
   g_return_val_if_fail (property_name != NULL, FALSE);
 
+  /* No declaration can use a name that was never interned */
+  property_quark = g_quark_try_string (property_name);
+  if (property_quark == 0)
+    return FALSE;
+
   ensure_properties (node);
 
   for (i = node->n_properties - 1; i >= 0; i--)
     {
       CRDeclaration *decl = node->properties[i];
 
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
+      if (_st_declaration_get_property_quark (decl) == property_quark)
         {
           GetFromTermResult result = get_color_from_term (node, decl->value, color);
           if (result == VALUE_FOUND)
@@ -1020,18 +1297,24 @@ st_theme_node_lookup_double (StThemeNode *node,
                              double      *value)
 {
   gboolean result = FALSE;
+  GQuark property_quark;
   int i;
 
   g_return_val_if_fail (ST_IS_THEME_NODE(node), FALSE);
   g_return_val_if_fail (property_name != NULL, FALSE);
 
+  /* No declaration can use a name that was never interned */
+  property_quark = g_quark_try_string (property_name);
+  if (property_quark == 0)
+    return FALSE;
+
   ensure_properties (node);
 
   for (i = node->n_properties - 1; i >= 0; i--)
     {
       CRDeclaration *decl = node->properties[i];
 
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
+      if (_st_declaration_get_property_quark (decl) == property_quark)
         {
           CRTerm *term = decl->value;
 
@@ -1076,18 +1359,24 @@ st_theme_node_lookup_time (StThemeNode *node,
                            double      *value)
 {
   gboolean result = FALSE;
+  GQuark property_quark;
   int i;
 
   g_return_val_if_fail (ST_IS_THEME_NODE(node), FALSE);
   g_return_val_if_fail (property_name != NULL, FALSE);
 
+  /* No declaration can use a name that was never interned */
+  property_quark = g_quark_try_string (property_name);
+  if (property_quark == 0)
+    return FALSE;
+
   ensure_properties (node);
 
   for (i = node->n_properties - 1; i >= 0; i--)
     {
       CRDeclaration *decl = node->properties[i];
 
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
+      if (_st_declaration_get_property_quark (decl) == property_quark)
         {
           CRTerm *term = decl->value;
           int factor = 1;
@@ -1171,18 +1460,24 @@ st_theme_node_lookup_url (StThemeNode  *node,
                           GFile       **file)
 {
   gboolean result = FALSE;
+  GQuark property_quark;
   int i;
 
   g_return_val_if_fail (ST_IS_THEME_NODE(node), FALSE);
   g_return_val_if_fail (property_name != NULL, FALSE);
 
+  /* No declaration can use a name that was never interned */
+  property_quark = g_quark_try_string (property_name);
+  if (property_quark == 0)
+    return FALSE;
+
   ensure_properties (node);
 
   for (i = node->n_properties - 1; i >= 0; i--)
     {
       CRDeclaration *decl = node->properties[i];
 
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
+      if (_st_declaration_get_property_quark (decl) == property_quark)
         {
           CRTerm *term = decl->value;
           CRStyleSheet *base_stylesheet;
@@ -1421,15 +1716,21 @@ get_length_internal (StThemeNode *node,
                      const char  *property_name,
                      gdouble     *length)
 {
+  GQuark property_quark;
   int i;
 
+  /* No declaration can use a name that was never interned */
+  property_quark = g_quark_try_string (property_name);
+  if (property_quark == 0)
+    return VALUE_NOT_FOUND;
+
   ensure_properties (node);
 
   for (i = node->n_properties - 1; i >= 0; i--)
     {
       CRDeclaration *decl = node->properties[i];
 
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
+      if (_st_declaration_get_property_quark (decl) == property_quark)
         {
           GetFromTermResult result = get_length_from_term (node, decl->value, FALSE, length);
           if (result != VALUE_NOT_FOUND)
@@ -2574,7 +2875,7 @@ st_theme_node_get_foreground_color (StThemeNode  *node,
         {
           CRDeclaration *decl = node->properties[i];
 
-          if (strcmp (decl->property->stryng->str, "color") == 0)
+          if (_st_declaration_get_property_quark (decl) == quark_color)
             {
               GetFromTermResult result = get_color_from_term (node, decl->value, &node->foreground_color);
               if (result == VALUE_FOUND)
@@ -2741,7 +3042,7 @@ st_theme_node_get_icon_style (StThemeNode *node)
     {
       CRDeclaration *decl = node->properties[i];
 
-      if (strcmp (decl->property->stryng->str, "-st-icon-style") == 0)
+      if (_st_declaration_get_property_quark (decl) == quark_st_icon_style)
         {
           CRTerm *term;
 
@@ -2793,7 +3094,7 @@ st_theme_node_get_text_decoration (StThemeNode *node)
     {
       CRDeclaration *decl = node->properties[i];
 
-      if (strcmp (decl->property->stryng->str, "text-decoration") == 0)
+      if (_st_declaration_get_property_quark (decl) == quark_text_decoration)
         {
           CRTerm *term = decl->value;
           StTextDecoration decoration = 0;
@@ -3214,6 +3515,8 @@ st_theme_node_get_font (StThemeNode *node)
 
   g_return_val_if_fail (ST_IS_THEME_NODE (node), NULL);
 
+  const PangoFontDescription *parent_font;
+  PangoFontDescription *font_desc;
   char *family = NULL;
   double parent_size;
   int i;
@@ -3221,9 +3524,9 @@ st_theme_node_get_font (StThemeNode *node)
   if (node->font_desc)
     return node->font_desc;
 
-  node->font_desc = pango_font_description_copy (get_parent_font (node));
-  parent_size = pango_font_description_get_size (node->font_desc);
-  if (!pango_font_description_get_size_is_absolute (node->font_desc))
+  parent_font = get_parent_font (node);
+  parent_size = pango_font_description_get_size (parent_font);
+  if (!pango_font_description_get_size_is_absolute (parent_font))
     {
       double resolution = clutter_backend_get_resolution (clutter_get_default_backend ());
       parent_size *= (resolution / 72.);
@@ -3235,7 +3538,7 @@ st_theme_node_get_font (StThemeNode *node)
     {
       CRDeclaration *decl = node->properties[i];
 
-      if (strcmp (decl->property->stryng->str, "font") == 0)
+      if (_st_declaration_get_property_quark (decl) == quark_font)
         {
           PangoStyle tmp_style = PANGO_STYLE_NORMAL;
           PangoVariant tmp_variant = PANGO_VARIANT_NORMAL;
@@ -3304,7 +3607,7 @@ st_theme_node_get_font (StThemeNode *node)
           size_set = TRUE;
 
         }
-      else if (strcmp (decl->property->stryng->str, "font-family") == 0)
+      else if (_st_declaration_get_property_quark (decl) == quark_font_family)
         {
           if (!font_family_from_terms (decl->value, &family))
             {
@@ -3312,7 +3615,7 @@ st_theme_node_get_font (StThemeNode *node)
               continue;
             }
         }
-      else if (strcmp (decl->property->stryng->str, "font-weight") == 0)
+      else if (_st_declaration_get_property_quark (decl) == quark_font_weight)
         {
           if (decl->value == NULL || decl->value->next != NULL)
             continue;
@@ -3320,7 +3623,7 @@ st_theme_node_get_font (StThemeNode *node)
           if (font_weight_from_term (decl->value, &weight, &weight_absolute))
             weight_set = TRUE;
         }
-      else if (strcmp (decl->property->stryng->str, "font-style") == 0)
+      else if (_st_declaration_get_property_quark (decl) == quark_font_style)
         {
           if (decl->value == NULL || decl->value->next != NULL)
             continue;
@@ -3328,7 +3631,7 @@ st_theme_node_get_font (StThemeNode *node)
           if (font_style_from_term (decl->value, &font_style))
             font_style_set = TRUE;
         }
-      else if (strcmp (decl->property->stryng->str, "font-variant") == 0)
+      else if (_st_declaration_get_property_quark (decl) == quark_font_variant)
         {
           if (decl->value == NULL || decl->value->next != NULL)
             continue;
@@ -3336,7 +3639,7 @@ st_theme_node_get_font (StThemeNode *node)
           if (font_variant_from_term (decl->value, &variant))
             variant_set = TRUE;
         }
-      else if (strcmp (decl->property->stryng->str, "font-size") == 0)
+      else if (_st_declaration_get_property_quark (decl) == quark_font_size)
         {
           gdouble tmp_size;
           if (decl->value == NULL || decl->value->next != NULL)
@@ -3351,14 +3654,23 @@ st_theme_node_get_font (StThemeNode *node)
         }
     }
 
+  /* Most nodes don't change the font they inherit */
+  if (!family && !size_set && !weight_set && !font_style_set && !variant_set)
+    {
+      node->font_desc = parent_font;
+      return node->font_desc;
+    }
+
+  font_desc = pango_font_description_copy (parent_font);
+
   if (family)
     {
-      pango_font_description_set_family (node->font_desc, family);
+      pango_font_description_set_family (font_desc, family);
       g_free (family);
     }
 
   if (size_set)
-    pango_font_description_set_absolute_size (node->font_desc, size);
+    pango_font_description_set_absolute_size (font_desc, size);
 
   if (weight_set)
     {
@@ -3370,7 +3682,7 @@ st_theme_node_get_font (StThemeNode *node)
            * normal to bold.
            */
 
-          PangoWeight old_weight = pango_font_description_get_weight (node->font_desc);
+          PangoWeight old_weight = pango_font_description_get_weight (font_desc);
           if (weight == PANGO_WEIGHT_BOLD)
             weight = old_weight + 200;
           else
@@ -3382,13 +3694,15 @@ st_theme_node_get_font (StThemeNode *node)
             weight = 900;
         }
 
-      pango_font_description_set_weight (node->font_desc, weight);
+      pango_font_description_set_weight (font_desc, weight);
     }
 
   if (font_style_set)
-    pango_font_description_set_style (node->font_desc, font_style);
+    pango_font_description_set_style (font_desc, font_style);
   if (variant_set)
-    pango_font_description_set_variant (node->font_desc, variant);
+    pango_font_description_set_variant (font_desc, variant);
+
+  node->font_desc = _st_theme_context_intern_font (node->context, font_desc);
 
   return node->font_desc;
 }
@@ -3414,7 +3728,7 @@ st_theme_node_get_font_features (StThemeNode *node)
     {
       CRDeclaration *decl = node->properties[i];
 
-      if (strcmp (decl->property->stryng->str, "font-feature-settings") == 0)
+      if (_st_declaration_get_property_quark (decl) == quark_font_feature_settings)
         {
           CRTerm *term = decl->value;
 
@@ -3464,7 +3778,7 @@ st_theme_node_get_border_image (StThemeNode *node)
     {
       CRDeclaration *decl = node->properties[i];
 
-      if (strcmp (decl->property->stryng->str, "border-image") == 0)
+      if (_st_declaration_get_property_quark (decl) == quark_border_image)
         {
           CRTerm *term = decl->value;
           CRStyleSheet *base_stylesheet;
@@ -3788,18 +4102,24 @@ st_theme_node_lookup_shadow (StThemeNode  *node,
   gboolean inset = FALSE;
   gboolean is_none = FALSE;
 
+  GQuark property_quark;
   int i;
 
   g_return_val_if_fail (ST_IS_THEME_NODE (node), FALSE);
   g_return_val_if_fail (property_name != NULL, FALSE);
 
+  /* No declaration can use a name that was never interned */
+  property_quark = g_quark_try_string (property_name);
+  if (property_quark == 0)
+    return FALSE;
+
   ensure_properties (node);
 
   for (i = node->n_properties - 1; i >= 0; i--)
     {
       CRDeclaration *decl = node->properties[i];
 
-      if (strcmp (decl->property->stryng->str, property_name) == 0)
+      if (_st_declaration_get_property_quark (decl) == property_quark)
         {
           GetFromTermResult result = parse_shadow_property (node,
                                                             decl,
@@ -4056,25 +4376,25 @@ st_theme_node_get_icon_colors (StThemeNode *node)
       guint found = 0;
 
       if ((still_need & FOREGROUND) != 0 &&
-          strcmp (decl->property->stryng->str, "color") == 0)
+          _st_declaration_get_property_quark (decl) == quark_color)
         {
           found = FOREGROUND;
           result = get_color_from_term (node, decl->value, &color);
         }
       else if ((still_need & WARNING) != 0 &&
-               strcmp (decl->property->stryng->str, "warning-color") == 0)
+               _st_declaration_get_property_quark (decl) == quark_warning_color)
         {
           found = WARNING;
           result = get_color_from_term (node, decl->value, &color);
         }
       else if ((still_need & ERROR) != 0 &&
-               strcmp (decl->property->stryng->str, "error-color") == 0)
+               _st_declaration_get_property_quark (decl) == quark_error_color)
         {
           found = ERROR;
           result = get_color_from_term (node, decl->value, &color);
         }
       else if ((still_need & SUCCESS) != 0 &&
-               strcmp (decl->property->stryng->str, "success-color") == 0)
+               _st_declaration_get_property_quark (decl) == quark_success_color)
         {
           found = SUCCESS;
           result = get_color_from_term (node, decl->value, &color);
@@ -4180,6 +4500,8 @@ st_theme_node_adjust_preferred_width (StThemeNode  *node,
 
   g_return_if_fail (ST_IS_THEME_NODE (node));
 
+  n_width_requests++;
+
   _st_theme_node_ensure_geometry (node);
 
   width_inc = get_width_inc (node);
@@ -4247,6 +4569,8 @@ st_theme_node_adjust_preferred_height (StThemeNode  *node,
 
   g_return_if_fail (ST_IS_THEME_NODE (node));
 
+  n_height_requests++;
+
   _st_theme_node_ensure_geometry (node);
 
   height_inc = get_height_inc (node);
@@ -4267,6 +4591,28 @@ st_theme_node_adjust_preferred_height (StThemeNode  *node,
     }
 }
 
+/**
+ * st_theme_node_get_size_request_stats:
+ * @width_requests: (out) (optional): return location for the number of
+ *   preferred widths computed by St widgets
+ * @height_requests: (out) (optional): return location for the number of
+ *   preferred heights computed by St widgets
+ *
+ * Clutter caches the preferred size of each actor until it queues a
+ * relayout, so these count the requests that missed that cache and had
+ * the widget measure its content again.
+ */
+void
+st_theme_node_get_size_request_stats (guint *width_requests,
+                                      guint *height_requests)
+{
+  if (width_requests)
+    *width_requests = n_width_requests;
+
+  if (height_requests)
+    *height_requests = n_height_requests;
+}
+
 /**
  * st_theme_node_get_content_box:
  * @node: a #StThemeNode
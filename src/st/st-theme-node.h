@@ -172,6 +172,14 @@ struct _StThemeNodePaintState {
   CoglPipeline *box_shadow_pipeline;
   CoglTexture *prerendered_texture;
   CoglPipeline *prerendered_pipeline;
+  CoglPipeline *rounded_box_pipeline;
+
+  /* Size of the prerendered background, which is stretched between
+   * its corners along the sliced axes */
+  float prerendered_width;
+  float prerendered_height;
+  gboolean prerendered_slice_x;
+  gboolean prerendered_slice_y;
   CoglPipeline *corner_material[4];
 };
 
@@ -319,6 +327,9 @@ void st_theme_node_adjust_preferred_height (StThemeNode  *node,
                                             float        *min_height_p,
                                             float        *natural_height_p);
 
+void st_theme_node_get_size_request_stats  (guint        *width_requests,
+                                            guint        *height_requests);
+
 /* Helper for allocate() ClutterActor vfunc */
 void st_theme_node_get_content_box         (StThemeNode        *node,
                                             const ClutterActorBox *allocation,
@@ -26,15 +26,35 @@
 
 G_BEGIN_DECLS
 
+typedef struct _StThemeSignature StThemeSignature;
+
 GPtrArray *_st_theme_get_matched_properties (StTheme       *theme,
                                              StThemeNode   *node);
 
+StThemeSignature *_st_theme_intern_signature (StTheme          *theme,
+                                              StThemeSignature *parent,
+                                              StThemeNode      *node,
+                                              gboolean          for_descendants);
+StThemeSignature *_st_theme_signature_ref   (StThemeSignature *signature);
+void              _st_theme_signature_unref (StThemeSignature *signature);
+
+GPtrArray *_st_theme_signature_get_matched_properties (StThemeSignature *signature,
+                                                       StThemeNode      *node);
+
 /* Resolve an URL from the stylesheet to a file */
 GFile *_st_theme_resolve_url (StTheme      *theme,
                               CRStyleSheet *base_stylesheet,
                               const char   *url);
 
 CRDeclaration *_st_theme_parse_declaration_list (const char *str);
+CRDeclaration *_st_theme_get_inline_declarations (StTheme    *theme,
+                                                  const char *str);
+
+/* Property names of all declarations StTheme hands out are interned as
+ * quarks when they are parsed; the quark is kept in the otherwise unused
+ * rfu0 slot of the declaration. */
+#define _st_declaration_get_property_quark(decl) \
+  ((GQuark) GPOINTER_TO_UINT ((decl)->rfu0))
 
 G_END_DECLS
 
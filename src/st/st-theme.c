@@ -43,7 +43,9 @@
 #include <gio/gio.h>
 
 #include "st-private.h"
+#include "st-stylesheet-cache.h"
 #include "st-theme-node.h"
+#include "st-theme-node-private.h"
 #include "st-theme-private.h"
 
 static void st_theme_constructed  (GObject      *object);
@@ -57,6 +59,15 @@ static void st_theme_get_property (GObject      *object,
                                    GValue       *value,
                                    GParamSpec   *pspec);
 
+typedef struct _StRuleIndex StRuleIndex;
+
+static void rule_index_free (StRuleIndex *index);
+
+static guint    signature_hash  (const StThemeSignature *signature);
+static gboolean signature_equal (const StThemeSignature *signature_a,
+                                 const StThemeSignature *signature_b);
+static void     invalidate_matching_caches (StTheme *theme);
+
 struct _StTheme
 {
   GObject parent;
@@ -69,9 +80,113 @@ struct _StTheme
   GHashTable *stylesheets_by_file;
   GHashTable *files_by_stylesheet;
 
+  /* CRStyleSheet => StRuleIndex, for top-level stylesheets only */
+  GHashTable *rule_indexes;
+
+  /* Set of StThemeSignature, not owned */
+  GHashTable *signatures;
+  guint signature_generation;
+
+  /* Classes and pseudo-classes used anywhere but in the rightmost simple
+   * selector of a rule; only those can change the matching of descendants */
+  GHashTable *ancestor_classes;
+  GHashTable *ancestor_pseudo_classes;
+
+  /* Parsed inline styles: char * => GList link in inline_style_lru,
+   * whose data is an StInlineStyle; most recently used first */
+  GHashTable *inline_styles;
+  GQueue inline_style_lru;
+
   CRCascade *cascade;
 };
 
+/* Maximum number of parsed inline styles kept around by a theme */
+#define INLINE_STYLE_CACHE_SIZE 256
+
+typedef struct {
+  char *style;
+  CRDeclaration *decl_list;
+} StInlineStyle;
+
+#define ORIGIN_OFFSET_IMPORTANT (NB_ORIGINS)
+#define ORIGIN_OFFSET_EXTENSION (NB_ORIGINS * 2)
+
+/* A single selector of a ruleset, compiled when the stylesheet is loaded.
+ * A ruleset with a comma separated selector list gets one entry per
+ * selector; @order is the position of the entry in the stylesheet (with
+ * @import'ed sheets flattened in place) and is used to keep the original
+ * document order among the candidates of a lookup.
+ *
+ * @origin already includes the offset for extension stylesheets; the
+ * offset for !important is added per declaration when matching.
+ */
+typedef struct {
+  CRStatement *stmt;
+  CRSimpleSel *simple_sel;
+  guint order;
+  guint specificity;
+  guint origin;
+  gboolean has_important;
+} StRule;
+
+/* Bits of the sort key of a matched declaration. From most to least
+ * significant: origin, specificity and the order in which it was
+ * matched, so that a plain integer comparison gives the cascade order.
+ */
+#define MATCH_KEY_SEQUENCE_BITS 32
+#define MATCH_KEY_SPECIFICITY_BITS 28
+#define MATCH_KEY_MAX_SPECIFICITY ((1 << MATCH_KEY_SPECIFICITY_BITS) - 1)
+
+typedef struct {
+  guint64 key;
+  CRDeclaration *decl;
+} StMatchedDeclaration;
+
+/* Everything about a node that selector matching looks at. Signatures are
+ * interned per theme, so the parent signature can be compared by pointer;
+ * they are removed from the theme again when the last node using them
+ * goes away.
+ *
+ * The parent of a signature is a descendant signature of the parent node,
+ * which leaves out the classes and pseudo-classes that no selector tests
+ * on an ancestor. Toggling e.g. :hover on a container then doesn't change
+ * the signatures of its children unless a stylesheet uses it in a
+ * descendant or child selector, and their cascade is shared rather
+ * than resolved again.
+ */
+struct _StThemeSignature {
+  int ref_count;
+
+  StTheme *theme;
+  StThemeSignature *parent;
+  guint generation;
+
+  GType element_type;
+  char *element_id;
+  GStrv element_classes;
+  GStrv pseudo_classes;
+
+  guint hash;
+
+  GPtrArray *matched_properties;
+};
+
+/* Rules of a stylesheet bucketed by the rightmost simple selector, so that
+ * matching a node only needs to look at the rules that could possibly apply
+ * to it. Each rule is in exactly one bucket: the id bucket if the rightmost
+ * simple selector has an id, otherwise the first class, otherwise the element
+ * name; anything else (universal and pseudo-class only selectors) goes into
+ * @universal_rules.
+ */
+struct _StRuleIndex {
+  GArray *rules; /* StRule */
+
+  GHashTable *id_rules;      /* char * => GArray of guint */
+  GHashTable *class_rules;   /* char * => GArray of guint */
+  GHashTable *type_rules;    /* char * => GArray of guint */
+  GArray *universal_rules;   /* guint */
+};
+
 enum
 {
   PROP_0,
@@ -113,6 +228,16 @@ st_theme_init (StTheme *theme)
   theme->stylesheets_by_file = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
                                                       (GDestroyNotify)g_object_unref, (GDestroyNotify)cr_stylesheet_unref);
   theme->files_by_stylesheet = g_hash_table_new (g_direct_hash, g_direct_equal);
+  theme->rule_indexes = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                               NULL, (GDestroyNotify) rule_index_free);
+  theme->signatures = g_hash_table_new ((GHashFunc) signature_hash,
+                                        (GEqualFunc) signature_equal);
+  theme->ancestor_classes = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                   g_free, NULL);
+  theme->ancestor_pseudo_classes = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                          g_free, NULL);
+  theme->inline_styles = g_hash_table_new (g_str_hash, g_str_equal);
+  g_queue_init (&theme->inline_style_lru);
 }
 
 static void
@@ -176,17 +301,81 @@ st_theme_class_init (StThemeClass *klass)
                   G_TYPE_NONE, 0);
 }
 
+static void
+intern_property_names (CRDeclaration *decl_list)
+{
+  CRDeclaration *cur_decl;
+
+  for (cur_decl = decl_list; cur_decl; cur_decl = cur_decl->next)
+    {
+      if (cur_decl->property && cur_decl->property->stryng)
+        cur_decl->rfu0 = GUINT_TO_POINTER (g_quark_from_string (cur_decl->property->stryng->str));
+    }
+}
+
+static void
+prepare_declarations (CRDeclaration *decl_list)
+{
+  intern_property_names (decl_list);
+  _st_theme_node_fold_color_terms (decl_list);
+}
+
+static void
+prepare_stylesheet_declarations (CRStyleSheet *stylesheet)
+{
+  CRStatement *cur_stmt;
+
+  for (cur_stmt = stylesheet->statements; cur_stmt; cur_stmt = cur_stmt->next)
+    {
+      if (cur_stmt->type == RULESET_STMT && cur_stmt->kind.ruleset)
+        prepare_declarations (cur_stmt->kind.ruleset->decl_list);
+    }
+}
+
+static GFile *
+resolve_url (GFile      *base_file,
+             const char *url)
+{
+  char *scheme;
+  GFile *resource;
+
+  if ((scheme = g_uri_parse_scheme (url)))
+    {
+      g_free (scheme);
+      resource = g_file_new_for_uri (url);
+    }
+  else if (base_file != NULL)
+    {
+      GFile *parent;
+
+      parent = g_file_get_parent (base_file);
+      resource = g_file_resolve_relative_path (parent, url);
+
+      g_object_unref (parent);
+    }
+  else
+    {
+      resource = g_file_new_for_path (url);
+    }
+
+  return resource;
+}
+
 static CRStyleSheet *
-parse_stylesheet (GFile   *file,
-                  GError **error)
+load_stylesheet (GFile   *file,
+                 GError **error)
 {
   enum CRStatus status;
   CRStyleSheet *stylesheet;
   char *contents;
   gsize length;
 
-  if (file == NULL)
-    return NULL;
+  if (_st_stylesheet_cache_is_enabled ())
+    {
+      stylesheet = _st_stylesheet_cache_load (file);
+      if (stylesheet)
+        return stylesheet;
+    }
 
   if (!g_file_load_contents (file, NULL, &contents, &length, NULL, error))
     return NULL;
@@ -206,6 +395,39 @@ parse_stylesheet (GFile   *file,
       return NULL;
     }
 
+  if (_st_stylesheet_cache_is_enabled ())
+    _st_stylesheet_cache_save (file, stylesheet);
+
+  return stylesheet;
+}
+
+static CRStyleSheet *
+parse_stylesheet (GFile   *file,
+                  GError **error)
+{
+  CRStyleSheet *stylesheet;
+  CRArena *arena, *previous_arena;
+
+  if (file == NULL)
+    return NULL;
+
+  /* Allocate the whole object model of the stylesheet from an arena
+   * that goes away with it, rather than piece by piece */
+  arena = cr_arena_new ();
+  previous_arena = cr_arena_push (arena);
+  stylesheet = load_stylesheet (file, error);
+  if (stylesheet)
+    prepare_stylesheet_declarations (stylesheet);
+  cr_arena_pop (previous_arena);
+
+  if (stylesheet == NULL)
+    {
+      cr_arena_destroy (arena);
+      return NULL;
+    }
+
+  stylesheet->arena = arena;
+
   /* Extension stylesheet */
   stylesheet->app_data = GUINT_TO_POINTER (FALSE);
 
@@ -215,24 +437,461 @@ parse_stylesheet (GFile   *file,
 CRDeclaration *
 _st_theme_parse_declaration_list (const char *str)
 {
-  return cr_declaration_parse_list_from_buf ((const guchar *)str,
-                                             CR_UTF_8);
+  CRDeclaration *decl_list;
+
+  decl_list = cr_declaration_parse_list_from_buf ((const guchar *)str,
+                                                  CR_UTF_8);
+  prepare_declarations (decl_list);
+
+  return decl_list;
+}
+
+static void
+inline_style_free (StInlineStyle *inline_style)
+{
+  if (inline_style->decl_list)
+    cr_declaration_unref (inline_style->decl_list);
+  g_free (inline_style->style);
+  g_free (inline_style);
 }
 
-/* Just g_warning for now until we have something nicer to do */
+/**
+ * _st_theme_get_inline_declarations:
+ * @theme: a #StTheme
+ * @str: an inline style, as passed to st_widget_set_style()
+ *
+ * Like _st_theme_parse_declaration_list(), but returns the list from a
+ * cache of recently parsed inline styles, since the same style strings
+ * tend to be set over and over again.
+ *
+ * Return value: (transfer full) (nullable): a reference on the head of
+ *   the declaration list, to be released with cr_declaration_unref(),
+ *   which frees the whole list with the last reference. The list is
+ *   shared and must not be modified.
+ */
+CRDeclaration *
+_st_theme_get_inline_declarations (StTheme    *theme,
+                                   const char *str)
+{
+  StInlineStyle *inline_style;
+  GList *link;
+
+  link = g_hash_table_lookup (theme->inline_styles, str);
+  if (link)
+    {
+      g_queue_unlink (&theme->inline_style_lru, link);
+      g_queue_push_head_link (&theme->inline_style_lru, link);
+      inline_style = link->data;
+    }
+  else
+    {
+      if (theme->inline_style_lru.length >= INLINE_STYLE_CACHE_SIZE)
+        {
+          StInlineStyle *oldest = g_queue_pop_tail (&theme->inline_style_lru);
+
+          g_hash_table_remove (theme->inline_styles, oldest->style);
+          inline_style_free (oldest);
+        }
+
+      inline_style = g_new0 (StInlineStyle, 1);
+      inline_style->style = g_strdup (str);
+      inline_style->decl_list = _st_theme_parse_declaration_list (str);
+      if (inline_style->decl_list)
+        cr_declaration_ref (inline_style->decl_list);
+
+      g_queue_push_head (&theme->inline_style_lru, inline_style);
+      g_hash_table_insert (theme->inline_styles, inline_style->style,
+                           theme->inline_style_lru.head);
+    }
+
+  if (inline_style->decl_list)
+    cr_declaration_ref (inline_style->decl_list);
+
+  return inline_style->decl_list;
+}
+
+static void
+register_stylesheet (StTheme      *theme,
+                     GFile        *file,
+                     CRStyleSheet *stylesheet)
+{
+  g_object_ref (file);
+  cr_stylesheet_ref (stylesheet);
+
+  g_hash_table_insert (theme->stylesheets_by_file, file, stylesheet);
+  g_hash_table_insert (theme->files_by_stylesheet, stylesheet, file);
+}
+
+/* Parses the stylesheet referenced by an @import rule the first time it
+ * is needed. Returns %NULL if the import can't be resolved.
+ */
 static CRStyleSheet *
-parse_stylesheet_nofail (GFile *file)
+ensure_import_sheet (StTheme      *theme,
+                     CRStyleSheet *base_sheet,
+                     CRStatement  *stmt)
+{
+  CRAtImportRule *import_rule = stmt->kind.import_rule;
+
+  if (import_rule->sheet == NULL)
+    {
+      GFile *file = NULL;
+
+      if (import_rule->url->stryng && import_rule->url->stryng->str)
+        {
+          file = _st_theme_resolve_url (theme,
+                                        base_sheet,
+                                        import_rule->url->stryng->str);
+          import_rule->sheet = parse_stylesheet (file, NULL);
+        }
+
+      if (import_rule->sheet)
+        {
+          register_stylesheet (theme, file, import_rule->sheet);
+          /* refcount of stylesheets starts off at zero, so we don't need to unref! */
+        }
+      else
+        {
+          /* Set a marker to avoid repeatedly trying to parse a non-existent or
+           * broken stylesheet
+           */
+          import_rule->sheet = (CRStyleSheet *) - 1;
+        }
+
+      if (file)
+        g_object_unref (file);
+    }
+
+  if (import_rule->sheet == (CRStyleSheet *) - 1)
+    return NULL;
+
+  return import_rule->sheet;
+}
+
+static void
+free_bucket (gpointer data)
+{
+  g_array_free (data, TRUE);
+}
+
+static void
+rule_index_free (StRuleIndex *index)
+{
+  g_array_free (index->rules, TRUE);
+  g_hash_table_destroy (index->id_rules);
+  g_hash_table_destroy (index->class_rules);
+  g_hash_table_destroy (index->type_rules);
+  g_array_free (index->universal_rules, TRUE);
+  g_free (index);
+}
+
+static void
+rule_index_add_to_bucket (GHashTable *buckets,
+                          const char *key,
+                          guint       rule)
+{
+  GArray *bucket = g_hash_table_lookup (buckets, key);
+
+  if (bucket == NULL)
+    {
+      bucket = g_array_new (FALSE, FALSE, sizeof (guint));
+      g_hash_table_insert (buckets, g_strdup (key), bucket);
+    }
+
+  g_array_append_val (bucket, rule);
+}
+
+static void
+rule_index_add_rule (StRuleIndex *index,
+                     CRStatement *stmt,
+                     CRSimpleSel *simple_sel)
+{
+  CRSimpleSel *last_sel;
+  CRAdditionalSel *add_sel;
+  const char *class_name = NULL;
+  CRStyleSheet *sheet = stmt->parent_sheet;
+  CRDeclaration *cur_decl;
+  StRule rule;
+  guint i;
+
+  cr_simple_sel_compute_specificity (simple_sel);
+
+  rule.stmt = stmt;
+  rule.simple_sel = simple_sel;
+  rule.order = index->rules->len;
+  rule.specificity = MIN (simple_sel->specificity, MATCH_KEY_MAX_SPECIFICITY);
+  rule.origin = sheet->origin;
+  if (GPOINTER_TO_UINT (sheet->app_data))
+    rule.origin += ORIGIN_OFFSET_EXTENSION;
+
+  rule.has_important = FALSE;
+  for (cur_decl = stmt->kind.ruleset->decl_list; cur_decl; cur_decl = cur_decl->next)
+    rule.has_important |= cur_decl->important;
+
+  g_array_append_val (index->rules, rule);
+  i = rule.order;
+
+  for (last_sel = simple_sel; last_sel->next; last_sel = last_sel->next)
+    ;
+
+  for (add_sel = last_sel->add_sel; add_sel; add_sel = add_sel->next)
+    {
+      if (add_sel->type == ID_ADD_SELECTOR &&
+          add_sel->content.id_name &&
+          add_sel->content.id_name->stryng &&
+          add_sel->content.id_name->stryng->str)
+        {
+          rule_index_add_to_bucket (index->id_rules,
+                                    add_sel->content.id_name->stryng->str, i);
+          return;
+        }
+
+      if (class_name == NULL &&
+          add_sel->type == CLASS_ADD_SELECTOR &&
+          add_sel->content.class_name &&
+          add_sel->content.class_name->stryng &&
+          add_sel->content.class_name->stryng->str)
+        class_name = add_sel->content.class_name->stryng->str;
+    }
+
+  if (class_name != NULL)
+    rule_index_add_to_bucket (index->class_rules, class_name, i);
+  else if ((last_sel->type_mask & TYPE_SELECTOR) &&
+           last_sel->name &&
+           last_sel->name->stryng &&
+           last_sel->name->stryng->str)
+    rule_index_add_to_bucket (index->type_rules, last_sel->name->stryng->str, i);
+  else
+    g_array_append_val (index->universal_rules, i);
+}
+
+static void
+rule_index_add_stylesheet (StTheme      *theme,
+                           StRuleIndex  *index,
+                           CRStyleSheet *stylesheet)
+{
+  CRStatement *cur_stmt;
+
+  for (cur_stmt = stylesheet->statements; cur_stmt; cur_stmt = cur_stmt->next)
+    {
+      switch (cur_stmt->type)
+        {
+        case RULESET_STMT:
+          if (cur_stmt->kind.ruleset && cur_stmt->kind.ruleset->sel_list)
+            {
+              CRSelector *cur_sel;
+
+              for (cur_sel = cur_stmt->kind.ruleset->sel_list; cur_sel; cur_sel = cur_sel->next)
+                {
+                  if (cur_sel->simple_sel)
+                    rule_index_add_rule (index, cur_stmt, cur_sel->simple_sel);
+                }
+            }
+          break;
+
+        case AT_IMPORT_RULE_STMT:
+          {
+            CRStyleSheet *import_sheet;
+
+            import_sheet = ensure_import_sheet (theme, stylesheet, cur_stmt);
+            if (import_sheet)
+              rule_index_add_stylesheet (theme, index, import_sheet);
+          }
+          break;
+
+        case AT_MEDIA_RULE_STMT:
+        case AT_RULE_STMT:
+        case AT_PAGE_RULE_STMT:
+        case AT_CHARSET_RULE_STMT:
+        case AT_FONT_FACE_RULE_STMT:
+        default:
+          break;
+        }
+    }
+}
+
+static StRuleIndex *
+rule_index_new (StTheme      *theme,
+                CRStyleSheet *stylesheet)
+{
+  StRuleIndex *index = g_new0 (StRuleIndex, 1);
+
+  index->rules = g_array_new (FALSE, FALSE, sizeof (StRule));
+  index->id_rules = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, free_bucket);
+  index->class_rules = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                              g_free, free_bucket);
+  index->type_rules = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             g_free, free_bucket);
+  index->universal_rules = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  rule_index_add_stylesheet (theme, index, stylesheet);
+
+  return index;
+}
+
+/* The parsing of a stylesheet along with everything it @imports,
+ * which doesn't touch the theme and can run in a worker thread.
+ */
+typedef struct {
+  GFile *file;
+  CRStyleSheet *stylesheet;
+  GError *error;
+
+  /* The sheets of the resolved @import rules, and their files */
+  GPtrArray *import_sheets;
+  GPtrArray *import_files;
+
+  /* Set when the job is part of a batch run in worker threads */
+  GMutex *mutex;
+  GCond *cond;
+  guint *n_pending;
+} StParseJob;
+
+static void
+parse_job_init (StParseJob *job,
+                GFile      *file)
+{
+  memset (job, 0, sizeof (StParseJob));
+  job->file = file;
+  job->import_sheets = g_ptr_array_new ();
+  job->import_files = g_ptr_array_new_with_free_func (g_object_unref);
+}
+
+static void
+parse_job_clear (StParseJob *job)
+{
+  g_clear_pointer (&job->import_sheets, g_ptr_array_unref);
+  g_clear_pointer (&job->import_files, g_ptr_array_unref);
+  g_clear_error (&job->error);
+}
+
+static void
+parse_job_add_imports (StParseJob   *job,
+                       GFile        *file,
+                       CRStyleSheet *stylesheet)
+{
+  CRStatement *cur_stmt;
+
+  for (cur_stmt = stylesheet->statements; cur_stmt; cur_stmt = cur_stmt->next)
+    {
+      CRAtImportRule *import_rule;
+      CRStyleSheet *import_sheet = NULL;
+      GFile *import_file = NULL;
+
+      if (cur_stmt->type != AT_IMPORT_RULE_STMT)
+        continue;
+
+      import_rule = cur_stmt->kind.import_rule;
+      if (import_rule->sheet != NULL)
+        continue;
+
+      if (import_rule->url->stryng && import_rule->url->stryng->str)
+        {
+          import_file = resolve_url (file, import_rule->url->stryng->str);
+          import_sheet = parse_stylesheet (import_file, NULL);
+        }
+
+      if (import_sheet)
+        {
+          import_rule->sheet = import_sheet;
+          g_ptr_array_add (job->import_sheets, import_sheet);
+          g_ptr_array_add (job->import_files, import_file);
+
+          parse_job_add_imports (job, import_file, import_sheet);
+        }
+      else
+        {
+          /* Same marker as in ensure_import_sheet() */
+          import_rule->sheet = (CRStyleSheet *) - 1;
+          g_clear_object (&import_file);
+        }
+    }
+}
+
+static void
+parse_job_run (StParseJob *job)
+{
+  job->stylesheet = parse_stylesheet (job->file, &job->error);
+  if (job->stylesheet)
+    parse_job_add_imports (job, job->file, job->stylesheet);
+}
+
+static void
+parse_job_thread (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+  StParseJob *job = task_data;
+
+  parse_job_run (job);
+
+  g_mutex_lock (job->mutex);
+  if (--(*job->n_pending) == 0)
+    g_cond_signal (job->cond);
+  g_mutex_unlock (job->mutex);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+/* Runs the jobs in the GTask thread pool and waits for all of them,
+ * so that the total time is the time of the slowest one.
+ */
+static void
+parse_jobs_run (StParseJob *jobs,
+                guint       n_jobs)
+{
+  GMutex mutex;
+  GCond cond;
+  guint n_pending = 0;
+  guint i;
+
+  g_mutex_init (&mutex);
+  g_cond_init (&cond);
+
+  for (i = 0; i < n_jobs; i++)
+    {
+      GTask *task;
+
+      if (jobs[i].file == NULL)
+        continue;
+
+      jobs[i].mutex = &mutex;
+      jobs[i].cond = &cond;
+      jobs[i].n_pending = &n_pending;
+
+      g_mutex_lock (&mutex);
+      n_pending++;
+      g_mutex_unlock (&mutex);
+
+      task = g_task_new (NULL, NULL, NULL, NULL);
+      g_task_set_source_tag (task, parse_jobs_run);
+      g_task_set_task_data (task, &jobs[i], NULL);
+      g_task_run_in_thread (task, parse_job_thread);
+      g_object_unref (task);
+    }
+
+  g_mutex_lock (&mutex);
+  while (n_pending > 0)
+    g_cond_wait (&cond, &mutex);
+  g_mutex_unlock (&mutex);
+
+  g_mutex_clear (&mutex);
+  g_cond_clear (&cond);
+}
+
+/* Registers the sheets of the @import rules resolved by the job, which
+ * insert_stylesheet() relies on to find their files */
+static void
+register_parse_job_imports (StTheme    *theme,
+                            StParseJob *job)
 {
-  GError *error = NULL;
-  CRStyleSheet *result;
+  guint i;
 
-  result = parse_stylesheet (file, &error);
-  if (error)
-    {
-      g_warning ("%s", error->message);
-      g_clear_error (&error);
-    }
-  return result;
+  for (i = 0; i < job->import_sheets->len; i++)
+    register_stylesheet (theme,
+                         g_ptr_array_index (job->import_files, i),
+                         g_ptr_array_index (job->import_sheets, i));
 }
 
 static void
@@ -243,11 +902,13 @@ insert_stylesheet (StTheme      *theme,
   if (stylesheet == NULL)
     return;
 
-  g_object_ref (file);
-  cr_stylesheet_ref (stylesheet);
+  register_stylesheet (theme, file, stylesheet);
 
-  g_hash_table_insert (theme->stylesheets_by_file, file, stylesheet);
-  g_hash_table_insert (theme->files_by_stylesheet, stylesheet, file);
+  /* This needs to happen after registering the stylesheet, since
+   * resolving @import rules needs to look up the file of the sheet.
+   */
+  g_hash_table_insert (theme->rule_indexes, stylesheet,
+                       rule_index_new (theme, stylesheet));
 }
 
 /**
@@ -266,16 +927,28 @@ st_theme_load_stylesheet (StTheme    *theme,
                           GError    **error)
 {
   CRStyleSheet *stylesheet;
+  StParseJob job;
+
+  parse_job_init (&job, file);
+  parse_job_run (&job);
 
-  stylesheet = parse_stylesheet (file, error);
+  stylesheet = job.stylesheet;
   if (!stylesheet)
-    return FALSE;
+    {
+      g_propagate_error (error, g_steal_pointer (&job.error));
+      parse_job_clear (&job);
+      return FALSE;
+    }
 
   stylesheet->app_data = GUINT_TO_POINTER (TRUE);
 
+  register_parse_job_imports (theme, &job);
+  parse_job_clear (&job);
+
   insert_stylesheet (theme, file, stylesheet);
   cr_stylesheet_ref (stylesheet);
   theme->custom_stylesheets = g_slist_prepend (theme->custom_stylesheets, stylesheet);
+  invalidate_matching_caches (theme);
   g_signal_emit (theme, signals[STYLESHEETS_CHANGED], 0);
 
   return TRUE;
@@ -303,6 +976,7 @@ st_theme_unload_stylesheet (StTheme    *theme,
     return;
 
   theme->custom_stylesheets = g_slist_remove (theme->custom_stylesheets, stylesheet);
+  invalidate_matching_caches (theme);
 
   g_signal_emit (theme, signals[STYLESHEETS_CHANGED], 0);
 
@@ -310,6 +984,7 @@ st_theme_unload_stylesheet (StTheme    *theme,
    * since we might still access the files_by_stylesheet hashtable in
    * _st_theme_resolve_url() during the signal emission.
    */
+  g_hash_table_remove (theme->rule_indexes, stylesheet);
   g_hash_table_remove (theme->stylesheets_by_file, file);
   g_hash_table_remove (theme->files_by_stylesheet, stylesheet);
   cr_stylesheet_unref (stylesheet);
@@ -341,6 +1016,32 @@ st_theme_get_custom_stylesheets (StTheme *theme)
   return result;
 }
 
+/**
+ * st_theme_save_cache:
+ * @theme: a #StTheme
+ *
+ * Writes all stylesheets parsed for @theme to the on-disk stylesheet
+ * cache, so that a process started next with ST_STYLESHEET_CACHE=1 can
+ * load them without parsing them again. When the cache is enabled,
+ * stylesheets were written as they were parsed already.
+ */
+void
+st_theme_save_cache (StTheme *theme)
+{
+  GHashTableIter iter;
+  GFile *file;
+  CRStyleSheet *stylesheet;
+
+  g_return_if_fail (ST_IS_THEME (theme));
+
+  if (_st_stylesheet_cache_is_enabled ())
+    return;
+
+  g_hash_table_iter_init (&iter, theme->stylesheets_by_file);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &file, (gpointer *) &stylesheet))
+    _st_stylesheet_cache_save (file, stylesheet);
+}
+
 static void
 st_theme_constructed (GObject *object)
 {
@@ -348,12 +1049,29 @@ st_theme_constructed (GObject *object)
   CRStyleSheet *application_stylesheet;
   CRStyleSheet *theme_stylesheet;
   CRStyleSheet *default_stylesheet;
+  StParseJob jobs[3];
+  guint i;
 
   G_OBJECT_CLASS (st_theme_parent_class)->constructed (object);
 
-  application_stylesheet = parse_stylesheet_nofail (theme->application_stylesheet);
-  theme_stylesheet = parse_stylesheet_nofail (theme->theme_stylesheet);
-  default_stylesheet = parse_stylesheet_nofail (theme->default_stylesheet);
+  parse_job_init (&jobs[0], theme->application_stylesheet);
+  parse_job_init (&jobs[1], theme->theme_stylesheet);
+  parse_job_init (&jobs[2], theme->default_stylesheet);
+  parse_jobs_run (jobs, G_N_ELEMENTS (jobs));
+
+  for (i = 0; i < G_N_ELEMENTS (jobs); i++)
+    {
+      /* Just g_warning for now until we have something nicer to do */
+      if (jobs[i].error)
+        g_warning ("%s", jobs[i].error->message);
+
+      register_parse_job_imports (theme, &jobs[i]);
+      parse_job_clear (&jobs[i]);
+    }
+
+  application_stylesheet = jobs[0].stylesheet;
+  theme_stylesheet = jobs[1].stylesheet;
+  default_stylesheet = jobs[2].stylesheet;
 
   theme->cascade = cr_cascade_new (application_stylesheet,
                                    theme_stylesheet,
@@ -365,6 +1083,8 @@ st_theme_constructed (GObject *object)
   insert_stylesheet (theme, theme->application_stylesheet, application_stylesheet);
   insert_stylesheet (theme, theme->theme_stylesheet, theme_stylesheet);
   insert_stylesheet (theme, theme->default_stylesheet, default_stylesheet);
+
+  invalidate_matching_caches (theme);
 }
 
 static void
@@ -376,6 +1096,15 @@ st_theme_finalize (GObject * object)
   g_slist_free (theme->custom_stylesheets);
   theme->custom_stylesheets = NULL;
 
+  /* Every node holds a reference on its theme, and nodes keep the
+   * signatures alive, so there can't be any left */
+  g_warn_if_fail (g_hash_table_size (theme->signatures) == 0);
+  g_hash_table_destroy (theme->signatures);
+  g_hash_table_destroy (theme->ancestor_classes);
+  g_hash_table_destroy (theme->ancestor_pseudo_classes);
+  g_hash_table_destroy (theme->inline_styles);
+  g_queue_clear_full (&theme->inline_style_lru, (GDestroyNotify) inline_style_free);
+  g_hash_table_destroy (theme->rule_indexes);
   g_hash_table_destroy (theme->stylesheets_by_file);
   g_hash_table_destroy (theme->files_by_stylesheet);
 
@@ -845,172 +1574,154 @@ done:
   return CR_OK;
 }
 
+static void
+append_bucket (GArray *candidates,
+               GArray *bucket)
+{
+  if (bucket != NULL)
+    g_array_append_vals (candidates, bucket->data, bucket->len);
+}
+
+static int
+compare_rule_order (gconstpointer a,
+                    gconstpointer b)
+{
+  guint order_a = *(const guint *) a;
+  guint order_b = *(const guint *) b;
+
+  return order_a < order_b ? -1 : (order_a > order_b ? 1 : 0);
+}
+
+static void
+append_type_buckets (StRuleIndex *index,
+                     GType        element_type,
+                     GArray      *candidates)
+{
+  GType type;
+
+  if (element_type == G_TYPE_NONE)
+    {
+      append_bucket (candidates, g_hash_table_lookup (index->type_rules, "stage"));
+      return;
+    }
+
+  /* Element names match any type the node's type is a subtype of,
+   * see element_name_matches_type()
+   */
+  for (type = element_type; type != G_TYPE_INVALID; type = g_type_parent (type))
+    {
+      GType *interfaces;
+      guint n_interfaces, i;
+
+      append_bucket (candidates, g_hash_table_lookup (index->type_rules,
+                                                      g_type_name (type)));
+
+      interfaces = g_type_interfaces (type, &n_interfaces);
+      for (i = 0; i < n_interfaces; i++)
+        append_bucket (candidates, g_hash_table_lookup (index->type_rules,
+                                                        g_type_name (interfaces[i])));
+      g_free (interfaces);
+    }
+}
+
+static inline void
+append_matched_declaration (GArray        *matched,
+                            const StRule  *rule,
+                            CRDeclaration *decl)
+{
+  StMatchedDeclaration match;
+  guint64 origin = rule->origin;
+
+  if (rule->has_important && decl->important)
+    origin += ORIGIN_OFFSET_IMPORTANT;
+
+  match.key = (origin << (MATCH_KEY_SPECIFICITY_BITS + MATCH_KEY_SEQUENCE_BITS)) |
+              ((guint64) rule->specificity << MATCH_KEY_SEQUENCE_BITS) |
+              matched->len;
+  match.decl = decl;
+
+  g_array_append_val (matched, match);
+}
+
 static void
 add_matched_properties (StTheme      *a_this,
                         CRStyleSheet *a_nodesheet,
                         StThemeNode  *a_node,
-                        GPtrArray    *props)
+                        GArray       *matched)
 {
-  CRStatement *cur_stmt = NULL;
-  CRSelector *sel_list = NULL;
-  CRSelector *cur_sel = NULL;
-  gboolean matches = FALSE;
-  enum CRStatus status = CR_OK;
+  StRuleIndex *index;
+  GArray *candidates;
+  const char *id;
+  GStrv classes;
+  guint i;
+  guint last_order = G_MAXUINT;
+
+  index = g_hash_table_lookup (a_this->rule_indexes, a_nodesheet);
+  if (index == NULL)
+    return;
 
   /*
-   *walk through the list of statements and,
-   *get the selectors list inside the statements that
-   *contain some, and try to match our style node in these
-   *selectors lists.
+   *collect the rules whose rightmost simple selector could match
+   *the node, and walk them in document order so that later rules
+   *get a later sequence number in their sort key.
    */
-  for (cur_stmt = a_nodesheet->statements; cur_stmt; cur_stmt = cur_stmt->next)
-    {
-      /*
-       *initialize the selector list in which we will
-       *really perform the search.
-       */
-      sel_list = NULL;
+  candidates = g_array_new (FALSE, FALSE, sizeof (guint));
 
-      /*
-       *get the the damn selector list in
-       *which we have to look
-       */
-      switch (cur_stmt->type)
-        {
-        case RULESET_STMT:
-          if (cur_stmt->kind.ruleset && cur_stmt->kind.ruleset->sel_list)
-            {
-              sel_list = cur_stmt->kind.ruleset->sel_list;
-            }
-          break;
+  g_array_append_vals (candidates,
+                       index->universal_rules->data,
+                       index->universal_rules->len);
 
-        case AT_IMPORT_RULE_STMT:
-          {
-            CRAtImportRule *import_rule = cur_stmt->kind.import_rule;
+  id = st_theme_node_get_element_id (a_node);
+  if (id != NULL)
+    append_bucket (candidates, g_hash_table_lookup (index->id_rules, id));
 
-            if (import_rule->sheet == NULL)
-              {
-                GFile *file = NULL;
+  classes = st_theme_node_get_element_classes (a_node);
+  for (i = 0; classes && classes[i]; i++)
+    append_bucket (candidates, g_hash_table_lookup (index->class_rules, classes[i]));
 
-                if (import_rule->url->stryng && import_rule->url->stryng->str)
-                  {
-                    file = _st_theme_resolve_url (a_this,
-                                                  a_nodesheet,
-                                                  import_rule->url->stryng->str);
-                    import_rule->sheet = parse_stylesheet (file, NULL);
-                  }
+  append_type_buckets (index, st_theme_node_get_element_type (a_node), candidates);
 
-                if (import_rule->sheet)
-                  {
-                    insert_stylesheet (a_this, file, import_rule->sheet);
-                    /* refcount of stylesheets starts off at zero, so we don't need to unref! */
-                  }
-                else
-                  {
-                    /* Set a marker to avoid repeatedly trying to parse a non-existent or
-                     * broken stylesheet
-                     */
-                    import_rule->sheet = (CRStyleSheet *) - 1;
-                  }
+  g_array_sort (candidates, compare_rule_order);
 
-                if (file)
-                  g_object_unref (file);
-              }
+  for (i = 0; i < candidates->len; i++)
+    {
+      guint order = g_array_index (candidates, guint, i);
+      StRule *rule;
+      gboolean matches = FALSE;
+      enum CRStatus status;
+
+      /* The same rule can be a candidate more than once if the node
+       * has duplicate classes or types */
+      if (order == last_order)
+        continue;
+      last_order = order;
 
-            if (import_rule->sheet != (CRStyleSheet *) - 1)
-              {
-                add_matched_properties (a_this, import_rule->sheet,
-                                        a_node, props);
-              }
-          }
-          break;
-        case AT_MEDIA_RULE_STMT:
-        case AT_RULE_STMT:
-        case AT_PAGE_RULE_STMT:
-        case AT_CHARSET_RULE_STMT:
-        case AT_FONT_FACE_RULE_STMT:
-        default:
-          break;
-        }
+      rule = &g_array_index (index->rules, StRule, order);
 
-      if (!sel_list)
-        continue;
+      status = sel_matches_style_real (a_this, rule->simple_sel, a_node, &matches, TRUE, TRUE);
 
-      /*
-       *now, we have a comma separated selector list to look in.
-       *let's walk it and try to match the style node
-       *on each item of the list.
-       */
-      for (cur_sel = sel_list; cur_sel; cur_sel = cur_sel->next)
+      if (status == CR_OK && matches)
         {
-          if (!cur_sel->simple_sel)
-            continue;
-
-          status = sel_matches_style_real (a_this, cur_sel->simple_sel, a_node, &matches, TRUE, TRUE);
+          CRDeclaration *cur_decl = NULL;
 
-          if (status == CR_OK && matches)
-            {
-              CRDeclaration *cur_decl = NULL;
-
-              /* In order to sort the matching properties, we need to compute the
-               * specificity of the selector that actually matched this
-               * element. In a non-thread-safe fashion, we store it in the
-               * ruleset. (Fixing this would mean cut-and-pasting
-               * cr_simple_sel_compute_specificity(), and have no need for
-               * thread-safety anyways.)
-               *
-               * Once we've sorted the properties, the specificity no longer
-               * matters and it can be safely overridden.
-               */
-              cr_simple_sel_compute_specificity (cur_sel->simple_sel);
-
-              cur_stmt->specificity = cur_sel->simple_sel->specificity;
-
-              for (cur_decl = cur_stmt->kind.ruleset->decl_list; cur_decl; cur_decl = cur_decl->next)
-                g_ptr_array_add (props, cur_decl);
-            }
+          for (cur_decl = rule->stmt->kind.ruleset->decl_list; cur_decl; cur_decl = cur_decl->next)
+            append_matched_declaration (matched, rule, cur_decl);
         }
     }
-}
-
-#define ORIGIN_OFFSET_IMPORTANT (NB_ORIGINS)
-#define ORIGIN_OFFSET_EXTENSION (NB_ORIGINS * 2)
-
-static inline int
-get_origin (const CRDeclaration * decl)
-{
-  enum CRStyleOrigin origin = decl->parent_statement->parent_sheet->origin;
-  gboolean is_extension_sheet = GPOINTER_TO_UINT (decl->parent_statement->parent_sheet->app_data);
 
-  if (decl->important)
-    origin += ORIGIN_OFFSET_IMPORTANT;
-
-  if (is_extension_sheet)
-    origin += ORIGIN_OFFSET_EXTENSION;
-
-  return origin;
+  g_array_free (candidates, TRUE);
 }
 
-/* Order of comparison is so that higher priority statements compare after
- * lower priority statements */
+/* Order of comparison is so that higher priority declarations compare
+ * after lower priority declarations */
 static int
-compare_declarations (gconstpointer a,
-                      gconstpointer b)
+compare_matched_declarations (gconstpointer a,
+                              gconstpointer b)
 {
-  /* g_ptr_array_sort() is broooken */
-  CRDeclaration *decl_a = *(CRDeclaration **) a;
-  CRDeclaration *decl_b = *(CRDeclaration **) b;
-
-  int origin_a = get_origin (decl_a);
-  int origin_b = get_origin (decl_b);
+  guint64 key_a = ((const StMatchedDeclaration *) a)->key;
+  guint64 key_b = ((const StMatchedDeclaration *) b)->key;
 
-  if (origin_a != origin_b)
-    return origin_a - origin_b;
-
-  if (decl_a->parent_statement->specificity != decl_b->parent_statement->specificity)
-    return decl_a->parent_statement->specificity - decl_b->parent_statement->specificity;
-
-  return 0;
+  return key_a < key_b ? -1 : (key_a > key_b ? 1 : 0);
 }
 
 GPtrArray *
@@ -1019,31 +1730,332 @@ _st_theme_get_matched_properties (StTheme        *theme,
 {
   enum CRStyleOrigin origin = 0;
   CRStyleSheet *sheet = NULL;
-  GPtrArray *props = g_ptr_array_new ();
+  GArray *matched;
+  GPtrArray *props;
   GSList *iter;
+  guint i;
 
   g_return_val_if_fail (ST_IS_THEME (theme), NULL);
   g_return_val_if_fail (ST_IS_THEME_NODE (node), NULL);
 
+  matched = g_array_new (FALSE, FALSE, sizeof (StMatchedDeclaration));
+
   for (origin = ORIGIN_UA; origin < NB_ORIGINS; origin++)
     {
       sheet = cr_cascade_get_sheet (theme->cascade, origin);
       if (!sheet)
         continue;
 
-      add_matched_properties (theme, sheet, node, props);
+      add_matched_properties (theme, sheet, node, matched);
     }
 
   for (iter = theme->custom_stylesheets; iter; iter = iter->next)
-    add_matched_properties (theme, iter->data, node, props);
+    add_matched_properties (theme, iter->data, node, matched);
+
+  /* Keys are unique, so this gives the same order as a stable sort
+   * by origin and specificity */
+  g_array_sort (matched, compare_matched_declarations);
 
-  /* We count on a stable sort here so that later declarations come
-   * after earlier declarations */
-  g_ptr_array_sort (props, compare_declarations);
+  props = g_ptr_array_sized_new (matched->len);
+  for (i = 0; i < matched->len; i++)
+    g_ptr_array_add (props, g_array_index (matched, StMatchedDeclaration, i).decl);
+
+  g_array_free (matched, TRUE);
 
   return props;
 }
 
+static guint
+strv_hash (GStrv strv)
+{
+  guint hash = 0;
+  char **it;
+
+  if (strv == NULL)
+    return 0;
+
+  for (it = strv; *it != NULL; it++)
+    hash = hash * 33 + g_str_hash (*it) + 1;
+
+  return hash;
+}
+
+static gboolean
+strv_equal0 (GStrv strv_a,
+             GStrv strv_b)
+{
+  if (strv_a == NULL || strv_b == NULL)
+    return strv_a == strv_b;
+
+  return g_strv_equal ((const char * const *) strv_a,
+                       (const char * const *) strv_b);
+}
+
+static guint
+signature_hash (const StThemeSignature *signature)
+{
+  return signature->hash;
+}
+
+static gboolean
+signature_equal (const StThemeSignature *signature_a,
+                 const StThemeSignature *signature_b)
+{
+  return signature_a->hash == signature_b->hash &&
+         signature_a->generation == signature_b->generation &&
+         signature_a->parent == signature_b->parent &&
+         signature_a->element_type == signature_b->element_type &&
+         g_strcmp0 (signature_a->element_id, signature_b->element_id) == 0 &&
+         strv_equal0 (signature_a->element_classes, signature_b->element_classes) &&
+         strv_equal0 (signature_a->pseudo_classes, signature_b->pseudo_classes);
+}
+
+static void
+add_name (GHashTable *names,
+          CRString   *name)
+{
+  if (name == NULL || name->stryng == NULL || name->stryng->str == NULL)
+    return;
+
+  if (!g_hash_table_contains (names, name->stryng->str))
+    g_hash_table_add (names, g_strdup (name->stryng->str));
+}
+
+static void
+add_ancestor_selector_names (StTheme     *theme,
+                             CRSimpleSel *simple_sel)
+{
+  CRSimpleSel *cur_sel;
+
+  /* Everything but the rightmost simple selector is matched against
+   * ancestors of the node */
+  for (cur_sel = simple_sel; cur_sel && cur_sel->next; cur_sel = cur_sel->next)
+    {
+      CRAdditionalSel *add_sel;
+
+      for (add_sel = cur_sel->add_sel; add_sel; add_sel = add_sel->next)
+        {
+          if (add_sel->type == CLASS_ADD_SELECTOR)
+            add_name (theme->ancestor_classes, add_sel->content.class_name);
+          else if (add_sel->type == PSEUDO_CLASS_ADD_SELECTOR && add_sel->content.pseudo)
+            add_name (theme->ancestor_pseudo_classes, add_sel->content.pseudo->name);
+        }
+    }
+}
+
+static void
+add_ancestor_selector_names_for_sheet (StTheme      *theme,
+                                       CRStyleSheet *sheet)
+{
+  StRuleIndex *index;
+  guint i;
+
+  if (sheet == NULL)
+    return;
+
+  index = g_hash_table_lookup (theme->rule_indexes, sheet);
+  if (index == NULL)
+    return;
+
+  for (i = 0; i < index->rules->len; i++)
+    add_ancestor_selector_names (theme, g_array_index (index->rules, StRule, i).simple_sel);
+}
+
+/* Called whenever the set of stylesheets changes */
+static void
+invalidate_matching_caches (StTheme *theme)
+{
+  GHashTableIter iter;
+  StThemeSignature *signature;
+  enum CRStyleOrigin origin;
+  GSList *l;
+
+  /* Nodes that already resolved their properties keep their own
+   * reference on the old array */
+  g_hash_table_iter_init (&iter, theme->signatures);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &signature, NULL))
+    g_clear_pointer (&signature->matched_properties, g_ptr_array_unref);
+
+  /* Existing signatures were filtered with the old selectors, so make
+   * sure they don't get reused */
+  theme->signature_generation++;
+
+  g_hash_table_remove_all (theme->ancestor_classes);
+  g_hash_table_remove_all (theme->ancestor_pseudo_classes);
+
+  for (origin = ORIGIN_UA; origin < NB_ORIGINS; origin++)
+    add_ancestor_selector_names_for_sheet (theme, cr_cascade_get_sheet (theme->cascade, origin));
+
+  for (l = theme->custom_stylesheets; l; l = l->next)
+    add_ancestor_selector_names_for_sheet (theme, l->data);
+}
+
+/* Returns the names of @names that are in @relevant, as a %NULL-terminated
+ * array borrowing the strings; or %NULL if there are none */
+static GStrv
+filter_names (GStrv       names,
+              GHashTable *relevant)
+{
+  GPtrArray *filtered = NULL;
+  char **it;
+
+  if (names == NULL)
+    return NULL;
+
+  for (it = names; *it != NULL; it++)
+    {
+      if (!g_hash_table_contains (relevant, *it))
+        continue;
+
+      if (filtered == NULL)
+        filtered = g_ptr_array_new ();
+      g_ptr_array_add (filtered, *it);
+    }
+
+  if (filtered == NULL)
+    return NULL;
+
+  g_ptr_array_add (filtered, NULL);
+  return (GStrv) g_ptr_array_free (filtered, FALSE);
+}
+
+/**
+ * _st_theme_intern_signature:
+ * @theme: a #StTheme
+ * @parent: (nullable): the interned descendant signature of the parent
+ *   of @node
+ * @node: a #StThemeNode styled by @theme
+ * @for_descendants: whether to intern the signature used as parent
+ *   signature for the children of @node
+ *
+ * Looks up the signature of @node, that is, the parent signature plus
+ * the element type, id, classes and pseudo-classes of @node. All nodes
+ * with the same signature match the same rules.
+ *
+ * If @for_descendants is %TRUE, only the classes and pseudo-classes
+ * that are used in ancestor position of some selector are included.
+ *
+ * Returns: (transfer full): the interned signature
+ */
+StThemeSignature *
+_st_theme_intern_signature (StTheme          *theme,
+                            StThemeSignature *parent,
+                            StThemeNode      *node,
+                            gboolean          for_descendants)
+{
+  StThemeSignature key = { 0, };
+  StThemeSignature *signature;
+  g_autofree GStrv filtered_classes = NULL;
+  g_autofree GStrv filtered_pseudo_classes = NULL;
+  guint hash;
+
+  g_return_val_if_fail (ST_IS_THEME (theme), NULL);
+  g_return_val_if_fail (parent == NULL || parent->theme == theme, NULL);
+
+  key.parent = parent;
+  key.generation = theme->signature_generation;
+  key.element_type = st_theme_node_get_element_type (node);
+  key.element_id = (char *) st_theme_node_get_element_id (node);
+
+  if (for_descendants)
+    {
+      filtered_classes = filter_names (st_theme_node_get_element_classes (node),
+                                       theme->ancestor_classes);
+      filtered_pseudo_classes = filter_names (st_theme_node_get_pseudo_classes (node),
+                                              theme->ancestor_pseudo_classes);
+      key.element_classes = filtered_classes;
+      key.pseudo_classes = filtered_pseudo_classes;
+    }
+  else
+    {
+      key.element_classes = st_theme_node_get_element_classes (node);
+      key.pseudo_classes = st_theme_node_get_pseudo_classes (node);
+    }
+
+  hash = GPOINTER_TO_UINT (parent) + key.generation;
+  hash = hash * 33 + (guint) key.element_type;
+  if (key.element_id != NULL)
+    hash = hash * 33 + g_str_hash (key.element_id);
+  hash = hash * 33 + strv_hash (key.element_classes);
+  hash = hash * 33 + strv_hash (key.pseudo_classes);
+  key.hash = hash;
+
+  signature = g_hash_table_lookup (theme->signatures, &key);
+  if (signature != NULL)
+    {
+      signature->ref_count++;
+      return signature;
+    }
+
+  signature = g_new0 (StThemeSignature, 1);
+  signature->ref_count = 1;
+  signature->theme = theme;
+  signature->parent = parent ? _st_theme_signature_ref (parent) : NULL;
+  signature->generation = key.generation;
+  signature->element_type = key.element_type;
+  signature->element_id = g_strdup (key.element_id);
+  signature->element_classes = g_strdupv (key.element_classes);
+  signature->pseudo_classes = g_strdupv (key.pseudo_classes);
+  signature->hash = hash;
+
+  g_hash_table_add (theme->signatures, signature);
+
+  return signature;
+}
+
+StThemeSignature *
+_st_theme_signature_ref (StThemeSignature *signature)
+{
+  g_return_val_if_fail (signature != NULL, NULL);
+  g_return_val_if_fail (signature->ref_count > 0, NULL);
+
+  signature->ref_count++;
+  return signature;
+}
+
+void
+_st_theme_signature_unref (StThemeSignature *signature)
+{
+  g_return_if_fail (signature != NULL);
+  g_return_if_fail (signature->ref_count > 0);
+
+  if (--signature->ref_count > 0)
+    return;
+
+  g_hash_table_remove (signature->theme->signatures, signature);
+
+  g_clear_pointer (&signature->parent, _st_theme_signature_unref);
+  g_clear_pointer (&signature->matched_properties, g_ptr_array_unref);
+  g_free (signature->element_id);
+  g_strfreev (signature->element_classes);
+  g_strfreev (signature->pseudo_classes);
+  g_free (signature);
+}
+
+/**
+ * _st_theme_signature_get_matched_properties:
+ * @signature: an interned #StThemeSignature
+ * @node: a node with @signature
+ *
+ * Gets the matched properties shared by all nodes with @signature,
+ * resolving them against @node the first time.
+ *
+ * Returns: (transfer full): an array of #CRDeclaration that must not be
+ *   modified
+ */
+GPtrArray *
+_st_theme_signature_get_matched_properties (StThemeSignature *signature,
+                                            StThemeNode      *node)
+{
+  g_return_val_if_fail (signature != NULL, NULL);
+
+  if (signature->matched_properties == NULL)
+    signature->matched_properties =
+      _st_theme_get_matched_properties (signature->theme, node);
+
+  return g_ptr_array_ref (signature->matched_properties);
+}
+
 /* Resolve an url from an url() reference in a stylesheet into a GFile,
  * if possible. The resolution here is distinctly lame and
  * will fail on many examples.
@@ -1053,33 +2065,16 @@ _st_theme_resolve_url (StTheme      *theme,
                        CRStyleSheet *base_stylesheet,
                        const char   *url)
 {
-  char *scheme;
-  GFile *resource;
+  GFile *base_file = NULL;
 
-  if ((scheme = g_uri_parse_scheme (url)))
-    {
-      g_free (scheme);
-      resource = g_file_new_for_uri (url);
-    }
-  else if (base_stylesheet != NULL)
+  if (base_stylesheet != NULL)
     {
-      GFile *base_file = NULL, *parent;
-
       base_file = g_hash_table_lookup (theme->files_by_stylesheet, base_stylesheet);
 
       /* This is an internal function, if we get here with
          a bad @base_stylesheet we have a problem. */
       g_assert (base_file);
-
-      parent = g_file_get_parent (base_file);
-      resource = g_file_resolve_relative_path (parent, url);
-
-      g_object_unref (parent);
-    }
-  else
-    {
-      resource = g_file_new_for_path (url);
     }
 
-  return resource;
+  return resolve_url (base_file, url);
 }
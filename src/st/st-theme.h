@@ -46,6 +46,8 @@ gboolean  st_theme_load_stylesheet        (StTheme *theme, GFile *file, GError *
 void      st_theme_unload_stylesheet      (StTheme *theme, GFile *file);
 GSList   *st_theme_get_custom_stylesheets (StTheme *theme);
 
+void      st_theme_save_cache             (StTheme *theme);
+
 G_END_DECLS
 
 #endif /* __ST_THEME_H__ */
@@ -57,6 +57,7 @@ enum {
   PROP_0,
 
   PROP_CLIP_TO_VIEW,
+  PROP_CACHE_CHILDREN,
 
   N_PROPS,
 
@@ -72,8 +73,12 @@ typedef struct
   StAdjustment *hadjustment;
   StAdjustment *vadjustment;
   gboolean clip_to_view;
+  gboolean cache_children;
 } StViewportPrivate;
 
+/* The offscreen redirect a child had before we cached it, plus one */
+static GQuark quark_cached_redirect;
+
 G_DEFINE_TYPE_WITH_CODE (StViewport, st_viewport, ST_TYPE_WIDGET,
                          G_ADD_PRIVATE (StViewport)
                          G_IMPLEMENT_INTERFACE (ST_TYPE_SCROLLABLE,
@@ -188,6 +193,79 @@ st_viewport_set_clip_to_view (StViewport *viewport,
     }
 }
 
+static void
+cache_child (ClutterActor *child)
+{
+  ClutterOffscreenRedirect redirect;
+
+  if (g_object_get_qdata (G_OBJECT (child), quark_cached_redirect))
+    return;
+
+  redirect = clutter_actor_get_offscreen_redirect (child);
+  g_object_set_qdata (G_OBJECT (child), quark_cached_redirect,
+                      GUINT_TO_POINTER (redirect + 1));
+
+  clutter_actor_set_offscreen_redirect (child,
+                                        CLUTTER_OFFSCREEN_REDIRECT_ALWAYS);
+}
+
+static void
+uncache_child (ClutterActor *child)
+{
+  guint redirect;
+
+  redirect = GPOINTER_TO_UINT (g_object_steal_qdata (G_OBJECT (child),
+                                                     quark_cached_redirect));
+  if (redirect == 0)
+    return;
+
+  clutter_actor_set_offscreen_redirect (child, redirect - 1);
+}
+
+static void
+on_child_added (ClutterActor *actor,
+                ClutterActor *child)
+{
+  StViewportPrivate *priv =
+    st_viewport_get_instance_private (ST_VIEWPORT (actor));
+
+  if (priv->cache_children)
+    cache_child (child);
+}
+
+static void
+on_child_removed (ClutterActor *actor,
+                  ClutterActor *child)
+{
+  uncache_child (child);
+}
+
+static void
+st_viewport_set_cache_children (StViewport *viewport,
+                                gboolean    cache_children)
+{
+  StViewportPrivate *priv =
+    st_viewport_get_instance_private (viewport);
+  ClutterActor *child;
+
+  if (!!priv->cache_children == !!cache_children)
+    return;
+
+  priv->cache_children = cache_children;
+
+  for (child = clutter_actor_get_first_child (CLUTTER_ACTOR (viewport));
+       child != NULL;
+       child = clutter_actor_get_next_sibling (child))
+    {
+      if (cache_children)
+        cache_child (child);
+      else
+        uncache_child (child);
+    }
+
+  g_object_notify_by_pspec (G_OBJECT (viewport), props[PROP_CACHE_CHILDREN]);
+}
+
 static void
 st_viewport_get_property (GObject    *object,
                           guint       property_id,
@@ -214,6 +292,10 @@ st_viewport_get_property (GObject    *object,
       g_value_set_boolean (value, priv->clip_to_view);
       break;
 
+    case PROP_CACHE_CHILDREN:
+      g_value_set_boolean (value, priv->cache_children);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     }
@@ -247,6 +329,10 @@ st_viewport_set_property (GObject      *object,
       st_viewport_set_clip_to_view (viewport, g_value_get_boolean (value));
       break;
 
+    case PROP_CACHE_CHILDREN:
+      st_viewport_set_cache_children (viewport, g_value_get_boolean (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     }
@@ -591,6 +677,22 @@ st_viewport_class_init (StViewportClass *klass)
                           TRUE,
                           ST_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
 
+  /**
+   * StViewport:cache-children:
+   *
+   * Whether to paint each child into an offscreen buffer that is kept
+   * until the child changes. Scrolling then only paints one textured
+   * rectangle per child, which is a good trade for content that rarely
+   * changes while it is scrolled, like the items of a long menu. Children
+   * that animate or are very large should not be cached.
+   */
+  props[PROP_CACHE_CHILDREN] =
+    g_param_spec_boolean ("cache-children",
+                          "Cache children",
+                          "Cache the content of children while scrolling",
+                          FALSE,
+                          ST_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY);
+
   /* StScrollable properties */
   g_object_class_override_property (object_class,
                                     PROP_HADJUST,
@@ -601,6 +703,8 @@ st_viewport_class_init (StViewportClass *klass)
                                     "vadjustment");
 
   g_object_class_install_properties (object_class, N_PROPS, props);
+
+  quark_cached_redirect = g_quark_from_static_string ("st-viewport-cached-redirect");
 }
 
 static void
@@ -610,4 +714,7 @@ st_viewport_init (StViewport *self)
     st_viewport_get_instance_private (self);
 
   priv->clip_to_view = TRUE;
+
+  g_signal_connect (self, "child-added", G_CALLBACK (on_child_added), NULL);
+  g_signal_connect (self, "child-removed", G_CALLBACK (on_child_removed), NULL);
 }
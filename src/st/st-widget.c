@@ -30,6 +30,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
 
 #include <clutter/clutter.h>
 
@@ -54,10 +55,17 @@
 /*
  * Forward declaration for sake of StWidgetChild
  */
+typedef struct _StWidgetProfile        StWidgetProfile;
+
+/* Widgets with costs recorded, see st_widget_set_profiling_enabled() */
+static GHashTable *profiled_widgets = NULL;
+
 typedef struct _StWidgetPrivate        StWidgetPrivate;
 struct _StWidgetPrivate
 {
   StThemeNode  *theme_node;
+  /* What was painted before the style became dirty, for transitions */
+  StThemeNode  *old_theme_node;
   gchar        *pseudo_class;
   gchar        *style_class;
   gchar        *inline_style;
@@ -65,6 +73,7 @@ struct _StWidgetPrivate
   StThemeNodeTransition *transition_animation;
 
   guint is_style_dirty : 1;
+  guint style_update_queued : 1;
   guint first_child_dirty : 1;
   guint last_child_dirty : 1;
   guint draw_bg_color : 1;
@@ -88,6 +97,8 @@ struct _StWidgetPrivate
 
   StThemeNodePaintState paint_states[2];
   int current_paint_state : 2;
+
+  StWidgetProfile *profile;
 };
 
 /**
@@ -133,6 +144,9 @@ static guint signals[LAST_SIGNAL] = { 0, };
 G_DEFINE_TYPE_WITH_PRIVATE (StWidget, st_widget, CLUTTER_TYPE_ACTOR);
 #define ST_WIDGET_PRIVATE(w) ((StWidgetPrivate *)st_widget_get_instance_private (w))
 
+/* Mapped widgets whose style changed since the last stage update */
+static GPtrArray *pending_style_updates = NULL;
+
 static void st_widget_recompute_style (StWidget    *widget,
                                        StThemeNode *old_theme_node);
 static gboolean st_widget_real_navigate_focus (StWidget         *widget,
@@ -141,6 +155,8 @@ static gboolean st_widget_real_navigate_focus (StWidget         *widget,
 
 static AtkObject * st_widget_get_accessible (ClutterActor *actor);
 static gboolean    st_widget_has_accessible (ClutterActor *actor);
+static void        st_widget_sync_accessible (StWidget *widget,
+                                              guint     prop_id);
 
 static void
 st_widget_update_insensitive (StWidget *widget)
@@ -320,6 +336,13 @@ st_widget_dispose (GObject *gobject)
   StWidgetPrivate *priv = st_widget_get_instance_private (actor);
 
   g_clear_pointer (&priv->theme_node, g_object_unref);
+  g_clear_pointer (&priv->old_theme_node, g_object_unref);
+
+  if (priv->style_update_queued)
+    {
+      g_ptr_array_remove_fast (pending_style_updates, actor);
+      priv->style_update_queued = FALSE;
+    }
 
   st_widget_remove_transition (actor);
 
@@ -331,6 +354,9 @@ st_widget_dispose (GObject *gobject)
   g_clear_object (&priv->first_visible_child);
   g_clear_object (&priv->last_visible_child);
 
+  if (profiled_widgets)
+    g_hash_table_remove (profiled_widgets, actor);
+
   G_OBJECT_CLASS (st_widget_parent_class)->dispose (gobject);
 
   g_clear_handle_id (&priv->update_child_styles_id, g_source_remove);
@@ -351,9 +377,466 @@ st_widget_finalize (GObject *gobject)
   for (i = 0; i < G_N_ELEMENTS (priv->paint_states); i++)
     st_theme_node_paint_state_free (&priv->paint_states[i]);
 
+  g_free (priv->profile);
+
   G_OBJECT_CLASS (st_widget_parent_class)->finalize (gobject);
 }
 
+/* Profiling
+ *
+ * Once profiling is enabled, the layout and paint vfuncs of all StWidget
+ * classes are replaced with wrappers recording the time spent in them for
+ * each widget. Time spent in other widgets, like children allocated by a
+ * container, is subtracted, so the recorded costs are those of the widget
+ * itself.
+ *
+ * When an implementation chains up, the wrapper is called again for the
+ * same widget, so for each widget and vfunc we keep track of the class
+ * being dispatched to, and continue with the closest parent class that
+ * has a different implementation. The wrappers stay installed when
+ * profiling is disabled again, but stop recording.
+ */
+
+typedef enum {
+  VFUNC_GET_PREFERRED_WIDTH,
+  VFUNC_GET_PREFERRED_HEIGHT,
+  VFUNC_ALLOCATE,
+  VFUNC_PAINT_NODE,
+
+  N_VFUNCS
+} StWidgetVfunc;
+
+typedef enum {
+  COST_PREFERRED_SIZE,
+  COST_ALLOCATE,
+  COST_PAINT_NODE,
+  COST_THEME_NODE_PAINT,
+
+  N_COSTS
+} StWidgetCost;
+
+struct _StWidgetProfile
+{
+  gint64 costs[N_COSTS];
+  GType dispatch_types[N_VFUNCS];
+};
+
+typedef struct
+{
+  gpointer vfuncs[N_VFUNCS];
+} StWidgetClassProfile;
+
+typedef struct _ProfileFrame ProfileFrame;
+struct _ProfileFrame
+{
+  ProfileFrame *parent;
+  StWidgetProfile *profile;
+  StWidgetCost cost;
+  gint64 start;
+  gint64 children;
+};
+
+typedef struct
+{
+  StWidgetProfile *profile;
+  StWidgetVfunc vfunc;
+  GType saved_type;
+  ProfileFrame frame;
+} ProfileDispatch;
+
+static gboolean profiling_enabled = FALSE;
+static ProfileFrame *current_frame = NULL;
+
+static gpointer profile_wrappers[N_VFUNCS];
+
+static GQuark
+get_class_profile_quark (void)
+{
+  static GQuark quark = 0;
+
+  if (G_UNLIKELY (quark == 0))
+    quark = g_quark_from_static_string ("st-widget-class-profile");
+
+  return quark;
+}
+
+static gint64
+profile_get_time (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * G_GINT64_CONSTANT (1000000000) + ts.tv_nsec;
+}
+
+static StWidgetProfile *
+ensure_profile (StWidget *widget)
+{
+  StWidgetPrivate *priv = st_widget_get_instance_private (widget);
+
+  if (!priv->profile)
+    priv->profile = g_new0 (StWidgetProfile, 1);
+
+  return priv->profile;
+}
+
+static void
+profile_frame_begin (ProfileFrame *frame,
+                     StWidget     *widget,
+                     StWidgetCost  cost)
+{
+  frame->profile = NULL;
+
+  if (!profiling_enabled)
+    return;
+
+  frame->profile = ensure_profile (widget);
+  frame->cost = cost;
+  frame->children = 0;
+  frame->parent = current_frame;
+  current_frame = frame;
+
+  g_hash_table_add (profiled_widgets, widget);
+
+  frame->start = profile_get_time ();
+}
+
+static void
+profile_frame_end (ProfileFrame *frame)
+{
+  gint64 elapsed;
+
+  if (!frame->profile)
+    return;
+
+  elapsed = profile_get_time () - frame->start;
+
+  frame->profile->costs[frame->cost] += elapsed - frame->children;
+  if (frame->parent)
+    frame->parent->children += elapsed;
+
+  current_frame = frame->parent;
+}
+
+static gpointer *
+get_vfunc_slot (ClutterActorClass *klass,
+                StWidgetVfunc      vfunc)
+{
+  switch (vfunc)
+    {
+    case VFUNC_GET_PREFERRED_WIDTH:
+      return (gpointer *) &klass->get_preferred_width;
+    case VFUNC_GET_PREFERRED_HEIGHT:
+      return (gpointer *) &klass->get_preferred_height;
+    case VFUNC_ALLOCATE:
+      return (gpointer *) &klass->allocate;
+    case VFUNC_PAINT_NODE:
+      return (gpointer *) &klass->paint_node;
+    case N_VFUNCS:
+      break;
+    }
+
+  g_assert_not_reached ();
+}
+
+/* Classes created after profiling was enabled, but not used for a mapped
+ * widget yet, inherit the wrappers; use the closest profiled class then.
+ */
+static StWidgetClassProfile *
+get_class_profile (GType type)
+{
+  StWidgetClassProfile *class_profile;
+
+  while (!(class_profile = g_type_get_qdata (type, get_class_profile_quark ())))
+    type = g_type_parent (type);
+
+  return class_profile;
+}
+
+static void
+profile_class (GType type)
+{
+  ClutterActorClass *klass;
+  StWidgetClassProfile *class_profile;
+  int i;
+
+  if (g_type_get_qdata (type, get_class_profile_quark ()))
+    return;
+
+  klass = g_type_class_peek (type);
+  if (!klass)
+    return;
+
+  if (type != ST_TYPE_WIDGET)
+    profile_class (g_type_parent (type));
+
+  class_profile = g_new0 (StWidgetClassProfile, 1);
+
+  for (i = 0; i < N_VFUNCS; i++)
+    {
+      gpointer *slot = get_vfunc_slot (klass, i);
+
+      if (*slot == profile_wrappers[i])
+        class_profile->vfuncs[i] = get_class_profile (g_type_parent (type))->vfuncs[i];
+      else
+        class_profile->vfuncs[i] = *slot;
+
+      *slot = profile_wrappers[i];
+    }
+
+  g_type_set_qdata (type, get_class_profile_quark (), class_profile);
+}
+
+static void
+profile_class_tree (GType type)
+{
+  GType *children;
+  guint n_children, i;
+
+  if (!g_type_class_peek (type))
+    return;
+
+  profile_class (type);
+
+  children = g_type_children (type, &n_children);
+  for (i = 0; i < n_children; i++)
+    profile_class_tree (children[i]);
+  g_free (children);
+}
+
+static gpointer
+profile_dispatch_begin (ProfileDispatch *dispatch,
+                        StWidget        *widget,
+                        StWidgetVfunc    vfunc,
+                        StWidgetCost     cost)
+{
+  StWidgetProfile *profile = ensure_profile (widget);
+  GType type;
+
+  dispatch->profile = profile;
+  dispatch->vfunc = vfunc;
+  dispatch->saved_type = profile->dispatch_types[vfunc];
+
+  if (dispatch->saved_type == G_TYPE_INVALID)
+    {
+      type = G_OBJECT_TYPE (widget);
+      profile_frame_begin (&dispatch->frame, widget, cost);
+    }
+  else
+    {
+      /* A chain-up; part of the same frame */
+      gpointer func = get_class_profile (dispatch->saved_type)->vfuncs[vfunc];
+
+      type = g_type_parent (dispatch->saved_type);
+      while (type != CLUTTER_TYPE_ACTOR &&
+             get_class_profile (type)->vfuncs[vfunc] == func)
+        type = g_type_parent (type);
+
+      dispatch->frame.profile = NULL;
+    }
+
+  profile->dispatch_types[vfunc] = type;
+
+  if (type == CLUTTER_TYPE_ACTOR)
+    return *get_vfunc_slot (g_type_class_peek (CLUTTER_TYPE_ACTOR), vfunc);
+  else
+    return get_class_profile (type)->vfuncs[vfunc];
+}
+
+static void
+profile_dispatch_end (ProfileDispatch *dispatch)
+{
+  profile_frame_end (&dispatch->frame);
+  dispatch->profile->dispatch_types[dispatch->vfunc] = dispatch->saved_type;
+}
+
+static void
+profiled_get_preferred_width (ClutterActor *actor,
+                              float         for_height,
+                              float        *min_width_p,
+                              float        *natural_width_p)
+{
+  void (* get_preferred_width) (ClutterActor *, float, float *, float *);
+  ProfileDispatch dispatch;
+
+  get_preferred_width = profile_dispatch_begin (&dispatch, ST_WIDGET (actor),
+                                                VFUNC_GET_PREFERRED_WIDTH,
+                                                COST_PREFERRED_SIZE);
+  get_preferred_width (actor, for_height, min_width_p, natural_width_p);
+  profile_dispatch_end (&dispatch);
+}
+
+static void
+profiled_get_preferred_height (ClutterActor *actor,
+                               float         for_width,
+                               float        *min_height_p,
+                               float        *natural_height_p)
+{
+  void (* get_preferred_height) (ClutterActor *, float, float *, float *);
+  ProfileDispatch dispatch;
+
+  get_preferred_height = profile_dispatch_begin (&dispatch, ST_WIDGET (actor),
+                                                 VFUNC_GET_PREFERRED_HEIGHT,
+                                                 COST_PREFERRED_SIZE);
+  get_preferred_height (actor, for_width, min_height_p, natural_height_p);
+  profile_dispatch_end (&dispatch);
+}
+
+static void
+profiled_allocate (ClutterActor          *actor,
+                   const ClutterActorBox *box)
+{
+  void (* allocate) (ClutterActor *, const ClutterActorBox *);
+  ProfileDispatch dispatch;
+
+  allocate = profile_dispatch_begin (&dispatch, ST_WIDGET (actor),
+                                     VFUNC_ALLOCATE,
+                                     COST_ALLOCATE);
+  allocate (actor, box);
+  profile_dispatch_end (&dispatch);
+}
+
+static void
+profiled_paint_node (ClutterActor     *actor,
+                     ClutterPaintNode *root)
+{
+  void (* paint_node) (ClutterActor *, ClutterPaintNode *);
+  ProfileDispatch dispatch;
+
+  paint_node = profile_dispatch_begin (&dispatch, ST_WIDGET (actor),
+                                       VFUNC_PAINT_NODE,
+                                       COST_PAINT_NODE);
+  paint_node (actor, root);
+  profile_dispatch_end (&dispatch);
+}
+
+static gpointer profile_wrappers[N_VFUNCS] = {
+  [VFUNC_GET_PREFERRED_WIDTH] = (gpointer) profiled_get_preferred_width,
+  [VFUNC_GET_PREFERRED_HEIGHT] = (gpointer) profiled_get_preferred_height,
+  [VFUNC_ALLOCATE] = (gpointer) profiled_allocate,
+  [VFUNC_PAINT_NODE] = (gpointer) profiled_paint_node,
+};
+
+/**
+ * st_widget_set_profiling_enabled:
+ * @enabled: whether to record the costs of widgets
+ *
+ * Enables or disables recording the time spent computing the preferred
+ * size, allocating and painting each widget, as well as painting the
+ * widget's theme node. The costs are accumulated until
+ * st_widget_reset_profile() is called.
+ */
+void
+st_widget_set_profiling_enabled (gboolean enabled)
+{
+  if (profiling_enabled == enabled)
+    return;
+
+  profiling_enabled = enabled;
+
+  if (!enabled)
+    return;
+
+  if (!profiled_widgets)
+    profiled_widgets = g_hash_table_new (NULL, NULL);
+
+  profile_class_tree (ST_TYPE_WIDGET);
+}
+
+/**
+ * st_widget_get_profiling_enabled:
+ *
+ * Returns: whether the costs of widgets are being recorded
+ */
+gboolean
+st_widget_get_profiling_enabled (void)
+{
+  return profiling_enabled;
+}
+
+/**
+ * st_widget_reset_profile:
+ *
+ * Clears the costs recorded for all widgets.
+ */
+void
+st_widget_reset_profile (void)
+{
+  GHashTableIter iter;
+  StWidget *widget;
+
+  if (!profiled_widgets)
+    return;
+
+  g_hash_table_iter_init (&iter, profiled_widgets);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &widget, NULL))
+    {
+      StWidgetPrivate *priv = st_widget_get_instance_private (widget);
+
+      memset (priv->profile->costs, 0, sizeof (priv->profile->costs));
+    }
+
+  g_hash_table_remove_all (profiled_widgets);
+}
+
+/**
+ * st_widget_get_profiled_widgets:
+ *
+ * Gets the widgets with costs recorded since profiling was enabled, or
+ * st_widget_reset_profile() was last called.
+ *
+ * Returns: (transfer container) (element-type StWidget): the profiled widgets
+ */
+GList *
+st_widget_get_profiled_widgets (void)
+{
+  if (!profiled_widgets)
+    return NULL;
+
+  return g_hash_table_get_keys (profiled_widgets);
+}
+
+/**
+ * st_widget_get_profile:
+ * @widget: a #StWidget
+ * @preferred_size_time: (out) (optional): time spent computing the
+ *   preferred width and height, in microseconds
+ * @allocate_time: (out) (optional): time spent allocating, in microseconds
+ * @paint_node_time: (out) (optional): time spent painting, in microseconds
+ * @theme_node_paint_time: (out) (optional): time spent painting the
+ *   theme node, in microseconds
+ *
+ * Gets the recorded costs of @widget, not including the costs of other
+ * widgets, such as its children. The time spent painting the theme node
+ * is not part of @paint_node_time.
+ */
+void
+st_widget_get_profile (StWidget *widget,
+                       double   *preferred_size_time,
+                       double   *allocate_time,
+                       double   *paint_node_time,
+                       double   *theme_node_paint_time)
+{
+  StWidgetPrivate *priv;
+  gint64 costs[N_COSTS] = { 0, };
+
+  g_return_if_fail (ST_IS_WIDGET (widget));
+
+  priv = st_widget_get_instance_private (widget);
+  if (priv->profile)
+    memcpy (costs, priv->profile->costs, sizeof (costs));
+
+  if (preferred_size_time)
+    *preferred_size_time = costs[COST_PREFERRED_SIZE] / 1000.;
+  if (allocate_time)
+    *allocate_time = costs[COST_ALLOCATE] / 1000.;
+  if (paint_node_time)
+    *paint_node_time = costs[COST_PAINT_NODE] / 1000.;
+  if (theme_node_paint_time)
+    *theme_node_paint_time = costs[COST_THEME_NODE_PAINT] / 1000.;
+}
+
 
 static void
 st_widget_get_preferred_width (ClutterActor *self,
@@ -424,6 +907,7 @@ st_widget_paint_background (StWidget         *widget,
   StWidgetPrivate *priv = st_widget_get_instance_private (widget);
   StThemeNode *theme_node;
   ClutterActorBox allocation;
+  ProfileFrame frame;
   float resource_scale;
   guint8 opacity;
 
@@ -435,6 +919,8 @@ st_widget_paint_background (StWidget         *widget,
 
   opacity = clutter_actor_get_paint_opacity (CLUTTER_ACTOR (widget));
 
+  profile_frame_begin (&frame, widget, COST_THEME_NODE_PAINT);
+
   if (priv->transition_animation)
     st_theme_node_transition_paint (priv->transition_animation,
                                     node,
@@ -448,6 +934,8 @@ st_widget_paint_background (StWidget         *widget,
                          &allocation,
                          opacity,
                          resource_scale);
+
+  profile_frame_end (&frame);
 }
 
 static void
@@ -479,6 +967,10 @@ st_widget_map (ClutterActor *actor)
   CLUTTER_ACTOR_CLASS (st_widget_parent_class)->map (actor);
 
   st_widget_ensure_style (self);
+
+  /* Classes created after profiling was enabled */
+  if (profiling_enabled)
+    profile_class (G_OBJECT_TYPE (actor));
 }
 
 static void
@@ -489,6 +981,9 @@ st_widget_unmap (ClutterActor *actor)
 
   CLUTTER_ACTOR_CLASS (st_widget_parent_class)->unmap (actor);
 
+  /* Don't transition from whatever was shown before when mapped again */
+  g_clear_pointer (&priv->old_theme_node, g_object_unref);
+
   st_widget_remove_transition (self);
 
   if (priv->track_hover && priv->hover)
@@ -511,36 +1006,164 @@ notify_children_of_style_change (ClutterActor *self)
     }
 }
 
-static void
-st_widget_real_style_changed (StWidget *self)
-{
-  clutter_actor_queue_redraw ((ClutterActor *) self);
-}
+static void mark_children_style_dirty (ClutterActor *self);
 
-void
-st_widget_style_changed (StWidget *widget)
+static void
+mark_style_dirty (StWidget *widget)
 {
   StWidgetPrivate *priv = st_widget_get_instance_private (widget);
-  StThemeNode *old_theme_node = NULL;
 
   priv->is_style_dirty = TRUE;
+
   if (priv->theme_node)
     {
-      old_theme_node = priv->theme_node;
+      /* Keep the node that was last painted, not the ones that may have
+       * been looked up in between */
+      if (priv->old_theme_node == NULL &&
+          clutter_actor_is_mapped (CLUTTER_ACTOR (widget)))
+        priv->old_theme_node = priv->theme_node;
+      else
+        g_object_unref (priv->theme_node);
+
       priv->theme_node = NULL;
     }
 
-  /* update the style only if we are mapped */
-  if (clutter_actor_is_mapped (CLUTTER_ACTOR (widget)))
-    st_widget_recompute_style (widget, old_theme_node);
+  mark_children_style_dirty (CLUTTER_ACTOR (widget));
+}
 
-  /* Descend through all children. If the actor is not mapped,
-   * children will clear their theme node without recomputing style.
-   */
-  notify_children_of_style_change (CLUTTER_ACTOR (widget));
+static void
+mark_children_style_dirty (ClutterActor *self)
+{
+  ClutterActorIter iter;
+  ClutterActor *actor;
 
-  if (old_theme_node)
-    g_object_unref (old_theme_node);
+  clutter_actor_iter_init (&iter, self);
+  while (clutter_actor_iter_next (&iter, &actor))
+    {
+      if (ST_IS_WIDGET (actor))
+        mark_style_dirty (ST_WIDGET (actor));
+      else
+        mark_children_style_dirty (actor);
+    }
+}
+
+static void ensure_children_style (ClutterActor *self);
+
+static void
+ensure_style (StWidget *widget)
+{
+  StWidgetPrivate *priv = st_widget_get_instance_private (widget);
+  g_autoptr (StThemeNode) old_theme_node = NULL;
+
+  if (!priv->is_style_dirty)
+    return;
+
+  old_theme_node = g_steal_pointer (&priv->old_theme_node);
+  st_widget_recompute_style (widget, old_theme_node);
+
+  ensure_children_style (CLUTTER_ACTOR (widget));
+}
+
+static void
+ensure_children_style (ClutterActor *self)
+{
+  ClutterActorIter iter;
+  ClutterActor *actor;
+
+  clutter_actor_iter_init (&iter, self);
+  while (clutter_actor_iter_next (&iter, &actor))
+    {
+      if (ST_IS_WIDGET (actor))
+        ensure_style (ST_WIDGET (actor));
+      else
+        ensure_children_style (actor);
+    }
+}
+
+static void
+flush_style_updates (ClutterStage *stage)
+{
+  g_autoptr (GPtrArray) widgets = NULL;
+  guint i;
+
+  if (pending_style_updates == NULL || pending_style_updates->len == 0)
+    return;
+
+  widgets = g_steal_pointer (&pending_style_updates);
+
+  for (i = 0; i < widgets->len; i++)
+    {
+      StWidget *widget = g_ptr_array_index (widgets, i);
+
+      ST_WIDGET_PRIVATE (widget)->style_update_queued = FALSE;
+    }
+
+  /* Restyling an ancestor already took care of its descendants, so
+   * this only does the work once per widget. Unmapped widgets wait
+   * until they are mapped. */
+  for (i = 0; i < widgets->len; i++)
+    {
+      StWidget *widget = g_ptr_array_index (widgets, i);
+
+      if (clutter_actor_is_mapped (CLUTTER_ACTOR (widget)))
+        ensure_style (widget);
+    }
+}
+
+static void
+queue_style_update (StWidget *widget)
+{
+  StWidgetPrivate *priv = st_widget_get_instance_private (widget);
+  ClutterActor *stage;
+
+  if (priv->style_update_queued)
+    return;
+
+  stage = clutter_actor_get_stage (CLUTTER_ACTOR (widget));
+  if (stage == NULL)
+    return;
+
+  if (!g_object_get_data (G_OBJECT (stage), "st-style-updates-connected"))
+    {
+      g_object_set_data (G_OBJECT (stage), "st-style-updates-connected",
+                         GUINT_TO_POINTER (1));
+      g_signal_connect (stage, "before-update",
+                        G_CALLBACK (flush_style_updates), NULL);
+    }
+
+  if (pending_style_updates == NULL)
+    pending_style_updates = g_ptr_array_new ();
+
+  g_ptr_array_add (pending_style_updates, widget);
+  priv->style_update_queued = TRUE;
+
+  clutter_stage_schedule_update (CLUTTER_STAGE (stage));
+}
+
+static void
+st_widget_real_style_changed (StWidget *self)
+{
+  clutter_actor_queue_redraw ((ClutterActor *) self);
+}
+
+/**
+ * st_widget_style_changed:
+ * @widget: A #StWidget
+ *
+ * Marks the style of @widget and its descendants as changed. Several
+ * changes within a frame only restyle the subtree once: if @widget is
+ * mapped, the style is recomputed just before the stage is laid out
+ * next, or by st_widget_ensure_style() if that is called first. The
+ * style of widgets that aren't mapped is recomputed when they get
+ * mapped.
+ */
+void
+st_widget_style_changed (StWidget *widget)
+{
+  mark_style_dirty (widget);
+
+  if (clutter_actor_is_mapped (CLUTTER_ACTOR (widget)))
+    queue_style_update (widget);
 }
 
 static void
@@ -550,6 +1173,40 @@ on_theme_context_changed (StThemeContext *context,
   notify_children_of_style_change (CLUTTER_ACTOR (stage));
 }
 
+static void
+notify_accent_color_users (ClutterActor *self)
+{
+  ClutterActorIter iter;
+  ClutterActor *actor;
+
+  clutter_actor_iter_init (&iter, self);
+  while (clutter_actor_iter_next (&iter, &actor))
+    {
+      if (ST_IS_WIDGET (actor))
+        {
+          StWidgetPrivate *priv =
+            st_widget_get_instance_private (ST_WIDGET (actor));
+
+          /* Their descendants use them too, so they are restyled along */
+          if (priv->theme_node &&
+              _st_theme_node_uses_accent_color (priv->theme_node))
+            {
+              st_widget_style_changed (ST_WIDGET (actor));
+              continue;
+            }
+        }
+
+      notify_accent_color_users (actor);
+    }
+}
+
+static void
+on_theme_context_accent_changed (StThemeContext *context,
+                                 ClutterStage   *stage)
+{
+  notify_accent_color_users (CLUTTER_ACTOR (stage));
+}
+
 static StThemeNode *
 get_root_theme_node (ClutterStage *stage)
 {
@@ -560,6 +1217,8 @@ get_root_theme_node (ClutterStage *stage)
       g_object_set_data (G_OBJECT (context), "st-theme-initialized", GUINT_TO_POINTER (1));
       g_signal_connect (G_OBJECT (context), "changed",
                         G_CALLBACK (on_theme_context_changed), stage);
+      g_signal_connect (G_OBJECT (context), "accent-changed",
+                        G_CALLBACK (on_theme_context_accent_changed), stage);
     }
 
   return st_theme_context_get_root_node (context);
@@ -1344,6 +2003,7 @@ st_widget_set_style_pseudo_class (StWidget    *actor,
     {
       st_widget_style_changed (actor);
       g_object_notify_by_pspec (G_OBJECT (actor), props[PROP_PSEUDO_CLASS]);
+      st_widget_sync_accessible (actor, PROP_PSEUDO_CLASS);
     }
 }
 
@@ -1371,6 +2031,7 @@ st_widget_add_style_pseudo_class (StWidget    *actor,
     {
       st_widget_style_changed (actor);
       g_object_notify_by_pspec (G_OBJECT (actor), props[PROP_PSEUDO_CLASS]);
+      st_widget_sync_accessible (actor, PROP_PSEUDO_CLASS);
     }
 }
 
@@ -1397,6 +2058,7 @@ st_widget_remove_style_pseudo_class (StWidget    *actor,
     {
       st_widget_style_changed (actor);
       g_object_notify_by_pspec (G_OBJECT (actor), props[PROP_PSEUDO_CLASS]);
+      st_widget_sync_accessible (actor, PROP_PSEUDO_CLASS);
     }
 }
 
@@ -1783,10 +2445,7 @@ st_widget_ensure_style (StWidget *widget)
   priv = st_widget_get_instance_private (widget);
 
   if (priv->is_style_dirty)
-    {
-      st_widget_recompute_style (widget, NULL);
-      notify_children_of_style_change (CLUTTER_ACTOR (widget));
-    }
+    ensure_style (widget);
 }
 
 /**
@@ -1948,6 +2607,7 @@ st_widget_set_can_focus (StWidget *widget,
     {
       priv->can_focus = can_focus;
       g_object_notify_by_pspec (G_OBJECT (widget), props[PROP_CAN_FOCUS]);
+      st_widget_sync_accessible (widget, PROP_CAN_FOCUS);
     }
 }
 
@@ -1980,66 +2640,42 @@ st_widget_popup_menu (StWidget *self)
   g_signal_emit (self, signals[POPUP_MENU], 0);
 }
 
-/* filter @children to contain only only actors that overlap @rbox
- * when moving in @direction. (Assuming no transformations.)
+typedef struct {
+  ClutterActor *actor;
+  int distance;
+} FocusCandidate;
+
+/* Whether @cbox is in @direction from @rbox. (Assuming no
+ * transformations.) To account for floating-point imprecision, an
+ * actor is "down" (etc.) from an another actor even if it overlaps it
+ * by up to 0.1 pixels.
  */
-static GList *
-filter_by_position (GList            *children,
-                    ClutterActorBox  *rbox,
-                    StDirectionType   direction)
+static gboolean
+is_in_direction (ClutterActorBox *cbox,
+                 ClutterActorBox *rbox,
+                 StDirectionType  direction)
 {
-  ClutterActorBox cbox;
-  graphene_point3d_t abs_vertices[4];
-  GList *l, *ret;
-  ClutterActor *child;
-
-  for (l = children, ret = NULL; l; l = l->next)
+  switch (direction)
     {
-      child = l->data;
-      clutter_actor_get_abs_allocation_vertices (child, abs_vertices);
-      clutter_actor_box_from_vertices (&cbox, abs_vertices);
-
-      /* Filter out children if they are in the wrong direction from
-       * @rbox, or if they don't overlap it. To account for floating-
-       * point imprecision, an actor is "down" (etc.) from an another
-       * actor even if it overlaps it by up to 0.1 pixels.
-       */
-      switch (direction)
-        {
-        case ST_DIR_UP:
-          if (cbox.y2 > rbox->y1 + 0.1)
-            continue;
-          break;
+    case ST_DIR_UP:
+      return cbox->y2 <= rbox->y1 + 0.1;
 
-        case ST_DIR_DOWN:
-          if (cbox.y1 < rbox->y2 - 0.1)
-            continue;
-          break;
+    case ST_DIR_DOWN:
+      return cbox->y1 >= rbox->y2 - 0.1;
 
-        case ST_DIR_LEFT:
-          if (cbox.x2 > rbox->x1 + 0.1)
-            continue;
-          break;
+    case ST_DIR_LEFT:
+      return cbox->x2 <= rbox->x1 + 0.1;
 
-        case ST_DIR_RIGHT:
-          if (cbox.x1 < rbox->x2 - 0.1)
-            continue;
-          break;
-
-        case ST_DIR_TAB_BACKWARD:
-        case ST_DIR_TAB_FORWARD:
-        default:
-          g_return_val_if_reached (NULL);
-        }
+    case ST_DIR_RIGHT:
+      return cbox->x1 >= rbox->x2 - 0.1;
 
-      ret = g_list_prepend (ret, child);
+    case ST_DIR_TAB_BACKWARD:
+    case ST_DIR_TAB_FORWARD:
+    default:
+      g_return_val_if_reached (FALSE);
     }
-
-  g_list_free (children);
-  return ret;
 }
 
-
 static void
 get_midpoint (ClutterActorBox *box,
               int             *x,
@@ -2049,18 +2685,13 @@ get_midpoint (ClutterActorBox *box,
   *y = (box->y1 + box->y2) / 2;
 }
 
-static double
-get_distance (ClutterActor    *actor,
+static int
+get_distance (ClutterActorBox *abox,
               ClutterActorBox *bbox)
 {
   int ax, ay, bx, by, dx, dy;
-  ClutterActorBox abox;
-  graphene_point3d_t abs_vertices[4];
-
-  clutter_actor_get_abs_allocation_vertices (actor, abs_vertices);
-  clutter_actor_box_from_vertices (&abox, abs_vertices);
 
-  get_midpoint (&abox, &ax, &ay);
+  get_midpoint (abox, &ax, &ay);
   get_midpoint (bbox, &bx, &by);
   dx = ax - bx;
   dy = ay - by;
@@ -2070,15 +2701,52 @@ get_distance (ClutterActor    *actor,
 }
 
 static int
-sort_by_distance (gconstpointer  a,
-                  gconstpointer  b,
-                  gpointer       user_data)
+compare_candidates (gconstpointer a,
+                    gconstpointer b)
 {
-  ClutterActor *actor_a = (ClutterActor *)a;
-  ClutterActor *actor_b = (ClutterActor *)b;
-  ClutterActorBox *box = user_data;
+  const FocusCandidate *candidate_a = a;
+  const FocusCandidate *candidate_b = b;
 
-  return get_distance (actor_a, box) - get_distance (actor_b, box);
+  return candidate_a->distance - candidate_b->distance;
+}
+
+/* Returns the actors of @children sorted by their distance from @rbox,
+ * leaving out those that aren't in @direction from it if @filter is set.
+ * Transforming an allocation to stage coordinates walks up the whole
+ * hierarchy, so each child's box is only computed once, rather than on
+ * every comparison of the sort.
+ */
+static GArray *
+get_focus_candidates (GList            *children,
+                      ClutterActorBox  *rbox,
+                      StDirectionType   direction,
+                      gboolean          filter)
+{
+  GArray *candidates;
+  GList *l;
+
+  candidates = g_array_new (FALSE, FALSE, sizeof (FocusCandidate));
+
+  for (l = children; l; l = l->next)
+    {
+      graphene_point3d_t abs_vertices[4];
+      FocusCandidate candidate;
+      ClutterActorBox cbox;
+
+      clutter_actor_get_abs_allocation_vertices (l->data, abs_vertices);
+      clutter_actor_box_from_vertices (&cbox, abs_vertices);
+
+      if (filter && !is_in_direction (&cbox, rbox, direction))
+        continue;
+
+      candidate.actor = l->data;
+      candidate.distance = get_distance (&cbox, rbox);
+      g_array_append_val (candidates, candidate);
+    }
+
+  g_array_sort (candidates, compare_candidates);
+
+  return candidates;
 }
 
 static gboolean
@@ -2087,6 +2755,7 @@ st_widget_real_navigate_focus (StWidget         *widget,
                                StDirectionType   direction)
 {
   StWidgetPrivate *priv = st_widget_get_instance_private (widget);
+  g_autoptr (GArray) candidates = NULL;
   ClutterActor *widget_actor, *focus_child;
   GList *children, *l;
 
@@ -2201,10 +2870,26 @@ st_widget_real_navigate_focus (StWidget         *widget,
             }
         }
 
-      if (from)
-        children = filter_by_position (children, &sort_box, direction);
-      if (children)
-        children = g_list_sort_with_data (children, sort_by_distance, &sort_box);
+      candidates = get_focus_candidates (children, &sort_box, direction,
+                                         from != NULL);
+      g_clear_pointer (&children, g_list_free);
+    }
+
+  /* Try the closest children first */
+  if (candidates)
+    {
+      guint i;
+
+      for (i = 0; i < candidates->len; i++)
+        {
+          ClutterActor *actor = g_array_index (candidates, FocusCandidate, i).actor;
+
+          if (ST_IS_WIDGET (actor) &&
+              st_widget_navigate_focus (ST_WIDGET (actor), from, direction, FALSE))
+            return TRUE;
+        }
+
+      return FALSE;
     }
 
   /* Now try each child in turn */
@@ -2421,6 +3106,7 @@ st_widget_set_label_actor (StWidget     *widget,
         priv->label_actor = NULL;
 
       g_object_notify_by_pspec (G_OBJECT (widget), props[PROP_LABEL_ACTOR]);
+      st_widget_sync_accessible (widget, PROP_LABEL_ACTOR);
     }
 }
 
@@ -2457,6 +3143,7 @@ st_widget_set_accessible_name (StWidget    *widget,
 
   priv->accessible_name = g_strdup (name);
   g_object_notify_by_pspec (G_OBJECT (widget), props[PROP_ACCESSIBLE_NAME]);
+  st_widget_sync_accessible (widget, PROP_ACCESSIBLE_NAME);
 }
 
 /**
@@ -2627,15 +3314,6 @@ static void         st_widget_accessible_initialize    (AtkObject *obj,
 static AtkRole      st_widget_accessible_get_role      (AtkObject *obj);
 
 /* Private methods */
-static void on_pseudo_class_notify (GObject    *gobject,
-                                    GParamSpec *pspec,
-                                    gpointer    data);
-static void on_can_focus_notify    (GObject    *gobject,
-                                    GParamSpec *pspec,
-                                    gpointer    data);
-static void on_label_notify        (GObject    *gobject,
-                                    GParamSpec *pspec,
-                                    gpointer    data);
 static void check_pseudo_class     (StWidgetAccessible *self,
                                     StWidget *widget);
 static void check_labels           (StWidgetAccessible *self,
@@ -2814,12 +3492,44 @@ st_widget_accessible_dispose (GObject *gobject)
   G_OBJECT_CLASS (st_widget_accessible_parent_class)->dispose (gobject);
 }
 
+/* Called by the widget's setters instead of connecting to its notify
+ * signals, so that pseudo class changes and the like don't go through
+ * any a11y signal handlers. Accessibles are only created once an AT
+ * asks for them, until then this is a single pointer check.
+ */
 static void
-on_accessible_name_notify (GObject    *gobject,
-                           GParamSpec *pspec,
-                           AtkObject  *accessible)
+st_widget_sync_accessible (StWidget *widget,
+                           guint     prop_id)
 {
-  g_object_notify (G_OBJECT (accessible), "accessible-name");
+  StWidgetPrivate *priv = st_widget_get_instance_private (widget);
+  AtkObject *accessible = priv->accessible;
+
+  if (G_LIKELY (accessible == NULL) || !ST_IS_WIDGET_ACCESSIBLE (accessible))
+    return;
+
+  switch (prop_id)
+    {
+    case PROP_PSEUDO_CLASS:
+      check_pseudo_class (ST_WIDGET_ACCESSIBLE (accessible), widget);
+      break;
+
+    case PROP_CAN_FOCUS:
+      atk_object_notify_state_change (accessible,
+                                      ATK_STATE_FOCUSABLE,
+                                      st_widget_get_can_focus (widget));
+      break;
+
+    case PROP_LABEL_ACTOR:
+      check_labels (ST_WIDGET_ACCESSIBLE (accessible), widget);
+      break;
+
+    case PROP_ACCESSIBLE_NAME:
+      g_object_notify (G_OBJECT (accessible), "accessible-name");
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
 }
 
 static void
@@ -2828,22 +3538,6 @@ st_widget_accessible_initialize (AtkObject *obj,
 {
   ATK_OBJECT_CLASS (st_widget_accessible_parent_class)->initialize (obj, data);
 
-  g_signal_connect (data, "notify::pseudo-class",
-                    G_CALLBACK (on_pseudo_class_notify),
-                    obj);
-
-  g_signal_connect (data, "notify::can-focus",
-                    G_CALLBACK (on_can_focus_notify),
-                    obj);
-
-  g_signal_connect (data, "notify::label-actor",
-                    G_CALLBACK (on_label_notify),
-                    obj);
-
-  g_signal_connect (data, "notify::accessible-name",
-                    G_CALLBACK (on_accessible_name_notify),
-                    obj);
-
   /* Check the cached selected state and notify the first selection.
    * Ie: it is required to ensure a first notification when Alt+Tab
    * popup appears
@@ -2925,15 +3619,6 @@ st_widget_accessible_get_role (AtkObject *obj)
   return ATK_OBJECT_CLASS (st_widget_accessible_parent_class)->get_role (obj);
 }
 
-static void
-on_pseudo_class_notify (GObject    *gobject,
-                        GParamSpec *pspec,
-                        gpointer    data)
-{
-  check_pseudo_class (ST_WIDGET_ACCESSIBLE (data),
-                      ST_WIDGET (gobject));
-}
-
 /*
  * In some cases the only way to check some states are checking the
  * pseudo-class. Like if the object is selected (see bug 637830) or if
@@ -2979,25 +3664,6 @@ check_pseudo_class (StWidgetAccessible *self,
     }
 }
 
-static void
-on_can_focus_notify (GObject    *gobject,
-                     GParamSpec *pspec,
-                     gpointer    data)
-{
-  gboolean can_focus = st_widget_get_can_focus (ST_WIDGET (gobject));
-
-  atk_object_notify_state_change (ATK_OBJECT (data),
-                                  ATK_STATE_FOCUSABLE, can_focus);
-}
-
-static void
-on_label_notify (GObject    *gobject,
-                 GParamSpec *pspec,
-                 gpointer    data)
-{
-  check_labels (ST_WIDGET_ACCESSIBLE (data), ST_WIDGET (gobject));
-}
-
 static void
 check_labels (StWidgetAccessible *widget_accessible,
               StWidget           *widget)
@@ -149,6 +149,16 @@ void                  st_widget_paint_background          (StWidget         *wid
 /* debug methods */
 char  *st_describe_actor       (ClutterActor *actor);
 
+void      st_widget_set_profiling_enabled (gboolean  enabled);
+gboolean  st_widget_get_profiling_enabled (void);
+void      st_widget_reset_profile         (void);
+GList    *st_widget_get_profiled_widgets  (void);
+void      st_widget_get_profile           (StWidget *widget,
+                                           double   *preferred_size_time,
+                                           double   *allocate_time,
+                                           double   *paint_node_time,
+                                           double   *theme_node_paint_time);
+
 /* accessibility methods */
 void                  st_widget_set_accessible_role      (StWidget    *widget,
                                                           AtkRole      role);
@@ -29,6 +29,7 @@
 #include <meta/meta-backend.h>
 
 static ClutterActor *stage;
+static StThemeContext *theme_context;
 static StThemeNode *root;
 static StThemeNode *group1;
 static StThemeNode *text1;
@@ -432,6 +433,13 @@ test_font (void)
   assert_font (group2, "group2", "serif Italic 12px");
   /* text3 inherits and overrides individually properties */
   assert_font (text3,  "text3",  "serif Bold Oblique Small-Caps 24px");
+  /* text4 doesn't change the font, so it shares the one of group2 */
+  assert_font (text4,  "text4",  "serif Italic 12px");
+  if (st_theme_node_get_font (text4) != st_theme_node_get_font (group2))
+    {
+      g_print ("%s: text4.font: expected the font of group2\n", test);
+      fail = TRUE;
+    }
 }
 
 static void
@@ -535,6 +543,48 @@ test_inline_style (void)
                  st_theme_node_get_padding (text3, ST_SIDE_BOTTOM));
 }
 
+static void
+test_inline_style_sharing (void)
+{
+  StThemeNode *text5;
+
+  test = "inline_style_sharing";
+  /* A node with the same inline style shares the parsed declarations */
+  text5 = st_theme_node_new (theme_context, group2, NULL,
+                             CLUTTER_TYPE_TEXT, "text5", NULL, NULL,
+                             "color: #0000ff; padding-bottom: 12px;");
+  assert_foreground_color (text5,   "text5",  "#0000ffff");
+  assert_length ("text5", "padding-bottom", 12.,
+                 st_theme_node_get_padding (text5, ST_SIDE_BOTTOM));
+  g_object_unref (text5);
+
+  /* ... and the declarations outlive it */
+  assert_foreground_color (text3,   "text3",  "#0000ffff");
+  assert_length ("text3", "padding-bottom", 12.,
+                 st_theme_node_get_padding (text3, ST_SIDE_BOTTOM));
+}
+
+static void
+test_color_functions (void)
+{
+  StThemeNode *text6;
+  int i;
+
+  test = "color_functions";
+  /* Color functions are evaluated once when parsing, check that every
+   * node sharing the declarations still gets the same colors */
+  for (i = 0; i < 2; i++)
+    {
+      text6 = st_theme_node_new (theme_context, group2, NULL,
+                                 CLUTTER_TYPE_TEXT, "text6", NULL, NULL,
+                                 "color: rgba(255, 0, 0, 0.5);"
+                                 "background-color: st-mix(#ff0000, #0000ff, 50%);");
+      assert_foreground_color (text6, "text6", "#ff000080");
+      assert_background_color (text6, "text6", "#7f007fff");
+      g_object_unref (text6);
+    }
+}
+
 int
 main (int argc, char **argv)
 {
@@ -542,7 +592,6 @@ main (int argc, char **argv)
   g_autoptr (GError) error = NULL;
   MetaBackend *backend;
   StTheme *theme;
-  StThemeContext *theme_context;
   PangoFontDescription *font_desc;
   GFile *file;
   g_autofree char *cwd = NULL;
@@ -615,6 +664,8 @@ main (int argc, char **argv)
   test_font_features ();
   test_pseudo_class ();
   test_inline_style ();
+  test_inline_style_sharing ();
+  test_color_functions ();
 
   g_object_unref (button);
   g_object_unref (group1);
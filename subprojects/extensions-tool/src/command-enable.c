@@ -26,46 +26,70 @@
 #include "config.h"
 
 static gboolean
-enable_extension_gsettings (const char *uuid)
+enable_extensions_gsettings (char **uuids)
 {
   g_autoptr(GSettings) settings = get_shell_settings ();
+  gboolean success = TRUE;
+  char **uuid;
 
   if (settings == NULL)
     return FALSE;
 
-  return settings_list_add (settings, "enabled-extensions", uuid) &&
-         settings_list_remove (settings, "disabled-extensions", uuid);
+  /* Write all the extensions at once, for one change notification */
+  g_settings_delay (settings);
+
+  for (uuid = uuids; *uuid != NULL && success; uuid++)
+    success = settings_list_add (settings, "enabled-extensions", *uuid) &&
+              settings_list_remove (settings, "disabled-extensions", *uuid);
+
+  if (success)
+    g_settings_apply (settings);
+  else
+    g_settings_revert (settings);
+
+  g_settings_sync ();
+
+  return success;
 }
 
 static gboolean
-enable_extension_dbus (GDBusProxy *proxy,
-                       const char *uuid)
+enable_extensions_dbus (GDBusProxy  *proxy,
+                        char       **uuids)
 {
   g_autoptr (GVariant) response = NULL;
+  g_autoptr (GVariantIter) iter = NULL;
   g_autoptr (GError) error = NULL;
-  gboolean success = FALSE;
+  gboolean all_success = TRUE;
+  gboolean success;
+  char **uuid = uuids;
 
   response = g_dbus_proxy_call_sync (proxy,
-                                     "EnableExtension",
-                                     g_variant_new ("(s)", uuid),
+                                     "EnableExtensions",
+                                     g_variant_new ("(^as)", uuids),
                                      0,
                                      -1,
                                      NULL,
                                      &error);
 
   if (response == NULL)
-    return enable_extension_gsettings (uuid);
+    return enable_extensions_gsettings (uuids);
 
-  g_variant_get (response, "(b)", &success);
+  g_variant_get (response, "(ab)", &iter);
 
-  if (!success)
-    g_printerr (_("Extension “%s” does not exist\n"), uuid);
+  while (g_variant_iter_next (iter, "b", &success) && *uuid != NULL)
+    {
+      if (!success)
+        g_printerr (_("Extension “%s” does not exist\n"), *uuid);
 
-  return success;
+      all_success = all_success && success;
+      uuid++;
+    }
+
+  return all_success;
 }
 
 static gboolean
-enable_extension (const char *uuid)
+enable_extensions (char **uuids)
 {
   g_autoptr (GDBusProxy) proxy = NULL;
   g_autoptr (GError) error = NULL;
@@ -73,9 +97,9 @@ enable_extension (const char *uuid)
   proxy = get_shell_proxy (&error);
 
   if (proxy != NULL)
-    return enable_extension_dbus (proxy, uuid);
+    return enable_extensions_dbus (proxy, uuids);
   else
-    return enable_extension_gsettings (uuid);
+    return enable_extensions_gsettings (uuids);
 }
 
 int
@@ -95,7 +119,7 @@ handle_enable (int argc, char *argv[], gboolean do_help)
 
   context = g_option_context_new (NULL);
   g_option_context_set_help_enabled (context, FALSE);
-  g_option_context_set_summary (context, _("Enable an extension"));
+  g_option_context_set_summary (context, _("Enable extensions"));
   g_option_context_add_main_entries (context, entries, GETTEXT_PACKAGE);
   g_option_context_add_group (context, get_option_group());
 
@@ -116,11 +140,6 @@ handle_enable (int argc, char *argv[], gboolean do_help)
       show_help (context, _("No UUID given"));
       return 1;
     }
-  else if (g_strv_length (uuids) > 1)
-    {
-      show_help (context, _("More than one UUID given"));
-      return 1;
-    }
 
-  return enable_extension (*uuids) ? 0 : 2;
+  return enable_extensions (uuids) ? 0 : 2;
 }
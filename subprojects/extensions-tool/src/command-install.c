@@ -184,6 +184,8 @@ handle_install (int argc, char *argv[], gboolean do_help)
   g_autoptr (GError) error = NULL;
   g_auto (GStrv) filenames = NULL;
   gboolean force = FALSE;
+  char **filename;
+  int status = 0;
   GOptionEntry entries[] = {
     { .long_name = "force", .short_name = 'f',
       .arg = G_OPTION_ARG_NONE, .arg_data = &force,
@@ -198,7 +200,7 @@ handle_install (int argc, char *argv[], gboolean do_help)
 
   context = g_option_context_new (NULL);
   g_option_context_set_help_enabled (context, FALSE);
-  g_option_context_set_summary (context, _("Install an extension bundle"));
+  g_option_context_set_summary (context, _("Install extension bundles"));
   g_option_context_add_main_entries (context, entries, GETTEXT_PACKAGE);
   g_option_context_add_group (context, get_option_group());
 
@@ -220,11 +222,13 @@ handle_install (int argc, char *argv[], gboolean do_help)
       return 1;
     }
 
-  if (g_strv_length (filenames) > 1)
+  for (filename = filenames; *filename != NULL; filename++)
     {
-      show_help (context, _("More than one extension bundle specified"));
-      return 1;
+      int res = install_extension (*filename, force);
+
+      if (res != 0)
+        status = res;
     }
 
-  return install_extension (*filenames, force);
+  return status;
 }
@@ -20,6 +20,7 @@
 
 #include <glib/gi18n.h>
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 
 #include <gnome-autoar/gnome-autoar.h>
 #include <json-glib/json-glib.h>
@@ -167,6 +168,81 @@ extension_pack_add_schemas (ExtensionPack  *pack,
   return TRUE;
 }
 
+/* Compiled translations are kept in the user's cache directory, named by
+ * a checksum of their source, so that packing again only runs msgfmt
+ * for translations that changed.
+ */
+static char *
+get_translation_cache_dir (void)
+{
+  return g_build_filename (g_get_user_cache_dir (),
+                           "gnome-extensions", "translations", NULL);
+}
+
+static void
+cache_translation (const char *mopath,
+                   const char *cachedir,
+                   const char *cachepath)
+{
+  g_autoptr (GFile) src = NULL;
+  g_autoptr (GFile) tmp = NULL;
+  g_autofree char *tmppath = NULL;
+
+  if (g_mkdir_with_parents (cachedir, 0755) < 0)
+    return;
+
+  /* Other packs may be caching the same translation */
+  tmppath = g_strdup_printf ("%s.%08x", cachepath, g_random_int ());
+  src = g_file_new_for_path (mopath);
+  tmp = g_file_new_for_path (tmppath);
+
+  if (!g_file_copy (src, tmp, G_FILE_COPY_NONE, NULL, NULL, NULL, NULL))
+    return;
+
+  if (g_rename (tmppath, cachepath) < 0)
+    g_file_delete (tmp, NULL, NULL);
+}
+
+static gboolean
+compile_translation (const char  *popath,
+                     const char  *mopath,
+                     GError     **error)
+{
+  g_autoptr (GSubprocess) proc = NULL;
+  g_autoptr (GFile) cached = NULL;
+  g_autoptr (GFile) dst = NULL;
+  g_autofree char *contents = NULL;
+  g_autofree char *checksum = NULL;
+  g_autofree char *cachedir = NULL;
+  g_autofree char *cachename = NULL;
+  g_autofree char *cachepath = NULL;
+  gsize length;
+
+  if (!g_file_get_contents (popath, &contents, &length, error))
+    return FALSE;
+
+  checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256,
+                                          (const guchar *) contents, length);
+  cachedir = get_translation_cache_dir ();
+  cachename = g_strdup_printf ("%s.mo", checksum);
+  cachepath = g_build_filename (cachedir, cachename, NULL);
+
+  cached = g_file_new_for_path (cachepath);
+  dst = g_file_new_for_path (mopath);
+  if (g_file_copy (cached, dst, G_FILE_COPY_NONE, NULL, NULL, NULL, NULL))
+    return TRUE;
+
+  proc = g_subprocess_new (G_SUBPROCESS_FLAGS_STDERR_SILENCE, error,
+                           "msgfmt", "-o", mopath, popath, NULL);
+
+  if (!g_subprocess_wait_check (proc, NULL, error))
+    return FALSE;
+
+  /* Failing to cache only means compiling again next time */
+  cache_translation (mopath, cachedir, cachepath);
+  return TRUE;
+}
+
 static gboolean
 extension_pack_add_locales (ExtensionPack  *pack,
                             const char     *podir,
@@ -215,7 +291,6 @@ extension_pack_add_locales (ExtensionPack  *pack,
 
   while (TRUE)
     {
-      g_autoptr (GSubprocess) proc = NULL;
       g_autoptr (GFile) modir = NULL;
       g_autofree char *popath = NULL;
       g_autofree char *mopath = NULL;
@@ -240,10 +315,7 @@ extension_pack_add_locales (ExtensionPack  *pack,
       mopath = g_build_filename (dstpath, lang, "LC_MESSAGES", moname, NULL);
       popath = g_file_get_path (child);
 
-      proc = g_subprocess_new (G_SUBPROCESS_FLAGS_STDERR_SILENCE, error,
-                               "msgfmt", "-o", mopath, popath, NULL);
-
-      if (!g_subprocess_wait_check (proc, NULL, error))
+      if (!compile_translation (popath, mopath, error))
         return FALSE;
     }
 
@@ -425,6 +497,58 @@ err:
   return 0;
 }
 
+typedef struct {
+  char *dstdir;
+  gboolean force;
+  char **extra_sources;
+  char **schemas;
+  char *podir;
+  char *gettext_domain;
+
+  int status;
+} PackOptions;
+
+static void
+pack_extension_func (gpointer data,
+                     gpointer user_data)
+{
+  char *srcdir = data;
+  PackOptions *options = user_data;
+  int status;
+
+  status = pack_extension (srcdir, options->dstdir, options->force,
+                           options->extra_sources, options->schemas,
+                           options->podir, options->gettext_domain);
+  if (status != 0)
+    g_atomic_int_set (&options->status, status);
+}
+
+/* Packs every source directory, as many at a time as there are
+ * processors, and returns the status of a failed one if any */
+static int
+pack_extensions (char        **srcdirs,
+                 PackOptions  *options)
+{
+  g_autoptr (GError) error = NULL;
+  GThreadPool *pool;
+  char **s;
+
+  pool = g_thread_pool_new (pack_extension_func, options,
+                            g_get_num_processors (), FALSE, &error);
+  if (pool == NULL)
+    {
+      g_printerr ("%s\n", error->message);
+      return 2;
+    }
+
+  for (s = srcdirs; *s; s++)
+    g_thread_pool_push (pool, *s, NULL);
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  return options->status;
+}
+
 int
 handle_pack (int argc, char *argv[], gboolean do_help)
 {
@@ -488,22 +612,27 @@ handle_pack (int argc, char *argv[], gboolean do_help)
       return 1;
     }
 
-  if (srcdirs)
-    {
-      if (g_strv_length (srcdirs) > 1)
-        {
-          show_help (context, _("More than one source directory specified"));
-          return 1;
-        }
-      srcdir = g_strdup (*srcdirs);
-    }
-  else
+  if (dstdir == NULL)
+    dstdir = g_get_current_dir ();
+
+  if (srcdirs && g_strv_length (srcdirs) > 1)
     {
-      srcdir = g_get_current_dir ();
+      PackOptions options = {
+        .dstdir = dstdir,
+        .force = force,
+        .extra_sources = extra_sources,
+        .schemas = schemas,
+        .podir = podir,
+        .gettext_domain = gettext_domain,
+      };
+
+      return pack_extensions (srcdirs, &options);
     }
 
-  if (dstdir == NULL)
-    dstdir = g_get_current_dir ();
+  if (srcdirs)
+    srcdir = g_strdup (*srcdirs);
+  else
+    srcdir = g_get_current_dir ();
 
   return pack_extension (srcdir, dstdir, force,
                          extra_sources, schemas, podir, gettext_domain);
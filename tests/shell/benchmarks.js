@@ -0,0 +1,308 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+/* eslint camelcase: ["error", { properties: "never", allow: ["^script_", "^clutter"] }] */
+
+import GLib from 'gi://GLib';
+
+import * as AltTab from 'resource:///org/gnome/shell/ui/altTab.js';
+import * as Main from 'resource:///org/gnome/shell/ui/main.js';
+import * as MessageTray from 'resource:///org/gnome/shell/ui/messageTray.js';
+import * as Scripting from 'resource:///org/gnome/shell/ui/scripting.js';
+
+// This performance script times common interactions, each repeated a
+// number of times, and reports the median time and frame rate of each.
+//
+// If SHELL_PERF_BASELINE names a JSON file mapping metric names to
+// values, such as the "metrics" of an earlier run's output with
+// SHELL_PERF_OUTPUT, the script fails when a metric is more than
+// SHELL_PERF_TOLERANCE percent (by default 20) worse than its baseline.
+
+const REPETITIONS = 5;
+const DEFAULT_TOLERANCE = 20;
+
+const SCENARIOS = {
+    appGridSwipe: 'switching pages of the app grid',
+    searchKeystroke: 'updating search results for a typed character',
+    notificationBurst: 'showing a burst of 10 notifications',
+    workspaceSwitch: 'switching workspaces',
+    altTab100Windows: 'showing the window switcher with 100 windows',
+    quickSettings: 'opening the quick settings menu',
+    lockUnlock: 'locking and unlocking the screen',
+};
+
+export var METRICS = {};
+
+for (const [name, description] of Object.entries(SCENARIOS)) {
+    METRICS[`${name}Time`] = {
+        description: `Median time for ${description}`,
+        units: 'us',
+    };
+    METRICS[`${name}Fps`] = {
+        description: `Median frame rate while ${description}`,
+        units: 'frames / s',
+    };
+}
+
+// The scenario of every benchmarkStart event, in order
+const runs = [];
+
+/**
+ * @param {string} scenario - the scenario to time
+ * @param {Function} action - async function performing one repetition
+ * @returns {void}
+ */
+async function measure(scenario, action) {
+    runs.push(scenario);
+    Scripting.scriptEvent('benchmarkStart');
+    await action();
+    await Scripting.waitLeisure();
+    Scripting.scriptEvent('benchmarkDone');
+}
+
+/**
+ * @param {string} scenario - the scenario to time
+ * @param {Function} action - async function performing one repetition
+ * @param {Function} reset - async function undoing the repetition
+ * @returns {void}
+ */
+async function repeat(scenario, action, reset) {
+    /* eslint-disable no-await-in-loop */
+    for (let i = 0; i < REPETITIONS; i++) {
+        await measure(scenario, action);
+        if (reset)
+            await reset();
+        await Scripting.waitLeisure();
+        await Scripting.sleep(200);
+    }
+    /* eslint-enable no-await-in-loop */
+}
+
+/**
+ * @param {number} count - the number of test windows to have
+ * @returns {void}
+ */
+async function createWindows(count) {
+    await Scripting.destroyTestWindows();
+    await Scripting.createTestWindows(
+        Array.from({length: count}, () => ({width: 640, height: 480})));
+    await Scripting.waitTestWindows();
+    await Scripting.waitLeisure();
+}
+
+/** @returns {void} */
+export async function run() {
+    /* eslint-disable no-await-in-loop */
+    Scripting.defineScriptEvent('benchmarkStart', 'Starting a benchmark repetition');
+    Scripting.defineScriptEvent('benchmarkDone', 'Done with a benchmark repetition');
+
+    global.frame_timestamps = true;
+
+    await Scripting.sleep(1000);
+
+    // App grid
+    Main.overview.show();
+    await Scripting.waitLeisure();
+    Main.overview.dash.showAppsButton.checked = true;
+    await Scripting.waitLeisure();
+
+    const appDisplay = Main.overview._overview.controls.appDisplay;
+    let page = 0;
+    await repeat('appGridSwipe', () => {
+        page = page === 0 ? 1 : 0;
+        appDisplay.goToPage(page);
+    });
+
+    // eslint-disable-next-line require-atomic-updates
+    Main.overview.dash.showAppsButton.checked = false;
+    await Scripting.waitLeisure();
+
+    // Search
+    const {searchEntry} = Main.overview;
+    for (let i = 0; i < REPETITIONS; i++) {
+        for (const character of 'settings') {
+            await measure('searchKeystroke', () => {
+                searchEntry.text += character;
+            });
+        }
+        // eslint-disable-next-line require-atomic-updates
+        searchEntry.text = '';
+        await Scripting.waitLeisure();
+    }
+
+    Main.overview.hide();
+    await Scripting.waitLeisure();
+
+    // Notifications
+    const source = MessageTray.getSystemSource();
+    let notifications = [];
+    await repeat('notificationBurst', () => {
+        for (let i = 0; i < 10; i++) {
+            const notification = new MessageTray.Notification({
+                source,
+                title: `Benchmark notification ${i}`,
+                body: 'Lorem ipsum dolor sit amet',
+            });
+            notifications.push(notification);
+            source.addNotification(notification);
+        }
+    }, async () => {
+        notifications.forEach(n => n.destroy());
+        notifications = [];
+        await Scripting.sleep(1000);
+    });
+
+    // Workspaces; a window keeps the first one around
+    await createWindows(1);
+    const workspaceManager = global.workspace_manager;
+    await repeat('workspaceSwitch', async () => {
+        const index = workspaceManager.get_active_workspace_index() === 0 ? 1 : 0;
+        workspaceManager.get_workspace_by_index(index).activate(
+            global.get_current_time());
+        // Wait for the switch animation
+        await Scripting.sleep(250);
+    });
+
+    // Alt+Tab
+    await createWindows(100);
+    let popup;
+    await repeat('altTab100Windows', () => {
+        popup = new AltTab.WindowSwitcherPopup();
+        if (popup.show(false, 'switch-windows', 0))
+            popup._showImmediately();
+    }, () => popup.destroy());
+    await Scripting.destroyTestWindows();
+
+    // Quick settings
+    const {menu} = Main.panel.statusArea.quickSettings;
+    await repeat('quickSettings',
+        () => menu.open(),
+        () => menu.close());
+
+    // Screen shield
+    if (Main.screenShield) {
+        await repeat('lockUnlock', async () => {
+            Main.screenShield.lock(false);
+            await Scripting.waitLeisure();
+            Main.screenShield.deactivate(false);
+        });
+    }
+    /* eslint-enable no-await-in-loop */
+}
+
+const durations = {};
+const frameRates = {};
+let currentRun = 0;
+let runStart = null;
+let runFrames = 0;
+
+/**
+ * @param {number[]} values - the values to take the median of
+ * @returns {number}
+ */
+function median(values) {
+    const sorted = [...values].sort((a, b) => a - b);
+    const middle = Math.floor(sorted.length / 2);
+
+    if (sorted.length % 2)
+        return sorted[middle];
+
+    return (sorted[middle - 1] + sorted[middle]) / 2;
+}
+
+/**
+ * @param {number} time - event timestamp
+ * @returns {void}
+ */
+export function script_benchmarkStart(time) {
+    runStart = time;
+    runFrames = 0;
+}
+
+/**
+ * @param {number} time - event timestamp
+ * @returns {void}
+ */
+export function script_benchmarkDone(time) {
+    const scenario = runs[currentRun++];
+    const duration = time - runStart;
+
+    durations[scenario] ??= [];
+    durations[scenario].push(duration);
+
+    frameRates[scenario] ??= [];
+    if (duration > 0)
+        frameRates[scenario].push(runFrames / (duration / 1000000));
+
+    runStart = null;
+}
+
+/**
+ * @param {number} _time - event timestamp
+ * @returns {void}
+ */
+export function clutter_stagePaintDone(_time) {
+    if (runStart !== null)
+        runFrames++;
+}
+
+/**
+ * @returns {object} metric values by name, from SHELL_PERF_BASELINE
+ */
+function loadBaseline() {
+    const file = GLib.getenv('SHELL_PERF_BASELINE');
+    if (!file)
+        return null;
+
+    const [, contents] = GLib.file_get_contents(file);
+    const baseline = JSON.parse(new TextDecoder().decode(contents));
+
+    // Accept both plain name to value maps and perf output files
+    if (Array.isArray(baseline.metrics)) {
+        return Object.fromEntries(
+            baseline.metrics.map(({name, value}) => [name, value]));
+    }
+
+    return baseline;
+}
+
+/** @returns {void} */
+export function finish() {
+    for (const scenario of Object.keys(SCENARIOS)) {
+        if (!durations[scenario])
+            continue;
+
+        METRICS[`${scenario}Time`].value = median(durations[scenario]);
+        if (frameRates[scenario].length > 0)
+            METRICS[`${scenario}Fps`].value = median(frameRates[scenario]);
+    }
+
+    // Skipped scenarios have no value, and would make for invalid output
+    for (const name of Object.keys(METRICS)) {
+        if (METRICS[name].value === undefined)
+            delete METRICS[name];
+    }
+
+    const baseline = loadBaseline();
+    if (!baseline)
+        return;
+
+    const tolerance =
+        Number(GLib.getenv('SHELL_PERF_TOLERANCE') ?? DEFAULT_TOLERANCE) / 100;
+    const regressions = [];
+
+    for (const [name, metric] of Object.entries(METRICS)) {
+        const expected = baseline[name];
+        if (typeof expected !== 'number')
+            continue;
+
+        // Times should not grow, frame rates should not shrink
+        const regressed = metric.units === 'us'
+            ? metric.value > expected * (1 + tolerance)
+            : metric.value < expected * (1 - tolerance);
+
+        if (regressed)
+            regressions.push(`${name}: ${metric.value} ${metric.units}, baseline ${expected}`);
+    }
+
+    if (regressions.length > 0)
+        throw new Error(`Performance regressions:\n${regressions.join('\n')}`);
+}
@@ -0,0 +1,85 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+// Test cases for the day index of calendar events
+
+import {EventIndex} from 'resource:///org/gnome/shell/misc/eventIndex.js';
+
+function event(id, date, end) {
+    return {id, date, end};
+}
+
+function candidateIds(index, begin, end) {
+    return [...index.candidates(begin, end)].map(e => e.id).sort();
+}
+
+describe('EventIndex', () => {
+    let index;
+
+    beforeEach(() => {
+        index = new EventIndex();
+    });
+
+    it('files events under the days they overlap', () => {
+        index.set(event('a', new Date(2024, 0, 1, 10), new Date(2024, 0, 1, 11)));
+        index.set(event('b', new Date(2024, 0, 1, 22), new Date(2024, 0, 3, 2)));
+
+        expect(candidateIds(index, new Date(2024, 0, 1), new Date(2024, 0, 2)))
+            .toEqual(['a', 'b']);
+        expect(candidateIds(index, new Date(2024, 0, 2), new Date(2024, 0, 3)))
+            .toEqual(['b']);
+        expect(candidateIds(index, new Date(2024, 0, 4), new Date(2024, 0, 5)))
+            .toEqual([]);
+    });
+
+    it('leaves out the day an event ends at the beginning of', () => {
+        index.set(event('a', new Date(2024, 0, 1), new Date(2024, 0, 2)));
+
+        expect(candidateIds(index, new Date(2024, 0, 2), new Date(2024, 0, 3)))
+            .toEqual([]);
+    });
+
+    it('keeps zero-length events on their day', () => {
+        const date = new Date(2024, 0, 1, 12);
+        index.set(event('a', date, date));
+
+        expect(candidateIds(index, new Date(2024, 0, 1), new Date(2024, 0, 2)))
+            .toEqual(['a']);
+    });
+
+    it('yields events of several days once', () => {
+        index.set(event('a', new Date(2024, 0, 1), new Date(2024, 0, 10)));
+
+        expect(candidateIds(index, new Date(2024, 0, 1), new Date(2024, 1, 1)))
+            .toEqual(['a']);
+    });
+
+    it('replaces events with the same ID', () => {
+        index.set(event('a', new Date(2024, 0, 1, 10), new Date(2024, 0, 1, 11)));
+        index.set(event('a', new Date(2024, 0, 5, 10), new Date(2024, 0, 5, 11)));
+
+        expect(index.size).toBe(1);
+        expect(candidateIds(index, new Date(2024, 0, 1), new Date(2024, 0, 2)))
+            .toEqual([]);
+        expect(candidateIds(index, new Date(2024, 0, 5), new Date(2024, 0, 6)))
+            .toEqual(['a']);
+    });
+
+    it('removes events from all their days', () => {
+        index.set(event('a', new Date(2024, 0, 1), new Date(2024, 0, 3)));
+
+        expect(index.delete('a')).toBeTrue();
+        expect(index.delete('a')).toBeFalse();
+        expect(candidateIds(index, new Date(2024, 0, 1), new Date(2024, 0, 3)))
+            .toEqual([]);
+    });
+
+    it('yields long events for every interval', () => {
+        index.set(event('a', new Date(2020, 0, 1), new Date(2030, 0, 1)));
+
+        expect(candidateIds(index, new Date(2024, 0, 1), new Date(2024, 0, 2)))
+            .toEqual(['a']);
+
+        index.delete('a');
+        expect(candidateIds(index, new Date(2024, 0, 1), new Date(2024, 0, 2)))
+            .toEqual([]);
+    });
+});
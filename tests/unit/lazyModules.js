@@ -0,0 +1,27 @@
+// -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*-
+// Test cases for importing modules on first use
+
+import 'resource:///org/gnome/shell/ui/environment.js';
+import * as LazyModules from 'resource:///org/gnome/shell/misc/lazyModules.js';
+
+const PARAMS_MODULE = 'resource:///org/gnome/shell/misc/params.js';
+const MISSING_MODULE = 'resource:///org/gnome/shell/misc/doesNotExist.js';
+
+describe('LazyModules.load()', () => {
+    it('imports the module', async () => {
+        const Params = await LazyModules.load(PARAMS_MODULE);
+        expect(Params.parse).toBeInstanceOf(Function);
+    });
+
+    it('shares one import between callers', () => {
+        expect(LazyModules.load(PARAMS_MODULE))
+            .toBe(LazyModules.load(PARAMS_MODULE));
+    });
+
+    it('retries imports that failed', async () => {
+        const failed = LazyModules.load(MISSING_MODULE);
+        await expectAsync(failed).toBeRejected();
+        expect(LazyModules.load(MISSING_MODULE)).not.toBe(failed);
+        await expectAsync(LazyModules.load(MISSING_MODULE)).toBeRejected();
+    });
+});
@@ -134,6 +134,19 @@ describe('disconnectObject()', () => {
         expect(handler).not.toHaveBeenCalled();
     });
 
+    it('keeps the signals of other tracked objects', () => {
+        const handler = jasmine.createSpy();
+        const otherHandler = jasmine.createSpy();
+
+        emitter.connectObject('signal1', handler, trackedObject);
+        emitter.connectObject('signal1', otherHandler, trackedDestroyable);
+        emitter.disconnectObject(trackedObject);
+        emitter.emit('signal1');
+
+        expect(handler).not.toHaveBeenCalled();
+        expect(otherHandler).toHaveBeenCalled();
+    });
+
     it('is called when a tracked destroyable is destroyed', () => {
         const handler = jasmine.createSpy();
 